@@ -46,6 +46,19 @@ if [ $? -eq 0 ]; then
     ARGS="$(echo $ARGS | sed s/\-disk//)"
 fi
 
+# Check if a virtio block device is requested
+echo $ARGS | grep -q "\-virtio"
+if [ $? -eq 0 ]; then
+    VIRTIOIMAGE="bezos-virtio.hdd"
+    if [ ! -f "$VIRTIOIMAGE" ]; then
+        qemu-img create -f raw $VIRTIOIMAGE 1G
+    fi
+
+    QEMUARGS="$QEMUARGS -drive file=$VIRTIOIMAGE,format=raw,if=none,id=vblk0 -device virtio-blk-pci,drive=vblk0,disable-legacy=on,num-queues=4"
+
+    ARGS="$(echo $ARGS | sed s/\-virtio//)"
+fi
+
 # If events are requested then create the second serial port
 echo $ARGS | grep -q "\-events"
 if [ $? -eq 0 ]; then
@@ -0,0 +1,20 @@
+#!/bin/sh
+
+set -e
+
+FOLDER=$1
+DST=$2
+
+export MTOOLS_SKIP_CHECK=1
+
+rm -f $DST
+
+# 34 MiB is the smallest size that gives FAT32 enough clusters with 512 byte clusters
+mkfs.fat -C -F 32 -s 1 -n BEZOS $DST 34816 > /dev/null
+
+mcopy -s -i $DST $FOLDER/* ::/
+
+# a file spanning several hundred clusters
+seq 1 50000 > $DST.numbers
+mcopy -i $DST $DST.numbers ::/numbers.txt
+rm -f $DST.numbers
@@ -3,6 +3,8 @@
 #include "acpi/madt.hpp"
 #include "acpi/fadt.hpp"
 #include "acpi/mcfg.hpp"
+#include "acpi/slit.hpp"
+#include "acpi/srat.hpp"
 #include "memory/vmm_heap.hpp"
 #include "util/signature.hpp"
 
@@ -64,6 +66,8 @@ namespace acpi {
         const Madt *mMadt;
         const Mcfg *mMcfg;
         const Fadt *mFadt;
+        const Srat *mSrat;
+        const Slit *mSlit;
         const RsdtHeader *mDsdt;
         std::unique_ptr<const RsdtHeader*[]> mRsdtEntries;
         size_t mRsdtEntryCount;
@@ -92,6 +96,8 @@ namespace acpi {
         const Madt *madt() const { return mMadt; }
         const Mcfg *mcfg() const { return mMcfg; }
         const Fadt *fadt() const { return mFadt; }
+        const Srat *srat() const { return mSrat; }
+        const Slit *slit() const { return mSlit; }
         const RsdtHeader *dsdt() const { return mDsdt; }
 
         [[nodiscard]]
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "acpi/header.hpp"
+#include "util/signature.hpp"
+
+#include <stddef.h>
+
+namespace acpi {
+    /// @brief System Locality Distance Information Table.
+    ///
+    /// Contains a square matrix of the relative distance between each pair
+    /// of proximity domains, normalized such that the distance from a domain
+    /// to itself is 10.
+    struct [[gnu::packed]] Slit {
+        static constexpr TableSignature kSignature = util::Signature("SLIT");
+
+        RsdtHeader header; // signature must be "SLIT"
+        uint64_t localityCount;
+
+        uint8_t entries[];
+
+        bool contains(uint64_t from, uint64_t to) const {
+            return from < localityCount && to < localityCount
+                && (sizeof(Slit) + (localityCount * localityCount)) <= header.length;
+        }
+
+        uint8_t distance(uint64_t from, uint64_t to) const {
+            return entries[(from * localityCount) + to];
+        }
+    };
+
+    static_assert(sizeof(Slit) == 44);
+}
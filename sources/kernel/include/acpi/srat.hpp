@@ -0,0 +1,190 @@
+#pragma once
+
+#include "acpi/header.hpp"
+
+#include "util/signature.hpp"
+#include "util/format.hpp"
+
+namespace km {
+    class NumaTopology;
+}
+
+namespace acpi {
+    struct Slit;
+
+    enum class SratEntryType : uint8_t {
+        eProcessorAffinity = 0,
+        eMemoryAffinity = 1,
+        eX2ApicAffinity = 2,
+    };
+
+    struct [[gnu::packed]] SratEntry {
+        struct [[gnu::packed]] ProcessorAffinity {
+            uint8_t domainLow;
+            uint8_t apicId;
+            uint32_t flags;
+            uint8_t sapicEid;
+            uint8_t domainHigh[3];
+            uint32_t clockDomain;
+
+            bool isEnabled() const {
+                static constexpr uint32_t kEnabled = 1 << 0;
+                return flags & kEnabled;
+            }
+
+            uint32_t domain() const {
+                return uint32_t(domainLow)
+                    | (uint32_t(domainHigh[0]) << 8)
+                    | (uint32_t(domainHigh[1]) << 16)
+                    | (uint32_t(domainHigh[2]) << 24);
+            }
+        };
+
+        struct [[gnu::packed]] MemoryAffinity {
+            uint32_t domain;
+            uint16_t reserved0;
+            uint64_t baseAddress;
+            uint64_t length;
+            uint32_t reserved1;
+            uint32_t flags;
+            uint64_t reserved2;
+
+            bool isEnabled() const {
+                static constexpr uint32_t kEnabled = 1 << 0;
+                return flags & kEnabled;
+            }
+
+            bool isHotPluggable() const {
+                static constexpr uint32_t kHotPluggable = 1 << 1;
+                return flags & kHotPluggable;
+            }
+
+            bool isNonVolatile() const {
+                static constexpr uint32_t kNonVolatile = 1 << 2;
+                return flags & kNonVolatile;
+            }
+        };
+
+        struct [[gnu::packed]] X2ApicAffinity {
+            uint16_t reserved0;
+            uint32_t domain;
+            uint32_t x2apicId;
+            uint32_t flags;
+            uint32_t clockDomain;
+            uint32_t reserved1;
+
+            bool isEnabled() const {
+                static constexpr uint32_t kEnabled = 1 << 0;
+                return flags & kEnabled;
+            }
+        };
+
+        SratEntryType type;
+        uint8_t length;
+
+        union {
+            ProcessorAffinity processor;
+            MemoryAffinity memory;
+            X2ApicAffinity x2apic;
+        };
+    };
+
+    static_assert(sizeof(SratEntry::ProcessorAffinity) == 14);
+    static_assert(sizeof(SratEntry::MemoryAffinity) == 38);
+    static_assert(sizeof(SratEntry::X2ApicAffinity) == 22);
+
+    class SratIterator {
+        const uint8_t *mCurrent;
+
+    public:
+        SratIterator(const uint8_t *current)
+            : mCurrent(current)
+        { }
+
+        SratIterator& operator++() {
+            mCurrent += load()->length;
+            return *this;
+        }
+
+        const SratEntry *operator*() const {
+            return load();
+        }
+
+        const SratEntry *load() const noexcept {
+            return reinterpret_cast<const SratEntry*>(mCurrent);
+        }
+
+        friend bool operator!=(const SratIterator& lhs, const SratIterator& rhs) {
+            // prevent overrunning the end of the table in the case of a corrupted entry length
+            return lhs.mCurrent < rhs.mCurrent;
+        }
+    };
+
+    /// @brief System Resource Affinity Table.
+    ///
+    /// Associates processors and ranges of physical memory with proximity domains.
+    struct [[gnu::packed]] Srat {
+        static constexpr TableSignature kSignature = util::Signature("SRAT");
+
+        RsdtHeader header; // signature must be "SRAT"
+
+        uint32_t reserved0; // must be 1
+        uint64_t reserved1;
+
+        // these entries are variable length so i cant use a struct
+        uint8_t entries[];
+
+        SratIterator begin() const {
+            return SratIterator { entries };
+        }
+
+        SratIterator end() const {
+            return SratIterator { entries + header.length - sizeof(Srat) };
+        }
+    };
+
+    static_assert(sizeof(Srat) == 48);
+
+    /// @brief Build the NUMA topology described by the firmware.
+    ///
+    /// Disabled entries are ignored. If @p slit is not provided, or does not describe
+    /// a domain, then the distance between distinct nodes is assumed to be
+    /// @a km::kNumaRemoteDistance.
+    ///
+    /// @param srat The system resource affinity table.
+    /// @param slit The system locality distance table, may be null.
+    /// @param[out] topology The topology to populate.
+    ///
+    /// @return The result of the operation.
+    /// @retval OsStatusSuccess The topology was populated.
+    /// @retval OsStatusOutOfMemory More proximity domains than @a km::kMaxNumaNodes,
+    ///                             or failed to allocate memory.
+    [[nodiscard]]
+    OsStatus ReadNumaTopology(const Srat *srat, const Slit *slit, km::NumaTopology *topology [[outparam]]);
+}
+
+template<>
+struct km::Format<acpi::SratEntryType> {
+    static constexpr size_t kStringSize = km::Format<uint8_t>::kStringSize;
+    static stdx::StringView toString(char *buffer, acpi::SratEntryType type) {
+        switch (type) {
+        case acpi::SratEntryType::eProcessorAffinity:
+            return "Processor Affinity";
+        case acpi::SratEntryType::eMemoryAffinity:
+            return "Memory Affinity";
+        case acpi::SratEntryType::eX2ApicAffinity:
+            return "x2APIC Affinity";
+        default:
+            return km::Format<uint8_t>::toString(buffer, static_cast<uint8_t>(type));
+        }
+    }
+};
+
+template<>
+struct std::iterator_traits<acpi::SratIterator> {
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = const acpi::SratEntry*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const acpi::SratEntry*;
+    using reference = const acpi::SratEntry*;
+};
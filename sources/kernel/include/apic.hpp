@@ -69,6 +69,9 @@ namespace km {
             Trigger trigger;
             bool enabled;
             TimerMode timer = TimerMode::eNone;
+
+            /// @brief How the interrupt is delivered, the timer entry is always fixed.
+            IcrMode delivery = IcrMode::eFixed;
         };
 
         enum class Type {
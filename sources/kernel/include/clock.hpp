@@ -1,6 +1,7 @@
 #pragma once
 
 #include <bezos/facility/clock.h>
+#include <bezos/clock_page.h>
 
 #include "cmos.hpp"
 #include "units.hpp"
@@ -17,6 +18,7 @@ namespace km {
         os_instant mStartDate;
         OsTickCounter mStartTicks;
         mp::quantity<si::hertz, uint64_t> mFrequency;
+        OsClockPage mClockPage{};
 
     public:
         Clock(DateTime start, ITickSource *counter [[gnu::nonnull]]);
@@ -26,5 +28,11 @@ namespace km {
         OsStatus stat(OsClockInfo *result);
         OsStatus time(OsInstant *result);
         OsStatus ticks(OsTickCounter *result);
+
+        /// @brief The clock data to publish to the clock page.
+        ///
+        /// Userspace converts ticks to time with the same data, so time read
+        /// from the clock page always agrees with @a time.
+        OsClockPage clockPage() const { return mClockPage; }
     };
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -8,6 +9,24 @@
 extern "C" {
 #endif
 
+/// @brief Processor features used to select the memory copy and set routines.
+typedef struct KmMemoryFeatures {
+    /// @brief Enhanced rep movsb/stosb, cpuid.7.ebx[9].
+    bool erms;
+
+    /// @brief Fast short rep movsb, cpuid.7.edx[4].
+    bool fsrm;
+
+    /// @brief Non-temporal integer stores (movnti), cpuid.1.edx[26].
+    bool nonTemporal;
+} KmMemoryFeatures;
+
+/// @brief Select the memory routines for the current processor.
+///
+/// Must be called once on the BSP before other processors are started. Until this
+/// is called only the portable word-at-a-time routines are used.
+void KmInitMemoryRoutines(KmMemoryFeatures features);
+
 __attribute__((__nothrow__, __nonblocking__, __nonnull__))
 void KmMemoryCopy(void *dst, const void *src, size_t size);
 
@@ -15,6 +15,7 @@
 namespace km::debug {
     namespace detail {
         OsStatus SendEvent(const EventPacket &packet) noexcept [[clang::nonallocating]];
+        OsStatus TrySendEvent(const EventPacket &packet) noexcept [[clang::nonallocating]];
     }
 
     template<typename T>
@@ -47,18 +48,50 @@ namespace km::debug {
 
     OsStatus InitDebugStream(ComPortInfo info);
 
+    /// @brief Switch the debug stream to interrupt driven transmission.
+    ///
+    /// After this events are queued rather than written synchronously, events
+    /// that do not fit in the transmit ring are dropped whole.
+    ///
+    /// @param ioApicSet The ioapics to route the irq through.
+    /// @param target The apic to deliver the interrupt to.
+    /// @param ist The isr table to allocate the handler in.
+    ///
+    /// @return The result of the operation.
+    [[nodiscard]]
+    OsStatus EnableDebugStreamIrq(IoApicSet& ioApicSet, const IApic *target, LocalIsrTable *ist);
+
+    template<typename T>
+    EventPacket MakeEventPacket(const T& event) noexcept [[clang::nonblocking]] {
+        //
+        // Subobject initialization weirdness, can't be bothered to fix it.
+        //
+        EventPacket packet {
+            .event = EventType<T>(),
+        };
+        memcpy(&packet.data, &event, sizeof(T));
+        return packet;
+    }
+
     template<typename T>
     OsStatus SendEvent(const T& event) noexcept [[clang::nonallocating]] {
         if constexpr (KM_DEBUG_EVENTS) {
-            //
-            // Subobject initialization weirdness, can't be bothered to fix it.
-            //
-            EventPacket packet {
-                .event = EventType<T>(),
-            };
-            memcpy(&packet.data, &event, sizeof(T));
-
-            return detail::SendEvent(packet);
+            return detail::SendEvent(MakeEventPacket(event));
+        } else {
+            return OsStatusSuccess;
+        }
+    }
+
+    /// @brief Send an event if the stream is not in use.
+    ///
+    /// For interrupt handlers, which may have interrupted another sender on the
+    /// same cpu. The event is dropped rather than waiting for the stream.
+    ///
+    /// @retval OsStatusDeviceBusy The stream was in use and the event was dropped.
+    template<typename T>
+    OsStatus TrySendEvent(const T& event) noexcept [[clang::nonallocating]] {
+        if constexpr (KM_DEBUG_EVENTS) {
+            return detail::TrySendEvent(MakeEventPacket(event));
         } else {
             return OsStatusSuccess;
         }
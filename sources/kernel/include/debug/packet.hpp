@@ -42,6 +42,9 @@ namespace km::debug {
     struct ScheduleTask {
         uint64_t previous;
         uint64_t next;
+
+        /// @brief The cpu the switch happened on.
+        uint32_t cpu;
     };
 
     struct EventPacket {
@@ -54,4 +57,7 @@ namespace km::debug {
             ScheduleTask scheduleTask;
         } data;
     };
+
+    // the host tools read the stream as an array of packets
+    static_assert(sizeof(EventPacket) == 32);
 }
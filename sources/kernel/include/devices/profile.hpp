@@ -0,0 +1,31 @@
+#pragma once
+
+#include "fs/node.hpp"
+
+#include "std/spinlock.hpp"
+#include "std/string.hpp"
+
+namespace dev {
+    /// @brief The profiler samples of every cpu in the folded stack format.
+    ///
+    /// Reading from the start of the file drains the samples taken since the
+    /// last read, later offsets read from the same snapshot. Writing "start"
+    /// or "stop" starts or stops sampling.
+    class ProfileFile final : public vfs::BasicNode {
+        stdx::SpinLock mLock;
+        stdx::String mSnapshot GUARDED_BY(mLock);
+
+        OsStatus refresh() REQUIRES(mLock);
+
+    public:
+        ProfileFile() = default;
+
+        OsStatus query(sm::uuid uuid, const void *data, size_t size, vfs::IHandle **handle) override;
+        OsStatus interfaces(OsIdentifyInterfaceList *list);
+        OsStatus identify(OsIdentifyInfo *info);
+
+        OsStatus stat(OsFileInfo *stat);
+        OsStatus read(vfs::ReadRequest request, vfs::ReadResult *result);
+        OsStatus write(vfs::WriteRequest request, vfs::WriteResult *result);
+    };
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <bezos/subsystem/serial.h>
+
+#include "fs/device.hpp"
+#include "fs/identify.hpp"
+
+namespace km {
+    class BufferedSerialPort;
+    class Clock;
+}
+
+namespace dev {
+    class SerialDevice;
+
+    static constexpr inline OsIdentifyInfo kSerialInfo {
+        .DisplayName = "Serial port",
+        .Model = "16550 UART",
+        .DeviceVendor = "Generic",
+        .FirmwareRevision = "Generic",
+        .DriverVendor = "BezOS",
+        .DriverVersion = OS_VERSION(1, 0, 0),
+    };
+
+    /// @brief A stream over an interrupt driven serial port.
+    ///
+    /// Reads wait for the interrupt handler to receive at least one byte or
+    /// for the request timeout to pass, writes queue bytes for transmission.
+    class SerialDevice : public vfs::BasicNode, public vfs::ConstIdentifyMixin<kSerialInfo> {
+        km::BufferedSerialPort *mPort;
+        km::Clock *mClock;
+
+    public:
+        SerialDevice(km::BufferedSerialPort *port, km::Clock *clock);
+
+        OsStatus query(sm::uuid uuid, const void *data, size_t size, vfs::IHandle **handle) override;
+        OsStatus interfaces(OsIdentifyInterfaceList *list);
+
+        /// @brief Read received bytes, waiting until @a vfs::ReadRequest::timeout for any to arrive.
+        ///
+        /// @retval OsStatusSuccess At least one byte was read, or the timeout was @a OS_TIMEOUT_INSTANT.
+        /// @retval OsStatusTimeout Nothing was received before the timeout.
+        OsStatus read(vfs::ReadRequest request, vfs::ReadResult *result);
+        OsStatus write(vfs::WriteRequest request, vfs::WriteResult *result);
+    };
+}
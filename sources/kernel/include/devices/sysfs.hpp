@@ -16,6 +16,11 @@ namespace acpi {
 
 namespace km {
     struct SmBiosTables;
+    class SyscallStats;
+}
+
+namespace task {
+    class Scheduler;
 }
 
 namespace dev {
@@ -26,12 +31,20 @@ namespace dev {
         void IdentifySmbRoot(const km::SmBiosTables *header, OsIdentifyInfo *info);
 
         OsStatus ReadTableData(km::VirtualRangeEx tables, vfs::ReadRequest request, vfs::ReadResult *result);
+
+        /// @brief Write the system call counters as text, one line per system call that has been made.
+        void WriteSyscallStats(const km::SyscallStats *stats, km::IOutStream& out);
+
+        /// @brief Write the scheduler counters as text, one line per cpu.
+        void WriteSchedulerStats(task::Scheduler *scheduler, km::IOutStream& out);
     }
 
     class AcpiTable;
     class AcpiRoot;
     class SmBiosTable;
     class SmBiosRoot;
+    class SyscallStatsFile;
+    class SchedulerStatsFile;
 
     class AcpiTable final : public vfs::BasicNode {
         const acpi::RsdtHeader *mHeader;
@@ -94,4 +107,40 @@ namespace dev {
 
         static sm::RcuSharedPtr<SmBiosRoot> create(sm::RcuDomain *domain, const km::SmBiosTables *tables);
     };
+
+    /// @brief Exports the system call counters of every cpu as text.
+    ///
+    /// The counters are summed every time the file is read, the text is
+    /// never stored.
+    class SyscallStatsFile final : public vfs::BasicNode {
+        const km::SyscallStats *mStats;
+
+    public:
+        SyscallStatsFile(const km::SyscallStats *stats);
+
+        OsStatus query(sm::uuid uuid, const void *data, size_t size, vfs::IHandle **handle) override;
+        OsStatus interfaces(OsIdentifyInterfaceList *list);
+        OsStatus identify(OsIdentifyInfo *info);
+
+        OsStatus stat(OsFileInfo *stat);
+        OsStatus read(vfs::ReadRequest request, vfs::ReadResult *result);
+    };
+
+    /// @brief Exports the scheduler counters of every cpu as text.
+    ///
+    /// The counters are read every time the file is read, the text is
+    /// never stored.
+    class SchedulerStatsFile final : public vfs::BasicNode {
+        task::Scheduler *mScheduler;
+
+    public:
+        SchedulerStatsFile(task::Scheduler *scheduler);
+
+        OsStatus query(sm::uuid uuid, const void *data, size_t size, vfs::IHandle **handle) override;
+        OsStatus interfaces(OsIdentifyInterfaceList *list);
+        OsStatus identify(OsIdentifyInfo *info);
+
+        OsStatus stat(OsFileInfo *stat);
+        OsStatus read(vfs::ReadRequest request, vfs::ReadResult *result);
+    };
 }
@@ -3,7 +3,10 @@
 #include <bezos/status.h>
 #include "pci/pci.hpp"
 
+#include "common/physical_address.hpp"
+
 #include <new>
+#include <span>
 #include <utility>
 
 namespace km {
@@ -45,6 +48,19 @@ namespace km {
 
         virtual BlockDeviceCapability capability() const = 0;
 
+        /// @brief Get the memory backing this device.
+        ///
+        /// Devices that are already resident in memory can be read directly
+        /// instead of copying blocks through a buffer.
+        ///
+        /// @return The memory of the device, or an empty span if it is not memory resident.
+        virtual std::span<const std::byte> resident() const { return {}; }
+
+        /// @brief Get the physical address of the memory backing this device.
+        ///
+        /// @return The physical address of @a resident, or null if it is unknown.
+        virtual sm::PhysicalAddress residentAddress() const { return nullptr; }
+
         BlockDeviceStatus read(uint64_t block, void *buffer, size_t count);
         BlockDeviceStatus write(uint64_t block, const void *buffer, size_t count);
     };
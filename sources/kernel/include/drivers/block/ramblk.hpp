@@ -9,13 +9,17 @@ namespace km {
         std::byte *mMemory;
         size_t mSize;
         Protection mProtection;
+        sm::PhysicalAddress mPhysical;
 
         km::BlockDeviceStatus readImpl(uint64_t block, void *buffer, size_t count) override;
         km::BlockDeviceStatus writeImpl(uint64_t block, const void *buffer, size_t count) override;
 
     public:
-        MemoryBlk(std::byte *memory, size_t size, Protection protection = Protection::eReadWrite);
+        MemoryBlk(std::byte *memory, size_t size, Protection protection = Protection::eReadWrite, sm::PhysicalAddress physical = nullptr);
 
         km::BlockDeviceCapability capability() const override;
+
+        std::span<const std::byte> resident() const override { return { mMemory, mSize }; }
+        sm::PhysicalAddress residentAddress() const override { return mPhysical; }
     };
 }
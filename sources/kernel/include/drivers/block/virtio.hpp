@@ -1,11 +1,70 @@
 #pragma once
 
 #include "drivers/block/driver.hpp"
+#include "drivers/virtio/pci.hpp"
+
+#include <memory>
 
 namespace km {
-    class VirtIoBlk : public km::IBlockDriver {
+    class SystemMemory;
+
+    namespace detail {
+        struct VirtIoBlkQueue;
+    }
+
+    /// @brief A virtio block device using the modern PCI transport.
+    ///
+    /// A request queue is created for each processor when the device supports
+    /// multiqueue, requests are submitted to the queue of the calling processor.
+    /// Large transfers are split into several requests which are published to
+    /// the device with a single notification.
+    ///
+    /// @cite Virtio
+    class VirtIoBlk final : public km::IBlockDriver {
+        virtio::PciTransport mTransport;
+        AddressSpace *mAddressSpace;
+        BlockDeviceCapability mCapability;
+
+        /// @brief The maximum number of data segments in a single request.
+        uint32_t mSegmentMax;
+
+        /// @brief The maximum size of a single data segment.
+        uint32_t mSizeMax;
+
+        uint16_t mQueueCount;
+        std::unique_ptr<detail::VirtIoBlkQueue[]> mQueues;
+
+        VirtIoBlk(virtio::PciTransport transport, AddressSpace *addressSpace);
+
+        detail::VirtIoBlkQueue& currentQueue() noexcept;
+
+        km::BlockDeviceStatus submit(uint32_t type, uint64_t block, void *buffer, size_t count);
+
+        km::BlockDeviceStatus readImpl(uint64_t block, void *buffer, size_t count) override;
+        km::BlockDeviceStatus writeImpl(uint64_t block, const void *buffer, size_t count) override;
+
+    public:
+        ~VirtIoBlk() override;
+
+        static constexpr pci::DeviceId kDeviceId = pci::DeviceId(virtio::kModernDeviceIdBase + 2);
+        static constexpr pci::DeviceId kTransitionalDeviceId = pci::DeviceId(0x1001);
+
         km::BlockDeviceCapability capability() const override;
-        km::BlockDeviceStatus readImpl(uint64_t, void *, size_t) override;
-        km::BlockDeviceStatus writeImpl(uint64_t, const void *, size_t) override;
+
+        uint16_t queueCount() const { return mQueueCount; }
+
+        /// @brief Initialize a virtio block device.
+        ///
+        /// @param config The config space the device is in.
+        /// @param address The address of the device.
+        /// @param memory The system memory used to allocate the queues.
+        /// @param cpuCount The number of processors, at most this many queues are created.
+        /// @param[out] device The initialized device.
+        ///
+        /// @retval OsStatusSuccess The device was initialized.
+        /// @retval OsStatusNotSupported The device is not a modern virtio block device.
+        /// @retval OsStatusOutOfMemory Memory for the queues could not be allocated.
+        [[nodiscard]]
+        static OsStatus create(pci::IConfigSpace *config, pci::DeviceBusAddress address, SystemMemory& memory, uint32_t cpuCount, VirtIoBlk **device [[outparam]]);
     };
 }
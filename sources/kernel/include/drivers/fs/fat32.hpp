@@ -1,6 +1,11 @@
 #pragma once
 
 #include "drivers/fs/driver.hpp"
+#include "std/string.hpp"
+#include "std/string_view.hpp"
+
+#include <memory>
+#include <span>
 
 namespace km {
     struct [[gnu::packed]] FatBootSector {
@@ -53,9 +58,9 @@ namespace km {
     static_assert(sizeof(FatBootSector) == 512);
 
     struct FatInfo {
-        static constexpr std::array<uint8_t, 4> kLeadSignature = { 0x41, 0x61, 0x52, 0x52 };
-        static constexpr std::array<uint8_t, 4> kStructureSignature = { 0x61, 0x41, 0x72, 0x72 };
-        static constexpr std::array<uint8_t, 4> kTrailSignature = { 0xAA, 0x55, 0x00, 0x00 };
+        static constexpr std::array<uint8_t, 4> kLeadSignature = { 0x52, 0x52, 0x61, 0x41 };
+        static constexpr std::array<uint8_t, 4> kStructureSignature = { 0x72, 0x72, 0x41, 0x61 };
+        static constexpr std::array<uint8_t, 4> kTrailSignature = { 0x00, 0x00, 0x55, 0xAA };
 
         std::array<uint8_t, 4> leadSignature;
         std::byte reserved0[480];
@@ -68,10 +73,37 @@ namespace km {
 
     static_assert(sizeof(FatInfo) == 512);
 
+    enum class FatAttribute : uint8_t {
+        eNone = 0,
+        eReadOnly = (1 << 0),
+        eHidden = (1 << 1),
+        eSystem = (1 << 2),
+        eVolumeId = (1 << 3),
+        eDirectory = (1 << 4),
+        eArchive = (1 << 5),
+
+        /// @brief The attributes of a long name entry.
+        eLongName = eReadOnly | eHidden | eSystem | eVolumeId,
+    };
+
+    UTIL_BITFLAGS(FatAttribute);
+
+    /// @brief Case flags used by Windows NT to store lowercase 8.3 names without a long name.
+    enum class FatCaseFlags : uint8_t {
+        eNone = 0,
+        eLowerBase = (1 << 3),
+        eLowerExtension = (1 << 4),
+    };
+
+    UTIL_BITFLAGS(FatCaseFlags);
+
     struct FatFolder {
+        static constexpr uint8_t kEndOfFolder = 0x00;
+        static constexpr uint8_t kDeleted = 0xE5;
+
         char name[11];
-        uint8_t attributes;
-        std::byte reserved0[1];
+        FatAttribute attributes;
+        FatCaseFlags caseFlags;
         uint8_t creationTimeTenths;
         sm::le<uint16_t> creationTime;
         sm::le<uint16_t> creationDate;
@@ -85,7 +117,292 @@ namespace km {
 
     static_assert(sizeof(FatFolder) == 32);
 
-    class FatFsDriver : public km::IFileSystem {
+    /// @brief A long file name entry, each holds 13 UCS-2 characters of the name.
+    struct [[gnu::packed]] FatLongName {
+        static constexpr uint8_t kLastEntry = 0x40;
+        static constexpr uint8_t kOrderMask = 0x1F;
+        static constexpr size_t kNameLength = 13;
+
+        uint8_t order;
+        sm::le<uint16_t> name0[5];
+        FatAttribute attributes;
+        uint8_t type;
+        uint8_t checksum;
+        sm::le<uint16_t> name1[6];
+        sm::le<uint16_t> firstClusterLow;
+        sm::le<uint16_t> name2[2];
+    };
+
+    static_assert(sizeof(FatLongName) == 32);
+
+    using FatCluster = uint32_t;
+
+    /// @brief The mask of the bits of a FAT32 entry that address a cluster.
+    static constexpr FatCluster kFatClusterMask = 0x0FFF'FFFF;
+    static constexpr FatCluster kFatFreeCluster = 0;
+    static constexpr FatCluster kFatBadCluster = 0x0FFF'FFF7;
+    static constexpr FatCluster kFatEndOfChain = 0x0FFF'FFFF;
+
+    /// @brief The first cluster number that refers to the data region.
+    static constexpr FatCluster kFatFirstCluster = 2;
+
+    constexpr bool IsFatEndOfChain(FatCluster cluster) noexcept {
+        return (cluster & kFatClusterMask) >= 0x0FFF'FFF8;
+    }
+
+    /// @brief Compute the checksum of an 8.3 name stored in each of its long name entries.
+    constexpr uint8_t FatNameChecksum(const char (&name)[11]) noexcept {
+        uint8_t sum = 0;
+        for (char c : name) {
+            sum = uint8_t(((sum & 1) << 7) + (sum >> 1) + uint8_t(c));
+        }
+        return sum;
+    }
+
+    /// @brief A run of physically contiguous clusters in a cluster chain.
+    struct FatExtent {
+        /// @brief The index in the chain of the first cluster in the run.
+        uint32_t index;
+
+        /// @brief The first cluster of the run.
+        FatCluster cluster;
+
+        /// @brief The number of clusters in the run.
+        uint32_t count;
+
+        uint32_t end() const { return index + count; }
+    };
+
+    /// @brief The cluster chain of a file or folder as a list of extents.
+    ///
+    /// The chain is mapped lazily, each entry in the FAT is only read the
+    /// first time an offset that depends on it is accessed. Later lookups
+    /// are a binary search over the extents, which for unfragmented files
+    /// is a single extent.
+    class FatClusterMap {
+        friend class FatFsDriver;
+
+        FatCluster mFirst = kFatFreeCluster;
+
+        /// @brief If the end of the chain has been reached.
+        bool mComplete = true;
+
+        stdx::Vector2<FatExtent> mExtents;
+
+    public:
+        FatClusterMap() = default;
+
+        FatClusterMap(FatCluster first)
+            : mFirst(first)
+            , mComplete(first == kFatFreeCluster)
+        { }
+
+        FatCluster first() const { return mFirst; }
+        bool isComplete() const { return mComplete; }
+        std::span<const FatExtent> extents() const { return std::span(mExtents.data(), mExtents.count()); }
+
+        /// @brief The number of clusters that have been mapped.
+        uint32_t mappedCount() const {
+            return mExtents.isEmpty() ? 0 : mExtents.back().end();
+        }
+    };
+
+    /// @brief The location of a short name entry on disk.
+    struct FatEntryLocation {
+        uint64_t sector;
+        uint16_t offset;
+
+        bool isPresent() const { return sector != 0; }
+    };
+
+    /// @brief The in memory state of an open file or folder.
+    struct FatNode {
+        FatClusterMap clusters;
+        uint32_t size;
+        bool folder;
+        FatEntryLocation location;
+    };
+
+    /// @brief An entry read from a folder.
+    struct FatFolderEntry {
+        stdx::String name;
+        FatFolder entry;
+        FatEntryLocation location;
+
+        bool isFolder() const { return bool(entry.attributes & FatAttribute::eDirectory); }
+        FatCluster cluster() const { return (FatCluster(entry.firstClusterHigh) << 16) | entry.firstClusterLow; }
+    };
+
+    struct FatStats {
+        /// @brief The number of FAT entries read while mapping cluster chains.
+        uint64_t chainReads;
+
+        uint64_t cacheHits;
+        uint64_t cacheMisses;
+        uint64_t cacheWriteBacks;
+    };
+
+    namespace detail {
+        /// @brief Convert a name to an 8.3 name if it can be stored without a long name.
+        ///
+        /// @param name The name to convert.
+        /// @param[out] shortName The 8.3 name, padded with spaces.
+        /// @param[out] flags The case flags for the entry.
+        ///
+        /// @return If the name can be stored as an 8.3 name.
+        bool FatShortName(stdx::StringView name, char shortName[11], FatCaseFlags *flags);
+
+        /// @brief Check if a name can be stored in a long name entry.
+        bool IsValidFatName(stdx::StringView name);
+    }
+
+    /// @brief A FAT32 volume.
+    ///
+    /// FAT sectors are held in a direct mapped write-back cache, and the free
+    /// clusters of the volume are tracked in a bitmap built at mount so that
+    /// allocation never searches the FAT on disk. Modified FAT sectors are
+    /// written to every FAT copy when they are evicted or the volume is synced.
+    ///
+    /// @note This class is not internally synchronized.
+    ///
+    /// @cite FAT32
+    class FatFsDriver final : public km::IFileSystem {
+    public:
+        /// @brief The number of FAT sectors kept in the cache.
+        static constexpr size_t kFatCacheSlots = 64;
+
+    private:
+        struct FatCacheSlot {
+            uint32_t sector = UINT32_MAX;
+            bool dirty = false;
+        };
+
+        IBlockDriver *mDevice = nullptr;
+
+        uint32_t mBytesPerSector = 0;
+        uint32_t mSectorsPerCluster = 0;
+        uint32_t mClusterSize = 0;
+
+        uint64_t mFatStart = 0;
+        uint32_t mFatSectors = 0;
+        uint8_t mFatCount = 0;
+
+        /// @brief The only FAT that is written when mirroring is disabled.
+        uint8_t mActiveFat = 0;
+        bool mMirrorFat = true;
+
+        uint64_t mDataStart = 0;
+        uint32_t mClusterCount = 0;
+        FatCluster mRootCluster = 0;
+        uint16_t mInfoSector = 0;
+
+        std::unique_ptr<std::byte[]> mFatCache;
+        FatCacheSlot mFatSlots[kFatCacheSlots];
+
+        /// @brief A set bit marks a cluster in use, bits past the end of the volume are always set.
+        std::unique_ptr<uint64_t[]> mUsedMap;
+        uint32_t mFreeCount = 0;
+        FatCluster mNextFree = kFatFirstCluster;
+        bool mInfoDirty = false;
+
+        /// @brief Scratch space for partial cluster transfers.
+        std::unique_ptr<std::byte[]> mBuffer;
+
+        FatStats mStats{};
+
+        uint64_t clusterSector(FatCluster cluster) const {
+            return mDataStart + uint64_t(cluster - kFatFirstCluster) * mSectorsPerCluster;
+        }
+
+        bool isValidCluster(FatCluster cluster) const {
+            return cluster >= kFatFirstCluster && cluster < mClusterCount + kFatFirstCluster;
+        }
+
+        OsStatus readSectors(uint64_t sector, void *buffer, size_t count);
+        OsStatus writeSectors(uint64_t sector, const void *buffer, size_t count);
+
+        OsStatus loadFatSector(uint32_t sector, std::byte **data);
+        OsStatus writeBackSlot(size_t index);
+        OsStatus readFat(FatCluster cluster, FatCluster *next);
+        OsStatus writeFat(FatCluster cluster, FatCluster next);
+
+        OsStatus buildUsedMap();
+        void markUsed(FatCluster cluster, bool used);
+        bool isUsed(FatCluster cluster) const;
+        FatCluster findFreeCluster(FatCluster hint) const;
+
+        /// @brief Append a cluster to the end of a chain.
+        OsStatus appendCluster(FatClusterMap& map, bool zero);
+
+        /// @brief Read the rest of a chain into its cluster map.
+        OsStatus mapComplete(FatClusterMap& map);
+
+        OsStatus transfer(FatNode& node, uint64_t offset, std::byte *buffer, size_t size, bool write);
+
+        OsStatus writeEntry(FatEntryLocation location, const void *entry);
+        OsStatus updateEntry(const FatNode& node);
+        OsStatus entryLocation(FatNode& folder, uint32_t slot, FatEntryLocation *location);
+        OsStatus findFreeSlots(FatNode& folder, uint32_t count, uint32_t *slot);
+
+    public:
+        FatFsDriver() = default;
+
+        /// @brief Mount a FAT32 volume.
+        ///
+        /// @param device The block device containing the volume.
+        /// @param[out] driver The mounted volume.
+        ///
+        /// @retval OsStatusSuccess The volume was mounted.
+        /// @retval OsStatusInvalidData The device does not contain a FAT32 volume.
+        /// @retval OsStatusDeviceFault The device could not be read.
+        /// @retval OsStatusOutOfMemory The caches could not be allocated.
+        [[nodiscard]]
+        static OsStatus create(IBlockDriver *device, FatFsDriver *driver [[outparam]]);
+
+        uint32_t clusterSize() const { return mClusterSize; }
+        uint32_t clusterCount() const { return mClusterCount; }
+        uint32_t freeClusterCount() const { return mFreeCount; }
+        FatStats stats() const { return mStats; }
+
+        FatNode rootNode() const;
+        FatNode openNode(const FatFolderEntry& entry) const;
+
+        /// @brief Find the extent containing a cluster of a chain.
+        ///
+        /// @param map The chain to search.
+        /// @param index The index of the cluster in the chain.
+        /// @param[out] extent The extent containing the cluster.
+        ///
+        /// @retval OsStatusSuccess The cluster was found.
+        /// @retval OsStatusEndOfFile The chain ends before the cluster.
+        /// @retval OsStatusInvalidData The chain is corrupt.
+        [[nodiscard]]
+        OsStatus mapCluster(FatClusterMap& map, uint32_t index, FatExtent *extent [[outparam]]);
+
+        [[nodiscard]]
+        OsStatus read(FatNode& node, uint64_t offset, void *buffer, size_t size, size_t *read [[outparam]]);
+
+        /// @brief Write to a file, allocating clusters as needed.
+        ///
+        /// Writing past the end of a file extends it, the gap reads as zeros.
+        [[nodiscard]]
+        OsStatus write(FatNode& node, uint64_t offset, const void *buffer, size_t size, size_t *written [[outparam]]);
+
+        /// @brief Read every entry of a folder, excluding the dot entries.
+        [[nodiscard]]
+        OsStatus readFolder(FatNode& folder, stdx::Vector2<FatFolderEntry> *entries [[outparam]]);
+
+        /// @brief Create a file or folder.
+        ///
+        /// @retval OsStatusSuccess The node was created.
+        /// @retval OsStatusAlreadyExists An entry with the name already exists.
+        /// @retval OsStatusInvalidPath The name cannot be stored on a FAT volume.
+        /// @retval OsStatusOutOfMemory The volume is full.
+        [[nodiscard]]
+        OsStatus create(FatNode& folder, stdx::StringView name, bool isFolder, FatFolderEntry *entry [[outparam]]);
 
+        /// @brief Write all modified FAT sectors and the free cluster count to disk.
+        [[nodiscard]]
+        OsStatus sync();
     };
 }
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "pci/pci.hpp"
+
+#include <bezos/status.h>
+
+#include "common/util/util.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace km {
+    class AddressSpace;
+}
+
+namespace km::virtio {
+    class VirtQueue;
+
+    enum class DeviceStatus : uint8_t {
+        eReset = 0,
+        eAcknowledge = (1 << 0),
+        eDriver = (1 << 1),
+        eDriverOk = (1 << 2),
+        eFeaturesOk = (1 << 3),
+        eNeedsReset = (1 << 6),
+        eFailed = (1 << 7),
+    };
+
+    UTIL_BITFLAGS(DeviceStatus);
+
+    static constexpr uint64_t kFeatureIndirectDescriptors = (1ull << 28);
+    static constexpr uint64_t kFeatureEventIndex = (1ull << 29);
+    static constexpr uint64_t kFeatureVersion1 = (1ull << 32);
+
+    /// @brief The vendor id of all virtio devices.
+    static constexpr pci::VendorId kVendorId = pci::VendorId::eQemuVirtio;
+
+    /// @brief The first device id used by modern virtio devices, offset by the device type.
+    static constexpr uint16_t kModernDeviceIdBase = 0x1040;
+
+    enum class ConfigType : uint8_t {
+        eCommon = 1,
+        eNotify = 2,
+        eIsr = 3,
+        eDevice = 4,
+        ePci = 5,
+    };
+
+    /// @brief The common configuration structure of the modern PCI transport.
+    struct CommonConfig {
+        uint32_t deviceFeatureSelect;
+        uint32_t deviceFeature;
+        uint32_t driverFeatureSelect;
+        uint32_t driverFeature;
+        uint16_t msixConfig;
+        uint16_t numQueues;
+        uint8_t deviceStatus;
+        uint8_t configGeneration;
+
+        uint16_t queueSelect;
+        uint16_t queueSize;
+        uint16_t queueMsixVector;
+        uint16_t queueEnable;
+        uint16_t queueNotifyOff;
+        uint32_t queueDescLow;
+        uint32_t queueDescHigh;
+        uint32_t queueDriverLow;
+        uint32_t queueDriverHigh;
+        uint32_t queueDeviceLow;
+        uint32_t queueDeviceHigh;
+    };
+
+    static_assert(offsetof(CommonConfig, numQueues) == 0x12);
+    static_assert(offsetof(CommonConfig, queueSelect) == 0x16);
+    static_assert(offsetof(CommonConfig, queueDescLow) == 0x20);
+    static_assert(offsetof(CommonConfig, queueDeviceHigh) == 0x34);
+
+    /// @brief The virtio 1.x PCI transport.
+    ///
+    /// Locates the configuration structures through the vendor specific capabilities
+    /// of a function and maps them uncached.
+    ///
+    /// @cite Virtio
+    class PciTransport {
+        volatile CommonConfig *mCommon = nullptr;
+        volatile uint8_t *mIsr = nullptr;
+        volatile uint8_t *mDevice = nullptr;
+        volatile uint8_t *mNotify = nullptr;
+        uint32_t mNotifyMultiplier = 0;
+        uint32_t mDeviceLength = 0;
+
+        void select(uint16_t queue) noexcept;
+
+    public:
+        constexpr PciTransport() noexcept = default;
+
+        /// @brief Map the configuration structures of a function.
+        ///
+        /// Memory decoding and bus mastering are enabled on the function.
+        ///
+        /// @retval OsStatusSuccess The transport was created.
+        /// @retval OsStatusNotSupported The function is not a modern virtio device.
+        /// @retval OsStatusOutOfMemory The configuration structures could not be mapped.
+        [[nodiscard]]
+        static OsStatus create(pci::IConfigSpace *config, pci::DeviceBusAddress address, AddressSpace& memory, PciTransport *transport [[outparam]]);
+
+        void reset() noexcept;
+        DeviceStatus status() const noexcept;
+        void addStatus(DeviceStatus status) noexcept;
+
+        /// @brief Negotiate the feature set with the device.
+        ///
+        /// @param supported The features supported by the driver, @a kFeatureVersion1 is always requested.
+        /// @param[out] features The negotiated features.
+        ///
+        /// @retval OsStatusSuccess The device accepted the features.
+        /// @retval OsStatusNotSupported The device is a legacy device or rejected the features.
+        [[nodiscard]]
+        OsStatus negotiate(uint64_t supported, uint64_t *features [[outparam]]) noexcept;
+
+        uint16_t queueCount() const noexcept;
+
+        /// @brief Get the maximum size of a queue, 0 if the queue does not exist.
+        uint16_t maxQueueSize(uint16_t queue) noexcept;
+
+        /// @brief Give a queue to the device and enable it.
+        void enableQueue(uint16_t queue, const VirtQueue& ring) noexcept;
+
+        /// @brief Get the register used to notify the device of new buffers in a queue.
+        volatile uint16_t *notifyRegister(uint16_t queue) noexcept;
+
+        /// @brief Notify the device of new buffers in a queue.
+        static void notify(volatile uint16_t *reg, uint16_t queue) noexcept {
+            *reg = queue;
+        }
+
+        /// @brief Get the size of the device specific configuration structure.
+        uint32_t deviceConfigSize() const noexcept { return mDeviceLength; }
+
+        uint8_t configGeneration() const noexcept;
+
+        /// @brief Read fields of the device specific configuration.
+        ///
+        /// Fields must be read with their natural width, 64-bit fields are read
+        /// as two halves and retried if the configuration changes between them.
+        uint8_t readDevice8(uint32_t offset) const noexcept;
+        uint16_t readDevice16(uint32_t offset) const noexcept;
+        uint32_t readDevice32(uint32_t offset) const noexcept;
+        uint64_t readDevice64(uint32_t offset) const noexcept;
+    };
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <bezos/status.h>
+
+#include "common/physical_address.hpp"
+#include "common/util/util.hpp"
+
+#include <span>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace km::virtio {
+    enum class DescriptorFlags : uint16_t {
+        eNone = 0,
+
+        /// @brief The descriptor continues via the next field.
+        eNext = (1 << 0),
+
+        /// @brief The buffer is written by the device.
+        eWrite = (1 << 1),
+
+        /// @brief The buffer contains a table of descriptors.
+        eIndirect = (1 << 2),
+    };
+
+    UTIL_BITFLAGS(DescriptorFlags);
+
+    struct Descriptor {
+        uint64_t address;
+        uint32_t length;
+        DescriptorFlags flags;
+        uint16_t next;
+    };
+
+    static_assert(sizeof(Descriptor) == 16);
+
+    struct UsedElement {
+        uint32_t id;
+        uint32_t length;
+    };
+
+    static_assert(sizeof(UsedElement) == 8);
+
+    /// @brief The device does not need to be notified of new buffers.
+    static constexpr uint16_t kUsedNoNotify = (1 << 0);
+
+    /// @brief The driver does not need an interrupt when buffers are used.
+    static constexpr uint16_t kAvailNoInterrupt = (1 << 0);
+
+    /// @brief Check if an event index has been crossed.
+    ///
+    /// When event index suppression is negotiated each side publishes the ring
+    /// index it wants to be notified at, a notification is only needed if that
+    /// index lies in the range of entries added since the last notification.
+    ///
+    /// @param event The index the other side asked to be notified at.
+    /// @param next The new ring index.
+    /// @param previous The ring index at the last notification.
+    ///
+    /// @return If a notification should be sent.
+    constexpr bool NeedEvent(uint16_t event, uint16_t next, uint16_t previous) noexcept [[clang::nonblocking]] {
+        return uint16_t(next - event - 1) < uint16_t(next - previous);
+    }
+
+    /// @brief The layout of a split virtqueue in memory.
+    ///
+    /// The descriptor table, available ring, and used ring are shared with the device.
+    /// The indirect tables are referenced by descriptors and also read by the device.
+    /// The tokens are private to the driver.
+    struct QueueLayout {
+        size_t descriptors;
+        size_t avail;
+        size_t used;
+        size_t indirect;
+        size_t tokens;
+        size_t size;
+
+        /// @brief Calculate the layout of a queue.
+        ///
+        /// @param size The number of descriptors in the queue.
+        /// @param indirect The number of descriptors in each indirect table, 0 to disable indirect descriptors.
+        static constexpr QueueLayout of(uint16_t size, uint16_t indirect) noexcept [[clang::nonblocking]] {
+            auto alignUp = [](size_t value, size_t align) { return (value + align - 1) & ~(align - 1); };
+
+            QueueLayout layout{};
+            layout.descriptors = 0;
+            layout.avail = layout.descriptors + (sizeof(Descriptor) * size);
+
+            // flags, idx, ring[size], used_event
+            layout.used = alignUp(layout.avail + (sizeof(uint16_t) * (3 + size)), 4);
+
+            // flags, idx, ring[size], avail_event
+            layout.indirect = alignUp(layout.used + (sizeof(uint16_t) * 3) + (sizeof(UsedElement) * size), 16);
+            layout.tokens = alignUp(layout.indirect + (sizeof(Descriptor) * indirect * size), alignof(void*));
+            layout.size = layout.tokens + (sizeof(void*) * size);
+            return layout;
+        }
+    };
+
+    /// @brief A buffer that forms part of a request.
+    struct QueueBuffer {
+        sm::PhysicalAddress address;
+        uint32_t length;
+
+        /// @brief If the device writes to this buffer.
+        bool writable;
+    };
+
+    /// @brief A split virtqueue.
+    ///
+    /// The queue does not own its memory and does not synchronize access, the
+    /// owner must serialize calls. Requests with more than one buffer are placed
+    /// in an indirect table when the queue has indirect tables so that every
+    /// request consumes one ring descriptor.
+    ///
+    /// @cite Virtio
+    class VirtQueue {
+        uint16_t mSize = 0;
+        uint16_t mIndirectLength = 0;
+        bool mEventIndex = false;
+
+        Descriptor *mDescriptors = nullptr;
+        uint16_t *mAvail = nullptr;
+        uint16_t *mUsed = nullptr;
+        Descriptor *mIndirect = nullptr;
+        void **mTokens = nullptr;
+        sm::PhysicalAddress mAddress;
+        QueueLayout mLayout{};
+
+        /// @brief Head of the list of free descriptors, linked by their next field.
+        uint16_t mFreeHead = 0;
+        uint16_t mFreeCount = 0;
+
+        /// @brief The driver side copy of the available ring index.
+        uint16_t mAvailIndex = 0;
+
+        /// @brief The available ring index at the last call to @a publish.
+        uint16_t mPublishedIndex = 0;
+
+        /// @brief The next used ring entry to consume.
+        uint16_t mLastUsed = 0;
+
+        uint16_t& availFlags() noexcept [[clang::nonblocking]] { return mAvail[0]; }
+        uint16_t& availIndex() noexcept [[clang::nonblocking]] { return mAvail[1]; }
+        uint16_t& availRing(uint16_t index) noexcept [[clang::nonblocking]] { return mAvail[2 + (index & (mSize - 1))]; }
+        uint16_t& usedEvent() noexcept [[clang::nonblocking]] { return mAvail[2 + mSize]; }
+
+        uint16_t& usedFlags() noexcept [[clang::nonblocking]] { return mUsed[0]; }
+        uint16_t& usedIndex() noexcept [[clang::nonblocking]] { return mUsed[1]; }
+        UsedElement& usedRing(uint16_t index) noexcept [[clang::nonblocking]];
+        uint16_t& availEvent() noexcept [[clang::nonblocking]];
+
+        Descriptor *indirectTable(uint16_t head) noexcept [[clang::nonblocking]] {
+            return mIndirect + (size_t(head) * mIndirectLength);
+        }
+
+        sm::PhysicalAddress physicalAddress(const void *ptr) const noexcept [[clang::nonblocking]];
+
+        uint16_t takeDescriptor() noexcept [[clang::nonblocking]];
+        void releaseChain(uint16_t head) noexcept [[clang::nonblocking]];
+
+    public:
+        constexpr VirtQueue() noexcept = default;
+
+        /// @brief Initialize a queue over zeroed memory.
+        ///
+        /// @param size The number of descriptors, must be a power of 2.
+        /// @param indirect The number of descriptors in each indirect table, 0 to disable indirect descriptors.
+        /// @param eventIndex If event index suppression was negotiated.
+        /// @param memory The memory for the queue, must be at least @a QueueLayout::of(size, indirect).size bytes.
+        /// @param address The physical address of @p memory, which must be physically contiguous.
+        /// @param[out] queue The initialized queue.
+        ///
+        /// @retval OsStatusSuccess The queue was initialized.
+        /// @retval OsStatusInvalidInput The queue size is not a power of 2.
+        [[nodiscard]]
+        static OsStatus create(uint16_t size, uint16_t indirect, bool eventIndex, void *memory, sm::PhysicalAddress address, VirtQueue *queue [[outparam]]);
+
+        uint16_t size() const noexcept [[clang::nonblocking]] { return mSize; }
+        uint16_t freeCount() const noexcept [[clang::nonblocking]] { return mFreeCount; }
+        uint16_t indirectLength() const noexcept [[clang::nonblocking]] { return mIndirectLength; }
+
+        sm::PhysicalAddress descriptorAddress() const noexcept [[clang::nonblocking]] { return mAddress + mLayout.descriptors; }
+        sm::PhysicalAddress availAddress() const noexcept [[clang::nonblocking]] { return mAddress + mLayout.avail; }
+        sm::PhysicalAddress usedAddress() const noexcept [[clang::nonblocking]] { return mAddress + mLayout.used; }
+
+        /// @brief Check if a request with @p count buffers can be added.
+        bool canAdd(size_t count) const noexcept [[clang::nonblocking]];
+
+        /// @brief Add a request to the available ring.
+        ///
+        /// The request is not visible to the device until @a publish is called.
+        ///
+        /// @param buffers The buffers of the request, device readable buffers must come first.
+        /// @param token A value returned by @a popUsed when the request completes, must not be null.
+        ///
+        /// @retval OsStatusSuccess The request was added.
+        /// @retval OsStatusOutOfMemory There are not enough free descriptors.
+        /// @retval OsStatusInvalidInput There are no buffers.
+        [[nodiscard]]
+        OsStatus add(std::span<const QueueBuffer> buffers, void *token) noexcept [[clang::nonblocking]];
+
+        /// @brief Make all added requests visible to the device.
+        ///
+        /// @return If the device must be notified.
+        bool publish() noexcept [[clang::nonblocking]];
+
+        /// @brief Take a completed request from the used ring.
+        ///
+        /// @param[out] length The number of bytes the device wrote.
+        ///
+        /// @return The token of the request, or null if no requests have completed.
+        void *popUsed(uint32_t *length [[outparam]]) noexcept [[clang::nonblocking]];
+
+        /// @brief Ask the device not to interrupt when buffers are used.
+        void disableInterrupts() noexcept [[clang::nonblocking]];
+
+        /// @brief Ask the device to interrupt when buffers are used.
+        ///
+        /// @return If requests completed before interrupts were enabled, the caller must poll again.
+        bool enableInterrupts() noexcept [[clang::nonblocking]];
+    };
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "drivers/fs/fat32.hpp"
+
+#include "fs/device.hpp"
+#include "fs/folder.hpp"
+#include "fs/identify.hpp"
+#include "fs/node.hpp"
+#include "std/shared.hpp"
+#include "std/spinlock.hpp"
+
+namespace vfs {
+    class FatFsNode;
+    class FatFsFile;
+    class FatFsFolder;
+    class FatFsMount;
+    class FatFs;
+
+    static constexpr inline OsIdentifyInfo kFatFsInfo {
+        .DisplayName = "FAT32 File System",
+        .Model = "Microsoft FAT32 Volume",
+        .DeviceVendor = "BezOS",
+        .FirmwareRevision = "1.0.0",
+        .DriverVendor = "BezOS",
+        .DriverVersion = OS_VERSION(1, 0, 0),
+    };
+
+    class FatFsNode : public BasicNode, public ConstIdentifyMixin<kFatFsInfo> {
+    protected:
+        FatFsMount *mVolume;
+
+        /// @brief The cluster chain and size of the node, guarded by the lock of the mount.
+        km::FatNode mState;
+
+    public:
+        FatFsNode(sm::RcuWeakPtr<INode> parent, FatFsMount *mount, VfsString name, km::FatNode state);
+    };
+
+    class FatFsFile : public FatFsNode {
+    public:
+        FatFsFile(sm::RcuWeakPtr<INode> parent, FatFsMount *mount, VfsString name, km::FatNode state)
+            : FatFsNode(parent, mount, std::move(name), std::move(state))
+        { }
+
+        OsStatus query(sm::uuid uuid, const void *data, size_t size, IHandle **handle) override;
+        OsStatus interfaces(OsIdentifyInterfaceList *list);
+
+        OsStatus read(ReadRequest request, ReadResult *result);
+        OsStatus write(WriteRequest request, WriteResult *result);
+        OsStatus stat(OsFileInfo *stat);
+    };
+
+    /// @brief A folder on a FAT volume.
+    ///
+    /// The entries of a folder are read from disk the first time the folder
+    /// is searched or iterated, folders that are never opened cost nothing.
+    class FatFsFolder : public FatFsNode, public FolderMixin {
+        stdx::SpinLock mLoadLock;
+        std::atomic<bool> mLoaded { false };
+
+        OsStatus load();
+
+    public:
+        FatFsFolder(sm::RcuWeakPtr<INode> parent, FatFsMount *mount, VfsString name, km::FatNode state)
+            : FatFsNode(parent, mount, std::move(name), std::move(state))
+        { }
+
+        OsStatus query(sm::uuid uuid, const void *data, size_t size, IHandle **handle) override;
+        OsStatus interfaces(OsIdentifyInterfaceList *list);
+
+        OsStatus lookup(VfsStringView name, sm::RcuSharedPtr<INode> *child);
+        OsStatus mknode(sm::RcuWeakPtr<INode> parent, VfsStringView name, sm::RcuSharedPtr<INode> child);
+        OsStatus rmnode(sm::RcuSharedPtr<INode> child);
+        OsStatus next(Iterator *iterator, sm::RcuSharedPtr<INode> *node);
+
+        /// @brief Create a file or folder on disk and add it to this folder.
+        OsStatus create(VfsStringView name, bool isFolder, sm::RcuSharedPtr<INode> *node);
+    };
+
+    class FatFsMount final : public IVfsMount {
+        sm::SharedPtr<km::IBlockDriver> mBlock;
+        stdx::SpinLock mLock;
+        km::FatFsDriver mVolume GUARDED_BY(mLock);
+        sm::RcuSharedPtr<FatFsFolder> mRootNode;
+
+        OsStatus createChild(sm::RcuSharedPtr<INode> parent, VfsStringView name, bool isFolder, sm::RcuSharedPtr<INode> *node);
+
+    public:
+        FatFsMount(FatFs *fatfs, sm::RcuDomain *domain, sm::SharedPtr<km::IBlockDriver> block, km::FatFsDriver volume);
+        ~FatFsMount();
+
+        OsStatus read(km::FatNode& node, ReadRequest request, ReadResult *result);
+        OsStatus write(km::FatNode& node, WriteRequest request, WriteResult *result);
+        OsStatus stat(km::FatNode& node, OsFileInfo *stat);
+        OsStatus readFolder(km::FatNode& folder, stdx::Vector2<km::FatFolderEntry> *entries);
+        OsStatus createEntry(km::FatNode& folder, VfsStringView name, bool isFolder, km::FatFolderEntry *entry);
+
+        /// @brief Create the node for an entry read from a folder.
+        sm::RcuSharedPtr<INode> makeNode(sm::RcuWeakPtr<INode> parent, const km::FatFolderEntry& entry);
+
+        /// @brief Write all modified FAT sectors to disk.
+        OsStatus sync();
+
+        km::FatStats stats();
+
+        OsStatus mkdir(sm::RcuSharedPtr<INode> parent, VfsStringView name, const void *data, size_t size, sm::RcuSharedPtr<INode> *node) override;
+        OsStatus create(sm::RcuSharedPtr<INode> parent, VfsStringView name, const void *data, size_t size, sm::RcuSharedPtr<INode> *node) override;
+
+        OsStatus root(sm::RcuSharedPtr<INode> *node) override;
+    };
+
+    class FatFs final : public IVfsDriver {
+    public:
+        constexpr FatFs()
+            : IVfsDriver("fatfs")
+        { }
+
+        OsStatus mount(sm::RcuDomain *domain, IVfsMount **mount) override;
+        OsStatus unmount(IVfsMount *mount) override;
+
+        /// @brief Mount a FAT32 volume.
+        ///
+        /// @param[out] mount The new mount.
+        /// @param domain The domain to allocate nodes in.
+        /// @param block The block device containing the volume.
+        ///
+        /// @retval OsStatusSuccess The volume was mounted.
+        /// @retval OsStatusInvalidData The device does not contain a FAT32 volume.
+        OsStatus createMount(IVfsMount **mount, sm::RcuDomain *domain, sm::SharedPtr<km::IBlockDriver> block);
+
+        static FatFs& instance();
+    };
+}
@@ -20,6 +20,11 @@ namespace vfs {
         { it.write(std::declval<WriteRequest>(), std::declval<WriteResult*>()) } -> std::same_as<OsStatus>;
     };
 
+    template<typename T>
+    concept FileNodePhysical = requires (T it) {
+        { it.physical(uint64_t(), size_t(), std::declval<sm::PhysicalAddress*>()) } -> std::same_as<OsStatus>;
+    };
+
     template<typename T>
     concept FileNode = FileNodeStat<T> && std::derived_from<T, INode>;
 
@@ -72,5 +77,13 @@ namespace vfs {
                 return OsStatusNotSupported;
             }
         }
+
+        virtual OsStatus physical(uint64_t offset, size_t size, sm::PhysicalAddress *address) override {
+            if constexpr (FileNodePhysical<T>) {
+                return mNode->physical(offset, size, address);
+            } else {
+                return OsStatusNotSupported;
+            }
+        }
     };
 }
@@ -33,17 +33,40 @@ namespace vfs {
         uint32_t mGeneration GUARDED_BY(mLock) = 0;
 
     public:
+        /// @brief A position in a folder.
+        ///
+        /// The name of the last entry is the real cursor, @a current is only
+        /// a shortcut that is used while the folder has not changed.
         struct Iterator {
             VfsString name;
             MapIterator current;
             uint32_t generation;
         };
 
+    private:
+        /// @brief Find the entry after the last one returned to @p iterator.
+        MapIterator resume(const Iterator *iterator) REQUIRES_SHARED(mLock);
+
+    public:
         OsStatus lookup(VfsStringView name, sm::RcuSharedPtr<INode> *child);
         OsStatus mknode(sm::RcuWeakPtr<INode> parent, VfsStringView name, sm::RcuSharedPtr<INode> child);
         OsStatus rmnode(sm::RcuSharedPtr<INode> child);
 
         OsStatus next(Iterator *iterator, sm::RcuSharedPtr<INode> *node);
+
+        /// @brief Write as many entries as fit into a buffer.
+        ///
+        /// The folder lock is only taken once for the whole batch.
+        ///
+        /// @param iterator The position to resume from, updated to the last entry written.
+        /// @param buffer The buffer to write packed @a OsIteratorEntry records into.
+        /// @param[out] count The number of entries written.
+        /// @param[out] used The number of bytes written.
+        ///
+        /// @return The status of the operation.
+        /// @retval OsStatusCompleted There are no more entries.
+        /// @retval OsStatusMoreData The next entry does not fit in the buffer.
+        OsStatus next(Iterator *iterator, std::span<std::byte> buffer, size_t *count [[outparam]], size_t *used [[outparam]]);
     };
 
     template<FolderNodeType T>
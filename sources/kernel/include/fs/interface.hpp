@@ -2,6 +2,10 @@
 
 #include "fs/node.hpp"
 
+#include "common/physical_address.hpp"
+
+#include <span>
+
 namespace vfs {
     /// @note All interfaces of @a kOsFileGuid must implement this interface.
     class IFileHandle : public IHandle {
@@ -9,6 +13,22 @@ namespace vfs {
         virtual ~IFileHandle() = default;
 
         virtual OsStatus stat(OsFileInfo *info) = 0;
+
+        /// @brief Find the physical memory holding part of the file.
+        ///
+        /// Files stored in memory resident media can be mapped directly rather
+        /// than read into new memory. The memory is owned by the media and must
+        /// never be written to or released.
+        ///
+        /// The parameters are the offset in the file, the number of bytes needed,
+        /// and the physical address of the byte at the offset, the rest of the
+        /// range follows it contiguously.
+        ///
+        /// @return The status of the operation.
+        /// @retval OsStatusNotSupported The file is not stored contiguously in memory.
+        virtual OsStatus physical(uint64_t, size_t, sm::PhysicalAddress *) {
+            return OsStatusNotSupported;
+        }
     };
 
     /// @note All interfaces of @a kOsFolderGuid must implement this interface.
@@ -39,7 +59,20 @@ namespace vfs {
 
         virtual OsStatus next(sm::RcuSharedPtr<INode> *node) = 0;
 
+        /// @brief Write as many packed @a OsIteratorEntry records as fit into a buffer.
+        ///
+        /// The parameters are the buffer to fill, the number of entries written,
+        /// and the number of bytes written.
+        ///
+        /// @return The status of the operation.
+        /// @retval OsStatusCompleted There are no more entries.
+        /// @retval OsStatusMoreData The next entry does not fit in the buffer.
+        virtual OsStatus next(std::span<std::byte>, size_t *, size_t *) {
+            return OsStatusFunctionNotSupported;
+        }
+
         OsStatus next(IInvokeContext *context, void *data, size_t size);
+        OsStatus nextBatch(void *data, size_t size);
 
         OsStatus invoke(IInvokeContext *context, uint64_t function, void *data, size_t size) override;
     };
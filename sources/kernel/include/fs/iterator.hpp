@@ -27,6 +27,10 @@ namespace vfs {
             return OsStatusSuccess;
         }
 
+        OsStatus next(std::span<std::byte> buffer, size_t *count, size_t *used) override {
+            return mNode->next(&mCurrent, buffer, count, used);
+        }
+
         HandleInfo info() override {
             return HandleInfo { mNode, kOsIteratorGuid };
         }
@@ -5,8 +5,7 @@
 #include "fs/identify.hpp"
 #include "fs/node.hpp"
 #include "fs/query.hpp"
-#include "std/shared_spinlock.hpp"
-#include "std/vector.hpp"
+#include "fs/ramfs_storage.hpp"
 
 namespace vfs {
     class RamFsNode;
@@ -32,8 +31,7 @@ namespace vfs {
     };
 
     class RamFsFile : public RamFsNode {
-        stdx::Vector2<std::byte> mData;
-        stdx::SharedSpinLock mLock;
+        RamFsStorage mData;
 
     public:
         RamFsFile(sm::RcuWeakPtr<INode> parent, IVfsMount *mount, VfsString name)
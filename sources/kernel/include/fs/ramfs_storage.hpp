@@ -0,0 +1,115 @@
+#pragma once
+
+#include <bezos/status.h>
+
+#include "std/shared_spinlock.hpp"
+#include "std/spinlock.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace vfs {
+    /// @brief The contents of a ramfs file, stored as page sized extents in a radix tree.
+    ///
+    /// Pages are only allocated when they are first written, reading a page that
+    /// was never written returns zeros. Growing the file never moves existing
+    /// pages so appends cost the same no matter how large the file is.
+    ///
+    /// Lookups are lock free, the tree only ever grows while the file exists.
+    /// Each page has its own lock so reads only wait for writes to the same page,
+    /// the tree lock is only taken when pages or nodes need to be allocated.
+    class RamFsStorage {
+    public:
+        static constexpr size_t kPageSize = 0x1000;
+
+        /// @brief The number of slots in each node of the tree.
+        static constexpr size_t kFanout = 512;
+
+    private:
+        static constexpr unsigned kPageShift = 12;
+        static constexpr unsigned kFanoutShift = 9;
+
+        /// @brief Enough levels to address every page of a 64 bit offset.
+        static constexpr unsigned kMaxHeight = 6;
+
+        /// @brief A page and its lock, kept together so a lookup only touches one cache line.
+        struct Extent {
+            std::atomic<std::byte*> page;
+            mutable stdx::SharedSpinLock lock;
+        };
+
+        /// @brief The bottom level of the tree, holds the pages.
+        struct Leaf {
+            Extent extents[kFanout];
+        };
+
+        /// @brief An inner level of the tree, holds leaves or other nodes.
+        struct Node {
+            std::atomic<void*> slots[kFanout];
+        };
+
+        /// @brief The root node and the height of the tree.
+        ///
+        /// The height is stored in the low bits of the root pointer so that
+        /// readers always see a root and height that belong together.
+        std::atomic<uintptr_t> mRoot = 0;
+
+        /// @brief Serializes allocation of pages and nodes.
+        stdx::SpinLock mGrowLock;
+
+        std::atomic<uint64_t> mSize = 0;
+        std::atomic<uint64_t> mPageCount = 0;
+
+        static constexpr uintptr_t kHeightMask = 0x7;
+
+        static void *rootNode(uintptr_t root) { return (void*)(root & ~kHeightMask); }
+        static unsigned rootHeight(uintptr_t root) { return root & kHeightMask; }
+
+        /// @brief The number of pages a tree of @p height can hold.
+        static uint64_t capacity(unsigned height);
+
+        /// @brief Find the leaf holding a page, or nullptr if it does not exist yet.
+        Leaf *findLeaf(uint64_t page, size_t *slot) const;
+
+        /// @brief Find or create the leaf holding a page.
+        OsStatus getLeaf(uint64_t page, Leaf **leaf, size_t *slot) REQUIRES(mGrowLock);
+
+        /// @brief Make sure every page in a range has memory.
+        OsStatus reserve(uint64_t front, uint64_t back);
+
+        static void destroy(void *node, unsigned height);
+
+    public:
+        RamFsStorage() = default;
+        ~RamFsStorage();
+
+        RamFsStorage(const RamFsStorage&) = delete;
+        RamFsStorage& operator=(const RamFsStorage&) = delete;
+
+        /// @brief Read from the file, holes read as zero.
+        ///
+        /// @param dst The buffer to read into.
+        /// @param size The number of bytes to read.
+        /// @param offset The offset in the file to read from.
+        ///
+        /// @return The number of bytes read, less than @p size only at the end of the file.
+        size_t read(void *dst, size_t size, uint64_t offset) const;
+
+        /// @brief Write to the file, growing it if needed.
+        ///
+        /// @param src The data to write.
+        /// @param size The number of bytes to write.
+        /// @param offset The offset in the file to write to.
+        /// @param[out] written The number of bytes written.
+        ///
+        /// @return The status of the operation.
+        OsStatus write(const void *src, size_t size, uint64_t offset, size_t *written [[outparam]]);
+
+        /// @brief The logical size of the file.
+        uint64_t size() const { return mSize.load(std::memory_order_acquire); }
+
+        /// @brief The number of pages that have memory.
+        uint64_t pageCount() const { return mPageCount.load(std::memory_order_relaxed); }
+    };
+}
@@ -174,6 +174,7 @@ namespace vfs {
 
         OsStatus stat(OsFileInfo *stat);
         OsStatus read(ReadRequest request, ReadResult *result);
+        OsStatus physical(uint64_t offset, size_t size, sm::PhysicalAddress *address);
     };
 
     class TarFsFolder : public TarFsNode, public FolderMixin {
@@ -198,17 +199,33 @@ namespace vfs {
     /// @return The status of the operation.
     OsStatus ParseTar(km::BlockDevice *media, TarParseOptions options, sm::AbslBTreeMap<VfsPath, TarEntry> *result);
 
+    /// @brief Parses a POSIX.1-1988 tar archive that is already in memory.
+    ///
+    /// The headers are read in place in a single pass over the image.
+    ///
+    /// @param image The memory containing the tar archive.
+    /// @param options The options for parsing the tar archive.
+    /// @param result The parsed tar archive.
+    ///
+    /// @return The status of the operation.
+    OsStatus ParseTar(std::span<const std::byte> image, TarParseOptions options, sm::AbslBTreeMap<VfsPath, TarEntry> *result);
+
     class TarFsMount final : public IVfsMount {
         sm::SharedPtr<km::IBlockDriver> mBlock;
         km::BlockDevice mMedia;
         sm::RcuSharedPtr<TarFsFolder> mRootNode;
 
+        /// @brief The archive when the media is memory resident, empty otherwise.
+        std::span<const std::byte> mImage;
+
         OsStatus walk(const VfsPath& path, sm::RcuSharedPtr<INode> *folder);
 
     public:
         TarFsMount(TarFs *tarfs, sm::RcuDomain *domain, sm::SharedPtr<km::IBlockDriver> block);
 
         km::BlockDevice *media() { return &mMedia; }
+        std::span<const std::byte> image() const { return mImage; }
+        sm::PhysicalAddress imageAddress() const { return mBlock->residentAddress(); }
 
         OsStatus root(sm::RcuSharedPtr<INode> *node) override;
     };
@@ -76,6 +76,8 @@ namespace km {
         bool hypervisor() const { return l1ecx & (1 << 31); }
 
         bool avx2() const { return l7ebx & (1 << 5); }
+        bool erms() const { return l7ebx & (1 << 9); }
+        bool fsrm() const { return l7edx & (1 << 4); }
         bool avx512f() const { return l7ebx & (1 << 16); }
         bool la57() const { return l7ecx & (1 << 16); }
         bool umip() const { return l7ecx & (1 << 2); }
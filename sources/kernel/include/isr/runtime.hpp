@@ -2,12 +2,39 @@
 
 #include "isr/isr.hpp"
 
+#include <span>
+
 namespace km {
+    enum class CpuCoreId : uint32_t;
+
+    /// @brief The isr table of a cpu.
+    struct CpuIsrTable {
+        CpuCoreId core;
+        LocalIsrTable *table;
+    };
+
+    /// @brief The maximum number of cpus whose isr tables are published.
+    static constexpr size_t kMaxCpuIsrTables = 256;
+
     class RuntimeIsrManager : public ILocalIsrManager {
     public:
         LocalIsrTable *getLocalIsrTable() override;
         static RuntimeIsrManager *instance();
 
-        static void cpuInit();
+        /// @brief Initialize the isr table of the current cpu.
+        ///
+        /// The table is published so that other cpus can route interrupts to this cpu.
+        ///
+        /// @param core The id of the current cpu.
+        static void cpuInit(CpuCoreId core);
     };
+
+    /// @brief Get the isr tables of every cpu that has been initialized.
+    ///
+    /// Entries may be allocated and released in the table of another cpu, as
+    /// both operations are atomic. Tables are published in the order their cpu
+    /// was started and are never removed.
+    ///
+    /// @return The published tables.
+    std::span<const CpuIsrTable> GetCpuIsrTables() noexcept [[clang::reentrant]];
 }
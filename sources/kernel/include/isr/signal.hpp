@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+
+#include <stdint.h>
+
+namespace km {
+    /// @brief A notification raised from an interrupt handler and waited on by threads.
+    ///
+    /// Raising the signal only bumps a counter, so it is safe from any context.
+    /// Waiters take the current @a sequence before checking their condition and
+    /// then wait for it to move, so a signal raised between the check and the
+    /// wait is never lost.
+    class IsrSignal {
+        std::atomic<uint64_t> mSequence{0};
+
+    public:
+        constexpr IsrSignal() noexcept = default;
+
+        /// @brief The number of times the signal has been raised.
+        uint64_t sequence() const noexcept [[clang::reentrant, clang::nonblocking]] {
+            return mSequence.load(std::memory_order_acquire);
+        }
+
+        /// @brief Wake all threads waiting on the signal.
+        void signal() noexcept [[clang::reentrant, clang::nonblocking]] {
+            mSequence.fetch_add(1, std::memory_order_release);
+        }
+
+        /// @brief Wait for the signal to be raised after @p sequence was taken.
+        ///
+        /// @param sequence The value of @a sequence before the waiter checked its condition.
+        /// @param expired Returns true once the waiter should stop waiting.
+        /// @param yield Gives up the cpu between checks.
+        ///
+        /// @return True if the signal was raised, false if @p expired first.
+        template<typename Expired, typename Yield>
+        bool wait(uint64_t sequence, Expired&& expired, Yield&& yield) [[clang::blocking]] {
+            while (sequence == this->sequence()) {
+                if (expired()) {
+                    return false;
+                }
+
+                yield();
+            }
+
+            return true;
+        }
+    };
+}
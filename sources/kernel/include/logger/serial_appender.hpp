@@ -9,12 +9,20 @@
 namespace km {
     class SerialAppender final : public ILogAppender {
         SerialPort mSerialPort;
+        BufferedSerialPort *mBufferedPort = nullptr;
 
         void write(const LogMessageView& message) override;
 
     public:
         constexpr SerialAppender() noexcept = default;
 
+        /// @brief Switch the appender to a buffered port.
+        ///
+        /// Once set, writes are queued and the appender never polls the port.
+        ///
+        /// @param port The buffered port, must be backed by the same serial port.
+        void setBufferedPort(BufferedSerialPort *port) noexcept { mBufferedPort = port; }
+
         static OsStatus create(SerialPort port, SerialAppender *appender) noexcept;
     };
 }
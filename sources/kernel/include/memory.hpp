@@ -16,6 +16,8 @@ namespace km {
         //
         // TODO: this is a bad hack to work around me being lazy when writing the rtld
         //
+        // The last page is reserved for the clock page, see OS_CLOCK_PAGE_ADDRESS.
+        //
         return VirtualRange { (void*)(x64::kPageSize * 4), (void*)sm::gigabytes(4).bytes() };
     }
 
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "common/util/util.hpp"
+
+#include "memory/memory.hpp"
+#include "std/spinlock.hpp"
+
+#include <array>
+#include <atomic>
+
+namespace km::detail {
+    /// @brief A small cache of recent page table walks.
+    ///
+    /// Each entry remembers the result of a walk along with the range of virtual address
+    /// space that the deepest entry of the walk covers. Any address inside that range
+    /// resolves to the same leaf, so lookups for nearby addresses can skip the walk entirely.
+    ///
+    /// The cache is shared between all users of an address space, lookups use @a try_lock
+    /// and treat contention as a miss so readers never spin on the cache.
+    ///
+    /// A walk may race with a modification of the page tables, so walks capture the
+    /// generation before they begin and their result is only inserted if no modification
+    /// started or was in progress since then.
+    class PageWalkCache {
+        static constexpr size_t kEntryCount = 4;
+
+        struct Entry {
+            uintptr_t front;
+            uintptr_t back;
+            PageWalk walk;
+        };
+
+        stdx::SpinLock mLock;
+        std::array<Entry, kEntryCount> mEntries GUARDED_BY(mLock){};
+        uint32_t mNext GUARDED_BY(mLock){0};
+
+        /// @brief Bumped when a modification begins and when it ends.
+        std::atomic<uint64_t> mGeneration{0};
+
+        /// @brief The number of modifications in progress.
+        std::atomic<uint32_t> mActive{0};
+
+    public:
+        constexpr PageWalkCache() noexcept [[clang::nonblocking]] = default;
+
+        UTIL_NOCOPY(PageWalkCache);
+
+        /// @brief Moving a cache produces an empty cache.
+        ///
+        /// The walk results are tied to the page tables they were produced from, the owning
+        /// page tables are free to repopulate the cache after a move.
+        constexpr PageWalkCache(PageWalkCache&&) noexcept [[clang::nonblocking]]
+            : PageWalkCache()
+        { }
+
+        PageWalkCache& operator=(PageWalkCache&&) noexcept [[clang::nonallocating]] {
+            invalidate();
+            return *this;
+        }
+
+        /// @brief Find a cached walk for the leaf containing @p address.
+        ///
+        /// @param address The address to lookup.
+        /// @param[out] walk The cached walk, the @a PageWalk::address field is the address that was
+        ///                  originally walked and may differ from @p address.
+        /// @param[out] leaf The range covered by the cached leaf.
+        ///
+        /// @return True if a cached walk was found, false otherwise.
+        bool find(uintptr_t address, PageWalk *walk [[outparam]], VirtualRange *leaf [[outparam]]) noexcept [[clang::nonblocking]] {
+            if (!mLock.try_lock()) {
+                return false;
+            }
+
+            bool found = false;
+            for (const Entry& entry : mEntries) {
+                if (entry.front <= address && address < entry.back) {
+                    *walk = entry.walk;
+                    *leaf = VirtualRange { (const void*)entry.front, (const void*)entry.back };
+                    found = true;
+                    break;
+                }
+            }
+
+            mLock.unlock();
+            return found;
+        }
+
+        /// @brief The generation to capture before walking the page tables.
+        uint64_t generation() const noexcept [[clang::nonblocking]] {
+            return mGeneration.load(std::memory_order_acquire);
+        }
+
+        /// @brief Insert a walk result into the cache, evicting the oldest entry.
+        ///
+        /// The result is discarded if the page tables were modified, or are being
+        /// modified, since @p generation was captured.
+        ///
+        /// @param walk The walk result.
+        /// @param leaf The range covered by the leaf.
+        /// @param generation The generation captured before the walk began.
+        ///
+        /// @return True if the walk was inserted.
+        bool insert(const PageWalk& walk, VirtualRange leaf, uint64_t generation) noexcept [[clang::nonblocking]] {
+            if (!mLock.try_lock()) {
+                return false;
+            }
+
+            bool current = mActive.load(std::memory_order_relaxed) == 0
+                && mGeneration.load(std::memory_order_relaxed) == generation;
+
+            if (current) {
+                mEntries[mNext] = Entry { (uintptr_t)leaf.front, (uintptr_t)leaf.back, walk };
+                mNext = (mNext + 1) % kEntryCount;
+            }
+
+            mLock.unlock();
+            return current;
+        }
+
+        /// @brief Start a modification of the page tables.
+        ///
+        /// Discards all cached walks and refuses walks that are still running.
+        void beginModification() noexcept [[clang::blocking, clang::nonallocating]] {
+            stdx::LockGuard guard(mLock);
+            mActive.fetch_add(1, std::memory_order_relaxed);
+            mGeneration.fetch_add(1, std::memory_order_relaxed);
+            mEntries = {};
+            mNext = 0;
+        }
+
+        /// @brief Finish a modification of the page tables.
+        ///
+        /// Walks that captured the generation during the modification are refused.
+        void endModification() noexcept [[clang::blocking, clang::nonallocating]] {
+            stdx::LockGuard guard(mLock);
+            mGeneration.fetch_add(1, std::memory_order_release);
+            mActive.fetch_sub(1, std::memory_order_release);
+        }
+
+        /// @brief Marks the page tables as being modified for the duration of a scope.
+        class ModifyGuard {
+            PageWalkCache& mCache;
+
+        public:
+            UTIL_NOCOPY(ModifyGuard);
+            UTIL_NOMOVE(ModifyGuard);
+
+            ModifyGuard(PageWalkCache& cache) noexcept [[clang::blocking, clang::nonallocating]]
+                : mCache(cache)
+            {
+                mCache.beginModification();
+            }
+
+            ~ModifyGuard() noexcept [[clang::blocking, clang::nonallocating]] {
+                mCache.endModification();
+            }
+        };
+
+        /// @brief Discard all cached walks and refuse walks that are still running.
+        void invalidate() noexcept [[clang::blocking, clang::nonallocating]] {
+            stdx::LockGuard guard(mLock);
+            mGeneration.fetch_add(1, std::memory_order_release);
+            mEntries = {};
+            mNext = 0;
+        }
+    };
+}
@@ -1,8 +1,15 @@
 #pragma once
 
-#include "std/vector.hpp"
 #include "common/util/util.hpp"
 
+#include <bit>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include <stddef.h>
+#include <stdint.h>
+
 namespace km {
     struct PoolAllocatorStats {
         /// @brief Number of currently allocated magazines.
@@ -30,70 +37,148 @@ namespace km {
             alignas(T) char data[sizeof(T)];
         };
 
-        template<typename T>
+        /// @brief Which of the pool lists a block is linked into.
+        enum class PoolBlockState : uint8_t {
+            /// @brief Every slot is free.
+            eEmpty,
+
+            /// @brief Some slots are free.
+            ePartial,
+
+            /// @brief No slots are free.
+            eFull,
+        };
+
+        /// @brief A block of pool items.
+        ///
+        /// Blocks are allocated aligned to their size, so the block that owns an item
+        /// is found by masking the item address.
+        template<typename T, size_t BlockSize>
         struct PoolBlock {
             using Item = PoolItem<T>;
 
-            uint32_t count;
+            static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+            PoolBlock *prev;
+            PoolBlock *next;
+
+            /// @brief Head of the list of items that have been released.
             uint32_t firstFreeIndex;
-            Item items[];
+
+            /// @brief Items at and above this index have never been handed out.
+            uint32_t nextUnusedIndex;
+
+            uint32_t freeCount;
+            PoolBlockState state;
+
+            alignas(Item) Item items[];
+
+            static constexpr size_t capacity() noexcept [[clang::nonblocking]] {
+                return (BlockSize - sizeof(PoolBlock)) / sizeof(Item);
+            }
+
+            static PoolBlock *owner(void *ptr) noexcept [[clang::nonblocking]] {
+                return std::bit_cast<PoolBlock*>(std::bit_cast<uintptr_t>(ptr) & ~(BlockSize - 1));
+            }
 
             void *take() noexcept [[clang::nonblocking]] {
-                if (firstFreeIndex < count) {
-                    Item *item = &items[firstFreeIndex];
+                Item *item;
+                if (firstFreeIndex != kInvalidIndex) {
+                    item = &items[firstFreeIndex];
                     firstFreeIndex = item->next;
-                    return item->data;
+                } else if (nextUnusedIndex < capacity()) {
+                    item = &items[nextUnusedIndex++];
+                } else {
+                    return nullptr;
                 }
 
-                return nullptr;
+                freeCount -= 1;
+                return item->data;
             }
 
-            void give(Item *item) noexcept [[clang::nonblocking]] {
+            void give(void *ptr) noexcept [[clang::nonblocking]] {
+                Item *item = std::bit_cast<Item*>(ptr);
                 item->next = firstFreeIndex;
                 firstFreeIndex = (item - items);
+                freeCount += 1;
             }
 
-            bool contains(Item *item) const noexcept [[clang::nonblocking]] {
-                return item >= items && item < items + count;
+            bool isEmpty() const noexcept [[clang::nonblocking]] {
+                return freeCount == capacity();
             }
 
-            bool reclaim(void *ptr) noexcept [[clang::nonblocking]] {
-                Item *item = std::bit_cast<Item*>(ptr);
-                if (contains(item)) {
-                    give(item);
-                    return true;
-                }
-
-                return false;
+            bool isFull() const noexcept [[clang::nonblocking]] {
+                return freeCount == 0;
             }
 
-            size_t countFreeSlots() const noexcept [[clang::nonallocating]] {
-                size_t result = 0;
-                size_t index = firstFreeIndex;
-                while (index < count) {
-                    index = items[index].next;
-                    result++;
-                }
-                return result;
+            void init() noexcept [[clang::nonblocking]] {
+                prev = nullptr;
+                next = nullptr;
+                firstFreeIndex = kInvalidIndex;
+                nextUnusedIndex = 0;
+                freeCount = capacity();
+                state = PoolBlockState::eEmpty;
             }
+        };
 
-            size_t capacity() const noexcept [[clang::nonblocking]] {
-                return count;
+        /// @brief An intrusive doubly linked list of pool blocks.
+        template<typename Block>
+        class PoolBlockList {
+            Block *mHead = nullptr;
+            size_t mCount = 0;
+
+        public:
+            constexpr PoolBlockList() noexcept = default;
+            UTIL_NOCOPY(PoolBlockList);
+
+            constexpr PoolBlockList(PoolBlockList&& other) noexcept
+                : mHead(std::exchange(other.mHead, nullptr))
+                , mCount(std::exchange(other.mCount, 0))
+            { }
+
+            constexpr PoolBlockList& operator=(PoolBlockList&& other) noexcept {
+                mHead = std::exchange(other.mHead, nullptr);
+                mCount = std::exchange(other.mCount, 0);
+                return *this;
             }
 
-            bool isEmpty() const noexcept [[clang::nonallocating]] {
-                return countFreeSlots() == capacity();
+            Block *head() const noexcept [[clang::nonblocking]] { return mHead; }
+            size_t count() const noexcept [[clang::nonblocking]] { return mCount; }
+            bool isEmpty() const noexcept [[clang::nonblocking]] { return mHead == nullptr; }
+
+            void push(Block *block) noexcept [[clang::nonblocking]] {
+                block->prev = nullptr;
+                block->next = mHead;
+                if (mHead != nullptr) {
+                    mHead->prev = block;
+                }
+                mHead = block;
+                mCount += 1;
             }
 
-            void init(size_t blockCount) noexcept [[clang::nonallocating]] {
-                count = blockCount;
-                firstFreeIndex = 0;
+            void remove(Block *block) noexcept [[clang::nonblocking]] {
+                if (block->prev != nullptr) {
+                    block->prev->next = block->next;
+                } else {
+                    mHead = block->next;
+                }
+
+                if (block->next != nullptr) {
+                    block->next->prev = block->prev;
+                }
+
+                block->prev = nullptr;
+                block->next = nullptr;
+                mCount -= 1;
+            }
 
-                for (size_t i = 0; i < blockCount - 1; i++) {
-                    items[i].next = i + 1;
+            Block *pop() noexcept [[clang::nonblocking]] {
+                Block *block = mHead;
+                if (block != nullptr) {
+                    remove(block);
                 }
 
-                items[blockCount - 1].next = UINT32_MAX;
+                return block;
             }
         };
     }
@@ -105,38 +190,83 @@ namespace km {
     /// D3D12MA uses this to allocate from graphics memory, which is not accessible from the CPU. We
     /// use this for physical memory, which is not mapped into the cpu address space.
     ///
+    /// Blocks are kept on empty, partial and full lists so that both allocation and release
+    /// are constant time. Released items find their block by masking the address, as blocks
+    /// are allocated aligned to @p BlockSize.
+    ///
+    /// @tparam T The type of object to allocate.
+    /// @tparam BlockSize The size and alignment of each block, must be a power of 2.
+    ///
     /// @cite D3D12MA
-    template<typename T>
+    template<typename T, size_t BlockSize = 4096>
     class PoolAllocator {
+        static_assert(std::has_single_bit(BlockSize), "BlockSize must be a power of 2");
+
         using Item = detail::PoolItem<T>;
-        using Block = detail::PoolBlock<T>;
+        using Block = detail::PoolBlock<T, BlockSize>;
+        using BlockList = detail::PoolBlockList<Block>;
+        using BlockState = detail::PoolBlockState;
+
+        static_assert(Block::capacity() >= 8, "BlockSize is too small for T");
+
+    public:
+        /// @brief The default number of empty blocks retained before they are freed.
+        static constexpr size_t kDefaultEmptyHighWaterMark = 4;
+
+    private:
+        BlockList mEmpty;
+        BlockList mPartial;
+        BlockList mFull;
+
+        /// @brief The number of empty blocks to keep around to absorb allocation churn.
+        size_t mEmptyHighWaterMark = kDefaultEmptyHighWaterMark;
+
+        /// @brief The number of free slots across all blocks.
+        size_t mFreeSlots = 0;
+
+        BlockList& listOf(BlockState state) noexcept [[clang::nonblocking]] {
+            switch (state) {
+            case BlockState::eEmpty:
+                return mEmpty;
+            case BlockState::ePartial:
+                return mPartial;
+            case BlockState::eFull:
+                return mFull;
+            }
+
+            std::unreachable();
+        }
+
+        void moveBlock(Block *block, BlockState state) noexcept [[clang::nonblocking]] {
+            if (block->state == state) {
+                return;
+            }
 
-        stdx::Vector2<Block*> mBlocks;
+            listOf(block->state).remove(block);
+            block->state = state;
+            listOf(state).push(block);
+        }
 
-        size_t nextBlockCapacity() const noexcept [[clang::nonblocking]] {
-            if (mBlocks.isEmpty()) {
-                return 16;
+        void updateBlock(Block *block) noexcept [[clang::nonblocking]] {
+            if (block->isFull()) {
+                moveBlock(block, BlockState::eFull);
+            } else if (block->isEmpty()) {
+                moveBlock(block, BlockState::eEmpty);
             } else {
-                Block *block = mBlocks.back();
-                return block->capacity() * 3 / 2;
+                moveBlock(block, BlockState::ePartial);
             }
         }
 
         Block *newBlock() noexcept [[clang::allocating]] {
-            size_t nextCapacity = nextBlockCapacity();
-            char *memory = new (std::align_val_t(alignof(Block)), std::nothrow) char[sizeof(Block) + (sizeof(Item) * nextCapacity)];
+            void *memory = operator new(BlockSize, std::align_val_t(BlockSize), std::nothrow);
             if (memory == nullptr) {
                 return nullptr;
             }
 
             Block *block = std::bit_cast<Block*>(memory);
-
-            if (mBlocks.add(block) != OsStatusSuccess) {
-                freeBlock(block);
-                return nullptr;
-            }
-
-            block->init(nextCapacity);
+            block->init();
+            mEmpty.push(block);
+            mFreeSlots += Block::capacity();
 
             return block;
         }
@@ -146,19 +276,51 @@ namespace km {
 
         void freeBlock(Block *block) noexcept [[clang::nonallocating]] {
             std::destroy_at(block);
-            operator delete[]((char*)block, std::align_val_t(alignof(Block)));
+            operator delete(std::bit_cast<void*>(block), std::align_val_t(BlockSize));
         }
 
 #pragma clang diagnostic pop
 
+        void freeList(BlockList& list) noexcept [[clang::nonallocating]] {
+            while (Block *block = list.pop()) {
+                mFreeSlots -= block->freeCount;
+                freeBlock(block);
+            }
+        }
+
+        /// @brief Free empty blocks until there are at most @p limit remaining.
+        PoolCompactStats trimEmptyBlocks(size_t limit) noexcept [[clang::nonallocating]] {
+            PoolCompactStats stats{};
+            while (mEmpty.count() > limit) {
+                Block *block = mEmpty.pop();
+                stats.magazines += 1;
+                stats.slots += Block::capacity();
+                mFreeSlots -= Block::capacity();
+                freeBlock(block);
+            }
+
+            return stats;
+        }
+
     public:
         UTIL_NOCOPY(PoolAllocator);
 
-        constexpr PoolAllocator(PoolAllocator&& other) noexcept = default;
+        constexpr PoolAllocator(PoolAllocator&& other) noexcept
+            : mEmpty(std::move(other.mEmpty))
+            , mPartial(std::move(other.mPartial))
+            , mFull(std::move(other.mFull))
+            , mEmptyHighWaterMark(other.mEmptyHighWaterMark)
+            , mFreeSlots(std::exchange(other.mFreeSlots, 0))
+        { }
+
         constexpr PoolAllocator& operator=(PoolAllocator&& other) noexcept {
             if (this != &other) {
                 clear();
-                mBlocks = std::move(other.mBlocks);
+                mEmpty = std::move(other.mEmpty);
+                mPartial = std::move(other.mPartial);
+                mFull = std::move(other.mFull);
+                mEmptyHighWaterMark = other.mEmptyHighWaterMark;
+                mFreeSlots = std::exchange(other.mFreeSlots, 0);
             }
             return *this;
         }
@@ -168,38 +330,55 @@ namespace km {
             clear();
         }
 
-        void clear() noexcept [[clang::nonallocating]] {
-            for (Block *block : mBlocks) {
-                freeBlock(block);
-            }
+        /// @brief Set the number of empty blocks retained before release frees them.
+        ///
+        /// @param count The number of empty blocks to retain.
+        void setEmptyHighWaterMark(size_t count) noexcept [[clang::nonallocating]] {
+            mEmptyHighWaterMark = count;
+            trimEmptyBlocks(count);
+        }
 
-            mBlocks.clear();
+        size_t emptyHighWaterMark() const noexcept [[clang::nonblocking]] {
+            return mEmptyHighWaterMark;
+        }
+
+        void clear() noexcept [[clang::nonallocating]] {
+            freeList(mEmpty);
+            freeList(mPartial);
+            freeList(mFull);
         }
 
         void *allocate() noexcept [[clang::allocating]] {
-            for (size_t i = mBlocks.count(); i > 0; i--) {
-                Block *block = mBlocks[i - 1];
-                if (void *ptr = block->take()) {
-                    return ptr;
-                }
+            // prefer partially used blocks to keep empty blocks available for release
+            Block *block = mPartial.head();
+            if (block == nullptr) {
+                block = mEmpty.head();
             }
 
-            if (Block *block = newBlock()) {
-                return block->take();
+            if (block == nullptr) {
+                block = newBlock();
             }
 
-            return nullptr;
+            if (block == nullptr) {
+                return nullptr;
+            }
+
+            void *ptr = block->take();
+            mFreeSlots -= 1;
+            updateBlock(block);
+
+            return ptr;
         }
 
         void release(void *ptr) noexcept [[clang::nonallocating]] {
-            for (size_t i = mBlocks.count(); i > 0; i--) {
-                Block *block = mBlocks[i - 1];
-                if (block->reclaim(ptr)) {
-                    return;
-                }
-            }
+            Block *block = Block::owner(ptr);
+            block->give(ptr);
+            mFreeSlots += 1;
+            updateBlock(block);
 
-            std::unreachable();
+            if (block->state == BlockState::eEmpty) {
+                trimEmptyBlocks(mEmptyHighWaterMark);
+            }
         }
 
         template<typename... Args>
@@ -219,42 +398,18 @@ namespace km {
         }
 
         PoolCompactStats compact() noexcept [[clang::nonallocating]] {
-            size_t magazines = 0;
-            size_t slots = 0;
-
-            size_t index = 0;
-            while (index < mBlocks.count()) {
-                Block *block = mBlocks[index];
-                if (block->isEmpty()) {
-                    slots += block->capacity();
-                    magazines += 1;
-
-                    freeBlock(block);
-                    mBlocks.remove(index);
-                } else {
-                    index++;
-                }
-            }
-
-            return PoolCompactStats { magazines, slots };
+            return trimEmptyBlocks(0);
         }
 
         PoolAllocatorStats stats() const noexcept [[clang::nonallocating]] {
-            size_t freeSlots = 0;
-            size_t totalSlots = 0;
-            size_t controlMemory = mBlocks.count() * sizeof(Block*);
-            for (Block *block : mBlocks) {
-                size_t freeBlocks = block->countFreeSlots();
-                freeSlots += freeBlocks;
-                totalSlots += block->count;
-                controlMemory += sizeof(Block) + (sizeof(Item) * freeBlocks);
-            }
+            size_t magazines = mEmpty.count() + mPartial.count() + mFull.count();
+            size_t totalSlots = magazines * Block::capacity();
 
             return PoolAllocatorStats {
-                .magazines = mBlocks.count(),
-                .freeSlots = freeSlots,
+                .magazines = magazines,
+                .freeSlots = mFreeSlots,
                 .totalSlots = totalSlots,
-                .controlMemory = controlMemory,
+                .controlMemory = (magazines * sizeof(Block)) + (sizeof(Item) * mFreeSlots),
             };
         }
     };
@@ -207,6 +207,17 @@ namespace km {
         /// @warning If you're using this function, you're doing it wrong.
         void freeAddress(PhysicalAddress address) noexcept [[clang::nonallocating]];
 
+        /// @brief Visit every free range in the heap.
+        ///
+        /// @param fn Called with the range of each non-empty free block.
+        /// @see TlsfHeap::forEachFreeRange
+        template<typename F>
+        void forEachFreeRange(F&& fn) const {
+            mHeap.forEachFreeRange([&](MemoryRange range) {
+                fn(Range { Address { range.front.address }, Address { range.back.address } });
+            });
+        }
+
         /// @brief Find an allocation by its address.
         /// @warning If you're using this function, you're doing it wrong.
         OsStatus findAllocation(PhysicalAddress address, TlsfAllocation *result [[outparam]]) noexcept [[clang::nonallocating]];
@@ -256,6 +267,23 @@ namespace km {
         [[nodiscard]]
         OsStatus reserve(MemoryRange range, TlsfAllocation *result [[outparam]]) [[clang::allocating]];
 
+        /// @brief Visit every free range in the heap.
+        ///
+        /// Ranges are visited from the top of the heap downwards, adjacent free
+        /// blocks are always merged so each visited range is maximal.
+        ///
+        /// @warning The heap must not be modified while it is being visited.
+        ///
+        /// @param fn Called with the range of each non-empty free block.
+        template<typename F>
+        void forEachFreeRange(F&& fn) const {
+            for (const TlsfBlock *block = mNullBlock; block != nullptr; block = block->prev) {
+                if (block->isFree() && block->size != 0) {
+                    fn(MemoryRange { block->offset, block->offset + block->size });
+                }
+            }
+        }
+
         /// @brief Gather statistics about the heap.
         ///
         /// @return The current heap statistics.
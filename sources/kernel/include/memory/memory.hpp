@@ -67,6 +67,21 @@ namespace km {
         /// @return true if the mapping is eligible for large pages, false otherwise.
         bool IsLargePageEligible(AddressMapping mapping) noexcept [[clang::nonblocking]];
 
+        /// @brief Allocations at least this large are placed on large page boundaries.
+        constexpr size_t kLargePageThreshold = x64::kLargePageSize;
+
+        /// @brief Select the alignment for a new allocation of physical or virtual memory.
+        ///
+        /// Allocations at least @a kLargePageThreshold in size are aligned to a 2m boundary
+        /// so that when both the physical and virtual allocations are made with this alignment
+        /// the mapping between them is @ref IsLargePageEligible.
+        ///
+        /// @param size The size of the allocation.
+        /// @param align The alignment requested by the caller.
+        ///
+        /// @return The alignment to use for the allocation, never less than @p align.
+        size_t GetLargePageAlignment(size_t size, size_t align) noexcept [[clang::nonblocking]];
+
         /// @brief Calculate the maximum possible number of pages required to map a range of memory.
         ///
         /// This is used to determine the number of pages to pre-allocate when mapping memory to
@@ -182,6 +197,20 @@ namespace km {
 
             return flags;
         }
+
+        /// @brief The size of the area described by the deepest entry of the walk.
+        ///
+        /// For a mapped address this is the size of the page that maps it. For an unmapped
+        /// address this is the size of the area covered by the first non-present entry,
+        /// every address in that area is also unmapped.
+        ///
+        /// @return The size of the area in bytes.
+        constexpr uintptr_t coverage() const noexcept [[clang::nonblocking]] {
+            if (!pml4e.present()) return x64::kHugePageSize * 512;
+            if (!pdpte.present() || pdpte.is1g()) return x64::kHugePageSize;
+            if (!pdte.present() || pdte.is2m()) return x64::kLargePageSize;
+            return x64::kPageSize;
+        }
     };
 }
 
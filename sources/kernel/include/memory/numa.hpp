@@ -0,0 +1,127 @@
+#pragma once
+
+#include "memory/range.hpp"
+#include "std/vector.hpp"
+#include "util/format.hpp"
+
+#include <span>
+
+namespace km {
+    enum class CpuCoreId : uint32_t;
+
+    /// @brief A dense index identifying a NUMA node.
+    ///
+    /// Firmware proximity domains are sparse 32-bit values, nodes are numbered
+    /// in the order their proximity domain was first seen so they can be used
+    /// to index fixed size tables.
+    enum class NumaNodeId : uint32_t {
+        eInvalid = 0xFFFF'FFFF
+    };
+
+    /// @brief The maximum number of NUMA nodes the kernel will track.
+    static constexpr size_t kMaxNumaNodes = 8;
+
+    /// @brief The relative distance from a node to itself.
+    static constexpr uint8_t kNumaLocalDistance = 10;
+
+    /// @brief The relative distance assumed between nodes when the firmware provides no SLIT.
+    static constexpr uint8_t kNumaRemoteDistance = 20;
+
+    struct NumaMemoryAffinity {
+        MemoryRange range;
+        NumaNodeId node;
+    };
+
+    struct NumaCpuAffinity {
+        CpuCoreId core;
+        NumaNodeId node;
+    };
+
+    /// @brief The memory and processor affinity of each NUMA node.
+    class NumaTopology {
+        uint32_t mNodeCount;
+        uint32_t mDomains[kMaxNumaNodes];
+        uint8_t mDistance[kMaxNumaNodes][kMaxNumaNodes];
+        stdx::Vector2<NumaMemoryAffinity> mMemory;
+        stdx::Vector2<NumaCpuAffinity> mCpus;
+
+    public:
+        NumaTopology() noexcept;
+
+        /// @brief Get the node for a proximity domain, creating it if it does not exist.
+        ///
+        /// @param domain The firmware proximity domain.
+        /// @param[out] node The node for the domain.
+        ///
+        /// @return The result of the operation.
+        /// @retval OsStatusSuccess The node was found or created.
+        /// @retval OsStatusOutOfMemory There are already @a kMaxNumaNodes nodes.
+        [[nodiscard]]
+        OsStatus addNode(uint32_t domain, NumaNodeId *node [[outparam]]);
+
+        /// @brief Associate a range of physical memory with a proximity domain.
+        [[nodiscard]]
+        OsStatus addMemory(uint32_t domain, MemoryRange range);
+
+        /// @brief Associate a processor with a proximity domain.
+        [[nodiscard]]
+        OsStatus addCpu(uint32_t domain, CpuCoreId core);
+
+        /// @brief Set the relative distance between two nodes.
+        ///
+        /// Distances are normalized such that @a kNumaLocalDistance is the distance
+        /// from a node to itself.
+        void setDistance(NumaNodeId from, NumaNodeId to, uint8_t distance) noexcept;
+
+        uint32_t nodeCount() const noexcept { return mNodeCount; }
+
+        std::span<const NumaMemoryAffinity> memory() const noexcept { return std::span(mMemory.begin(), mMemory.end()); }
+        std::span<const NumaCpuAffinity> cpus() const noexcept { return std::span(mCpus.begin(), mCpus.end()); }
+
+        /// @brief Get the firmware proximity domain of a node.
+        uint32_t domainOf(NumaNodeId node) const noexcept;
+
+        /// @brief Find the node for a proximity domain.
+        ///
+        /// @return The node, or @a NumaNodeId::eInvalid if the domain is unknown.
+        NumaNodeId findNode(uint32_t domain) const noexcept;
+
+        /// @brief Find the node a processor belongs to.
+        ///
+        /// @return The node, or @a NumaNodeId::eInvalid if the processor is unknown.
+        NumaNodeId nodeOfCpu(CpuCoreId core) const noexcept;
+
+        /// @brief Find the node a physical address belongs to.
+        ///
+        /// @return The node, or @a NumaNodeId::eInvalid if the address is not described.
+        NumaNodeId nodeOfAddress(PhysicalAddress address) const noexcept;
+
+        /// @brief Get the relative distance between two nodes.
+        uint8_t distance(NumaNodeId from, NumaNodeId to) const noexcept;
+
+        /// @brief Order all nodes by their distance from a node.
+        ///
+        /// The node itself is always first, ties are broken by node index.
+        ///
+        /// @param from The node to measure from.
+        /// @param[out] order Receives the sorted nodes, must be at least @a nodeCount elements.
+        ///
+        /// @return The number of nodes written to @p order.
+        size_t nodesByDistance(NumaNodeId from, std::span<NumaNodeId> order) const noexcept;
+    };
+
+    /// @brief Get the NUMA node of the current processor.
+    ///
+    /// @return The current node, node 0 until @a SetCurrentNumaNode is called.
+    NumaNodeId GetCurrentNumaNode() noexcept [[clang::reentrant]];
+
+    /// @brief Set the NUMA node of the current processor.
+    void SetCurrentNumaNode(NumaNodeId node) noexcept;
+}
+
+template<>
+struct km::Format<km::NumaNodeId> {
+    static void format(km::IOutStream& out, km::NumaNodeId id) {
+        out.format("NODE", km::Int(std::to_underlying(id)).pad(2));
+    }
+};
@@ -4,26 +4,62 @@
 
 #include "memory/heap.hpp"
 #include "common/compiler/compiler.hpp"
+#include "memory/numa.hpp"
 #include "memory/pmm_heap.hpp"
 #include "std/spinlock.hpp"
 
 namespace km {
     struct PageAllocatorStats {
         TlsfHeapStats heap;
+
+        /// @brief The number of NUMA nodes the allocator has been partitioned into, 0 if not partitioned.
+        uint32_t nodeCount;
+
+        /// @brief Statistics for the heap serving each node.
+        TlsfHeapStats nodes[kMaxNumaNodes];
     };
 
     class PageAllocator {
         friend class PageAllocatorCommandList;
 
+        /// @brief The physical memory carved out of the primary heap for a remote NUMA node.
+        struct NodeHeap {
+            km::PmmHeap heap;
+
+            /// @brief The ranges managed by @a heap, sorted in ascending order.
+            stdx::Vector2<MemoryRange> ranges;
+
+            /// @brief Nodes to allocate from when serving this node, nearest first.
+            NumaNodeId fallback[kMaxNumaNodes];
+            uint32_t fallbackCount;
+        };
+
         stdx::SpinLock mLock;
 
+        /// @brief The primary heap, contains all memory not owned by a remote node.
         km::PmmHeap mMemoryHeap GUARDED_BY(mLock);
 
+        //
+        // The node layout is only written by partition during startup, before any other
+        // core can allocate, so it is read without holding the lock to route frees.
+        //
+        NumaNodeId mPrimaryNode;
+        uint32_t mNodeCount;
+        std::unique_ptr<NodeHeap[]> mNodes;
+
+        km::PmmHeap& heapOf(NumaNodeId node) REQUIRES(mLock);
+        km::PmmHeap& heapOwning(PhysicalAddress address) REQUIRES(mLock);
+
+        PmmAllocation allocateOnNode(size_t align, size_t size, NumaNodeId node) REQUIRES(mLock) [[clang::allocating]];
+
     public:
         UTIL_NOCOPY(PageAllocator);
 
         constexpr PageAllocator(PageAllocator&& other) noexcept
             : mMemoryHeap(std::move(other.mMemoryHeap))
+            , mPrimaryNode(std::exchange(other.mPrimaryNode, NumaNodeId(0)))
+            , mNodeCount(std::exchange(other.mNodeCount, 0))
+            , mNodes(std::move(other.mNodes))
         { }
 
         constexpr PageAllocator& operator=(PageAllocator&& other) noexcept {
@@ -31,22 +67,43 @@ namespace km {
             CLANG_DIAGNOSTIC_IGNORE("-Wthread-safety");
 
             mMemoryHeap = std::move(other.mMemoryHeap);
+            mPrimaryNode = std::exchange(other.mPrimaryNode, NumaNodeId(0));
+            mNodeCount = std::exchange(other.mNodeCount, 0);
+            mNodes = std::move(other.mNodes);
             return *this;
 
             CLANG_DIAGNOSTIC_POP();
         }
 
-        constexpr PageAllocator() noexcept = default;
+        constexpr PageAllocator() noexcept
+            : mPrimaryNode(NumaNodeId(0))
+            , mNodeCount(0)
+        { }
 
         /// @brief Allocate a number of contiguous physical pages.
         ///
+        /// Once the allocator has been partitioned memory local to the current
+        /// processors NUMA node is preferred.
+        ///
         /// @param count The number of contiguous pages to allocate.
         ///
         /// @return The allocation, or a null allocation on failure.
         [[nodiscard]]
         PmmAllocation pageAlloc(size_t count = 1) [[clang::allocating]];
 
+        /// @brief Allocate a number of contiguous physical pages, preferring a specific NUMA node.
+        ///
+        /// Falls back to other nodes in order of distance if @p node is exhausted.
+        ///
+        /// @param count The number of contiguous pages to allocate.
+        /// @param node The node to prefer.
+        ///
+        /// @return The allocation, or a null allocation on failure.
+        [[nodiscard]]
+        PmmAllocation pageAlloc(size_t count, NumaNodeId node) [[clang::allocating]];
+
         PmmAllocation aligned_alloc(size_t align, size_t size) [[clang::allocating]];
+        PmmAllocation aligned_alloc(size_t align, size_t size, NumaNodeId node) [[clang::allocating]];
 
         [[nodiscard]]
         OsStatus splitv(PmmAllocation ptr, std::span<const PhysicalAddress> points, std::span<PmmAllocation> results);
@@ -66,6 +123,28 @@ namespace km {
 
         PageAllocatorStats stats() noexcept;
 
+        /// @brief Split the allocator into one heap per NUMA node.
+        ///
+        /// Free memory belonging to each remote node is moved out of the primary heap
+        /// into a heap of its own, memory that is already allocated remains owned by
+        /// the primary heap until it is freed. The primary heap serves @p primary.
+        ///
+        /// @pre Must be called before any other processor is started.
+        ///
+        /// @param topology The NUMA topology of the system.
+        /// @param primary The node of the boot processor.
+        ///
+        /// @return The result of the operation.
+        /// @retval OsStatusSuccess The allocator was partitioned, or there is only a single node.
+        /// @retval OsStatusInvalidInput @p primary is not a node in @p topology.
+        /// @retval OsStatusAlreadyExists The allocator has already been partitioned.
+        /// @retval OsStatusOutOfMemory Failed to allocate control structures, the allocator is unchanged.
+        [[nodiscard]]
+        OsStatus partition(const NumaTopology& topology, NumaNodeId primary) [[clang::allocating]];
+
+        /// @brief Find the NUMA node whose heap owns an address.
+        NumaNodeId nodeOf(PhysicalAddress address) noexcept;
+
         [[nodiscard]]
         static OsStatus create(std::span<const boot::MemoryRegion> memmap, PageAllocator *allocator [[outparam]]) [[clang::allocating]];
     };
@@ -6,8 +6,17 @@
 namespace km {
     class PageAllocator;
 
+    /// @brief A batch of splits to apply to a page allocator.
+    ///
+    /// Splits are applied to the heap that owns each allocation, a single command
+    /// list may span the primary heap and at most one NUMA node heap.
     class PageAllocatorCommandList {
+        PageAllocator *mAllocator;
         GenericTlsfHeapCommandList<km::PhysicalAddress> mList;
+        GenericTlsfHeapCommandList<km::PhysicalAddress> mNodeList;
+        PmmHeap *mNodeHeap;
+
+        GenericTlsfHeapCommandList<km::PhysicalAddress> *listFor(PmmAllocation allocation) noexcept [[clang::nonallocating]];
 
     public:
         PageAllocatorCommandList(PageAllocator *allocator [[gnu::nonnull]]) noexcept;
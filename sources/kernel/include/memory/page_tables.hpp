@@ -3,6 +3,7 @@
 #include "arch/paging.hpp"
 
 #include "memory/detail/mapping_lookup_table.hpp"
+#include "memory/detail/page_walk_cache.hpp"
 #include "memory/detail/table_list.hpp"
 
 #include "memory/memory.hpp"
@@ -46,6 +47,9 @@ namespace km {
         /// @brief Flags used for mapping intermediate page tables.
         PageFlags mMiddleFlags{PageFlags::eNone};
 
+        /// @brief Recent page walk results, invalidated whenever the tables are modified.
+        detail::PageWalkCache mWalkCache;
+
         /// @brief Allocate a new page table, garanteed to be aligned to 4k and zeroed.
         ///
         /// @return The new page table, or @c nullptr if no memory is available.
@@ -110,7 +114,19 @@ namespace km {
         void map2m(PhysicalAddressEx paddr, const void *vaddr, PageFlags flags, MemoryType type, detail::PageTableList& buffer) noexcept [[clang::nonallocating]];
         void map1g(PhysicalAddressEx paddr, const void *vaddr, PageFlags flags, MemoryType type, detail::PageTableList& buffer);
 
-        void partialRemap2m(x64::PageTable *pt, VirtualRange range, PhysicalAddressEx paddr, MemoryType type);
+        void partialRemap2m(x64::PageTable *pt, VirtualRange range, PhysicalAddressEx paddr, MemoryType type, PageFlags flags);
+
+        /// @brief Replace a 2m page mapping with an equivalent set of 4k pages.
+        ///
+        /// @pre @p pde.is2m() must be true.
+        ///
+        /// @param pde The 2m page directory entry to split.
+        /// @param page The range of the 2m page.
+        /// @param allocation The newly allocated page table.
+        void shatter2mMapping(x64::pdte& pde, VirtualRange page, PageTableAllocation allocation);
+
+        /// @brief Split the large page containing @p address if @p address is not on its boundary.
+        void splitLargePageAt(uintptr_t address, detail::PageTableList& buffer);
 
         /// @brief Split a 2m page mapping into 4k pages.
         ///
@@ -145,6 +161,14 @@ namespace km {
 
         PageWalk walkUnlocked(sm::VirtualAddress ptr) const noexcept [[clang::nonblocking]];
 
+        /// @brief Walk to the leaf entry containing an address, consulting the walk cache first.
+        ///
+        /// @param address The address to walk.
+        /// @param[out] leaf The range of address space covered by the leaf entry.
+        ///
+        /// @return The walk result.
+        PageWalk walkLeaf(uintptr_t address, VirtualRange *leaf [[outparam]]) noexcept [[clang::nonblocking]];
+
         OsStatus earlyUnmap(VirtualRange range, VirtualRange *remaining);
         void earlyUnmapWithList(int earlyAllocations, VirtualRange range, VirtualRange *remaining, detail::PageTableList& buffer) noexcept [[clang::nonallocating]];
 
@@ -272,6 +296,23 @@ namespace km {
         [[nodiscard]]
         OsStatus unmap2m(VirtualRange range);
 
+        /// @brief Change the access flags of a range of memory.
+        ///
+        /// Pages in the range that are not mapped are ignored. Large pages that are only partially
+        /// covered by the range are split into 4k pages before their flags are changed, the page
+        /// tables required for this are allocated up front so the operation cannot fail partway.
+        ///
+        /// @param range The range to update.
+        /// @param flags The new flags for the range.
+        ///
+        /// @retval OsStatusSuccess The flags were updated, the full range is using @p flags.
+        /// @retval OsStatusOutOfMemory There was not enough memory to split large pages, no flags have been changed.
+        /// @retval OsStatusNotSupported The range partially covers a 1g page, no flags have been changed.
+        ///
+        /// @return The status of the operation.
+        [[nodiscard]]
+        OsStatus protect(VirtualRange range, PageFlags flags);
+
         /// @brief Walk the page tables to find all tables involved in mapping a given address.
         ///
         /// @param ptr The address to walk.
@@ -280,6 +321,50 @@ namespace km {
         [[nodiscard]]
         PageWalk walk(const void *ptr);
 
+        /// @brief Visit each leaf entry that covers a range of memory.
+        ///
+        /// Each leaf is visited once, and the walk skips ahead by the size of the leaf
+        /// rather than by 4k pages. Unmapped areas are reported as a single leaf covering
+        /// the area of the first non-present entry.
+        ///
+        /// @note The reported leaf range is not clamped to @p range.
+        /// @note The @a PageWalk::address field may be any address inside the leaf.
+        ///
+        /// @param range The range to walk.
+        /// @param fn Invoked as <code>bool fn(VirtualRange leaf, const PageWalk& walk)</code>, returning false stops the walk.
+        template<typename F>
+        void walkRange(VirtualRange range, F&& fn) {
+            uintptr_t front = (uintptr_t)range.front;
+            uintptr_t back = (uintptr_t)range.back;
+
+            while (front < back) {
+                VirtualRange leaf;
+                PageWalk result = walkLeaf(front, &leaf);
+                if (!fn(leaf, static_cast<const PageWalk&>(result))) {
+                    return;
+                }
+
+                //
+                // The leaf at the very top of the address space ends at 0.
+                //
+                uintptr_t next = (uintptr_t)leaf.back;
+                if (next <= front) {
+                    return;
+                }
+
+                front = next;
+            }
+        }
+
+        /// @brief Test if every page in a range is mapped with at least the given flags.
+        ///
+        /// @param range The range to test.
+        /// @param flags The flags each page must have.
+        ///
+        /// @return True if the entire range is mapped with @p flags, false otherwise.
+        [[nodiscard]]
+        bool isRangeMapped(VirtualRange range, PageFlags flags);
+
         /// @brief Compact page tables, pruning empty tables.
         ///
         /// @warning This function can be very expensive and should be used sparingly.
@@ -28,9 +28,16 @@ namespace pci {
 
         virtual ConfigSpaceType type() const = 0;
         virtual uint32_t read32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset) = 0;
+        virtual void write32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset, uint32_t value) = 0;
 
         uint16_t read16(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset);
         uint8_t read8(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset);
+
+        /// @brief Write a word of configuration space.
+        ///
+        /// Configuration space can only be written a dword at a time, the neighbouring
+        /// word is read and written back unchanged.
+        void write16(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset, uint16_t value);
     };
 
     struct EcamRegion {
@@ -64,6 +71,7 @@ namespace pci {
 
         ConfigSpaceType type() const override { return ConfigSpaceType::eMcfg; }
         uint32_t read32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset) override;
+        void write32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset, uint32_t value) override;
 
         [[nodiscard]]
         static OsStatus create(const acpi::Mcfg *mcfg, km::AddressSpace& memory, McfgConfigSpace **space [[gnu::nonnull]]) [[clang::allocating]];
@@ -73,6 +81,7 @@ namespace pci {
     public:
         ConfigSpaceType type() const override { return ConfigSpaceType::ePort; }
         uint32_t read32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset) override;
+        void write32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset, uint32_t value) override;
 
         [[nodiscard]]
         static OsStatus create(PortConfigSpace **space [[gnu::nonnull]]) [[clang::allocating]];
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "pci/pci.hpp"
+#include "isr/isr.hpp"
+#include "memory/vmm_heap.hpp"
+
+#include <span>
+
+namespace km {
+    class AddressSpace;
+    enum class CpuCoreId : uint32_t;
+}
+
+namespace pci {
+    /// @brief The address and data a device writes to raise a message signalled interrupt.
+    struct MsiMessage {
+        uint64_t address;
+        uint32_t data;
+    };
+
+    /// @brief Compose a message that delivers a fixed, edge triggered interrupt to one cpu.
+    ///
+    /// @param apic The local apic id of the cpu, must be less than 256 without interrupt remapping.
+    /// @param vector The vector to deliver.
+    constexpr MsiMessage ComposeMsiMessage(uint32_t apic, uint8_t vector) noexcept {
+        return MsiMessage {
+            .address = 0xFEE0'0000 | (uint64_t(apic & 0xFF) << 12),
+            .data = vector,
+        };
+    }
+
+    /// @brief An entry in the MSI-X table of a device.
+    struct MsiXTableEntry {
+        uint32_t addressLow;
+        uint32_t addressHigh;
+        uint32_t data;
+        uint32_t control;
+    };
+
+    static_assert(sizeof(MsiXTableEntry) == 16);
+
+    struct MsiXCapability {
+        /// @brief The offset of the capability in config space.
+        uint8_t offset;
+
+        /// @brief The number of entries in the MSI-X table.
+        uint16_t tableSize;
+
+        uint8_t tableBar;
+        uint32_t tableOffset;
+    };
+
+    struct MsiCapability {
+        /// @brief The offset of the capability in config space.
+        uint8_t offset;
+
+        /// @brief If the message address is 64 bits wide.
+        bool is64Bit;
+
+        /// @brief If the capability has a mask register.
+        bool perVectorMask;
+    };
+
+    /// @brief Read the MSI-X capability of a function.
+    ///
+    /// @return If the function has an MSI-X capability.
+    bool ReadMsiXCapability(IConfigSpace *config, DeviceBusAddress address, MsiXCapability *capability [[outparam]]);
+
+    /// @brief Read the MSI capability of a function.
+    ///
+    /// @return If the function has an MSI capability.
+    bool ReadMsiCapability(IConfigSpace *config, DeviceBusAddress address, MsiCapability *capability [[outparam]]);
+
+    enum class InterruptMode : uint8_t {
+        eNone,
+        eMsi,
+        eMsiX,
+    };
+
+    /// @brief A vector allocated to a device.
+    struct InterruptVector {
+        km::CpuCoreId core;
+        uint8_t vector;
+        km::LocalIsrTable *table;
+        const km::IsrEntry *entry;
+        km::IsrCallback callback;
+    };
+
+    /// @brief The message signalled interrupts of a PCI function.
+    ///
+    /// Vectors are allocated from the isr tables of every started cpu in turn so
+    /// that the interrupts of a device are spread across cpus. MSI-X is preferred,
+    /// plain MSI is limited to a single vector as all of its messages must target
+    /// the same cpu.
+    ///
+    /// Every vector starts masked, drivers unmask each vector once they are ready
+    /// to handle it. Legacy INTx interrupts are disabled while messages are enabled.
+    class DeviceInterrupts {
+    public:
+        /// @brief The largest number of vectors a single device can allocate.
+        static constexpr size_t kMaxVectors = 64;
+
+    private:
+        IConfigSpace *mConfig = nullptr;
+        DeviceBusAddress mAddress{};
+        InterruptMode mMode = InterruptMode::eNone;
+
+        MsiXCapability mMsiX{};
+        MsiCapability mMsi{};
+
+        /// @brief The address space the MSI-X table is mapped into.
+        km::AddressSpace *mMemory = nullptr;
+        km::VmemAllocation mTableAllocation{};
+        volatile MsiXTableEntry *mTable = nullptr;
+
+        uint16_t mCount = 0;
+        InterruptVector mVectors[kMaxVectors]{};
+
+        [[nodiscard]]
+        OsStatus allocateVectors(std::span<const km::IsrCallback> handlers, size_t firstCpu);
+        void releaseVectors();
+
+        [[nodiscard]]
+        OsStatus enableMsiX(km::AddressSpace& memory);
+        void enableMsi();
+
+        /// @brief Unmap the MSI-X table if it is mapped.
+        void unmapTable();
+
+        void setMsiEnabled(bool enabled);
+
+    public:
+        constexpr DeviceInterrupts() noexcept = default;
+
+        /// @brief Allocate message signalled interrupts for a function.
+        ///
+        /// @param config The config space of the function.
+        /// @param address The address of the function.
+        /// @param memory The address space to map the MSI-X table into.
+        /// @param handlers The handler of each vector, vector @a i is handled by @p handlers[i].
+        /// @param firstCpu The index in @a km::GetCpuIsrTables of the cpu the first vector is routed to.
+        /// @param[out] interrupts The allocated interrupts.
+        ///
+        /// @retval OsStatusSuccess The vectors were allocated and programmed into the device.
+        /// @retval OsStatusNotSupported The function has no MSI or MSI-X capability, or too few messages.
+        /// @retval OsStatusOutOfMemory There were not enough free vectors, or the table could not be mapped.
+        /// @retval OsStatusInvalidInput No handlers, or more than @a kMaxVectors handlers were provided.
+        [[nodiscard]]
+        static OsStatus create(
+            IConfigSpace *config, DeviceBusAddress address, km::AddressSpace& memory,
+            std::span<const km::IsrCallback> handlers, size_t firstCpu,
+            DeviceInterrupts *interrupts [[outparam]]
+        );
+
+        /// @brief Disable message signalled interrupts, release every vector and unmap the MSI-X table.
+        void release();
+
+        InterruptMode mode() const noexcept { return mMode; }
+        uint16_t count() const noexcept { return mCount; }
+        const InterruptVector& vector(uint16_t index) const noexcept { return mVectors[index]; }
+        std::span<const InterruptVector> vectors() const noexcept { return std::span(mVectors, mCount); }
+
+        /// @brief Stop a vector from being delivered, messages are held pending by the device.
+        void mask(uint16_t index) noexcept;
+
+        /// @brief Allow a vector to be delivered.
+        void unmask(uint16_t index) noexcept;
+
+        bool isMasked(uint16_t index) const noexcept;
+
+        /// @brief Route a vector to a different cpu.
+        ///
+        /// The vector is masked while the message is updated.
+        ///
+        /// @param index The vector to move.
+        /// @param cpu The index in @a km::GetCpuIsrTables of the new cpu.
+        ///
+        /// @retval OsStatusSuccess The vector was moved.
+        /// @retval OsStatusOutOfMemory The cpu has no free vectors.
+        /// @retval OsStatusNotSupported The cpu cannot be addressed by a message.
+        [[nodiscard]]
+        OsStatus setAffinity(uint16_t index, size_t cpu);
+    };
+}
@@ -6,6 +6,8 @@
 #include "util/format.hpp"
 #include "common/util/util.hpp"
 
+#include <span>
+
 #include <stdint.h>
 
 namespace pci {
@@ -35,6 +37,15 @@ namespace pci {
 
     UTIL_BITFLAGS(DeviceStatus);
 
+    enum class DeviceCommand : uint16_t {
+        eIoSpace = (1 << 0),
+        eMemorySpace = (1 << 1),
+        eBusMaster = (1 << 2),
+        eInterruptDisable = (1 << 10),
+    };
+
+    UTIL_BITFLAGS(DeviceCommand);
+
     struct DeviceClass {
         DeviceClassCode cls;
         uint8_t subclass;
@@ -46,6 +57,7 @@ namespace pci {
         eNull = 0x00,
         ePowerManagement = 0x01,
         eMsi = 0x05,
+        eVendorSpecific = 0x09,
         ePciExpress = 0x10,
         eMsiX = 0x11,
         eSataConfig = 0x12,
@@ -106,6 +118,37 @@ namespace pci {
     ConfigHeader QueryHeader(IConfigSpace *config, uint8_t bus, uint8_t slot, uint8_t function);
     BridgeConfig QueryBridge(IConfigSpace *config, uint8_t bus, uint8_t slot, uint8_t function);
 
+    /// @brief Find the offset of a capability.
+    ///
+    /// @param config The config space to read from.
+    /// @param address The function to search.
+    /// @param id The capability to search for.
+    /// @param after The offset of a capability to continue searching from, 0 to start from the head of the list.
+    ///
+    /// @return The offset of the capability, or 0 if there are no more matching capabilities.
+    uint8_t FindCapability(IConfigSpace *config, DeviceBusAddress address, CapabilityId id, uint8_t after = 0);
+
+    /// @brief Read the physical address of a memory BAR.
+    ///
+    /// 64-bit BARs consume the following BAR slot for the upper half of the address.
+    ///
+    /// @return The address of the BAR, or an invalid address if the BAR is not a memory BAR.
+    km::PhysicalAddressEx ReadMemoryBar(IConfigSpace *config, DeviceBusAddress address, uint8_t bar);
+
+    /// @brief Set bits in the command register of a function.
+    void EnableCommand(IConfigSpace *config, DeviceBusAddress address, DeviceCommand command);
+
+    /// @brief Find all functions with a matching vendor and device id.
+    ///
+    /// @param config The config space to search.
+    /// @param mcfg The MCFG table, if null all 256 buses are searched.
+    /// @param vendor The vendor to search for.
+    /// @param devices The accepted device ids.
+    /// @param result Receives the addresses of the matching functions.
+    ///
+    /// @return The number of addresses written to @p result.
+    size_t FindDevices(IConfigSpace *config, const acpi::Mcfg *mcfg, VendorId vendor, std::span<const DeviceId> devices, std::span<DeviceBusAddress> result);
+
     void probeConfigSpace(IConfigSpace *config, const acpi::Mcfg *mcfg);
 }
 
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <bezos/status.h>
+
+#include "profile/sample.hpp"
+
+#include "std/vector.hpp"
+
+namespace km {
+    class IApic;
+    class SharedIsrTable;
+    struct IsrContext;
+
+    /// @brief What drives the profiler samples on a cpu.
+    enum class ProfileSource {
+        /// @brief The cpu has no profiler state.
+        eNone,
+
+        /// @brief The fixed function cycle counter overflows into an NMI.
+        ePmu,
+
+        /// @brief The scheduler timer interrupt, used when there is no architectural PMU.
+        eTimer,
+    };
+
+    /// @brief The number of core cycles between PMU samples.
+    static constexpr uint64_t kProfileCyclePeriod = 10'000'000;
+
+    /// @brief The number of samples each cpu can hold before they are drained.
+    static constexpr uint32_t kProfileRingCapacity = 1024;
+
+    /// @brief Install the NMI handler that receives PMU samples.
+    ///
+    /// NMIs that were not raised by a profiler counter are passed to the
+    /// handler that was installed before.
+    void InstallProfilerIsr(SharedIsrTable *ist);
+
+    /// @brief Setup the profiler on the current cpu.
+    ///
+    /// Allocates the sample ring of the cpu and selects the PMU if the cpu
+    /// has an architectural cycle counter. Sampling does not begin until the
+    /// profiler is started.
+    void InitCpuProfiler(IApic *apic);
+
+    /// @brief Called from the scheduler timer interrupt on every cpu.
+    ///
+    /// Takes a sample when the cpu has no PMU, and arms or disarms the PMU
+    /// of the cpu when the profiler is started or stopped.
+    void ProfilerTimerTick(const IsrContext *context) noexcept [[clang::reentrant]];
+
+    /// @brief Start or stop sampling on every cpu.
+    ///
+    /// Each cpu notices the change on its next timer interrupt.
+    void SetProfilerRunning(bool running) noexcept;
+
+    bool IsProfilerRunning() noexcept;
+
+    /// @brief Move every sample out of the per cpu rings.
+    ///
+    /// @param samples The vector to append the samples to.
+    ///
+    /// @retval OsStatusSuccess Every sample was moved.
+    /// @retval OsStatusOutOfMemory The vector could not grow, the remaining samples are left in the rings.
+    OsStatus DrainProfileSamples(stdx::Vector2<ProfileSample>& samples);
+
+    /// @brief The number of samples dropped because a ring was full.
+    uint64_t GetProfileDroppedSamples() noexcept;
+}
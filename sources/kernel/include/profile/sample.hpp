@@ -0,0 +1,124 @@
+#pragma once
+
+#include "util/format.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace km {
+    /// @brief The maximum number of program counters kept for each sample.
+    static constexpr size_t kProfileStackDepth = 16;
+
+    /// @brief A single profiler sample.
+    struct ProfileSample {
+        /// @brief An opaque id for the task that was running, 0 when the cpu was idle.
+        uintptr_t task;
+
+        /// @brief The number of valid entries in @a pcs.
+        uint16_t depth;
+
+        /// @brief Was the cpu running user code when the sample was taken.
+        bool user;
+
+        /// @brief The sampled program counter followed by its callers, innermost first.
+        uintptr_t pcs[kProfileStackDepth];
+    };
+
+    /// @brief Walk a chain of frame pointers without leaving a stack.
+    ///
+    /// Every frame must lie entirely within [@p front, @p back) and each frame
+    /// must be above the last, so a corrupt chain ends the walk rather than
+    /// reading outside the stack. Safe to call from an NMI.
+    ///
+    /// @param rbp The first frame pointer.
+    /// @param front The lowest address of the stack.
+    /// @param back One past the highest address of the stack.
+    /// @param pcs Where to write the return addresses.
+    /// @param limit The maximum number of return addresses to write.
+    ///
+    /// @return The number of return addresses written.
+    inline size_t WalkProfileStack(uintptr_t rbp, uintptr_t front, uintptr_t back, uintptr_t *pcs, size_t limit) noexcept [[clang::reentrant, clang::nonblocking]] {
+        static constexpr size_t kFrameSize = sizeof(uintptr_t) * 2;
+
+        size_t depth = 0;
+        uintptr_t frame = rbp;
+
+        while (depth < limit) {
+            if (frame % alignof(uintptr_t) != 0 || frame < front || back < kFrameSize || frame > back - kFrameSize) {
+                break;
+            }
+
+            const uintptr_t *slots = reinterpret_cast<const uintptr_t*>(frame);
+            uintptr_t next = slots[0];
+            uintptr_t pc = slots[1];
+
+            if (pc == 0) {
+                break;
+            }
+
+            pcs[depth++] = pc;
+
+            if (next <= frame) {
+                break;
+            }
+
+            frame = next;
+        }
+
+        return depth;
+    }
+
+    namespace detail {
+        inline bool ProfileSampleLess(const ProfileSample& lhs, const ProfileSample& rhs) noexcept {
+            if (lhs.task != rhs.task) return lhs.task < rhs.task;
+            if (lhs.user != rhs.user) return lhs.user < rhs.user;
+            return std::lexicographical_compare(lhs.pcs, lhs.pcs + lhs.depth, rhs.pcs, rhs.pcs + rhs.depth);
+        }
+
+        inline bool ProfileSampleEqual(const ProfileSample& lhs, const ProfileSample& rhs) noexcept {
+            return lhs.task == rhs.task
+                && lhs.user == rhs.user
+                && std::equal(lhs.pcs, lhs.pcs + lhs.depth, rhs.pcs, rhs.pcs + rhs.depth);
+        }
+    }
+
+    /// @brief Write samples in the folded stack format used by flame graph tools.
+    ///
+    /// Each distinct stack is written once as a line of frames from the
+    /// outermost caller to the sampled program counter, separated by ';' and
+    /// followed by the number of samples. The first frame is the task, kernel
+    /// frames have the '_[k]' suffix.
+    ///
+    /// @param samples The samples to write, sorted in place.
+    /// @param out The stream to write to.
+    inline void WriteFoldedStacks(std::span<ProfileSample> samples, IOutStream& out) {
+        std::sort(samples.begin(), samples.end(), detail::ProfileSampleLess);
+
+        for (size_t i = 0; i < samples.size();) {
+            const ProfileSample& sample = samples[i];
+
+            size_t count = 1;
+            while (i + count < samples.size() && detail::ProfileSampleEqual(sample, samples[i + count])) {
+                count += 1;
+            }
+
+            if (sample.task == 0) {
+                out.write("idle");
+            } else {
+                out.format("task-", Hex(sample.task));
+            }
+
+            for (size_t frame = sample.depth; frame > 0; frame--) {
+                out.format(";", Hex(sample.pcs[frame - 1]));
+                if (!sample.user) {
+                    out.write("_[k]");
+                }
+            }
+
+            out.format(" ", count, "\n");
+            i += count;
+        }
+    }
+}
@@ -8,11 +8,18 @@
 
 #include "panic.hpp"
 
+#include <bit>
 #include <functional>
+#include <ranges>
+#include <type_traits>
 
 #include <limits.h>
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#   include <immintrin.h>
+#endif
+
 namespace sm::detail {
     enum class InsertResult {
         eSuccess,
@@ -81,6 +88,114 @@ namespace sm::detail {
     static constexpr bool kTreeDebug = false;
     static constexpr size_t kTargetNodeSize = sm::kilobytes(1).bytes();
 
+    /// @brief Keys that are searched with branchless comparisons rather than @a std::lower_bound.
+    ///
+    /// Comparing these is cheap enough that a mispredicted branch costs more than
+    /// the comparison, so node searches trade branches for conditional moves.
+    template<typename T>
+    concept BranchlessSearchKey = std::is_integral_v<T> || std::is_enum_v<T>;
+
+    /// @brief Once a search has narrowed to this many keys the remainder is counted linearly.
+    static constexpr size_t kLinearSearchWindow = 16;
+
+    /// @brief Count the keys below @p key, or at or below @p key if @p kOrEqual.
+    ///
+    /// @pre @p keys is sorted.
+    template<bool kOrEqual, typename Key>
+    size_t CountKeysBelowScalar(const Key *keys, size_t count, const Key& key) noexcept {
+        size_t result = 0;
+        for (size_t i = 0; i < count; i++) {
+            if constexpr (kOrEqual) {
+                result += !(key < keys[i]);
+            } else {
+                result += (keys[i] < key);
+            }
+        }
+
+        return result;
+    }
+
+#if defined(__SSE2__)
+    template<typename Key>
+    concept SimdSearchKey = std::is_integral_v<Key> && sizeof(Key) == sizeof(uint32_t);
+
+    template<bool kOrEqual, SimdSearchKey Key>
+    size_t CountKeysBelowSimd(const Key *keys, size_t count, Key key) noexcept {
+        // There is only a signed compare, flipping the sign bit orders unsigned keys correctly.
+        constexpr uint32_t kBias = std::is_signed_v<Key> ? 0 : 0x8000'0000;
+
+        size_t result = 0;
+        size_t i = 0;
+
+#if defined(__AVX2__)
+        const __m256i bias256 = _mm256_set1_epi32(int(kBias));
+        const __m256i needle256 = _mm256_set1_epi32(int(uint32_t(key) ^ kBias));
+        for (; i + 8 <= count; i += 8) {
+            __m256i lane = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), bias256);
+            __m256i mask = kOrEqual ? _mm256_cmpgt_epi32(lane, needle256) : _mm256_cmpgt_epi32(needle256, lane);
+            unsigned bits = unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+            result += kOrEqual ? 8 - std::popcount(bits) : std::popcount(bits);
+        }
+#endif
+
+        const __m128i bias = _mm_set1_epi32(int(kBias));
+        const __m128i needle = _mm_set1_epi32(int(uint32_t(key) ^ kBias));
+        for (; i + 4 <= count; i += 4) {
+            __m128i lane = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias);
+            __m128i mask = kOrEqual ? _mm_cmpgt_epi32(lane, needle) : _mm_cmpgt_epi32(needle, lane);
+            unsigned bits = unsigned(_mm_movemask_ps(_mm_castsi128_ps(mask)));
+            result += kOrEqual ? 4 - std::popcount(bits) : std::popcount(bits);
+        }
+
+        return result + CountKeysBelowScalar<kOrEqual>(keys + i, count - i, key);
+    }
+#endif
+
+    template<bool kOrEqual, typename Key>
+    size_t CountKeysBelow(const Key *keys, size_t count, const Key& key) noexcept {
+#if defined(__SSE2__)
+        if constexpr (SimdSearchKey<Key>) {
+            return CountKeysBelowSimd<kOrEqual>(keys, count, key);
+        }
+#endif
+
+        return CountKeysBelowScalar<kOrEqual>(keys, count, key);
+    }
+
+    /// @brief Branchless bisection over a sorted array of keys.
+    ///
+    /// Each step halves the window with a conditional move instead of a branch, once
+    /// the window is small enough the remaining keys are counted directly. The count
+    /// is vectorized when SSE2 is available, kernel builds use the scalar path.
+    ///
+    /// @tparam kOrEqual Find the upper bound rather than the lower bound.
+    ///
+    /// @return The index of the first key not below @p key, or above @p key if @p kOrEqual.
+    template<bool kOrEqual, typename Key>
+    size_t BranchlessBound(const Key *keys, size_t count, const Key& key) noexcept {
+        const Key *base = keys;
+        size_t n = count;
+        while (n > kLinearSearchWindow) {
+            size_t half = n / 2;
+            const Key& pivot = base[half - 1];
+            bool below = kOrEqual ? !(key < pivot) : (pivot < key);
+            base += below ? half : 0;
+            n -= half;
+        }
+
+        return (base - keys) + CountKeysBelow<kOrEqual>(base, n, key);
+    }
+
+    template<typename Key>
+    size_t BranchlessLowerBound(const Key *keys, size_t count, const Key& key) noexcept {
+        return BranchlessBound<false>(keys, count, key);
+    }
+
+    template<typename Key>
+    size_t BranchlessUpperBound(const Key *keys, size_t count, const Key& key) noexcept {
+        return BranchlessBound<true>(keys, count, key);
+    }
+
     template<typename Key, typename Value>
     struct BTreeMapCommon {
         struct Entry {
@@ -239,15 +354,23 @@ namespace sm::detail {
             }
 
             size_t upperBound(const Key& k) const noexcept {
-                auto keySet = keys();
-                auto it = std::upper_bound(keySet.begin(), keySet.end(), k);
-                return std::distance(keySet.begin(), it);
+                if constexpr (BranchlessSearchKey<Key>) {
+                    return BranchlessUpperBound(mKeys, count(), k);
+                } else {
+                    auto keySet = keys();
+                    auto it = std::upper_bound(keySet.begin(), keySet.end(), k);
+                    return std::distance(keySet.begin(), it);
+                }
             }
 
             size_t lowerBound(const Key& k) const noexcept {
-                auto keySet = keys();
-                auto it = std::lower_bound(keySet.begin(), keySet.end(), k);
-                return std::distance(keySet.begin(), it);
+                if constexpr (BranchlessSearchKey<Key>) {
+                    return BranchlessLowerBound(mKeys, count(), k);
+                } else {
+                    auto keySet = keys();
+                    auto it = std::lower_bound(keySet.begin(), keySet.end(), k);
+                    return std::distance(keySet.begin(), it);
+                }
             }
 
             size_t indexOfScan(const Key& k) const noexcept {
@@ -1917,6 +2040,91 @@ namespace sm {
             }
         }
 
+        template<typename T>
+        T *allocateArray(size_t count) noexcept {
+            return static_cast<T*>(mAllocator.allocateAligned(sizeof(T) * count, alignof(T)));
+        }
+
+        template<typename T>
+        void releaseArray(T *array, size_t count) noexcept {
+            if (array != nullptr) {
+                mAllocator.deallocate(static_cast<void*>(array), sizeof(T) * count);
+            }
+        }
+
+        void releaseEntries(Entry *entries, size_t count) noexcept {
+            if (entries != nullptr) {
+                std::destroy_n(entries, count);
+                releaseArray(entries, count);
+            }
+        }
+
+        void destroyNodes(LeafNode **nodes, size_t count) noexcept {
+            for (size_t i = 0; i < count; i++) {
+                destroyNode(nodes[i]);
+            }
+        }
+
+        /// @brief The number of nodes needed to hold @p count keys in a packed level.
+        ///
+        /// Each node but the last donates a separator to the level above.
+        static constexpr size_t bulkLevelWidth(size_t count) noexcept {
+            return (count + LeafNode::kOrder + 1) / (LeafNode::kOrder + 1);
+        }
+
+        /// @brief The number of keys that go into node @p index of a packed level.
+        ///
+        /// Keys are spread evenly so every node is within one key of its siblings,
+        /// which keeps the last node above the minimum fill.
+        static constexpr size_t bulkNodeCount(size_t index, size_t width, size_t count) noexcept {
+            size_t items = count - (width - 1);
+            return (items / width) + (index < (items % width) ? 1 : 0);
+        }
+
+        /// @brief Build a level of internal nodes over the level below it.
+        ///
+        /// Consumes @p separators and @p children, the new level and its own separators
+        /// are written back into them. On failure every node in both levels is released.
+        ///
+        /// @param separators The separator entries between each of @p children.
+        /// @param children The nodes of the level below.
+        /// @param width The number of nodes in @p children, updated to the width of the new level.
+        OsStatus bulkLoadLevel(Entry *separators, LeafNode **children, size_t *width) noexcept {
+            size_t count = *width - 1;
+            size_t newWidth = bulkLevelWidth(count);
+            size_t entry = 0;
+            size_t child = 0;
+
+            for (size_t i = 0; i < newWidth; i++) {
+                InternalNode *node = allocateNode<InternalNode>(nullptr);
+                if (node == nullptr) {
+                    destroyNodes(children, i);
+                    destroyNodes(children + child, *width - child);
+                    return OsStatusOutOfMemory;
+                }
+
+                size_t n = bulkNodeCount(i, newWidth, count);
+                node->setCount(n);
+                for (size_t j = 0; j < n; j++) {
+                    node->emplace(j, separators[entry++]);
+                    node->takeChild(j, children[child++]);
+                }
+
+                node->takeChild(n, children[child++]);
+
+                // Both cursors are always ahead of the write position, so the
+                // new level can be written over the old one.
+                if (i + 1 < newWidth) {
+                    separators[i] = separators[entry++];
+                }
+
+                children[i] = node;
+            }
+
+            *width = newWidth;
+            return OsStatusSuccess;
+        }
+
     public:
         using Iterator = MutIterator;
 
@@ -1970,6 +2178,98 @@ namespace sm {
             return insertInto(mRootNode, Entry{key, value}, tracker);
         }
 
+        /// @brief Replace the contents of the map with a sorted sequence of entries.
+        ///
+        /// Builds the tree bottom up in linear time, every node is packed to within one
+        /// entry of its siblings. The existing contents are only released once the new
+        /// tree has been built, if this fails the map is left unchanged.
+        ///
+        /// @param entries The entries to load, each element must destructure to a key and value.
+        ///
+        /// @return The result of the operation.
+        /// @retval OsStatusSuccess The map now contains @p entries.
+        /// @retval OsStatusInvalidInput The keys are not in strictly ascending order.
+        /// @retval OsStatusOutOfMemory Not enough memory to allocate the tree.
+        template<std::ranges::forward_range R> requires (std::ranges::sized_range<R>)
+        [[nodiscard]]
+        OsStatus bulkLoad(R&& entries) noexcept {
+            size_t count = std::ranges::size(entries);
+
+            if (count > 1) {
+                auto prev = std::ranges::begin(entries);
+                for (auto it = std::next(prev); it != std::ranges::end(entries); prev = it++) {
+                    const auto& [lhs, _0] = *prev;
+                    const auto& [rhs, _1] = *it;
+                    if (!mCompare(lhs, rhs)) {
+                        return OsStatusInvalidInput;
+                    }
+                }
+            }
+
+            if (count == 0) {
+                clear();
+                return OsStatusSuccess;
+            }
+
+            size_t width = bulkLevelWidth(count);
+            Entry *separators = nullptr;
+            LeafNode **nodes = allocateArray<LeafNode*>(width);
+            if (nodes == nullptr) {
+                return OsStatusOutOfMemory;
+            }
+
+            if (width > 1) {
+                separators = allocateArray<Entry>(width - 1);
+                if (separators == nullptr) {
+                    releaseArray(nodes, width);
+                    return OsStatusOutOfMemory;
+                }
+            }
+
+            size_t capacity = width;
+            auto it = std::ranges::begin(entries);
+
+            for (size_t i = 0; i < width; i++) {
+                LeafNode *leaf = allocateNode<LeafNode>(nullptr);
+                if (leaf == nullptr) {
+                    destroyNodes(nodes, i);
+                    std::destroy_n(separators, i);
+                    releaseArray(separators, capacity - 1);
+                    releaseArray(nodes, capacity);
+                    return OsStatusOutOfMemory;
+                }
+
+                size_t n = bulkNodeCount(i, width, count);
+                leaf->setCount(n);
+                for (size_t j = 0; j < n; j++, ++it) {
+                    const auto& [key, value] = *it;
+                    leaf->emplace(j, Entry{key, value});
+                }
+
+                if (i + 1 < width) {
+                    const auto& [key, value] = *it++;
+                    new (&separators[i]) Entry{key, value};
+                }
+
+                nodes[i] = leaf;
+            }
+
+            while (width > 1) {
+                if (OsStatus status = bulkLoadLevel(separators, nodes, &width)) {
+                    releaseEntries(separators, capacity - 1);
+                    releaseArray(nodes, capacity);
+                    return status;
+                }
+            }
+
+            clear();
+            mRootNode = nodes[0];
+
+            releaseEntries(separators, capacity - 1);
+            releaseArray(nodes, capacity);
+            return OsStatusSuccess;
+        }
+
         void remove(const Key& key) noexcept {
             erase(find(key));
         }
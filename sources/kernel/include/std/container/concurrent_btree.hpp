@@ -0,0 +1,574 @@
+#pragma once
+
+#include "std/container/btree.hpp"
+#include "std/optimistic_lock.hpp"
+
+#include <atomic>
+
+namespace sm {
+    /// @brief A B+tree that supports concurrent readers and writers.
+    ///
+    /// Lookups take no locks, they read each node optimistically and validate its
+    /// version before moving on. Writers lock only the leaf they modify, and the
+    /// parent of a node they split. Full inner nodes are split on the way down so
+    /// a split never has to propagate back up the tree.
+    ///
+    /// Nodes are never merged or freed while the map is shared, erasing leaves the
+    /// emptied slots in place. This keeps every pointer a reader has validated safe
+    /// to dereference without any deferred reclamation.
+    ///
+    /// Readers may copy out keys and values while a writer is modifying them,
+    /// the copy is discarded if the node changed, so both must be trivially copyable.
+    ///
+    /// @tparam Key The key type.
+    /// @tparam Value The value type.
+    /// @tparam Allocator The allocator for tree nodes, must be safe to call from any thread.
+    template<
+        typename Key,
+        typename Value,
+        mem::Allocator Allocator = mem::GenericAllocator
+    >
+    class ConcurrentBTreeMap {
+        static_assert(std::is_trivially_copyable_v<Key>, "Keys are read optimistically and must be trivially copyable");
+        static_assert(std::is_trivially_copyable_v<Value>, "Values are read optimistically and must be trivially copyable");
+
+        struct NodeHeader {
+            detail::OptimisticLock lock;
+
+            /// @brief Written only under the lock, readers must clamp it before indexing.
+            uint32_t count;
+
+            const bool isLeaf;
+
+            NodeHeader(bool leaf) noexcept
+                : count(0)
+                , isLeaf(leaf)
+            { }
+        };
+
+        static constexpr size_t kTargetNodeSize = detail::kTargetNodeSize;
+
+        static size_t search(const Key *keys, size_t count, const Key& key) noexcept {
+            if constexpr (detail::BranchlessSearchKey<Key>) {
+                return detail::BranchlessLowerBound(keys, count, key);
+            } else {
+                return std::distance(keys, std::lower_bound(keys, keys + count, key));
+            }
+        }
+
+        struct LeafNode : NodeHeader {
+            static constexpr size_t kCapacity = std::max(3zu, (kTargetNodeSize - sizeof(NodeHeader)) / (sizeof(Key) + sizeof(Value)));
+
+            Key keys[kCapacity];
+            Value values[kCapacity];
+
+            LeafNode() noexcept
+                : NodeHeader(true)
+            { }
+
+            size_t size() const noexcept {
+                return std::min<size_t>(this->count, kCapacity);
+            }
+
+            bool isFull() const noexcept {
+                return this->count >= kCapacity;
+            }
+
+            size_t lowerBound(const Key& key) const noexcept {
+                return search(keys, size(), key);
+            }
+
+            void insert(size_t index, const Key& key, const Value& value) noexcept {
+                size_t n = this->count;
+                std::move_backward(keys + index, keys + n, keys + n + 1);
+                std::move_backward(values + index, values + n, values + n + 1);
+                keys[index] = key;
+                values[index] = value;
+                this->count = n + 1;
+            }
+
+            void remove(size_t index) noexcept {
+                size_t n = this->count;
+                std::move(keys + index + 1, keys + n, keys + index);
+                std::move(values + index + 1, values + n, values + index);
+                this->count = n - 1;
+            }
+
+            /// @brief Move the upper half of this node into @p other.
+            ///
+            /// @return The separator, the largest key remaining in this node.
+            Key splitInto(LeafNode *other) noexcept {
+                size_t n = this->count;
+                size_t mid = n / 2;
+                std::copy(keys + mid, keys + n, other->keys);
+                std::copy(values + mid, values + n, other->values);
+                other->count = n - mid;
+                this->count = mid;
+                return keys[mid - 1];
+            }
+        };
+
+        struct InnerNode : NodeHeader {
+            static constexpr size_t kCapacity = std::max(3zu, (kTargetNodeSize - sizeof(NodeHeader) - sizeof(NodeHeader*)) / (sizeof(Key) + sizeof(NodeHeader*)));
+
+            /// @brief Every key in children[i] is less than or equal to keys[i].
+            Key keys[kCapacity];
+            NodeHeader *children[kCapacity + 1];
+
+            InnerNode() noexcept
+                : NodeHeader(false)
+            { }
+
+            size_t size() const noexcept {
+                return std::min<size_t>(this->count, kCapacity);
+            }
+
+            bool isFull() const noexcept {
+                return this->count >= kCapacity;
+            }
+
+            NodeHeader *childOf(const Key& key) const noexcept {
+                return children[search(keys, size(), key)];
+            }
+
+            /// @brief Insert a separator and the node to its right, after @p key splits.
+            void insert(const Key& key, NodeHeader *child) noexcept {
+                size_t n = this->count;
+                size_t index = search(keys, n, key);
+                std::move_backward(keys + index, keys + n, keys + n + 1);
+                std::move_backward(children + index + 1, children + n + 1, children + n + 2);
+                keys[index] = key;
+                children[index + 1] = child;
+                this->count = n + 1;
+            }
+
+            /// @brief Move the upper half of this node into @p other.
+            ///
+            /// @return The separator that is promoted to the parent.
+            Key splitInto(InnerNode *other) noexcept {
+                size_t n = this->count;
+                size_t mid = n / 2;
+                std::copy(keys + mid + 1, keys + n, other->keys);
+                std::copy(children + mid + 1, children + n + 1, other->children);
+                other->count = n - mid - 1;
+                this->count = mid;
+                return keys[mid];
+            }
+        };
+
+        [[no_unique_address]] Allocator mAllocator;
+        std::atomic<NodeHeader*> mRootNode;
+
+        template<typename T>
+        T *allocateNode() noexcept {
+            void *ptr = mAllocator.allocateAligned(sizeof(T), alignof(T));
+            if (ptr == nullptr) {
+                return nullptr;
+            }
+
+            return new (ptr) T();
+        }
+
+        void releaseNode(NodeHeader *node) noexcept {
+            if (node->isLeaf) {
+                LeafNode *leaf = static_cast<LeafNode*>(node);
+                std::destroy_at(leaf);
+                mAllocator.deallocate(static_cast<void*>(leaf), sizeof(LeafNode));
+            } else {
+                InnerNode *inner = static_cast<InnerNode*>(node);
+                std::destroy_at(inner);
+                mAllocator.deallocate(static_cast<void*>(inner), sizeof(InnerNode));
+            }
+        }
+
+        void destroyNode(NodeHeader *node) noexcept {
+            if (!node->isLeaf) {
+                InnerNode *inner = static_cast<InnerNode*>(node);
+                for (size_t i = 0; i < inner->count + 1; i++) {
+                    destroyNode(inner->children[i]);
+                }
+            }
+
+            releaseNode(node);
+        }
+
+        /// @brief Result of a single attempt at an operation.
+        enum class Attempt {
+            eDone,
+            eRestart,
+        };
+
+        /// @brief Split @p node, which the caller has write locked along with @p parent.
+        ///
+        /// If @p parent is null @p node must be the root, and a new root is installed above it.
+        OsStatus splitNode(NodeHeader *node, InnerNode *parent) noexcept {
+            InnerNode *root = nullptr;
+            if (parent == nullptr) {
+                root = allocateNode<InnerNode>();
+                if (root == nullptr) {
+                    return OsStatusOutOfMemory;
+                }
+            }
+
+            NodeHeader *sibling = nullptr;
+            Key separator{};
+            if (node->isLeaf) {
+                LeafNode *other = allocateNode<LeafNode>();
+                if (other != nullptr) {
+                    separator = static_cast<LeafNode*>(node)->splitInto(other);
+                }
+                sibling = other;
+            } else {
+                InnerNode *other = allocateNode<InnerNode>();
+                if (other != nullptr) {
+                    separator = static_cast<InnerNode*>(node)->splitInto(other);
+                }
+                sibling = other;
+            }
+
+            if (sibling == nullptr) {
+                if (root != nullptr) {
+                    releaseNode(root);
+                }
+
+                return OsStatusOutOfMemory;
+            }
+
+            if (parent != nullptr) {
+                parent->insert(separator, sibling);
+            } else {
+                root->count = 1;
+                root->keys[0] = separator;
+                root->children[0] = node;
+                root->children[1] = sibling;
+                mRootNode.store(root, std::memory_order_release);
+            }
+
+            return OsStatusSuccess;
+        }
+
+        /// @brief Lock @p node and its parent and split it.
+        ///
+        /// @return eRestart in every case where the split was attempted, the tree has changed shape.
+        Attempt trySplit(NodeHeader *node, uint64_t version, InnerNode *parent, uint64_t parentVersion, OsStatus *status [[outparam]]) noexcept {
+            if (parent != nullptr && !parent->lock.upgrade(parentVersion)) {
+                return Attempt::eRestart;
+            }
+
+            if (!node->lock.upgrade(version)) {
+                if (parent != nullptr) {
+                    parent->lock.unlock();
+                }
+
+                return Attempt::eRestart;
+            }
+
+            // another writer may have split the root since it was read
+            if (parent == nullptr && node != mRootNode.load(std::memory_order_relaxed)) {
+                node->lock.unlock();
+                return Attempt::eRestart;
+            }
+
+            *status = splitNode(node, parent);
+
+            node->lock.unlock();
+            if (parent != nullptr) {
+                parent->lock.unlock();
+            }
+
+            return (*status == OsStatusSuccess) ? Attempt::eRestart : Attempt::eDone;
+        }
+
+        /// @brief Descend optimistically to the leaf that owns @p key.
+        ///
+        /// Full inner nodes along the way are split, and the descent restarts.
+        Attempt descend(const Key& key, bool splitFull, LeafNode **leaf, uint64_t *leafVersion, InnerNode **parentNode, uint64_t *parentVersion, OsStatus *status) noexcept {
+            NodeHeader *node = mRootNode.load(std::memory_order_acquire);
+            uint64_t version;
+            if (!node->lock.readLock(&version)) {
+                return Attempt::eRestart;
+            }
+
+            if (node != mRootNode.load(std::memory_order_acquire)) {
+                return Attempt::eRestart;
+            }
+
+            InnerNode *parent = nullptr;
+            uint64_t versionOfParent = 0;
+
+            while (!node->isLeaf) {
+                InnerNode *inner = static_cast<InnerNode*>(node);
+
+                if (splitFull && inner->isFull()) {
+                    return trySplit(inner, version, parent, versionOfParent, status);
+                }
+
+                if (parent != nullptr && !parent->lock.validate(versionOfParent)) {
+                    return Attempt::eRestart;
+                }
+
+                parent = inner;
+                versionOfParent = version;
+
+                node = inner->childOf(key);
+
+                // the child pointer may be torn until the parent is validated
+                if (!inner->lock.validate(version)) {
+                    return Attempt::eRestart;
+                }
+
+                if (!node->lock.readLock(&version)) {
+                    return Attempt::eRestart;
+                }
+            }
+
+            *leaf = static_cast<LeafNode*>(node);
+            *leafVersion = version;
+            *parentNode = parent;
+            *parentVersion = versionOfParent;
+            return Attempt::eDone;
+        }
+
+        Attempt tryFind(const Key& key, Value *value, bool *found) const noexcept {
+            ConcurrentBTreeMap *self = const_cast<ConcurrentBTreeMap*>(this);
+            LeafNode *leaf;
+            InnerNode *parent;
+            uint64_t version, parentVersion;
+            if (self->descend(key, false, &leaf, &version, &parent, &parentVersion, nullptr) == Attempt::eRestart) {
+                return Attempt::eRestart;
+            }
+
+            size_t index = leaf->lowerBound(key);
+            bool match = index < leaf->size() && leaf->keys[index] == key;
+            Value result{};
+            if (match) {
+                result = leaf->values[index];
+            }
+
+            if (!leaf->lock.validate(version)) {
+                return Attempt::eRestart;
+            }
+
+            // the leaf may have been split after the parent was last validated
+            if (parent != nullptr && !parent->lock.validate(parentVersion)) {
+                return Attempt::eRestart;
+            }
+
+            *found = match;
+            if (match && value != nullptr) {
+                *value = result;
+            }
+
+            return Attempt::eDone;
+        }
+
+        Attempt tryInsert(const Key& key, const Value& value, OsStatus *status) noexcept {
+            LeafNode *leaf;
+            InnerNode *parent;
+            uint64_t version, parentVersion;
+            if (descend(key, true, &leaf, &version, &parent, &parentVersion, status) == Attempt::eRestart) {
+                return Attempt::eRestart;
+            }
+
+            // descend only stops early when a split failed
+            if (*status != OsStatusSuccess) {
+                return Attempt::eDone;
+            }
+
+            if (leaf->isFull()) {
+                return trySplit(leaf, version, parent, parentVersion, status);
+            }
+
+            if (!leaf->lock.upgrade(version)) {
+                return Attempt::eRestart;
+            }
+
+            if (parent != nullptr && !parent->lock.validate(parentVersion)) {
+                leaf->lock.unlock();
+                return Attempt::eRestart;
+            }
+
+            size_t index = leaf->lowerBound(key);
+            if (index < leaf->count && leaf->keys[index] == key) {
+                leaf->values[index] = value;
+            } else {
+                leaf->insert(index, key, value);
+            }
+
+            leaf->lock.unlock();
+            return Attempt::eDone;
+        }
+
+        Attempt tryRemove(const Key& key, bool *removed) noexcept {
+            LeafNode *leaf;
+            InnerNode *parent;
+            uint64_t version, parentVersion;
+            if (descend(key, false, &leaf, &version, &parent, &parentVersion, nullptr) == Attempt::eRestart) {
+                return Attempt::eRestart;
+            }
+
+            if (!leaf->lock.upgrade(version)) {
+                return Attempt::eRestart;
+            }
+
+            if (parent != nullptr && !parent->lock.validate(parentVersion)) {
+                leaf->lock.unlock();
+                return Attempt::eRestart;
+            }
+
+            size_t index = leaf->lowerBound(key);
+            *removed = index < leaf->count && leaf->keys[index] == key;
+            if (*removed) {
+                leaf->remove(index);
+            }
+
+            leaf->lock.unlock();
+            return Attempt::eDone;
+        }
+
+        size_t countNode(const NodeHeader *node) const noexcept {
+            if (node->isLeaf) {
+                return node->count;
+            }
+
+            const InnerNode *inner = static_cast<const InnerNode*>(node);
+            size_t count = 0;
+            for (size_t i = 0; i < inner->count + 1; i++) {
+                count += countNode(inner->children[i]);
+            }
+
+            return count;
+        }
+
+        void validateNode(const NodeHeader *node, const Key *lower, const Key *upper, size_t depth, size_t *leafDepth) const noexcept {
+            if (node->isLeaf) {
+                const LeafNode *leaf = static_cast<const LeafNode*>(node);
+                KM_ASSERT(leaf->count <= LeafNode::kCapacity);
+                KM_ASSERT(std::is_sorted(leaf->keys, leaf->keys + leaf->count));
+                for (size_t i = 0; i < leaf->count; i++) {
+                    KM_ASSERT(lower == nullptr || *lower < leaf->keys[i]);
+                    KM_ASSERT(upper == nullptr || !(*upper < leaf->keys[i]));
+                }
+
+                if (*leafDepth == 0) {
+                    *leafDepth = depth;
+                }
+
+                KM_ASSERT(*leafDepth == depth);
+                return;
+            }
+
+            const InnerNode *inner = static_cast<const InnerNode*>(node);
+            KM_ASSERT(inner->count > 0 && inner->count <= InnerNode::kCapacity);
+            KM_ASSERT(std::is_sorted(inner->keys, inner->keys + inner->count));
+
+            for (size_t i = 0; i < inner->count + 1; i++) {
+                const Key *childLower = (i == 0) ? lower : &inner->keys[i - 1];
+                const Key *childUpper = (i == inner->count) ? upper : &inner->keys[i];
+                validateNode(inner->children[i], childLower, childUpper, depth + 1, leafDepth);
+            }
+        }
+
+        template<typename F>
+        static void retry(F&& attempt) noexcept {
+            while (attempt() == Attempt::eRestart) { }
+        }
+
+    public:
+        static constexpr size_t kLeafCapacity = LeafNode::kCapacity;
+        static constexpr size_t kInnerCapacity = InnerNode::kCapacity;
+
+        UTIL_NOCOPY(ConcurrentBTreeMap);
+        UTIL_NOMOVE(ConcurrentBTreeMap);
+
+        /// @brief Create an empty map.
+        ///
+        /// The map always has a root leaf so that readers never have to handle an empty
+        /// tree, use @a create to handle allocation failure.
+        ///
+        /// @param allocator The allocator for tree nodes.
+        /// @param[out] map The map to initialize.
+        ///
+        /// @return The result of the operation.
+        /// @retval OsStatusSuccess The map was created.
+        /// @retval OsStatusOutOfMemory The root node could not be allocated.
+        [[nodiscard]]
+        static OsStatus create(Allocator allocator, ConcurrentBTreeMap *map [[outparam]]) noexcept {
+            map->mAllocator = std::move(allocator);
+            LeafNode *root = map->template allocateNode<LeafNode>();
+            if (root == nullptr) {
+                return OsStatusOutOfMemory;
+            }
+
+            map->mRootNode.store(root, std::memory_order_release);
+            return OsStatusSuccess;
+        }
+
+        constexpr ConcurrentBTreeMap() noexcept
+            : mAllocator(Allocator{})
+            , mRootNode(nullptr)
+        { }
+
+        ~ConcurrentBTreeMap() noexcept {
+            if (NodeHeader *root = mRootNode.load(std::memory_order_relaxed)) {
+                destroyNode(root);
+            }
+        }
+
+        bool isSetup() const noexcept {
+            return mRootNode.load(std::memory_order_relaxed) != nullptr;
+        }
+
+        /// @brief Insert or update an entry.
+        ///
+        /// @return The result of the operation.
+        /// @retval OsStatusSuccess The entry was inserted or updated.
+        /// @retval OsStatusOutOfMemory A node needed to be split but could not be allocated.
+        [[nodiscard]]
+        OsStatus insert(const Key& key, const Value& value) noexcept {
+            OsStatus status = OsStatusSuccess;
+            retry([&] { return tryInsert(key, value, &status); });
+            return status;
+        }
+
+        /// @brief Remove an entry.
+        ///
+        /// @return If the entry was present.
+        bool remove(const Key& key) noexcept {
+            bool removed = false;
+            retry([&] { return tryRemove(key, &removed); });
+            return removed;
+        }
+
+        /// @brief Find an entry and copy out its value.
+        ///
+        /// @param key The key to search for.
+        /// @param[out] value The value of the entry if it was found.
+        ///
+        /// @return If the entry was found.
+        bool find(const Key& key, Value *value [[outparam]]) const noexcept {
+            bool found = false;
+            retry([&] { return tryFind(key, value, &found); });
+            return found;
+        }
+
+        bool contains(const Key& key) const noexcept {
+            return find(key, nullptr);
+        }
+
+        /// @brief Count the entries in the map.
+        ///
+        /// @pre No other thread is modifying the map.
+        size_t count() const noexcept {
+            return countNode(mRootNode.load(std::memory_order_acquire));
+        }
+
+        /// @brief Check the structure of the tree.
+        ///
+        /// @pre No other thread is modifying the map.
+        void validate() const noexcept {
+            size_t leafDepth = 0;
+            validateNode(mRootNode.load(std::memory_order_acquire), nullptr, nullptr, 1, &leafDepth);
+        }
+    };
+}
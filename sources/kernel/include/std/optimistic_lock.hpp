@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+
+#include <stdint.h>
+
+#include <emmintrin.h>
+
+namespace sm::detail {
+    /// @brief The atomic operations used by @a BasicOptimisticLock.
+    ///
+    /// A model checker substitutes its own atomics here so that it checks
+    /// the same lock the kernel runs rather than a copy of it.
+    struct StdOptimisticAtomics {
+        using Version = std::atomic<uint64_t>;
+
+        static uint64_t load(const Version& version, std::memory_order order) noexcept [[clang::nonblocking]] {
+            return version.load(order);
+        }
+
+        static bool compareExchange(Version& version, uint64_t& expected, uint64_t desired, std::memory_order order) noexcept [[clang::nonblocking]] {
+            return version.compare_exchange_strong(expected, desired, order);
+        }
+
+        static void fetchAdd(Version& version, uint64_t value, std::memory_order order) noexcept [[clang::nonblocking]] {
+            version.fetch_add(value, order);
+        }
+
+        static void fence(std::memory_order order) noexcept [[clang::nonblocking]] {
+            std::atomic_thread_fence(order);
+        }
+
+        static void pause() noexcept [[clang::nonblocking]] {
+            _mm_pause();
+        }
+    };
+
+    /// @brief A node version word for optimistic lock coupling.
+    ///
+    /// The low bit is set while a writer holds the node, every unlock advances the
+    /// version. Readers take no lock, they snapshot the version before reading a
+    /// node and validate that it has not changed once they are done with it.
+    ///
+    /// @cite OptimisticLockCoupling
+    ///
+    /// @tparam Atomics The atomic operations, see @a StdOptimisticAtomics.
+    template<typename Atomics>
+    class BasicOptimisticLock {
+        using Version = typename Atomics::Version;
+
+        static constexpr uint64_t kLockedBit = 0b1;
+
+        Version mVersion{0};
+
+    public:
+        static constexpr bool isLocked(uint64_t version) noexcept {
+            return (version & kLockedBit) != 0;
+        }
+
+        /// @brief Begin an optimistic read of the node.
+        ///
+        /// @param[out] version The version to validate against.
+        ///
+        /// @return If the node is unlocked, otherwise the caller should restart.
+        bool readLock(uint64_t *version [[outparam]]) const noexcept [[clang::nonblocking]] {
+            uint64_t current = Atomics::load(mVersion, std::memory_order_acquire);
+            *version = current;
+            if (isLocked(current)) {
+                Atomics::pause();
+                return false;
+            }
+
+            return true;
+        }
+
+        /// @brief Check that nothing has written to the node since @p version was read.
+        ///
+        /// @return If every read since @a readLock observed a consistent node.
+        bool validate(uint64_t version) const noexcept [[clang::nonblocking]] {
+            // keep the reads of the node before the second read of the version
+            Atomics::fence(std::memory_order_acquire);
+            return Atomics::load(mVersion, std::memory_order_relaxed) == version;
+        }
+
+        /// @brief Upgrade an optimistic read to a write lock.
+        ///
+        /// Fails if any writer has held the node since @p version was read.
+        ///
+        /// @return If the lock was acquired, otherwise the caller should restart.
+        bool upgrade(uint64_t version) noexcept [[clang::nonblocking]] {
+            if (!Atomics::compareExchange(mVersion, version, version | kLockedBit, std::memory_order_acquire)) {
+                Atomics::pause();
+                return false;
+            }
+
+            // readers that observe any write made under the lock must also observe the lock bit
+            Atomics::fence(std::memory_order_release);
+            return true;
+        }
+
+        void unlock() noexcept [[clang::nonblocking]] {
+            Atomics::fetchAdd(mVersion, kLockedBit, std::memory_order_release);
+        }
+    };
+
+    using OptimisticLock = BasicOptimisticLock<StdOptimisticAtomics>;
+}
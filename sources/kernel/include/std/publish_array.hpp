@@ -0,0 +1,66 @@
+#pragma once
+
+#include <bezos/status.h>
+
+#include <atomic>
+#include <span>
+
+#include <emmintrin.h>
+
+namespace stdx {
+    /// @brief A fixed size array that entries are appended to and never removed from.
+    ///
+    /// Used for per cpu state that each cpu registers as it starts and that
+    /// other cpus, or interrupt handlers, walk without taking a lock. Any number
+    /// of cpus may add entries at once, each reserves a slot, writes it, then
+    /// publishes it once every earlier slot has been published. Readers only
+    /// ever see the published prefix, so they never observe a reserved but
+    /// unwritten entry.
+    template<typename T, size_t N>
+    class PublishArray {
+        T mEntries[N]{};
+        std::atomic<size_t> mReserved = 0;
+        std::atomic<size_t> mCount = 0;
+
+    public:
+        constexpr PublishArray() noexcept = default;
+
+        /// @brief Append an entry.
+        ///
+        /// @param entry The entry to append.
+        ///
+        /// @retval OsStatusSuccess The entry was published.
+        /// @retval OsStatusOutOfMemory There is no room for another entry.
+        OsStatus add(const T& entry) noexcept [[clang::nonallocating]] {
+            size_t index = mReserved.fetch_add(1);
+            if (index >= N) {
+                return OsStatusOutOfMemory;
+            }
+
+            mEntries[index] = entry;
+
+            // publish in order so readers never observe a reserved but unwritten entry
+            size_t expected = index;
+            while (!mCount.compare_exchange_weak(expected, index + 1, std::memory_order_release)) {
+                expected = index;
+                _mm_pause();
+            }
+
+            return OsStatusSuccess;
+        }
+
+        /// @brief The number of published entries.
+        size_t count() const noexcept [[clang::reentrant]] {
+            return mCount.load(std::memory_order_acquire);
+        }
+
+        /// @brief Every published entry.
+        std::span<const T> entries() const noexcept [[clang::reentrant]] {
+            return std::span(mEntries, count());
+        }
+
+        static constexpr size_t capacity() noexcept {
+            return N;
+        }
+    };
+}
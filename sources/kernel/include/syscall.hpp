@@ -13,6 +13,7 @@ static constexpr x64::RwModelRegister<0xC0000080> IA32_EFER;
 
 namespace km {
     class SystemMemory;
+    class SyscallStats;
 
     struct [[gnu::packed]] SystemCallRegisterSet {
         // user registers
@@ -88,6 +89,11 @@ namespace km {
 
     void AddSystemCall(uint8_t function, CallHandler handler);
 
+    /// @brief Get the system call counters of every cpu.
+    ///
+    /// @return The counters, or nullptr if they were compiled out.
+    const SyscallStats *GetSyscallStats();
+
     template<typename T> requires (sizeof(T) <= sizeof(uint64_t))
     inline OsCallResult CallOk(T value) {
         return OsCallResult { .Status = OsStatusSuccess, .Value = std::bit_cast<uint64_t>(value) };
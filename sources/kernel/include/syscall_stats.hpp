@@ -0,0 +1,127 @@
+#pragma once
+
+#include <bezos/status.h>
+
+#include "std/publish_array.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef KM_SYSCALL_STATS
+#   define KM_SYSCALL_STATS 1
+#endif
+
+namespace km {
+    static constexpr size_t kSyscallCount = 256;
+
+    /// @brief The number of latency buckets kept for each system call.
+    ///
+    /// Bucket 0 holds calls that took no ticks, bucket n holds calls that took
+    /// [2^(n-1), 2^n) ticks, and the last bucket holds everything longer.
+    static constexpr size_t kSyscallLatencyBuckets = 29;
+
+    /// @brief The maximum number of cpus whose counters are published.
+    static constexpr size_t kMaxSyscallStatsCpus = 256;
+
+    constexpr size_t SyscallLatencyBucket(uint64_t ticks) noexcept [[clang::nonblocking]] {
+        size_t bucket = std::bit_width(ticks);
+        return bucket < kSyscallLatencyBuckets ? bucket : kSyscallLatencyBuckets - 1;
+    }
+
+    /// @brief The system call counters of a single cpu.
+    ///
+    /// Only the owning cpu writes to its counters, and it does so with
+    /// interrupts disabled, so updates are plain loads and stores rather
+    /// than locked instructions. The counters are atomic so that other cpus
+    /// can read them while they are written without tearing.
+    class SyscallCounters {
+        struct alignas(64) Entry {
+            std::atomic<uint64_t> calls;
+            std::atomic<uint64_t> errors;
+            std::atomic<uint64_t> ticks;
+            std::atomic<uint64_t> latency[kSyscallLatencyBuckets];
+        };
+
+        static_assert(sizeof(Entry) == 256);
+
+        static void increment(std::atomic<uint64_t>& counter, uint64_t value) noexcept [[clang::nonblocking]] {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        Entry mEntries[kSyscallCount]{};
+
+        friend class SyscallStats;
+
+    public:
+        /// @brief Record a completed system call.
+        ///
+        /// @pre Called on the owning cpu with interrupts disabled.
+        ///
+        /// @param function The system call number.
+        /// @param status The status the call returned.
+        /// @param ticks The time the call took.
+        void record(uint8_t function, OsStatus status, uint64_t ticks) noexcept [[clang::nonblocking]] {
+            Entry& entry = mEntries[function];
+            increment(entry.calls, 1);
+            increment(entry.errors, (status != OsStatusSuccess) ? 1 : 0);
+            increment(entry.ticks, ticks);
+            increment(entry.latency[SyscallLatencyBucket(ticks)], 1);
+        }
+    };
+
+    /// @brief The counters of a single system call summed over every cpu.
+    struct SyscallSummary {
+        uint64_t calls;
+        uint64_t errors;
+        uint64_t ticks;
+        uint64_t latency[kSyscallLatencyBuckets];
+    };
+
+    /// @brief The per cpu system call counters of every cpu.
+    ///
+    /// Counters are published in the order their cpu was started and are
+    /// never removed.
+    class SyscallStats {
+        stdx::PublishArray<SyscallCounters*, kMaxSyscallStatsCpus> mCpus;
+
+    public:
+        constexpr SyscallStats() = default;
+
+        /// @brief Publish the counters of a cpu.
+        ///
+        /// @param counters The counters to publish.
+        ///
+        /// @retval OsStatusSuccess The counters were published.
+        /// @retval OsStatusOutOfMemory There is no room for the counters of another cpu.
+        OsStatus addCpu(SyscallCounters *counters) noexcept {
+            return mCpus.add(counters);
+        }
+
+        size_t cpuCount() const noexcept {
+            return mCpus.count();
+        }
+
+        /// @brief Sum the counters of a system call over every cpu.
+        ///
+        /// The counters of other cpus may be updated while they are summed,
+        /// so the totals are not a single consistent snapshot.
+        void summary(uint8_t function, SyscallSummary *result [[outparam]]) const noexcept {
+            SyscallSummary summary{};
+
+            for (const SyscallCounters *counters : mCpus.entries()) {
+                const SyscallCounters::Entry& entry = counters->mEntries[function];
+                summary.calls += entry.calls.load(std::memory_order_relaxed);
+                summary.errors += entry.errors.load(std::memory_order_relaxed);
+                summary.ticks += entry.ticks.load(std::memory_order_relaxed);
+
+                for (size_t bucket = 0; bucket < kSyscallLatencyBuckets; bucket++) {
+                    summary.latency[bucket] += entry.latency[bucket].load(std::memory_order_relaxed);
+                }
+            }
+
+            *result = summary;
+        }
+    };
+}
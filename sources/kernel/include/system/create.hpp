@@ -8,6 +8,7 @@
 
 #include "std/rcuptr.hpp"
 #include "std/static_string.hpp"
+#include "task/scheduler_stats.hpp"
 #include "util/absl.hpp"
 #include "util/uuid.hpp"
 
@@ -131,6 +132,7 @@ namespace sys {
         ObjectName name;
         sm::RcuSharedPtr<Process> process;
         OsThreadState state;
+        task::TaskStats scheduler;
     };
 
     // mutex
@@ -110,6 +110,7 @@ namespace sys {
         OsStatus vmemMapProcess(System *system, VmemMapInfo info, sm::RcuSharedPtr<Process> process, km::VirtualRange *result);
         OsStatus vmemMap(System *system, OsVmemMapInfo info, km::AddressMapping *mapping);
         OsStatus vmemRelease(System *system, km::VirtualRange range);
+        OsStatus vmemProtect(System *system, km::VirtualRange range, km::PageFlags flags);
 
         void removeThread(sm::RcuSharedPtr<Thread> thread);
         void addThread(sm::RcuSharedPtr<Thread> thread);
@@ -16,6 +16,7 @@
 
 namespace km {
     class ApicTimer;
+    class NumaTopology;
 }
 
 namespace task {
@@ -164,7 +165,14 @@ namespace sys {
 
     void installSchedulerIsr();
     void setupApScheduler();
-    void setupGlobalScheduler(bool enableSmp, acpi::AcpiTables& rsdt, task::Scheduler *scheduler);
+
+    /// @brief Create a scheduler queue for each processor.
+    ///
+    /// @param enableSmp Create queues for application processors as well as the boot processor.
+    /// @param rsdt The ACPI tables describing the processors.
+    /// @param topology The NUMA topology, used to group queues by node.
+    /// @param scheduler The scheduler to populate.
+    void setupGlobalScheduler(bool enableSmp, acpi::AcpiTables& rsdt, const km::NumaTopology& topology, task::Scheduler *scheduler);
 
     task::SchedulerQueue *getTlsQueue();
     task::Scheduler *getScheduler();
@@ -2,6 +2,7 @@
 
 #include <bezos/handle.h>
 #include <bezos/facility/handle.h>
+#include <bezos/clock_page.h>
 
 #include "std/vector.hpp"
 #include "std/rcuptr.hpp"
@@ -24,6 +25,10 @@ namespace km {
     class AddressSpace;
 }
 
+namespace sys {
+    class AddressSpaceManager;
+}
+
 namespace vfs {
     class VfsRoot;
     class INode;
@@ -50,6 +55,9 @@ namespace sys {
 
         MemoryManager mMemoryManager;
 
+        /// @brief The clock page mapped read only into every process.
+        km::AddressMapping mClockPage;
+
         System() = default;
 
         System(System&& other)
@@ -61,6 +69,7 @@ namespace sys {
             , mObjects(std::move(other.mObjects))
             , mProcessObjects(std::move(other.mProcessObjects))
             , mMemoryManager(std::move(other.mMemoryManager))
+            , mClockPage(other.mClockPage)
         { }
 
     public:
@@ -81,6 +90,23 @@ namespace sys {
 
         km::AddressSpace *pageTables() { return mSystemTables; }
 
+        /// @brief Reserve and map the clock page in a new process.
+        ///
+        /// The page is mapped at @ref OS_CLOCK_PAGE_ADDRESS, which is reserved
+        /// in the address space so it is never handed out for anything else.
+        ///
+        /// @param addressSpace The address space of the process.
+        ///
+        /// @return The status of the operation.
+        OsStatus mapClockPage(AddressSpaceManager& addressSpace);
+
+        /// @brief Publish the clock data to every process.
+        ///
+        /// @pre Called once during boot, before the first process is created.
+        ///
+        /// @param page The clock data.
+        void publishClockPage(const OsClockPage& page);
+
         OsStatus createProcess(ProcessCreateInfo info, ProcessHandle **handle);
         OsStatus createThread(ThreadCreateInfo info, ThreadHandle **handle);
         OsStatus createTx(TxCreateInfo info, TxHandle **handle);
@@ -146,6 +172,7 @@ namespace sys {
     OsStatus SysVmemCreate(InvokeContext *context, OsVmemCreateInfo info, void **outVmem);
     OsStatus SysVmemMap(InvokeContext *context, OsVmemMapInfo info, void **outVmem);
     OsStatus SysVmemRelease(InvokeContext *context, OsAnyPointer base, OsSize size);
+    OsStatus SysVmemProtect(InvokeContext *context, OsAnyPointer base, OsSize size, OsMemoryAccess access);
 
     // thread
 
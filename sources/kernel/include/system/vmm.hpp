@@ -87,6 +87,11 @@ namespace sys {
         OsStatus unmapSegment(MemoryManager *manager, Iterator it, km::VirtualRange range, km::VirtualRange *remaining) [[clang::allocating]] REQUIRES(mLock);
 
         OsStatus splitAtAddress(MemoryManager *manager, sm::VirtualAddress address) [[clang::allocating]] REQUIRES(mLock);
+
+        OsStatus unmapUnlocked(MemoryManager *manager, km::VirtualRange range) [[clang::allocating]] REQUIRES(mLock);
+
+        /// @brief Reserve a fixed range of address space, unmapping anything already mapped there.
+        OsStatus reserveUnlocked(MemoryManager *manager, km::VirtualRange range, km::VmemAllocation *allocation [[outparam]]) [[clang::allocating]] REQUIRES(mLock);
     public:
         UTIL_NOCOPY(AddressSpaceManager);
 
@@ -141,6 +146,32 @@ namespace sys {
         [[nodiscard]]
         OsStatus mapExternal(km::MemoryRange memory, km::PageFlags flags, km::MemoryType type, km::AddressMapping *mapping [[outparam]]) [[clang::allocating]];
 
+        /// @brief Map physical memory that is not managed by the system memory manager at a fixed address.
+        ///
+        /// The memory is never retained or released, the owner of the memory must
+        /// outlive the mapping. Any existing mappings in the range are unmapped first.
+        [[nodiscard]]
+        OsStatus mapExternal(MemoryManager *manager, sm::VirtualAddress address, km::MemoryRange memory, km::PageFlags flags, km::MemoryType type, km::AddressMapping *mapping [[outparam]]) [[clang::allocating]];
+
+        /// @brief Map physical memory that is not managed by the system memory manager, followed by managed memory.
+        ///
+        /// Both parts are mapped as one contiguous range. This maps a file that is
+        /// resident in memory when its last page is shared with other data, @p tail
+        /// is a private copy of that page. @p tail is owned by the address space once
+        /// this succeeds, on failure it is left with the caller.
+        ///
+        /// @param manager The memory manager to use.
+        /// @param address The address to map at, replacing any existing mappings, or null to map anywhere.
+        /// @param memory The external memory to map.
+        /// @param tail The managed memory to map after @p memory.
+        /// @param flags The page flags to use.
+        /// @param type The memory type to use.
+        /// @param[out] result The mapped range.
+        ///
+        /// @return The status of the operation.
+        [[nodiscard]]
+        OsStatus mapExternal(MemoryManager *manager, sm::VirtualAddress address, km::MemoryRange memory, km::MemoryRange tail, km::PageFlags flags, km::MemoryType type, km::VirtualRange *result [[outparam]]) [[clang::allocating]];
+
         /// @brief Allocate virtual memory in this address space and back it with physical memory from the memory manager.
         ///
         /// @param memory The range of physical memory to back the allocation with.
@@ -161,6 +192,19 @@ namespace sys {
         [[nodiscard]]
         OsStatus unmap(MemoryManager *manager, km::VirtualRange range) [[clang::allocating]];
 
+        /// @brief Change the access flags of mapped memory in this address space.
+        ///
+        /// Large pages that are only partially covered by @p range are split into 4k pages.
+        /// The range may span several segments but every page must be mapped by one.
+        ///
+        /// @param range The range to update.
+        /// @param flags The new page flags.
+        ///
+        /// @return The status of the operation.
+        /// @retval OsStatusNotFound Part of @p range is not mapped by this address space.
+        [[nodiscard]]
+        OsStatus protect(km::VirtualRange range, km::PageFlags flags) [[clang::allocating]];
+
         [[nodiscard]]
         OsStatus querySegment(const void *address, detail::AddressSegment *result) noexcept [[clang::nonallocating]];
 
@@ -7,6 +7,7 @@ namespace km {
 namespace task {
     class Scheduler;
     class SchedulerQueue;
+    enum class ScheduleReason;
 
     /// @brief Try to switch to a new task.
     ///
@@ -16,6 +17,7 @@ namespace task {
     /// @param scheduler The scheduler to use for the context switch.
     /// @param queue This cores scheduler queue.
     /// @param isrContext The ISR context to use for the context switch.
+    /// @param reason Why the current task is being switched out.
     /// @return If a new task has been selected, this implies the invoker must switch extra state to setup the new task environment.
-    bool switchCurrentContext(Scheduler *scheduler, task::SchedulerQueue *queue, km::IsrContext *isrContext) noexcept;
+    bool switchCurrentContext(Scheduler *scheduler, task::SchedulerQueue *queue, km::IsrContext *isrContext, ScheduleReason reason) noexcept;
 }
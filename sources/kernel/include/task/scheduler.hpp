@@ -1,6 +1,7 @@
 #pragma once
 
 #include "processor.hpp"
+#include "memory/numa.hpp"
 #include "std/container/btree.hpp"
 #include "task/scheduler_queue.hpp"
 
@@ -43,6 +44,7 @@ namespace task {
     class Scheduler {
         struct QueueInfo {
             SchedulerQueue *queue;
+            km::NumaNodeId node;
         };
 
         sm::BTreeMap<km::CpuCoreId, QueueInfo> mQueues;
@@ -61,11 +63,33 @@ namespace task {
         constexpr Scheduler &operator=(Scheduler&& other) noexcept = delete;
 
         OsStatus addQueue(km::CpuCoreId coreId, SchedulerQueue *queue) noexcept;
+        OsStatus addQueue(km::CpuCoreId coreId, SchedulerQueue *queue, km::NumaNodeId node) noexcept;
+
         OsStatus enqueue(const TaskState &state, SchedulerEntry *entry) noexcept;
+
+        /// @brief Enqueue a task, preferring queues that belong to a NUMA node.
+        ///
+        /// Queues on @p node are tried first so the task runs close to memory allocated
+        /// on its behalf, if they are all full any other queue is used.
+        ///
+        /// @param state The initial state of the task.
+        /// @param entry The task to enqueue.
+        /// @param node The preferred node, or @a km::NumaNodeId::eInvalid for no preference.
+        ///
+        /// @return The result of the operation.
+        OsStatus enqueue(const TaskState &state, SchedulerEntry *entry, km::NumaNodeId node) noexcept;
         SchedulerQueue *getQueue(km::CpuCoreId coreId) noexcept;
 
-        ScheduleResult reschedule(km::CpuCoreId coreId, TaskState *state) noexcept;
-        ScheduleResult reschedule(SchedulerQueue *queue, TaskState *state) noexcept;
+        /// @brief Call @p fn with the core id and queue of every cpu, in core id order.
+        template<typename F>
+        void forEachQueue(F&& fn) noexcept {
+            for (auto taskQueue : mQueues) {
+                fn(taskQueue.first, taskQueue.second.queue);
+            }
+        }
+
+        ScheduleResult reschedule(km::CpuCoreId coreId, TaskState *state, ScheduleReason reason = ScheduleReason::ePreempt) noexcept;
+        ScheduleResult reschedule(SchedulerQueue *queue, TaskState *state, ScheduleReason reason = ScheduleReason::ePreempt) noexcept;
 
         OsStatus sleep(SchedulerEntry *entry, km::os_instant timeout) noexcept;
         OsStatus wait(SchedulerEntry *entry, Mutex *waitable, km::os_instant timeout) noexcept;
@@ -4,6 +4,7 @@
 #include "std/ringbuffer.hpp"
 #include "std/vector.hpp"
 #include "system/create.hpp"
+#include "task/scheduler_stats.hpp"
 
 #include "clock.hpp"
 
@@ -60,6 +61,7 @@ namespace task {
         std::atomic<TaskStatus> mStatus{TaskStatus::eIdle};
         std::atomic<km::os_instant> mSleepUntil{km::os_instant::min()};
         TaskState mState;
+        TaskCounters mCounters;
 
     public:
         constexpr SchedulerEntry() noexcept = default;
@@ -83,6 +85,10 @@ namespace task {
         TaskState& getState() noexcept {
             return mState;
         }
+
+        TaskStats getStats() const noexcept {
+            return mCounters.stats();
+        }
     };
 
     /// @brief What should be done with the result of a scheduling operation.
@@ -94,6 +100,15 @@ namespace task {
         eIdle,
     };
 
+    /// @brief Why the current task is being switched out.
+    enum class ScheduleReason {
+        /// @brief The scheduler interrupt fired, a task that could have kept running is preempted.
+        ePreempt,
+
+        /// @brief The task gave up the cpu itself, this is never counted as a preemption.
+        eYield,
+    };
+
     class SchedulerQueue {
         using EntryQueue = sm::AtomicRingQueue<SchedulerEntry*>;
         EntryQueue mQueue;
@@ -105,7 +120,12 @@ namespace task {
 
         stdx::Vector2<SchedulerEntry*> mSleepingTasks;
 
-        void setCurrentTask(SchedulerEntry *task) noexcept;
+        QueueCounters mCounters;
+
+        void setCurrentTask(SchedulerEntry *task, uint64_t now, ScheduleReason reason) noexcept;
+
+        /// @brief Account for the current task leaving the cpu.
+        void switchOutCurrentTask(uint64_t now, bool preempted) noexcept;
 
         bool takeNextTask(SchedulerEntry **next) noexcept;
 
@@ -145,10 +165,12 @@ namespace task {
         /// @param[in,out] state The old state of the thread, the new state will be written to this if
         ///                      the thread is rescheduled.
         ///
+        /// @param reason Why the current thread is being rescheduled.
+        ///
         /// @return If the thread was rescheduled.
         /// @retval true The thread was rescheduled.
         /// @retval false The thread was not rescheduled, it is still the current thread.
-        ScheduleResult reschedule(TaskState *state [[gnu::nonnull]]) noexcept;
+        ScheduleResult reschedule(TaskState *state [[gnu::nonnull]], ScheduleReason reason = ScheduleReason::ePreempt) noexcept;
 
         /// @brief Enqueue a new task to the scheduler.
         ///
@@ -167,6 +189,11 @@ namespace task {
             return mCurrentTask;
         }
 
+        /// @brief The scheduler statistics of this queue, safe to call from any cpu.
+        QueueStats getStats() const noexcept {
+            return mCounters.stats();
+        }
+
         static OsStatus create(uint32_t capacity, SchedulerQueue *queue [[gnu::nonnull]]) noexcept;
     };
 }
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef KM_SCHEDULER_STATS
+#   define KM_SCHEDULER_STATS 1
+#endif
+
+namespace task {
+    static constexpr bool kEnableSchedulerStats = KM_SCHEDULER_STATS;
+
+    /// @brief The number of buckets in the runnable wait histogram.
+    ///
+    /// Bucket 0 holds tasks that waited no ticks, bucket n holds tasks that
+    /// waited [2^(n-1), 2^n) ticks, and the last bucket holds everything longer.
+    static constexpr size_t kRunQueueWaitBuckets = 32;
+
+    constexpr size_t RunQueueWaitBucket(uint64_t ticks) noexcept [[clang::nonblocking]] {
+        size_t bucket = std::bit_width(ticks);
+        return bucket < kRunQueueWaitBuckets ? bucket : kRunQueueWaitBuckets - 1;
+    }
+
+    /// @brief The timestamp used by the scheduler statistics.
+    inline uint64_t SchedulerTimestamp() noexcept [[clang::nonblocking]] {
+        if constexpr (kEnableSchedulerStats) {
+            return __builtin_ia32_rdtsc();
+        } else {
+            return 0;
+        }
+    }
+
+    namespace detail {
+        // every counter has a single writer at a time, so there is no need for a locked add
+        inline void AddCounter(std::atomic<uint64_t>& counter, uint64_t value) noexcept [[clang::nonblocking]] {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief The scheduler statistics of a single task.
+    struct TaskStats {
+        /// @brief The number of times the task was switched onto a cpu.
+        uint64_t switches;
+
+        /// @brief The number of times the task was switched out while it could still run.
+        uint64_t preemptions;
+
+        /// @brief The total ticks spent running, excluding the current time slice.
+        uint64_t runTicks;
+
+        /// @brief The total ticks spent runnable in a queue waiting for a cpu.
+        uint64_t waitTicks;
+    };
+
+    /// @brief The scheduler counters of a single task.
+    ///
+    /// Only one cpu writes to the counters at a time, the cpu that is
+    /// enqueueing the task or the cpu that is switching it in or out. The
+    /// scheduler queue orders these writes, so updates are relaxed.
+    class TaskCounters {
+        std::atomic<uint64_t> mSwitches{0};
+        std::atomic<uint64_t> mPreemptions{0};
+        std::atomic<uint64_t> mRunTicks{0};
+        std::atomic<uint64_t> mWaitTicks{0};
+
+        std::atomic<uint64_t> mQueuedAt{0};
+        std::atomic<uint64_t> mRunningSince{0};
+
+    public:
+        constexpr TaskCounters() noexcept = default;
+
+        /// @brief The task was made runnable and added to a queue.
+        void queued(uint64_t now) noexcept [[clang::nonblocking]] {
+            if constexpr (kEnableSchedulerStats) {
+                mQueuedAt.store(now, std::memory_order_relaxed);
+            }
+        }
+
+        /// @brief The task was switched onto a cpu.
+        ///
+        /// @return The ticks the task spent waiting in the queue.
+        uint64_t switchIn(uint64_t now) noexcept [[clang::nonblocking]] {
+            if constexpr (!kEnableSchedulerStats) {
+                return 0;
+            }
+
+            uint64_t queuedAt = mQueuedAt.load(std::memory_order_relaxed);
+            uint64_t wait = (now > queuedAt) ? now - queuedAt : 0;
+
+            detail::AddCounter(mSwitches, 1);
+            detail::AddCounter(mWaitTicks, wait);
+            mRunningSince.store(now, std::memory_order_relaxed);
+            return wait;
+        }
+
+        /// @brief The task was switched off a cpu.
+        ///
+        /// @param now The current timestamp.
+        /// @param preempted If the task could have continued running.
+        ///
+        /// @return The ticks the task spent running.
+        uint64_t switchOut(uint64_t now, bool preempted) noexcept [[clang::nonblocking]] {
+            if constexpr (!kEnableSchedulerStats) {
+                return 0;
+            }
+
+            uint64_t since = mRunningSince.load(std::memory_order_relaxed);
+            uint64_t run = (now > since) ? now - since : 0;
+
+            detail::AddCounter(mRunTicks, run);
+            detail::AddCounter(mPreemptions, preempted ? 1 : 0);
+            return run;
+        }
+
+        TaskStats stats() const noexcept {
+            return TaskStats {
+                .switches = mSwitches.load(std::memory_order_relaxed),
+                .preemptions = mPreemptions.load(std::memory_order_relaxed),
+                .runTicks = mRunTicks.load(std::memory_order_relaxed),
+                .waitTicks = mWaitTicks.load(std::memory_order_relaxed),
+            };
+        }
+    };
+
+    /// @brief The scheduler statistics of a single cpu.
+    struct QueueStats {
+        /// @brief The number of times a task was switched onto the cpu.
+        uint64_t switches;
+
+        /// @brief The number of times a runnable task was switched out for another.
+        uint64_t preemptions;
+
+        /// @brief The number of reschedules that left the cpu idle.
+        uint64_t idle;
+
+        /// @brief The total ticks tasks spent running on the cpu.
+        uint64_t runTicks;
+
+        /// @brief The number of times the run queue length was sampled.
+        uint64_t samples;
+
+        /// @brief The sum of every sampled run queue length.
+        uint64_t lengthTotal;
+
+        /// @brief The longest sampled run queue length.
+        uint64_t lengthMax;
+
+        /// @brief A log2 histogram of the ticks tasks waited in the run queue.
+        uint64_t wait[kRunQueueWaitBuckets];
+    };
+
+    /// @brief The scheduler counters of a single cpu.
+    ///
+    /// Only the owning cpu writes to its counters, and it does so from the
+    /// scheduler interrupt, so updates are relaxed loads and stores rather
+    /// than locked instructions. The counters are atomic so that other cpus
+    /// can read them while they are written without tearing.
+    class QueueCounters {
+        std::atomic<uint64_t> mSwitches{0};
+        std::atomic<uint64_t> mPreemptions{0};
+        std::atomic<uint64_t> mIdle{0};
+        std::atomic<uint64_t> mRunTicks{0};
+        std::atomic<uint64_t> mSamples{0};
+        std::atomic<uint64_t> mLengthTotal{0};
+        std::atomic<uint64_t> mLengthMax{0};
+        std::atomic<uint64_t> mWait[kRunQueueWaitBuckets]{};
+
+    public:
+        constexpr QueueCounters() noexcept = default;
+
+        /// @brief Sample the length of the run queue, taken on every reschedule.
+        void sample(uint64_t length) noexcept [[clang::nonblocking]] {
+            if constexpr (kEnableSchedulerStats) {
+                detail::AddCounter(mSamples, 1);
+                detail::AddCounter(mLengthTotal, length);
+                if (length > mLengthMax.load(std::memory_order_relaxed)) {
+                    mLengthMax.store(length, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /// @brief A task was switched onto the cpu after waiting @p wait ticks.
+        void switchIn(uint64_t wait) noexcept [[clang::nonblocking]] {
+            if constexpr (kEnableSchedulerStats) {
+                detail::AddCounter(mSwitches, 1);
+                detail::AddCounter(mWait[RunQueueWaitBucket(wait)], 1);
+            }
+        }
+
+        /// @brief A task was switched off the cpu after running for @p run ticks.
+        void switchOut(uint64_t run, bool preempted) noexcept [[clang::nonblocking]] {
+            if constexpr (kEnableSchedulerStats) {
+                detail::AddCounter(mRunTicks, run);
+                detail::AddCounter(mPreemptions, preempted ? 1 : 0);
+            }
+        }
+
+        /// @brief A reschedule found nothing to run.
+        void idle() noexcept [[clang::nonblocking]] {
+            if constexpr (kEnableSchedulerStats) {
+                detail::AddCounter(mIdle, 1);
+            }
+        }
+
+        /// @brief Read the counters.
+        ///
+        /// The counters may be updated while they are read, so the result is
+        /// not a single consistent snapshot.
+        QueueStats stats() const noexcept {
+            QueueStats result {
+                .switches = mSwitches.load(std::memory_order_relaxed),
+                .preemptions = mPreemptions.load(std::memory_order_relaxed),
+                .idle = mIdle.load(std::memory_order_relaxed),
+                .runTicks = mRunTicks.load(std::memory_order_relaxed),
+                .samples = mSamples.load(std::memory_order_relaxed),
+                .lengthTotal = mLengthTotal.load(std::memory_order_relaxed),
+                .lengthMax = mLengthMax.load(std::memory_order_relaxed),
+            };
+
+            for (size_t i = 0; i < kRunQueueWaitBuckets; i++) {
+                result.wait[i] = mWait[i].load(std::memory_order_relaxed);
+            }
+
+            return result;
+        }
+    };
+}
@@ -2,12 +2,21 @@
 
 #include <bezos/status.h>
 
+#include "isr/signal.hpp"
+#include "std/ringbuffer.hpp"
+#include "std/spinlock.hpp"
 #include "util/format.hpp"
 
+#include <atomic>
+
 #include <stddef.h>
 #include <stdint.h>
 
 namespace km {
+    class IApic;
+    class IoApicSet;
+    class LocalIsrTable;
+
     namespace uart::detail {
         // Offsets from the base serial port
         static constexpr uint16_t kData = 0;
@@ -25,6 +34,23 @@ namespace km {
         // Line status bits
         static constexpr uint8_t kEmptyTransmit = (1 << 5);
         static constexpr uint8_t kDataReady = (1 << 0);
+
+        // Interrupt enable bits
+        static constexpr uint8_t kEnableReceive = (1 << 0);
+        static constexpr uint8_t kEnableTransmit = (1 << 1);
+        static constexpr uint8_t kEnableLineStatus = (1 << 2);
+
+        // Interrupt identification values, read from kFifoControl
+        static constexpr uint8_t kNoInterruptPending = (1 << 0);
+        static constexpr uint8_t kInterruptIdMask = 0b1110;
+        static constexpr uint8_t kModemStatusInterrupt = 0b0000;
+        static constexpr uint8_t kTransmitEmptyInterrupt = 0b0010;
+        static constexpr uint8_t kReceiveInterrupt = 0b0100;
+        static constexpr uint8_t kLineStatusInterrupt = 0b0110;
+        static constexpr uint8_t kReceiveTimeoutInterrupt = 0b1100;
+
+        /// @brief The depth of the 16550 transmit fifo.
+        static constexpr size_t kFifoDepth = 16;
     }
 
     struct ComPortInfo {
@@ -66,6 +92,8 @@ namespace km {
         /// @brief Returns true if the receive buffer has data.
         bool waitForReceive() noexcept [[clang::blocking, clang::nonallocating]];
 
+        friend class BufferedSerialPort;
+
         constexpr SerialPort(ComPortInfo info) noexcept
             : mBasePort(info.port)
             , mIrq(info.irq)
@@ -80,6 +108,31 @@ namespace km {
         size_t write(std::span<const uint8_t> src, unsigned timeout = 100) noexcept [[clang::blocking, clang::nonallocating]];
         size_t read(std::span<uint8_t> dst) noexcept [[clang::blocking, clang::nonallocating]];
 
+        /// @brief Read bytes, waiting for the interrupt handler if nothing has been received.
+        ///
+        /// @param dst The buffer to read into.
+        /// @param expired Returns true once the reader should stop waiting.
+        /// @param yield Gives up the cpu while waiting.
+        ///
+        /// @return The number of bytes read, 0 if @p expired before anything was received or receiving is disabled.
+        template<typename Expired, typename Yield>
+        size_t read(std::span<uint8_t> dst, Expired&& expired, Yield&& yield) [[clang::blocking]] {
+            if (!mRxQueue.isSetup() || dst.empty()) {
+                return 0;
+            }
+
+            while (true) {
+                uint64_t sequence = mRxSignal.sequence();
+                if (size_t count = read(dst)) {
+                    return count;
+                }
+
+                if (!mRxSignal.wait(sequence, expired, yield)) {
+                    return 0;
+                }
+            }
+        }
+
         OsStatus put(uint8_t byte, unsigned timeout = 100) noexcept [[clang::blocking, clang::nonallocating]];
         OsStatus get(uint8_t& byte, unsigned timeout = 100) noexcept [[clang::blocking, clang::nonallocating]];
 
@@ -94,6 +147,142 @@ namespace km {
         static OsStatus create(ComPortInfo info, SerialPort *port [[clang::noescape, gnu::nonnull]]) noexcept [[clang::blocking]];
     };
 
+    /// @brief Counters for a buffered serial port.
+    struct BufferedSerialStats {
+        uint64_t txBytes;
+        uint64_t rxBytes;
+        uint64_t txDropped;
+        uint64_t rxDropped;
+        uint64_t interrupts;
+    };
+
+    /// @brief An interrupt driven serial port.
+    ///
+    /// Writers push into a lock-free transmit ring and return immediately, the
+    /// transmit holding register empty interrupt refills the fifo from the ring.
+    /// Received bytes are drained into a receive ring by the interrupt handler,
+    /// which then notifies any waiting readers.
+    ///
+    /// Writes are never blocking, when the transmit ring is full the remaining
+    /// bytes are dropped and counted.
+    class BufferedSerialPort {
+        SerialPort mPort;
+
+        sm::AtomicRingQueue<uint8_t> mTxQueue;
+        sm::AtomicRingQueue<uint8_t> mRxQueue;
+
+        /// @brief Serializes readers, the receive ring only supports a single consumer.
+        stdx::SpinLock mRxLock;
+
+        /// @brief Raised by the interrupt handler when bytes are pushed into the receive ring.
+        IsrSignal mRxSignal;
+
+        /// @brief Serializes consumers of the transmit ring, the interrupt handler and @a flush.
+        stdx::SpinLock mTxLock;
+
+        /// @brief True while the transmit interrupt is enabled.
+        std::atomic<bool> mTxArmed{false};
+
+        /// @brief The interrupts enabled while there is nothing to transmit.
+        uint8_t mIdleInterrupts = 0;
+
+        std::atomic<uint64_t> mTxBytes{0};
+        std::atomic<uint64_t> mRxBytes{0};
+        std::atomic<uint64_t> mTxDropped{0};
+        std::atomic<uint64_t> mRxDropped{0};
+        std::atomic<uint64_t> mInterrupts{0};
+
+        void setInterruptEnable(uint8_t mask) noexcept [[clang::reentrant, clang::nonblocking]];
+
+        /// @brief Enable the transmit interrupt if it is not already enabled.
+        void kick() noexcept [[clang::reentrant, clang::nonblocking]];
+
+        /// @brief Move pending bytes from the transmit ring into the fifo.
+        void transmit() noexcept [[clang::reentrant, clang::nonblocking]];
+
+        /// @brief Move received bytes from the fifo into the receive ring.
+        void receive() noexcept [[clang::reentrant, clang::nonblocking]];
+
+    public:
+        constexpr BufferedSerialPort() noexcept = default;
+        UTIL_NOCOPY(BufferedSerialPort);
+        UTIL_NOMOVE(BufferedSerialPort);
+
+        bool isReady() const noexcept { return mPort.isReady(); }
+        uint8_t irq() const noexcept { return mPort.irq(); }
+
+        /// @brief Queue bytes for transmission.
+        ///
+        /// @param src The bytes to transmit.
+        ///
+        /// @return The number of bytes queued, less than @p src if the ring is full.
+        size_t write(std::span<const uint8_t> src) noexcept [[clang::reentrant, clang::nonblocking]];
+
+        /// @brief Queue a string for transmission, translating newlines to CRLF.
+        ///
+        /// @return The number of bytes queued.
+        size_t print(stdx::StringView src) noexcept [[clang::reentrant, clang::nonblocking]];
+
+        /// @brief Read bytes that have already been received.
+        ///
+        /// @param dst The buffer to read into.
+        ///
+        /// @return The number of bytes read, 0 if nothing has been received or receiving is disabled.
+        size_t read(std::span<uint8_t> dst) noexcept [[clang::blocking, clang::nonallocating]];
+
+        /// @brief The number of bytes that can be queued without dropping any.
+        size_t writeAvailable() const noexcept [[clang::reentrant, clang::nonblocking]];
+
+        /// @brief The number of received bytes waiting to be read.
+        size_t readAvailable() const noexcept [[clang::reentrant, clang::nonblocking]];
+
+        /// @brief Service a pending interrupt on this port.
+        ///
+        /// @pre Must only be called from the interrupt handler for this port.
+        void handleInterrupt() noexcept [[clang::reentrant, clang::nonblocking]];
+
+        /// @brief Drain the transmit ring by polling the port.
+        ///
+        /// Intended for use when interrupts can no longer be serviced, such as while panicking.
+        /// Waits for an interrupt handler that is transmitting on another cpu to finish, if the
+        /// handler does not finish in time, such as when flushing from inside the handler, the
+        /// remaining bytes are left in the ring.
+        void flush() noexcept [[clang::blocking, clang::nonallocating]];
+
+        BufferedSerialStats stats() const noexcept;
+
+        /// @brief Take ownership of a serial port and switch it to interrupt driven mode.
+        ///
+        /// Only enables the receive interrupt, the transmit interrupt is enabled on demand
+        /// when bytes are written. The irq for the port must be routed by the caller.
+        ///
+        /// @param port The opened serial port.
+        /// @param txCapacity The size of the transmit ring.
+        /// @param rxCapacity The size of the receive ring, 0 for a transmit only port.
+        /// @param[out] result The port to initialize.
+        ///
+        /// @return The result of the operation.
+        /// @retval OsStatusSuccess The port is ready.
+        /// @retval OsStatusInvalidInput The port has not been opened.
+        /// @retval OsStatusOutOfMemory Failed to allocate the rings.
+        [[nodiscard]]
+        static OsStatus create(SerialPort port, uint32_t txCapacity, uint32_t rxCapacity, BufferedSerialPort *result [[outparam]]) noexcept [[clang::allocating]];
+    };
+
+    /// @brief Route a legacy serial irq to a buffered serial port.
+    ///
+    /// @param ioApicSet The ioapics to route the irq through.
+    /// @param irq The legacy irq of the port, @a irq::kCom1 or @a irq::kCom2.
+    /// @param port The port to service, must outlive the handler.
+    /// @param target The apic to deliver the interrupt to.
+    /// @param ist The isr table to allocate the handler in.
+    ///
+    /// @return The result of the operation.
+    /// @retval OsStatusSuccess The handler was installed and the irq routed.
+    /// @retval OsStatusOutOfMemory No free isr or port slots remain.
+    [[nodiscard]]
+    OsStatus InstallSerialIsr(IoApicSet& ioApicSet, uint8_t irq, BufferedSerialPort *port, const IApic *target, LocalIsrTable *ist);
+
     struct OpenSerialResult {
         SerialPort port;
         SerialPortStatus status;
@@ -89,4 +89,5 @@ namespace um {
     OsCallResult VmemCreate(km::System *system, km::CallContext *context, km::SystemCallRegisterSet *regs);
     OsCallResult VmemMap(km::System *system, km::CallContext *context, km::SystemCallRegisterSet *regs);
     OsCallResult VmemDestroy(km::System *system, km::CallContext *context, km::SystemCallRegisterSet *regs);
+    OsCallResult VmemProtect(km::System *system, km::CallContext *context, km::SystemCallRegisterSet *regs);
 }
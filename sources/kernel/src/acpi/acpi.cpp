@@ -144,6 +144,57 @@ static void displayHpet(const acpi::Hpet *hpet) {
     AcpiLog.println("| /SYS/ACPI/HPET     | Page protection             | ", table.pageProtection);
 }
 
+static void displaySrat(const acpi::Srat *srat) {
+    uint32_t index = 0;
+    for (const acpi::SratEntry *entry : *srat) {
+        AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | Entry type                  | ", auto{entry->type});
+
+        switch (entry->type) {
+        case acpi::SratEntryType::eProcessorAffinity: {
+            acpi::SratEntry::ProcessorAffinity processor = entry->processor;
+            AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | APIC ID                     | ", processor.apicId);
+            AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | Proximity domain            | ", processor.domain());
+            AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | Enabled                     | ", processor.isEnabled());
+            break;
+        }
+        case acpi::SratEntryType::eX2ApicAffinity: {
+            acpi::SratEntry::X2ApicAffinity x2apic = entry->x2apic;
+            AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | x2APIC ID                   | ", x2apic.x2apicId);
+            AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | Proximity domain            | ", x2apic.domain);
+            AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | Enabled                     | ", x2apic.isEnabled());
+            break;
+        }
+        case acpi::SratEntryType::eMemoryAffinity: {
+            acpi::SratEntry::MemoryAffinity memory = entry->memory;
+            AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | Memory range                | ", km::MemoryRange::of(km::PhysicalAddress { memory.baseAddress }, memory.length));
+            AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | Proximity domain            | ", memory.domain);
+            AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | Enabled                     | ", memory.isEnabled());
+            AcpiLog.println("| /SYS/ACPI/SRAT/", km::Int(index).pad(3), " | Hot pluggable               | ", memory.isHotPluggable());
+            break;
+        }
+        default:
+            break;
+        }
+
+        index += 1;
+    }
+}
+
+static void displaySlit(const acpi::Slit *slit) {
+    uint64_t count = slit->localityCount;
+    AcpiLog.println("| /SYS/ACPI/SLIT     | Locality count              | ", count);
+
+    for (uint64_t i = 0; i < count; i++) {
+        for (uint64_t j = 0; j < count; j++) {
+            if (!slit->contains(i, j)) {
+                return;
+            }
+
+            AcpiLog.println("| /SYS/ACPI/SLIT/", km::Int(i).pad(3), " | Distance to ", km::Int(j).pad(3), "             | ", slit->distance(i, j));
+        }
+    }
+}
+
 static void PrintRsdtEntry(const acpi::RsdtHeader *entry, sm::PhysicalAddress paddr) {
     acpi::RsdtHeader table = *entry;
 
@@ -169,6 +220,10 @@ static void PrintRsdtEntry(const acpi::RsdtHeader *entry, sm::PhysicalAddress pa
         displayFadt(fadt);
     } else if (auto *hpet = acpi::tableCast<acpi::Hpet>(entry)) {
         displayHpet(hpet);
+    } else if (auto *srat = acpi::tableCast<acpi::Srat>(entry)) {
+        displaySrat(srat);
+    } else if (auto *slit = acpi::tableCast<acpi::Slit>(entry)) {
+        displaySlit(slit);
     }
 }
 
@@ -273,6 +328,8 @@ acpi::AcpiTables::AcpiTables(km::VmemAllocation allocation, const RsdpLocator *l
     , mMadt(nullptr)
     , mMcfg(nullptr)
     , mFadt(nullptr)
+    , mSrat(nullptr)
+    , mSlit(nullptr)
     , mDsdt(nullptr)
 {
     auto setupTables = [&](const auto *locator) {
@@ -289,6 +346,8 @@ acpi::AcpiTables::AcpiTables(km::VmemAllocation allocation, const RsdpLocator *l
             SetUniqueTableEntry(&mMadt, header);
             SetUniqueTableEntry(&mMcfg, header);
             SetUniqueTableEntry(&mFadt, header);
+            SetUniqueTableEntry(&mSrat, header);
+            SetUniqueTableEntry(&mSlit, header);
 
             mRsdtEntries[i] = header;
 
@@ -0,0 +1,69 @@
+#include "acpi/srat.hpp"
+#include "acpi/slit.hpp"
+
+#include "memory/numa.hpp"
+
+OsStatus acpi::ReadNumaTopology(const Srat *srat, const Slit *slit, km::NumaTopology *topology [[outparam]]) {
+    for (const SratEntry *entry : *srat) {
+        switch (entry->type) {
+        case SratEntryType::eProcessorAffinity: {
+            SratEntry::ProcessorAffinity processor = entry->processor;
+            if (!processor.isEnabled()) {
+                break;
+            }
+
+            if (OsStatus status = topology->addCpu(processor.domain(), km::CpuCoreId(processor.apicId))) {
+                return status;
+            }
+
+            break;
+        }
+        case SratEntryType::eX2ApicAffinity: {
+            SratEntry::X2ApicAffinity x2apic = entry->x2apic;
+            if (!x2apic.isEnabled()) {
+                break;
+            }
+
+            if (OsStatus status = topology->addCpu(x2apic.domain, km::CpuCoreId(x2apic.x2apicId))) {
+                return status;
+            }
+
+            break;
+        }
+        case SratEntryType::eMemoryAffinity: {
+            SratEntry::MemoryAffinity memory = entry->memory;
+            if (!memory.isEnabled() || memory.length == 0) {
+                break;
+            }
+
+            km::MemoryRange range = km::MemoryRange::of(km::PhysicalAddress { memory.baseAddress }, memory.length);
+            if (OsStatus status = topology->addMemory(memory.domain, range)) {
+                return status;
+            }
+
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    if (slit == nullptr) {
+        return OsStatusSuccess;
+    }
+
+    for (uint32_t i = 0; i < topology->nodeCount(); i++) {
+        for (uint32_t j = 0; j < topology->nodeCount(); j++) {
+            km::NumaNodeId from = km::NumaNodeId(i);
+            km::NumaNodeId to = km::NumaNodeId(j);
+            uint32_t fromDomain = topology->domainOf(from);
+            uint32_t toDomain = topology->domainOf(to);
+
+            if (slit->contains(fromDomain, toDomain)) {
+                topology->setDistance(from, to, slit->distance(fromDomain, toDomain));
+            }
+        }
+    }
+
+    return OsStatusSuccess;
+}
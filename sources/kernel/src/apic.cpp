@@ -280,6 +280,10 @@ void km::IApic::configure(apic::Ivt ivt, apic::IvtConfig config) {
         entry |= (std::to_underlying(config.timer) << 17);
     }
 
+    if (ivt != apic::Ivt::eTimer) {
+        entry |= (std::to_underlying(config.delivery) << 8);
+    }
+
     write(std::to_underlying(ivt), entry);
 }
 
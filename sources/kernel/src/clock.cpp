@@ -40,12 +40,6 @@ static constexpr km::DateTime InstantToDate(OsInstant instant) {
 }
 #endif
 
-static constexpr OsInstant TimeSinceBoot(km::os_instant bootTime, km::hertz frequency, OsTickCounter bootTicks, OsTickCounter currentTicks) {
-    auto diff = currentTicks - bootTicks;
-    auto nanos = (diff * 1'000'000'0) / frequency;
-    return OsInstant(bootTime.count()) + OsInstant(nanos * si::hertz);
-}
-
 static_assert(DateToInstant(km::DateTime{.day = 15, .month = 10, .year = 1582}) == km::os_instant(0));
 static_assert(DateToInstant(km::DateTime{.day = 16, .month = 10, .year = 1582}) == km::os_instant(1ll * 24 * 60 * 60 * 10000000));
 
@@ -55,6 +49,17 @@ km::Clock::Clock(DateTime start, ITickSource *counter)
     , mStartTicks(counter->ticks())
     , mFrequency(counter->frequency())
 {
+    uint64_t frequency = uint64_t(mFrequency / si::hertz);
+
+    mClockPage = OsClockPage {
+        .Flags = (counter->type() == km::TickSourceType::TSC) ? uint32_t(OS_CLOCK_PAGE_TSC) : 0u,
+        .FrequencyHz = frequency,
+        .BaseTicks = mStartTicks,
+        .BaseTime = mStartDate.count(),
+    };
+
+    OsClockPageScale(frequency, &mClockPage.Multiplier, &mClockPage.Shift);
+
     ClockLog.infof("Boot time: ", start.year, "-", start.month, "-", start.day, "T", start.hour, ":", start.minute, ":", start.second, "Z");
     ClockLog.infof("Boot ticks: ", mStartTicks);
     ClockLog.infof("Frequency: ", mFrequency);
@@ -87,9 +92,7 @@ OsStatus km::Clock::stat(OsClockInfo *result) {
 }
 
 OsStatus km::Clock::time(OsInstant *result) {
-    auto ticks = mCounter->ticks();
-    OsInstant now = TimeSinceBoot(mStartDate, mFrequency, mStartTicks, ticks);
-    *result = now;
+    *result = OsClockPageInstant(&mClockPage, mCounter->ticks());
     return OsStatusSuccess;
 }
 
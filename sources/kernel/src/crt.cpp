@@ -3,43 +3,104 @@
 
 #include "crt.hpp"
 
-static bool HaveEqualAlignment(const void *lhs, const void *rhs, size_t alignment) {
-    return ((uintptr_t)lhs % alignment) == ((uintptr_t)rhs % alignment);
+// Sizes at or above these thresholds use the faster routine, SIZE_MAX disables it.
+// These are written once by KmInitMemoryRoutines before other processors start.
+static constinit size_t gRepMovsbThreshold = SIZE_MAX;
+static constinit size_t gRepStosbThreshold = SIZE_MAX;
+static constinit size_t gNonTemporalThreshold = SIZE_MAX;
+
+// rep movsb only beats a word loop once the microcode startup cost is amortized,
+// fsrm processors have a much cheaper startup.
+static constexpr size_t kErmsThreshold = 2048;
+static constexpr size_t kFsrmThreshold = 128;
+
+// Clears this large are unlikely to be read back soon, bypassing the cache
+// avoids evicting the working set. Page sized to catch page zeroing.
+static constexpr size_t kNonTemporalThreshold = 4096;
+
+// __builtin_memcpy with a constant size lowers to a single unaligned move,
+// even under -fno-builtin.
+static uint64_t Load64(const uint8_t *src) {
+    uint64_t value;
+    __builtin_memcpy(&value, src, sizeof(value));
+    return value;
 }
 
-static void CopySmall(uint8_t *dst, const uint8_t *src, size_t n) {
-    for (size_t i = 0; i < n; i++) {
-        dst[i] = src[i];
-    }
+static void Store64(uint8_t *dst, uint64_t value) {
+    __builtin_memcpy(dst, &value, sizeof(value));
 }
 
-static size_t CopyQword(uint64_t *dst, const uint64_t *src, size_t n) {
-    while (n > sizeof(uint64_t)) {
-        *dst++ = *src++;
-        n -= sizeof(uint64_t);
-    }
+static uint32_t Load32(const uint8_t *src) {
+    uint32_t value;
+    __builtin_memcpy(&value, src, sizeof(value));
+    return value;
+}
 
-    return n;
+static void Store32(uint8_t *dst, uint32_t value) {
+    __builtin_memcpy(dst, &value, sizeof(value));
 }
 
-static void CopyLarge(uint8_t *dst, const uint8_t *src, size_t n) {
-    // copy enough to align the destination to 8 bytes
-    if (size_t head = ((uintptr_t)dst % sizeof(uint64_t))) {
-        size_t offset = sizeof(uint64_t) - head;
-        CopySmall(dst, src, offset);
-        dst += offset;
-        src += offset;
-        n -= offset;
+static void RepMovsb(uint8_t *dst, const uint8_t *src, size_t n) {
+    asm volatile("rep movsb" : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+}
+
+static void RepStosb(uint8_t *dst, uint8_t value, size_t n) {
+    asm volatile("rep stosb" : "+D"(dst), "+c"(n) : "a"(value) : "memory");
+}
+
+static void CopySmall(uint8_t *dst, const uint8_t *src, size_t n) {
+    // overlapping head and tail moves cover every size without a loop
+    if (n >= sizeof(uint64_t)) {
+        uint64_t head = Load64(src);
+        uint64_t tail = Load64(src + n - sizeof(uint64_t));
+        Store64(dst, head);
+        Store64(dst + n - sizeof(uint64_t), tail);
+    } else if (n >= sizeof(uint32_t)) {
+        uint32_t head = Load32(src);
+        uint32_t tail = Load32(src + n - sizeof(uint32_t));
+        Store32(dst, head);
+        Store32(dst + n - sizeof(uint32_t), tail);
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = src[i];
+        }
     }
+}
 
-    // copy 8 bytes at a time
-    size_t remaining = CopyQword((uint64_t *)dst, (const uint64_t *)src, n);
+static void CopyLarge(uint8_t *dst, const uint8_t *src, size_t n) {
+    // copy an unaligned head, then advance far enough to align the destination.
+    // the source may stay misaligned, unaligned loads are cheap on x86.
+    uint64_t tail = Load64(src + n - sizeof(uint64_t));
+    Store64(dst, Load64(src));
+
+    size_t offset = sizeof(uint64_t) - ((uintptr_t)dst % sizeof(uint64_t));
+    dst += offset;
+    src += offset;
+    n -= offset;
+
+    while (n >= sizeof(uint64_t) * 4) {
+        uint64_t a = Load64(src + 0);
+        uint64_t b = Load64(src + 8);
+        uint64_t c = Load64(src + 16);
+        uint64_t d = Load64(src + 24);
+        Store64(dst + 0, a);
+        Store64(dst + 8, b);
+        Store64(dst + 16, c);
+        Store64(dst + 24, d);
+        dst += sizeof(uint64_t) * 4;
+        src += sizeof(uint64_t) * 4;
+        n -= sizeof(uint64_t) * 4;
+    }
 
-    // copy the remaining bytes
-    dst += n - remaining;
-    src += n - remaining;
+    while (n >= sizeof(uint64_t)) {
+        Store64(dst, Load64(src));
+        dst += sizeof(uint64_t);
+        src += sizeof(uint64_t);
+        n -= sizeof(uint64_t);
+    }
 
-    CopySmall(dst, src, remaining);
+    // the tail was loaded up front and overlaps whatever is left
+    Store64(dst + n - sizeof(uint64_t), tail);
 }
 
 __attribute__((__nothrow__, __nonblocking__, __nonnull__))
@@ -47,51 +108,106 @@ void KmMemoryCopy(void *to, const void *from, size_t n) {
     uint8_t *dst = (uint8_t *)to;
     const uint8_t *src = (const uint8_t *)from;
 
-    bool useLargeCopy = HaveEqualAlignment(dst, src, sizeof(uint64_t)) && (n > sizeof(uint64_t) * 2);
-
-    if (useLargeCopy) {
-        CopyLarge(dst, src, n);
-    } else {
+    if (n <= sizeof(uint64_t) * 2) {
         CopySmall(dst, src, n);
+    } else if (n >= gRepMovsbThreshold) {
+        RepMovsb(dst, src, n);
+    } else {
+        CopyLarge(dst, src, n);
     }
 }
 
-static void SetSmall(uint8_t *dst, uint8_t value, size_t n) {
-    for (size_t i = 0; i < n; i++) {
-        dst[i] = value;
+static void SetSmall(uint8_t *dst, uint64_t v64, size_t n) {
+    if (n >= sizeof(uint64_t)) {
+        Store64(dst, v64);
+        Store64(dst + n - sizeof(uint64_t), v64);
+    } else if (n >= sizeof(uint32_t)) {
+        Store32(dst, uint32_t(v64));
+        Store32(dst + n - sizeof(uint32_t), uint32_t(v64));
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = uint8_t(v64);
+        }
     }
 }
 
-static void SetLarge(uint8_t *dst, uint8_t value, size_t n) {
-    // align the destination to 8 bytes
-    if (size_t align = (uintptr_t)dst % sizeof(uint64_t)) {
-        size_t offset = sizeof(uint64_t) - align;
-        SetSmall(dst, value, offset);
-        dst += offset;
-        n -= offset;
+static void SetLarge(uint8_t *dst, uint64_t v64, size_t n) {
+    Store64(dst, v64);
+    Store64(dst + n - sizeof(uint64_t), v64);
+
+    // align the destination to 8 bytes, the head store covered the skipped bytes
+    size_t offset = sizeof(uint64_t) - ((uintptr_t)dst % sizeof(uint64_t));
+    dst += offset;
+    n -= offset;
+
+    while (n >= sizeof(uint64_t) * 4) {
+        Store64(dst + 0, v64);
+        Store64(dst + 8, v64);
+        Store64(dst + 16, v64);
+        Store64(dst + 24, v64);
+        dst += sizeof(uint64_t) * 4;
+        n -= sizeof(uint64_t) * 4;
     }
 
-    // set 8 bytes at a time
-    uint64_t v64 = uint64_t(value) * 0x0101010101010101;
-    while (n > sizeof(uint64_t)) {
-        *reinterpret_cast<uint64_t*>(dst) = v64;
+    while (n >= sizeof(uint64_t)) {
+        Store64(dst, v64);
+        dst += sizeof(uint64_t);
+        n -= sizeof(uint64_t);
+    }
+}
+
+static void SetNonTemporal(uint8_t *dst, uint64_t v64, size_t n) {
+    Store64(dst, v64);
+    Store64(dst + n - sizeof(uint64_t), v64);
+
+    size_t offset = sizeof(uint64_t) - ((uintptr_t)dst % sizeof(uint64_t));
+    dst += offset;
+    n -= offset;
+
+    // movnti uses general purpose registers, so this does not touch any
+    // vector state that would need to be saved on kernel entry.
+    while (n >= sizeof(uint64_t)) {
+        asm volatile("movnti %1, %0" : "=m"(*(uint64_t*)dst) : "r"(v64));
         dst += sizeof(uint64_t);
         n -= sizeof(uint64_t);
     }
 
-    // set the remaining bytes
-    SetSmall(dst, value, n);
+    // non-temporal stores are weakly ordered
+    asm volatile("sfence" : : : "memory");
 }
 
 __attribute__((__nothrow__, __nonblocking__, __nonnull__))
 void KmMemorySet(void *dst, uint8_t value, size_t size) {
     uint8_t *p = (uint8_t *)dst;
+    uint64_t v64 = uint64_t(value) * 0x0101010101010101;
 
-    bool useLargeCopy = (size > (sizeof(uint64_t) * 2));
-
-    if (useLargeCopy) {
-        SetLarge(p, value, size);
+    if (size <= sizeof(uint64_t) * 2) {
+        SetSmall(p, v64, size);
+    } else if (size >= gNonTemporalThreshold) {
+        SetNonTemporal(p, v64, size);
+    } else if (size >= gRepStosbThreshold) {
+        RepStosb(p, value, size);
     } else {
-        SetSmall(p, value, size);
+        SetLarge(p, v64, size);
+    }
+}
+
+void KmInitMemoryRoutines(KmMemoryFeatures features) {
+    gRepMovsbThreshold = SIZE_MAX;
+    gRepStosbThreshold = SIZE_MAX;
+    gNonTemporalThreshold = SIZE_MAX;
+
+    if (features.fsrm) {
+        gRepMovsbThreshold = kFsrmThreshold;
+    } else if (features.erms) {
+        gRepMovsbThreshold = kErmsThreshold;
+    }
+
+    if (features.erms) {
+        gRepStosbThreshold = kErmsThreshold;
+    }
+
+    if (features.nonTemporal) {
+        gNonTemporalThreshold = kNonTemporalThreshold;
     }
 }
@@ -1,9 +1,29 @@
 #include "debug/debug.hpp"
+#include "isr/isr.hpp"
 #include "std/spinlock.hpp"
+#include "util/memory.hpp"
 
 #if KM_DEBUG_EVENTS
 static constinit km::SerialPort gDebugSerialPort;
+static constinit km::BufferedSerialPort gDebugBufferedPort;
 static constinit stdx::SpinLock gDebugLock;
+
+/// @brief Large enough to absorb bursts of allocation events without dropping.
+static constexpr uint32_t kDebugTxCapacity = sm::kilobytes(64).bytes();
+
+static OsStatus WriteEventUnlocked(const km::debug::EventPacket &packet) noexcept [[clang::nonallocating]] REQUIRES(gDebugLock) {
+    if (gDebugBufferedPort.isReady()) {
+        // Never write a partial packet, the host would lose framing.
+        if (gDebugBufferedPort.writeAvailable() < sizeof(packet)) {
+            return OsStatusOutOfMemory;
+        }
+
+        gDebugBufferedPort.write(std::span(reinterpret_cast<const uint8_t*>(&packet), sizeof(packet)));
+        return OsStatusSuccess;
+    }
+
+    return gDebugSerialPort.write(packet);
+}
 #endif
 
 OsStatus km::debug::InitDebugStream([[maybe_unused]] ComPortInfo info) {
@@ -14,6 +34,25 @@ OsStatus km::debug::InitDebugStream([[maybe_unused]] ComPortInfo info) {
 #endif
 }
 
+OsStatus km::debug::EnableDebugStreamIrq([[maybe_unused]] IoApicSet& ioApicSet, [[maybe_unused]] const IApic *target, [[maybe_unused]] LocalIsrTable *ist) {
+#if KM_DEBUG_EVENTS
+    if (!gDebugSerialPort.isReady()) {
+        return OsStatusDeviceNotReady;
+    }
+
+    stdx::LockGuard guard(gDebugLock);
+
+    // The debug stream is write only, so the port never enables the receive interrupt.
+    if (OsStatus status = BufferedSerialPort::create(gDebugSerialPort, kDebugTxCapacity, 0, &gDebugBufferedPort)) {
+        return status;
+    }
+
+    return InstallSerialIsr(ioApicSet, irq::kCom2, &gDebugBufferedPort, target, ist);
+#else
+    return OsStatusSuccess;
+#endif
+}
+
 OsStatus km::debug::detail::SendEvent(const EventPacket &packet) noexcept [[clang::nonallocating]] {
 #if KM_DEBUG_EVENTS
     if (!gDebugSerialPort.isReady()) {
@@ -21,8 +60,25 @@ OsStatus km::debug::detail::SendEvent(const EventPacket &packet) noexcept [[clan
     }
 
     stdx::LockGuard guard(gDebugLock);
+    return WriteEventUnlocked(packet);
+#else
+    return OsStatusSuccess;
+#endif
+}
 
-    return gDebugSerialPort.write(packet);
+OsStatus km::debug::detail::TrySendEvent(const EventPacket &packet) noexcept [[clang::nonallocating]] {
+#if KM_DEBUG_EVENTS
+    if (!gDebugSerialPort.isReady()) {
+        return OsStatusDeviceNotReady;
+    }
+
+    if (!gDebugLock.try_lock()) {
+        return OsStatusDeviceBusy;
+    }
+
+    OsStatus status = WriteEventUnlocked(packet);
+    gDebugLock.unlock();
+    return status;
 #else
     return OsStatusSuccess;
 #endif
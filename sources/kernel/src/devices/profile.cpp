@@ -0,0 +1,119 @@
+#include "devices/profile.hpp"
+
+#include "fs/file.hpp"
+#include "fs/identify.hpp"
+#include "fs/query.hpp"
+#include "logger/categories.hpp"
+#include "profile/profiler.hpp"
+
+#include <string.h>
+
+namespace stdr = std::ranges;
+
+static constexpr inline vfs::InterfaceList kProfileInterfaceList = std::to_array({
+    vfs::InterfaceOf<vfs::TIdentifyHandle<dev::ProfileFile>, dev::ProfileFile>(kOsIdentifyGuid),
+    vfs::InterfaceOf<vfs::TFileHandle<dev::ProfileFile>, dev::ProfileFile>(kOsFileGuid),
+});
+
+namespace {
+    class StringOutStream final : public km::IOutStream {
+        stdx::String& mString;
+
+    public:
+        StringOutStream(stdx::String& string)
+            : mString(string)
+        { }
+
+        void write(stdx::StringView message) override {
+            mString.append(message);
+        }
+    };
+}
+
+OsStatus dev::ProfileFile::refresh() {
+    stdx::Vector2<km::ProfileSample> samples;
+    if (OsStatus status = km::DrainProfileSamples(samples)) {
+        return status;
+    }
+
+    mSnapshot.clear();
+
+    StringOutStream out(mSnapshot);
+    km::WriteFoldedStacks(std::span(samples.begin(), samples.end()), out);
+
+    if (uint64_t dropped = km::GetProfileDroppedSamples()) {
+        CpuLog.warnf("Profiler has dropped ", dropped, " samples, drain more often");
+    }
+
+    return OsStatusSuccess;
+}
+
+OsStatus dev::ProfileFile::query(sm::uuid uuid, const void *data, size_t size, vfs::IHandle **handle) {
+    return kProfileInterfaceList.query(loanShared(), uuid, data, size, handle);
+}
+
+OsStatus dev::ProfileFile::interfaces(OsIdentifyInterfaceList *list) {
+    return kProfileInterfaceList.list(list);
+}
+
+OsStatus dev::ProfileFile::identify(OsIdentifyInfo *info) {
+    *info = OsIdentifyInfo {
+        .DisplayName = "Sampling Profiler",
+        .DriverVendor = "BezOS",
+        .DriverVersion = OS_VERSION(1, 0, 0),
+    };
+
+    return OsStatusSuccess;
+}
+
+OsStatus dev::ProfileFile::stat(OsFileInfo *stat) {
+    stdx::LockGuard guard(mLock);
+
+    *stat = OsFileInfo {
+        .Name = "Profile",
+        .LogicalSize = mSnapshot.count(),
+        .BlockSize = 1,
+        .BlockCount = mSnapshot.count(),
+    };
+
+    return OsStatusSuccess;
+}
+
+OsStatus dev::ProfileFile::read(vfs::ReadRequest request, vfs::ReadResult *result) {
+    stdx::LockGuard guard(mLock);
+
+    if (request.offset == 0) {
+        if (OsStatus status = refresh()) {
+            return status;
+        }
+    }
+
+    if (request.offset >= mSnapshot.count()) {
+        return OsStatusEndOfFile;
+    }
+
+    size_t count = std::min<uint64_t>(request.size(), mSnapshot.count() - request.offset);
+    memcpy(request.begin, mSnapshot.begin() + request.offset, count);
+    result->read = count;
+    return OsStatusSuccess;
+}
+
+OsStatus dev::ProfileFile::write(vfs::WriteRequest request, vfs::WriteResult *result) {
+    stdx::StringView command { (const char*)request.begin, (const char*)request.end };
+
+    // accept a trailing newline so the command can be echoed into the file
+    if (command.endsWith("\n")) {
+        command = stdx::StringView { command.begin(), command.end() - 1 };
+    }
+
+    if (command == "start") {
+        km::SetProfilerRunning(true);
+    } else if (command == "stop") {
+        km::SetProfilerRunning(false);
+    } else {
+        return OsStatusInvalidInput;
+    }
+
+    result->write = request.size();
+    return OsStatusSuccess;
+}
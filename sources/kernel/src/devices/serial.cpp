@@ -0,0 +1,65 @@
+#include "devices/serial.hpp"
+
+#include <bezos/handle.h>
+
+#include "fs/identify.hpp"
+#include "fs/stream.hpp"
+#include "fs/query.hpp"
+
+#include "system/schedule.hpp"
+
+#include "clock.hpp"
+#include "uart.hpp"
+
+dev::SerialDevice::SerialDevice(km::BufferedSerialPort *port, km::Clock *clock)
+    : mPort(port)
+    , mClock(clock)
+{ }
+
+OsStatus dev::SerialDevice::read(vfs::ReadRequest request, vfs::ReadResult *result) {
+    OsInstant timeout = request.timeout;
+
+    auto expired = [&] {
+        if (timeout == OS_TIMEOUT_INSTANT) {
+            return true;
+        }
+
+        if (timeout == OS_TIMEOUT_INFINITE) {
+            return false;
+        }
+
+        OsInstant now = 0;
+        mClock->time(&now);
+        return now >= timeout;
+    };
+
+    size_t count = mPort->read(std::span((uint8_t*)request.begin, request.size()), expired, [] {
+        sys::YieldCurrentThread();
+    });
+
+    result->read = count;
+
+    if (count == 0 && request.size() != 0 && timeout != OS_TIMEOUT_INSTANT) {
+        return OsStatusTimeout;
+    }
+
+    return OsStatusSuccess;
+}
+
+OsStatus dev::SerialDevice::write(vfs::WriteRequest request, vfs::WriteResult *result) {
+    result->write = mPort->write(std::span((const uint8_t*)request.begin, request.size()));
+    return OsStatusSuccess;
+}
+
+static constexpr inline vfs::InterfaceList kInterfaceList = std::to_array({
+    vfs::InterfaceOf<vfs::TIdentifyHandle<dev::SerialDevice>, dev::SerialDevice>(kOsIdentifyGuid),
+    vfs::InterfaceOf<vfs::TStreamHandle<dev::SerialDevice>, dev::SerialDevice>(kOsStreamGuid),
+});
+
+OsStatus dev::SerialDevice::query(sm::uuid uuid, const void *data, size_t size, vfs::IHandle **handle) {
+    return kInterfaceList.query(loanShared(), uuid, data, size, handle);
+}
+
+OsStatus dev::SerialDevice::interfaces(OsIdentifyInterfaceList *list) {
+    return kInterfaceList.list(list);
+}
@@ -7,6 +7,8 @@
 #include "fs/iterator.hpp"
 #include "fs/query.hpp"
 #include "smbios.hpp"
+#include "syscall_stats.hpp"
+#include "task/scheduler.hpp"
 
 namespace smbios = km::smbios;
 
@@ -103,6 +105,55 @@ void dev::detail::IdentifySmbRoot(const km::SmBiosTables *header, OsIdentifyInfo
     *info = result;
 }
 
+void dev::detail::WriteSyscallStats(const km::SyscallStats *stats, km::IOutStream& out) {
+    out.format("# function calls errors ticks latency[log2 ticks]...\n");
+
+    for (size_t function = 0; function < km::kSyscallCount; function++) {
+        km::SyscallSummary summary;
+        stats->summary(function, &summary);
+        if (summary.calls == 0) {
+            continue;
+        }
+
+        out.format(km::Hex(uint8_t(function)).pad(2), " ", summary.calls, " ", summary.errors, " ", summary.ticks);
+
+        // trailing empty buckets are left off
+        size_t used = km::kSyscallLatencyBuckets;
+        while (used > 0 && summary.latency[used - 1] == 0) {
+            used -= 1;
+        }
+
+        for (size_t bucket = 0; bucket < used; bucket++) {
+            out.format(" ", summary.latency[bucket]);
+        }
+
+        out.format("\n");
+    }
+}
+
+void dev::detail::WriteSchedulerStats(task::Scheduler *scheduler, km::IOutStream& out) {
+    out.format("# cpu switches preemptions idle run-ticks queue-samples queue-total queue-max wait[log2 ticks]...\n");
+
+    scheduler->forEachQueue([&](km::CpuCoreId coreId, const task::SchedulerQueue *queue) {
+        task::QueueStats stats = queue->getStats();
+
+        out.format(std::to_underlying(coreId), " ", stats.switches, " ", stats.preemptions, " ", stats.idle, " ", stats.runTicks);
+        out.format(" ", stats.samples, " ", stats.lengthTotal, " ", stats.lengthMax);
+
+        // trailing empty buckets are left off
+        size_t used = task::kRunQueueWaitBuckets;
+        while (used > 0 && stats.wait[used - 1] == 0) {
+            used -= 1;
+        }
+
+        for (size_t bucket = 0; bucket < used; bucket++) {
+            out.format(" ", stats.wait[bucket]);
+        }
+
+        out.format("\n");
+    });
+}
+
 static constexpr inline vfs::InterfaceList kAcpiTableInterfaceList = std::to_array({
     vfs::InterfaceOf<vfs::TIdentifyHandle<dev::AcpiTable>, dev::AcpiTable>(kOsIdentifyGuid),
     vfs::InterfaceOf<vfs::TFileHandle<dev::AcpiTable>, dev::AcpiTable>(kOsFileGuid),
@@ -127,6 +178,16 @@ static constexpr inline vfs::InterfaceList kSmbRootInterfaceList = std::to_array
     vfs::InterfaceOf<vfs::TIteratorHandle<dev::SmBiosRoot>, dev::SmBiosRoot>(kOsIteratorGuid),
 });
 
+static constexpr inline vfs::InterfaceList kSyscallStatsInterfaceList = std::to_array({
+    vfs::InterfaceOf<vfs::TIdentifyHandle<dev::SyscallStatsFile>, dev::SyscallStatsFile>(kOsIdentifyGuid),
+    vfs::InterfaceOf<vfs::TFileHandle<dev::SyscallStatsFile>, dev::SyscallStatsFile>(kOsFileGuid),
+});
+
+static constexpr inline vfs::InterfaceList kSchedulerStatsInterfaceList = std::to_array({
+    vfs::InterfaceOf<vfs::TIdentifyHandle<dev::SchedulerStatsFile>, dev::SchedulerStatsFile>(kOsIdentifyGuid),
+    vfs::InterfaceOf<vfs::TFileHandle<dev::SchedulerStatsFile>, dev::SchedulerStatsFile>(kOsFileGuid),
+});
+
 dev::AcpiTable::AcpiTable(const acpi::RsdtHeader *table)
     : mHeader(table)
 { }
@@ -313,3 +374,140 @@ sm::RcuSharedPtr<dev::SmBiosRoot> dev::SmBiosRoot::create(sm::RcuDomain *domain,
 
     return root;
 }
+
+//
+// system call counters
+//
+
+namespace {
+    /// @brief Copies the part of a formatted stream that falls inside a read request.
+    class ReadWindowStream final : public km::IOutStream {
+        std::byte *mBuffer;
+        uint64_t mFront;
+        uint64_t mBack;
+        uint64_t mOffset = 0;
+
+    public:
+        ReadWindowStream(void *buffer, uint64_t front, uint64_t back)
+            : mBuffer(static_cast<std::byte*>(buffer))
+            , mFront(front)
+            , mBack(back)
+        { }
+
+        void write(stdx::StringView message) override {
+            uint64_t front = std::max(mOffset, mFront);
+            uint64_t back = std::min(mOffset + message.count(), mBack);
+            if (front < back) {
+                memcpy(mBuffer + (front - mFront), message.data() + (front - mOffset), back - front);
+            }
+
+            mOffset += message.count();
+        }
+
+        uint64_t size() const { return mOffset; }
+
+        uint64_t copied() const {
+            return mOffset > mFront ? std::min(mOffset, mBack) - mFront : 0;
+        }
+    };
+}
+
+dev::SyscallStatsFile::SyscallStatsFile(const km::SyscallStats *stats)
+    : mStats(stats)
+{ }
+
+OsStatus dev::SyscallStatsFile::query(sm::uuid uuid, const void *data, size_t size, vfs::IHandle **handle) {
+    return kSyscallStatsInterfaceList.query(loanShared(), uuid, data, size, handle);
+}
+
+OsStatus dev::SyscallStatsFile::interfaces(OsIdentifyInterfaceList *list) {
+    return kSyscallStatsInterfaceList.list(list);
+}
+
+OsStatus dev::SyscallStatsFile::identify(OsIdentifyInfo *info) {
+    *info = OsIdentifyInfo {
+        .DisplayName = "System Call Statistics",
+        .DriverVendor = "BezOS",
+        .DriverVersion = OS_VERSION(1, 0, 0),
+    };
+
+    return OsStatusSuccess;
+}
+
+OsStatus dev::SyscallStatsFile::stat(OsFileInfo *stat) {
+    ReadWindowStream out(nullptr, 0, 0);
+    detail::WriteSyscallStats(mStats, out);
+
+    *stat = OsFileInfo {
+        .Name = "Syscalls",
+        .LogicalSize = out.size(),
+        .BlockSize = 1,
+        .BlockCount = out.size(),
+    };
+
+    return OsStatusSuccess;
+}
+
+OsStatus dev::SyscallStatsFile::read(vfs::ReadRequest request, vfs::ReadResult *result) {
+    ReadWindowStream out(request.begin, request.offset, request.offset + request.size());
+    detail::WriteSyscallStats(mStats, out);
+
+    if (request.offset >= out.size()) {
+        return OsStatusEndOfFile;
+    }
+
+    result->read = out.copied();
+    return OsStatusSuccess;
+}
+
+//
+// scheduler counters
+//
+
+dev::SchedulerStatsFile::SchedulerStatsFile(task::Scheduler *scheduler)
+    : mScheduler(scheduler)
+{ }
+
+OsStatus dev::SchedulerStatsFile::query(sm::uuid uuid, const void *data, size_t size, vfs::IHandle **handle) {
+    return kSchedulerStatsInterfaceList.query(loanShared(), uuid, data, size, handle);
+}
+
+OsStatus dev::SchedulerStatsFile::interfaces(OsIdentifyInterfaceList *list) {
+    return kSchedulerStatsInterfaceList.list(list);
+}
+
+OsStatus dev::SchedulerStatsFile::identify(OsIdentifyInfo *info) {
+    *info = OsIdentifyInfo {
+        .DisplayName = "Scheduler Statistics",
+        .DriverVendor = "BezOS",
+        .DriverVersion = OS_VERSION(1, 0, 0),
+    };
+
+    return OsStatusSuccess;
+}
+
+OsStatus dev::SchedulerStatsFile::stat(OsFileInfo *stat) {
+    ReadWindowStream out(nullptr, 0, 0);
+    detail::WriteSchedulerStats(mScheduler, out);
+
+    *stat = OsFileInfo {
+        .Name = "Scheduler",
+        .LogicalSize = out.size(),
+        .BlockSize = 1,
+        .BlockCount = out.size(),
+    };
+
+    return OsStatusSuccess;
+}
+
+OsStatus dev::SchedulerStatsFile::read(vfs::ReadRequest request, vfs::ReadResult *result) {
+    ReadWindowStream out(request.begin, request.offset, request.offset + request.size());
+    detail::WriteSchedulerStats(mScheduler, out);
+
+    if (request.offset >= out.size()) {
+        return OsStatusEndOfFile;
+    }
+
+    result->read = out.copied();
+    return OsStatusSuccess;
+}
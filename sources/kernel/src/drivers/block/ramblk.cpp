@@ -1,9 +1,10 @@
 #include "drivers/block/ramblk.hpp"
 
-km::MemoryBlk::MemoryBlk(std::byte *memory, size_t size, Protection protection)
+km::MemoryBlk::MemoryBlk(std::byte *memory, size_t size, Protection protection, sm::PhysicalAddress physical)
     : mMemory(memory)
     , mSize(size)
     , mProtection(protection)
+    , mPhysical(physical)
 { }
 
 km::BlockDeviceCapability km::MemoryBlk::capability() const {
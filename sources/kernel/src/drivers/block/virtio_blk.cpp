@@ -1,15 +1,389 @@
 #include "drivers/block/virtio.hpp"
+#include "drivers/virtio/queue.hpp"
 
-km::BlockDeviceCapability km::VirtIoBlk::capability() const {
-    return km::BlockDeviceCapability {
-        .protection = km::Protection::eNone
+#include "logger/categories.hpp"
+#include "memory.hpp"
+#include "memory/address_space.hpp"
+#include "panic.hpp"
+#include "processor.hpp"
+#include "std/spinlock.hpp"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+
+using km::virtio::QueueBuffer;
+using km::virtio::VirtQueue;
+
+constinit static km::Logger BlkLog { "VIRTIO-BLK" };
+
+// device specific feature bits
+static constexpr uint64_t kFeatureSizeMax = (1ull << 1);
+static constexpr uint64_t kFeatureSegMax = (1ull << 2);
+static constexpr uint64_t kFeatureReadOnly = (1ull << 5);
+static constexpr uint64_t kFeatureBlockSize = (1ull << 6);
+static constexpr uint64_t kFeatureMultiQueue = (1ull << 12);
+
+// offsets of the fields in struct virtio_blk_config
+static constexpr uint32_t kConfigCapacity = 0;
+static constexpr uint32_t kConfigSizeMax = 8;
+static constexpr uint32_t kConfigSegMax = 12;
+static constexpr uint32_t kConfigBlockSize = 20;
+static constexpr uint32_t kConfigNumQueues = 34;
+
+static constexpr uint32_t kRequestIn = 0;
+static constexpr uint32_t kRequestOut = 1;
+
+static constexpr uint8_t kStatusOk = 0;
+
+/// @brief Request sector numbers are always in units of 512 bytes.
+static constexpr uint32_t kSectorSize = 512;
+
+/// @brief The largest queue the driver will create.
+static constexpr uint16_t kMaxQueueSize = 128;
+
+/// @brief The largest number of data segments in one request.
+static constexpr uint32_t kMaxSegments = 32;
+
+/// @brief The size of each indirect table, the data segments plus the header and status.
+static constexpr uint16_t kIndirectLength = kMaxSegments + 2;
+
+namespace {
+    struct RequestHeader {
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t sector;
+    };
+
+    /// @brief The device visible state of a request.
+    struct alignas(16) RequestSlot {
+        RequestHeader header;
+        uint8_t status;
+    };
+}
+
+struct km::detail::VirtIoBlkQueue {
+    stdx::SpinLock lock;
+    VirtQueue ring;
+    volatile uint16_t *notify = nullptr;
+    uint16_t index = 0;
+
+    RequestSlot *slots = nullptr;
+    sm::PhysicalAddress slotsAddress;
+
+    /// @brief Stack of free request slots.
+    uint16_t *freeSlots = nullptr;
+    uint16_t freeSlotCount = 0;
+
+    sm::PhysicalAddress physicalAddress(const void *ptr) const {
+        uintptr_t offset = std::bit_cast<uintptr_t>(ptr) - std::bit_cast<uintptr_t>(slots);
+        return slotsAddress + offset;
+    }
+
+    RequestSlot *takeSlot() {
+        KM_ASSERT(freeSlotCount > 0);
+        return &slots[freeSlots[--freeSlotCount]];
+    }
+
+    void releaseSlot(RequestSlot *slot) {
+        freeSlots[freeSlotCount++] = uint16_t(slot - slots);
+    }
+
+    void kick() {
+        if (ring.publish()) {
+            virtio::PciTransport::notify(notify, index);
+        }
+    }
+};
+
+static OsStatus CreateQueue(km::virtio::PciTransport& transport, km::SystemMemory& memory, uint16_t index, bool indirect, bool eventIndex, km::detail::VirtIoBlkQueue *queue) {
+    uint16_t maxSize = transport.maxQueueSize(index);
+    if (maxSize == 0) {
+        return OsStatusNotSupported;
+    }
+
+    uint16_t size = std::bit_floor(std::min(maxSize, kMaxQueueSize));
+    uint16_t indirectLength = indirect ? kIndirectLength : 0;
+
+    // the request slots and their free list follow the ring in the same allocation
+    km::virtio::QueueLayout layout = km::virtio::QueueLayout::of(size, indirectLength);
+    size_t slotsOffset = sm::roundup(layout.size, alignof(RequestSlot));
+    size_t freeOffset = slotsOffset + (sizeof(RequestSlot) * size);
+    size_t total = sm::roundup(freeOffset + (sizeof(uint16_t) * size), x64::kPageSize);
+
+    km::MappingAllocation allocation;
+    if (OsStatus status = memory.map(total, km::PageFlags::eData, km::MemoryType::eWriteBack, &allocation)) {
+        return status;
+    }
+
+    std::byte *base = std::bit_cast<std::byte*>(allocation.baseAddress());
+    km::PhysicalAddressEx address = allocation.baseMemory();
+    std::memset(base, 0, total);
+
+    if (OsStatus status = VirtQueue::create(size, indirectLength, eventIndex, base, address, &queue->ring)) {
+        return status;
+    }
+
+    // requests are completed by polling
+    queue->ring.disableInterrupts();
+
+    queue->index = index;
+    queue->slots = std::bit_cast<RequestSlot*>(base + slotsOffset);
+    queue->slotsAddress = address + slotsOffset;
+    queue->freeSlots = std::bit_cast<uint16_t*>(base + freeOffset);
+    for (uint16_t i = 0; i < size; i++) {
+        queue->freeSlots[i] = i;
+    }
+    queue->freeSlotCount = size;
+
+    transport.enableQueue(index, queue->ring);
+    queue->notify = transport.notifyRegister(index);
+
+    return OsStatusSuccess;
+}
+
+km::VirtIoBlk::VirtIoBlk(virtio::PciTransport transport, AddressSpace *addressSpace)
+    : mTransport(transport)
+    , mAddressSpace(addressSpace)
+    , mCapability()
+    , mSegmentMax(kMaxSegments)
+    , mSizeMax(UINT32_MAX)
+    , mQueueCount(0)
+{ }
+
+km::VirtIoBlk::~VirtIoBlk() = default;
+
+km::detail::VirtIoBlkQueue& km::VirtIoBlk::currentQueue() noexcept {
+    uint32_t core = std::to_underlying(km::GetCurrentCoreId());
+    return mQueues[core % mQueueCount];
+}
+
+km::BlockDeviceStatus km::VirtIoBlk::submit(uint32_t type, uint64_t block, void *buffer, size_t count) {
+    detail::VirtIoBlkQueue& queue = currentQueue();
+    stdx::LockGuard guard(queue.lock);
+
+    bool deviceWrites = (type == kRequestIn);
+    std::byte *data = static_cast<std::byte*>(buffer);
+    size_t remaining = count * mCapability.blockSize;
+    uint64_t sector = block * (mCapability.blockSize / kSectorSize);
+
+    size_t inflight = 0;
+    BlockDeviceStatus result = BlockDeviceStatus::eOk;
+
+    auto reap = [&] {
+        uint32_t length;
+        while (void *token = queue.ring.popUsed(&length)) {
+            RequestSlot *slot = static_cast<RequestSlot*>(token);
+            if (slot->status != kStatusOk) {
+                BlkLog.warnf("Request for sector ", slot->header.sector, " failed with status ", unsigned(slot->status));
+                result = BlockDeviceStatus::eInternalError;
+            }
+
+            queue.releaseSlot(slot);
+            inflight -= 1;
+        }
     };
+
+    while (remaining > 0 && result == BlockDeviceStatus::eOk) {
+        QueueBuffer buffers[kMaxSegments + 2];
+        size_t segments = 0;
+        size_t length = 0;
+
+        // gather the physical pages of the buffer, merging contiguous pages
+        while (length < remaining) {
+            std::byte *ptr = data + length;
+            km::PhysicalAddressEx address = mAddressSpace->getBackingAddress(ptr);
+            if (address == km::PhysicalAddressEx::invalid()) {
+                BlkLog.warnf("Buffer ", (void*)ptr, " is not mapped");
+                result = BlockDeviceStatus::eInternalError;
+                break;
+            }
+
+            size_t pageRemaining = x64::kPageSize - (std::bit_cast<uintptr_t>(ptr) % x64::kPageSize);
+            size_t chunk = std::min({ pageRemaining, remaining - length, size_t(mSizeMax) });
+
+            QueueBuffer& last = buffers[segments];
+            if (segments > 0 && (last.address + last.length) == address && (size_t(last.length) + chunk) <= mSizeMax) {
+                last.length += chunk;
+            } else if (segments < mSegmentMax) {
+                segments += 1;
+                buffers[segments] = QueueBuffer { address, uint32_t(chunk), deviceWrites };
+            } else {
+                break;
+            }
+
+            length += chunk;
+        }
+
+        if (result != BlockDeviceStatus::eOk) {
+            break;
+        }
+
+        // a request must cover whole blocks, trim the tail back to a block boundary
+        size_t excess = length % mCapability.blockSize;
+        length -= excess;
+        while (excess > 0) {
+            QueueBuffer& last = buffers[segments];
+            size_t trim = std::min(excess, size_t(last.length));
+            last.length -= trim;
+            excess -= trim;
+
+            if (last.length == 0) {
+                segments -= 1;
+            }
+        }
+
+        if (length == 0) {
+            BlkLog.warnf("Buffer is too fragmented for a single block");
+            result = BlockDeviceStatus::eInternalError;
+            break;
+        }
+
+        // wait for earlier requests in this batch to complete if the queue is full
+        while (queue.freeSlotCount == 0 || !queue.ring.canAdd(segments + 2)) {
+            KM_ASSERT(inflight > 0);
+            queue.kick();
+            _mm_pause();
+            reap();
+        }
+
+        RequestSlot *slot = queue.takeSlot();
+        slot->header = RequestHeader { .type = type, .reserved = 0, .sector = sector };
+        slot->status = UINT8_MAX;
+
+        buffers[0] = QueueBuffer { queue.physicalAddress(&slot->header), sizeof(RequestHeader), false };
+        buffers[segments + 1] = QueueBuffer { queue.physicalAddress(&slot->status), sizeof(uint8_t), true };
+
+        OsStatus status = queue.ring.add(std::span(buffers, segments + 2), slot);
+        KM_ASSERT(status == OsStatusSuccess);
+
+        inflight += 1;
+        data += length;
+        remaining -= length;
+        sector += length / kSectorSize;
+    }
+
+    // the whole batch is published with a single notification
+    queue.kick();
+
+    while (inflight > 0) {
+        reap();
+        _mm_pause();
+    }
+
+    return result;
+}
+
+km::BlockDeviceCapability km::VirtIoBlk::capability() const {
+    return mCapability;
 }
 
-km::BlockDeviceStatus km::VirtIoBlk::readImpl(uint64_t, void *, size_t) {
-    return km::BlockDeviceStatus::eInternalError;
+km::BlockDeviceStatus km::VirtIoBlk::readImpl(uint64_t block, void *buffer, size_t count) {
+    return submit(kRequestIn, block, buffer, count);
 }
 
-km::BlockDeviceStatus km::VirtIoBlk::writeImpl(uint64_t, const void *, size_t) {
-    return km::BlockDeviceStatus::eInternalError;
+km::BlockDeviceStatus km::VirtIoBlk::writeImpl(uint64_t block, const void *buffer, size_t count) {
+    return submit(kRequestOut, block, const_cast<void*>(buffer), count);
+}
+
+OsStatus km::VirtIoBlk::create(pci::IConfigSpace *config, pci::DeviceBusAddress address, SystemMemory& memory, uint32_t cpuCount, VirtIoBlk **device [[outparam]]) {
+    virtio::PciTransport transport;
+    if (OsStatus status = virtio::PciTransport::create(config, address, memory.pageTables(), &transport)) {
+        return status;
+    }
+
+    if (transport.deviceConfigSize() <= kConfigNumQueues) {
+        return OsStatusNotSupported;
+    }
+
+    transport.reset();
+    transport.addStatus(virtio::DeviceStatus::eAcknowledge);
+    transport.addStatus(virtio::DeviceStatus::eDriver);
+
+    uint64_t supported
+        = virtio::kFeatureIndirectDescriptors
+        | virtio::kFeatureEventIndex
+        | kFeatureSizeMax
+        | kFeatureSegMax
+        | kFeatureReadOnly
+        | kFeatureBlockSize
+        | kFeatureMultiQueue;
+
+    uint64_t features = 0;
+    if (OsStatus status = transport.negotiate(supported, &features)) {
+        transport.addStatus(virtio::DeviceStatus::eFailed);
+        return status;
+    }
+
+    std::unique_ptr<VirtIoBlk> result{new (std::nothrow) VirtIoBlk(transport, &memory.pageTables())};
+    if (result == nullptr) {
+        transport.addStatus(virtio::DeviceStatus::eFailed);
+        return OsStatusOutOfMemory;
+    }
+
+    uint32_t blockSize = kSectorSize;
+    if (features & kFeatureBlockSize) {
+        uint32_t size = transport.readDevice32(kConfigBlockSize);
+        if (size >= kSectorSize && std::has_single_bit(size)) {
+            blockSize = size;
+        }
+    }
+
+    bool indirect = (features & virtio::kFeatureIndirectDescriptors);
+    bool eventIndex = (features & virtio::kFeatureEventIndex);
+
+    uint64_t capacity = transport.readDevice64(kConfigCapacity);
+    result->mCapability = BlockDeviceCapability {
+        .protection = (features & kFeatureReadOnly) ? Protection::eRead : Protection::eReadWrite,
+        .blockSize = blockSize,
+        .blockCount = (capacity * kSectorSize) / blockSize,
+    };
+
+    if (features & kFeatureSegMax) {
+        result->mSegmentMax = std::clamp<uint32_t>(transport.readDevice32(kConfigSegMax), 1, kMaxSegments);
+    }
+
+    if (features & kFeatureSizeMax) {
+        result->mSizeMax = std::max<uint32_t>(transport.readDevice32(kConfigSizeMax), kSectorSize);
+    }
+
+    uint16_t queueCount = 1;
+    if (features & kFeatureMultiQueue) {
+        queueCount = std::max<uint16_t>(transport.readDevice16(kConfigNumQueues), 1);
+    }
+
+    queueCount = uint16_t(std::min<uint32_t>({ queueCount, std::max<uint32_t>(cpuCount, 1), transport.queueCount() }));
+
+    result->mQueues.reset(new (std::nothrow) detail::VirtIoBlkQueue[queueCount]);
+    if (result->mQueues == nullptr) {
+        transport.addStatus(virtio::DeviceStatus::eFailed);
+        return OsStatusOutOfMemory;
+    }
+
+    for (uint16_t i = 0; i < queueCount; i++) {
+        if (OsStatus status = CreateQueue(result->mTransport, memory, i, indirect, eventIndex, &result->mQueues[i])) {
+            BlkLog.warnf("Failed to create queue ", i, ": ", OsStatusId(status));
+            transport.addStatus(virtio::DeviceStatus::eFailed);
+            return status;
+        }
+
+        // without indirect descriptors every segment consumes a ring descriptor
+        if (!indirect) {
+            uint32_t limit = result->mQueues[i].ring.size() - 2;
+            result->mSegmentMax = std::min(result->mSegmentMax, limit);
+        }
+    }
+
+    result->mQueueCount = queueCount;
+    transport.addStatus(virtio::DeviceStatus::eDriverOk);
+
+    BlkLog.infof("Device ", km::Hex(address.bus).pad(2), ":", km::Hex(address.slot).pad(2), ".", address.function,
+                 " ", result->mCapability.blockCount, " blocks of ", blockSize, " bytes, ", queueCount, " queues",
+                 indirect ? ", indirect" : "", eventIndex ? ", event index" : "");
+
+    *device = result.release();
+    return OsStatusSuccess;
 }
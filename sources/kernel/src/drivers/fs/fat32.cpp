@@ -0,0 +1,1306 @@
+#include "drivers/fs/fat32.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+using km::FatFsDriver;
+using km::FatCluster;
+using km::FatClusterMap;
+using km::FatExtent;
+using km::FatFolder;
+using km::FatFolderEntry;
+using km::FatLongName;
+using km::FatNode;
+using km::FatAttribute;
+using km::FatCaseFlags;
+
+namespace {
+    constexpr uint32_t kEntrySize = sizeof(FatFolder);
+
+    /// @brief A folder may contain at most 65536 entries.
+    constexpr uint32_t kMaxFolderEntries = 0x10000;
+
+    /// @brief The number of FAT sectors read at once while building the used map.
+    constexpr uint32_t kScanSectors = 64;
+
+    /// @brief The longest name that can be stored in long name entries, in UTF-16 code units.
+    constexpr size_t kMaxLongName = 255;
+
+    /// @brief 1980-01-01, the earliest date that can be stored in an entry.
+    constexpr uint16_t kEpochDate = (1 << 5) | 1;
+
+    /// @brief Set in the flags of the boot sector when only the active FAT is written.
+    constexpr uint16_t kNoFatMirroring = (1 << 7);
+    constexpr uint16_t kActiveFatMask = 0xF;
+
+    constexpr uint32_t kUnknownFreeCount = 0xFFFF'FFFF;
+}
+
+static OsStatus ConvertStatus(km::BlockDeviceStatus status) {
+    switch (status) {
+    case km::BlockDeviceStatus::eOk:
+        return OsStatusSuccess;
+    case km::BlockDeviceStatus::eReadOnly:
+        return OsStatusAccessDenied;
+    case km::BlockDeviceStatus::eOutOfRange:
+    case km::BlockDeviceStatus::eInvalidBlock:
+        return OsStatusOutOfBounds;
+    default:
+        return OsStatusDeviceFault;
+    }
+}
+
+static bool IsShortNameChar(char c) {
+    if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+        return true;
+    }
+
+    switch (c) {
+    case '!': case '#': case '$': case '%': case '&': case '\'': case '(': case ')':
+    case '-': case '@': case '^': case '_': case '`': case '{': case '}': case '~':
+        return true;
+    default:
+        return false;
+    }
+}
+
+static char ToUpper(char c) {
+    return (c >= 'a' && c <= 'z') ? char(c - 'a' + 'A') : c;
+}
+
+static char ToLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+static bool EqualsIgnoreCase(stdx::StringView lhs, stdx::StringView rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char a, char b) {
+        return ToUpper(a) == ToUpper(b);
+    });
+}
+
+/// @brief Store a part of a name in an 8.3 name if it has a consistent case.
+static bool StoreShortPart(stdx::StringView part, char *dst, size_t limit, bool *lower) {
+    if (part.count() > limit) {
+        return false;
+    }
+
+    bool hasLower = false;
+    bool hasUpper = false;
+    for (size_t i = 0; i < part.count(); i++) {
+        char c = part[i];
+        hasLower |= (c >= 'a' && c <= 'z');
+        hasUpper |= (c >= 'A' && c <= 'Z');
+
+        char upper = ToUpper(c);
+        if (!IsShortNameChar(upper)) {
+            return false;
+        }
+
+        dst[i] = upper;
+    }
+
+    *lower = hasLower;
+    return !(hasLower && hasUpper);
+}
+
+bool km::detail::FatShortName(stdx::StringView name, char shortName[11], FatCaseFlags *flags) {
+    std::fill_n(shortName, 11, ' ');
+
+    const char *dot = std::find(name.begin(), name.end(), '.');
+    stdx::StringView base(name.begin(), dot);
+    stdx::StringView ext = (dot == name.end()) ? stdx::StringView() : stdx::StringView(dot + 1, name.end());
+
+    if (base.isEmpty() || (dot != name.end() && ext.isEmpty())) {
+        return false;
+    }
+
+    bool lowerBase = false;
+    bool lowerExt = false;
+    if (!StoreShortPart(base, shortName, 8, &lowerBase) || !StoreShortPart(ext, shortName + 8, 3, &lowerExt)) {
+        return false;
+    }
+
+    *flags = FatCaseFlags::eNone;
+    if (lowerBase) *flags |= FatCaseFlags::eLowerBase;
+    if (lowerExt) *flags |= FatCaseFlags::eLowerExtension;
+    return true;
+}
+
+bool km::detail::IsValidFatName(stdx::StringView name) {
+    if (name.isEmpty() || name.count() > kMaxLongName) {
+        return false;
+    }
+
+    if (name == stdx::StringView(".") || name == stdx::StringView("..")) {
+        return false;
+    }
+
+    for (char c : name) {
+        if (uint8_t(c) < 0x20) {
+            return false;
+        }
+
+        switch (c) {
+        case '"': case '*': case '/': case ':': case '<': case '>': case '?': case '\\': case '|':
+            return false;
+        default:
+            break;
+        }
+    }
+
+    char last = name[name.count() - 1];
+    return last != '.' && last != ' ';
+}
+
+static void AppendUtf8(stdx::String& result, char32_t c) {
+    if (c < 0x80) {
+        result.add(char(c));
+    } else if (c < 0x800) {
+        result.add(char(0xC0 | (c >> 6)));
+        result.add(char(0x80 | (c & 0x3F)));
+    } else if (c < 0x10000) {
+        result.add(char(0xE0 | (c >> 12)));
+        result.add(char(0x80 | ((c >> 6) & 0x3F)));
+        result.add(char(0x80 | (c & 0x3F)));
+    } else {
+        result.add(char(0xF0 | (c >> 18)));
+        result.add(char(0x80 | ((c >> 12) & 0x3F)));
+        result.add(char(0x80 | ((c >> 6) & 0x3F)));
+        result.add(char(0x80 | (c & 0x3F)));
+    }
+}
+
+static stdx::String DecodeLongName(std::span<const uint16_t> units) {
+    stdx::String result;
+    for (size_t i = 0; i < units.size(); i++) {
+        char32_t c = units[i];
+        if (c == 0x0000 || c == 0xFFFF) {
+            break;
+        }
+
+        if (c >= 0xD800 && c < 0xDC00 && i + 1 < units.size() && units[i + 1] >= 0xDC00 && units[i + 1] < 0xE000) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (units[i + 1] - 0xDC00);
+            i += 1;
+        }
+
+        AppendUtf8(result, c);
+    }
+
+    return result;
+}
+
+/// @brief Convert a UTF-8 name to UTF-16 for storage in long name entries.
+static bool EncodeLongName(stdx::StringView name, uint16_t *units, size_t *count) {
+    size_t length = 0;
+    size_t i = 0;
+    while (i < name.count()) {
+        uint8_t lead = uint8_t(name[i]);
+        char32_t c;
+        size_t extra;
+        if (lead < 0x80) {
+            c = lead; extra = 0;
+        } else if ((lead & 0xE0) == 0xC0) {
+            c = lead & 0x1F; extra = 1;
+        } else if ((lead & 0xF0) == 0xE0) {
+            c = lead & 0x0F; extra = 2;
+        } else if ((lead & 0xF8) == 0xF0) {
+            c = lead & 0x07; extra = 3;
+        } else {
+            return false;
+        }
+
+        if (i + extra >= name.count()) {
+            return false;
+        }
+
+        for (size_t j = 1; j <= extra; j++) {
+            uint8_t next = uint8_t(name[i + j]);
+            if ((next & 0xC0) != 0x80) {
+                return false;
+            }
+
+            c = (c << 6) | (next & 0x3F);
+        }
+
+        i += extra + 1;
+
+        size_t needed = (c >= 0x10000) ? 2 : 1;
+        if (length + needed > kMaxLongName) {
+            return false;
+        }
+
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            units[length++] = uint16_t(0xD800 + (c >> 10));
+            units[length++] = uint16_t(0xDC00 + (c & 0x3FF));
+        } else {
+            units[length++] = uint16_t(c);
+        }
+    }
+
+    *count = length;
+    return true;
+}
+
+static stdx::String DecodeShortName(const FatFolder& entry) {
+    auto trimmed = [](const char *text, size_t length) {
+        while (length > 0 && text[length - 1] == ' ') {
+            length -= 1;
+        }
+        return length;
+    };
+
+    size_t baseLength = trimmed(entry.name, 8);
+    size_t extLength = trimmed(entry.name + 8, 3);
+    bool lowerBase = bool(entry.caseFlags & FatCaseFlags::eLowerBase);
+    bool lowerExt = bool(entry.caseFlags & FatCaseFlags::eLowerExtension);
+
+    stdx::String result;
+    for (size_t i = 0; i < baseLength; i++) {
+        // a leading 0x05 stands in for 0xE5, which marks a deleted entry
+        char c = (i == 0 && uint8_t(entry.name[0]) == 0x05) ? char(0xE5) : entry.name[i];
+        result.add(lowerBase ? ToLower(c) : c);
+    }
+
+    if (extLength > 0) {
+        result.add('.');
+        for (size_t i = 0; i < extLength; i++) {
+            char c = entry.name[8 + i];
+            result.add(lowerExt ? ToLower(c) : c);
+        }
+    }
+
+    return result;
+}
+
+/// @brief Generate the basis of an 8.3 alias for a long name.
+///
+/// @return The length of the base part of the alias.
+static size_t FatBasisName(stdx::StringView name, char shortName[11]) {
+    std::fill_n(shortName, 11, ' ');
+
+    const char *dot = name.end();
+    for (const char *it = name.end(); it != name.begin() + 1; it--) {
+        if (*(it - 1) == '.') {
+            dot = it - 1;
+            break;
+        }
+    }
+
+    auto store = [](char c) {
+        if (uint8_t(c) >= 0x80) return '_';
+        char upper = ToUpper(c);
+        return IsShortNameChar(upper) ? upper : '_';
+    };
+
+    size_t length = 0;
+    for (const char *it = name.begin(); it != dot && length < 8; it++) {
+        if (*it == ' ' || *it == '.') continue;
+        shortName[length++] = store(*it);
+    }
+
+    if (length == 0) {
+        shortName[length++] = '_';
+    }
+
+    size_t ext = 0;
+    if (dot != name.end()) {
+        for (const char *it = dot + 1; it != name.end() && ext < 3; it++) {
+            if (*it == ' ' || *it == '.') continue;
+            shortName[8 + ext++] = store(*it);
+        }
+    }
+
+    return length;
+}
+
+//
+// block access
+//
+
+OsStatus FatFsDriver::readSectors(uint64_t sector, void *buffer, size_t count) {
+    return ConvertStatus(mDevice->read(sector, buffer, count));
+}
+
+OsStatus FatFsDriver::writeSectors(uint64_t sector, const void *buffer, size_t count) {
+    return ConvertStatus(mDevice->write(sector, buffer, count));
+}
+
+//
+// fat cache
+//
+
+OsStatus FatFsDriver::loadFatSector(uint32_t sector, std::byte **data) {
+    size_t index = sector % kFatCacheSlots;
+    FatCacheSlot& slot = mFatSlots[index];
+    std::byte *buffer = mFatCache.get() + (index * mBytesPerSector);
+
+    if (slot.sector == sector) {
+        mStats.cacheHits += 1;
+        *data = buffer;
+        return OsStatusSuccess;
+    }
+
+    mStats.cacheMisses += 1;
+
+    if (OsStatus status = writeBackSlot(index)) {
+        return status;
+    }
+
+    uint64_t fat = mMirrorFat ? 0 : mActiveFat;
+    if (OsStatus status = readSectors(mFatStart + (fat * mFatSectors) + sector, buffer, 1)) {
+        slot.sector = UINT32_MAX;
+        return status;
+    }
+
+    slot = FatCacheSlot { sector, false };
+    *data = buffer;
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsDriver::writeBackSlot(size_t index) {
+    FatCacheSlot& slot = mFatSlots[index];
+    if (!slot.dirty) {
+        return OsStatusSuccess;
+    }
+
+    const std::byte *buffer = mFatCache.get() + (index * mBytesPerSector);
+
+    for (uint8_t fat = 0; fat < mFatCount; fat++) {
+        if (!mMirrorFat && fat != mActiveFat) {
+            continue;
+        }
+
+        if (OsStatus status = writeSectors(mFatStart + (uint64_t(fat) * mFatSectors) + slot.sector, buffer, 1)) {
+            return status;
+        }
+    }
+
+    slot.dirty = false;
+    mStats.cacheWriteBacks += 1;
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsDriver::readFat(FatCluster cluster, FatCluster *next) {
+    uint64_t offset = uint64_t(cluster) * sizeof(uint32_t);
+    std::byte *data = nullptr;
+    if (OsStatus status = loadFatSector(offset / mBytesPerSector, &data)) {
+        return status;
+    }
+
+    uint32_t value;
+    std::memcpy(&value, data + (offset % mBytesPerSector), sizeof(value));
+    *next = value & kFatClusterMask;
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsDriver::writeFat(FatCluster cluster, FatCluster next) {
+    uint64_t offset = uint64_t(cluster) * sizeof(uint32_t);
+    uint32_t sector = offset / mBytesPerSector;
+    std::byte *data = nullptr;
+    if (OsStatus status = loadFatSector(sector, &data)) {
+        return status;
+    }
+
+    // the top 4 bits of an entry are reserved and must be preserved
+    uint32_t value;
+    std::memcpy(&value, data + (offset % mBytesPerSector), sizeof(value));
+    value = (value & ~kFatClusterMask) | (next & kFatClusterMask);
+    std::memcpy(data + (offset % mBytesPerSector), &value, sizeof(value));
+
+    mFatSlots[sector % kFatCacheSlots].dirty = true;
+    return OsStatusSuccess;
+}
+
+//
+// free cluster tracking
+//
+
+OsStatus FatFsDriver::buildUsedMap() {
+    size_t words = (size_t(mClusterCount) + kFatFirstCluster + 63) / 64;
+    mUsedMap.reset(new (std::nothrow) uint64_t[words]);
+    std::unique_ptr<std::byte[]> buffer{new (std::nothrow) std::byte[kScanSectors * mBytesPerSector]};
+    if (!mUsedMap || !buffer) {
+        return OsStatusOutOfMemory;
+    }
+
+    std::fill_n(mUsedMap.get(), words, UINT64_MAX);
+
+    uint32_t entriesPerSector = mBytesPerSector / sizeof(uint32_t);
+    uint64_t end = uint64_t(mClusterCount) + kFatFirstCluster;
+    uint32_t sectors = (end + entriesPerSector - 1) / entriesPerSector;
+    uint64_t fat = mFatStart + (mMirrorFat ? 0 : uint64_t(mActiveFat) * mFatSectors);
+
+    mFreeCount = 0;
+
+    for (uint32_t sector = 0; sector < sectors; sector += kScanSectors) {
+        uint32_t count = std::min(kScanSectors, sectors - sector);
+        if (OsStatus status = readSectors(fat + sector, buffer.get(), count)) {
+            return status;
+        }
+
+        uint64_t first = uint64_t(sector) * entriesPerSector;
+        uint64_t last = std::min(end, first + uint64_t(count) * entriesPerSector);
+        for (uint64_t cluster = std::max<uint64_t>(first, kFatFirstCluster); cluster < last; cluster++) {
+            uint32_t value;
+            std::memcpy(&value, buffer.get() + (cluster - first) * sizeof(uint32_t), sizeof(value));
+            if ((value & kFatClusterMask) == kFatFreeCluster) {
+                markUsed(cluster, false);
+                mFreeCount += 1;
+            }
+        }
+    }
+
+    return OsStatusSuccess;
+}
+
+void FatFsDriver::markUsed(FatCluster cluster, bool used) {
+    uint64_t bit = uint64_t(1) << (cluster % 64);
+    if (used) {
+        mUsedMap[cluster / 64] |= bit;
+    } else {
+        mUsedMap[cluster / 64] &= ~bit;
+    }
+}
+
+bool FatFsDriver::isUsed(FatCluster cluster) const {
+    return mUsedMap[cluster / 64] & (uint64_t(1) << (cluster % 64));
+}
+
+FatCluster FatFsDriver::findFreeCluster(FatCluster hint) const {
+    if (mFreeCount == 0) {
+        return kFatFreeCluster;
+    }
+
+    if (!isValidCluster(hint)) {
+        hint = kFatFirstCluster;
+    }
+
+    size_t words = (size_t(mClusterCount) + kFatFirstCluster + 63) / 64;
+    size_t start = hint / 64;
+
+    //
+    // Search from the hint so that files grow into the clusters following
+    // their last cluster, the final iteration revisits the first word to
+    // find any clusters below the hint.
+    //
+    for (size_t i = 0; i <= words; i++) {
+        size_t index = (start + i) % words;
+        uint64_t used = mUsedMap[index];
+        if (i == 0) {
+            used |= (uint64_t(1) << (hint % 64)) - 1;
+        }
+
+        if (~used != 0) {
+            return FatCluster(index * 64 + std::countr_zero(~used));
+        }
+    }
+
+    return kFatFreeCluster;
+}
+
+//
+// cluster chains
+//
+
+OsStatus FatFsDriver::mapCluster(FatClusterMap& map, uint32_t index, FatExtent *extent [[outparam]]) {
+    //
+    // Extend the mapped region of the chain until it covers the requested
+    // cluster. Every FAT entry of a chain is read at most once.
+    //
+    while (index >= map.mappedCount()) {
+        if (map.mComplete) {
+            return OsStatusEndOfFile;
+        }
+
+        FatCluster next = map.mFirst;
+        if (!map.mExtents.isEmpty()) {
+            FatExtent& tail = map.mExtents.back();
+            if (OsStatus status = readFat(tail.cluster + tail.count - 1, &next)) {
+                return status;
+            }
+
+            mStats.chainReads += 1;
+
+            if (IsFatEndOfChain(next)) {
+                map.mComplete = true;
+                return OsStatusEndOfFile;
+            }
+        }
+
+        if (!isValidCluster(next) || map.mappedCount() >= mClusterCount) {
+            return OsStatusInvalidData;
+        }
+
+        if (!map.mExtents.isEmpty() && map.mExtents.back().cluster + map.mExtents.back().count == next) {
+            map.mExtents.back().count += 1;
+        } else if (OsStatus status = map.mExtents.add(FatExtent { map.mappedCount(), next, 1 })) {
+            return status;
+        }
+    }
+
+    auto it = std::upper_bound(map.mExtents.begin(), map.mExtents.end(), index, [](uint32_t index, const FatExtent& extent) {
+        return index < extent.index;
+    });
+
+    *extent = *(it - 1);
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsDriver::mapComplete(FatClusterMap& map) {
+    while (!map.mComplete) {
+        FatExtent extent;
+        OsStatus status = mapCluster(map, map.mappedCount(), &extent);
+        if (status == OsStatusEndOfFile) {
+            break;
+        }
+
+        if (status != OsStatusSuccess) {
+            return status;
+        }
+    }
+
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsDriver::appendCluster(FatClusterMap& map, bool zero) {
+    if (OsStatus status = mapComplete(map)) {
+        return status;
+    }
+
+    FatCluster tail = map.mExtents.isEmpty() ? kFatFreeCluster : map.mExtents.back().cluster + map.mExtents.back().count - 1;
+    FatCluster cluster = findFreeCluster(tail != kFatFreeCluster ? tail + 1 : mNextFree);
+    if (cluster == kFatFreeCluster) {
+        return OsStatusOutOfMemory;
+    }
+
+    if (map.mExtents.isEmpty() || tail + 1 != cluster) {
+        if (OsStatus status = map.mExtents.add(FatExtent { map.mappedCount(), cluster, 0 })) {
+            return status;
+        }
+    }
+
+    if (zero) {
+        std::memset(mBuffer.get(), 0, mClusterSize);
+        if (OsStatus status = writeSectors(clusterSector(cluster), mBuffer.get(), mSectorsPerCluster)) {
+            return status;
+        }
+    }
+
+    //
+    // Terminate the new cluster before linking it so the chain is never
+    // left pointing at a cluster that is still marked free.
+    //
+    if (OsStatus status = writeFat(cluster, kFatEndOfChain)) {
+        return status;
+    }
+
+    if (tail != kFatFreeCluster) {
+        if (OsStatus status = writeFat(tail, cluster)) {
+            return status;
+        }
+    } else {
+        map.mFirst = cluster;
+    }
+
+    map.mExtents.back().count += 1;
+    map.mComplete = true;
+
+    markUsed(cluster, true);
+    mFreeCount -= 1;
+    mNextFree = cluster + 1;
+    mInfoDirty = true;
+
+    return OsStatusSuccess;
+}
+
+//
+// data transfer
+//
+
+OsStatus FatFsDriver::transfer(FatNode& node, uint64_t offset, std::byte *buffer, size_t size, bool write) {
+    while (size > 0) {
+        uint32_t index = offset / mClusterSize;
+        uint32_t within = offset % mClusterSize;
+
+        FatExtent extent;
+        if (OsStatus status = mapCluster(node.clusters, index, &extent)) {
+            return status;
+        }
+
+        uint32_t skip = index - extent.index;
+        FatCluster cluster = extent.cluster + skip;
+
+        if (within == 0 && size >= mClusterSize && buffer != nullptr) {
+            //
+            // Whole clusters are transferred directly, a contiguous run of
+            // clusters is a single request to the device.
+            //
+            uint32_t count = std::min<uint64_t>(extent.count - skip, size / mClusterSize);
+            uint64_t sector = clusterSector(cluster);
+            size_t bytes = size_t(count) * mClusterSize;
+
+            OsStatus status = write
+                ? writeSectors(sector, buffer, size_t(count) * mSectorsPerCluster)
+                : readSectors(sector, buffer, size_t(count) * mSectorsPerCluster);
+
+            if (status != OsStatusSuccess) {
+                return status;
+            }
+
+            buffer += bytes;
+            offset += bytes;
+            size -= bytes;
+            continue;
+        }
+
+        //
+        // Partial clusters only transfer the sectors they touch.
+        //
+        size_t chunk = std::min<size_t>(size, mClusterSize - within);
+        uint32_t first = within / mBytesPerSector;
+        uint32_t last = (within + chunk - 1) / mBytesPerSector;
+        uint32_t count = last - first + 1;
+        uint64_t sector = clusterSector(cluster) + first;
+        std::byte *scratch = mBuffer.get();
+        size_t position = within - (first * mBytesPerSector);
+
+        if (OsStatus status = readSectors(sector, scratch, count)) {
+            return status;
+        }
+
+        if (write) {
+            if (buffer != nullptr) {
+                std::memcpy(scratch + position, buffer, chunk);
+            } else {
+                std::memset(scratch + position, 0, chunk);
+            }
+
+            if (OsStatus status = writeSectors(sector, scratch, count)) {
+                return status;
+            }
+        } else {
+            std::memcpy(buffer, scratch + position, chunk);
+        }
+
+        if (buffer != nullptr) {
+            buffer += chunk;
+        }
+
+        offset += chunk;
+        size -= chunk;
+    }
+
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsDriver::read(FatNode& node, uint64_t offset, void *buffer, size_t size, size_t *read [[outparam]]) {
+    if (node.folder) {
+        return OsStatusInvalidType;
+    }
+
+    if (offset >= node.size) {
+        *read = 0;
+        return OsStatusEndOfFile;
+    }
+
+    size = std::min<uint64_t>(size, node.size - offset);
+    if (OsStatus status = transfer(node, offset, static_cast<std::byte*>(buffer), size, false)) {
+        return status;
+    }
+
+    *read = size;
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsDriver::write(FatNode& node, uint64_t offset, const void *buffer, size_t size, size_t *written [[outparam]]) {
+    if (node.folder) {
+        return OsStatusInvalidType;
+    }
+
+    if (size == 0) {
+        *written = 0;
+        return OsStatusSuccess;
+    }
+
+    uint64_t end = offset + size;
+    if (end > UINT32_MAX) {
+        return OsStatusOutOfBounds;
+    }
+
+    if (OsStatus status = mapComplete(node.clusters)) {
+        return status;
+    }
+
+    FatCluster first = node.clusters.first();
+    uint32_t allocated = node.clusters.mappedCount();
+    uint32_t required = (end + mClusterSize - 1) / mClusterSize;
+
+    for (uint32_t index = allocated; index < required; index++) {
+        //
+        // Clusters that are only partly written are zeroed first so that
+        // any gap between the old end of the file and the write reads as zeros.
+        //
+        uint64_t front = uint64_t(index) * mClusterSize;
+        bool covered = front >= offset && front + mClusterSize <= end;
+        if (OsStatus status = appendCluster(node.clusters, !covered)) {
+            return status;
+        }
+    }
+
+    //
+    // Bytes between the old size and the write in clusters that were
+    // already allocated may contain stale data.
+    //
+    uint64_t allocatedEnd = uint64_t(allocated) * mClusterSize;
+    if (offset > node.size && node.size < allocatedEnd) {
+        uint64_t gap = std::min(offset, allocatedEnd) - node.size;
+        if (OsStatus status = transfer(node, node.size, nullptr, gap, true)) {
+            return status;
+        }
+    }
+
+    // the const_cast is sound as writes never modify the source buffer
+    if (OsStatus status = transfer(node, offset, const_cast<std::byte*>(static_cast<const std::byte*>(buffer)), size, true)) {
+        return status;
+    }
+
+    if (end > node.size || first != node.clusters.first()) {
+        node.size = std::max<uint64_t>(node.size, end);
+        if (OsStatus status = updateEntry(node)) {
+            return status;
+        }
+    }
+
+    *written = size;
+    return OsStatusSuccess;
+}
+
+//
+// folder entries
+//
+
+OsStatus FatFsDriver::writeEntry(FatEntryLocation location, const void *entry) {
+    if (OsStatus status = readSectors(location.sector, mBuffer.get(), 1)) {
+        return status;
+    }
+
+    std::memcpy(mBuffer.get() + location.offset, entry, kEntrySize);
+    return writeSectors(location.sector, mBuffer.get(), 1);
+}
+
+OsStatus FatFsDriver::updateEntry(const FatNode& node) {
+    if (!node.location.isPresent()) {
+        return OsStatusSuccess;
+    }
+
+    if (OsStatus status = readSectors(node.location.sector, mBuffer.get(), 1)) {
+        return status;
+    }
+
+    FatFolder entry;
+    std::memcpy(&entry, mBuffer.get() + node.location.offset, kEntrySize);
+
+    FatCluster cluster = node.clusters.first();
+    entry.firstClusterHigh = uint16_t(cluster >> 16);
+    entry.firstClusterLow = uint16_t(cluster & 0xFFFF);
+    entry.fileSize = node.folder ? 0 : node.size;
+
+    std::memcpy(mBuffer.get() + node.location.offset, &entry, kEntrySize);
+    return writeSectors(node.location.sector, mBuffer.get(), 1);
+}
+
+OsStatus FatFsDriver::entryLocation(FatNode& folder, uint32_t slot, FatEntryLocation *location) {
+    uint64_t offset = uint64_t(slot) * kEntrySize;
+
+    FatExtent extent;
+    if (OsStatus status = mapCluster(folder.clusters, offset / mClusterSize, &extent)) {
+        return status;
+    }
+
+    FatCluster cluster = extent.cluster + (offset / mClusterSize - extent.index);
+    uint32_t within = offset % mClusterSize;
+
+    *location = FatEntryLocation {
+        .sector = clusterSector(cluster) + (within / mBytesPerSector),
+        .offset = uint16_t(within % mBytesPerSector),
+    };
+
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsDriver::findFreeSlots(FatNode& folder, uint32_t count, uint32_t *slot) {
+    uint32_t perCluster = mClusterSize / kEntrySize;
+    uint32_t run = 0;
+    uint32_t start = 0;
+    uint32_t index = 0;
+
+    while (true) {
+        if (uint64_t(index) * perCluster >= kMaxFolderEntries) {
+            return OsStatusOutOfMemory;
+        }
+
+        FatExtent extent;
+        OsStatus status = mapCluster(folder.clusters, index, &extent);
+        if (status == OsStatusEndOfFile) {
+            //
+            // Grow the folder by a zeroed cluster, every entry in it is free.
+            //
+            if (OsStatus status = appendCluster(folder.clusters, true)) {
+                return status;
+            }
+
+            continue;
+        }
+
+        if (status != OsStatusSuccess) {
+            return status;
+        }
+
+        FatCluster cluster = extent.cluster + (index - extent.index);
+        if (OsStatus status = readSectors(clusterSector(cluster), mBuffer.get(), mSectorsPerCluster)) {
+            return status;
+        }
+
+        for (uint32_t i = 0; i < perCluster; i++) {
+            uint8_t first = uint8_t(mBuffer[i * kEntrySize]);
+            if (first != FatFolder::kEndOfFolder && first != FatFolder::kDeleted) {
+                run = 0;
+                continue;
+            }
+
+            if (run == 0) {
+                start = (index * perCluster) + i;
+            }
+
+            run += 1;
+            if (run == count) {
+                *slot = start;
+                return OsStatusSuccess;
+            }
+        }
+
+        index += 1;
+    }
+}
+
+OsStatus FatFsDriver::readFolder(FatNode& folder, stdx::Vector2<FatFolderEntry> *entries [[outparam]]) {
+    if (!folder.folder) {
+        return OsStatusInvalidType;
+    }
+
+    stdx::Vector2<FatFolderEntry> result;
+    uint32_t perCluster = mClusterSize / kEntrySize;
+
+    uint16_t longName[FatLongName::kNameLength * 20];
+    uint8_t longChecksum = 0;
+    uint8_t longExpected = 0;
+    size_t longLength = 0;
+    bool longValid = false;
+
+    for (uint32_t index = 0;; index++) {
+        FatExtent extent;
+        OsStatus status = mapCluster(folder.clusters, index, &extent);
+        if (status == OsStatusEndOfFile) {
+            break;
+        }
+
+        if (status != OsStatusSuccess) {
+            return status;
+        }
+
+        FatCluster cluster = extent.cluster + (index - extent.index);
+        if (OsStatus status = readSectors(clusterSector(cluster), mBuffer.get(), mSectorsPerCluster)) {
+            return status;
+        }
+
+        for (uint32_t i = 0; i < perCluster; i++) {
+            FatFolder entry;
+            std::memcpy(&entry, mBuffer.get() + (i * kEntrySize), kEntrySize);
+
+            uint8_t first = uint8_t(entry.name[0]);
+            if (first == FatFolder::kEndOfFolder) {
+                *entries = std::move(result);
+                return OsStatusSuccess;
+            }
+
+            if (first == FatFolder::kDeleted) {
+                longValid = false;
+                continue;
+            }
+
+            if ((entry.attributes & FatAttribute::eLongName) == FatAttribute::eLongName) {
+                //
+                // Long name entries precede their short entry in reverse order,
+                // the first one read carries the last part of the name.
+                //
+                FatLongName part;
+                std::memcpy(&part, &entry, kEntrySize);
+                uint8_t order = part.order & FatLongName::kOrderMask;
+
+                if (part.order & FatLongName::kLastEntry) {
+                    longValid = (order >= 1 && order <= 20);
+                    longExpected = order;
+                    longChecksum = part.checksum;
+                    longLength = order * FatLongName::kNameLength;
+                }
+
+                if (!longValid || order != longExpected || part.checksum != longChecksum) {
+                    longValid = false;
+                    continue;
+                }
+
+                uint16_t *dst = longName + (order - 1) * FatLongName::kNameLength;
+                for (size_t j = 0; j < 5; j++) *dst++ = part.name0[j];
+                for (size_t j = 0; j < 6; j++) *dst++ = part.name1[j];
+                for (size_t j = 0; j < 2; j++) *dst++ = part.name2[j];
+
+                longExpected -= 1;
+                continue;
+            }
+
+            bool hasLongName = longValid && longExpected == 0 && FatNameChecksum(entry.name) == longChecksum;
+            longValid = false;
+
+            if (bool(entry.attributes & FatAttribute::eVolumeId) || entry.name[0] == '.') {
+                continue;
+            }
+
+            uint32_t within = (index * perCluster + i) * kEntrySize % mClusterSize;
+            FatFolderEntry item {
+                .name = hasLongName ? DecodeLongName(std::span(longName, longLength)) : DecodeShortName(entry),
+                .entry = entry,
+                .location = FatEntryLocation {
+                    .sector = clusterSector(cluster) + (within / mBytesPerSector),
+                    .offset = uint16_t(within % mBytesPerSector),
+                },
+            };
+
+            if (OsStatus status = result.add(std::move(item))) {
+                return status;
+            }
+        }
+    }
+
+    *entries = std::move(result);
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsDriver::create(FatNode& folder, stdx::StringView name, bool isFolder, FatFolderEntry *entry [[outparam]]) {
+    if (!folder.folder) {
+        return OsStatusInvalidType;
+    }
+
+    if (!detail::IsValidFatName(name)) {
+        return OsStatusInvalidPath;
+    }
+
+    uint16_t units[kMaxLongName];
+    size_t unitCount = 0;
+    if (!EncodeLongName(name, units, &unitCount)) {
+        return OsStatusInvalidPath;
+    }
+
+    stdx::Vector2<FatFolderEntry> existing;
+    if (OsStatus status = readFolder(folder, &existing)) {
+        return status;
+    }
+
+    for (const FatFolderEntry& other : existing) {
+        if (EqualsIgnoreCase(other.name, name)) {
+            return OsStatusAlreadyExists;
+        }
+    }
+
+    FatFolder result{};
+    uint32_t longCount = 0;
+
+    if (!detail::FatShortName(name, result.name, &result.caseFlags)) {
+        //
+        // The name needs long name entries, pick the first numeric tail
+        // that gives an alias no other entry is using.
+        //
+        char basis[11];
+        size_t length = FatBasisName(name, basis);
+        bool found = false;
+
+        for (uint32_t n = 1; n < 1'000'000 && !found; n++) {
+            char tail[8];
+            size_t digits = 0;
+            for (uint32_t value = n; value != 0; value /= 10) {
+                tail[7 - digits++] = char('0' + (value % 10));
+            }
+
+            tail[7 - digits] = '~';
+            size_t tailLength = digits + 1;
+            size_t position = std::min(length, 8 - tailLength);
+
+            std::memcpy(result.name, basis, sizeof(basis));
+            std::memcpy(result.name + position, tail + 8 - tailLength, tailLength);
+
+            found = std::none_of(existing.begin(), existing.end(), [&](const FatFolderEntry& other) {
+                return std::memcmp(other.entry.name, result.name, sizeof(result.name)) == 0;
+            });
+        }
+
+        if (!found) {
+            return OsStatusAlreadyExists;
+        }
+
+        result.caseFlags = FatCaseFlags::eNone;
+        longCount = (unitCount + FatLongName::kNameLength - 1) / FatLongName::kNameLength;
+    }
+
+    uint32_t slot = 0;
+    if (OsStatus status = findFreeSlots(folder, longCount + 1, &slot)) {
+        return status;
+    }
+
+    FatClusterMap clusters;
+    if (isFolder) {
+        if (OsStatus status = appendCluster(clusters, true)) {
+            return status;
+        }
+
+        //
+        // The first cluster of a folder starts with the dot entries, '..'
+        // refers to the root folder as cluster 0.
+        //
+        FatCluster parent = (folder.clusters.first() == mRootCluster) ? 0 : folder.clusters.first();
+        FatFolder dots[2]{};
+        std::memcpy(dots[0].name, ".          ", 11);
+        std::memcpy(dots[1].name, "..         ", 11);
+
+        FatCluster targets[2] = { clusters.first(), parent };
+        for (size_t i = 0; i < 2; i++) {
+            dots[i].attributes = FatAttribute::eDirectory;
+            dots[i].creationDate = kEpochDate;
+            dots[i].lastWriteDate = kEpochDate;
+            dots[i].firstClusterHigh = uint16_t(targets[i] >> 16);
+            dots[i].firstClusterLow = uint16_t(targets[i] & 0xFFFF);
+        }
+
+        std::memset(mBuffer.get(), 0, mBytesPerSector);
+        std::memcpy(mBuffer.get(), dots, sizeof(dots));
+        if (OsStatus status = writeSectors(clusterSector(clusters.first()), mBuffer.get(), 1)) {
+            return status;
+        }
+    }
+
+    result.attributes = isFolder ? FatAttribute::eDirectory : FatAttribute::eArchive;
+    result.creationDate = kEpochDate;
+    result.lastAccessDate = kEpochDate;
+    result.lastWriteDate = kEpochDate;
+    result.firstClusterHigh = uint16_t(clusters.first() >> 16);
+    result.firstClusterLow = uint16_t(clusters.first() & 0xFFFF);
+    result.fileSize = 0;
+
+    uint8_t checksum = FatNameChecksum(result.name);
+    for (uint32_t i = 0; i < longCount; i++) {
+        uint8_t order = uint8_t(longCount - i);
+
+        FatLongName part{};
+        part.order = order | (i == 0 ? FatLongName::kLastEntry : 0);
+        part.attributes = FatAttribute::eLongName;
+        part.checksum = checksum;
+
+        //
+        // The name is terminated by a null character if there is space,
+        // and any remaining characters are padded with 0xFFFF.
+        //
+        auto unit = [&](size_t j) -> uint16_t {
+            size_t index = (order - 1) * FatLongName::kNameLength + j;
+            if (index < unitCount) return units[index];
+            return (index == unitCount) ? 0x0000 : 0xFFFF;
+        };
+
+        for (size_t j = 0; j < 5; j++) part.name0[j] = unit(j);
+        for (size_t j = 0; j < 6; j++) part.name1[j] = unit(5 + j);
+        for (size_t j = 0; j < 2; j++) part.name2[j] = unit(11 + j);
+
+        FatEntryLocation location;
+        if (OsStatus status = entryLocation(folder, slot + i, &location)) {
+            return status;
+        }
+
+        if (OsStatus status = writeEntry(location, &part)) {
+            return status;
+        }
+    }
+
+    FatEntryLocation location;
+    if (OsStatus status = entryLocation(folder, slot + longCount, &location)) {
+        return status;
+    }
+
+    if (OsStatus status = writeEntry(location, &result)) {
+        return status;
+    }
+
+    *entry = FatFolderEntry {
+        .name = stdx::String(name),
+        .entry = result,
+        .location = location,
+    };
+
+    return OsStatusSuccess;
+}
+
+//
+// volume
+//
+
+FatNode FatFsDriver::rootNode() const {
+    return FatNode {
+        .clusters = FatClusterMap(mRootCluster),
+        .size = 0,
+        .folder = true,
+        .location = {},
+    };
+}
+
+FatNode FatFsDriver::openNode(const FatFolderEntry& entry) const {
+    return FatNode {
+        .clusters = FatClusterMap(entry.cluster()),
+        .size = entry.isFolder() ? 0 : uint32_t(entry.entry.fileSize),
+        .folder = entry.isFolder(),
+        .location = entry.location,
+    };
+}
+
+OsStatus FatFsDriver::sync() {
+    for (size_t i = 0; i < kFatCacheSlots; i++) {
+        if (OsStatus status = writeBackSlot(i)) {
+            return status;
+        }
+    }
+
+    if (!mInfoDirty || mInfoSector == 0 || mInfoSector == 0xFFFF) {
+        return OsStatusSuccess;
+    }
+
+    if (OsStatus status = readSectors(mInfoSector, mBuffer.get(), 1)) {
+        return status;
+    }
+
+    FatInfo info;
+    std::memcpy(&info, mBuffer.get(), sizeof(info));
+
+    if (info.leadSignature == FatInfo::kLeadSignature && info.structureSignature == FatInfo::kStructureSignature) {
+        info.freeClusterCount = mFreeCount;
+        info.nextFreeCluster = mNextFree;
+        std::memcpy(mBuffer.get(), &info, sizeof(info));
+
+        if (OsStatus status = writeSectors(mInfoSector, mBuffer.get(), 1)) {
+            return status;
+        }
+    }
+
+    mInfoDirty = false;
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsDriver::create(IBlockDriver *device, FatFsDriver *driver [[outparam]]) {
+    BlockDeviceCapability capability = device->capability();
+    if (capability.blockSize < sizeof(FatBootSector)) {
+        return OsStatusNotSupported;
+    }
+
+    std::unique_ptr<std::byte[]> sector{new (std::nothrow) std::byte[capability.blockSize]};
+    if (!sector) {
+        return OsStatusOutOfMemory;
+    }
+
+    if (OsStatus status = ConvertStatus(device->read(0, sector.get(), 1))) {
+        return status;
+    }
+
+    FatBootSector boot;
+    std::memcpy(&boot, sector.get(), sizeof(boot));
+
+    if (boot.bootSignature != MasterBootRecord::kSignature) {
+        return OsStatusInvalidData;
+    }
+
+    if (boot.bytesPerSector != capability.blockSize) {
+        return OsStatusNotSupported;
+    }
+
+    //
+    // FAT32 volumes have no fixed size root folder and only record
+    // the size of the FAT in the 32 bit field.
+    //
+    if (boot.rootEntryCount != 0 || boot.sectorsPerFat16 != 0 || boot.sectorsPerFat32 == 0) {
+        return OsStatusInvalidData;
+    }
+
+    if (boot.fatCount == 0 || boot.sectorsPerCluster == 0 || !std::has_single_bit(boot.sectorsPerCluster)) {
+        return OsStatusInvalidData;
+    }
+
+    uint64_t totalSectors = (boot.totalSectors16 != 0) ? boot.totalSectors16 : boot.totalSectors32;
+    if (totalSectors > capability.blockCount) {
+        return OsStatusInvalidData;
+    }
+
+    FatFsDriver result;
+    result.mDevice = device;
+    result.mBytesPerSector = boot.bytesPerSector;
+    result.mSectorsPerCluster = boot.sectorsPerCluster;
+    result.mClusterSize = result.mBytesPerSector * result.mSectorsPerCluster;
+    result.mFatStart = boot.reservedSectors;
+    result.mFatSectors = boot.sectorsPerFat32;
+    result.mFatCount = boot.fatCount;
+    result.mMirrorFat = !(boot.flags & kNoFatMirroring);
+    result.mActiveFat = boot.flags & kActiveFatMask;
+    result.mDataStart = result.mFatStart + uint64_t(result.mFatCount) * result.mFatSectors;
+    result.mRootCluster = boot.rootCluster;
+    result.mInfoSector = boot.fsInfoSector;
+
+    if (result.mDataStart >= totalSectors || result.mActiveFat >= result.mFatCount) {
+        return OsStatusInvalidData;
+    }
+
+    // the cluster count is limited by both the data region and the size of the FAT
+    uint64_t dataClusters = (totalSectors - result.mDataStart) / result.mSectorsPerCluster;
+    uint64_t fatEntries = (uint64_t(result.mFatSectors) * result.mBytesPerSector / sizeof(uint32_t)) - kFatFirstCluster;
+    result.mClusterCount = std::min({ dataClusters, fatEntries, uint64_t(kFatBadCluster - kFatFirstCluster) });
+
+    if (!result.isValidCluster(result.mRootCluster)) {
+        return OsStatusInvalidData;
+    }
+
+    result.mFatCache.reset(new (std::nothrow) std::byte[kFatCacheSlots * result.mBytesPerSector]);
+    result.mBuffer.reset(new (std::nothrow) std::byte[result.mClusterSize]);
+    if (!result.mFatCache || !result.mBuffer) {
+        return OsStatusOutOfMemory;
+    }
+
+    if (OsStatus status = result.buildUsedMap()) {
+        return status;
+    }
+
+    //
+    // The next free hint in the info sector is only advisory, the used map
+    // is always authoritative.
+    //
+    if (result.mInfoSector != 0 && result.mInfoSector != 0xFFFF) {
+        if (OsStatus status = result.readSectors(result.mInfoSector, result.mBuffer.get(), 1)) {
+            return status;
+        }
+
+        FatInfo info;
+        std::memcpy(&info, result.mBuffer.get(), sizeof(info));
+        if (info.leadSignature == FatInfo::kLeadSignature && info.structureSignature == FatInfo::kStructureSignature) {
+            if (result.isValidCluster(info.nextFreeCluster)) {
+                result.mNextFree = info.nextFreeCluster;
+            }
+
+            result.mInfoDirty = (info.freeClusterCount == kUnknownFreeCount) || (info.freeClusterCount != result.mFreeCount);
+        }
+    }
+
+    *driver = std::move(result);
+    return OsStatusSuccess;
+}
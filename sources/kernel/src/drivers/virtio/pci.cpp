@@ -0,0 +1,224 @@
+#include "drivers/virtio/pci.hpp"
+#include "drivers/virtio/queue.hpp"
+
+#include "logger/categories.hpp"
+#include "memory/address_space.hpp"
+#include "panic.hpp"
+
+#include <emmintrin.h>
+
+using km::virtio::PciTransport;
+using km::virtio::DeviceStatus;
+using km::virtio::ConfigType;
+
+namespace {
+    /// @brief The location of a configuration structure described by a vendor capability.
+    struct ConfigLocation {
+        uint8_t bar;
+        uint32_t offset;
+        uint32_t length;
+
+        bool isPresent() const { return length != 0; }
+    };
+
+    // offsets of the fields in struct virtio_pci_cap
+    constexpr uint8_t kCapType = 3;
+    constexpr uint8_t kCapBar = 4;
+    constexpr uint8_t kCapOffset = 8;
+    constexpr uint8_t kCapLength = 12;
+    constexpr uint8_t kCapNotifyMultiplier = 16;
+}
+
+static ConfigLocation ReadConfigLocation(pci::IConfigSpace *config, pci::DeviceBusAddress address, uint8_t offset) {
+    auto [bus, slot, function] = address;
+    return ConfigLocation {
+        .bar = config->read8(bus, slot, function, offset + kCapBar),
+        .offset = config->read32(bus, slot, function, offset + kCapOffset),
+        .length = config->read32(bus, slot, function, offset + kCapLength),
+    };
+}
+
+static volatile void *MapConfigLocation(pci::IConfigSpace *config, pci::DeviceBusAddress address, km::AddressSpace& memory, ConfigLocation location) {
+    km::PhysicalAddressEx bar = pci::ReadMemoryBar(config, address, location.bar);
+    if (bar == km::PhysicalAddressEx::invalid() || bar.isNull()) {
+        PciLog.warnf("virtio BAR", location.bar, " is not a memory BAR");
+        return nullptr;
+    }
+
+    km::VmemAllocation allocation;
+    km::MemoryRangeEx range = km::MemoryRangeEx::of(bar + location.offset, location.length);
+    return memory.mapGenericObject(range, km::PageFlags::eData, km::MemoryType::eUncached, &allocation);
+}
+
+OsStatus PciTransport::create(pci::IConfigSpace *config, pci::DeviceBusAddress address, AddressSpace& memory, PciTransport *transport [[outparam]]) {
+    ConfigLocation common{}, notify{}, isr{}, device{};
+    uint32_t multiplier = 0;
+
+    // the first capability of each type is the preferred one
+    uint8_t offset = 0;
+    while ((offset = pci::FindCapability(config, address, pci::CapabilityId::eVendorSpecific, offset)) != 0) {
+        ConfigType type = ConfigType(config->read8(address.bus, address.slot, address.function, offset + kCapType));
+        ConfigLocation location = ReadConfigLocation(config, address, offset);
+
+        switch (type) {
+        case ConfigType::eCommon:
+            if (!common.isPresent()) common = location;
+            break;
+        case ConfigType::eNotify:
+            if (!notify.isPresent()) {
+                notify = location;
+                multiplier = config->read32(address.bus, address.slot, address.function, offset + kCapNotifyMultiplier);
+            }
+            break;
+        case ConfigType::eIsr:
+            if (!isr.isPresent()) isr = location;
+            break;
+        case ConfigType::eDevice:
+            if (!device.isPresent()) device = location;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (!common.isPresent() || !notify.isPresent() || !isr.isPresent()) {
+        return OsStatusNotSupported;
+    }
+
+    if (common.length < sizeof(CommonConfig)) {
+        return OsStatusNotSupported;
+    }
+
+    pci::EnableCommand(config, address, pci::DeviceCommand::eMemorySpace | pci::DeviceCommand::eBusMaster);
+
+    PciTransport result;
+    result.mCommon = static_cast<volatile CommonConfig*>(MapConfigLocation(config, address, memory, common));
+    result.mNotify = static_cast<volatile uint8_t*>(MapConfigLocation(config, address, memory, notify));
+    result.mIsr = static_cast<volatile uint8_t*>(MapConfigLocation(config, address, memory, isr));
+    result.mNotifyMultiplier = multiplier;
+
+    if (result.mCommon == nullptr || result.mNotify == nullptr || result.mIsr == nullptr) {
+        return OsStatusOutOfMemory;
+    }
+
+    if (device.isPresent()) {
+        result.mDevice = static_cast<volatile uint8_t*>(MapConfigLocation(config, address, memory, device));
+        if (result.mDevice == nullptr) {
+            return OsStatusOutOfMemory;
+        }
+
+        result.mDeviceLength = device.length;
+    }
+
+    *transport = result;
+    return OsStatusSuccess;
+}
+
+void PciTransport::select(uint16_t queue) noexcept {
+    mCommon->queueSelect = queue;
+}
+
+void PciTransport::reset() noexcept {
+    mCommon->deviceStatus = std::to_underlying(DeviceStatus::eReset);
+
+    // the reset is complete once the device reads back as reset
+    while (mCommon->deviceStatus != std::to_underlying(DeviceStatus::eReset)) {
+        _mm_pause();
+    }
+}
+
+DeviceStatus PciTransport::status() const noexcept {
+    return DeviceStatus(mCommon->deviceStatus);
+}
+
+void PciTransport::addStatus(DeviceStatus status) noexcept {
+    mCommon->deviceStatus = mCommon->deviceStatus | std::to_underlying(status);
+}
+
+OsStatus PciTransport::negotiate(uint64_t supported, uint64_t *features [[outparam]]) noexcept {
+    mCommon->deviceFeatureSelect = 0;
+    uint64_t offered = mCommon->deviceFeature;
+    mCommon->deviceFeatureSelect = 1;
+    offered |= uint64_t(mCommon->deviceFeature) << 32;
+
+    if (!(offered & kFeatureVersion1)) {
+        return OsStatusNotSupported;
+    }
+
+    uint64_t accepted = offered & (supported | kFeatureVersion1);
+
+    mCommon->driverFeatureSelect = 0;
+    mCommon->driverFeature = uint32_t(accepted);
+    mCommon->driverFeatureSelect = 1;
+    mCommon->driverFeature = uint32_t(accepted >> 32);
+
+    addStatus(DeviceStatus::eFeaturesOk);
+    if (!bool(status() & DeviceStatus::eFeaturesOk)) {
+        return OsStatusNotSupported;
+    }
+
+    *features = accepted;
+    return OsStatusSuccess;
+}
+
+uint16_t PciTransport::queueCount() const noexcept {
+    return mCommon->numQueues;
+}
+
+uint16_t PciTransport::maxQueueSize(uint16_t queue) noexcept {
+    select(queue);
+    return mCommon->queueSize;
+}
+
+void PciTransport::enableQueue(uint16_t queue, const VirtQueue& ring) noexcept {
+    uint64_t descriptors = ring.descriptorAddress().address;
+    uint64_t avail = ring.availAddress().address;
+    uint64_t used = ring.usedAddress().address;
+
+    select(queue);
+    mCommon->queueSize = ring.size();
+    mCommon->queueDescLow = uint32_t(descriptors);
+    mCommon->queueDescHigh = uint32_t(descriptors >> 32);
+    mCommon->queueDriverLow = uint32_t(avail);
+    mCommon->queueDriverHigh = uint32_t(avail >> 32);
+    mCommon->queueDeviceLow = uint32_t(used);
+    mCommon->queueDeviceHigh = uint32_t(used >> 32);
+    mCommon->queueEnable = 1;
+}
+
+volatile uint16_t *PciTransport::notifyRegister(uint16_t queue) noexcept {
+    select(queue);
+    uint32_t offset = uint32_t(mCommon->queueNotifyOff) * mNotifyMultiplier;
+    return reinterpret_cast<volatile uint16_t*>(mNotify + offset);
+}
+
+uint8_t PciTransport::configGeneration() const noexcept {
+    return mCommon->configGeneration;
+}
+
+uint8_t PciTransport::readDevice8(uint32_t offset) const noexcept {
+    KM_ASSERT(offset + sizeof(uint8_t) <= mDeviceLength);
+    return mDevice[offset];
+}
+
+uint16_t PciTransport::readDevice16(uint32_t offset) const noexcept {
+    KM_ASSERT(offset + sizeof(uint16_t) <= mDeviceLength);
+    return *reinterpret_cast<volatile const uint16_t*>(mDevice + offset);
+}
+
+uint32_t PciTransport::readDevice32(uint32_t offset) const noexcept {
+    KM_ASSERT(offset + sizeof(uint32_t) <= mDeviceLength);
+    return *reinterpret_cast<volatile const uint32_t*>(mDevice + offset);
+}
+
+uint64_t PciTransport::readDevice64(uint32_t offset) const noexcept {
+    while (true) {
+        uint8_t generation = configGeneration();
+        uint64_t low = readDevice32(offset);
+        uint64_t high = readDevice32(offset + sizeof(uint32_t));
+
+        if (generation == configGeneration()) {
+            return low | (high << 32);
+        }
+    }
+}
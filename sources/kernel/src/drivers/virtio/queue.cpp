@@ -0,0 +1,226 @@
+#include "drivers/virtio/queue.hpp"
+
+#include "panic.hpp"
+
+#include <atomic>
+#include <bit>
+
+using km::virtio::VirtQueue;
+using km::virtio::Descriptor;
+using km::virtio::DescriptorFlags;
+
+// The ring indices are shared with the device, stores to ring entries must be
+// visible before the index is published, and the index must be read before the
+// entries it covers.
+
+static uint16_t LoadShared(uint16_t& value) noexcept [[clang::nonblocking]] {
+    return std::atomic_ref(value).load(std::memory_order_acquire);
+}
+
+static void StoreShared(uint16_t& value, uint16_t data) noexcept [[clang::nonblocking]] {
+    std::atomic_ref(value).store(data, std::memory_order_release);
+}
+
+km::virtio::UsedElement& VirtQueue::usedRing(uint16_t index) noexcept [[clang::nonblocking]] {
+    UsedElement *ring = std::bit_cast<UsedElement*>(mUsed + 2);
+    return ring[index & (mSize - 1)];
+}
+
+uint16_t& VirtQueue::availEvent() noexcept [[clang::nonblocking]] {
+    return *std::bit_cast<uint16_t*>(&usedRing(0) + mSize);
+}
+
+sm::PhysicalAddress VirtQueue::physicalAddress(const void *ptr) const noexcept [[clang::nonblocking]] {
+    uintptr_t offset = std::bit_cast<uintptr_t>(ptr) - std::bit_cast<uintptr_t>(mDescriptors);
+    return mAddress + offset;
+}
+
+uint16_t VirtQueue::takeDescriptor() noexcept [[clang::nonblocking]] {
+    uint16_t index = mFreeHead;
+    mFreeHead = mDescriptors[index].next;
+    mFreeCount -= 1;
+    return index;
+}
+
+void VirtQueue::releaseChain(uint16_t head) noexcept [[clang::nonblocking]] {
+    uint16_t index = head;
+    while (true) {
+        Descriptor& descriptor = mDescriptors[index];
+        mFreeCount += 1;
+
+        if (!bool(descriptor.flags & DescriptorFlags::eNext)) {
+            break;
+        }
+
+        index = descriptor.next;
+    }
+
+    mDescriptors[index].next = mFreeHead;
+    mFreeHead = head;
+    mTokens[head] = nullptr;
+}
+
+OsStatus VirtQueue::create(uint16_t size, uint16_t indirect, bool eventIndex, void *memory, sm::PhysicalAddress address, VirtQueue *queue [[outparam]]) {
+    if (size == 0 || !std::has_single_bit(size)) {
+        return OsStatusInvalidInput;
+    }
+
+    QueueLayout layout = QueueLayout::of(size, indirect);
+    std::byte *base = static_cast<std::byte*>(memory);
+
+    VirtQueue result;
+    result.mSize = size;
+    result.mIndirectLength = indirect;
+    result.mEventIndex = eventIndex;
+    result.mDescriptors = std::bit_cast<Descriptor*>(base + layout.descriptors);
+    result.mAvail = std::bit_cast<uint16_t*>(base + layout.avail);
+    result.mUsed = std::bit_cast<uint16_t*>(base + layout.used);
+    result.mIndirect = (indirect != 0) ? std::bit_cast<Descriptor*>(base + layout.indirect) : nullptr;
+    result.mTokens = std::bit_cast<void**>(base + layout.tokens);
+    result.mAddress = address;
+    result.mLayout = layout;
+
+    for (uint16_t i = 0; i < size; i++) {
+        result.mDescriptors[i].next = i + 1;
+        result.mTokens[i] = nullptr;
+    }
+
+    result.mFreeHead = 0;
+    result.mFreeCount = size;
+
+    *queue = result;
+    return OsStatusSuccess;
+}
+
+bool VirtQueue::canAdd(size_t count) const noexcept [[clang::nonblocking]] {
+    if (count == 0) {
+        return false;
+    }
+
+    if (count > 1 && count <= mIndirectLength) {
+        return mFreeCount >= 1;
+    }
+
+    return mFreeCount >= count;
+}
+
+OsStatus VirtQueue::add(std::span<const QueueBuffer> buffers, void *token) noexcept [[clang::nonblocking]] {
+    KM_ASSERT(token != nullptr);
+
+    if (buffers.empty()) {
+        return OsStatusInvalidInput;
+    }
+
+    if (!canAdd(buffers.size())) {
+        return OsStatusOutOfMemory;
+    }
+
+    auto fill = [&](Descriptor& descriptor, const QueueBuffer& buffer, bool last, uint16_t next) {
+        DescriptorFlags flags = buffer.writable ? DescriptorFlags::eWrite : DescriptorFlags::eNone;
+        if (!last) {
+            flags |= DescriptorFlags::eNext;
+        }
+
+        descriptor.address = buffer.address.address;
+        descriptor.length = buffer.length;
+        descriptor.flags = flags;
+        descriptor.next = next;
+    };
+
+    uint16_t head;
+    if (buffers.size() > 1 && buffers.size() <= mIndirectLength) {
+        head = takeDescriptor();
+
+        // the indirect table for a head is only used by that head, so it is
+        // free whenever the head descriptor is.
+        Descriptor *table = indirectTable(head);
+        for (size_t i = 0; i < buffers.size(); i++) {
+            bool last = (i == buffers.size() - 1);
+            fill(table[i], buffers[i], last, last ? 0 : uint16_t(i + 1));
+        }
+
+        Descriptor& descriptor = mDescriptors[head];
+        descriptor.address = physicalAddress(table).address;
+        descriptor.length = sizeof(Descriptor) * buffers.size();
+        descriptor.flags = DescriptorFlags::eIndirect;
+    } else {
+        head = mFreeHead;
+
+        uint16_t index = head;
+        for (size_t i = 0; i < buffers.size(); i++) {
+            bool last = (i == buffers.size() - 1);
+            uint16_t current = takeDescriptor();
+            KM_ASSERT(current == index);
+
+            // the free list is already linked through the next field
+            index = mDescriptors[current].next;
+            fill(mDescriptors[current], buffers[i], last, index);
+        }
+    }
+
+    mTokens[head] = token;
+    availRing(mAvailIndex) = head;
+    mAvailIndex += 1;
+
+    return OsStatusSuccess;
+}
+
+bool VirtQueue::publish() noexcept [[clang::nonblocking]] {
+    uint16_t previous = mPublishedIndex;
+    uint16_t next = mAvailIndex;
+    if (previous == next) {
+        return false;
+    }
+
+    StoreShared(availIndex(), next);
+    mPublishedIndex = next;
+
+    // the device may be checking for new buffers concurrently, the index store
+    // must be visible before the suppression state is read.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (mEventIndex) {
+        return NeedEvent(LoadShared(availEvent()), next, previous);
+    }
+
+    return !(LoadShared(usedFlags()) & kUsedNoNotify);
+}
+
+void *VirtQueue::popUsed(uint32_t *length [[outparam]]) noexcept [[clang::nonblocking]] {
+    if (mLastUsed == LoadShared(usedIndex())) {
+        return nullptr;
+    }
+
+    UsedElement element = usedRing(mLastUsed);
+    mLastUsed += 1;
+
+    KM_ASSERT(element.id < mSize);
+
+    void *token = mTokens[element.id];
+    KM_ASSERT(token != nullptr);
+
+    releaseChain(element.id);
+    *length = element.length;
+    return token;
+}
+
+void VirtQueue::disableInterrupts() noexcept [[clang::nonblocking]] {
+    if (mEventIndex) {
+        // as far behind as possible, the device will not reach it until the ring wraps
+        StoreShared(usedEvent(), mLastUsed - 1 - 0x8000);
+    } else {
+        StoreShared(availFlags(), kAvailNoInterrupt);
+    }
+}
+
+bool VirtQueue::enableInterrupts() noexcept [[clang::nonblocking]] {
+    if (mEventIndex) {
+        StoreShared(usedEvent(), mLastUsed);
+    } else {
+        StoreShared(availFlags(), 0);
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    return mLastUsed != LoadShared(usedIndex());
+}
@@ -0,0 +1,305 @@
+#include "fs/fatfs.hpp"
+#include "fs/file.hpp"
+#include "fs/identify.hpp"
+#include "fs/iterator.hpp"
+#include "fs/query.hpp"
+#include "fs/utils.hpp"
+#include "logger/logger.hpp"
+
+using namespace vfs;
+
+static constinit km::Logger FatLog { "FATFS" };
+
+//
+// fatfs node implementation
+//
+
+FatFsNode::FatFsNode(sm::RcuWeakPtr<INode> parent, FatFsMount *mount, VfsString name, km::FatNode state)
+    : BasicNode(parent, mount, std::move(name))
+    , mVolume(mount)
+    , mState(std::move(state))
+{ }
+
+//
+// fatfs file implementation
+//
+
+static constexpr inline InterfaceList kFileInterfaceList = std::to_array({
+    InterfaceOf<TIdentifyHandle<FatFsFile>, FatFsFile>(kOsIdentifyGuid),
+    InterfaceOf<TFileHandle<FatFsFile>, FatFsFile>(kOsFileGuid),
+});
+
+OsStatus FatFsFile::query(sm::uuid uuid, const void *data, size_t size, IHandle **handle) {
+    return kFileInterfaceList.query(loanShared(), uuid, data, size, handle);
+}
+
+OsStatus FatFsFile::interfaces(OsIdentifyInterfaceList *list) {
+    return kFileInterfaceList.list(list);
+}
+
+OsStatus FatFsFile::read(ReadRequest request, ReadResult *result) {
+    return mVolume->read(mState, request, result);
+}
+
+OsStatus FatFsFile::write(WriteRequest request, WriteResult *result) {
+    return mVolume->write(mState, request, result);
+}
+
+OsStatus FatFsFile::stat(OsFileInfo *stat) {
+    return mVolume->stat(mState, stat);
+}
+
+//
+// fatfs folder implementation
+//
+
+static constexpr inline InterfaceList kFolderInterfaceList = std::to_array({
+    InterfaceOf<TIdentifyHandle<FatFsFolder>, FatFsFolder>(kOsIdentifyGuid),
+    InterfaceOf<TFolderHandle<FatFsFolder>, FatFsFolder>(kOsFolderGuid),
+    InterfaceOf<TIteratorHandle<FatFsFolder>, FatFsFolder>(kOsIteratorGuid),
+});
+
+OsStatus FatFsFolder::query(sm::uuid uuid, const void *data, size_t size, IHandle **handle) {
+    return kFolderInterfaceList.query(loanShared(), uuid, data, size, handle);
+}
+
+OsStatus FatFsFolder::interfaces(OsIdentifyInterfaceList *list) {
+    return kFolderInterfaceList.list(list);
+}
+
+OsStatus FatFsFolder::load() {
+    if (mLoaded.load(std::memory_order_acquire)) {
+        return OsStatusSuccess;
+    }
+
+    stdx::LockGuard guard(mLoadLock);
+    if (mLoaded.load(std::memory_order_relaxed)) {
+        return OsStatusSuccess;
+    }
+
+    stdx::Vector2<km::FatFolderEntry> entries;
+    if (OsStatus status = mVolume->readFolder(mState, &entries)) {
+        FatLog.warnf("Failed to read folder '", mName, "' : ", OsStatusId(status));
+        return status;
+    }
+
+    for (const km::FatFolderEntry& entry : entries) {
+        sm::RcuSharedPtr<INode> child = mVolume->makeNode(loanWeak(), entry);
+        if (!child) {
+            return OsStatusOutOfMemory;
+        }
+
+        //
+        // Names that only differ by case can only exist on a corrupt
+        // volume, the first entry is kept.
+        //
+        if (OsStatus status = FolderMixin::mknode(loanWeak(), entry.name, child)) {
+            FatLog.warnf("Failed to add entry '", entry.name, "' : ", OsStatusId(status));
+        }
+    }
+
+    mLoaded.store(true, std::memory_order_release);
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsFolder::lookup(VfsStringView name, sm::RcuSharedPtr<INode> *child) {
+    if (OsStatus status = load()) {
+        return status;
+    }
+
+    return FolderMixin::lookup(name, child);
+}
+
+OsStatus FatFsFolder::mknode(sm::RcuWeakPtr<INode> parent, VfsStringView name, sm::RcuSharedPtr<INode> child) {
+    //
+    // Nodes from other filesystems, such as mount points, are only
+    // kept in memory and are never written to the volume.
+    //
+    if (OsStatus status = load()) {
+        return status;
+    }
+
+    return FolderMixin::mknode(parent, name, child);
+}
+
+OsStatus FatFsFolder::rmnode(sm::RcuSharedPtr<INode>) {
+    return OsStatusFunctionNotSupported;
+}
+
+OsStatus FatFsFolder::next(Iterator *iterator, sm::RcuSharedPtr<INode> *node) {
+    if (OsStatus status = load()) {
+        return status;
+    }
+
+    return FolderMixin::next(iterator, node);
+}
+
+OsStatus FatFsFolder::create(VfsStringView name, bool isFolder, sm::RcuSharedPtr<INode> *node) {
+    //
+    // The folder must be loaded before the entry is written, otherwise
+    // the entry would be added a second time when the folder is loaded.
+    //
+    if (OsStatus status = load()) {
+        return status;
+    }
+
+    km::FatFolderEntry entry;
+    if (OsStatus status = mVolume->createEntry(mState, name, isFolder, &entry)) {
+        return status;
+    }
+
+    sm::RcuSharedPtr<INode> child = mVolume->makeNode(loanWeak(), entry);
+    if (!child) {
+        return OsStatusOutOfMemory;
+    }
+
+    if (OsStatus status = FolderMixin::mknode(loanWeak(), name, child)) {
+        return status;
+    }
+
+    *node = child;
+    return OsStatusSuccess;
+}
+
+//
+// fatfs mount implementation
+//
+
+FatFsMount::FatFsMount(FatFs *fatfs, sm::RcuDomain *domain, sm::SharedPtr<km::IBlockDriver> block, km::FatFsDriver volume)
+    : IVfsMount(fatfs, domain)
+    , mBlock(block)
+    , mVolume(std::move(volume))
+    , mRootNode(sm::rcuMakeShared<FatFsFolder>(mDomain, nullptr, this, "", mVolume.rootNode()))
+{ }
+
+FatFsMount::~FatFsMount() {
+    if (OsStatus status = sync()) {
+        FatLog.errorf("Failed to sync volume: ", OsStatusId(status));
+    }
+}
+
+OsStatus FatFsMount::read(km::FatNode& node, ReadRequest request, ReadResult *result) {
+    stdx::LockGuard guard(mLock);
+
+    size_t read = 0;
+    OsStatus status = mVolume.read(node, request.offset, request.begin, request.size(), &read);
+    result->read = read;
+    return status;
+}
+
+OsStatus FatFsMount::write(km::FatNode& node, WriteRequest request, WriteResult *result) {
+    stdx::LockGuard guard(mLock);
+
+    size_t written = 0;
+    OsStatus status = mVolume.write(node, request.offset, request.begin, request.size(), &written);
+    result->write = written;
+    return status;
+}
+
+OsStatus FatFsMount::stat(km::FatNode& node, OsFileInfo *stat) {
+    stdx::LockGuard guard(mLock);
+
+    uint32_t clusterSize = mVolume.clusterSize();
+    *stat = OsFileInfo {
+        .LogicalSize = node.size,
+        .BlockSize = clusterSize,
+        .BlockCount = sm::roundup<uint64_t>(node.size, clusterSize) / clusterSize,
+    };
+
+    return OsStatusSuccess;
+}
+
+OsStatus FatFsMount::readFolder(km::FatNode& folder, stdx::Vector2<km::FatFolderEntry> *entries) {
+    stdx::LockGuard guard(mLock);
+    return mVolume.readFolder(folder, entries);
+}
+
+OsStatus FatFsMount::createEntry(km::FatNode& folder, VfsStringView name, bool isFolder, km::FatFolderEntry *entry) {
+    stdx::LockGuard guard(mLock);
+    return mVolume.create(folder, name, isFolder, entry);
+}
+
+sm::RcuSharedPtr<INode> FatFsMount::makeNode(sm::RcuWeakPtr<INode> parent, const km::FatFolderEntry& entry) {
+    km::FatNode state = [&] {
+        stdx::LockGuard guard(mLock);
+        return mVolume.openNode(entry);
+    }();
+
+    if (entry.isFolder()) {
+        return sm::rcuMakeShared<FatFsFolder>(mDomain, parent, this, VfsString(entry.name), std::move(state));
+    }
+
+    return sm::rcuMakeShared<FatFsFile>(mDomain, parent, this, VfsString(entry.name), std::move(state));
+}
+
+OsStatus FatFsMount::sync() {
+    stdx::LockGuard guard(mLock);
+    return mVolume.sync();
+}
+
+km::FatStats FatFsMount::stats() {
+    stdx::LockGuard guard(mLock);
+    return mVolume.stats();
+}
+
+OsStatus FatFsMount::createChild(sm::RcuSharedPtr<INode> parent, VfsStringView name, bool isFolder, sm::RcuSharedPtr<INode> *node) {
+    //
+    // Every folder of this mount is a FatFsFolder, and files do not
+    // implement the folder interface.
+    //
+    std::unique_ptr<IFolderHandle> folder;
+    if (OsStatus status = OpenFolderInterface(parent, nullptr, 0, std::out_ptr(folder))) {
+        return status;
+    }
+
+    sm::RcuSharedPtr<FatFsFolder> target = sm::rcuSharedPtrCast<FatFsFolder>(parent);
+    return target->create(name, isFolder, node);
+}
+
+OsStatus FatFsMount::mkdir(sm::RcuSharedPtr<INode> parent, VfsStringView name, const void *, size_t, sm::RcuSharedPtr<INode> *node) {
+    return createChild(parent, name, true, node);
+}
+
+OsStatus FatFsMount::create(sm::RcuSharedPtr<INode> parent, VfsStringView name, const void *, size_t, sm::RcuSharedPtr<INode> *node) {
+    return createChild(parent, name, false, node);
+}
+
+OsStatus FatFsMount::root(sm::RcuSharedPtr<INode> *node) {
+    *node = mRootNode;
+    return OsStatusSuccess;
+}
+
+//
+// fatfs driver implementation
+//
+
+OsStatus FatFs::mount(sm::RcuDomain *, IVfsMount **) {
+    // Like tarfs a volume can only be mounted with a block device.
+    return OsStatusNotSupported;
+}
+
+OsStatus FatFs::unmount(IVfsMount *mount) {
+    delete mount;
+    return OsStatusSuccess;
+}
+
+OsStatus FatFs::createMount(IVfsMount **mount, sm::RcuDomain *domain, sm::SharedPtr<km::IBlockDriver> block) {
+    km::FatFsDriver volume;
+    if (OsStatus status = km::FatFsDriver::create(block.get(), &volume)) {
+        FatLog.warnf("Failed to mount FAT volume: ", OsStatusId(status));
+        return status;
+    }
+
+    FatFsMount *result = new (std::nothrow) FatFsMount(this, domain, block, std::move(volume));
+    if (!result) {
+        return OsStatusOutOfMemory;
+    }
+
+    *mount = result;
+    return OsStatusSuccess;
+}
+
+FatFs& FatFs::instance() {
+    static FatFs sDriver{};
+    return sDriver;
+}
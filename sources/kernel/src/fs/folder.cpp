@@ -1,5 +1,9 @@
 #include "fs/folder.hpp"
 
+#include "common/util/util.hpp"
+
+#include <string.h>
+
 using namespace vfs;
 
 OsStatus FolderMixin::lookup(VfsStringView name, sm::RcuSharedPtr<INode> *child) {
@@ -44,29 +48,77 @@ OsStatus FolderMixin::rmnode(sm::RcuSharedPtr<INode> child) {
     return OsStatusNotFound;
 }
 
-OsStatus FolderMixin::next(Iterator *iterator, sm::RcuSharedPtr<INode> *node) {
-    stdx::UniqueLock guard(mLock);
-
+FolderMixin::MapIterator FolderMixin::resume(const Iterator *iterator) {
     if (iterator->name.isEmpty()) {
-        iterator->current = mChildren.begin();
-        iterator->generation = mGeneration;
-    } else if (iterator->generation != mGeneration) {
-        //
-        // If the iterator has been invalidated, we use the cached last node to
-        // find the next node.
-        //
-        iterator->current = mChildren.upper_bound(iterator->name);
-        iterator->generation = mGeneration;
-    } else {
-        iterator->current++;
+        return mChildren.begin();
     }
 
-    if (iterator->current == mChildren.end()) {
+    if (iterator->generation == mGeneration) {
+        return std::next(iterator->current);
+    }
+
+    //
+    // If the iterator has been invalidated, we use the cached last node to
+    // find the next node.
+    //
+    return mChildren.upper_bound(iterator->name);
+}
+
+OsStatus FolderMixin::next(Iterator *iterator, sm::RcuSharedPtr<INode> *node) {
+    stdx::UniqueLock guard(mLock);
+
+    MapIterator it = resume(iterator);
+    if (it == mChildren.end()) {
         return OsStatusCompleted;
     }
 
-    auto& [name, child] = *iterator->current;
+    auto& [name, child] = *it;
     iterator->name = name;
+    iterator->current = it;
+    iterator->generation = mGeneration;
     *node = child;
     return OsStatusSuccess;
 }
+
+OsStatus FolderMixin::next(Iterator *iterator, std::span<std::byte> buffer, size_t *count, size_t *used) {
+    stdx::UniqueLock guard(mLock);
+
+    MapIterator it = resume(iterator);
+    MapIterator last = mChildren.end();
+    size_t entries = 0;
+    size_t offset = 0;
+
+    for (; it != mChildren.end(); ++it) {
+        const VfsString& name = it->first;
+        size_t length = name.count();
+        size_t size = sm::roundup(sizeof(OsIteratorEntry) + length, alignof(OsIteratorEntry));
+        if (size > UINT16_MAX || size > buffer.size() - offset) {
+            break;
+        }
+
+        OsIteratorEntry *entry = reinterpret_cast<OsIteratorEntry*>(buffer.data() + offset);
+        entry->Size = uint16_t(size);
+        entry->NameLength = uint16_t(length);
+        entry->Reserved = 0;
+        memcpy(entry->Name, name.data(), length);
+
+        offset += size;
+        entries += 1;
+        last = it;
+    }
+
+    *count = entries;
+    *used = offset;
+
+    if (last != mChildren.end()) {
+        iterator->name = last->first;
+        iterator->current = last;
+        iterator->generation = mGeneration;
+    }
+
+    if (entries == 0) {
+        return (it == mChildren.end()) ? OsStatusCompleted : OsStatusMoreData;
+    }
+
+    return OsStatusSuccess;
+}
@@ -15,10 +15,33 @@ OsStatus vfs::IIteratorHandle::next(IInvokeContext *context, void *data, size_t
     return OsStatusSuccess;
 }
 
+OsStatus vfs::IIteratorHandle::nextBatch(void *data, size_t size) {
+    if ((data == nullptr) || (size < sizeof(OsIteratorBatch))) {
+        return OsStatusInvalidInput;
+    }
+
+    //
+    // The entries are written directly after the header, the caller has
+    // already verified that the whole buffer is mapped.
+    //
+    OsIteratorBatch *batch = static_cast<OsIteratorBatch*>(data);
+    std::span buffer { reinterpret_cast<std::byte*>(batch + 1), size - sizeof(OsIteratorBatch) };
+
+    size_t count = 0;
+    size_t used = 0;
+    OsStatus status = next(buffer, &count, &used);
+
+    batch->Count = count;
+    batch->Size = used;
+    return status;
+}
+
 OsStatus vfs::IIteratorHandle::invoke(IInvokeContext *context, uint64_t function, void *data, size_t size) {
     switch (function) {
     case eOsIteratorNext:
         return next(context, data, size);
+    case eOsIteratorNextBatch:
+        return nextBatch(data, size);
 
     default:
         return OsStatusFunctionNotSupported;
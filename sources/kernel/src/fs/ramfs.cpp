@@ -24,32 +24,21 @@ OsStatus RamFsFile::interfaces(OsIdentifyInterfaceList *list) {
 }
 
 OsStatus RamFsFile::read(ReadRequest request, ReadResult *result) {
-    stdx::SharedLock lock(mLock);
     uintptr_t range = (uintptr_t)request.end - (uintptr_t)request.begin;
-    size_t size = std::min<size_t>(range, mData.count() - request.offset);
-    memcpy(request.begin, mData.data() + request.offset, size);
-    result->read = size;
+    result->read = mData.read(request.begin, range, request.offset);
     return OsStatusSuccess;
 }
 
 OsStatus RamFsFile::write(WriteRequest request, WriteResult *result) {
-    stdx::UniqueLock lock(mLock);
     uintptr_t range = (uintptr_t)request.end - (uintptr_t)request.begin;
-    if ((request.offset + range) > mData.count()) {
-        mData.resize(request.offset + range);
-    }
-
-    memcpy(mData.data() + request.offset, request.begin, range);
-    result->write = range;
-    return OsStatusSuccess;
+    return mData.write(request.begin, range, request.offset, &result->write);
 }
 
 OsStatus RamFsFile::stat(OsFileInfo *stat) {
-    stdx::SharedLock lock(mLock);
     *stat = OsFileInfo {
-        .LogicalSize = mData.count(),
-        .BlockSize = 1,
-        .BlockCount = mData.count(),
+        .LogicalSize = mData.size(),
+        .BlockSize = RamFsStorage::kPageSize,
+        .BlockCount = mData.pageCount(),
     };
     return OsStatusSuccess;
 }
@@ -0,0 +1,261 @@
+#include "fs/ramfs_storage.hpp"
+
+#include <algorithm>
+#include <new>
+#include <string.h>
+
+using vfs::RamFsStorage;
+
+static constexpr std::align_val_t kPageAlign = std::align_val_t(RamFsStorage::kPageSize);
+
+uint64_t RamFsStorage::capacity(unsigned height) {
+    if (height == 0) {
+        return 0;
+    }
+
+    unsigned shift = kFanoutShift * height;
+    if (shift >= 64 - kPageShift) {
+        return UINT64_MAX;
+    }
+
+    return UINT64_C(1) << shift;
+}
+
+RamFsStorage::Leaf *RamFsStorage::findLeaf(uint64_t page, size_t *slot) const {
+    uintptr_t root = mRoot.load(std::memory_order_acquire);
+    unsigned height = rootHeight(root);
+    if (page >= capacity(height)) {
+        return nullptr;
+    }
+
+    void *node = rootNode(root);
+    for (unsigned level = height; level > 1 && node != nullptr; level--) {
+        size_t index = (page >> (kFanoutShift * (level - 1))) & (kFanout - 1);
+        node = static_cast<Node*>(node)->slots[index].load(std::memory_order_acquire);
+    }
+
+    *slot = page & (kFanout - 1);
+    return static_cast<Leaf*>(node);
+}
+
+OsStatus RamFsStorage::getLeaf(uint64_t page, Leaf **leaf, size_t *slot) {
+    uintptr_t root = mRoot.load(std::memory_order_relaxed);
+    unsigned height = rootHeight(root);
+
+    if (height == 0) {
+        Leaf *first = new (std::nothrow) Leaf{};
+        if (first == nullptr) {
+            return OsStatusOutOfMemory;
+        }
+
+        height = 1;
+        root = uintptr_t(first) | height;
+        mRoot.store(root, std::memory_order_release);
+    }
+
+    //
+    // Grow the tree by adding new roots above the current one, the existing
+    // nodes keep covering the same pages so concurrent readers see either the
+    // old or new root and find the same pages through both.
+    //
+    while (page >= capacity(height)) {
+        if (height == kMaxHeight) {
+            return OsStatusInvalidInput;
+        }
+
+        Node *parent = new (std::nothrow) Node{};
+        if (parent == nullptr) {
+            return OsStatusOutOfMemory;
+        }
+
+        parent->slots[0].store(rootNode(root), std::memory_order_relaxed);
+        height += 1;
+        root = uintptr_t(parent) | height;
+        mRoot.store(root, std::memory_order_release);
+    }
+
+    void *node = rootNode(root);
+    for (unsigned level = height; level > 1; level--) {
+        size_t index = (page >> (kFanoutShift * (level - 1))) & (kFanout - 1);
+        std::atomic<void*>& child = static_cast<Node*>(node)->slots[index];
+        void *next = child.load(std::memory_order_relaxed);
+        if (next == nullptr) {
+            if (level == 2) {
+                next = new (std::nothrow) Leaf{};
+            } else {
+                next = new (std::nothrow) Node{};
+            }
+
+            if (next == nullptr) {
+                return OsStatusOutOfMemory;
+            }
+
+            child.store(next, std::memory_order_release);
+        }
+
+        node = next;
+    }
+
+    *leaf = static_cast<Leaf*>(node);
+    *slot = page & (kFanout - 1);
+    return OsStatusSuccess;
+}
+
+OsStatus RamFsStorage::reserve(uint64_t front, uint64_t back) {
+    bool locked = false;
+
+    for (uint64_t page = front; page < back; page++) {
+        size_t slot = 0;
+        Leaf *leaf = findLeaf(page, &slot);
+        if (leaf != nullptr && leaf->extents[slot].page.load(std::memory_order_acquire) != nullptr) {
+            continue;
+        }
+
+        // Only take the lock once a page is missing, overwrites never need it.
+        if (!locked) {
+            mGrowLock.lock();
+            locked = true;
+        }
+
+        if (OsStatus status = getLeaf(page, &leaf, &slot)) {
+            mGrowLock.unlock();
+            return status;
+        }
+
+        if (leaf->extents[slot].page.load(std::memory_order_relaxed) != nullptr) {
+            continue;
+        }
+
+        std::byte *memory = new (kPageAlign, std::nothrow) std::byte[kPageSize];
+        if (memory == nullptr) {
+            mGrowLock.unlock();
+            return OsStatusOutOfMemory;
+        }
+
+        memset(memory, 0, kPageSize);
+        leaf->extents[slot].page.store(memory, std::memory_order_release);
+        mPageCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (locked) {
+        mGrowLock.unlock();
+    }
+
+    return OsStatusSuccess;
+}
+
+size_t RamFsStorage::read(void *dst, size_t size, uint64_t offset) const {
+    uint64_t end = mSize.load(std::memory_order_acquire);
+    if (offset >= end) {
+        return 0;
+    }
+
+    size = std::min<uint64_t>(size, end - offset);
+
+    std::byte *out = static_cast<std::byte*>(dst);
+    size_t remaining = size;
+
+    while (remaining > 0) {
+        uint64_t page = offset >> kPageShift;
+        size_t inner = offset & (kPageSize - 1);
+        size_t count = std::min(remaining, kPageSize - inner);
+
+        size_t slot = 0;
+        Leaf *leaf = findLeaf(page, &slot);
+        std::byte *memory = (leaf != nullptr) ? leaf->extents[slot].page.load(std::memory_order_acquire) : nullptr;
+
+        if (memory == nullptr) {
+            memset(out, 0, count);
+        } else {
+            stdx::SharedLock guard(leaf->extents[slot].lock);
+            memcpy(out, memory + inner, count);
+        }
+
+        out += count;
+        offset += count;
+        remaining -= count;
+    }
+
+    return size;
+}
+
+OsStatus RamFsStorage::write(const void *src, size_t size, uint64_t offset, size_t *written) {
+    if (size == 0) {
+        *written = 0;
+        return OsStatusSuccess;
+    }
+
+    uint64_t end = offset + size;
+    if (end < offset) {
+        return OsStatusInvalidInput;
+    }
+
+    uint64_t front = offset >> kPageShift;
+    uint64_t back = ((end - 1) >> kPageShift) + 1;
+
+    if (OsStatus status = reserve(front, back)) {
+        return status;
+    }
+
+    const std::byte *in = static_cast<const std::byte*>(src);
+    size_t remaining = size;
+
+    while (remaining > 0) {
+        uint64_t page = offset >> kPageShift;
+        size_t inner = offset & (kPageSize - 1);
+        size_t count = std::min(remaining, kPageSize - inner);
+
+        size_t slot = 0;
+        Leaf *leaf = findLeaf(page, &slot);
+        std::byte *memory = leaf->extents[slot].page.load(std::memory_order_acquire);
+
+        {
+            stdx::UniqueLock guard(leaf->extents[slot].lock);
+            memcpy(memory + inner, in, count);
+        }
+
+        in += count;
+        offset += count;
+        remaining -= count;
+    }
+
+    //
+    // The size is only raised once the data is in place, so readers never
+    // see the new end of the file before the bytes that lead up to it.
+    //
+    uint64_t current = mSize.load(std::memory_order_relaxed);
+    while (current < end && !mSize.compare_exchange_weak(current, end, std::memory_order_release, std::memory_order_relaxed)) { }
+
+    *written = size;
+    return OsStatusSuccess;
+}
+
+void RamFsStorage::destroy(void *node, unsigned height) {
+    if (node == nullptr) {
+        return;
+    }
+
+    if (height == 1) {
+        Leaf *leaf = static_cast<Leaf*>(node);
+        for (Extent& extent : leaf->extents) {
+            if (std::byte *memory = extent.page.load(std::memory_order_relaxed)) {
+                operator delete[](memory, kPageAlign);
+            }
+        }
+
+        delete leaf;
+        return;
+    }
+
+    Node *inner = static_cast<Node*>(node);
+    for (std::atomic<void*>& slot : inner->slots) {
+        destroy(slot.load(std::memory_order_relaxed), height - 1);
+    }
+
+    delete inner;
+}
+
+RamFsStorage::~RamFsStorage() {
+    uintptr_t root = mRoot.load(std::memory_order_relaxed);
+    destroy(rootNode(root), rootHeight(root));
+}
@@ -74,18 +74,25 @@ OsStatus vfs::detail::ConvertTarPath(const char *path, VfsPath *result) {
     return OsStatusSuccess;
 }
 
-OsStatus vfs::ParseTar(km::BlockDevice *media, TarParseOptions options, sm::AbslBTreeMap<VfsPath, TarEntry> *result) {
-    TarPosixHeader header{};
+/// @brief Walk the headers of a tar archive.
+///
+/// @param mediaSize The size of the archive.
+/// @param options The options for parsing the tar archive.
+/// @param result The parsed tar archive.
+/// @param readHeader Returns the header at an offset, or nullptr if it could not be read.
+///
+/// @return The status of the operation.
+template<typename F>
+static OsStatus ParseTarHeaders(uint64_t mediaSize, TarParseOptions options, sm::AbslBTreeMap<VfsPath, TarEntry> *result, F&& readHeader) {
     uint64_t offset = 0;
-    const uint64_t mediaSize = media->size();
 
     //
     // Read the tar archive in 512 byte blocks.
     // Using the media size as an upper bound for the loop.
     //
     while (offset < mediaSize) {
-        size_t read = media->read(offset, &header, sizeof(header));
-        if (read != sizeof(header)) {
+        const TarPosixHeader *header = readHeader(offset);
+        if (header == nullptr) {
             //
             // If this happens, either the media is corrupt. Or there
             // is a bug in the tarfs driver. Either way it is not safe
@@ -97,19 +104,19 @@ OsStatus vfs::ParseTar(km::BlockDevice *media, TarParseOptions options, sm::Absl
             return OsStatusInvalidInput;
         }
 
-        if (header.name[0] == '\0') {
+        if (header->name[0] == '\0') {
             //
             // If the name is empty, we have probably reached the end of the archive.
             //
             break;
         }
 
-        if (header.magic != TarPosixHeader::kMagic) {
+        if (header->magic != TarPosixHeader::kMagic) {
             //
             // If the magic is invalid, we may have overrun the tar file.
             //
             TarLog.errorf("Invalid magic for entry at offset: ", km::Hex(offset).pad(16));
-            TarLog.errorf("Expected: '", TarPosixHeader::kMagic, "' Actual: '", header.magic, "'");
+            TarLog.errorf("Expected: '", TarPosixHeader::kMagic, "' Actual: '", header->magic, "'");
             break;
         }
 
@@ -118,10 +125,10 @@ OsStatus vfs::ParseTar(km::BlockDevice *media, TarParseOptions options, sm::Absl
             // If the checksum is invalid, we should assume we have overrun
             // the tar file. Better to be safe than sorry when parsing data.
             //
-            uint64_t checksum = header.reportedChecksum();
-            uint64_t actual = header.actualChecksum();
+            uint64_t checksum = header->reportedChecksum();
+            uint64_t actual = header->actualChecksum();
             if (checksum != actual) {
-                TarLog.errorf("Invalid checksum for entry: '", header.name, "'");
+                TarLog.errorf("Invalid checksum for entry: '", header->name, "'");
                 TarLog.errorf("Reported: ", km::Hex(checksum).pad(8), " Actual: ", km::Hex(actual).pad(8));
                 return OsStatusInvalidInput;
             }
@@ -139,12 +146,12 @@ OsStatus vfs::ParseTar(km::BlockDevice *media, TarParseOptions options, sm::Absl
         //
         uint64_t dataOffset = offset;
 
-        if (header.getSize() + offset > mediaSize) {
+        if (header->getSize() + offset > mediaSize) {
             //
             // If the size of the file is larger than the media size,
             // the tar file is corrupt.
             //
-            TarLog.errorf("File size exceeds media size: '", header.name, "'");
+            TarLog.errorf("File size exceeds media size: '", header->name, "'");
             return OsStatusInvalidInput;
         }
 
@@ -152,9 +159,9 @@ OsStatus vfs::ParseTar(km::BlockDevice *media, TarParseOptions options, sm::Absl
         // This routine is only concerned with parsing headers,
         // so we skip over the file data.
         //
-        offset += sm::roundup(header.getSize(), kTarBlockSize);
+        offset += sm::roundup(header->getSize(), kTarBlockSize);
 
-        VfsNodeType type = header.getType();
+        VfsNodeType type = header->getType();
         if (type != VfsNodeType::eFile && type != VfsNodeType::eFolder) {
             //
             // We only care about files and folders, so we skip over
@@ -163,7 +170,7 @@ OsStatus vfs::ParseTar(km::BlockDevice *media, TarParseOptions options, sm::Absl
             continue;
         }
 
-        if (strncmp(header.name, "./", 3) == 0) {
+        if (strncmp(header->name, "./", 3) == 0) {
             //
             // Skip the current directory entry.
             //
@@ -171,17 +178,40 @@ OsStatus vfs::ParseTar(km::BlockDevice *media, TarParseOptions options, sm::Absl
         }
 
         VfsPath path;
-        if (OsStatus status = detail::ConvertTarPath(header.name, &path)) {
-            TarLog.errorf("Failed to convert path: ", header.name, " = ", OsStatusId(status));
+        if (OsStatus status = detail::ConvertTarPath(header->name, &path)) {
+            TarLog.errorf("Failed to convert path: ", header->name, " = ", OsStatusId(status));
             return status;
         }
 
-        result->insert({ path, TarEntry(header, dataOffset) });
+        result->insert({ path, TarEntry(*header, dataOffset) });
     }
 
     return OsStatusSuccess;
 }
 
+OsStatus vfs::ParseTar(km::BlockDevice *media, TarParseOptions options, sm::AbslBTreeMap<VfsPath, TarEntry> *result) {
+    TarPosixHeader header{};
+
+    return ParseTarHeaders(media->size(), options, result, [&](uint64_t offset) -> const TarPosixHeader* {
+        size_t read = media->read(offset, &header, sizeof(header));
+        return (read == sizeof(header)) ? &header : nullptr;
+    });
+}
+
+OsStatus vfs::ParseTar(std::span<const std::byte> image, TarParseOptions options, sm::AbslBTreeMap<VfsPath, TarEntry> *result) {
+    //
+    // The headers are only made of chars so they can be read in place
+    // without any alignment concerns.
+    //
+    return ParseTarHeaders(image.size(), options, result, [&](uint64_t offset) -> const TarPosixHeader* {
+        if (image.size() - offset < sizeof(TarPosixHeader)) {
+            return nullptr;
+        }
+
+        return reinterpret_cast<const TarPosixHeader*>(image.data() + offset);
+    });
+}
+
 //
 // tarfs node implementation
 //
@@ -229,12 +259,37 @@ OsStatus TarFsFile::read(ReadRequest request, ReadResult *result) {
     uint64_t remaining = mHeader.getSize() - request.offset;
     uint64_t toRead = std::min(remaining, (uintptr_t)request.end - (uintptr_t)request.begin);
 
+    //
+    // Archives that are already in memory are copied from directly, this
+    // skips the block device and the bounce buffer it reads through.
+    //
+    std::span<const std::byte> image = mMount->image();
+    if (!image.empty()) {
+        memcpy(request.begin, image.data() + mOffset + request.offset, toRead);
+        result->read = toRead;
+        return OsStatusSuccess;
+    }
+
     km::BlockDevice *media = mMount->media();
     size_t read = media->read(mOffset + request.offset, request.begin, toRead);
     result->read = read;
     return OsStatusSuccess;
 }
 
+OsStatus TarFsFile::physical(uint64_t offset, size_t size, sm::PhysicalAddress *address) {
+    sm::PhysicalAddress base = mMount->imageAddress();
+    if (mMount->image().empty() || base.isNull()) {
+        return OsStatusNotSupported;
+    }
+
+    if (offset > mHeader.getSize() || size > mHeader.getSize() - offset) {
+        return OsStatusInvalidInput;
+    }
+
+    *address = base + (mOffset + offset);
+    return OsStatusSuccess;
+}
+
 OsStatus TarFsFile::stat(OsFileInfo *result) {
     size_t size = mHeader.getSize();
 
@@ -306,9 +361,14 @@ TarFsMount::TarFsMount(TarFs *tarfs, sm::RcuDomain *domain, sm::SharedPtr<km::IB
     , mBlock(block)
     , mMedia(mBlock.get())
     , mRootNode(sm::rcuMakeShared<TarFsFolder>(mDomain, TarEntry{}, nullptr, this))
+    , mImage(mBlock->resident())
 {
     sm::AbslBTreeMap<VfsPath, TarEntry> headers;
-    if (OsStatus status = ParseTar(&mMedia, TarParseOptions{}, &headers)) {
+    OsStatus status = mImage.empty()
+        ? ParseTar(&mMedia, TarParseOptions{}, &headers)
+        : ParseTar(mImage, TarParseOptions{}, &headers);
+
+    if (status != OsStatusSuccess) {
         TarLog.errorf("Failed to parse tar archive: ", OsStatusId(status));
         return;
     }
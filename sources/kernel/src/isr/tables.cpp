@@ -1,5 +1,6 @@
 #include "isr/startup.hpp"
 #include "isr/runtime.hpp"
+#include "std/publish_array.hpp"
 #include "thread.hpp"
 
 static constinit km::SharedIsrTable gSharedIsrTable{};
@@ -13,6 +14,8 @@ static constinit km::RuntimeIsrManager gRuntimeIsrManager{};
 
 static constinit km::ILocalIsrManager *gIsrManager = &gStartupIsrManager;
 
+static constinit stdx::PublishArray<km::CpuIsrTable, km::kMaxCpuIsrTables> gCpuIsrTables{};
+
 km::LocalIsrTable *km::StartupIsrManager::getLocalIsrTable() {
     return &gStartupIsrTable;
 }
@@ -29,8 +32,14 @@ km::RuntimeIsrManager *km::RuntimeIsrManager::instance() {
     return &gRuntimeIsrManager;
 }
 
-void km::RuntimeIsrManager::cpuInit() {
+void km::RuntimeIsrManager::cpuInit(CpuCoreId core) {
     std::fill(tlsIsrTable->begin(), tlsIsrTable->end(), km::defaultIsrHandler);
+
+    gCpuIsrTables.add(CpuIsrTable { core, &tlsIsrTable });
+}
+
+std::span<const km::CpuIsrTable> km::GetCpuIsrTables() noexcept [[clang::reentrant]] {
+    return gCpuIsrTables.entries();
 }
 
 km::LocalIsrTable *km::GetLocalIsrTable() {
@@ -2,19 +2,34 @@
 
 #include "logger/logger.hpp"
 
-void km::SerialAppender::write(const LogMessageView& message) {
+template<typename T>
+static void WriteMessage(T& port, const km::LogMessageView& message) {
     auto& [_, msg, logger, level] = message;
 
-    if (level != LogLevel::ePrint) {
-        mSerialPort.print("[");
-        mSerialPort.print(logger->getName());
-        mSerialPort.print("] ");
+    if (level != km::LogLevel::ePrint) {
+        port.print("[");
+        port.print(logger->getName());
+        port.print("] ");
+    }
+
+    port.print(msg);
+
+    if (level != km::LogLevel::ePrint) {
+        port.print("\n");
     }
+}
 
-    mSerialPort.print(msg);
+void km::SerialAppender::write(const LogMessageView& message) {
+    if (mBufferedPort != nullptr) {
+        WriteMessage(*mBufferedPort, message);
 
-    if (level != LogLevel::ePrint) {
-        mSerialPort.put('\n');
+        // Fatal messages are usually followed by a halt, so the interrupt
+        // handler may never get to send them.
+        if (message.level == LogLevel::eFatal) {
+            mBufferedPort->flush();
+        }
+    } else {
+        WriteMessage(mSerialPort, message);
     }
 }
 
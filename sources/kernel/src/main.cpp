@@ -22,14 +22,18 @@
 
 #include "clock.hpp"
 #include "cmos.hpp"
+#include "crt.hpp"
 #include "delay.hpp"
 
 #include "debug/debug.hpp"
 
 #include "devices/ddi.hpp"
 #include "devices/hid.hpp"
+#include "devices/profile.hpp"
+#include "devices/serial.hpp"
 #include "devices/sysfs.hpp"
 #include "drivers/block/ramblk.hpp"
+#include "drivers/block/virtio.hpp"
 #include "fs/vfs.hpp"
 #include "fs/path.hpp"
 #include "fs/utils.hpp"
@@ -52,10 +56,12 @@
 #include "logger/e9_appender.hpp"
 
 #include "memory.hpp"
+#include "memory/numa.hpp"
 #include "memory/stack_mapping.hpp"
 #include "notify.hpp"
 #include "panic.hpp"
 #include "processor.hpp"
+#include "profile/profiler.hpp"
 #include "setup.hpp"
 #include "smp.hpp"
 
@@ -68,6 +74,7 @@
 #include "system/system.hpp"
 
 #include "task/runtime.hpp"
+#include "task/scheduler_stats.hpp"
 #include "thread.hpp"
 #include "uart.hpp"
 #include "smbios.hpp"
@@ -111,7 +118,11 @@ static constexpr size_t kMaxMessageSize = 0x1000;
 static constexpr size_t kKernelStackSize = 0x4000;
 static constexpr auto kTssStackSize = x64::kPageSize * 16;
 static constexpr std::chrono::milliseconds kDefaultTimeSlice = std::chrono::milliseconds(25);
+static constexpr uint32_t kSerialTxCapacity = sm::kilobytes(16).bytes();
+static constexpr uint32_t kSerialRxCapacity = sm::kilobytes(1).bytes();
 
+constinit static km::SerialPort gSerialPort;
+constinit static km::BufferedSerialPort gBufferedSerialPort;
 constinit static km::SerialAppender gSerialAppender;
 constinit static km::VgaAppender gVgaAppender;
 constinit static km::E9Appender gDebugPortAppender;
@@ -548,7 +559,7 @@ static km::Apic enableBootApic(km::AddressSpace& memory, bool useX2Apic) {
     // setup tls now that we have the lapic id
 
     km::InitCpuLocalRegion();
-    km::RuntimeIsrManager::cpuInit();
+    km::RuntimeIsrManager::cpuInit(km::CpuCoreId(apic->id()));
 
     km::InitKernelThread(apic);
 
@@ -600,6 +611,7 @@ static void initBootTerminal(std::span<const boot::FrameBuffer> framebuffers) {
 static void updateSerialPort(ComPortInfo info) {
     info.skipLoopbackTest = true;
     if (OpenSerialResult com = OpenSerial(info); com.status == SerialPortStatus::eOk) {
+        gSerialPort = com.port;
         SerialAppender::create(com.port, &gSerialAppender);
         LogQueue::addGlobalAppender(&gSerialAppender);
     }
@@ -609,6 +621,7 @@ static SerialPortStatus initSerialPort(ComPortInfo info) {
     if (OpenSerialResult com = OpenSerial(info)) {
         return com.status;
     } else {
+        gSerialPort = com.port;
         SerialAppender::create(com.port, &gSerialAppender);
         LogQueue::addGlobalAppender(&gSerialAppender);
         return SerialPortStatus::eOk;
@@ -734,6 +747,7 @@ static void initStage1Idt(uint16_t cs) {
 
     InitInterrupts(cs);
     InstallExceptionHandlers(GetSharedIsrTable());
+    km::InstallProfilerIsr(GetSharedIsrTable());
     setupInterruptStacks(cs);
 
     if (kSelfTestIdt) {
@@ -879,6 +893,27 @@ static void CreatePlatformVfsNodes(const km::SmBiosTables *smbios, const acpi::A
             VfsLog.warnf("Failed to create ACPI device: ", OsStatusId(status));
         }
     }
+
+    {
+        auto node = sm::rcuMakeShared<dev::ProfileFile>(gVfsRoot->domain());
+        if (OsStatus status = gVfsRoot->mkdevice(vfs::BuildPath("Platform", "Profile"), node)) {
+            VfsLog.warnf("Failed to create profiler device: ", OsStatusId(status));
+        }
+    }
+
+    if (const km::SyscallStats *stats = km::GetSyscallStats()) {
+        auto node = sm::rcuMakeShared<dev::SyscallStatsFile>(gVfsRoot->domain(), stats);
+        if (OsStatus status = gVfsRoot->mkdevice(vfs::BuildPath("Platform", "Syscalls"), node)) {
+            VfsLog.warnf("Failed to create system call statistics device: ", OsStatusId(status));
+        }
+    }
+
+    if constexpr (task::kEnableSchedulerStats) {
+        auto node = sm::rcuMakeShared<dev::SchedulerStatsFile>(gVfsRoot->domain(), sys::getScheduler());
+        if (OsStatus status = gVfsRoot->mkdevice(vfs::BuildPath("Platform", "Scheduler"), node)) {
+            VfsLog.warnf("Failed to create scheduler statistics device: ", OsStatusId(status));
+        }
+    }
 }
 
 static void MountInitArchive(MemoryRangeEx initrd, AddressSpace& memory) {
@@ -899,7 +934,13 @@ static void MountInitArchive(MemoryRangeEx initrd, AddressSpace& memory) {
         KM_PANIC("Failed to map initrd.");
     }
 
-    sm::SharedPtr<MemoryBlk> block = new MemoryBlk{std::bit_cast<std::byte*>(initrdMemory.address()), initrd.size()};
+    //
+    // The initrd is only mapped read only, and tarfs maps its pages directly
+    // into processes that load executables from it so it needs to know where
+    // it lives in physical memory.
+    //
+    std::byte *initrdBase = std::bit_cast<std::byte*>(initrdMemory.address()) + (initrd.front.address % x64::kPageSize);
+    sm::SharedPtr<MemoryBlk> block = new MemoryBlk{initrdBase, initrd.size(), Protection::eRead, initrd.front};
 
     vfs::IVfsMount *mount = nullptr;
     if (OsStatus status = gVfsRoot->addMountWithParams(&vfs::TarFs::instance(), vfs::BuildPath("Init"), &mount, block)) {
@@ -993,6 +1034,44 @@ static void AddDebugSystemCalls() {
 
 static sys::System *gSysSystem = nullptr;
 
+static km::NumaTopology *gNumaTopology = nullptr;
+
+static void setupNumaTopology(const acpi::AcpiTables& rsdt) {
+    gNumaTopology = new km::NumaTopology;
+
+    const acpi::Srat *srat = rsdt.srat();
+    if (srat == nullptr) {
+        InitLog.infof("No SRAT present, assuming a single NUMA node.");
+        return;
+    }
+
+    if (OsStatus status = acpi::ReadNumaTopology(srat, rsdt.slit(), gNumaTopology)) {
+        InitLog.warnf("Failed to read NUMA topology: ", OsStatusId(status));
+        *gNumaTopology = km::NumaTopology{};
+        return;
+    }
+
+    InitLog.infof("NUMA nodes: ", gNumaTopology->nodeCount());
+
+    km::NumaNodeId node = gNumaTopology->nodeOfCpu(km::GetCurrentCoreId());
+    if (node == km::NumaNodeId::eInvalid) {
+        node = km::NumaNodeId(0);
+    }
+
+    km::SetCurrentNumaNode(node);
+
+    if (OsStatus status = gMemory->pmmAllocator().partition(*gNumaTopology, node)) {
+        InitLog.warnf("Failed to partition physical memory by NUMA node: ", OsStatusId(status));
+    }
+}
+
+static void setupApNumaNode() {
+    km::NumaNodeId node = gNumaTopology->nodeOfCpu(km::GetCurrentCoreId());
+    if (node != km::NumaNodeId::eInvalid) {
+        km::SetCurrentNumaNode(node);
+    }
+}
+
 static void initSystem() {
     auto *memory = GetSystemMemory();
     gSysSystem = new sys::System;
@@ -1184,6 +1263,11 @@ static void AddVmemSystemCalls() {
         System system = GetSystem();
         return um::VmemDestroy(&system, context, regs);
     });
+
+    AddSystemCall(eOsCallVmemProtect, [](CallContext *context, SystemCallRegisterSet *regs) -> OsCallResult {
+        System system = GetSystem();
+        return um::VmemProtect(&system, context, regs);
+    });
 }
 
 static void AddClockSystemCalls() {
@@ -1203,6 +1287,16 @@ static void AddClockSystemCalls() {
     });
 }
 
+static void initMemoryRoutines(const ProcessorInfo& processor) {
+    KmMemoryFeatures features {
+        .erms = processor.erms(),
+        .fsrm = processor.fsrm(),
+        .nonTemporal = processor.sse2(),
+    };
+
+    KmInitMemoryRoutines(features);
+}
+
 static void enableUmip(bool enable) {
     if (enable) {
         x64::Cr4 cr4 = x64::Cr4::load();
@@ -1213,6 +1307,8 @@ static void enableUmip(bool enable) {
 
 [[noreturn]]
 static void enterSchedulerLoop(km::IApic *apic, km::ApicTimer *apicTimer) {
+    km::InitCpuProfiler(apic);
+
     auto frequency = apicTimer->frequency();
     auto ticks = (frequency * kDefaultTimeSlice.count()) / 1000;
     apic->setTimerDivisor(km::apic::TimerDivide::e1);
@@ -1265,6 +1361,7 @@ static void startupSmp(const acpi::AcpiTables& rsdt, bool umip, km::ITickSource
                 }
             }
 
+            setupApNumaNode();
             sys::setupApScheduler();
             enterSchedulerLoop(GetCpuLocalApic(), &apicTimer);
         });
@@ -1345,6 +1442,63 @@ static OsStatus kernelMasterTask() {
     return OsStatusSuccess;
 }
 
+static void createSerialDevice(BufferedSerialPort *port, Clock *clock) {
+    vfs::VfsPath serialPath{OS_DEVICE_SERIAL_COM1};
+
+    {
+        sm::RcuSharedPtr<vfs::INode> node = nullptr;
+        if (OsStatus status = gVfsRoot->mkpath(serialPath.parent(), &node)) {
+            VfsLog.warnf("Failed to create ", serialPath.parent(), " folder: ", OsStatusId(status));
+            return;
+        }
+    }
+
+    auto device = sm::rcuMakeShared<dev::SerialDevice>(gVfsRoot->domain(), port, clock);
+    if (OsStatus status = gVfsRoot->mkdevice(serialPath, device)) {
+        VfsLog.warnf("Failed to create ", serialPath, " device: ", OsStatusId(status));
+    }
+}
+
+static void configureSerialIrqs(IoApicSet& ioApicSet, const IApic *apic, LocalIsrTable *ist) {
+    if (gSerialPort.isReady()) {
+        if (OsStatus status = BufferedSerialPort::create(gSerialPort, kSerialTxCapacity, kSerialRxCapacity, &gBufferedSerialPort)) {
+            InitLog.warnf("Failed to create buffered serial port: ", OsStatusId(status));
+        } else if (OsStatus status = InstallSerialIsr(ioApicSet, irq::kCom1, &gBufferedSerialPort, apic, ist)) {
+            InitLog.warnf("Failed to install serial ISR: ", OsStatusId(status));
+        } else {
+            gSerialAppender.setBufferedPort(&gBufferedSerialPort);
+            createSerialDevice(&gBufferedSerialPort, &gClock);
+        }
+    }
+
+    if (OsStatus status = debug::EnableDebugStreamIrq(ioApicSet, apic, ist)) {
+        InitLog.warnf("Failed to enable debug stream irq: ", OsStatusId(status));
+    }
+}
+
+static void setupVirtIoBlockDevices(pci::IConfigSpace *config, const acpi::AcpiTables& rsdt) {
+    static constexpr size_t kMaxDevices = 8;
+    static constexpr pci::DeviceId kDeviceIds[] = { km::VirtIoBlk::kDeviceId, km::VirtIoBlk::kTransitionalDeviceId };
+    static constinit stdx::StaticVector<km::VirtIoBlk*, kMaxDevices> devices;
+
+    if (config == nullptr) {
+        return;
+    }
+
+    pci::DeviceBusAddress addresses[kMaxDevices];
+    size_t count = pci::FindDevices(config, rsdt.mcfg(), km::virtio::kVendorId, kDeviceIds, addresses);
+
+    for (size_t i = 0; i < count; i++) {
+        km::VirtIoBlk *device = nullptr;
+        if (OsStatus status = km::VirtIoBlk::create(config, addresses[i], *gMemory, rsdt.lapicCount(), &device)) {
+            InitLog.warnf("Failed to initialize virtio block device: ", OsStatusId(status));
+            continue;
+        }
+
+        devices.add(device);
+    }
+}
+
 static void configurePs2Controller(const acpi::AcpiTables& rsdt, IoApicSet& ioApicSet, const IApic *apic, LocalIsrTable *ist) {
     static hid::Ps2Controller ps2Controller;
 
@@ -1533,6 +1687,7 @@ void LaunchKernel(boot::LaunchInfo launch) {
 #endif
 
     ProcessorInfo processor = GetProcessorInfo();
+    initMemoryRoutines(processor);
     enableUmip(processor.umip());
 
     initPortDelay(hvInfo);
@@ -1612,6 +1767,8 @@ void LaunchKernel(boot::LaunchInfo launch) {
     auto lapic = enableBootApic(gMemory->pageTables(), useX2Apic);
 
     acpi::AcpiTables rsdt = acpi::setupAcpi(launch.rsdpAddress, gMemory->pageTables());
+    setupNumaTopology(rsdt);
+
     const acpi::Fadt *fadt = rsdt.fadt();
     initCmos(fadt->century);
 
@@ -1625,6 +1782,7 @@ void LaunchKernel(boot::LaunchInfo launch) {
     }
 
     pci::probeConfigSpace(config.get(), rsdt.mcfg());
+    setupVirtIoBlockDevices(config.get(), rsdt);
 
     km::LocalIsrTable *ist = GetLocalIsrTable();
     sys::installSchedulerIsr();
@@ -1681,7 +1839,7 @@ void LaunchKernel(boot::LaunchInfo launch) {
 
     ioApicSet.clearLegacyRedirect(irq::kTimer);
 
-    sys::setupGlobalScheduler(kEnableSmp, rsdt, &gSysSystem->mScheduler);
+    sys::setupGlobalScheduler(kEnableSmp, rsdt, *gNumaTopology, &gSysSystem->mScheduler);
 
     startupSmp(rsdt, processor.umip(), clockTicker, processor.invariantTsc);
 
@@ -1689,10 +1847,12 @@ void LaunchKernel(boot::LaunchInfo launch) {
     ClockLog.infof("Current time: ", time);
 
     gClock = Clock { time, clockTicker };
+    gSysSystem->publishClockPage(gClock.clockPage());
 
     createVfsDevices(&smbios, &rsdt, launch.initrd);
     initUserApi();
     createNotificationQueue();
+    configureSerialIrqs(ioApicSet, lapic.pointer(), ist);
     configurePs2Controller(rsdt, ioApicSet, lapic.pointer(), ist);
     createDisplayDevice();
 
@@ -1,5 +1,7 @@
 #include "memory/memory.hpp"
 
+#include <algorithm>
+
 /// @brief The amount of memory a single pml4 entry can cover.
 static constexpr auto kPml4MemorySize = x64::kHugePageSize * 512;
 
@@ -73,6 +75,12 @@ bool km::detail::IsLargePageEligible(AddressMapping mapping) noexcept [[clang::n
     return front2m < back2m;
 }
 
+size_t km::detail::GetLargePageAlignment(size_t size, size_t align) noexcept [[clang::nonblocking]] {
+    if (size < kLargePageThreshold) return align;
+
+    return std::max<size_t>(align, x64::kLargePageSize);
+}
+
 size_t km::detail::GetCoveredSegments(VirtualRange range, size_t segment) noexcept [[clang::nonblocking]] {
     uintptr_t front = sm::rounddown(reinterpret_cast<uintptr_t>(range.front), segment);
     uintptr_t back = sm::roundup(reinterpret_cast<uintptr_t>(range.back), segment);
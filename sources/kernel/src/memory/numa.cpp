@@ -0,0 +1,120 @@
+#include "memory/numa.hpp"
+
+#include "panic.hpp"
+
+#include <algorithm>
+
+using namespace km;
+
+NumaTopology::NumaTopology() noexcept
+    : mNodeCount(0)
+    , mDomains()
+{
+    for (size_t i = 0; i < kMaxNumaNodes; i++) {
+        for (size_t j = 0; j < kMaxNumaNodes; j++) {
+            mDistance[i][j] = (i == j) ? kNumaLocalDistance : kNumaRemoteDistance;
+        }
+    }
+}
+
+OsStatus NumaTopology::addNode(uint32_t domain, NumaNodeId *node [[outparam]]) {
+    NumaNodeId existing = findNode(domain);
+    if (existing != NumaNodeId::eInvalid) {
+        *node = existing;
+        return OsStatusSuccess;
+    }
+
+    if (mNodeCount >= kMaxNumaNodes) {
+        return OsStatusOutOfMemory;
+    }
+
+    mDomains[mNodeCount] = domain;
+    *node = NumaNodeId(mNodeCount);
+    mNodeCount += 1;
+    return OsStatusSuccess;
+}
+
+OsStatus NumaTopology::addMemory(uint32_t domain, MemoryRange range) {
+    NumaNodeId node = NumaNodeId::eInvalid;
+    if (OsStatus status = addNode(domain, &node)) {
+        return status;
+    }
+
+    return mMemory.add(NumaMemoryAffinity { range, node });
+}
+
+OsStatus NumaTopology::addCpu(uint32_t domain, CpuCoreId core) {
+    NumaNodeId node = NumaNodeId::eInvalid;
+    if (OsStatus status = addNode(domain, &node)) {
+        return status;
+    }
+
+    return mCpus.add(NumaCpuAffinity { core, node });
+}
+
+void NumaTopology::setDistance(NumaNodeId from, NumaNodeId to, uint8_t distance) noexcept {
+    KM_ASSERT(std::to_underlying(from) < mNodeCount && std::to_underlying(to) < mNodeCount);
+    mDistance[std::to_underlying(from)][std::to_underlying(to)] = distance;
+}
+
+uint32_t NumaTopology::domainOf(NumaNodeId node) const noexcept {
+    KM_ASSERT(std::to_underlying(node) < mNodeCount);
+    return mDomains[std::to_underlying(node)];
+}
+
+NumaNodeId NumaTopology::findNode(uint32_t domain) const noexcept {
+    for (uint32_t i = 0; i < mNodeCount; i++) {
+        if (mDomains[i] == domain) {
+            return NumaNodeId(i);
+        }
+    }
+
+    return NumaNodeId::eInvalid;
+}
+
+NumaNodeId NumaTopology::nodeOfCpu(CpuCoreId core) const noexcept {
+    for (const NumaCpuAffinity& affinity : mCpus) {
+        if (affinity.core == core) {
+            return affinity.node;
+        }
+    }
+
+    return NumaNodeId::eInvalid;
+}
+
+NumaNodeId NumaTopology::nodeOfAddress(PhysicalAddress address) const noexcept {
+    for (const NumaMemoryAffinity& affinity : mMemory) {
+        if (affinity.range.contains(address)) {
+            return affinity.node;
+        }
+    }
+
+    return NumaNodeId::eInvalid;
+}
+
+uint8_t NumaTopology::distance(NumaNodeId from, NumaNodeId to) const noexcept {
+    KM_ASSERT(std::to_underlying(from) < mNodeCount && std::to_underlying(to) < mNodeCount);
+    return mDistance[std::to_underlying(from)][std::to_underlying(to)];
+}
+
+size_t NumaTopology::nodesByDistance(NumaNodeId from, std::span<NumaNodeId> order) const noexcept {
+    KM_ASSERT(order.size() >= mNodeCount);
+
+    for (uint32_t i = 0; i < mNodeCount; i++) {
+        order[i] = NumaNodeId(i);
+    }
+
+    std::stable_sort(order.begin(), order.begin() + mNodeCount, [&](NumaNodeId lhs, NumaNodeId rhs) {
+        //
+        // Firmware is permitted to report a remote distance equal to the local
+        // distance, the node itself must still be tried first.
+        //
+        if (lhs == from || rhs == from) {
+            return lhs == from && rhs != from;
+        }
+
+        return distance(from, lhs) < distance(from, rhs);
+    });
+
+    return mNodeCount;
+}
@@ -1,38 +1,133 @@
 #include "memory/page_allocator.hpp"
 
+#include "debug/debug.hpp"
 #include "logger/categories.hpp"
 #include "memory/layout.hpp"
 #include "std/inlined_vector.hpp"
 #include "std/spinlock.hpp"
 
+#include <algorithm>
 #include <cstring>
 
 using namespace km;
 
+static PmmAllocation SendAllocateEvent(PmmAllocation allocation, size_t align) noexcept [[clang::nonallocating]] {
+    if (allocation.isValid()) {
+        debug::SendEvent(debug::AllocatePhysicalMemory {
+            .size = allocation.size(),
+            .address = allocation.address().address,
+            .alignment = static_cast<uint32_t>(align),
+            .tag = 0,
+        });
+    }
+
+    return allocation;
+}
+
 /// page allocator
 
+km::PmmHeap& PageAllocator::heapOf(NumaNodeId node) {
+    if (node == mPrimaryNode) {
+        return mMemoryHeap;
+    }
+
+    return mNodes[std::to_underlying(node)].heap;
+}
+
+km::PmmHeap& PageAllocator::heapOwning(PhysicalAddress address) {
+    NumaNodeId node = nodeOf(address);
+    return heapOf(node);
+}
+
+NumaNodeId PageAllocator::nodeOf(PhysicalAddress address) noexcept {
+    for (uint32_t i = 0; i < mNodeCount; i++) {
+        for (MemoryRange range : mNodes[i].ranges) {
+            if (range.contains(address)) {
+                return NumaNodeId(i);
+            }
+        }
+    }
+
+    return mPrimaryNode;
+}
+
+PmmAllocation PageAllocator::allocateOnNode(size_t align, size_t size, NumaNodeId node) [[clang::allocating]] {
+    if (std::to_underlying(node) >= mNodeCount) {
+        node = mPrimaryNode;
+    }
+
+    const NodeHeap& local = mNodes[std::to_underlying(node)];
+    for (uint32_t i = 0; i < local.fallbackCount; i++) {
+        if (PmmAllocation allocation = heapOf(local.fallback[i]).alignedAlloc(align, size)) {
+            return allocation;
+        }
+    }
+
+    return PmmAllocation{};
+}
+
 PmmAllocation PageAllocator::pageAlloc(size_t count) [[clang::allocating]] {
     return aligned_alloc(alignof(x64::page), count * x64::kPageSize);
 }
 
+PmmAllocation PageAllocator::pageAlloc(size_t count, NumaNodeId node) [[clang::allocating]] {
+    return aligned_alloc(alignof(x64::page), count * x64::kPageSize, node);
+}
+
 PmmAllocation PageAllocator::aligned_alloc(size_t align, size_t size) [[clang::allocating]] {
-    stdx::LockGuard guard(mLock);
-    return mMemoryHeap.alignedAlloc(align, size);
+    PmmAllocation allocation = [&] {
+        stdx::LockGuard guard(mLock);
+        if (mNodeCount == 0) {
+            return mMemoryHeap.alignedAlloc(align, size);
+        }
+
+        //
+        // Only query the current node after partitioning, allocations made before then
+        // may happen before cpu local storage is available.
+        //
+        return allocateOnNode(align, size, GetCurrentNumaNode());
+    }();
+
+    // events are sent after dropping the lock so the heap is never held while writing to the stream
+    return SendAllocateEvent(allocation, align);
+}
+
+PmmAllocation PageAllocator::aligned_alloc(size_t align, size_t size, NumaNodeId node) [[clang::allocating]] {
+    PmmAllocation allocation = [&] {
+        stdx::LockGuard guard(mLock);
+        if (mNodeCount == 0) {
+            return mMemoryHeap.alignedAlloc(align, size);
+        }
+
+        return allocateOnNode(align, size, node);
+    }();
+
+    return SendAllocateEvent(allocation, align);
 }
 
 OsStatus PageAllocator::splitv(PmmAllocation ptr, std::span<const PhysicalAddress> points, std::span<PmmAllocation> results) {
     stdx::LockGuard guard(mLock);
-    return mMemoryHeap.splitv(ptr, points, results);
+    return heapOwning(ptr.address()).splitv(ptr, points, results);
 }
 
 OsStatus PageAllocator::split(PmmAllocation allocation, PhysicalAddress midpoint, PmmAllocation *lo [[outparam]], PmmAllocation *hi [[outparam]]) [[clang::allocating]] {
     stdx::LockGuard guard(mLock);
-    return mMemoryHeap.split(allocation, midpoint.address, lo, hi);
+    return heapOwning(allocation.address()).split(allocation, midpoint.address, lo, hi);
 }
 
 void PageAllocator::free(PmmAllocation allocation) noexcept [[clang::nonallocating]] {
-    stdx::LockGuard guard(mLock);
-    mMemoryHeap.free(allocation);
+    MemoryRange range = allocation.range();
+
+    {
+        stdx::LockGuard guard(mLock);
+        heapOwning(allocation.address()).free(allocation);
+    }
+
+    debug::SendEvent(debug::ReleasePhysicalMemory {
+        .begin = range.front.address,
+        .end = range.back.address,
+        .tag = 0,
+    });
 }
 
 OsStatus PageAllocator::reserve(MemoryRange range, PmmAllocation *allocation [[outparam]]) {
@@ -40,11 +135,14 @@ OsStatus PageAllocator::reserve(MemoryRange range, PmmAllocation *allocation [[o
         return OsStatusInvalidInput;
     }
 
-    stdx::LockGuard guard(mLock);
-    if (OsStatus status = mMemoryHeap.reserve(range.cast<km::PhysicalAddress>(), allocation)) {
-        return status;
+    {
+        stdx::LockGuard guard(mLock);
+        if (OsStatus status = heapOwning(range.front).reserve(range.cast<km::PhysicalAddress>(), allocation)) {
+            return status;
+        }
     }
 
+    SendAllocateEvent(*allocation, x64::kPageSize);
     return OsStatusSuccess;
 }
 
@@ -56,9 +154,142 @@ void PageAllocator::release(MemoryRange range) {
 
 PageAllocatorStats PageAllocator::stats() noexcept {
     stdx::LockGuard guard(mLock);
-    return {
-        mMemoryHeap.stats(),
+    PageAllocatorStats result {
+        .heap = mMemoryHeap.stats(),
+        .nodeCount = mNodeCount,
     };
+
+    for (uint32_t i = 0; i < mNodeCount; i++) {
+        NumaNodeId node = NumaNodeId(i);
+        if (node == mPrimaryNode || !mNodes[i].ranges.isEmpty()) {
+            result.nodes[i] = heapOf(node).stats();
+        }
+    }
+
+    return result;
+}
+
+OsStatus PageAllocator::partition(const NumaTopology& topology, NumaNodeId primary) [[clang::allocating]] {
+    uint32_t nodeCount = topology.nodeCount();
+    if (nodeCount <= 1) {
+        return OsStatusSuccess;
+    }
+
+    if (std::to_underlying(primary) >= nodeCount) {
+        return OsStatusInvalidInput;
+    }
+
+    std::unique_ptr<NodeHeap[]> nodes{new (std::nothrow) NodeHeap[nodeCount]};
+    if (!nodes) {
+        return OsStatusOutOfMemory;
+    }
+
+    stdx::LockGuard guard(mLock);
+
+    if (mNodeCount != 0) {
+        return OsStatusAlreadyExists;
+    }
+
+    stdx::Vector2<MemoryRange> freeMemory;
+    OsStatus gatherStatus = OsStatusSuccess;
+    mMemoryHeap.forEachFreeRange([&](MemoryRange range) {
+        if (gatherStatus == OsStatusSuccess) {
+            gatherStatus = freeMemory.add(range);
+        }
+    });
+
+    if (gatherStatus != OsStatusSuccess) {
+        return gatherStatus;
+    }
+
+    //
+    // Reserve the free memory of every remote node in the primary heap, these
+    // reservations are never released while the node heaps exist. If anything
+    // fails then all reservations are returned and the allocator is left as it was.
+    //
+    km::PmmHeap& primaryHeap = mMemoryHeap;
+    stdx::Vector2<PmmAllocation> reserved;
+    auto rollback = [&](OsStatus error) {
+        for (PmmAllocation allocation : reserved) {
+            primaryHeap.free(allocation);
+        }
+
+        return error;
+    };
+
+    for (const NumaMemoryAffinity& affinity : topology.memory()) {
+        if (affinity.node == primary) {
+            continue;
+        }
+
+        for (MemoryRange range : freeMemory) {
+            MemoryRange inner = km::intersection(range, affinity.range);
+            inner.front.address = sm::roundup(inner.front.address, x64::kPageSize);
+            inner.back.address = sm::rounddown(inner.back.address, x64::kPageSize);
+            if (inner.front >= inner.back) {
+                continue;
+            }
+
+            PmmAllocation allocation;
+            if (OsStatus status = mMemoryHeap.reserve(inner, &allocation)) {
+                // Overlapping affinity entries, the memory has already been claimed.
+                if (status == OsStatusNotAvailable) {
+                    continue;
+                }
+
+                return rollback(status);
+            }
+
+            if (OsStatus status = reserved.add(allocation)) {
+                mMemoryHeap.free(allocation);
+                return rollback(status);
+            }
+
+            if (OsStatus status = nodes[std::to_underlying(affinity.node)].ranges.add(inner)) {
+                return rollback(status);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < nodeCount; i++) {
+        NodeHeap& node = nodes[i];
+        if (node.ranges.isEmpty()) {
+            continue;
+        }
+
+        std::sort(node.ranges.begin(), node.ranges.end(), [](MemoryRange lhs, MemoryRange rhs) {
+            return lhs.front < rhs.front;
+        });
+
+        if (OsStatus status = km::PmmHeap::create(std::span(node.ranges.begin(), node.ranges.end()), &node.heap)) {
+            return rollback(status);
+        }
+    }
+
+    //
+    // Nodes without any free memory of their own are skipped entirely, they are
+    // served by the nearest node that does have memory.
+    //
+    for (uint32_t i = 0; i < nodeCount; i++) {
+        NumaNodeId order[kMaxNumaNodes];
+        size_t count = topology.nodesByDistance(NumaNodeId(i), order);
+
+        NodeHeap& node = nodes[i];
+        node.fallbackCount = 0;
+        for (size_t j = 0; j < count; j++) {
+            if (order[j] == primary || !nodes[std::to_underlying(order[j])].ranges.isEmpty()) {
+                node.fallback[node.fallbackCount++] = order[j];
+            }
+        }
+
+        MemLog.infof(NumaNodeId(i), " owns ", node.ranges.count(), " ranges, nearest node with memory ", node.fallback[0]);
+    }
+
+    mPrimaryNode = primary;
+    mNodes = std::move(nodes);
+    mNodeCount = nodeCount;
+
+    return OsStatusSuccess;
 }
 
 OsStatus PageAllocator::create(std::span<const boot::MemoryRegion> memmap, PageAllocator *allocator [[outparam]]) [[clang::allocating]] {
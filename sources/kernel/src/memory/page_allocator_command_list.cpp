@@ -4,13 +4,45 @@
 using km::PageAllocatorCommandList;
 
 PageAllocatorCommandList::PageAllocatorCommandList(PageAllocator *allocator [[gnu::nonnull]]) noexcept
-    : mList(&allocator->mMemoryHeap)
+    : mAllocator(allocator)
+    , mList(&allocator->mMemoryHeap)
+    , mNodeList(&allocator->mMemoryHeap)
+    , mNodeHeap(nullptr)
 { }
 
+km::GenericTlsfHeapCommandList<km::PhysicalAddress> *PageAllocatorCommandList::listFor(km::PmmAllocation allocation) noexcept [[clang::nonallocating]] {
+    CLANG_DIAGNOSTIC_PUSH();
+    CLANG_DIAGNOSTIC_IGNORE("-Wthread-safety");
+
+    km::PmmHeap *heap = &mAllocator->heapOwning(allocation.address());
+
+    CLANG_DIAGNOSTIC_POP();
+
+    if (heap == &mAllocator->mMemoryHeap) {
+        return &mList;
+    }
+
+    if (mNodeHeap == nullptr) {
+        mNodeList = GenericTlsfHeapCommandList<km::PhysicalAddress>(heap);
+        mNodeHeap = heap;
+    }
+
+    return (mNodeHeap == heap) ? &mNodeList : nullptr;
+}
+
 OsStatus PageAllocatorCommandList::split(km::PmmAllocation allocation, PhysicalAddress midpoint, km::PmmAllocation *lo [[outparam]], km::PmmAllocation *hi [[outparam]]) [[clang::allocating]] {
-    return mList.split(allocation, midpoint, lo, hi);
+    auto *list = listFor(allocation);
+    if (list == nullptr) {
+        return OsStatusNotSupported;
+    }
+
+    return list->split(allocation, midpoint, lo, hi);
 }
 
 void PageAllocatorCommandList::commit() noexcept [[clang::nonallocating]] {
     mList.commit();
+
+    if (mNodeHeap != nullptr) {
+        mNodeList.commit();
+    }
 }
@@ -402,6 +402,8 @@ void PageTables::drainTableList(detail::PageTableList list) noexcept [[clang::no
 }
 
 void PageTables::mapWithList(AddressMapping mapping, PageFlags flags, MemoryType type, detail::PageTableList& buffer) noexcept [[clang::nonallocating]] {
+    detail::PageWalkCache::ModifyGuard walkGuard(mWalkCache);
+
     //
     // We can use large pages if the range is larger than 2m after alignment and the mapping
     // has equal alignment between the physical and virtual addresses relative to the 2m boundary.
@@ -573,15 +575,64 @@ PageTableStats PageTables::stats() const noexcept [[clang::nonallocating]] {
     return stats;
 }
 
-void PageTables::partialRemap2m(x64::PageTable *pt, VirtualRange range, PhysicalAddressEx paddr, MemoryType type) {
+/// @brief Get the access flags of a single page table entry.
+static PageFlags GetEntryFlags(const x64::Entry& entry) noexcept [[clang::nonblocking]] {
+    PageFlags flags = PageFlags::eRead;
+    if (entry.writeable()) flags |= PageFlags::eWrite;
+    if (entry.executable()) flags |= PageFlags::eExecute;
+    if (entry.user()) flags |= PageFlags::eUser;
+    return flags;
+}
+
+/// @brief Update the access flags of a page table entry without changing its address or memory type.
+static void SetAccessFlags(x64::Entry& entry, PageFlags flags) noexcept [[clang::nonblocking]] {
+    entry.setWriteable(bool(flags & PageFlags::eWrite));
+    entry.setExecutable(bool(flags & PageFlags::eExecute));
+    entry.setUser(bool(flags & PageFlags::eUser));
+}
+
+void PageTables::partialRemap2m(x64::PageTable *pt, VirtualRange range, PhysicalAddressEx paddr, MemoryType type, PageFlags flags) {
     KM_CHECK(!range.isEmpty(), "Cannot remap empty range.");
 
     for (uintptr_t i = (uintptr_t)range.front; i < (uintptr_t)range.back; i += x64::kPageSize) {
         auto [pml4e, pdpte, pdte, pte] = getAddressParts(i);
         x64::pte& t1 = pt->entries[pte];
         mPageManager->setMemoryType(t1, type);
-        setEntryFlags(t1, mMiddleFlags, paddr + (i - (uintptr_t)range.front));
+        setEntryFlags(t1, flags, paddr + (i - (uintptr_t)range.front));
+    }
+}
+
+void PageTables::shatter2mMapping(x64::pdte& pde, VirtualRange page, PageTableAllocation allocation) {
+    KM_CHECK(pde.is2m(), "Splitting pde that is already split.");
+    x64::PageTable *pt = std::bit_cast<x64::PageTable*>(allocation.getVirtual());
+
+    MemoryType type = mPageManager->getMemoryType(pde);
+    PhysicalAddressEx paddr = mPageManager->address(pde);
+
+    partialRemap2m(pt, page, paddr, type, GetEntryFlags(pde));
+
+    setEntryFlags(pde, mMiddleFlags, asPhysical(allocation));
+    pde.set2m(false);
+}
+
+void PageTables::splitLargePageAt(uintptr_t address, detail::PageTableList& buffer) {
+    if (address % x64::kLargePageSize == 0) {
+        return;
     }
+
+    PageWalk walk = walkUnlocked(address);
+    if (walk.pageSize() != PageSize::eLarge) {
+        return;
+    }
+
+    uintptr_t front2m = sm::rounddown(address, x64::kLargePageSize);
+    VirtualRange page = { (void*)front2m, (void*)(front2m + x64::kLargePageSize) };
+    shatter2mMapping(getLargePageEntry((void*)address), page, claimListEntry(buffer));
+
+    //
+    // The large page was a single tlb entry, flush it now that it has been replaced.
+    //
+    x64::invlpg(front2m);
 }
 
 void PageTables::split2mMapping(x64::pdte& pde, VirtualRange page, VirtualRange erase, PageTableAllocation allocation) {
@@ -591,17 +642,18 @@ void PageTables::split2mMapping(x64::pdte& pde, VirtualRange page, VirtualRange
     auto [lo, hi] = km::split(page, erase);
     MemoryType type = mPageManager->getMemoryType(pde);
     PhysicalAddressEx paddr = mPageManager->address(pde);
+    PageFlags flags = GetEntryFlags(pde);
     uintptr_t hiOffset = (uintptr_t)erase.back - (uintptr_t)page.front;
 
     //
     // Map the lo part of the remaining area.
     //
-    partialRemap2m(pt, lo, paddr, type);
+    partialRemap2m(pt, lo, paddr, type, flags);
 
     //
     // The map the hi part of the area.
     //
-    partialRemap2m(pt, hi, paddr + hiOffset, type);
+    partialRemap2m(pt, hi, paddr + hiOffset, type, flags);
 
     //
     // Finally, update the 2m page to point to the new 4k page table.
@@ -621,7 +673,7 @@ void PageTables::cut2mMapping(x64::pdte& pde, VirtualRange page, VirtualRange er
     //
     // Remap the area that is still valid.
     //
-    partialRemap2m(pt, remaining, paddr + offset, type);
+    partialRemap2m(pt, remaining, paddr + offset, type, GetEntryFlags(pde));
 
     //
     // Update the 2m page to point to the new 4k page table.
@@ -743,7 +795,29 @@ PageWalk PageTables::walkUnlocked(sm::VirtualAddress ptr) const noexcept [[clang
     };
 }
 
+PageWalk PageTables::walkLeaf(uintptr_t address, VirtualRange *leaf [[outparam]]) noexcept [[clang::nonblocking]] {
+    PageWalk result;
+    if (mWalkCache.find(address, &result, leaf)) {
+        return result;
+    }
+
+    // captured before the walk so a walk that races with a modification is never cached
+    uint64_t generation = mWalkCache.generation();
+
+    result = walkUnlocked(address);
+
+    uintptr_t size = result.coverage();
+    uintptr_t front = sm::rounddown(address, size);
+    *leaf = VirtualRange { (const void*)front, (const void*)(front + size) };
+
+    mWalkCache.insert(result, *leaf, generation);
+
+    return result;
+}
+
 void PageTables::earlyUnmapWithList(int earlyAllocations, VirtualRange range, VirtualRange *remaining, detail::PageTableList& buffer) noexcept [[clang::nonallocating]] {
+    detail::PageWalkCache::ModifyGuard walkGuard(mWalkCache);
+
     if (earlyAllocations == 2) {
         //
         // We rebuild the first and last mappings early here, then shrink the range and continue the
@@ -837,6 +911,8 @@ void PageTables::unmapWithList(VirtualRange range, detail::PageTableList& buffer
 }
 
 void PageTables::unmapUnlocked(VirtualRange range) noexcept [[clang::nonallocating]] {
+    detail::PageWalkCache::ModifyGuard walkGuard(mWalkCache);
+
     x64::PageMapLevel4 *l4 = pml4();
 
     uintptr_t i = (uintptr_t)range.front;
@@ -917,6 +993,8 @@ OsStatus PageTables::unmap2m(VirtualRange range) {
         return OsStatusInvalidInput;
     }
 
+    detail::PageWalkCache::ModifyGuard walkGuard(mWalkCache);
+
     x64::PageMapLevel4 *l4 = pml4();
 
     for (uintptr_t i = (uintptr_t)range.front; i < (uintptr_t)range.back;) {
@@ -1009,6 +1087,92 @@ PageWalk PageTables::walk(const void *ptr) {
     return walkUnlocked(ptr);
 }
 
+OsStatus PageTables::protect(VirtualRange range, PageFlags flags) {
+    range = alignedOut(range, x64::kPageSize);
+
+    //
+    // Partially changing the flags of a 1g page would require splitting it into 512 2m pages,
+    // nothing maps user memory with 1g pages so this is not supported.
+    //
+    auto isPartialHugePage = [&](const void *address) {
+        return ((uintptr_t)address % x64::kHugePageSize != 0)
+            && (walkUnlocked(address).pageSize() == PageSize::eHuge);
+    };
+
+    if (isPartialHugePage(range.front) || isPartialHugePage(range.back)) {
+        return OsStatusNotSupported;
+    }
+
+    //
+    // Allocate the tables needed to split large pages at either end of the range
+    // before touching anything, same as when unmapping.
+    //
+    detail::PageTableList buffer;
+    if (int count = countRequiredPageTables(range)) {
+        if (!mAllocator.allocateList(count, &buffer)) {
+            return OsStatusOutOfMemory;
+        }
+    }
+
+    defer { drainTableList(std::move(buffer)); };
+
+    detail::PageWalkCache::ModifyGuard walkGuard(mWalkCache);
+
+    splitLargePageAt((uintptr_t)range.front, buffer);
+    splitLargePageAt((uintptr_t)range.back, buffer);
+
+    x64::PageMapLevel4 *l4 = pml4();
+
+    uintptr_t i = (uintptr_t)range.front;
+    uintptr_t end = (uintptr_t)range.back;
+
+    while (i < end) {
+        PageWalk walk = walkUnlocked(i);
+        uintptr_t next = sm::rounddown(i, walk.coverage()) + walk.coverage();
+
+        switch (walk.pageSize()) {
+        case PageSize::eHuge: {
+            x64::PageMapLevel3 *l3 = findPageMap3(l4, walk.pml4eIndex);
+            SetAccessFlags(l3->entries[walk.pdpteIndex], flags);
+            break;
+        }
+        case PageSize::eLarge: {
+            SetAccessFlags(getLargePageEntry((void*)i), flags);
+            break;
+        }
+        case PageSize::eRegular: {
+            x64::PageMapLevel3 *l3 = findPageMap3(l4, walk.pml4eIndex);
+            x64::PageMapLevel2 *l2 = findPageMap2(l3, walk.pdpteIndex);
+            x64::PageTable *pt = findPageTable(l2, walk.pdteIndex);
+            SetAccessFlags(pt->entries[walk.pteIndex], flags);
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (walk.pageSize() != PageSize::eNone) {
+            x64::invlpg(i);
+        }
+
+        if (next <= i) break;
+        i = next;
+    }
+
+    return OsStatusSuccess;
+}
+
+bool PageTables::isRangeMapped(VirtualRange range, PageFlags flags) {
+    bool mapped = true;
+
+    walkRange(range, [&](VirtualRange, const PageWalk& leaf) {
+        mapped = (leaf.flags() & flags) == flags;
+        return mapped;
+    });
+
+    return mapped;
+}
+
 template<typename T>
 static bool IsTableEmpty(const T *pt) {
     for (const auto& entry : pt->entries) {
@@ -44,6 +44,13 @@ uint8_t pci::IConfigSpace::read8(uint8_t bus, uint8_t slot, uint8_t function, ui
     return ExtractByte(data, offset);
 }
 
+void pci::IConfigSpace::write16(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset, uint16_t value) {
+    uint32_t data = read32(bus, slot, function, offset & ~0b11);
+    uint32_t shift = (offset & 2) * 8;
+    data = (data & ~(0xFFFFu << shift)) | (uint32_t(value) << shift);
+    write32(bus, slot, function, offset & ~0b11, data);
+}
+
 // port-based PCI configuration space read
 
 uint32_t pci::PortConfigSpace::read32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset) {
@@ -59,6 +66,18 @@ uint32_t pci::PortConfigSpace::read32(uint8_t bus, uint8_t slot, uint8_t functio
     return KmReadLong(kDataPort);
 }
 
+void pci::PortConfigSpace::write32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset, uint32_t value) {
+    uint32_t address
+        = uint32_t(bus) << 16
+        | uint32_t(slot) << 11
+        | uint32_t(function) << 8
+        | uint32_t(offset & kOffsetMask)
+        | kEnableBit;
+
+    KmWriteLong(kAddressPort, address);
+    KmWriteLong(kDataPort, value);
+}
+
 OsStatus pci::PortConfigSpace::create(PortConfigSpace **space [[gnu::nonnull]]) [[clang::allocating]] {
     void *ptr = aligned_alloc(alignof(PortConfigSpace), sizeof(PortConfigSpace));
     if (ptr == nullptr) {
@@ -126,6 +145,20 @@ uint32_t pci::McfgConfigSpace::read32(uint8_t bus, uint8_t slot, uint8_t functio
     return UINT32_MAX;
 }
 
+void pci::McfgConfigSpace::write32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset, uint32_t value) {
+    for (size_t i = 0; i < mMcfg->allocationCount(); i++) {
+        const EcamRegion& region = mRegions[i];
+        if (!region.contains(bus)) continue;
+
+        uint32_t address = (uint32_t(bus) << 20) | (uint32_t(slot) << 15) | (uint32_t(function) << 12) | offset;
+
+        *(volatile uint32_t*)((uint8_t*)region.baseAddress() + address) = value;
+        return;
+    }
+
+    PciLog.warnf("ECAM region not found for ", km::Hex(bus).pad(2), ":", km::Hex(slot).pad(2), ":", km::Hex(function).pad(2));
+}
+
 pci::IConfigSpace *pci::setupConfigSpace(const acpi::Mcfg *mcfg, km::AddressSpace& memory) {
     IConfigSpace *space;
     if (OsStatus status = setupConfigSpace(mcfg, memory, &space)) {
@@ -0,0 +1,400 @@
+#include "pci/msi.hpp"
+
+#include "isr/runtime.hpp"
+#include "logger/categories.hpp"
+#include "memory/address_space.hpp"
+#include "panic.hpp"
+#include "processor.hpp"
+
+using pci::DeviceInterrupts;
+
+namespace {
+    // MSI-X message control
+    constexpr uint16_t kMsiXTableSizeMask = 0x7FF;
+    constexpr uint16_t kMsiXFunctionMask = (1 << 14);
+    constexpr uint16_t kMsiXEnable = (1 << 15);
+    constexpr uint32_t kMsiXBirMask = 0x7;
+
+    // MSI-X vector control
+    constexpr uint32_t kMsiXEntryMasked = (1 << 0);
+
+    // MSI message control
+    constexpr uint16_t kMsiEnable = (1 << 0);
+    constexpr uint16_t kMsiMultipleMessageEnable = (0b111 << 4);
+    constexpr uint16_t kMsi64Bit = (1 << 7);
+    constexpr uint16_t kMsiPerVectorMask = (1 << 8);
+
+    /// @brief The largest apic id that can be addressed without interrupt remapping.
+    constexpr uint32_t kMaxMessageApicId = 0xFF;
+
+    bool IsAddressable(km::CpuCoreId core) {
+        return std::to_underlying(core) <= kMaxMessageApicId;
+    }
+}
+
+bool pci::ReadMsiXCapability(IConfigSpace *config, DeviceBusAddress address, MsiXCapability *capability [[outparam]]) {
+    uint8_t offset = FindCapability(config, address, CapabilityId::eMsiX);
+    if (offset == 0) {
+        return false;
+    }
+
+    auto [bus, slot, function] = address;
+    uint16_t control = config->read16(bus, slot, function, offset + 2);
+    uint32_t table = config->read32(bus, slot, function, offset + 4);
+
+    *capability = MsiXCapability {
+        .offset = offset,
+        .tableSize = uint16_t((control & kMsiXTableSizeMask) + 1),
+        .tableBar = uint8_t(table & kMsiXBirMask),
+        .tableOffset = table & ~kMsiXBirMask,
+    };
+
+    return true;
+}
+
+bool pci::ReadMsiCapability(IConfigSpace *config, DeviceBusAddress address, MsiCapability *capability [[outparam]]) {
+    uint8_t offset = FindCapability(config, address, CapabilityId::eMsi);
+    if (offset == 0) {
+        return false;
+    }
+
+    auto [bus, slot, function] = address;
+    uint16_t control = config->read16(bus, slot, function, offset + 2);
+
+    *capability = MsiCapability {
+        .offset = offset,
+        .is64Bit = bool(control & kMsi64Bit),
+        .perVectorMask = bool(control & kMsiPerVectorMask),
+    };
+
+    return true;
+}
+
+OsStatus DeviceInterrupts::allocateVectors(std::span<const km::IsrCallback> handlers, size_t firstCpu) {
+    std::span<const km::CpuIsrTable> tables = km::GetCpuIsrTables();
+    if (tables.empty()) {
+        return OsStatusOutOfMemory;
+    }
+
+    for (size_t i = 0; i < handlers.size(); i++) {
+        //
+        // Start each vector on the next cpu so the vectors of a device are spread
+        // evenly, if a cpu has run out of vectors fall through to the ones after it.
+        //
+        bool allocated = false;
+        for (size_t j = 0; j < tables.size() && !allocated; j++) {
+            const km::CpuIsrTable& cpu = tables[(firstCpu + i + j) % tables.size()];
+            if (!IsAddressable(cpu.core)) {
+                continue;
+            }
+
+            if (const km::IsrEntry *entry = cpu.table->allocate(handlers[i])) {
+                mVectors[i] = InterruptVector {
+                    .core = cpu.core,
+                    .vector = cpu.table->index(entry),
+                    .table = cpu.table,
+                    .entry = entry,
+                    .callback = handlers[i],
+                };
+
+                mCount += 1;
+                allocated = true;
+            }
+        }
+
+        if (!allocated) {
+            releaseVectors();
+            return OsStatusOutOfMemory;
+        }
+    }
+
+    return OsStatusSuccess;
+}
+
+void DeviceInterrupts::releaseVectors() {
+    for (InterruptVector& vector : std::span(mVectors, mCount)) {
+        vector.table->release(vector.entry, vector.callback);
+    }
+
+    mCount = 0;
+}
+
+OsStatus DeviceInterrupts::enableMsiX(km::AddressSpace& memory) {
+    auto [bus, slot, function] = mAddress;
+
+    km::PhysicalAddressEx bar = ReadMemoryBar(mConfig, mAddress, mMsiX.tableBar);
+    if (bar == km::PhysicalAddressEx::invalid() || bar.isNull()) {
+        PciLog.warnf("MSI-X table BAR", mMsiX.tableBar, " is not a memory BAR");
+        return OsStatusNotSupported;
+    }
+
+    km::MemoryRangeEx range = km::MemoryRangeEx::of(bar + mMsiX.tableOffset, mMsiX.tableSize * sizeof(MsiXTableEntry));
+    mTable = memory.mapObject<MsiXTableEntry>(range, km::PageFlags::eData, km::MemoryType::eUncached, &mTableAllocation);
+    if (mTable == nullptr) {
+        return OsStatusOutOfMemory;
+    }
+
+    mMemory = &memory;
+
+    EnableCommand(mConfig, mAddress, DeviceCommand::eMemorySpace | DeviceCommand::eBusMaster | DeviceCommand::eInterruptDisable);
+
+    //
+    // The table may only be programmed while MSI-X is enabled, hold every
+    // vector with the function mask until all the entries are written.
+    //
+    uint16_t control = mConfig->read16(bus, slot, function, mMsiX.offset + 2);
+    mConfig->write16(bus, slot, function, mMsiX.offset + 2, control | kMsiXEnable | kMsiXFunctionMask);
+
+    for (uint16_t i = 0; i < mMsiX.tableSize; i++) {
+        mTable[i].control = mTable[i].control | kMsiXEntryMasked;
+    }
+
+    for (uint16_t index = 0; index < mCount; index++) {
+        const InterruptVector& vector = mVectors[index];
+        MsiMessage message = ComposeMsiMessage(std::to_underlying(vector.core), vector.vector);
+        mTable[index].addressLow = uint32_t(message.address);
+        mTable[index].addressHigh = uint32_t(message.address >> 32);
+        mTable[index].data = message.data;
+    }
+
+    mConfig->write16(bus, slot, function, mMsiX.offset + 2, (control | kMsiXEnable) & ~kMsiXFunctionMask);
+
+    mMode = InterruptMode::eMsiX;
+    return OsStatusSuccess;
+}
+
+void DeviceInterrupts::unmapTable() {
+    if (mTable == nullptr) {
+        return;
+    }
+
+    if (OsStatus status = mMemory->unmap(mTableAllocation)) {
+        PciLog.warnf("Failed to unmap MSI-X table: ", OsStatusId(status));
+    }
+
+    mTable = nullptr;
+    mTableAllocation = km::VmemAllocation{};
+}
+
+void DeviceInterrupts::enableMsi() {
+    auto [bus, slot, function] = mAddress;
+    uint8_t offset = mMsi.offset;
+
+    EnableCommand(mConfig, mAddress, DeviceCommand::eBusMaster | DeviceCommand::eInterruptDisable);
+
+    // only a single message is enabled, so the low bits of the data are never modified by the device
+    uint16_t control = mConfig->read16(bus, slot, function, offset + 2);
+    control &= ~(kMsiEnable | kMsiMultipleMessageEnable);
+    mConfig->write16(bus, slot, function, offset + 2, control);
+
+    const InterruptVector& vector = mVectors[0];
+    MsiMessage message = ComposeMsiMessage(std::to_underlying(vector.core), vector.vector);
+    mConfig->write32(bus, slot, function, offset + 4, uint32_t(message.address));
+    if (mMsi.is64Bit) {
+        mConfig->write32(bus, slot, function, offset + 8, uint32_t(message.address >> 32));
+        mConfig->write16(bus, slot, function, offset + 12, uint16_t(message.data));
+    } else {
+        mConfig->write16(bus, slot, function, offset + 8, uint16_t(message.data));
+    }
+
+    mMode = InterruptMode::eMsi;
+
+    // without a mask register the vector is masked by leaving MSI disabled
+    mask(0);
+    if (mMsi.perVectorMask) {
+        setMsiEnabled(true);
+    }
+}
+
+void DeviceInterrupts::setMsiEnabled(bool enabled) {
+    auto [bus, slot, function] = mAddress;
+    uint16_t control = mConfig->read16(bus, slot, function, mMsi.offset + 2);
+    control = enabled ? (control | kMsiEnable) : (control & ~kMsiEnable);
+    mConfig->write16(bus, slot, function, mMsi.offset + 2, control);
+}
+
+OsStatus DeviceInterrupts::create(
+    IConfigSpace *config, DeviceBusAddress address, km::AddressSpace& memory,
+    std::span<const km::IsrCallback> handlers, size_t firstCpu,
+    DeviceInterrupts *interrupts [[outparam]]
+) {
+    if (handlers.empty() || handlers.size() > kMaxVectors) {
+        return OsStatusInvalidInput;
+    }
+
+    DeviceInterrupts result;
+    result.mConfig = config;
+    result.mAddress = address;
+
+    bool hasMsiX = ReadMsiXCapability(config, address, &result.mMsiX);
+    bool hasMsi = ReadMsiCapability(config, address, &result.mMsi);
+
+    if (hasMsiX && handlers.size() <= result.mMsiX.tableSize) {
+        if (OsStatus status = result.allocateVectors(handlers, firstCpu)) {
+            return status;
+        }
+
+        if (OsStatus status = result.enableMsiX(memory)) {
+            result.unmapTable();
+            result.releaseVectors();
+            return status;
+        }
+    } else if (hasMsi && handlers.size() == 1) {
+        if (OsStatus status = result.allocateVectors(handlers, firstCpu)) {
+            return status;
+        }
+
+        result.enableMsi();
+    } else {
+        return OsStatusNotSupported;
+    }
+
+    *interrupts = result;
+    return OsStatusSuccess;
+}
+
+void DeviceInterrupts::release() {
+    auto [bus, slot, function] = mAddress;
+
+    switch (mMode) {
+    case InterruptMode::eMsiX: {
+        for (uint16_t i = 0; i < mCount; i++) {
+            mask(i);
+        }
+
+        uint16_t control = mConfig->read16(bus, slot, function, mMsiX.offset + 2);
+        mConfig->write16(bus, slot, function, mMsiX.offset + 2, control & ~kMsiXEnable);
+
+        // the device can no longer use the table once MSI-X is disabled
+        unmapTable();
+        break;
+    }
+    case InterruptMode::eMsi:
+        setMsiEnabled(false);
+        break;
+    default:
+        return;
+    }
+
+    releaseVectors();
+    mMode = InterruptMode::eNone;
+}
+
+void DeviceInterrupts::mask(uint16_t index) noexcept {
+    KM_ASSERT(index < mCount);
+
+    switch (mMode) {
+    case InterruptMode::eMsiX:
+        mTable[index].control = mTable[index].control | kMsiXEntryMasked;
+        break;
+    case InterruptMode::eMsi: {
+        if (!mMsi.perVectorMask) {
+            setMsiEnabled(false);
+            break;
+        }
+
+        auto [bus, slot, function] = mAddress;
+        uint16_t maskOffset = mMsi.offset + (mMsi.is64Bit ? 16 : 12);
+        uint32_t bits = mConfig->read32(bus, slot, function, maskOffset);
+        mConfig->write32(bus, slot, function, maskOffset, bits | 1);
+        break;
+    }
+    default:
+        KM_PANIC("Masking a vector of a device without message interrupts");
+    }
+}
+
+void DeviceInterrupts::unmask(uint16_t index) noexcept {
+    KM_ASSERT(index < mCount);
+
+    switch (mMode) {
+    case InterruptMode::eMsiX:
+        mTable[index].control = mTable[index].control & ~kMsiXEntryMasked;
+        break;
+    case InterruptMode::eMsi: {
+        if (!mMsi.perVectorMask) {
+            setMsiEnabled(true);
+            break;
+        }
+
+        auto [bus, slot, function] = mAddress;
+        uint16_t maskOffset = mMsi.offset + (mMsi.is64Bit ? 16 : 12);
+        uint32_t bits = mConfig->read32(bus, slot, function, maskOffset);
+        mConfig->write32(bus, slot, function, maskOffset, bits & ~1u);
+        break;
+    }
+    default:
+        KM_PANIC("Unmasking a vector of a device without message interrupts");
+    }
+}
+
+bool DeviceInterrupts::isMasked(uint16_t index) const noexcept {
+    KM_ASSERT(index < mCount);
+
+    auto [bus, slot, function] = mAddress;
+
+    switch (mMode) {
+    case InterruptMode::eMsiX:
+        return mTable[index].control & kMsiXEntryMasked;
+    case InterruptMode::eMsi:
+        if (!mMsi.perVectorMask) {
+            return !(mConfig->read16(bus, slot, function, mMsi.offset + 2) & kMsiEnable);
+        }
+
+        return mConfig->read32(bus, slot, function, mMsi.offset + (mMsi.is64Bit ? 16 : 12)) & 1;
+    default:
+        return true;
+    }
+}
+
+OsStatus DeviceInterrupts::setAffinity(uint16_t index, size_t cpu) {
+    KM_ASSERT(index < mCount);
+
+    std::span<const km::CpuIsrTable> tables = km::GetCpuIsrTables();
+    if (cpu >= tables.size() || !IsAddressable(tables[cpu].core)) {
+        return OsStatusNotSupported;
+    }
+
+    const km::CpuIsrTable& target = tables[cpu];
+    InterruptVector& current = mVectors[index];
+
+    const km::IsrEntry *entry = target.table->allocate(current.callback);
+    if (entry == nullptr) {
+        return OsStatusOutOfMemory;
+    }
+
+    InterruptVector moved {
+        .core = target.core,
+        .vector = target.table->index(entry),
+        .table = target.table,
+        .entry = entry,
+        .callback = current.callback,
+    };
+
+    //
+    // Keep the old vector installed until the device can no longer send the
+    // old message, a message already in flight is still handled correctly.
+    //
+    bool masked = isMasked(index);
+    mask(index);
+
+    auto [bus, slot, function] = mAddress;
+    MsiMessage message = ComposeMsiMessage(std::to_underlying(moved.core), moved.vector);
+    if (mMode == InterruptMode::eMsiX) {
+        mTable[index].addressLow = uint32_t(message.address);
+        mTable[index].addressHigh = uint32_t(message.address >> 32);
+        mTable[index].data = message.data;
+    } else {
+        mConfig->write32(bus, slot, function, mMsi.offset + 4, uint32_t(message.address));
+        mConfig->write16(bus, slot, function, mMsi.offset + (mMsi.is64Bit ? 12 : 8), uint16_t(message.data));
+    }
+
+    if (!masked) {
+        unmask(index);
+    }
+
+    current.table->release(current.entry, current.callback);
+    current = moved;
+
+    return OsStatusSuccess;
+}
@@ -2,6 +2,7 @@
 
 #include "logger/categories.hpp"
 
+#include <algorithm>
 #include <utility>
 
 pci::Capability pci::ReadCapability(IConfigSpace *config, uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset) {
@@ -85,6 +86,115 @@ pci::BridgeConfig pci::QueryBridge(IConfigSpace *config, uint8_t bus, uint8_t sl
     };
 }
 
+uint8_t pci::FindCapability(IConfigSpace *config, DeviceBusAddress address, CapabilityId id, uint8_t after) {
+    auto [bus, slot, function] = address;
+
+    uint8_t offset;
+    if (after != 0) {
+        offset = ReadCapability(config, bus, slot, function, after).next;
+    } else {
+        ConfigHeader header = QueryHeader(config, bus, slot, function);
+        if (!header.isValid() || !header.hasCapabilityList()) {
+            return 0;
+        }
+
+        offset = config->read8(bus, slot, function, header.capabilityOffset());
+    }
+
+    // the list is bounded to guard against malformed devices that link to themselves
+    for (int i = 0; i < 48 && offset != 0; i++) {
+        offset &= ~0b11;
+
+        Capability capability = ReadCapability(config, bus, slot, function, offset);
+        if (capability.id == id) {
+            return offset;
+        }
+
+        offset = capability.next;
+    }
+
+    return 0;
+}
+
+km::PhysicalAddressEx pci::ReadMemoryBar(IConfigSpace *config, DeviceBusAddress address, uint8_t bar) {
+    static constexpr uint32_t kIoSpace = (1 << 0);
+    static constexpr uint32_t kTypeMask = 0b110;
+    static constexpr uint32_t kType64 = 0b100;
+
+    if (bar >= 6) {
+        return km::PhysicalAddressEx::invalid();
+    }
+
+    auto [bus, slot, function] = address;
+    uint16_t offset = 0x10 + (bar * sizeof(uint32_t));
+    uint32_t low = config->read32(bus, slot, function, offset);
+
+    if (low & kIoSpace) {
+        return km::PhysicalAddressEx::invalid();
+    }
+
+    uint64_t base = low & ~0xFu;
+    if ((low & kTypeMask) == kType64) {
+        if (bar == 5) {
+            return km::PhysicalAddressEx::invalid();
+        }
+
+        uint64_t high = config->read32(bus, slot, function, offset + sizeof(uint32_t));
+        base |= (high << 32);
+    }
+
+    return km::PhysicalAddressEx { base };
+}
+
+void pci::EnableCommand(IConfigSpace *config, DeviceBusAddress address, DeviceCommand command) {
+    auto [bus, slot, function] = address;
+    uint16_t current = config->read16(bus, slot, function, 0x4);
+    config->write16(bus, slot, function, 0x4, current | std::to_underlying(command));
+}
+
+static void findDevicesOnBus(pci::IConfigSpace *config, uint8_t bus, pci::VendorId vendor, std::span<const pci::DeviceId> devices, std::span<pci::DeviceBusAddress> result, size_t& count) {
+    auto check = [&](uint8_t slot, uint8_t function) {
+        pci::ConfigHeader header = pci::QueryHeader(config, bus, slot, function);
+        if (!header.isValid()) return header;
+
+        if (header.vendorId == vendor && std::ranges::contains(devices, header.deviceId) && count < result.size()) {
+            result[count++] = pci::DeviceBusAddress { bus, slot, function };
+        }
+
+        return header;
+    };
+
+    for (uint8_t slot = 0; slot < 32; slot++) {
+        pci::ConfigHeader header = check(slot, 0);
+        if (!header.isValid() || !header.isMultiFunction()) continue;
+
+        for (uint8_t function = 1; function < 8; function++) {
+            check(slot, function);
+        }
+    }
+}
+
+size_t pci::FindDevices(IConfigSpace *config, const acpi::Mcfg *mcfg, VendorId vendor, std::span<const DeviceId> devices, std::span<DeviceBusAddress> result) {
+    // every bus is scanned directly rather than walking bridges, the bus ranges
+    // already include the secondary buses of any bridges.
+    size_t count = 0;
+    auto scanRange = [&](uint8_t first, uint8_t last) {
+        for (unsigned bus = first; bus <= last; bus++) {
+            findDevicesOnBus(config, bus, vendor, devices, result, count);
+        }
+    };
+
+    if (mcfg == nullptr) {
+        scanRange(0, 255);
+    } else {
+        for (const acpi::McfgAllocation& allocation : mcfg->mcfgAllocations()) {
+            scanRange(allocation.startBusNumber, allocation.endBusNumber);
+        }
+    }
+
+    return count;
+}
+
 static void probePciBus(pci::IConfigSpace *config, uint8_t bus);
 static void probePciDevice(pci::IConfigSpace *config, uint8_t bus, uint8_t slot);
 
@@ -282,6 +392,9 @@ void CapabilityIdFormat::format(km::IOutStream& out, pci::CapabilityId value) {
     case pci::CapabilityId::eMsi:
         out.write("MSI (0x05)");
         break;
+    case pci::CapabilityId::eVendorSpecific:
+        out.write("Vendor Specific (0x09)");
+        break;
     case pci::CapabilityId::ePciExpress:
         out.write("PCIe (0x10)");
         break;
@@ -2,6 +2,7 @@
 
 #include "apic.hpp"
 #include "thread.hpp"
+#include "memory/numa.hpp"
 
 struct KernelThreadData {
     uint32_t lapicId;
@@ -11,6 +12,9 @@ struct KernelThreadData {
 CPU_LOCAL
 static constinit km::CpuLocal<KernelThreadData> tlsCoreInfo;
 
+CPU_LOCAL
+static constinit km::CpuLocal<km::NumaNodeId> tlsNumaNode;
+
 void km::InitKernelThread(Apic pic) {
     uint32_t id = pic->id();
     tlsCoreInfo = KernelThreadData {
@@ -26,3 +30,11 @@ km::CpuCoreId km::GetCurrentCoreId() noexcept [[clang::reentrant]] {
 km::IApic *km::GetCpuLocalApic() noexcept [[clang::reentrant]] {
     return *tlsCoreInfo->pic;
 }
+
+km::NumaNodeId km::GetCurrentNumaNode() noexcept [[clang::reentrant]] {
+    return tlsNumaNode.get();
+}
+
+void km::SetCurrentNumaNode(NumaNodeId node) noexcept {
+    tlsNumaNode = node;
+}
@@ -0,0 +1,321 @@
+#include "profile/profiler.hpp"
+
+#include "apic.hpp"
+#include "logger/categories.hpp"
+#include "thread.hpp"
+
+#include "isr/isr.hpp"
+
+#include "std/publish_array.hpp"
+#include "std/ringbuffer.hpp"
+#include "std/spinlock.hpp"
+
+#include "system/schedule.hpp"
+#include "system/thread.hpp"
+
+#include "task/scheduler_queue.hpp"
+
+#include "util/cpuid.hpp"
+
+#include <new>
+
+// Intel SDM Vol 3B 21.2 Architectural Performance Monitoring
+static constexpr x64::RwModelRegister<0x30A> IA32_FIXED_CTR1;
+static constexpr x64::RwModelRegister<0x38D> IA32_FIXED_CTR_CTRL;
+static constexpr x64::RoModelRegister<0x38E> IA32_PERF_GLOBAL_STATUS;
+static constexpr x64::RwModelRegister<0x38F> IA32_PERF_GLOBAL_CTRL;
+static constexpr x64::RwModelRegister<0x390> IA32_PERF_GLOBAL_OVF_CTRL;
+
+/// @brief Fixed counter 1 counts unhalted core cycles, its enable and overflow bit.
+static constexpr uint64_t kCycleCounterBit = (UINT64_C(1) << 33);
+
+/// @brief The fixed counter 1 control field, count in ring 0 and ring 3 and raise a PMI on overflow.
+static constexpr uint64_t kCycleCounterControl = (0b1011 << 4);
+static constexpr uint64_t kCycleCounterControlMask = (0b1111 << 4);
+
+static constexpr size_t kMaxProfileCpus = 256;
+
+namespace {
+    struct ProfileCpu {
+        sm::AtomicRingQueue<km::ProfileSample> ring;
+        std::atomic<uint64_t> dropped;
+
+        km::ProfileSource source;
+        km::IApic *apic;
+
+        /// @brief The apic id reported by @a CurrentApicId, used to find this state from an NMI.
+        uint32_t apicId;
+
+        /// @brief The kernel gs base of the owning cpu.
+        uint64_t gsBase;
+
+        /// @brief The bits the cycle counter implements.
+        uint64_t counterMask;
+
+        /// @brief Is the PMU counting, only accessed by the owning cpu.
+        bool armed;
+    };
+}
+
+static constinit stdx::PublishArray<ProfileCpu*, kMaxProfileCpus> gProfileCpus{};
+
+static constinit std::atomic<bool> gProfilerRunning = false;
+static constinit std::atomic<bool> gHasTopologyLeaf = false;
+static constinit km::IsrCallback gPreviousNmiHandler = nullptr;
+
+// only one cpu may drain the rings at a time
+static constinit stdx::SpinLock gDrainLock;
+
+CPU_LOCAL
+static constinit km::CpuLocal<ProfileCpu*> tlsProfileCpu;
+
+static bool HasCycleCounter(uint64_t *mask) {
+    if (sm::CpuId::of(0).eax < 0xA) {
+        return false;
+    }
+
+    sm::CpuId leaf = sm::CpuId::of(0xA);
+    uint32_t version = leaf.eax & 0xFF;
+    uint32_t fixedCount = leaf.edx & 0x1F;
+    uint32_t fixedWidth = (leaf.edx >> 5) & 0xFF;
+
+    // the global control registers were added in version 2
+    if (version < 2 || fixedCount < 2 || fixedWidth == 0) {
+        return false;
+    }
+
+    *mask = (fixedWidth >= 64) ? UINT64_MAX : (UINT64_C(1) << fixedWidth) - 1;
+    return true;
+}
+
+/// @brief The apic id of the current cpu, without using cpu local storage.
+static uint32_t CurrentApicId() noexcept [[clang::reentrant]] {
+    if (gHasTopologyLeaf.load(std::memory_order_relaxed)) {
+        return sm::CpuId::count(0xB, 0).edx;
+    }
+
+    return sm::CpuId::of(1).ebx >> 24;
+}
+
+static ProfileCpu *FindProfileCpu(uint32_t apicId) noexcept [[clang::reentrant]] {
+    for (ProfileCpu *cpu : gProfileCpus.entries()) {
+        if (cpu->apicId == apicId) {
+            return cpu;
+        }
+    }
+
+    return nullptr;
+}
+
+static void ReloadCycleCounter(const ProfileCpu *cpu) noexcept [[clang::reentrant]] {
+    IA32_FIXED_CTR1 = (0 - kProfileCyclePeriod) & cpu->counterMask;
+    IA32_PERF_GLOBAL_OVF_CTRL = kCycleCounterBit;
+
+    // the apic masks the performance entry when it delivers a PMI
+    cpu->apic->cfgIvtPerformance(km::apic::IvtConfig {
+        .vector = 0,
+        .polarity = km::apic::Polarity::eActiveHigh,
+        .trigger = km::apic::Trigger::eEdge,
+        .enabled = true,
+        .delivery = km::apic::IcrMode::eNmi,
+    });
+}
+
+static void ArmCycleCounter(const ProfileCpu *cpu) noexcept [[clang::reentrant]] {
+    IA32_PERF_GLOBAL_CTRL &= ~kCycleCounterBit;
+
+    ReloadCycleCounter(cpu);
+
+    uint64_t control = IA32_FIXED_CTR_CTRL.load();
+    IA32_FIXED_CTR_CTRL = (control & ~kCycleCounterControlMask) | kCycleCounterControl;
+
+    IA32_PERF_GLOBAL_CTRL |= kCycleCounterBit;
+}
+
+static void DisarmCycleCounter(const ProfileCpu *cpu) noexcept [[clang::reentrant]] {
+    IA32_PERF_GLOBAL_CTRL &= ~kCycleCounterBit;
+    IA32_FIXED_CTR_CTRL &= ~kCycleCounterControlMask;
+    cpu->apic->maskIvt(km::apic::Ivt::ePerformance);
+}
+
+static void TakeSample(ProfileCpu *cpu, const km::IsrContext *context) noexcept [[clang::reentrant]] {
+    km::ProfileSample sample {
+        .task = 0,
+        .depth = 1,
+        .user = (context->cs & 0b11) != 0,
+        .pcs = { context->rip },
+    };
+
+    //
+    // An NMI can arrive in the swapgs windows on kernel entry and exit, where
+    // the cpl is 0 but gs still holds the user base. Cpu local storage can
+    // not be read there, so those samples only have the program counter.
+    //
+    if (IA32_GS_BASE.load() != cpu->gsBase) {
+        if (!cpu->ring.tryPush(sample)) {
+            cpu->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return;
+    }
+
+    task::SchedulerQueue *queue = sys::getTlsQueue();
+    task::SchedulerEntry *entry = (queue != nullptr) ? queue->getCurrentTask() : nullptr;
+    sample.task = reinterpret_cast<uintptr_t>(entry);
+
+    //
+    // User stacks may not be mapped and can not be read from an NMI, so
+    // user samples only have the sampled program counter. Kernel stacks
+    // are only walked within the kernel stack of the current thread.
+    //
+    if (!sample.user && entry != nullptr) {
+        km::StackMapping stack = static_cast<sys::Thread*>(entry)->getKernelStack();
+        uintptr_t front = reinterpret_cast<uintptr_t>(stack.stack.vaddr);
+        uintptr_t back = front + stack.stack.size;
+
+        if (context->rsp >= front && context->rsp < back) {
+            sample.depth += km::WalkProfileStack(context->rbp, context->rsp, back, sample.pcs + 1, km::kProfileStackDepth - 1);
+        }
+    }
+
+    if (!cpu->ring.tryPush(sample)) {
+        cpu->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static km::IsrContext ProfileNmi(km::IsrContext *context) noexcept [[clang::reentrant]] {
+    if (!(IA32_PERF_GLOBAL_STATUS.load() & kCycleCounterBit)) {
+        return gPreviousNmiHandler(context);
+    }
+
+    //
+    // Gs may hold the user base here, so the profiler state is found by apic id
+    // rather than through cpu local storage. The overflow is always acknowledged,
+    // otherwise the cpu would stop sampling until the profiler is restarted.
+    //
+    ProfileCpu *cpu = FindProfileCpu(CurrentApicId());
+    if (cpu == nullptr || cpu->source != km::ProfileSource::ePmu) {
+        IA32_PERF_GLOBAL_OVF_CTRL = kCycleCounterBit;
+        return *context;
+    }
+
+    if (gProfilerRunning.load(std::memory_order_relaxed)) {
+        TakeSample(cpu, context);
+    }
+
+    ReloadCycleCounter(cpu);
+    return *context;
+}
+
+void km::InstallProfilerIsr(SharedIsrTable *ist) {
+    gPreviousNmiHandler = ist->install(isr::NMI, ProfileNmi);
+}
+
+void km::InitCpuProfiler(IApic *apic) {
+    ProfileCpu *cpu = new (std::nothrow) ProfileCpu();
+    if (cpu == nullptr) {
+        CpuLog.warnf("Failed to allocate profiler state");
+        return;
+    }
+
+    if (OsStatus status = sm::AtomicRingQueue<ProfileSample>::create(kProfileRingCapacity, &cpu->ring)) {
+        CpuLog.warnf("Failed to allocate profiler samples: ", OsStatusId(status));
+        delete cpu;
+        return;
+    }
+
+    // leaf 0xB reports the full x2apic id, it is only valid when subleaf 0 has a non zero ebx
+    if (sm::CpuId::of(0).eax >= 0xB && sm::CpuId::count(0xB, 0).ebx != 0) {
+        gHasTopologyLeaf.store(true, std::memory_order_relaxed);
+    }
+
+    cpu->apic = apic;
+    cpu->apicId = CurrentApicId();
+    cpu->gsBase = IA32_GS_BASE.load();
+    cpu->source = HasCycleCounter(&cpu->counterMask) ? ProfileSource::ePmu : ProfileSource::eTimer;
+
+    if (OsStatus status = gProfileCpus.add(cpu)) {
+        CpuLog.warnf("Too many cpus to profile: ", OsStatusId(status));
+        delete cpu;
+        return;
+    }
+
+    tlsProfileCpu = cpu;
+
+    if (cpu->source == ProfileSource::ePmu) {
+        CpuLog.dbgf("Profiler sampling every ", kProfileCyclePeriod, " cycles");
+    } else {
+        CpuLog.dbgf("Profiler has no PMU, sampling on the APIC timer");
+    }
+}
+
+void km::ProfilerTimerTick(const IsrContext *context) noexcept [[clang::reentrant]] {
+    ProfileCpu *cpu = tlsProfileCpu.get();
+    if (cpu == nullptr) {
+        return;
+    }
+
+    bool running = gProfilerRunning.load(std::memory_order_relaxed);
+
+    switch (cpu->source) {
+    case ProfileSource::eTimer:
+        if (running) {
+            TakeSample(cpu, context);
+        }
+        break;
+
+    case ProfileSource::ePmu:
+        if (running != cpu->armed) {
+            if (running) {
+                ArmCycleCounter(cpu);
+            } else {
+                DisarmCycleCounter(cpu);
+            }
+
+            cpu->armed = running;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void km::SetProfilerRunning(bool running) noexcept {
+    gProfilerRunning.store(running, std::memory_order_relaxed);
+}
+
+bool km::IsProfilerRunning() noexcept {
+    return gProfilerRunning.load(std::memory_order_relaxed);
+}
+
+OsStatus km::DrainProfileSamples(stdx::Vector2<ProfileSample>& samples) {
+    stdx::LockGuard guard(gDrainLock);
+
+    for (ProfileCpu *cpu : gProfileCpus.entries()) {
+        // only take what there is room for, samples are never popped and then lost
+        uint32_t pending = cpu->ring.count();
+        if (OsStatus status = samples.reserve(samples.count() + pending)) {
+            return status;
+        }
+
+        ProfileSample sample;
+        for (uint32_t j = 0; j < pending && cpu->ring.tryPop(sample); j++) {
+            if (OsStatus status = samples.add(sample)) {
+                return status;
+            }
+        }
+    }
+
+    return OsStatusSuccess;
+}
+
+uint64_t km::GetProfileDroppedSamples() noexcept {
+    uint64_t dropped = 0;
+
+    for (const ProfileCpu *cpu : gProfileCpus.entries()) {
+        dropped += cpu->dropped.load(std::memory_order_relaxed);
+    }
+
+    return dropped;
+}
@@ -81,7 +81,7 @@ extern "C" [[noreturn]] void KmSmpStartup(SmpInfoHeader *header) {
 
     km::InitCpuLocalRegion();
 
-    km::RuntimeIsrManager::cpuInit();
+    km::RuntimeIsrManager::cpuInit(km::CpuCoreId(apic->id()));
     km::InitKernelThread(apic);
 
     km::SetupApGdt();
@@ -3,28 +3,82 @@
 #include "gdt.hpp"
 #include "kernel.hpp"
 #include "logger/categories.hpp"
+#include "syscall_stats.hpp"
 #include "thread.hpp"
 #include "user/user.hpp"
 
+#include <new>
+
 static constexpr x64::RwModelRegister<0xC0000081> IA32_STAR;
 static constexpr x64::RwModelRegister<0xC0000082> IA32_LSTAR;
 static constexpr x64::RwModelRegister<0xC0000084> IA32_FMASK;
 
 static constexpr size_t kStackSize = 0x4000 * 4;
 
-static constinit km::CallHandler gSystemCalls[256] = { nullptr };
+static constinit km::CallHandler gSystemCalls[km::kSyscallCount] = { nullptr };
+
+static constinit km::SyscallStats gSyscallStats{};
+
+CPU_LOCAL
+static constinit km::CpuLocal<km::SyscallCounters*> tlsSyscallCounters;
 
 void km::AddSystemCall(uint8_t function, CallHandler handler) {
     gSystemCalls[function] = handler;
 }
 
+const km::SyscallStats *km::GetSyscallStats() {
+    if constexpr (KM_SYSCALL_STATS) {
+        return &gSyscallStats;
+    } else {
+        return nullptr;
+    }
+}
+
+static void RecordSystemCall(uint8_t function, OsStatus status, uint64_t start) {
+    //
+    // The thread may have been preempted or moved to another cpu during the
+    // call, interrupts are disabled so the counters of the cpu it finished on
+    // are updated without another thread on that cpu interleaving.
+    //
+    km::IntGuard guard;
+    uint64_t ticks = __builtin_ia32_rdtsc() - start;
+
+    if (km::SyscallCounters *counters = tlsSyscallCounters.get()) {
+        counters->record(function, status, ticks);
+    }
+}
+
+static void InitSyscallCounters() {
+    km::SyscallCounters *counters = new (std::nothrow) km::SyscallCounters();
+    if (counters == nullptr) {
+        UserLog.warnf("Failed to allocate system call counters");
+        return;
+    }
+
+    if (OsStatus status = gSyscallStats.addCpu(counters)) {
+        UserLog.warnf("Failed to publish system call counters: ", OsStatusId(status));
+        delete counters;
+        return;
+    }
+
+    tlsSyscallCounters = counters;
+}
+
 extern "C" void KmSystemEntry(void);
 
 extern "C" OsCallResult KmSystemDispatchRoutine(km::SystemCallRegisterSet *regs) {
     uint8_t function = regs->function;
     if (km::CallHandler handler = gSystemCalls[function]) {
         km::CallContext context{};
-        return handler(&context, regs);
+
+        if constexpr (KM_SYSCALL_STATS) {
+            uint64_t start = __builtin_ia32_rdtsc();
+            OsCallResult result = handler(&context, regs);
+            RecordSystemCall(function, result.Status, start);
+            return result;
+        } else {
+            return handler(&context, regs);
+        }
     }
 
     UserLog.warnf("Unknown function ", km::Hex(regs->function));
@@ -54,6 +108,10 @@ void km::SetupUserMode(SystemMemory *memory) {
     IA32_LSTAR = (uintptr_t)KmSystemEntry;
 
     IA32_STAR = star;
+
+    if constexpr (KM_SYSCALL_STATS) {
+        InitSyscallCounters();
+    }
 }
 
 void km::EnterUserMode(km::IsrContext state) {
@@ -1,5 +1,6 @@
 #include "system/pmm.hpp"
 
+#include "memory/memory.hpp"
 #include "memory/page_allocator.hpp"
 #include "memory/page_allocator_command_list.hpp"
 
@@ -599,7 +600,19 @@ OsStatus sys::MemoryManager::release(km::MemoryRange range) [[clang::allocating]
 OsStatus sys::MemoryManager::allocate(size_t size, size_t align, km::MemoryRange *range [[outparam]]) [[clang::allocating]] {
     stdx::LockGuard guard(mLock);
 
-    km::PmmAllocation allocation = mHeap->aligned_alloc(align, size);
+    //
+    // Prefer placing large allocations on a 2m boundary so they can be mapped with large pages,
+    // when physical memory is too fragmented for that fall back to the requested alignment.
+    //
+    km::PmmAllocation allocation;
+    if (size_t large = km::detail::GetLargePageAlignment(size, align); large != align) {
+        allocation = mHeap->aligned_alloc(large, size);
+    }
+
+    if (allocation.isNull()) {
+        allocation = mHeap->aligned_alloc(align, size);
+    }
+
     if (allocation.isNull()) {
         return OsStatusOutOfMemory;
     }
@@ -212,6 +212,11 @@ OsStatus sys::Process::createProcess(System *system, ProcessCreateInfo info, Pro
         return status;
     }
 
+    if (OsStatus status = system->mapClockPage(addressSpace)) {
+        system->releaseMapping(pteMemory);
+        return status;
+    }
+
     if (auto process = sm::rcuMakeShared<sys::Process>(&system->rcuDomain(), info.name, info.state, loanWeak(), system->nextProcessId(), std::move(addressSpace))) {
         ProcessHandle *result = new (std::nothrow) ProcessHandle(process, newHandleId(eOsHandleProcess), ProcessAccess::eAll);
         if (!result) {
@@ -326,9 +331,75 @@ OsStatus sys::Process::vmemCreate(System *system, VmemCreateInfo info, km::Addre
     return OsStatusSuccess;
 }
 
+/// @brief Map a read only view of a file that is already resident in memory.
+///
+/// @retval OsStatusNotSupported The file can not be mapped directly and must be copied.
+static OsStatus MapResidentFile(sys::System *system, sys::AddressSpaceManager& addressSpace, sys::VmemMapInfo info, vfs::IFileHandle *fileHandle, km::VirtualRange *result) {
+    if (bool(info.flags & km::PageFlags::eWrite)) {
+        return OsStatusNotSupported;
+    }
+
+    sm::PhysicalAddress address;
+    if (OsStatus status = fileHandle->physical(info.srcAddress.address, info.size, &address)) {
+        return status;
+    }
+
+    //
+    // The file data must start on a page boundary to be mapped in place. Files
+    // smaller than a page are cheaper to copy.
+    //
+    if (address.address % x64::kPageSize != 0 || info.size < x64::kPageSize) {
+        return OsStatusNotSupported;
+    }
+
+    size_t whole = sm::rounddown(info.size, x64::kPageSize);
+    size_t partial = info.size - whole;
+    km::MemoryRange memory = km::MemoryRange::of(address.address, whole);
+
+    if (partial == 0) {
+        km::AddressMapping mapping;
+
+        if (info.baseAddress.isNull()) {
+            if (OsStatus status = addressSpace.mapExternal(memory, info.flags, km::MemoryType::eWriteBack, &mapping)) {
+                return status;
+            }
+        } else {
+            if (OsStatus status = addressSpace.mapExternal(&system->mMemoryManager, info.baseAddress, memory, info.flags, km::MemoryType::eWriteBack, &mapping)) {
+                return status;
+            }
+        }
+
+        *result = mapping.virtualRange();
+        return OsStatusSuccess;
+    }
+
+    //
+    // The rest of the last page is whatever follows the file in the media,
+    // which must not be visible to the process. The last page is copied into
+    // a zeroed page of its own and only the whole pages are mapped in place.
+    //
+    km::MemoryRange tail;
+    if (OsStatus status = sys::MapFileToMemory(fileHandle, &system->mMemoryManager, system->mSystemTables, info.srcAddress.address + whole, partial, &tail)) {
+        return status;
+    }
+
+    if (OsStatus status = addressSpace.mapExternal(&system->mMemoryManager, info.baseAddress, memory, tail, info.flags, km::MemoryType::eWriteBack, result)) {
+        OsStatus inner = system->mMemoryManager.release(tail);
+        KM_ASSERT(inner == OsStatusSuccess);
+        return status;
+    }
+
+    return OsStatusSuccess;
+}
+
 OsStatus sys::Process::vmemMapFile(System *system, VmemMapInfo info, vfs::IFileHandle *fileHandle, km::VirtualRange *result) {
     km::MemoryRange memory;
 
+    OsStatus resident = MapResidentFile(system, mAddressSpace, info, fileHandle, result);
+    if (resident != OsStatusNotSupported) {
+        return resident;
+    }
+
     if (OsStatus status = MapFileToMemory(fileHandle, &system->mMemoryManager, system->mSystemTables, info.srcAddress.address, info.size, &memory)) {
         return status;
     }
@@ -369,6 +440,10 @@ OsStatus sys::Process::vmemRelease(System *, km::VirtualRange) {
     return OsStatusNotSupported;
 }
 
+OsStatus sys::Process::vmemProtect(System *, km::VirtualRange range, km::PageFlags flags) {
+    return mAddressSpace.protect(range, flags);
+}
+
 static OsStatus CreateProcessInner(sys::System *system, sys::ObjectName name, OsProcessStateFlags state, sm::RcuSharedPtr<sys::Process> parent, std::span<std::byte> args, OsHandle id, sys::ProcessHandle **handle) {
     sm::RcuSharedPtr<sys::Process> process;
     sys::ProcessHandle *result = nullptr;
@@ -384,6 +459,11 @@ static OsStatus CreateProcessInner(sys::System *system, sys::ObjectName name, Os
         return status;
     }
 
+    if (OsStatus status = system->mapClockPage(mm)) {
+        system->releaseMapping(pteMemory);
+        return status;
+    }
+
     // Create the process.
     process = sm::rcuMakeShared<sys::Process>(&system->rcuDomain(), name, state, parent, system->nextProcessId(), std::move(mm));
     if (!process) {
@@ -637,6 +717,24 @@ OsStatus sys::SysVmemRelease(InvokeContext *, OsAnyPointer, OsSize) {
     return OsStatusNotSupported;
 }
 
+OsStatus sys::SysVmemProtect(InvokeContext *context, OsAnyPointer base, OsSize size, OsMemoryAccess access) {
+    sm::VirtualAddress address = base;
+    if (size == 0 || size % x64::kPageSize != 0 || !address.isAlignedTo(x64::kPageSize)) {
+        return OsStatusInvalidInput;
+    }
+
+    if (access & ~OsMemoryAccess(eOsMemoryRead | eOsMemoryWrite | eOsMemoryExecute)) {
+        return OsStatusInvalidInput;
+    }
+
+    km::PageFlags flags = km::PageFlags::eUser;
+    if (access & eOsMemoryRead) flags |= km::PageFlags::eRead;
+    if (access & eOsMemoryWrite) flags |= km::PageFlags::eWrite;
+    if (access & eOsMemoryExecute) flags |= km::PageFlags::eExecute;
+
+    return context->process->vmemProtect(context->system, km::VirtualRange::of(base, size), flags);
+}
+
 OsStatus sys::SysVmemMap(InvokeContext *context, OsVmemMapInfo info, void **outVmem) {
     VmemMapInfo vmemInfo;
     if (OsStatus status = sys::sanitize(context, &info, &vmemInfo)) {
@@ -704,6 +802,12 @@ OsStatus sys::MapFileToMemory(vfs::IFileHandle *file, MemoryManager *mm, km::Add
         KM_ASSERT(read.read == size);
     }
 
+    //
+    // The memory is mapped into a process a page at a time, so the rest of
+    // the last page must not leak whatever it held before.
+    //
+    memset((char*)privateMapping.vaddr + size, 0, result.size() - size);
+
     *range = result;
     return OsStatusSuccess;
 }
@@ -2,11 +2,17 @@
 #include "gdt.h"
 #include "thread.hpp"
 
+#include "debug/debug.hpp"
+
 #include "isr/isr.hpp"
 
 #include "system/schedule.hpp"
 #include "system/thread.hpp"
 
+#include "memory/numa.hpp"
+
+#include "profile/profiler.hpp"
+
 #include "task/scheduler.hpp"
 #include "task/scheduler_queue.hpp"
 #include "task/runtime.hpp"
@@ -23,7 +29,7 @@ static constinit km::CpuLocal<void*> tlsKernelStack;
 CPU_LOCAL
 static constinit km::CpuLocal<task::SchedulerQueue*> tlsQueue;
 
-void sys::setupGlobalScheduler(bool enableSmp, acpi::AcpiTables& rsdt, task::Scheduler *scheduler) {
+void sys::setupGlobalScheduler(bool enableSmp, acpi::AcpiTables& rsdt, const km::NumaTopology& topology, task::Scheduler *scheduler) {
     gScheduler = scheduler;
     task::Scheduler::create(gScheduler);
     size_t cpuCount = enableSmp ? rsdt.madt()->lapicCount() : 1;
@@ -47,7 +53,13 @@ void sys::setupGlobalScheduler(bool enableSmp, acpi::AcpiTables& rsdt, task::Sch
             task::SchedulerQueue& queue = queues[localApic.apicId];
             task::SchedulerQueue::create(64, &queue);
 
-            gScheduler->addQueue(km::CpuCoreId(localApic.apicId), &queue);
+            km::CpuCoreId coreId = km::CpuCoreId(localApic.apicId);
+            km::NumaNodeId node = topology.nodeOfCpu(coreId);
+            if (node == km::NumaNodeId::eInvalid) {
+                node = km::NumaNodeId(0);
+            }
+
+            gScheduler->addQueue(coreId, &queue, node);
         }
 
         tlsQueue = gScheduler->getQueue(km::GetCurrentCoreId());
@@ -62,6 +74,24 @@ task::Scheduler *sys::getScheduler() {
     return gScheduler;
 }
 
+/// @brief Switch to the next task on this cpu and report the switch on the debug stream.
+static bool SwitchCurrentTask(task::SchedulerQueue *queue, km::IsrContext *context, task::ScheduleReason reason) noexcept [[clang::reentrant]] {
+    task::SchedulerEntry *previous = queue->getCurrentTask();
+    bool switched = task::switchCurrentContext(gScheduler, queue, context, reason);
+    task::SchedulerEntry *next = queue->getCurrentTask();
+
+    // a null next task is the cpu going idle
+    if (previous != next) {
+        km::debug::TrySendEvent(km::debug::ScheduleTask {
+            .previous = reinterpret_cast<uintptr_t>(previous),
+            .next = reinterpret_cast<uintptr_t>(next),
+            .cpu = std::to_underlying(km::GetCurrentCoreId()),
+        });
+    }
+
+    return switched;
+}
+
 task::SchedulerQueue *sys::getTlsQueue() {
     return tlsQueue.get();
 }
@@ -72,8 +102,11 @@ void sys::installSchedulerIsr() {
     sharedIst->install(km::isr::kTimerVector, [](km::IsrContext *isrContext) noexcept [[clang::reentrant]] -> km::IsrContext {
         km::IApic *apic = km::GetCpuLocalApic();
 
+        // sampled before switching so the sample is of the interrupted task
+        km::ProfilerTimerTick(isrContext);
+
         task::SchedulerQueue *queue = tlsQueue.get();
-        if (task::switchCurrentContext(gScheduler, queue, isrContext)) {
+        if (SwitchCurrentTask(queue, isrContext, task::ScheduleReason::ePreempt)) {
             task::SchedulerEntry *entry = queue->getCurrentTask();
             sys::Thread *thread = static_cast<sys::Thread*>(entry);
             km::StackMapping kernelStack = thread->getKernelStack();
@@ -137,7 +170,7 @@ void sys::YieldCurrentThread() {
 
     task::SchedulerQueue *queue = tlsQueue.get();
 
-    if (task::switchCurrentContext(gScheduler, queue, &context)) {
+    if (SwitchCurrentTask(queue, &context, task::ScheduleReason::eYield)) {
         task::SchedulerEntry *entry = queue->getCurrentTask();
         sys::Thread *thread = static_cast<sys::Thread*>(entry);
         km::StackMapping kernelStack = thread->getKernelStack();
@@ -129,6 +129,38 @@ sys::SystemStats sys::System::stats() {
     return stats;
 }
 
+OsStatus sys::System::mapClockPage(AddressSpaceManager& addressSpace) {
+    km::AddressMapping mapping;
+    sm::VirtualAddress address = OS_CLOCK_PAGE_ADDRESS;
+    return addressSpace.mapExternal(&mMemoryManager, address, mClockPage.physicalRange(), km::PageFlags::eRead | km::PageFlags::eUser, km::MemoryType::eWriteBack, &mapping);
+}
+
+void sys::System::publishClockPage(const OsClockPage& page) {
+    stdx::SharedLock guard(mLock);
+    KM_ASSERT(mProcessObjects.empty());
+
+    *(OsClockPage*)mClockPage.vaddr = page;
+}
+
+static OsStatus CreateClockPage(km::AddressSpace *addressSpace, km::PageAllocator *pageAllocator, km::AddressMapping *mapping) {
+    km::PmmAllocation allocation = pageAllocator->pageAlloc(1);
+    if (allocation.isNull()) {
+        return OsStatusOutOfMemory;
+    }
+
+    if (OsStatus status = addressSpace->map(allocation.range(), km::PageFlags::eData, km::MemoryType::eWriteBack, mapping)) {
+        pageAllocator->free(allocation);
+        return status;
+    }
+
+    //
+    // Until the clock is published the page has no flags set, so reading the
+    // clock falls back to a system call.
+    //
+    memset((void*)mapping->vaddr, 0, mapping->size);
+    return OsStatusSuccess;
+}
+
 OsStatus sys::System::create(vfs::VfsRoot *vfsRoot, km::AddressSpace *addressSpace, km::PageAllocator *pageAllocator, System *system [[clang::noescape, gnu::nonnull]]) {
     system->mPageAllocator = pageAllocator;
     system->mSystemTables = addressSpace;
@@ -137,6 +169,10 @@ OsStatus sys::System::create(vfs::VfsRoot *vfsRoot, km::AddressSpace *addressSpa
         return status;
     }
 
+    if (OsStatus status = CreateClockPage(addressSpace, pageAllocator, &system->mClockPage)) {
+        return status;
+    }
+
     return OsStatusSuccess;
 }
 
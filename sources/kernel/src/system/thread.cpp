@@ -54,6 +54,7 @@ OsStatus sys::Thread::stat(ThreadStat *info) {
         .name = getNameUnlocked(),
         .process = process,
         .state = mThreadState,
+        .scheduler = getStats(),
     };
 
     return OsStatusSuccess;
@@ -160,7 +161,10 @@ OsStatus sys::Thread::attach(task::Scheduler *scheduler) {
     state.registers.cs = isSupervisor() ? (GDT_64BIT_CODE * 0x8) : ((GDT_64BIT_USER_CODE * 0x8) | 0b11);
     state.registers.ss = isSupervisor() ? (GDT_64BIT_DATA * 0x8) : ((GDT_64BIT_USER_DATA * 0x8) | 0b11);
 
-    return scheduler->enqueue(state, this);
+    //
+    // The threads stacks were allocated from the current node, so prefer to run it there.
+    //
+    return scheduler->enqueue(state, this, km::GetCurrentNumaNode());
 }
 
 OsStatus sys::Thread::destroy(System *, OsThreadState reason) {
@@ -317,6 +321,12 @@ OsStatus sys::SysThreadStat(InvokeContext *context, OsThreadHandle handle, OsThr
     OsThreadInfo stat {
         .State = info.state,
         .Process = parent,
+        .Scheduler = {
+            .Switches = info.scheduler.switches,
+            .Preemptions = info.scheduler.preemptions,
+            .RunTicks = info.scheduler.runTicks,
+            .WaitTicks = info.scheduler.waitTicks,
+        },
     };
 
     size_t size = std::min(sizeof(stat.Name), info.name.count());
@@ -8,20 +8,35 @@
 using sys::AddressSpaceManager;
 using sys::detail::AddressSegment;
 
+/// @brief Select the virtual alignment for mapping a range of physical memory.
+///
+/// When the physical memory starts on a large page boundary and is large enough to
+/// contain a large page, aligning the virtual address the same way allows the page
+/// tables to map the range with 2m pages.
+static size_t GetVirtualAlignment(km::MemoryRange memory, size_t align) noexcept {
+    size_t large = km::detail::GetLargePageAlignment(memory.size(), align);
+    if (memory.front.address % large != 0) {
+        return align;
+    }
+
+    return large;
+}
+
 OsStatus AddressSpaceManager::map(MemoryManager *manager, size_t size, size_t align, km::PageFlags flags, km::MemoryType type, km::AddressMapping *mapping [[outparam]]) [[clang::allocating]] {
     stdx::LockGuard guard(mLock);
 
-    km::VmemAllocation allocation = mHeap.alignedAlloc(align, size);
-    if (allocation.isNull()) {
-        return OsStatusOutOfMemory;
-    }
-
     km::MemoryRange range;
     if (OsStatus status = manager->allocate(size, align, &range)) {
-        mHeap.free(allocation);
         return status;
     }
 
+    km::VmemAllocation allocation = mHeap.alignedAlloc(GetVirtualAlignment(range, align), size);
+    if (allocation.isNull()) {
+        OsStatus inner = manager->release(range);
+        KM_ASSERT(inner == OsStatusSuccess);
+        return OsStatusOutOfMemory;
+    }
+
     km::AddressMapping result {
         .vaddr = std::bit_cast<const void*>(allocation.address()),
         .paddr = range.front,
@@ -47,7 +62,7 @@ OsStatus AddressSpaceManager::map(MemoryManager *manager, size_t size, size_t al
 OsStatus AddressSpaceManager::map(MemoryManager *manager, km::MemoryRange range, km::PageFlags flags, km::MemoryType type, km::AddressMapping *mapping [[outparam]]) [[clang::allocating]] {
     stdx::LockGuard guard(mLock);
 
-    km::VmemAllocation allocation = mHeap.alignedAlloc(x64::kPageSize, range.size());
+    km::VmemAllocation allocation = mHeap.alignedAlloc(GetVirtualAlignment(range, x64::kPageSize), range.size());
     if (allocation.isNull()) {
         return OsStatusOutOfMemory;
     }
@@ -156,6 +171,21 @@ OsStatus AddressSpaceManager::map(MemoryManager *manager, AddressSpaceManager *o
         return OsStatusNotFound;
     }
 
+    //
+    // External memory is not owned by the memory manager, so it cannot be
+    // retained to share it with another address space. Any segment in the
+    // range may be external, not just the segments at either end.
+    //
+    for (auto it = begin;; ++it) {
+        if (!it->second.hasBackingMemory()) {
+            return OsStatusNotSupported;
+        }
+
+        if (it == end) {
+            break;
+        }
+    }
+
     km::VmemAllocation allocation = mHeap.alignedAlloc(alignof(x64::page), range.size());
     if (allocation.isNull()) {
         return OsStatusOutOfMemory;
@@ -273,8 +303,15 @@ OsStatus AddressSpaceManager::splitSegment(MemoryManager *manager, Iterator it,
         return status;
     }
 
-    km::MemoryRangeEx loRange = { memory.front, memory.front + frontOffset };
-    km::MemoryRangeEx hiRange = { memory.back - backOffset, memory.back };
+    //
+    // Segments without backing memory, such as external mappings, have
+    // nothing to divide between the two halves.
+    //
+    km::MemoryRangeEx loRange, hiRange;
+    if (segment.hasBackingMemory()) {
+        loRange = { memory.front, memory.front + frontOffset };
+        hiRange = { memory.back - backOffset, memory.back };
+    }
 
     auto loSegment = AddressSegment { loRange, lo };
     auto hiSegment = AddressSegment { hiRange, hi };
@@ -321,8 +358,10 @@ OsStatus AddressSpaceManager::unmapSegment(MemoryManager *manager, Iterator it,
         //
         //    |-----seg-----|
         // |--------range-----|
-        status = manager->release(srcMemory.cast<km::PhysicalAddress>());
-        KM_ASSERT(status == OsStatusSuccess);
+        if (segment.hasBackingMemory()) {
+            status = manager->release(srcMemory.cast<km::PhysicalAddress>());
+            KM_ASSERT(status == OsStatusSuccess);
+        }
 
         status = mPageTables.unmap(seg);
         KM_ASSERT(status == OsStatusSuccess);
@@ -358,19 +397,23 @@ OsStatus AddressSpaceManager::splitAtAddress(MemoryManager *manager, sm::Virtual
     KM_PANIC("Not implemented");
 }
 
-OsStatus AddressSpaceManager::map(MemoryManager *manager, sm::VirtualAddress address, km::MemoryRange memory, km::PageFlags flags, km::MemoryType type, km::AddressMapping *mapping [[outparam]]) [[clang::allocating]] {
-    // TODO: on the error case memory is a bit busted
-    km::VirtualRange range = { address, address + memory.size() };
-    if (OsStatus status = unmap(manager, range)) {
+OsStatus AddressSpaceManager::reserveUnlocked(MemoryManager *manager, km::VirtualRange range, km::VmemAllocation *allocation [[outparam]]) [[clang::allocating]] {
+    if (OsStatus status = unmapUnlocked(manager, range)) {
         if (status != OsStatusNotFound) {
             return status;
         }
     }
 
+    return mHeap.reserve(range.cast<sm::VirtualAddress>(), allocation);
+}
+
+OsStatus AddressSpaceManager::map(MemoryManager *manager, sm::VirtualAddress address, km::MemoryRange memory, km::PageFlags flags, km::MemoryType type, km::AddressMapping *mapping [[outparam]]) [[clang::allocating]] {
+    // TODO: on the error case memory is a bit busted
+    km::VirtualRange range = { address, address + memory.size() };
     km::VmemAllocation allocation;
 
     stdx::LockGuard guard(mLock);
-    if (OsStatus status = mHeap.reserve(range.cast<sm::VirtualAddress>(), &allocation)) {
+    if (OsStatus status = reserveUnlocked(manager, range, &allocation)) {
         return status;
     }
 
@@ -381,7 +424,7 @@ OsStatus AddressSpaceManager::map(MemoryManager *manager, sm::VirtualAddress add
     };
 
     if (OsStatus status = mPageTables.map(result, flags, type)) {
-        KM_ASSERT(status == OsStatusSuccess);
+        mHeap.free(allocation);
         return status;
     }
 
@@ -396,6 +439,9 @@ OsStatus AddressSpaceManager::mapExternal(km::MemoryRange memory, km::PageFlags
     stdx::LockGuard guard(mLock);
 
     km::VmemAllocation allocation = mHeap.alignedAlloc(alignof(x64::page), memory.size());
+    if (allocation.isNull()) {
+        return OsStatusOutOfMemory;
+    }
 
     km::AddressMapping result {
         .vaddr = std::bit_cast<const void*>(allocation.address()),
@@ -404,7 +450,7 @@ OsStatus AddressSpaceManager::mapExternal(km::MemoryRange memory, km::PageFlags
     };
 
     if (OsStatus status = mPageTables.map(result, flags, type)) {
-        KM_ASSERT(status == OsStatusSuccess);
+        mHeap.free(allocation);
         return status;
     }
 
@@ -415,6 +461,89 @@ OsStatus AddressSpaceManager::mapExternal(km::MemoryRange memory, km::PageFlags
     return OsStatusSuccess;
 }
 
+OsStatus AddressSpaceManager::mapExternal(MemoryManager *manager, sm::VirtualAddress address, km::MemoryRange memory, km::PageFlags flags, km::MemoryType type, km::AddressMapping *mapping [[outparam]]) [[clang::allocating]] {
+    km::VirtualRange range = { address, address + memory.size() };
+    km::VmemAllocation allocation;
+
+    stdx::LockGuard guard(mLock);
+    if (OsStatus status = reserveUnlocked(manager, range, &allocation)) {
+        return status;
+    }
+
+    km::AddressMapping result {
+        .vaddr = address,
+        .paddr = memory.front,
+        .size = memory.size(),
+    };
+
+    if (OsStatus status = mPageTables.map(result, flags, type)) {
+        mHeap.free(allocation);
+        return status;
+    }
+
+    auto segment = AddressSegment { km::MemoryRangeEx{}, allocation };
+    addSegment(std::move(segment));
+
+    *mapping = result;
+    return OsStatusSuccess;
+}
+
+OsStatus AddressSpaceManager::mapExternal(MemoryManager *manager, sm::VirtualAddress address, km::MemoryRange memory, km::MemoryRange tail, km::PageFlags flags, km::MemoryType type, km::VirtualRange *result [[outparam]]) [[clang::allocating]] {
+    KM_ASSERT(!memory.isEmpty() && !tail.isEmpty());
+
+    size_t size = memory.size() + tail.size();
+    km::VmemAllocation allocation;
+
+    stdx::LockGuard guard(mLock);
+    if (address.isNull()) {
+        allocation = mHeap.alignedAlloc(alignof(x64::page), size);
+        if (allocation.isNull()) {
+            return OsStatusOutOfMemory;
+        }
+    } else if (OsStatus status = reserveUnlocked(manager, { address, address + size }, &allocation)) {
+        return status;
+    }
+
+    km::VmemAllocation head, rest;
+    if (OsStatus status = mHeap.split(allocation, allocation.range().front + memory.size(), &head, &rest)) {
+        mHeap.free(allocation);
+        return status;
+    }
+
+    km::AddressMapping headMapping {
+        .vaddr = std::bit_cast<const void*>(head.address()),
+        .paddr = memory.front,
+        .size = memory.size(),
+    };
+
+    km::AddressMapping tailMapping {
+        .vaddr = std::bit_cast<const void*>(rest.address()),
+        .paddr = tail.front,
+        .size = tail.size(),
+    };
+
+    if (OsStatus status = mPageTables.map(headMapping, flags, type)) {
+        mHeap.free(head);
+        mHeap.free(rest);
+        return status;
+    }
+
+    if (OsStatus status = mPageTables.map(tailMapping, flags, type)) {
+        OsStatus inner = mPageTables.unmap(headMapping.virtualRange());
+        KM_ASSERT(inner == OsStatusSuccess);
+
+        mHeap.free(head);
+        mHeap.free(rest);
+        return status;
+    }
+
+    addSegment(AddressSegment { km::MemoryRangeEx{}, head });
+    addSegment(AddressSegment { tail.cast<km::PhysicalAddressEx>(), rest });
+
+    *result = { headMapping.vaddr, tailMapping.virtualRange().back };
+    return OsStatusSuccess;
+}
+
 OsStatus AddressSpaceManager::allocateVirtual(km::MemoryRange memory, sm::VirtualAddress address, size_t size, size_t align, bool addressIsHint, km::PageFlags flags, km::AddressMapping *result [[outparam]]) [[clang::allocating]] {
     stdx::LockGuard guard(mLock);
 
@@ -433,7 +562,7 @@ OsStatus AddressSpaceManager::allocateVirtual(km::MemoryRange memory, sm::Virtua
             return status;
         }
     } else {
-        allocation = mHeap.alignedAlloc(align, size);
+        allocation = mHeap.alignedAlloc(GetVirtualAlignment(memory, align), size);
         if (allocation.isNull()) {
             return OsStatusOutOfMemory;
         }
@@ -457,6 +586,35 @@ OsStatus AddressSpaceManager::allocateVirtual(km::MemoryRange memory, sm::Virtua
     return OsStatusSuccess;
 }
 
+OsStatus AddressSpaceManager::protect(km::VirtualRange range, km::PageFlags flags) [[clang::allocating]] {
+    if (range.isEmpty()) {
+        return OsStatusInvalidInput;
+    }
+
+    stdx::LockGuard guard(mLock);
+
+    //
+    // Every page in the range must belong to a segment of this address space,
+    // otherwise the flags of memory that this address space does not own would change.
+    //
+    auto& segments = mTable.segments();
+    for (const void *cursor = range.front; cursor < range.back;) {
+        auto it = segments.upper_bound(cursor);
+        if (it == segments.end()) {
+            return OsStatusNotFound;
+        }
+
+        km::VirtualRange seg = it->second.range();
+        if (seg.front > cursor) {
+            return OsStatusNotFound;
+        }
+
+        cursor = seg.back;
+    }
+
+    return mPageTables.protect(range, flags);
+}
+
 OsStatus AddressSpaceManager::map(const AddressSpaceMappingRequest& request, km::AddressMapping *result [[outparam]]) {
     KM_PANIC("Not implemented");
 }
@@ -502,9 +660,12 @@ void AddressSpaceManager::eraseMany(MemoryManager *manager, km::VirtualRange ran
 }
 
 OsStatus AddressSpaceManager::unmap(MemoryManager *manager, km::VirtualRange range) [[clang::allocating]] {
-    KM_ASSERT(range.isValid());
-
     stdx::LockGuard guard(mLock);
+    return unmapUnlocked(manager, range);
+}
+
+OsStatus AddressSpaceManager::unmapUnlocked(MemoryManager *manager, km::VirtualRange range) [[clang::allocating]] {
+    KM_ASSERT(range.isValid());
 
     MemLog.infof("Unmapping range: ", range);
 
@@ -537,8 +698,7 @@ OsStatus AddressSpaceManager::unmap(MemoryManager *manager, km::VirtualRange ran
 
     if (begin == end) {
         auto& segment = begin->second;
-        auto mapping = segment.mapping();
-        auto seg = mapping.virtualRange();
+        auto seg = segment.range();
         if (seg == range || range.contains(seg)) {
             // |--------seg-------|
             // |--------range-----|
@@ -560,8 +720,6 @@ OsStatus AddressSpaceManager::unmap(MemoryManager *manager, km::VirtualRange ran
             auto [lhs, rhs] = km::split(seg, range);
             KM_ASSERT(!lhs.isEmpty() && !rhs.isEmpty());
 
-            km::AddressMapping subrange = mapping.subrange(range);
-
             std::array<km::VmemAllocation, 3> allocations;
             std::array<sm::VirtualAddress, 2> points = {
                 (uintptr_t)range.front,
@@ -572,15 +730,25 @@ OsStatus AddressSpaceManager::unmap(MemoryManager *manager, km::VirtualRange ran
                 return status;
             }
 
-            status = manager->release(subrange.physicalRange());
-            KM_ASSERT(status == OsStatusSuccess);
+            //
+            // External mappings have no backing memory to release or divide.
+            //
+            km::MemoryRangeEx loBacking, hiBacking;
+            if (segment.hasBackingMemory()) {
+                km::AddressMapping subrange = segment.mapping().subrange(range);
+                status = manager->release(subrange.physicalRange());
+                KM_ASSERT(status == OsStatusSuccess);
 
-            status = mPageTables.unmap(subrange.virtualRange());
+                auto backing = segment.getBackingMemory();
+                loBacking = backing.first(lhs.size());
+                hiBacking = backing.last(rhs.size());
+            }
+
+            status = mPageTables.unmap(range);
             KM_ASSERT(status == OsStatusSuccess);
 
-            auto backing = segment.getBackingMemory();
-            AddressSegment loSegment { backing.first(lhs.size()), allocations[0] };
-            AddressSegment hiSegment { backing.last(rhs.size()), allocations[2] };
+            AddressSegment loSegment { loBacking, allocations[0] };
+            AddressSegment hiSegment { hiBacking, allocations[2] };
 
             mHeap.free(allocations[1]);
 
@@ -605,10 +773,8 @@ OsStatus AddressSpaceManager::unmap(MemoryManager *manager, km::VirtualRange ran
     } else if (end != segments().end()) {
         const auto& lhs = begin->second;
         const auto& rhs = end->second;
-        auto lhsMapping = lhs.mapping();
-        auto rhsMapping = rhs.mapping();
-        auto lhsVirtualRange = lhsMapping.virtualRange();
-        auto rhsVirtualRange = rhsMapping.virtualRange();
+        auto lhsVirtualRange = lhs.range();
+        auto rhsVirtualRange = rhs.range();
         if (lhsVirtualRange.front == range.front && rhsVirtualRange.back == range.back) {
             // |----lhs----|   |----rhs----|
             // |-----------range-----------|
@@ -661,10 +827,10 @@ OsStatus AddressSpaceManager::unmap(MemoryManager *manager, km::VirtualRange ran
         } else if (lhsVirtualRange.contains(range.front)) {
             // |--------seg-------|
             //     |--------range-----|
-            MemLog.fatalf("Invalid range state: ", range, ", ", lhsMapping, ", ", rhsMapping);
+            MemLog.fatalf("Invalid range state: ", range, ", ", lhsVirtualRange, ", ", rhsVirtualRange);
             KM_ASSERT(false);
         } else {
-            MemLog.fatalf("Invalid state: ", range, ", ", lhsMapping, ", ", rhsMapping);
+            MemLog.fatalf("Invalid state: ", range, ", ", lhsVirtualRange, ", ", rhsVirtualRange);
             KM_ASSERT(false);
         }
     }
@@ -10,7 +10,7 @@
 
 extern "C" void __x86_64_idle() noexcept;
 
-bool task::switchCurrentContext(Scheduler *scheduler, task::SchedulerQueue *queue, km::IsrContext *isrContext) noexcept {
+bool task::switchCurrentContext(Scheduler *scheduler, task::SchedulerQueue *queue, km::IsrContext *isrContext, ScheduleReason reason) noexcept {
     x64::XSave *xsave = nullptr;
     if (task::SchedulerEntry *current = queue->getCurrentTask()) {
         task::TaskState& currentState = current->getState();
@@ -45,7 +45,7 @@ bool task::switchCurrentContext(Scheduler *scheduler, task::SchedulerQueue *queu
         .tlsBase = IA32_FS_BASE.load(),
     };
 
-    if (scheduler->reschedule(queue, &state) == task::ScheduleResult::eIdle) {
+    if (scheduler->reschedule(queue, &state, reason) == task::ScheduleResult::eIdle) {
         isrContext->rip = reinterpret_cast<uintptr_t>(__x86_64_idle);
         return false;
     }
@@ -2,7 +2,11 @@
 #include "task/mutex.hpp"
 
 OsStatus task::Scheduler::addQueue(km::CpuCoreId coreId, SchedulerQueue *queue) noexcept {
-    if (OsStatus status = mQueues.insert(coreId, QueueInfo{queue})) {
+    return addQueue(coreId, queue, km::NumaNodeId(0));
+}
+
+OsStatus task::Scheduler::addQueue(km::CpuCoreId coreId, SchedulerQueue *queue, km::NumaNodeId node) noexcept {
+    if (OsStatus status = mQueues.insert(coreId, QueueInfo{queue, node})) {
         return status;
     }
     mAvailableTaskCount.add(queue->getCapacity(), std::memory_order_relaxed);
@@ -10,6 +14,10 @@ OsStatus task::Scheduler::addQueue(km::CpuCoreId coreId, SchedulerQueue *queue)
 }
 
 OsStatus task::Scheduler::enqueue(const TaskState &state, SchedulerEntry *entry) noexcept {
+    return enqueue(state, entry, km::NumaNodeId::eInvalid);
+}
+
+OsStatus task::Scheduler::enqueue(const TaskState &state, SchedulerEntry *entry, km::NumaNodeId node) noexcept {
     if (!mAvailableTaskCount.consume()) {
         return OsStatusOutOfMemory;
     }
@@ -17,7 +25,24 @@ OsStatus task::Scheduler::enqueue(const TaskState &state, SchedulerEntry *entry)
     uint64_t taskId = mNextTaskId.fetch_add(1, std::memory_order_relaxed);
     entry->mId = taskId;
 
+    if (node != km::NumaNodeId::eInvalid) {
+        for (auto taskQueue : mQueues) {
+            if (taskQueue.second.node != node) {
+                continue;
+            }
+
+            SchedulerQueue *queue = taskQueue.second.queue;
+            if (queue->enqueue(state, entry) == OsStatusSuccess) {
+                return OsStatusSuccess;
+            }
+        }
+    }
+
     for (auto taskQueue : mQueues) {
+        if (taskQueue.second.node == node) {
+            continue;
+        }
+
         SchedulerQueue *queue = taskQueue.second.queue;
         if (queue->enqueue(state, entry) == OsStatusSuccess) {
             return OsStatusSuccess;
@@ -34,18 +59,18 @@ task::SchedulerQueue *task::Scheduler::getQueue(km::CpuCoreId coreId) noexcept {
     return (*it).second.queue;
 }
 
-task::ScheduleResult task::Scheduler::reschedule(km::CpuCoreId coreId, TaskState *state) noexcept {
+task::ScheduleResult task::Scheduler::reschedule(km::CpuCoreId coreId, TaskState *state, ScheduleReason reason) noexcept {
     auto it = mQueues.find(coreId);
     KM_ASSERT(it != mQueues.end());
 
     SchedulerQueue *queue = (*it).second.queue;
 
-    return reschedule(queue, state);
+    return reschedule(queue, state, reason);
 }
 
-task::ScheduleResult task::Scheduler::reschedule(SchedulerQueue *queue, TaskState *state) noexcept {
+task::ScheduleResult task::Scheduler::reschedule(SchedulerQueue *queue, TaskState *state, ScheduleReason reason) noexcept {
     // Eventually there will be logic for thread migration here, but for now just forward to the queue.
-    return queue->reschedule(state);
+    return queue->reschedule(state, reason);
 }
 
 OsStatus task::Scheduler::sleep(SchedulerEntry *entry, km::os_instant timeout) noexcept {
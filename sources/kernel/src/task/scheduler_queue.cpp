@@ -175,6 +175,7 @@ size_t task::SchedulerQueue::wakeSleepingTasks(km::os_instant now) noexcept {
             woken += 1;
             // The task was woken up, remove it from the list.
             it = mSleepingTasks.erase(it);
+            task->mCounters.queued(SchedulerTimestamp());
 
             // This must never fail, if it does then this queue has been overfilled.
             KM_ASSERT(mQueue.tryPush(task));
@@ -190,7 +191,12 @@ size_t task::SchedulerQueue::wakeSleepingTasks(km::os_instant now) noexcept {
     return woken;
 }
 
-void task::SchedulerQueue::setCurrentTask(SchedulerEntry *task) noexcept {
+void task::SchedulerQueue::switchOutCurrentTask(uint64_t now, bool preempted) noexcept {
+    uint64_t run = mCurrentTask->mCounters.switchOut(now, preempted);
+    mCounters.switchOut(run, preempted);
+}
+
+void task::SchedulerQueue::setCurrentTask(SchedulerEntry *task, uint64_t now, ScheduleReason reason) noexcept {
     KM_ASSERT(task != mCurrentTask);
     // Ideally here the task should be in the running state, this may not always be the case
     // though. If the user terminates a thread right now it will be in the terminated state.
@@ -202,7 +208,12 @@ void task::SchedulerQueue::setCurrentTask(SchedulerEntry *task) noexcept {
     if (mCurrentTask != nullptr) {
         bool addToQueue = moveTaskToIdle(mCurrentTask);
 
+        // the task is preempted if it could have kept running and did not yield
+        switchOutCurrentTask(now, addToQueue && reason == ScheduleReason::ePreempt);
+
         if (addToQueue) {
+            mCurrentTask->mCounters.queued(now);
+
             if (!mQueue.tryPush(mCurrentTask)) {
                 SchedulerEntry *rescueTask = mRescueTask.exchange(mCurrentTask);
                 KM_ASSERT(rescueTask == nullptr);
@@ -210,6 +221,9 @@ void task::SchedulerQueue::setCurrentTask(SchedulerEntry *task) noexcept {
         }
     }
 
+    uint64_t wait = task->mCounters.switchIn(now);
+    mCounters.switchIn(wait);
+
     mCurrentTask = task;
 }
 
@@ -229,9 +243,12 @@ bool task::SchedulerQueue::takeNextTask(SchedulerEntry **next) noexcept {
     return false;
 }
 
-task::ScheduleResult task::SchedulerQueue::reschedule(TaskState *state [[gnu::nonnull]]) noexcept {
+task::ScheduleResult task::SchedulerQueue::reschedule(TaskState *state [[gnu::nonnull]], ScheduleReason reason) noexcept {
     SchedulerEntry *newTask;
 
+    uint64_t now = SchedulerTimestamp();
+    mCounters.sample(mQueue.count());
+
     if (!takeNextTask(&newTask)) {
         //
         // This handles the case where there are no tasks in the queue.
@@ -239,12 +256,15 @@ task::ScheduleResult task::SchedulerQueue::reschedule(TaskState *state [[gnu::no
         // If there is a current task we need to check if it can continue running.
         //
         if (mCurrentTask == nullptr) {
+            mCounters.idle();
             return ScheduleResult::eIdle;
         }
 
         if (!keepTaskRunning(mCurrentTask)) {
             mCurrentTask->mState = *state;
+            switchOutCurrentTask(now, false);
             mCurrentTask = nullptr;
+            mCounters.idle();
             return ScheduleResult::eIdle;
         }
 
@@ -255,7 +275,7 @@ task::ScheduleResult task::SchedulerQueue::reschedule(TaskState *state [[gnu::no
         mCurrentTask->mState = *state;
     }
 
-    setCurrentTask(newTask);
+    setCurrentTask(newTask, now, reason);
 
     *state = newTask->mState;
     return ScheduleResult::eResume;
@@ -273,6 +293,7 @@ OsStatus task::SchedulerQueue::enqueue(const TaskState &state, SchedulerEntry *e
     }
 
     entry->mState = state;
+    entry->mCounters.queued(SchedulerTimestamp());
 
     if (!mQueue.tryPush(entry)) {
         return OsStatusOutOfMemory;
@@ -173,3 +173,248 @@ km::OpenSerialResult km::OpenSerial(ComPortInfo info) {
         return { .status = SerialPortStatus::eScratchTestFailed };
     }
 }
+
+void km::BufferedSerialPort::setInterruptEnable(uint8_t mask) noexcept [[clang::reentrant, clang::nonblocking]] {
+    KmWriteByteNoDelay(mPort.mBasePort + kInterruptEnable, mask);
+}
+
+void km::BufferedSerialPort::kick() noexcept [[clang::reentrant, clang::nonblocking]] {
+    // Enabling the transmit interrupt while the holding register is empty
+    // raises it immediately, so the interrupt handler does all the writes.
+    if (!mTxArmed.exchange(true)) {
+        setInterruptEnable(mIdleInterrupts | kEnableTransmit);
+    }
+}
+
+void km::BufferedSerialPort::transmit() noexcept [[clang::reentrant, clang::nonblocking]] {
+    // The transmit ring only supports a single consumer. If flush is
+    // draining it then it will re-arm the interrupt once it is done.
+    if (!mTxLock.try_lock()) {
+        return;
+    }
+
+    size_t count = 0;
+    uint8_t byte;
+    while (count < kFifoDepth && mTxQueue.tryPop(byte)) {
+        KmWriteByteNoDelay(mPort.mBasePort + kData, byte);
+        count += 1;
+    }
+
+    mTxLock.unlock();
+
+    mTxBytes.fetch_add(count, std::memory_order_relaxed);
+
+    if (count != 0) {
+        return;
+    }
+
+    // Nothing left to send, disable the interrupt before clearing the flag
+    // so a concurrent writer that sees the flag clear re-enables it after us.
+    setInterruptEnable(mIdleInterrupts);
+    mTxArmed.store(false);
+
+    // A writer may have pushed between the last pop and clearing the flag.
+    if (mTxQueue.count() != 0) {
+        kick();
+    }
+}
+
+void km::BufferedSerialPort::receive() noexcept [[clang::reentrant, clang::nonblocking]] {
+    size_t count = 0;
+    while (KmReadByte(mPort.mBasePort + kLineStatus) & kDataReady) {
+        uint8_t byte = KmReadByte(mPort.mBasePort + kData);
+        if (mRxQueue.tryPush(byte)) {
+            count += 1;
+        } else {
+            mRxDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    mRxBytes.fetch_add(count, std::memory_order_relaxed);
+
+    if (count != 0) {
+        mRxSignal.signal();
+    }
+}
+
+void km::BufferedSerialPort::handleInterrupt() noexcept [[clang::reentrant, clang::nonblocking]] {
+    mInterrupts.fetch_add(1, std::memory_order_relaxed);
+
+    // Bound the number of interrupts serviced at once so a misbehaving
+    // device cannot wedge the processor.
+    for (size_t i = 0; i < kFifoDepth; i++) {
+        uint8_t iir = KmReadByte(mPort.mBasePort + kFifoControl);
+        if (iir & kNoInterruptPending) {
+            break;
+        }
+
+        switch (iir & kInterruptIdMask) {
+        case kReceiveInterrupt:
+        case kReceiveTimeoutInterrupt:
+            if (mRxQueue.isSetup()) {
+                receive();
+            }
+            break;
+        case kTransmitEmptyInterrupt:
+            transmit();
+            break;
+        case kLineStatusInterrupt:
+            KmReadByte(mPort.mBasePort + kLineStatus);
+            break;
+        case kModemStatusInterrupt:
+            KmReadByte(mPort.mBasePort + KModemStatus);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+size_t km::BufferedSerialPort::write(std::span<const uint8_t> src) noexcept [[clang::reentrant, clang::nonblocking]] {
+    size_t i = 0;
+    for (; i < src.size_bytes(); i++) {
+        uint8_t byte = src[i];
+        if (!mTxQueue.tryPush(byte)) {
+            mTxDropped.fetch_add(src.size_bytes() - i, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    if (i != 0) {
+        kick();
+    }
+
+    return i;
+}
+
+size_t km::BufferedSerialPort::print(stdx::StringView src) noexcept [[clang::reentrant, clang::nonblocking]] {
+    auto push = [&](uint8_t byte) {
+        return mTxQueue.tryPush(byte);
+    };
+
+    size_t result = 0;
+    size_t i = 0;
+    for (; i < src.count(); i++) {
+        char c = src[i];
+        if (c == '\0')
+            continue;
+
+        if (c == '\n') {
+            if (!push('\r'))
+                break;
+
+            result += 1;
+        }
+
+        if (!push(c))
+            break;
+
+        result += 1;
+    }
+
+    if (i != src.count()) {
+        mTxDropped.fetch_add(src.count() - i, std::memory_order_relaxed);
+    }
+
+    if (result != 0) {
+        kick();
+    }
+
+    return result;
+}
+
+size_t km::BufferedSerialPort::read(std::span<uint8_t> dst) noexcept [[clang::blocking, clang::nonallocating]] {
+    if (!mRxQueue.isSetup()) {
+        return 0;
+    }
+
+    stdx::LockGuard guard(mRxLock);
+
+    size_t i = 0;
+    while (i < dst.size_bytes() && mRxQueue.tryPop(dst[i])) {
+        i += 1;
+    }
+
+    return i;
+}
+
+size_t km::BufferedSerialPort::writeAvailable() const noexcept [[clang::reentrant, clang::nonblocking]] {
+    return mTxQueue.capacity() - mTxQueue.count();
+}
+
+size_t km::BufferedSerialPort::readAvailable() const noexcept [[clang::reentrant, clang::nonblocking]] {
+    return mRxQueue.isSetup() ? mRxQueue.count() : 0;
+}
+
+void km::BufferedSerialPort::flush() noexcept [[clang::blocking, clang::nonallocating]] {
+    // Wait for an interrupt handler on another cpu to finish transmitting,
+    // but give up rather than deadlock if we are flushing from inside it.
+    static constexpr size_t kFlushLockAttempts = 0x10000;
+
+    size_t attempts = 0;
+    while (!mTxLock.try_lock()) {
+        if (++attempts == kFlushLockAttempts) {
+            return;
+        }
+
+        _mm_pause();
+    }
+
+    setInterruptEnable(0);
+
+    uint8_t byte;
+    while (mTxQueue.tryPop(byte)) {
+        if (mPort.put(byte) == OsStatusSuccess) {
+            mTxBytes.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            mTxDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    mTxArmed.store(false);
+    setInterruptEnable(mIdleInterrupts);
+
+    mTxLock.unlock();
+
+    // A writer may have pushed after the ring was drained.
+    if (mTxQueue.count() != 0) {
+        kick();
+    }
+}
+
+km::BufferedSerialStats km::BufferedSerialPort::stats() const noexcept {
+    return BufferedSerialStats {
+        .txBytes = mTxBytes.load(std::memory_order_relaxed),
+        .rxBytes = mRxBytes.load(std::memory_order_relaxed),
+        .txDropped = mTxDropped.load(std::memory_order_relaxed),
+        .rxDropped = mRxDropped.load(std::memory_order_relaxed),
+        .interrupts = mInterrupts.load(std::memory_order_relaxed),
+    };
+}
+
+OsStatus km::BufferedSerialPort::create(SerialPort port, uint32_t txCapacity, uint32_t rxCapacity, BufferedSerialPort *result [[outparam]]) noexcept [[clang::allocating]] {
+    if (!port.isReady()) {
+        return OsStatusInvalidInput;
+    }
+
+    if (OsStatus status = sm::AtomicRingQueue<uint8_t>::create(txCapacity, &result->mTxQueue)) {
+        return status;
+    }
+
+    // A transmit only port never enables the receive interrupt.
+    if (rxCapacity != 0) {
+        if (OsStatus status = sm::AtomicRingQueue<uint8_t>::create(rxCapacity, &result->mRxQueue)) {
+            return status;
+        }
+
+        result->mIdleInterrupts = kEnableReceive | kEnableLineStatus;
+    } else {
+        result->mIdleInterrupts = 0;
+    }
+
+    result->mPort = port;
+    result->mTxArmed.store(false);
+    result->setInterruptEnable(result->mIdleInterrupts);
+
+    return OsStatusSuccess;
+}
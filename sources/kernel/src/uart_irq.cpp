@@ -0,0 +1,70 @@
+#include "uart.hpp"
+
+#include "apic.hpp"
+#include "common/util/defer.hpp"
+#include "isr/isr.hpp"
+#include "logger/logger.hpp"
+#include "processor.hpp"
+
+constinit inline km::Logger UartLog { "UART" };
+
+namespace {
+    struct SerialIsrSlot {
+        std::atomic<uint8_t> vector;
+        std::atomic<km::BufferedSerialPort*> port;
+    };
+
+    /// @brief Enough for COM1 and COM2, the other ports share their irqs.
+    constinit SerialIsrSlot gSerialIsrSlots[2];
+
+    km::IsrContext SerialIsr(km::IsrContext *ctx) noexcept [[clang::reentrant]] {
+        km::IApic *apic = km::GetCpuLocalApic();
+        defer { apic->eoi(); };
+
+        for (SerialIsrSlot& slot : gSerialIsrSlots) {
+            if (slot.vector.load() != ctx->vector) {
+                continue;
+            }
+
+            if (km::BufferedSerialPort *port = slot.port.load()) {
+                port->handleInterrupt();
+            }
+        }
+
+        return *ctx;
+    }
+}
+
+OsStatus km::InstallSerialIsr(IoApicSet& ioApicSet, uint8_t irq, BufferedSerialPort *port, const IApic *target, LocalIsrTable *ist) {
+    SerialIsrSlot *slot = nullptr;
+    for (SerialIsrSlot& it : gSerialIsrSlots) {
+        km::BufferedSerialPort *expected = nullptr;
+        if (it.port.compare_exchange_strong(expected, port)) {
+            slot = &it;
+            break;
+        }
+    }
+
+    if (slot == nullptr) {
+        return OsStatusOutOfMemory;
+    }
+
+    const IsrEntry *entry = ist->allocate(SerialIsr);
+    if (entry == nullptr) {
+        slot->port.store(nullptr);
+        return OsStatusOutOfMemory;
+    }
+
+    uint8_t index = ist->index(entry);
+    slot->vector.store(index);
+
+    apic::IvtConfig config {
+        .vector = index,
+        .enabled = true,
+    };
+    ioApicSet.setLegacyRedirect(config, irq, target);
+
+    UartLog.dbgf("Serial irq ", irq, " ISR: ", index);
+
+    return OsStatusSuccess;
+}
@@ -30,6 +30,11 @@ extern "C" OsStatus OsVmemRelease(OsAnyPointer BaseAddress, OsSize Size) {
     return sys::SysVmemRelease(&invoke, BaseAddress, Size);
 }
 
+extern "C" OsStatus OsVmemProtect(OsAnyPointer BaseAddress, OsSize Size, OsMemoryAccess Access) {
+    auto invoke = GetInvokeContext();
+    return sys::SysVmemProtect(&invoke, BaseAddress, Size, Access);
+}
+
 extern "C" OsStatus OsThreadCreate(struct OsThreadCreateInfo CreateInfo, OsThreadHandle *OutHandle) {
     auto invoke = GetInvokeContext();
     return sys::SysThreadCreate(&invoke, CreateInfo, OutHandle);
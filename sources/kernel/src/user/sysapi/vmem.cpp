@@ -65,3 +65,16 @@ OsCallResult um::VmemMap(km::System *system, km::CallContext *context, km::Syste
 OsCallResult um::VmemDestroy(km::System *system, km::CallContext *context, km::SystemCallRegisterSet *regs) {
     return NewVmemDestroy(system, context, regs);
 }
+
+OsCallResult um::VmemProtect(km::System *system, km::CallContext *, km::SystemCallRegisterSet *regs) {
+    OsAnyPointer base = (OsAnyPointer)regs->arg0;
+    OsSize size = regs->arg1;
+    OsMemoryAccess access = regs->arg2;
+
+    sys::InvokeContext invoke { system->sys, sys::GetCurrentProcess() };
+    if (OsStatus status = sys::SysVmemProtect(&invoke, base, size, access)) {
+        return km::CallError(status);
+    }
+
+    return km::CallOk(0zu);
+}
@@ -5,22 +5,13 @@ bool km::IsPageMapped(PageTables& pt, const void *address, km::PageFlags flags)
 }
 
 bool km::IsRangeMapped(PageTables& pt, const void *begin, const void *end, km::PageFlags flags) {
-    uintptr_t front = (uintptr_t)begin;
-    uintptr_t back = (uintptr_t)end;
-
     const PageBuilder *pm = pt.pageManager();
 
     if (!pm->isCanonicalAddress(begin) || !pm->isCanonicalAddress(end)) {
         return false;
     }
 
-    for (uintptr_t addr = front; addr < back; addr += x64::kPageSize) {
-        if (!IsPageMapped(pt, (void*)addr, flags)) {
-            return false;
-        }
-    }
-
-    return true;
+    return pt.isRangeMapped(VirtualRange { begin, end }, flags);
 }
 
 OsStatus km::CopyUserMemory(PageTables& pt, uint64_t address, size_t size, void *copy) {
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include "acpi/slit.hpp"
+#include "acpi/srat.hpp"
+#include "memory/numa.hpp"
+
+#include <cstring>
+
+class SratTest : public testing::Test {
+public:
+    void SetUp() override {
+        srat.resize(sizeof(acpi::Srat));
+        slit.resize(sizeof(acpi::Slit));
+    }
+
+    template<typename T>
+    void addEntry(acpi::SratEntryType type, const T& body) {
+        uint8_t header[2] = { uint8_t(type), uint8_t(sizeof(header) + sizeof(T)) };
+        srat.insert(srat.end(), header, header + sizeof(header));
+
+        const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&body);
+        srat.insert(srat.end(), bytes, bytes + sizeof(T));
+    }
+
+    void addProcessor(uint32_t domain, uint8_t apicId, bool enabled = true) {
+        acpi::SratEntry::ProcessorAffinity processor {
+            .domainLow = uint8_t(domain & 0xFF),
+            .apicId = apicId,
+            .flags = enabled ? 1u : 0u,
+            .domainHigh = { uint8_t(domain >> 8), uint8_t(domain >> 16), uint8_t(domain >> 24) },
+        };
+
+        addEntry(acpi::SratEntryType::eProcessorAffinity, processor);
+    }
+
+    void addMemory(uint32_t domain, uint64_t base, uint64_t length, bool enabled = true) {
+        acpi::SratEntry::MemoryAffinity memory {
+            .domain = domain,
+            .baseAddress = base,
+            .length = length,
+            .flags = enabled ? 1u : 0u,
+        };
+
+        addEntry(acpi::SratEntryType::eMemoryAffinity, memory);
+    }
+
+    void addX2Apic(uint32_t domain, uint32_t x2apicId) {
+        acpi::SratEntry::X2ApicAffinity x2apic {
+            .domain = domain,
+            .x2apicId = x2apicId,
+            .flags = 1,
+        };
+
+        addEntry(acpi::SratEntryType::eX2ApicAffinity, x2apic);
+    }
+
+    void setDistances(std::initializer_list<uint8_t> distances, uint64_t count) {
+        slit.insert(slit.end(), distances.begin(), distances.end());
+        acpi::Slit *table = reinterpret_cast<acpi::Slit*>(slit.data());
+        std::memcpy(table->header.signature.data(), "SLIT", 4);
+        table->header.length = slit.size();
+        table->localityCount = count;
+    }
+
+    const acpi::Srat *getSrat() {
+        acpi::Srat *table = reinterpret_cast<acpi::Srat*>(srat.data());
+        std::memcpy(table->header.signature.data(), "SRAT", 4);
+        table->header.length = srat.size();
+        table->reserved0 = 1;
+        return table;
+    }
+
+    const acpi::Slit *getSlit() {
+        return reinterpret_cast<const acpi::Slit*>(slit.data());
+    }
+
+    std::vector<uint8_t> srat;
+    std::vector<uint8_t> slit;
+};
+
+TEST_F(SratTest, ReadTopology) {
+    addProcessor(0, 0);
+    addProcessor(0, 1);
+    addProcessor(1, 2);
+    addProcessor(1, 3, false);
+    addX2Apic(1, 0x100);
+    addMemory(0, 0x0000'0000, 0x8000'0000);
+    addMemory(1, 0x1'0000'0000, 0x8000'0000);
+    addMemory(2, 0x2'0000'0000, 0x8000'0000, false);
+
+    km::NumaTopology topology;
+    ASSERT_EQ(acpi::ReadNumaTopology(getSrat(), nullptr, &topology), OsStatusSuccess);
+
+    EXPECT_EQ(topology.nodeCount(), 2);
+    EXPECT_EQ(topology.cpus().size(), 4);
+    EXPECT_EQ(topology.memory().size(), 2);
+
+    EXPECT_EQ(topology.nodeOfCpu(km::CpuCoreId(1)), km::NumaNodeId(0));
+    EXPECT_EQ(topology.nodeOfCpu(km::CpuCoreId(2)), km::NumaNodeId(1));
+    EXPECT_EQ(topology.nodeOfCpu(km::CpuCoreId(3)), km::NumaNodeId::eInvalid);
+    EXPECT_EQ(topology.nodeOfCpu(km::CpuCoreId(0x100)), km::NumaNodeId(1));
+
+    EXPECT_EQ(topology.nodeOfAddress(km::PhysicalAddress { 0x1000 }), km::NumaNodeId(0));
+    EXPECT_EQ(topology.nodeOfAddress(km::PhysicalAddress { 0x1'0000'1000 }), km::NumaNodeId(1));
+    EXPECT_EQ(topology.nodeOfAddress(km::PhysicalAddress { 0x2'0000'1000 }), km::NumaNodeId::eInvalid);
+
+    EXPECT_EQ(topology.distance(km::NumaNodeId(0), km::NumaNodeId(0)), km::kNumaLocalDistance);
+    EXPECT_EQ(topology.distance(km::NumaNodeId(0), km::NumaNodeId(1)), km::kNumaRemoteDistance);
+}
+
+TEST_F(SratTest, SparseDomains) {
+    addProcessor(0x01020304, 0);
+    addMemory(0x01020304, 0, 0x1000);
+
+    km::NumaTopology topology;
+    ASSERT_EQ(acpi::ReadNumaTopology(getSrat(), nullptr, &topology), OsStatusSuccess);
+
+    EXPECT_EQ(topology.nodeCount(), 1);
+    EXPECT_EQ(topology.domainOf(km::NumaNodeId(0)), 0x01020304);
+    EXPECT_EQ(topology.nodeOfCpu(km::CpuCoreId(0)), km::NumaNodeId(0));
+}
+
+TEST_F(SratTest, ReadDistances) {
+    addMemory(2, 0x0000'0000, 0x1000);
+    addMemory(0, 0x1000, 0x1000);
+    addMemory(1, 0x2000, 0x1000);
+
+    setDistances({
+        10, 16, 32,
+        16, 10, 21,
+        32, 21, 10,
+    }, 3);
+
+    km::NumaTopology topology;
+    ASSERT_EQ(acpi::ReadNumaTopology(getSrat(), getSlit(), &topology), OsStatusSuccess);
+    ASSERT_EQ(topology.nodeCount(), 3);
+
+    // nodes are numbered in the order their domain was first seen
+    km::NumaNodeId node2 = topology.findNode(2);
+    km::NumaNodeId node0 = topology.findNode(0);
+    km::NumaNodeId node1 = topology.findNode(1);
+    EXPECT_EQ(node2, km::NumaNodeId(0));
+
+    EXPECT_EQ(topology.distance(node0, node1), 16);
+    EXPECT_EQ(topology.distance(node2, node0), 32);
+    EXPECT_EQ(topology.distance(node2, node1), 21);
+    EXPECT_EQ(topology.distance(node1, node1), 10);
+
+    km::NumaNodeId order[km::kMaxNumaNodes];
+    ASSERT_EQ(topology.nodesByDistance(node2, order), 3);
+    EXPECT_EQ(order[0], node2);
+    EXPECT_EQ(order[1], node1);
+    EXPECT_EQ(order[2], node0);
+}
+
+TEST_F(SratTest, TooManyNodes) {
+    for (uint32_t i = 0; i < km::kMaxNumaNodes + 1; i++) {
+        addMemory(i, i * 0x1000, 0x1000);
+    }
+
+    km::NumaTopology topology;
+    EXPECT_EQ(acpi::ReadNumaTopology(getSrat(), nullptr, &topology), OsStatusOutOfMemory);
+}
@@ -0,0 +1,123 @@
+#include <benchmark/benchmark.h>
+
+#include "crt.hpp"
+
+#include <cstring>
+#include <vector>
+
+/// @brief Memory routine configurations, indexed by the first benchmark argument.
+static constexpr KmMemoryFeatures kFeatures[] = {
+    { },
+    { .erms = true },
+    { .erms = true, .fsrm = true },
+    { .erms = true, .fsrm = true, .nonTemporal = true },
+};
+
+static constexpr const char *kFeatureNames[] = {
+    "generic",
+    "erms",
+    "fsrm",
+    "fsrm+nt",
+};
+
+static constexpr int64_t kMinSize = 1;
+static constexpr int64_t kMaxSize = 2 << 20;
+
+static void MemoryArgs(benchmark::internal::Benchmark *bench) {
+    bench->ArgNames({ "routine", "size" });
+    for (int64_t routine = 0; routine < int64_t(std::size(kFeatures)); routine++) {
+        for (int64_t size = kMinSize; size <= kMaxSize; size *= 4) {
+            bench->Args({ routine, size });
+        }
+    }
+}
+
+static void MisalignedArgs(benchmark::internal::Benchmark *bench) {
+    bench->ArgNames({ "routine", "size", "offset" });
+    for (int64_t routine = 0; routine < int64_t(std::size(kFeatures)); routine++) {
+        for (int64_t size = 64; size <= kMaxSize; size *= 16) {
+            bench->Args({ routine, size, 3 });
+        }
+    }
+}
+
+static void SetupRoutine(benchmark::State& state) {
+    KmInitMemoryRoutines(kFeatures[state.range(0)]);
+    state.SetLabel(kFeatureNames[state.range(0)]);
+}
+
+/// @brief Baseline using the host libc.
+static void BM_HostMemcpy(benchmark::State& state) {
+    size_t size = state.range(0);
+    std::vector<uint8_t> src(size, 0x55);
+    std::vector<uint8_t> dst(size);
+
+    for (auto _ : state) {
+        memcpy(dst.data(), src.data(), size);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_HostMemcpy)
+    ->RangeMultiplier(4)
+    ->Range(kMinSize, kMaxSize);
+
+static void BM_MemoryCopy(benchmark::State& state) {
+    SetupRoutine(state);
+
+    size_t size = state.range(1);
+    std::vector<uint8_t> src(size, 0x55);
+    std::vector<uint8_t> dst(size);
+
+    for (auto _ : state) {
+        KmMemoryCopy(dst.data(), src.data(), size);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_MemoryCopy)
+    ->Apply(MemoryArgs);
+
+static void BM_MemoryCopyMisaligned(benchmark::State& state) {
+    SetupRoutine(state);
+
+    size_t size = state.range(1);
+    size_t offset = state.range(2);
+    std::vector<uint8_t> src(size + offset, 0x55);
+    std::vector<uint8_t> dst(size);
+
+    for (auto _ : state) {
+        KmMemoryCopy(dst.data(), src.data() + offset, size);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_MemoryCopyMisaligned)
+    ->Apply(MisalignedArgs);
+
+static void BM_MemorySet(benchmark::State& state) {
+    SetupRoutine(state);
+
+    size_t size = state.range(1);
+    std::vector<uint8_t> dst(size);
+
+    for (auto _ : state) {
+        KmMemorySet(dst.data(), 0, size);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_MemorySet)
+    ->Apply(MemoryArgs);
@@ -0,0 +1,117 @@
+#include <benchmark/benchmark.h>
+
+#include "fs/interface.hpp"
+#include "fs/utils.hpp"
+#include "fs/vfs.hpp"
+#include "fs/ramfs.hpp"
+
+#include <memory>
+#include <stdio.h>
+
+using namespace vfs;
+
+static constexpr size_t kEntryCount = 100'000;
+
+/// @brief A ramfs folder with @a kEntryCount files, shared by every benchmark.
+static sm::RcuSharedPtr<INode> GetFolder() {
+    static VfsRoot *vfs = [] {
+        VfsRoot *vfs = new VfsRoot();
+        IVfsMount *mount = nullptr;
+        if (vfs->addMount(&RamFs::instance(), "System", &mount) != OsStatusSuccess) {
+            abort();
+        }
+
+        sm::RcuSharedPtr<INode> node = nullptr;
+        if (vfs->mkpath(BuildPath("Test"), &node) != OsStatusSuccess) {
+            abort();
+        }
+
+        for (size_t i = 0; i < kEntryCount; i++) {
+            char name[32];
+            int length = snprintf(name, sizeof(name), "file-%06zu.txt", i);
+            if (vfs->create(BuildPath("Test", VfsStringView(name, name + length)), &node) != OsStatusSuccess) {
+                abort();
+            }
+        }
+
+        return vfs;
+    }();
+
+    sm::RcuSharedPtr<INode> folder = nullptr;
+    if (vfs->lookup(BuildPath("Test"), &folder) != OsStatusSuccess) {
+        abort();
+    }
+
+    return folder;
+}
+
+/// @brief List the folder one node at a time, reading the name from each node.
+static void BM_ListNext(benchmark::State& state) {
+    sm::RcuSharedPtr<INode> folder = GetFolder();
+
+    for (auto _ : state) {
+        std::unique_ptr<IIteratorHandle> handle;
+        OsStatus status = vfs::OpenIteratorInterface(folder, nullptr, 0, std::out_ptr(handle));
+        if (status != OsStatusSuccess) {
+            state.SkipWithError("failed to open iterator");
+            return;
+        }
+
+        size_t count = 0;
+        sm::RcuSharedPtr<INode> child = nullptr;
+        while (handle->next(&child) == OsStatusSuccess) {
+            NodeInfo info = child->info();
+            benchmark::DoNotOptimize(info.name.count());
+            count += 1;
+        }
+
+        if (count != kEntryCount) {
+            state.SkipWithError("missing entries");
+            return;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * kEntryCount);
+}
+
+BENCHMARK(BM_ListNext)->Unit(benchmark::kMillisecond);
+
+/// @brief List the folder in batches of packed entries that fit in @p range(0) bytes.
+static void BM_ListBatch(benchmark::State& state) {
+    sm::RcuSharedPtr<INode> folder = GetFolder();
+    std::unique_ptr<std::byte[]> buffer{new std::byte[state.range(0)]};
+    OsIteratorBatch *batch = reinterpret_cast<OsIteratorBatch*>(buffer.get());
+
+    for (auto _ : state) {
+        std::unique_ptr<IIteratorHandle> handle;
+        OsStatus status = vfs::OpenIteratorInterface(folder, nullptr, 0, std::out_ptr(handle));
+        if (status != OsStatusSuccess) {
+            state.SkipWithError("failed to open iterator");
+            return;
+        }
+
+        size_t count = 0;
+        while (handle->invoke(nullptr, eOsIteratorNextBatch, batch, state.range(0)) == OsStatusSuccess) {
+            const OsIteratorEntry *entry = OsIteratorBatchFirst(batch);
+            for (size_t i = 0; i < batch->Count; i++) {
+                benchmark::DoNotOptimize(entry->NameLength);
+                entry = OsIteratorEntryNext(entry);
+            }
+
+            count += batch->Count;
+        }
+
+        if (count != kEntryCount) {
+            state.SkipWithError("missing entries");
+            return;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * kEntryCount);
+}
+
+BENCHMARK(BM_ListBatch)
+    ->Arg(256)
+    ->Arg(4096)
+    ->Arg(65536)
+    ->Unit(benchmark::kMillisecond);
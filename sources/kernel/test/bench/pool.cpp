@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+
+#include "memory/detail/pool.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+struct PoolObject {
+    uint64_t data[6];
+};
+
+using Pool = km::PoolAllocator<PoolObject>;
+
+/// @brief Fill a pool until it spans @p blocks blocks.
+static std::vector<PoolObject*> FillPool(Pool& pool, size_t blocks) {
+    std::vector<PoolObject*> objects;
+    while (pool.stats().magazines <= blocks) {
+        objects.push_back(pool.construct());
+    }
+
+    // the last allocation opened a new block, give it back
+    pool.destroy(objects.back());
+    objects.pop_back();
+    return objects;
+}
+
+/// @brief Free and reallocate random objects in a pool that spans a number of blocks.
+static void BM_PoolChurn(benchmark::State& state) {
+    Pool pool;
+    std::vector<PoolObject*> objects = FillPool(pool, state.range(0));
+
+    std::mt19937 random{0x1234};
+    std::uniform_int_distribution<size_t> dist(0, objects.size() - 1);
+
+    for (auto _ : state) {
+        size_t index = dist(random);
+        pool.destroy(objects[index]);
+        objects[index] = pool.construct();
+        benchmark::DoNotOptimize(objects[index]);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_PoolChurn)
+    ->Arg(1)
+    ->Arg(64)
+    ->Arg(4096);
+
+/// @brief Release objects in a random order then reallocate them all.
+static void BM_PoolBatchChurn(benchmark::State& state) {
+    Pool pool;
+    std::vector<PoolObject*> objects = FillPool(pool, state.range(0));
+
+    std::mt19937 random{0x1234};
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::shuffle(objects.begin(), objects.end(), random);
+        state.ResumeTiming();
+
+        for (PoolObject *object : objects) {
+            pool.destroy(object);
+        }
+
+        for (PoolObject *&object : objects) {
+            object = pool.construct();
+        }
+
+        benchmark::DoNotOptimize(objects.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * objects.size());
+}
+
+BENCHMARK(BM_PoolBatchChurn)
+    ->Arg(1)
+    ->Arg(64)
+    ->Arg(4096);
@@ -0,0 +1,149 @@
+#include <benchmark/benchmark.h>
+
+#include "fs/ramfs_storage.hpp"
+#include "std/vector.hpp"
+
+#include <random>
+
+#include <string.h>
+
+using vfs::RamFsStorage;
+
+/// @brief The storage ramfs files used before the radix tree, one contiguous buffer behind a lock.
+class VectorStorage {
+    stdx::Vector2<std::byte> mData;
+    stdx::SharedSpinLock mLock;
+
+public:
+    size_t read(void *dst, size_t size, uint64_t offset) {
+        stdx::SharedLock lock(mLock);
+        if (offset >= mData.count()) {
+            return 0;
+        }
+
+        size = std::min<size_t>(size, mData.count() - offset);
+        memcpy(dst, mData.data() + offset, size);
+        return size;
+    }
+
+    OsStatus write(const void *src, size_t size, uint64_t offset, size_t *written) {
+        stdx::UniqueLock lock(mLock);
+        if ((offset + size) > mData.count()) {
+            mData.resize(offset + size);
+        }
+
+        memcpy(mData.data() + offset, src, size);
+        *written = size;
+        return OsStatusSuccess;
+    }
+
+    uint64_t size() {
+        stdx::SharedLock lock(mLock);
+        return mData.count();
+    }
+};
+
+/// @brief Append chunks of @p range(0) bytes until the file is @p range(1) bytes long.
+template<typename T>
+static void BM_Append(benchmark::State& state) {
+    size_t chunk = state.range(0);
+    size_t total = state.range(1);
+    std::vector<std::byte> data(chunk, std::byte(0x55));
+
+    for (auto _ : state) {
+        T storage;
+        while (storage.size() < total) {
+            size_t written = 0;
+            storage.write(data.data(), data.size(), storage.size(), &written);
+        }
+
+        benchmark::DoNotOptimize(storage.size());
+    }
+
+    state.SetBytesProcessed(state.iterations() * total);
+}
+
+BENCHMARK(BM_Append<VectorStorage>)
+    ->Args({ 64, 1 << 20 })
+    ->Args({ 4096, 1 << 20 })
+    ->Args({ 4096, 16 << 20 });
+
+BENCHMARK(BM_Append<RamFsStorage>)
+    ->Args({ 64, 1 << 20 })
+    ->Args({ 4096, 1 << 20 })
+    ->Args({ 4096, 16 << 20 });
+
+/// @brief Read @p range(0) bytes from random offsets of a 16M file.
+template<typename T>
+static void BM_RandomRead(benchmark::State& state) {
+    static constexpr size_t kFileSize = 16 << 20;
+    size_t size = state.range(0);
+
+    static T *storage = [] {
+        T *storage = new T();
+        std::vector<std::byte> data(kFileSize, std::byte(0x55));
+        size_t written = 0;
+        storage->write(data.data(), data.size(), 0, &written);
+        return storage;
+    }();
+
+    std::mt19937 random{0x1234 + uint32_t(state.thread_index())};
+    std::uniform_int_distribution<uint64_t> dist(0, kFileSize - size);
+    std::vector<std::byte> buffer(size);
+
+    for (auto _ : state) {
+        size_t read = storage->read(buffer.data(), size, dist(random));
+        benchmark::DoNotOptimize(read);
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_RandomRead<VectorStorage>)
+    ->Arg(64)
+    ->Arg(4096)
+    ->ThreadRange(1, 4);
+
+BENCHMARK(BM_RandomRead<RamFsStorage>)
+    ->Arg(64)
+    ->Arg(4096)
+    ->ThreadRange(1, 4);
+
+/// @brief Random reads of one page while another thread keeps overwriting a different page.
+template<typename T>
+static void BM_ReadDuringWrite(benchmark::State& state) {
+    static constexpr size_t kFileSize = 1 << 20;
+    static T *storage = [] {
+        T *storage = new T();
+        std::vector<std::byte> data(kFileSize, std::byte(0x55));
+        size_t written = 0;
+        storage->write(data.data(), data.size(), 0, &written);
+        return storage;
+    }();
+
+    std::vector<std::byte> buffer(RamFsStorage::kPageSize);
+
+    if (state.thread_index() == 0) {
+        for (auto _ : state) {
+            size_t written = 0;
+            storage->write(buffer.data(), buffer.size(), 0, &written);
+        }
+    } else {
+        std::mt19937 random{uint32_t(state.thread_index())};
+        std::uniform_int_distribution<uint64_t> dist(1, kFileSize / RamFsStorage::kPageSize - 1);
+        for (auto _ : state) {
+            size_t read = storage->read(buffer.data(), buffer.size(), dist(random) * RamFsStorage::kPageSize);
+            benchmark::DoNotOptimize(read);
+        }
+
+        state.SetBytesProcessed(state.iterations() * buffer.size());
+    }
+}
+
+BENCHMARK(BM_ReadDuringWrite<VectorStorage>)
+    ->Threads(2)
+    ->Threads(4);
+
+BENCHMARK(BM_ReadDuringWrite<RamFsStorage>)
+    ->Threads(2)
+    ->Threads(4);
@@ -0,0 +1,96 @@
+#include <benchmark/benchmark.h>
+
+#include "stdio_stream.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdarg>
+
+#define STB_SPRINTF_IMPLEMENTATION 1
+#define STB_SPRINTF_STATIC 1
+#include "stb_sprintf.h"
+
+//
+// Formats lines the same way as vfprintf in sysapi and writes them to
+// /dev/null, so every write to the device is a real syscall. Unbuffered
+// streams behave like stdio did before streams were buffered, with one
+// syscall per printf.
+//
+
+static constexpr int64_t kLineCount = 1 << 20;
+
+static constexpr const char *kModeNames[] = {
+    "full",
+    "line",
+    "none",
+};
+
+static OsStatus NullWrite(void *object, const void *src, size_t size, size_t *written) {
+    int fd = *static_cast<int *>(object);
+    ssize_t result = write(fd, src, size);
+    if (result < 0) {
+        return OsStatusDeviceFault;
+    }
+
+    *written = result;
+    return OsStatusSuccess;
+}
+
+static OsStatus NullRead(void *, void *, size_t, size_t *read) {
+    *read = 0;
+    return OsStatusSuccess;
+}
+
+struct PrintBuffer {
+    char *buffer;
+    StreamBuffer *stream;
+};
+
+static char *PrintCallback(const char *buffer, void *user, int length) {
+    PrintBuffer *data = static_cast<PrintBuffer *>(user);
+    data->stream->write(buffer, length);
+    return data->buffer;
+}
+
+static int StreamPrintf(StreamBuffer *stream, const char *format, ...) {
+    char buffer[STB_SPRINTF_MIN];
+    PrintBuffer user { buffer, stream };
+
+    va_list args;
+    va_start(args, format);
+    int result = stbsp_vsprintfcb(PrintCallback, &user, buffer, format, args);
+    va_end(args);
+    return result;
+}
+
+static void BM_PrintLines(benchmark::State& state) {
+    StreamMode mode = StreamMode(state.range(0));
+    state.SetLabel(kModeNames[mode]);
+
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) {
+        state.SkipWithError("Failed to open /dev/null");
+        return;
+    }
+
+    StreamBuffer stream { StreamDevice { &fd, NullWrite, NullRead }, mode };
+
+    int64_t line = 0;
+    for (auto _ : state) {
+        StreamPrintf(&stream, "line %lld of %lld: %s\n", (long long)line, (long long)kLineCount, "the quick brown fox");
+        line += 1;
+    }
+
+    stream.flush();
+    close(fd);
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_PrintLines)
+    ->ArgName("mode")
+    ->Arg(eStreamFull)
+    ->Arg(eStreamLine)
+    ->Arg(eStreamNone)
+    ->Iterations(kLineCount);
@@ -0,0 +1,228 @@
+#include <benchmark/benchmark.h>
+
+#include "string_routines.hpp"
+
+#include <cstring>
+#include <vector>
+
+//
+// The byte at a time routines that the vectorized routines replaced.
+//
+
+static size_t BaselineStringLength(const char *s) {
+    size_t len = 0;
+    while (*s++) {
+        len++;
+    }
+    return len;
+}
+
+static char *BaselineStringFind(const char *str, int c) {
+    for (size_t i = 0; str[i]; i++) {
+        if (str[i] == c) {
+            return const_cast<char *>(str + i);
+        }
+    }
+
+    return nullptr;
+}
+
+static void *BaselineMemoryFind(const void *s, int c, size_t n) {
+    const unsigned char *p = static_cast<const unsigned char *>(s);
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] == c) {
+            return const_cast<unsigned char *>(p + i);
+        }
+    }
+
+    return nullptr;
+}
+
+static int BaselineMemoryCompare(const void *lhs, const void *rhs, size_t n) {
+    const unsigned char *l = static_cast<const unsigned char *>(lhs);
+    const unsigned char *r = static_cast<const unsigned char *>(rhs);
+    for (size_t i = 0; i < n; i++) {
+        if (l[i] != r[i]) {
+            return l[i] - r[i];
+        }
+    }
+
+    return 0;
+}
+
+static void *BaselineMemoryCopy(void *dst, const void *src, size_t size) {
+    unsigned char *d = static_cast<unsigned char *>(dst);
+    const unsigned char *s = static_cast<const unsigned char *>(src);
+    for (size_t i = 0; i < size; i++) {
+        d[i] = s[i];
+    }
+    return dst;
+}
+
+static void *BaselineMemorySet(void *ptr, int v, size_t size) {
+    unsigned char *p = static_cast<unsigned char *>(ptr);
+    for (size_t i = 0; i < size; i++) {
+        p[i] = static_cast<unsigned char>(v);
+    }
+    return ptr;
+}
+
+/// @brief Routine configurations, indexed by the first benchmark argument.
+static const StringRoutines kRoutines[] = {
+    {
+        .strlen = BaselineStringLength,
+        .strchr = BaselineStringFind,
+        .memchr = BaselineMemoryFind,
+        .memcmp = BaselineMemoryCompare,
+        .memcpy = BaselineMemoryCopy,
+        .memmove = nullptr,
+        .memset = BaselineMemorySet,
+    },
+    ImplSelectStringRoutines({ }),
+    ImplSelectStringRoutines({ .erms = true, .fsrm = true }),
+    ImplSelectStringRoutines({ .erms = true, .fsrm = true, .avx2 = true }),
+    {
+        .strlen = strlen,
+        .strchr = [](const char *str, int c) { return const_cast<char *>(strchr(str, c)); },
+        .memchr = [](const void *ptr, int c, size_t size) { return const_cast<void *>(memchr(ptr, c, size)); },
+        .memcmp = memcmp,
+        .memcpy = memcpy,
+        .memmove = memmove,
+        .memset = memset,
+    },
+};
+
+static constexpr const char *kRoutineNames[] = {
+    "baseline",
+    "sse2",
+    "erms+fsrm",
+    "avx2",
+    "host",
+};
+
+static constexpr size_t kAvx2Routine = 3;
+
+static constexpr int64_t kMinSize = 4;
+static constexpr int64_t kMaxSize = 1 << 20;
+
+static void StringArgs(benchmark::internal::Benchmark *bench) {
+    bench->ArgNames({ "routine", "size" });
+    for (int64_t routine = 0; routine < int64_t(std::size(kRoutines)); routine++) {
+        for (int64_t size = kMinSize; size <= kMaxSize; size *= 8) {
+            bench->Args({ routine, size });
+        }
+    }
+}
+
+static const StringRoutines *SetupRoutine(benchmark::State& state) {
+    size_t index = state.range(0);
+    if (index == kAvx2Routine && !ImplDetectStringFeatures().avx2) {
+        state.SkipWithError("AVX2 is not supported");
+        return nullptr;
+    }
+
+    state.SetLabel(kRoutineNames[index]);
+    return &kRoutines[index];
+}
+
+static void BM_StringLength(benchmark::State& state) {
+    const StringRoutines *routines = SetupRoutine(state);
+    if (!routines) return;
+
+    size_t size = state.range(1);
+    std::string str(size, 'x');
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(routines->strlen(str.c_str()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_StringLength)->Apply(StringArgs);
+
+static void BM_StringFind(benchmark::State& state) {
+    const StringRoutines *routines = SetupRoutine(state);
+    if (!routines) return;
+
+    size_t size = state.range(1);
+    std::string str(size, 'x');
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(routines->strchr(str.c_str(), 'y'));
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_StringFind)->Apply(StringArgs);
+
+static void BM_MemoryFind(benchmark::State& state) {
+    const StringRoutines *routines = SetupRoutine(state);
+    if (!routines) return;
+
+    size_t size = state.range(1);
+    std::vector<uint8_t> data(size, 'x');
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(routines->memchr(data.data(), 'y', size));
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_MemoryFind)->Apply(StringArgs);
+
+static void BM_MemoryCompare(benchmark::State& state) {
+    const StringRoutines *routines = SetupRoutine(state);
+    if (!routines) return;
+
+    size_t size = state.range(1);
+    std::vector<uint8_t> lhs(size, 'x');
+    std::vector<uint8_t> rhs(size, 'x');
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(routines->memcmp(lhs.data(), rhs.data(), size));
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_MemoryCompare)->Apply(StringArgs);
+
+static void BM_MemoryCopy(benchmark::State& state) {
+    const StringRoutines *routines = SetupRoutine(state);
+    if (!routines) return;
+
+    size_t size = state.range(1);
+    std::vector<uint8_t> src(size, 0x55);
+    std::vector<uint8_t> dst(size);
+
+    for (auto _ : state) {
+        routines->memcpy(dst.data(), src.data(), size);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_MemoryCopy)->Apply(StringArgs);
+
+static void BM_MemorySet(benchmark::State& state) {
+    const StringRoutines *routines = SetupRoutine(state);
+    if (!routines) return;
+
+    size_t size = state.range(1);
+    std::vector<uint8_t> dst(size);
+
+    for (auto _ : state) {
+        routines->memset(dst.data(), 0x55, size);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_MemorySet)->Apply(StringArgs);
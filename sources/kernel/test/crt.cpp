@@ -2,6 +2,8 @@
 
 #include "crt.hpp"
 
+#include <vector>
+
 TEST(CrtTest, MemoryCopySmall) {
     uint8_t buffer[3] = { 0x1, 0x2, 0x3 };
     uint8_t copy[3] = { 0x0, 0x0, 0x0 };
@@ -188,3 +190,71 @@ TEST_P(CrtUnalignedTest, MemorySetUnaligned) {
         ASSERT_EQ(copy[i + offset], 0xFF);
     }
 }
+
+struct CrtRoutineTest
+    : public testing::TestWithParam<KmMemoryFeatures> {
+    void SetUp() override {
+        KmInitMemoryRoutines(GetParam());
+    }
+
+    void TearDown() override {
+        KmInitMemoryRoutines(KmMemoryFeatures{});
+    }
+};
+
+INSTANTIATE_TEST_SUITE_P(
+    Routines, CrtRoutineTest,
+    testing::Values(
+        KmMemoryFeatures { },
+        KmMemoryFeatures { .erms = true },
+        KmMemoryFeatures { .erms = true, .fsrm = true },
+        KmMemoryFeatures { .nonTemporal = true },
+        KmMemoryFeatures { .erms = true, .fsrm = true, .nonTemporal = true }
+    ));
+
+static constexpr size_t kRoutineSizes[] = {
+    0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 32, 33, 127, 128, 129,
+    2047, 2048, 2049, 4095, 4096, 4097, 65536 + 5,
+};
+
+TEST_P(CrtRoutineTest, MemoryCopy) {
+    std::vector<uint8_t> src(65536 + 32);
+    for (size_t i = 0; i < src.size(); i++) {
+        src[i] = (i * 7) % 251;
+    }
+
+    for (size_t size : kRoutineSizes) {
+        for (size_t srcOffset = 0; srcOffset < 8; srcOffset++) {
+            for (size_t dstOffset = 0; dstOffset < 8; dstOffset++) {
+                std::vector<uint8_t> dst(size + 32, 0xAA);
+                KmMemoryCopy(dst.data() + dstOffset, src.data() + srcOffset, size);
+
+                for (size_t i = 0; i < dstOffset; i++) {
+                    ASSERT_EQ(dst[i], 0xAA) << "size " << size << " clobbered head " << i;
+                }
+
+                for (size_t i = 0; i < size; i++) {
+                    ASSERT_EQ(dst[i + dstOffset], src[i + srcOffset]) << "size " << size << " index " << i;
+                }
+
+                for (size_t i = size + dstOffset; i < dst.size(); i++) {
+                    ASSERT_EQ(dst[i], 0xAA) << "size " << size << " clobbered tail " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST_P(CrtRoutineTest, MemorySet) {
+    for (size_t size : kRoutineSizes) {
+        for (size_t offset = 0; offset < 8; offset++) {
+            std::vector<uint8_t> dst(size + 32, 0xAA);
+            KmMemorySet(dst.data() + offset, 0x5C, size);
+
+            for (size_t i = 0; i < dst.size(); i++) {
+                bool inside = i >= offset && i < offset + size;
+                ASSERT_EQ(dst[i], inside ? 0x5C : 0xAA) << "size " << size << " index " << i;
+            }
+        }
+    }
+}
@@ -0,0 +1,291 @@
+#include <gtest/gtest.h>
+
+#include "drivers/virtio/queue.hpp"
+
+#include <bit>
+#include <memory>
+#include <vector>
+
+using namespace km::virtio;
+
+static_assert(NeedEvent(0, 1, 0));
+static_assert(!NeedEvent(1, 1, 0));
+static_assert(NeedEvent(5, 8, 2));
+static_assert(!NeedEvent(8, 8, 2));
+static_assert(NeedEvent(0xFFFF, 2, 0xFFF0));
+
+/// @brief Plays the part of the device, the physical address of the queue is its virtual address.
+class VirtQueueTest : public testing::Test {
+public:
+    static constexpr uint16_t kSize = 16;
+    static constexpr uint16_t kIndirect = 8;
+
+    void create(bool indirect, bool eventIndex) {
+        layout = QueueLayout::of(kSize, indirect ? kIndirect : 0);
+        memory.reset(new (std::align_val_t(16)) std::byte[layout.size]());
+        ASSERT_EQ(VirtQueue::create(kSize, indirect ? kIndirect : 0, eventIndex, memory.get(), address(memory.get()), &queue), OsStatusSuccess);
+    }
+
+    static sm::PhysicalAddress address(const void *ptr) {
+        return sm::PhysicalAddress { std::bit_cast<uintptr_t>(ptr) };
+    }
+
+    template<typename T>
+    T *at(size_t offset) {
+        return std::bit_cast<T*>(memory.get() + offset);
+    }
+
+    Descriptor *descriptors() { return at<Descriptor>(layout.descriptors); }
+    uint16_t *avail() { return at<uint16_t>(layout.avail); }
+    uint16_t *used() { return at<uint16_t>(layout.used); }
+    UsedElement *usedRing() { return at<UsedElement>(layout.used + 4); }
+    uint16_t& usedEvent() { return avail()[2 + kSize]; }
+    uint16_t& availEvent() { return *std::bit_cast<uint16_t*>(usedRing() + kSize); }
+
+    /// @brief Take the next request from the available ring as a list of descriptors.
+    std::vector<Descriptor> consume(uint16_t *head) {
+        *head = avail()[2 + (deviceAvail++ % kSize)];
+
+        std::vector<Descriptor> chain;
+        Descriptor descriptor = descriptors()[*head];
+        if (bool(descriptor.flags & DescriptorFlags::eIndirect)) {
+            const Descriptor *table = std::bit_cast<const Descriptor*>(uintptr_t(descriptor.address));
+            for (size_t i = 0; i < descriptor.length / sizeof(Descriptor); i++) {
+                chain.push_back(table[i]);
+            }
+        } else {
+            while (true) {
+                chain.push_back(descriptor);
+                if (!bool(descriptor.flags & DescriptorFlags::eNext)) break;
+                descriptor = descriptors()[descriptor.next];
+            }
+        }
+
+        return chain;
+    }
+
+    void complete(uint16_t head, uint32_t length) {
+        uint16_t index = used()[1];
+        usedRing()[index % kSize] = UsedElement { head, length };
+        used()[1] = index + 1;
+    }
+
+    std::vector<QueueBuffer> request(size_t count) {
+        std::vector<QueueBuffer> buffers;
+        for (size_t i = 0; i < count; i++) {
+            buffers.push_back(QueueBuffer { address(data + i), uint32_t(i + 1), i == count - 1 });
+        }
+        return buffers;
+    }
+
+    struct Deleter {
+        void operator()(std::byte *ptr) { operator delete[](ptr, std::align_val_t(16)); }
+    };
+
+    std::unique_ptr<std::byte[], Deleter> memory;
+    QueueLayout layout;
+    VirtQueue queue;
+    uint16_t deviceAvail = 0;
+    int data[kSize * 4];
+};
+
+TEST_F(VirtQueueTest, InvalidSize) {
+    VirtQueue invalid;
+    std::byte buffer[1024];
+    ASSERT_EQ(VirtQueue::create(12, 0, false, buffer, address(buffer), &invalid), OsStatusInvalidInput);
+    ASSERT_EQ(VirtQueue::create(0, 0, false, buffer, address(buffer), &invalid), OsStatusInvalidInput);
+}
+
+TEST_F(VirtQueueTest, Layout) {
+    create(true, false);
+
+    ASSERT_EQ(queue.descriptorAddress(), address(memory.get()));
+    ASSERT_EQ(queue.availAddress().address % 2, 0);
+    ASSERT_EQ(queue.usedAddress().address % 4, 0);
+    ASSERT_EQ(queue.freeCount(), kSize);
+}
+
+TEST_F(VirtQueueTest, SingleBuffer) {
+    create(true, false);
+
+    auto buffers = request(1);
+    ASSERT_EQ(queue.add(buffers, &data[0]), OsStatusSuccess);
+    ASSERT_EQ(queue.freeCount(), kSize - 1);
+
+    // nothing is visible to the device until published
+    ASSERT_EQ(avail()[1], 0);
+    ASSERT_TRUE(queue.publish());
+    ASSERT_EQ(avail()[1], 1);
+
+    uint16_t head;
+    auto chain = consume(&head);
+    ASSERT_EQ(chain.size(), 1);
+    ASSERT_EQ(chain[0].address, buffers[0].address.address);
+    ASSERT_EQ(chain[0].flags, DescriptorFlags::eWrite);
+
+    uint32_t length = 0;
+    ASSERT_EQ(queue.popUsed(&length), nullptr);
+
+    complete(head, 64);
+    ASSERT_EQ(queue.popUsed(&length), &data[0]);
+    ASSERT_EQ(length, 64);
+    ASSERT_EQ(queue.freeCount(), kSize);
+    ASSERT_EQ(queue.popUsed(&length), nullptr);
+}
+
+TEST_F(VirtQueueTest, IndirectRequest) {
+    create(true, false);
+
+    auto buffers = request(3);
+    ASSERT_EQ(queue.add(buffers, &data[0]), OsStatusSuccess);
+
+    // the whole request consumes a single ring descriptor
+    ASSERT_EQ(queue.freeCount(), kSize - 1);
+    ASSERT_TRUE(queue.publish());
+
+    uint16_t head;
+    auto chain = consume(&head);
+    ASSERT_TRUE(bool(descriptors()[head].flags & DescriptorFlags::eIndirect));
+    ASSERT_EQ(chain.size(), 3);
+
+    for (size_t i = 0; i < chain.size(); i++) {
+        ASSERT_EQ(chain[i].address, buffers[i].address.address);
+        ASSERT_EQ(chain[i].length, buffers[i].length);
+        ASSERT_EQ(bool(chain[i].flags & DescriptorFlags::eWrite), buffers[i].writable);
+        ASSERT_EQ(bool(chain[i].flags & DescriptorFlags::eNext), i != chain.size() - 1);
+    }
+
+    complete(head, 0);
+    uint32_t length;
+    ASSERT_EQ(queue.popUsed(&length), &data[0]);
+    ASSERT_EQ(queue.freeCount(), kSize);
+}
+
+TEST_F(VirtQueueTest, DirectChain) {
+    create(false, false);
+
+    // without indirect tables every buffer consumes a ring descriptor
+    auto buffers = request(3);
+    ASSERT_EQ(queue.add(buffers, &data[0]), OsStatusSuccess);
+    ASSERT_EQ(queue.freeCount(), kSize - 3);
+    ASSERT_TRUE(queue.publish());
+
+    uint16_t head;
+    auto chain = consume(&head);
+    ASSERT_EQ(chain.size(), 3);
+    for (size_t i = 0; i < chain.size(); i++) {
+        ASSERT_EQ(chain[i].address, buffers[i].address.address);
+    }
+
+    complete(head, 0);
+    uint32_t length;
+    ASSERT_EQ(queue.popUsed(&length), &data[0]);
+    ASSERT_EQ(queue.freeCount(), kSize);
+}
+
+TEST_F(VirtQueueTest, FullQueue) {
+    create(false, false);
+
+    auto buffers = request(2);
+    for (size_t i = 0; i < kSize / 2; i++) {
+        ASSERT_EQ(queue.add(buffers, &data[i]), OsStatusSuccess);
+    }
+
+    ASSERT_FALSE(queue.canAdd(1));
+    ASSERT_EQ(queue.add(buffers, &data[0]), OsStatusOutOfMemory);
+    queue.publish();
+
+    // complete out of order to shuffle the free list
+    std::vector<uint16_t> heads;
+    for (size_t i = 0; i < kSize / 2; i++) {
+        uint16_t head;
+        consume(&head);
+        heads.push_back(head);
+    }
+
+    for (size_t i = 0; i < heads.size(); i += 2) complete(heads[i], 0);
+    for (size_t i = 1; i < heads.size(); i += 2) complete(heads[i], 0);
+
+    uint32_t length;
+    size_t count = 0;
+    while (queue.popUsed(&length) != nullptr) {
+        count += 1;
+    }
+
+    ASSERT_EQ(count, kSize / 2);
+    ASSERT_EQ(queue.freeCount(), kSize);
+
+    // every descriptor can be reused after the ring wraps
+    for (size_t round = 0; round < 4; round++) {
+        for (size_t i = 0; i < kSize; i++) {
+            ASSERT_EQ(queue.add(request(1), &data[i]), OsStatusSuccess);
+        }
+
+        queue.publish();
+
+        for (size_t i = 0; i < kSize; i++) {
+            uint16_t head;
+            consume(&head);
+            complete(head, 0);
+        }
+
+        for (size_t i = 0; i < kSize; i++) {
+            ASSERT_EQ(queue.popUsed(&length), &data[i]);
+        }
+    }
+}
+
+TEST_F(VirtQueueTest, NoNotifyFlag) {
+    create(true, false);
+
+    used()[0] = kUsedNoNotify;
+    ASSERT_EQ(queue.add(request(1), &data[0]), OsStatusSuccess);
+    ASSERT_FALSE(queue.publish());
+
+    used()[0] = 0;
+    ASSERT_EQ(queue.add(request(1), &data[1]), OsStatusSuccess);
+    ASSERT_TRUE(queue.publish());
+
+    // publishing with nothing new never notifies
+    ASSERT_FALSE(queue.publish());
+}
+
+TEST_F(VirtQueueTest, EventIndex) {
+    create(true, true);
+
+    // the device wants to be notified once entry 2 is made available
+    availEvent() = 2;
+
+    ASSERT_EQ(queue.add(request(1), &data[0]), OsStatusSuccess);
+    ASSERT_FALSE(queue.publish());
+
+    // a batch that crosses the event index needs exactly one notification
+    ASSERT_EQ(queue.add(request(1), &data[1]), OsStatusSuccess);
+    ASSERT_EQ(queue.add(request(1), &data[2]), OsStatusSuccess);
+    ASSERT_EQ(queue.add(request(1), &data[3]), OsStatusSuccess);
+    ASSERT_TRUE(queue.publish());
+
+    ASSERT_EQ(queue.add(request(1), &data[4]), OsStatusSuccess);
+    ASSERT_FALSE(queue.publish());
+}
+
+TEST_F(VirtQueueTest, InterruptSuppression) {
+    create(true, true);
+
+    ASSERT_EQ(queue.add(request(1), &data[0]), OsStatusSuccess);
+    queue.publish();
+
+    uint16_t head;
+    consume(&head);
+
+    queue.disableInterrupts();
+    ASSERT_FALSE(NeedEvent(usedEvent(), 1, 0));
+
+    complete(head, 0);
+    ASSERT_TRUE(queue.enableInterrupts());
+
+    uint32_t length;
+    ASSERT_EQ(queue.popUsed(&length), &data[0]);
+    ASSERT_FALSE(queue.enableInterrupts());
+    ASSERT_EQ(usedEvent(), 1);
+}
@@ -0,0 +1,361 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <random>
+#include <set>
+
+#include "fs/fatfs.hpp"
+#include "drivers/block/driver.hpp"
+#include "drivers/block/ramblk.hpp"
+#include "fs/file.hpp"
+#include "fs/vfs.hpp"
+
+using namespace vfs;
+
+TEST(FatFsTest, ShortName) {
+    char name[11];
+    km::FatCaseFlags flags;
+
+    ASSERT_TRUE(km::detail::FatShortName("motd.txt", name, &flags));
+    ASSERT_EQ(memcmp(name, "MOTD    TXT", 11), 0);
+    ASSERT_EQ(flags, km::FatCaseFlags::eLowerBase | km::FatCaseFlags::eLowerExtension);
+
+    ASSERT_TRUE(km::detail::FatShortName("README", name, &flags));
+    ASSERT_EQ(memcmp(name, "README     ", 11), 0);
+    ASSERT_EQ(flags, km::FatCaseFlags::eNone);
+
+    ASSERT_FALSE(km::detail::FatShortName("MiXed.txt", name, &flags));
+    ASSERT_FALSE(km::detail::FatShortName("toolongname.txt", name, &flags));
+    ASSERT_FALSE(km::detail::FatShortName("A long file name.txt", name, &flags));
+    ASSERT_FALSE(km::detail::FatShortName("archive.tar.gz", name, &flags));
+}
+
+TEST(FatFsTest, ValidName) {
+    ASSERT_TRUE(km::detail::IsValidFatName("A long file name.txt"));
+    ASSERT_FALSE(km::detail::IsValidFatName(""));
+    ASSERT_FALSE(km::detail::IsValidFatName(".."));
+    ASSERT_FALSE(km::detail::IsValidFatName("what?"));
+    ASSERT_FALSE(km::detail::IsValidFatName("trailing."));
+}
+
+class FatVolumeTest : public testing::Test {
+public:
+    std::vector<std::byte> image;
+    std::unique_ptr<km::MemoryBlk> media;
+    km::FatFsDriver volume;
+
+    void SetUp() override {
+        char *path = getenv("FAT_TEST_IMAGE");
+        ASSERT_NE(path, nullptr);
+
+        std::ifstream file(path, std::ios::binary);
+        ASSERT_TRUE(file.is_open());
+
+        file.seekg(0, std::ios::end);
+        image.resize(file.tellg());
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char*>(image.data()), image.size());
+
+        media.reset(new km::MemoryBlk(image.data(), image.size()));
+        remount();
+    }
+
+    void remount() {
+        volume = km::FatFsDriver{};
+        OsStatus status = km::FatFsDriver::create(media.get(), &volume);
+        ASSERT_EQ(status, OsStatusSuccess);
+    }
+
+    void find(km::FatNode& folder, stdx::StringView name, km::FatNode *node) {
+        stdx::Vector2<km::FatFolderEntry> entries;
+        ASSERT_EQ(volume.readFolder(folder, &entries), OsStatusSuccess);
+
+        for (const km::FatFolderEntry& entry : entries) {
+            if (stdx::StringView(entry.name) == name) {
+                *node = volume.openNode(entry);
+                return;
+            }
+        }
+
+        FAIL() << "entry not found: " << std::string_view(name.data(), name.count());
+    }
+
+    std::string readAll(km::FatNode& node) {
+        std::string result(node.size, '\0');
+        size_t read = 0;
+        OsStatus status = volume.read(node, 0, result.data(), result.size(), &read);
+        EXPECT_EQ(status, OsStatusSuccess);
+        EXPECT_EQ(read, result.size());
+        return result;
+    }
+
+    static std::string numbers() {
+        std::string result;
+        for (int i = 1; i <= 50000; i++) {
+            result += std::to_string(i);
+            result += '\n';
+        }
+        return result;
+    }
+};
+
+TEST_F(FatVolumeTest, ReadRootFolder) {
+    km::FatNode root = volume.rootNode();
+    stdx::Vector2<km::FatFolderEntry> entries;
+    ASSERT_EQ(volume.readFolder(root, &entries), OsStatusSuccess);
+
+    std::set<std::string> names;
+    for (const km::FatFolderEntry& entry : entries) {
+        names.insert(std::string(entry.name.begin(), entry.name.end()));
+    }
+
+    ASSERT_TRUE(names.contains("motd.txt"));
+    ASSERT_TRUE(names.contains("A long file name.txt"));
+    ASSERT_TRUE(names.contains("subdir"));
+    ASSERT_TRUE(names.contains("numbers.txt"));
+}
+
+TEST_F(FatVolumeTest, ReadNestedFile) {
+    km::FatNode root = volume.rootNode();
+    km::FatNode subdir, nested, hello;
+    find(root, "subdir", &subdir);
+    find(subdir, "nested", &nested);
+    find(nested, "hello.txt", &hello);
+
+    ASSERT_EQ(readAll(hello), "I am in a folder!\n");
+
+    char data[16];
+    size_t read = 0;
+    ASSERT_EQ(volume.read(hello, hello.size, data, sizeof(data), &read), OsStatusEndOfFile);
+    ASSERT_EQ(read, 0);
+}
+
+TEST_F(FatVolumeTest, SequentialReadWalksChainOnce) {
+    km::FatNode root = volume.rootNode();
+    km::FatNode node;
+    find(root, "numbers.txt", &node);
+
+    std::string expected = numbers();
+    ASSERT_EQ(node.size, expected.size());
+
+    //
+    // Read the file in small pieces, each FAT entry of the chain
+    // should only be read once.
+    //
+    uint64_t before = volume.stats().chainReads;
+    std::string result(node.size, '\0');
+    for (size_t offset = 0; offset < result.size(); offset += 100) {
+        size_t read = 0;
+        ASSERT_EQ(volume.read(node, offset, result.data() + offset, std::min<size_t>(100, result.size() - offset), &read), OsStatusSuccess);
+    }
+
+    ASSERT_EQ(result, expected);
+
+    uint32_t clusters = (node.size + volume.clusterSize() - 1) / volume.clusterSize();
+    ASSERT_LE(volume.stats().chainReads - before, clusters);
+
+    uint64_t mapped = volume.stats().chainReads;
+    ASSERT_EQ(readAll(node), expected);
+    ASSERT_EQ(volume.stats().chainReads, mapped);
+}
+
+TEST_F(FatVolumeTest, RandomRead) {
+    km::FatNode root = volume.rootNode();
+    km::FatNode node;
+    find(root, "numbers.txt", &node);
+
+    std::string expected = numbers();
+    std::mt19937 rng(1234);
+
+    for (int i = 0; i < 200; i++) {
+        size_t offset = rng() % expected.size();
+        size_t size = std::min<size_t>(rng() % 2000, expected.size() - offset);
+
+        std::string result(size, '\0');
+        size_t read = 0;
+        ASSERT_EQ(volume.read(node, offset, result.data(), size, &read), OsStatusSuccess);
+        ASSERT_EQ(read, size);
+        ASSERT_EQ(result, expected.substr(offset, size));
+    }
+}
+
+TEST_F(FatVolumeTest, CreateAndWrite) {
+    km::FatNode root = volume.rootNode();
+    uint32_t freeBefore = volume.freeClusterCount();
+
+    km::FatFolderEntry entry;
+    ASSERT_EQ(volume.create(root, "written file.txt", false, &entry), OsStatusSuccess);
+    ASSERT_EQ(volume.create(root, "WRITTEN FILE.TXT", false, &entry), OsStatusAlreadyExists);
+
+    std::string data;
+    for (int i = 0; i < 300; i++) {
+        data += "line " + std::to_string(i) + "\n";
+    }
+
+    km::FatNode node = volume.openNode(entry);
+    size_t written = 0;
+    ASSERT_EQ(volume.write(node, 0, data.data(), data.size(), &written), OsStatusSuccess);
+    ASSERT_EQ(written, data.size());
+
+    uint32_t clusters = (data.size() + volume.clusterSize() - 1) / volume.clusterSize();
+    ASSERT_EQ(volume.freeClusterCount(), freeBefore - clusters);
+    ASSERT_EQ(volume.sync(), OsStatusSuccess);
+
+    remount();
+    ASSERT_EQ(volume.freeClusterCount(), freeBefore - clusters);
+
+    root = volume.rootNode();
+    km::FatNode reopened;
+    find(root, "written file.txt", &reopened);
+    ASSERT_EQ(readAll(reopened), data);
+}
+
+TEST_F(FatVolumeTest, SparseWriteReadsZeros) {
+    km::FatNode root = volume.rootNode();
+
+    km::FatFolderEntry entry;
+    ASSERT_EQ(volume.create(root, "sparse.bin", false, &entry), OsStatusSuccess);
+
+    km::FatNode node = volume.openNode(entry);
+    size_t written = 0;
+    ASSERT_EQ(volume.write(node, 0, "head", 4, &written), OsStatusSuccess);
+    ASSERT_EQ(volume.write(node, 5000, "tail", 4, &written), OsStatusSuccess);
+    ASSERT_EQ(node.size, 5004);
+    ASSERT_EQ(volume.sync(), OsStatusSuccess);
+
+    remount();
+    root = volume.rootNode();
+    km::FatNode reopened;
+    find(root, "sparse.bin", &reopened);
+
+    std::string expected = "head" + std::string(4996, '\0') + "tail";
+    ASSERT_EQ(readAll(reopened), expected);
+}
+
+TEST_F(FatVolumeTest, FragmentedFile) {
+    km::FatNode root = volume.rootNode();
+
+    km::FatFolderEntry first, second;
+    ASSERT_EQ(volume.create(root, "first.bin", false, &first), OsStatusSuccess);
+    ASSERT_EQ(volume.create(root, "second.bin", false, &second), OsStatusSuccess);
+
+    //
+    // Growing two files in turn interleaves their clusters.
+    //
+    km::FatNode a = volume.openNode(first);
+    km::FatNode b = volume.openNode(second);
+    std::string expected;
+    std::vector<char> block(volume.clusterSize());
+    for (int i = 0; i < 8; i++) {
+        std::fill(block.begin(), block.end(), char('a' + i));
+        expected.append(block.begin(), block.end());
+
+        size_t written = 0;
+        ASSERT_EQ(volume.write(a, a.size, block.data(), block.size(), &written), OsStatusSuccess);
+        ASSERT_EQ(volume.write(b, b.size, block.data(), block.size(), &written), OsStatusSuccess);
+    }
+
+    ASSERT_EQ(volume.sync(), OsStatusSuccess);
+
+    remount();
+    root = volume.rootNode();
+    km::FatNode node;
+    find(root, "first.bin", &node);
+
+    ASSERT_EQ(readAll(node), expected);
+    ASSERT_EQ(node.clusters.extents().size(), 8);
+
+    uint64_t mapped = volume.stats().chainReads;
+    ASSERT_EQ(readAll(node), expected);
+    ASSERT_EQ(volume.stats().chainReads, mapped);
+}
+
+TEST_F(FatVolumeTest, CreateNestedFolder) {
+    km::FatNode root = volume.rootNode();
+
+    km::FatFolderEntry entry;
+    ASSERT_EQ(volume.create(root, "Documents", true, &entry), OsStatusSuccess);
+
+    km::FatNode folder = volume.openNode(entry);
+    ASSERT_EQ(volume.create(folder, "notes.txt", false, &entry), OsStatusSuccess);
+
+    km::FatNode notes = volume.openNode(entry);
+    size_t written = 0;
+    ASSERT_EQ(volume.write(notes, 0, "notes\n", 6, &written), OsStatusSuccess);
+
+    //
+    // Fill the folder past its first cluster.
+    //
+    for (int i = 0; i < 40; i++) {
+        std::string name = "entry number " + std::to_string(i);
+        ASSERT_EQ(volume.create(folder, stdx::StringView(name.data(), name.size()), false, &entry), OsStatusSuccess);
+    }
+
+    ASSERT_EQ(volume.sync(), OsStatusSuccess);
+
+    remount();
+    root = volume.rootNode();
+    km::FatNode documents, reopened;
+    find(root, "Documents", &documents);
+    find(documents, "notes.txt", &reopened);
+    ASSERT_EQ(readAll(reopened), "notes\n");
+
+    stdx::Vector2<km::FatFolderEntry> entries;
+    ASSERT_EQ(volume.readFolder(documents, &entries), OsStatusSuccess);
+    ASSERT_EQ(entries.count(), 41);
+}
+
+TEST_F(FatVolumeTest, MountVfs) {
+    vfs::VfsRoot vfs;
+
+    sm::SharedPtr<km::MemoryBlk> block = new km::MemoryBlk(image.data(), image.size());
+
+    {
+        IVfsMount *mount = nullptr;
+        OsStatus status = vfs.addMountWithParams(&FatFs::instance(), BuildPath("Mount"), &mount, block);
+        ASSERT_EQ(OsStatusSuccess, status);
+        ASSERT_NE(mount, nullptr);
+    }
+
+    {
+        std::unique_ptr<IFileHandle> hello;
+        OsStatus status = vfs.open(BuildPath("Mount", "subdir", "nested", "hello.txt"), std::out_ptr(hello));
+        ASSERT_EQ(OsStatusSuccess, status);
+        ASSERT_NE(hello, nullptr);
+
+        char data[512];
+        ReadRequest request {
+            .begin = std::begin(data),
+            .end = std::end(data),
+            .offset = 0,
+        };
+        ReadResult result{};
+        status = hello->read(request, &result);
+        ASSERT_EQ(OsStatusSuccess, status);
+
+        char expected[] = "I am in a folder!\n";
+        ASSERT_EQ(result.read, sizeof(expected) - 1);
+        ASSERT_EQ(memcmp(data, expected, sizeof(expected) - 1), 0);
+    }
+
+    {
+        sm::RcuSharedPtr<INode> node = nullptr;
+        OsStatus status = vfs.create(BuildPath("Mount", "created.txt"), &node);
+        ASSERT_EQ(OsStatusSuccess, status);
+
+        std::unique_ptr<IFileHandle> file;
+        status = vfs.open(BuildPath("Mount", "created.txt"), std::out_ptr(file));
+        ASSERT_EQ(OsStatusSuccess, status);
+
+        char text[] = "Created through the vfs\n";
+        WriteRequest request {
+            .begin = std::begin(text),
+            .end = std::end(text) - 1,
+            .offset = 0,
+        };
+        WriteResult result{};
+        status = file->write(request, &result);
+        ASSERT_EQ(OsStatusSuccess, status);
+        ASSERT_EQ(result.write, sizeof(text) - 1);
+    }
+}
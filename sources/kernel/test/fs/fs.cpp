@@ -3,6 +3,10 @@
 #include "fs/utils.hpp"
 #include "fs/vfs.hpp"
 #include "fs/ramfs.hpp"
+#include "fs/interface.hpp"
+
+#include <string>
+#include <vector>
 
 using namespace vfs;
 
@@ -325,3 +329,116 @@ TEST(Vfs2Test, OpenFolder) {
         ASSERT_EQ(OsStatusCompleted, status);
     }
 }
+
+/// @brief Read one batch of names from an iterator through the invoke interface.
+static OsStatus NextBatch(IIteratorHandle *handle, size_t size, std::vector<std::string> *names) {
+    alignas(OsIteratorBatch) std::byte buffer[4096];
+    OsIteratorBatch *batch = reinterpret_cast<OsIteratorBatch*>(buffer);
+    OsStatus status = handle->invoke(nullptr, eOsIteratorNextBatch, buffer, size);
+
+    const OsIteratorEntry *entry = OsIteratorBatchFirst(batch);
+    for (size_t i = 0; i < batch->Count; i++) {
+        EXPECT_EQ(uintptr_t(entry) % alignof(OsIteratorEntry), 0);
+        names->emplace_back(entry->Name, entry->NameLength);
+        entry = OsIteratorEntryNext(entry);
+    }
+
+    EXPECT_EQ((const std::byte*)entry - (const std::byte*)(batch + 1), batch->Size);
+    return status;
+}
+
+TEST(Vfs2Test, IterateFolderBatch) {
+    VfsRoot vfs;
+
+    IVfsMount *mount = nullptr;
+    sm::RcuSharedPtr<INode> node = nullptr;
+
+    ASSERT_EQ(vfs.addMount(&RamFs::instance(), "System", &mount), OsStatusSuccess);
+    ASSERT_EQ(vfs.mkpath(BuildPath("Test"), &node), OsStatusSuccess);
+
+    CreateFile(&vfs, BuildPath("Test", "file1.txt"), "Hello, World!");
+    CreateFile(&vfs, BuildPath("Test", "file2.txt"), "Goodbye, World!");
+    CreateFile(&vfs, BuildPath("Test", "file3.txt"), "Hello, World!");
+
+    std::unique_ptr<IIteratorHandle> handle;
+    ASSERT_EQ(vfs::OpenIteratorInterface(node, nullptr, 0, std::out_ptr(handle)), OsStatusSuccess);
+
+    std::vector<std::string> names;
+    ASSERT_EQ(NextBatch(handle.get(), 4096, &names), OsStatusSuccess);
+    ASSERT_EQ(names, (std::vector<std::string> { "file1.txt", "file2.txt", "file3.txt" }));
+
+    names.clear();
+    ASSERT_EQ(NextBatch(handle.get(), 4096, &names), OsStatusCompleted);
+    ASSERT_TRUE(names.empty());
+}
+
+TEST(Vfs2Test, IterateFolderBatchSmallBuffer) {
+    VfsRoot vfs;
+
+    IVfsMount *mount = nullptr;
+    sm::RcuSharedPtr<INode> node = nullptr;
+
+    ASSERT_EQ(vfs.addMount(&RamFs::instance(), "System", &mount), OsStatusSuccess);
+    ASSERT_EQ(vfs.mkpath(BuildPath("Test"), &node), OsStatusSuccess);
+
+    CreateFile(&vfs, BuildPath("Test", "file1.txt"), "Hello, World!");
+    CreateFile(&vfs, BuildPath("Test", "file2.txt"), "Goodbye, World!");
+
+    std::unique_ptr<IIteratorHandle> handle;
+    ASSERT_EQ(vfs::OpenIteratorInterface(node, nullptr, 0, std::out_ptr(handle)), OsStatusSuccess);
+
+    std::vector<std::string> names;
+
+    // The header alone can not hold an entry.
+    ASSERT_EQ(NextBatch(handle.get(), sizeof(OsIteratorBatch), &names), OsStatusMoreData);
+    ASSERT_EQ(NextBatch(handle.get(), sizeof(OsIteratorBatch) - 1, &names), OsStatusInvalidInput);
+    ASSERT_TRUE(names.empty());
+
+    // Room for exactly one entry per batch.
+    size_t size = sizeof(OsIteratorBatch) + sizeof(OsIteratorEntry) + 16;
+    ASSERT_EQ(NextBatch(handle.get(), size, &names), OsStatusSuccess);
+    ASSERT_EQ(NextBatch(handle.get(), size, &names), OsStatusSuccess);
+    ASSERT_EQ(NextBatch(handle.get(), size, &names), OsStatusCompleted);
+    ASSERT_EQ(names, (std::vector<std::string> { "file1.txt", "file2.txt" }));
+}
+
+TEST(Vfs2Test, IterateFolderBatchResume) {
+    VfsRoot vfs;
+
+    IVfsMount *mount = nullptr;
+    sm::RcuSharedPtr<INode> node = nullptr;
+
+    ASSERT_EQ(vfs.addMount(&RamFs::instance(), "System", &mount), OsStatusSuccess);
+    ASSERT_EQ(vfs.mkpath(BuildPath("Test"), &node), OsStatusSuccess);
+
+    CreateFile(&vfs, BuildPath("Test", "b"), "");
+    CreateFile(&vfs, BuildPath("Test", "d"), "");
+    CreateFile(&vfs, BuildPath("Test", "f"), "");
+
+    std::unique_ptr<IIteratorHandle> handle;
+    ASSERT_EQ(vfs::OpenIteratorInterface(node, nullptr, 0, std::out_ptr(handle)), OsStatusSuccess);
+
+    std::vector<std::string> names;
+    size_t size = sizeof(OsIteratorBatch) + sizeof(OsIteratorEntry) + 8;
+    ASSERT_EQ(NextBatch(handle.get(), size, &names), OsStatusSuccess);
+    ASSERT_EQ(names, (std::vector<std::string> { "b" }));
+
+    //
+    // Changing the folder between batches resumes from the name of the last
+    // entry, entries before it are not repeated and new entries after it are seen.
+    //
+    sm::RcuSharedPtr<INode> removed = nullptr;
+    ASSERT_EQ(vfs.lookup(BuildPath("Test", "b"), &removed), OsStatusSuccess);
+    ASSERT_EQ(vfs.remove(removed), OsStatusSuccess);
+    CreateFile(&vfs, BuildPath("Test", "a"), "");
+    CreateFile(&vfs, BuildPath("Test", "c"), "");
+
+    // Mixing single and batched calls shares the same cursor.
+    sm::RcuSharedPtr<INode> child = nullptr;
+    ASSERT_EQ(handle->next(&child), OsStatusSuccess);
+    ASSERT_EQ(GetName(child), "c");
+
+    ASSERT_EQ(NextBatch(handle.get(), 4096, &names), OsStatusSuccess);
+    ASSERT_EQ(names, (std::vector<std::string> { "b", "d", "f" }));
+    ASSERT_EQ(NextBatch(handle.get(), 4096, &names), OsStatusCompleted);
+}
@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+
+#include "fs/ramfs_storage.hpp"
+
+#include <random>
+#include <thread>
+#include <vector>
+
+using vfs::RamFsStorage;
+
+static constexpr size_t kPageSize = RamFsStorage::kPageSize;
+
+TEST(RamFsStorageTest, Empty) {
+    RamFsStorage storage;
+    ASSERT_EQ(storage.size(), 0);
+    ASSERT_EQ(storage.pageCount(), 0);
+
+    char buffer[16];
+    ASSERT_EQ(storage.read(buffer, sizeof(buffer), 0), 0);
+    ASSERT_EQ(storage.read(buffer, sizeof(buffer), 1000), 0);
+}
+
+TEST(RamFsStorageTest, ReadBack) {
+    RamFsStorage storage;
+
+    const char data[] = "hello world";
+    size_t written = 0;
+    ASSERT_EQ(storage.write(data, sizeof(data), 0, &written), OsStatusSuccess);
+    ASSERT_EQ(written, sizeof(data));
+    ASSERT_EQ(storage.size(), sizeof(data));
+    ASSERT_EQ(storage.pageCount(), 1);
+
+    char buffer[64]{};
+    ASSERT_EQ(storage.read(buffer, sizeof(buffer), 0), sizeof(data));
+    ASSERT_STREQ(buffer, data);
+
+    // reads are clamped to the end of the file
+    ASSERT_EQ(storage.read(buffer, sizeof(buffer), 6), sizeof(data) - 6);
+    ASSERT_STREQ(buffer, "world");
+}
+
+TEST(RamFsStorageTest, HolesReadAsZero) {
+    RamFsStorage storage;
+
+    uint64_t offset = kPageSize * 100 + 7;
+    uint32_t value = 0xDEADBEEF;
+    size_t written = 0;
+    ASSERT_EQ(storage.write(&value, sizeof(value), offset, &written), OsStatusSuccess);
+    ASSERT_EQ(storage.size(), offset + sizeof(value));
+
+    // only the written page has memory
+    ASSERT_EQ(storage.pageCount(), 1);
+
+    std::vector<std::byte> buffer(offset + sizeof(value), std::byte(0xFF));
+    ASSERT_EQ(storage.read(buffer.data(), buffer.size(), 0), buffer.size());
+    for (uint64_t i = 0; i < offset; i++) {
+        ASSERT_EQ(buffer[i], std::byte(0)) << "offset " << i;
+    }
+
+    uint32_t result = 0;
+    memcpy(&result, buffer.data() + offset, sizeof(result));
+    ASSERT_EQ(result, value);
+}
+
+TEST(RamFsStorageTest, WriteAcrossPages) {
+    RamFsStorage storage;
+
+    std::vector<uint8_t> data(kPageSize * 3);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = uint8_t(i * 31);
+    }
+
+    size_t written = 0;
+    ASSERT_EQ(storage.write(data.data(), data.size(), kPageSize / 2, &written), OsStatusSuccess);
+    ASSERT_EQ(written, data.size());
+    ASSERT_EQ(storage.pageCount(), 4);
+
+    std::vector<uint8_t> buffer(data.size());
+    ASSERT_EQ(storage.read(buffer.data(), buffer.size(), kPageSize / 2), buffer.size());
+    ASSERT_EQ(buffer, data);
+}
+
+TEST(RamFsStorageTest, Overwrite) {
+    RamFsStorage storage;
+
+    std::vector<char> data(kPageSize * 2, 'a');
+    size_t written = 0;
+    ASSERT_EQ(storage.write(data.data(), data.size(), 0, &written), OsStatusSuccess);
+
+    ASSERT_EQ(storage.write("bbbb", 4, kPageSize - 2, &written), OsStatusSuccess);
+    ASSERT_EQ(storage.size(), data.size());
+    ASSERT_EQ(storage.pageCount(), 2);
+
+    char buffer[8]{};
+    ASSERT_EQ(storage.read(buffer, 6, kPageSize - 3), 6);
+    ASSERT_STREQ(buffer, "abbbba");
+}
+
+TEST(RamFsStorageTest, GrowsTree) {
+    RamFsStorage storage;
+
+    //
+    // Each offset needs a taller tree than the last, the pages written before
+    // the tree grew must still be found through the new root.
+    //
+    std::vector<uint64_t> offsets;
+    for (uint64_t page = 1; page < (UINT64_C(1) << 40); page *= RamFsStorage::kFanout) {
+        offsets.push_back(page * kPageSize - 8);
+    }
+
+    offsets.push_back(UINT64_MAX - 16);
+
+    for (uint64_t offset : offsets) {
+        size_t written = 0;
+        ASSERT_EQ(storage.write(&offset, sizeof(offset), offset, &written), OsStatusSuccess) << "offset " << offset;
+    }
+
+    for (uint64_t offset : offsets) {
+        uint64_t value = 0;
+        ASSERT_EQ(storage.read(&value, sizeof(value), offset), sizeof(value));
+        ASSERT_EQ(value, offset);
+    }
+
+    ASSERT_EQ(storage.size(), UINT64_MAX - 8);
+}
+
+TEST(RamFsStorageTest, WriteOverflow) {
+    RamFsStorage storage;
+
+    char data[16]{};
+    size_t written = 0;
+    ASSERT_EQ(storage.write(data, sizeof(data), UINT64_MAX - 4, &written), OsStatusInvalidInput);
+    ASSERT_EQ(storage.size(), 0);
+}
+
+TEST(RamFsStorageTest, Append) {
+    RamFsStorage storage;
+
+    std::mt19937 random{0x1234};
+    std::vector<uint8_t> expected;
+    while (expected.size() < kPageSize * 64) {
+        std::vector<uint8_t> chunk(random() % 1000 + 1);
+        for (uint8_t& byte : chunk) {
+            byte = uint8_t(random());
+        }
+
+        size_t written = 0;
+        ASSERT_EQ(storage.write(chunk.data(), chunk.size(), storage.size(), &written), OsStatusSuccess);
+        expected.insert(expected.end(), chunk.begin(), chunk.end());
+    }
+
+    ASSERT_EQ(storage.size(), expected.size());
+
+    std::vector<uint8_t> buffer(expected.size());
+    ASSERT_EQ(storage.read(buffer.data(), buffer.size(), 0), buffer.size());
+    ASSERT_EQ(buffer, expected);
+}
+
+TEST(RamFsStorageTest, ConcurrentReadWrite) {
+    RamFsStorage storage;
+    static constexpr size_t kPages = 64;
+
+    //
+    // Writers fill whole pages with a single repeated byte, a reader that
+    // sees two different bytes in one page read it while it was being written.
+    //
+    std::vector<uint8_t> zero(kPageSize * kPages, 0);
+    size_t written = 0;
+    ASSERT_EQ(storage.write(zero.data(), zero.size(), 0, &written), OsStatusSuccess);
+
+    std::atomic<bool> done = false;
+    std::atomic<size_t> torn = 0;
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < 2; w++) {
+        threads.emplace_back([&, w] {
+            std::mt19937 random(w);
+            std::vector<uint8_t> page(kPageSize);
+            for (int i = 0; i < 2000; i++) {
+                std::fill(page.begin(), page.end(), uint8_t(random()));
+                size_t count = 0;
+                storage.write(page.data(), page.size(), (random() % kPages) * kPageSize, &count);
+            }
+        });
+    }
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; r++) {
+        readers.emplace_back([&, r] {
+            std::mt19937 random(r + 100);
+            std::vector<uint8_t> page(kPageSize);
+            while (!done) {
+                storage.read(page.data(), page.size(), (random() % kPages) * kPageSize);
+                if (std::count(page.begin(), page.end(), page[0]) != ptrdiff_t(page.size())) {
+                    torn += 1;
+                }
+            }
+        });
+    }
+
+    // Appends past the end grow the tree while the others run.
+    threads.emplace_back([&] {
+        std::vector<uint8_t> page(kPageSize, 0xAA);
+        for (size_t i = 0; i < 1000; i++) {
+            size_t count = 0;
+            storage.write(page.data(), page.size(), (kPages + i) * kPageSize, &count);
+        }
+    });
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    done = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQ(torn, 0);
+    ASSERT_EQ(storage.size(), (kPages + 1000) * kPageSize);
+    ASSERT_EQ(storage.pageCount(), kPages + 1000);
+}
@@ -3,6 +3,7 @@
 #include "fs/fs_test.hpp"
 
 #include <filesystem>
+#include <fstream>
 #include <fcntl.h>
 #include <sys/mman.h>
 
@@ -208,3 +209,112 @@ TEST(TarFsTest, ReadLargeFile) {
 		ASSERT_EQ(result.read, 833);
 	}
 }
+
+TEST(TarFsTest, ParseHeaderInMemory) {
+    sm::AbslBTreeMap<VfsPath, TarEntry> result;
+    std::span<const std::byte> image { (const std::byte*)kTestHeader, sizeof(kTestHeader) };
+
+    OsStatus status = vfs::ParseTar(image, {}, &result);
+    ASSERT_EQ(OsStatusSuccess, status);
+
+    ASSERT_EQ(result.size(), 1);
+
+    auto it = result.at(BuildPath("build"));
+    ASSERT_EQ(it.header.getType(), VfsNodeType::eFolder);
+    ASSERT_EQ(it.header.getSize(), 0);
+}
+
+TEST(TarFsTest, ParseTruncatedInMemory) {
+    sm::AbslBTreeMap<VfsPath, TarEntry> result;
+
+    // Not enough memory for a whole header.
+    std::span<const std::byte> image { (const std::byte*)kTestHeader, 100 };
+
+    OsStatus status = vfs::ParseTar(image, {}, &result);
+    ASSERT_EQ(OsStatusInvalidInput, status);
+}
+
+/// @brief Load the test archive into memory.
+static std::vector<std::byte> LoadTestArchive() {
+    std::ifstream stream(getenv("TAR_TEST_ARCHIVE"), std::ios::binary);
+    std::vector<char> data { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+    std::vector<std::byte> result(data.size());
+    memcpy(result.data(), data.data(), data.size());
+    return result;
+}
+
+TEST(TarFsTest, MountTarInMemory) {
+	vfs::VfsRoot vfs;
+
+	static constexpr sm::PhysicalAddress kImageAddress = 0x1000000;
+
+	std::vector<std::byte> image = LoadTestArchive();
+	ASSERT_FALSE(image.empty());
+
+	sm::SharedPtr<km::MemoryBlk> block = new km::MemoryBlk(image.data(), image.size(), km::Protection::eRead, kImageAddress);
+
+	{
+		IVfsMount *mount = nullptr;
+		OsStatus status = vfs.addMountWithParams(&TarFs::instance(), BuildPath("Mount"), &mount, block);
+		ASSERT_EQ(OsStatusSuccess, status);
+		ASSERT_NE(mount, nullptr);
+	}
+
+	std::unique_ptr<IFileHandle> motd;
+	OsStatus status = vfs.open(BuildPath("Mount", "motd.txt"), std::out_ptr(motd));
+	ASSERT_EQ(OsStatusSuccess, status);
+
+	char expected[] = "Tar parsing test file\n";
+
+	{
+		char data[512];
+		ReadRequest request {
+			.begin = std::begin(data),
+			.end = std::end(data),
+			.offset = 0,
+		};
+		ReadResult result{};
+		status = motd->read(request, &result);
+		ASSERT_EQ(OsStatusSuccess, status);
+		ASSERT_EQ(result.read, sizeof(expected) - 1);
+		ASSERT_EQ(memcmp(data, expected, sizeof(expected) - 1), 0);
+	}
+
+	{
+		// The physical address of the file points at its data in the image.
+		sm::PhysicalAddress address;
+		status = motd->physical(4, 8, &address);
+		ASSERT_EQ(OsStatusSuccess, status);
+
+		size_t offset = address.address - kImageAddress.address;
+		ASSERT_LT(offset, image.size());
+		ASSERT_EQ(memcmp(image.data() + offset, expected + 4, 8), 0);
+	}
+
+	{
+		// Ranges past the end of the file can not be mapped.
+		sm::PhysicalAddress address;
+		status = motd->physical(0, sizeof(expected), &address);
+		ASSERT_EQ(OsStatusInvalidInput, status);
+	}
+}
+
+TEST(TarFsTest, PhysicalNeedsResidentMedia) {
+	vfs::VfsRoot vfs;
+
+	sm::SharedPtr<FileBlk> file = new FileBlk(getenv("TAR_TEST_ARCHIVE"), 512);
+
+	{
+		IVfsMount *mount = nullptr;
+		OsStatus status = vfs.addMountWithParams(&TarFs::instance(), BuildPath("Mount"), &mount, file);
+		ASSERT_EQ(OsStatusSuccess, status);
+	}
+
+	std::unique_ptr<IFileHandle> motd;
+	OsStatus status = vfs.open(BuildPath("Mount", "motd.txt"), std::out_ptr(motd));
+	ASSERT_EQ(OsStatusSuccess, status);
+
+	sm::PhysicalAddress address;
+	status = motd->physical(0, 4, &address);
+	ASSERT_EQ(OsStatusNotSupported, status);
+}
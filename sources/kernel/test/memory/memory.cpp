@@ -174,6 +174,25 @@ TEST(MemoryDetailTest, AlignLargeRangeWithTail) {
     ASSERT_EQ(tail.size, 0x1000);
 }
 
+TEST(MemoryDetailTest, LargePageAlignment) {
+    //
+    // Small allocations keep the alignment they asked for.
+    //
+    ASSERT_EQ(detail::GetLargePageAlignment(x64::kPageSize, x64::kPageSize), x64::kPageSize);
+    ASSERT_EQ(detail::GetLargePageAlignment(x64::kLargePageSize - x64::kPageSize, x64::kPageSize), x64::kPageSize);
+
+    //
+    // Allocations of at least 2m are aligned to 2m.
+    //
+    ASSERT_EQ(detail::GetLargePageAlignment(x64::kLargePageSize, x64::kPageSize), x64::kLargePageSize);
+    ASSERT_EQ(detail::GetLargePageAlignment(x64::kLargePageSize * 3 + x64::kPageSize, x64::kPageSize), x64::kLargePageSize);
+
+    //
+    // Stricter alignment requirements are never weakened.
+    //
+    ASSERT_EQ(detail::GetLargePageAlignment(x64::kLargePageSize, x64::kHugePageSize), x64::kHugePageSize);
+}
+
 TEST(MemoryDetailTest, AddressParts) {
     uintptr_t address = 0xFFFF800000000000;
     PageWalkIndices indices = getAddressParts(address);
@@ -80,3 +80,94 @@ TEST_F(PageAllocatorTest, Allocate4k) {
     EXPECT_EQ(range.size(), x64::kPageSize);
     EXPECT_GE(range.front, sm::megabytes(1).bytes());
 }
+
+class PageAllocatorNumaTest : public testing::Test {
+public:
+    static constexpr MemoryRange kNode0 = MemoryRange::of(0x4000'0000zu, sm::megabytes(16).bytes());
+    static constexpr MemoryRange kNode1 = MemoryRange::of(0x8000'0000zu, sm::megabytes(16).bytes());
+
+    void SetUp() override {
+        std::vector<MemoryRegion> regions {
+            MemoryRegion { MemoryRegionType::eUsable, kNode0 },
+            MemoryRegion { MemoryRegionType::eUsable, kNode1 },
+        };
+
+        ASSERT_EQ(PageAllocator::create(regions, &allocator), OsStatusSuccess);
+
+        ASSERT_EQ(topology.addMemory(100, kNode0), OsStatusSuccess);
+        ASSERT_EQ(topology.addMemory(200, kNode1), OsStatusSuccess);
+        ASSERT_EQ(topology.addCpu(100, km::CpuCoreId(0)), OsStatusSuccess);
+        ASSERT_EQ(topology.addCpu(200, km::CpuCoreId(1)), OsStatusSuccess);
+    }
+
+    void TearDown() override {
+        km::SetCurrentNumaNode(km::NumaNodeId(0));
+    }
+
+    km::NumaTopology topology;
+    PageAllocator allocator;
+};
+
+TEST_F(PageAllocatorNumaTest, PreferLocalNode) {
+    ASSERT_EQ(allocator.partition(topology, km::NumaNodeId(0)), OsStatusSuccess);
+
+    auto local = allocator.pageAlloc(1, km::NumaNodeId(0));
+    ASSERT_TRUE(local.isValid());
+    EXPECT_TRUE(kNode0.contains(local.range()));
+
+    auto remote = allocator.pageAlloc(1, km::NumaNodeId(1));
+    ASSERT_TRUE(remote.isValid());
+    EXPECT_TRUE(kNode1.contains(remote.range()));
+    EXPECT_EQ(allocator.nodeOf(remote.address()), km::NumaNodeId(1));
+
+    km::SetCurrentNumaNode(km::NumaNodeId(1));
+    auto current = allocator.pageAlloc(1);
+    ASSERT_TRUE(current.isValid());
+    EXPECT_TRUE(kNode1.contains(current.range()));
+
+    allocator.free(local);
+    allocator.free(remote);
+    allocator.free(current);
+
+    auto stats = allocator.stats();
+    EXPECT_EQ(stats.nodeCount, 2);
+    EXPECT_EQ(stats.nodes[1].usedMemory, 0);
+}
+
+TEST_F(PageAllocatorNumaTest, FallbackToRemoteNode) {
+    ASSERT_EQ(allocator.partition(topology, km::NumaNodeId(0)), OsStatusSuccess);
+
+    size_t pages = sm::megabytes(12).bytes() / x64::kPageSize;
+    auto most = allocator.pageAlloc(pages, km::NumaNodeId(1));
+    ASSERT_TRUE(most.isValid());
+    EXPECT_TRUE(kNode1.contains(most.range()));
+
+    // node 1 only has 4mb left, so this must be served by node 0.
+    auto fallback = allocator.pageAlloc(pages, km::NumaNodeId(1));
+    ASSERT_TRUE(fallback.isValid());
+    EXPECT_TRUE(kNode0.contains(fallback.range()));
+
+    allocator.free(most);
+    allocator.free(fallback);
+}
+
+TEST_F(PageAllocatorNumaTest, PartitionKeepsLiveAllocations) {
+    // node 1 is entirely in use before partitioning, so there is nothing to carve out.
+    km::PmmAllocation live;
+    ASSERT_EQ(allocator.reserve(kNode1, &live), OsStatusSuccess);
+
+    ASSERT_EQ(allocator.partition(topology, km::NumaNodeId(0)), OsStatusSuccess);
+    EXPECT_EQ(allocator.nodeOf(kNode1.front), km::NumaNodeId(0));
+
+    // the live allocation is still owned by the primary heap.
+    allocator.free(live);
+
+    auto remote = allocator.pageAlloc(1, km::NumaNodeId(1));
+    ASSERT_TRUE(remote.isValid());
+    allocator.free(remote);
+}
+
+TEST_F(PageAllocatorNumaTest, PartitionTwice) {
+    ASSERT_EQ(allocator.partition(topology, km::NumaNodeId(0)), OsStatusSuccess);
+    EXPECT_EQ(allocator.partition(topology, km::NumaNodeId(0)), OsStatusAlreadyExists);
+}
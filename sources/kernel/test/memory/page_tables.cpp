@@ -950,3 +950,113 @@ TEST_F(PageTableTest, AddBackingMemory) {
         ASSERT_EQ(77 - (PageTables::minMemoryUsage() / x64::kPageSize), stats.freeBlocks);
     }
 }
+
+TEST_F(PageTableTest, WalkRangeLargePages) {
+    km::PageTables pt = ptes(km::PageFlags::eAll);
+
+    const void *vaddr = (void*)0xFFFF800000000000;
+    km::PhysicalAddress paddr = 0x1000000;
+    km::AddressMapping mapping { vaddr, paddr, x64::kLargePageSize * 4 };
+
+    OsStatus status = pt.map(mapping, km::PageFlags::eData);
+    ASSERT_EQ(OsStatusSuccess, status);
+
+    size_t leaves = 0;
+    pt.walkRange(mapping.virtualRange(), [&](VirtualRange leaf, const PageWalk& walk) {
+        EXPECT_EQ(km::PageSize::eLarge, walk.pageSize());
+        EXPECT_EQ(x64::kLargePageSize, leaf.size());
+        leaves += 1;
+        return true;
+    });
+
+    ASSERT_EQ(4, leaves);
+}
+
+TEST_F(PageTableTest, WalkRangeSkipsUnmapped) {
+    km::PageTables pt = ptes(km::PageFlags::eAll);
+
+    const void *vaddr = (void*)0xFFFF800000000000;
+    VirtualRange range { vaddr, (void*)((uintptr_t)vaddr + x64::kHugePageSize) };
+
+    size_t leaves = 0;
+    pt.walkRange(range, [&](VirtualRange leaf, const PageWalk& walk) {
+        EXPECT_EQ(km::PageSize::eNone, walk.pageSize());
+        EXPECT_TRUE(leaf.contains(range));
+        leaves += 1;
+        return true;
+    });
+
+    ASSERT_EQ(1, leaves);
+}
+
+TEST_F(PageTableTest, IsRangeMapped) {
+    km::PageTables pt = ptes(km::PageFlags::eAll);
+
+    const void *vaddr = (void*)0xFFFF800000000000;
+    km::PhysicalAddress paddr = 0x1000000;
+    km::AddressMapping mapping { vaddr, paddr, x64::kLargePageSize * 2 };
+
+    OsStatus status = pt.map(mapping, km::PageFlags::eData);
+    ASSERT_EQ(OsStatusSuccess, status);
+
+    ASSERT_TRUE(pt.isRangeMapped(mapping.virtualRange(), km::PageFlags::eData));
+    ASSERT_FALSE(pt.isRangeMapped(mapping.virtualRange(), km::PageFlags::eCode));
+
+    VirtualRange beyond { vaddr, (void*)((uintptr_t)vaddr + mapping.size + 1) };
+    ASSERT_FALSE(pt.isRangeMapped(beyond, km::PageFlags::eData));
+
+    //
+    // Unmapping part of the range must invalidate any cached walks.
+    //
+    VirtualRange hole { (void*)((uintptr_t)vaddr + x64::kPageSize), (void*)((uintptr_t)vaddr + x64::kPageSize * 2) };
+    status = pt.unmap(hole);
+    ASSERT_EQ(OsStatusSuccess, status);
+
+    ASSERT_FALSE(pt.isRangeMapped(mapping.virtualRange(), km::PageFlags::eData));
+    ASSERT_TRUE(pt.isRangeMapped(VirtualRange { vaddr, hole.front }, km::PageFlags::eData));
+    ASSERT_TRUE(pt.isRangeMapped(VirtualRange { hole.back, (void*)((uintptr_t)vaddr + mapping.size) }, km::PageFlags::eData));
+}
+
+TEST_F(PageTableTest, WalkCacheRefusesStaleWalk) {
+    km::PageTables pt = ptes(km::PageFlags::eAll);
+    km::detail::PageWalkCache cache;
+
+    const void *vaddr = (void*)0xFFFF800000000000;
+    km::AddressMapping mapping { vaddr, km::PhysicalAddress(0x1000000), x64::kPageSize * 4 };
+
+    OsStatus status = pt.map(mapping, km::PageFlags::eData);
+    ASSERT_EQ(OsStatusSuccess, status);
+
+    //
+    // A walk begins before the unmap and finishes after it, the result it
+    // produced describes the old page tables and must not be cached.
+    //
+    uint64_t generation = cache.generation();
+    km::PageWalk walk = pt.walk(vaddr);
+    ASSERT_EQ(walk.pageSize(), km::PageSize::eRegular);
+
+    uintptr_t size = walk.coverage();
+    VirtualRange leaf { vaddr, (void*)((uintptr_t)vaddr + size) };
+
+    {
+        km::detail::PageWalkCache::ModifyGuard guard(cache);
+        status = pt.unmap(mapping.virtualRange());
+        ASSERT_EQ(OsStatusSuccess, status);
+
+        // walks that start while the tables are being modified are refused too
+        ASSERT_FALSE(cache.insert(walk, leaf, cache.generation()));
+    }
+
+    ASSERT_FALSE(cache.insert(walk, leaf, generation));
+
+    km::PageWalk cached;
+    VirtualRange cachedLeaf;
+    ASSERT_FALSE(cache.find((uintptr_t)vaddr, &cached, &cachedLeaf));
+    ASSERT_FALSE(pt.isRangeMapped(mapping.virtualRange(), km::PageFlags::eData));
+
+    // a walk that starts after the modification is cached as usual
+    generation = cache.generation();
+    walk = pt.walk(vaddr);
+    ASSERT_TRUE(cache.insert(walk, leaf, generation));
+    ASSERT_TRUE(cache.find((uintptr_t)vaddr, &cached, &cachedLeaf));
+}
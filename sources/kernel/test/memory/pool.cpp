@@ -3,6 +3,11 @@
 #include "memory/detail/pool.hpp"
 #include "new_shim.hpp"
 
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
 template<typename T>
 using Pool = km::PoolAllocator<T>;
 
@@ -225,3 +230,78 @@ TEST_F(PoolTest, OutOfMemory) {
     ASSERT_LT(s2.magazines, s1.magazines) << "Magazines should be released after compaction";
     ASSERT_LT(s2.totalSlots, s1.totalSlots) << "Total slots should be released after compaction";
 }
+
+TEST_F(PoolTest, ReleaseAcrossBlocks) {
+    Pool<int> pool;
+    std::vector<int*> pointers;
+
+    // enough to span several blocks
+    for (size_t i = 0; i < 4096; i++) {
+        int *ptr = pool.construct(i);
+        ASSERT_NE(ptr, nullptr);
+        pointers.push_back(ptr);
+    }
+
+    ASSERT_GT(pool.stats().magazines, 1) << "Test should span multiple blocks";
+
+    // release in an order unrelated to allocation, every item must find its block
+    std::mt19937 random{0x1234};
+    std::shuffle(pointers.begin(), pointers.end(), random);
+
+    GetGlobalAllocator()->mNoAlloc = true;
+    for (int *ptr : pointers) {
+        pool.destroy(ptr);
+    }
+    GetGlobalAllocator()->mNoAlloc = false;
+
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.freeSlots, stats.totalSlots);
+    EXPECT_LE(stats.magazines, Pool<int>::kDefaultEmptyHighWaterMark);
+}
+
+TEST_F(PoolTest, EmptyHighWaterMark) {
+    Pool<int> pool;
+    pool.setEmptyHighWaterMark(1);
+
+    std::vector<int*> pointers;
+    for (size_t i = 0; i < 4096; i++) {
+        pointers.push_back(pool.construct(i));
+    }
+
+    size_t magazines = pool.stats().magazines;
+    ASSERT_GT(magazines, 2);
+
+    for (int *ptr : pointers) {
+        pool.destroy(ptr);
+    }
+
+    // all but one empty block should have been returned
+    EXPECT_EQ(pool.stats().magazines, 1);
+
+    pool.setEmptyHighWaterMark(0);
+    EXPECT_EQ(pool.stats().magazines, 0);
+    EXPECT_EQ(pool.stats().freeSlots, 0);
+}
+
+TEST_F(PoolTest, ReuseAfterFull) {
+    Pool<int> pool;
+    std::vector<int*> pointers;
+
+    for (size_t i = 0; i < 2048; i++) {
+        pointers.push_back(pool.construct(i));
+    }
+
+    size_t magazines = pool.stats().magazines;
+
+    // freeing one item from a full block must make it available again
+    // without allocating a new block.
+    int *victim = pointers.front();
+    pool.destroy(victim);
+
+    GetGlobalAllocator()->mNoAlloc = true;
+    int *ptr = pool.construct(42);
+    GetGlobalAllocator()->mNoAlloc = false;
+
+    EXPECT_EQ(ptr, victim);
+    EXPECT_EQ(pool.stats().magazines, magazines);
+}
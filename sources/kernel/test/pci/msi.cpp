@@ -0,0 +1,254 @@
+#include <gtest/gtest.h>
+
+#include "pci/msi.hpp"
+#include "isr/runtime.hpp"
+#include "memory/address_space.hpp"
+
+#include <algorithm>
+#include <array>
+
+static std::span<const km::CpuIsrTable> gTestCpuTables;
+
+std::span<const km::CpuIsrTable> km::GetCpuIsrTables() noexcept [[clang::reentrant]] {
+    return gTestCpuTables;
+}
+
+static km::IsrContext TestIsrHandler(km::IsrContext *context) noexcept [[clang::reentrant]] {
+    return *context;
+}
+
+/// @brief The config space of a single function at 00:00.0.
+class FakeConfigSpace final : public pci::IConfigSpace {
+public:
+    std::array<uint32_t, 64> space{};
+
+    pci::ConfigSpaceType type() const override { return pci::ConfigSpaceType::ePort; }
+
+    uint32_t read32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset) override {
+        if (bus != 0 || slot != 0 || function != 0) {
+            return UINT32_MAX;
+        }
+
+        return space[offset / sizeof(uint32_t)];
+    }
+
+    void write32(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset, uint32_t value) override {
+        if (bus != 0 || slot != 0 || function != 0) {
+            return;
+        }
+
+        space[offset / sizeof(uint32_t)] = value;
+    }
+};
+
+class MsiTest : public testing::Test {
+public:
+    static constexpr pci::DeviceBusAddress kAddress = { 0, 0, 0 };
+    static constexpr uint8_t kMsiOffset = 0x40;
+    static constexpr uint8_t kMsiXOffset = 0x60;
+
+    FakeConfigSpace config;
+
+    km::LocalIsrTable tables[3];
+    km::CpuIsrTable cpus[3] = {
+        { km::CpuCoreId(0), &tables[0] },
+        { km::CpuCoreId(1), &tables[1] },
+
+        // cannot be addressed by a message without interrupt remapping
+        { km::CpuCoreId(300), &tables[2] },
+    };
+
+    km::AddressSpace memory;
+
+    void SetUp() override {
+        gTestCpuTables = cpus;
+
+        // vendor and device id, status with a capability list, capabilities at 0x40
+        config.space[0x0 / 4] = 0x1042'1AF4;
+        config.space[0x4 / 4] = (1 << 4) << 16;
+        config.space[0x34 / 4] = kMsiOffset;
+    }
+
+    void TearDown() override {
+        gTestCpuTables = {};
+    }
+
+    /// @brief Add a 64 bit MSI capability with a mask register.
+    void addMsi(uint8_t next) {
+        uint16_t control = (1 << 7) | (1 << 8);
+        config.space[kMsiOffset / 4] = 0x05 | (next << 8) | (control << 16);
+    }
+
+    /// @brief Add an MSI-X capability with an 8 entry table in BAR 1.
+    void addMsiX(uint32_t bar1) {
+        config.space[kMsiXOffset / 4] = 0x11 | ((8 - 1) << 16);
+        config.space[(kMsiXOffset + 4) / 4] = 0x2000 | 1;
+        config.space[0x14 / 4] = bar1;
+    }
+
+    uint32_t read32(uint16_t offset) const {
+        return config.space[offset / 4];
+    }
+
+    static size_t allocatedCount(km::LocalIsrTable& table) {
+        return std::count_if(table.begin(), table.end(), [](const km::IsrEntry& entry) {
+            return entry.load() != km::defaultIsrHandler;
+        });
+    }
+};
+
+TEST(MsiMessageTest, Compose) {
+    pci::MsiMessage message = pci::ComposeMsiMessage(3, 0x40);
+    ASSERT_EQ(message.address, 0xFEE0'3000);
+    ASSERT_EQ(message.data, 0x40);
+
+    // only 8 bits of apic id fit in the message address
+    message = pci::ComposeMsiMessage(0x1FF, 0x80);
+    ASSERT_EQ(message.address, 0xFEEF'F000);
+    ASSERT_EQ(message.data, 0x80);
+}
+
+TEST_F(MsiTest, ReadCapabilities) {
+    addMsi(kMsiXOffset);
+    addMsiX(0);
+
+    pci::MsiCapability msi;
+    ASSERT_TRUE(pci::ReadMsiCapability(&config, kAddress, &msi));
+    ASSERT_EQ(msi.offset, kMsiOffset);
+    ASSERT_TRUE(msi.is64Bit);
+    ASSERT_TRUE(msi.perVectorMask);
+
+    pci::MsiXCapability msix;
+    ASSERT_TRUE(pci::ReadMsiXCapability(&config, kAddress, &msix));
+    ASSERT_EQ(msix.offset, kMsiXOffset);
+    ASSERT_EQ(msix.tableSize, 8);
+    ASSERT_EQ(msix.tableBar, 1);
+    ASSERT_EQ(msix.tableOffset, 0x2000);
+}
+
+TEST_F(MsiTest, NoCapabilities) {
+    config.space[0x4 / 4] = 0;
+
+    pci::MsiCapability msi;
+    ASSERT_FALSE(pci::ReadMsiCapability(&config, kAddress, &msi));
+
+    pci::MsiXCapability msix;
+    ASSERT_FALSE(pci::ReadMsiXCapability(&config, kAddress, &msix));
+
+    km::IsrCallback handlers[] = { TestIsrHandler };
+    pci::DeviceInterrupts interrupts;
+    ASSERT_EQ(pci::DeviceInterrupts::create(&config, kAddress, memory, handlers, 0, &interrupts), OsStatusNotSupported);
+}
+
+TEST_F(MsiTest, InvalidHandlers) {
+    addMsi(0);
+
+    pci::DeviceInterrupts interrupts;
+    ASSERT_EQ(pci::DeviceInterrupts::create(&config, kAddress, memory, {}, 0, &interrupts), OsStatusInvalidInput);
+
+    // plain msi is limited to a single vector
+    km::IsrCallback handlers[] = { TestIsrHandler, TestIsrHandler };
+    ASSERT_EQ(pci::DeviceInterrupts::create(&config, kAddress, memory, handlers, 0, &interrupts), OsStatusNotSupported);
+    ASSERT_EQ(allocatedCount(tables[0]), 0);
+}
+
+TEST_F(MsiTest, AllocateMsi) {
+    addMsi(0);
+
+    km::IsrCallback handlers[] = { TestIsrHandler };
+    pci::DeviceInterrupts interrupts;
+    ASSERT_EQ(pci::DeviceInterrupts::create(&config, kAddress, memory, handlers, 1, &interrupts), OsStatusSuccess);
+
+    ASSERT_EQ(interrupts.mode(), pci::InterruptMode::eMsi);
+    ASSERT_EQ(interrupts.count(), 1);
+
+    // routed to the requested cpu
+    const pci::InterruptVector& vector = interrupts.vector(0);
+    ASSERT_EQ(vector.core, km::CpuCoreId(1));
+    ASSERT_EQ(vector.table, &tables[1]);
+    ASSERT_EQ(allocatedCount(tables[1]), 1);
+
+    // the message is programmed into the capability
+    pci::MsiMessage message = pci::ComposeMsiMessage(1, vector.vector);
+    ASSERT_EQ(read32(kMsiOffset + 4), uint32_t(message.address));
+    ASSERT_EQ(read32(kMsiOffset + 8), uint32_t(message.address >> 32));
+    ASSERT_EQ(read32(kMsiOffset + 12) & 0xFFFF, message.data);
+
+    // msi is enabled with the vector masked, and legacy interrupts are disabled
+    ASSERT_TRUE((read32(kMsiOffset) >> 16) & 1);
+    ASSERT_TRUE(interrupts.isMasked(0));
+    ASSERT_TRUE(read32(0x4) & (1 << 10));
+    ASSERT_TRUE(read32(0x4) & (1 << 2));
+
+    interrupts.unmask(0);
+    ASSERT_FALSE(interrupts.isMasked(0));
+    ASSERT_EQ(read32(kMsiOffset + 16) & 1, 0);
+
+    interrupts.mask(0);
+    ASSERT_TRUE(interrupts.isMasked(0));
+
+    interrupts.release();
+    ASSERT_EQ(interrupts.mode(), pci::InterruptMode::eNone);
+    ASSERT_FALSE((read32(kMsiOffset) >> 16) & 1);
+    ASSERT_EQ(allocatedCount(tables[1]), 0);
+}
+
+TEST_F(MsiTest, SkipsUnaddressableCpus) {
+    addMsi(0);
+
+    // the third cpu cannot be targeted, so allocation wraps around to the first
+    km::IsrCallback handlers[] = { TestIsrHandler };
+    pci::DeviceInterrupts interrupts;
+    ASSERT_EQ(pci::DeviceInterrupts::create(&config, kAddress, memory, handlers, 2, &interrupts), OsStatusSuccess);
+
+    ASSERT_EQ(interrupts.vector(0).core, km::CpuCoreId(0));
+    ASSERT_EQ(allocatedCount(tables[0]), 1);
+    ASSERT_EQ(allocatedCount(tables[2]), 0);
+
+    interrupts.release();
+}
+
+TEST_F(MsiTest, SetAffinity) {
+    addMsi(0);
+
+    km::IsrCallback handlers[] = { TestIsrHandler };
+    pci::DeviceInterrupts interrupts;
+    ASSERT_EQ(pci::DeviceInterrupts::create(&config, kAddress, memory, handlers, 0, &interrupts), OsStatusSuccess);
+    interrupts.unmask(0);
+
+    ASSERT_EQ(interrupts.setAffinity(0, 2), OsStatusNotSupported);
+    ASSERT_EQ(interrupts.setAffinity(0, 1), OsStatusSuccess);
+
+    // the old vector is released and the message now targets the new cpu
+    const pci::InterruptVector& vector = interrupts.vector(0);
+    ASSERT_EQ(vector.core, km::CpuCoreId(1));
+    ASSERT_EQ(allocatedCount(tables[0]), 0);
+    ASSERT_EQ(allocatedCount(tables[1]), 1);
+
+    pci::MsiMessage message = pci::ComposeMsiMessage(1, vector.vector);
+    ASSERT_EQ(read32(kMsiOffset + 4), uint32_t(message.address));
+    ASSERT_EQ(read32(kMsiOffset + 12) & 0xFFFF, message.data);
+
+    // the mask state is kept across the move
+    ASSERT_FALSE(interrupts.isMasked(0));
+
+    interrupts.release();
+}
+
+TEST_F(MsiTest, MsiXReleasesVectorsOnFailure) {
+    addMsi(kMsiXOffset);
+
+    // the table bar is an io bar, so the table cannot be mapped
+    addMsiX(0x1);
+
+    km::IsrCallback handlers[] = { TestIsrHandler, TestIsrHandler, TestIsrHandler };
+    pci::DeviceInterrupts interrupts;
+    ASSERT_EQ(pci::DeviceInterrupts::create(&config, kAddress, memory, handlers, 0, &interrupts), OsStatusNotSupported);
+
+    for (km::LocalIsrTable& table : tables) {
+        ASSERT_EQ(allocatedCount(table), 0);
+    }
+
+    // msi-x was never enabled
+    ASSERT_FALSE((read32(kMsiXOffset) >> 16) & (1 << 15));
+}
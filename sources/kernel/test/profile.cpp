@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include "profile/sample.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+    struct StringStream final : public km::IOutStream {
+        std::string result;
+
+        void write(stdx::StringView message) override {
+            result.append(message.begin(), message.end());
+        }
+    };
+
+    /// @brief A fake stack of frames, each frame is a saved frame pointer and a return address.
+    struct FakeStack {
+        uintptr_t slots[64]{};
+
+        uintptr_t front() const { return (uintptr_t)std::begin(slots); }
+        uintptr_t back() const { return (uintptr_t)std::end(slots); }
+        uintptr_t frame(size_t index) const { return (uintptr_t)&slots[index]; }
+
+        void link(size_t index, uintptr_t next, uintptr_t pc) {
+            slots[index] = next;
+            slots[index + 1] = pc;
+        }
+    };
+
+    km::ProfileSample MakeSample(uintptr_t task, std::initializer_list<uintptr_t> pcs, bool user = false) {
+        km::ProfileSample sample { .task = task, .depth = uint16_t(pcs.size()), .user = user };
+        std::copy(pcs.begin(), pcs.end(), sample.pcs);
+        return sample;
+    }
+}
+
+TEST(ProfileStackTest, WalkChain) {
+    FakeStack stack;
+    stack.link(0, stack.frame(4), 0x1000);
+    stack.link(4, stack.frame(10), 0x2000);
+    stack.link(10, 0, 0x3000);
+
+    uintptr_t pcs[8];
+    size_t depth = km::WalkProfileStack(stack.frame(0), stack.front(), stack.back(), pcs, std::size(pcs));
+
+    ASSERT_EQ(depth, 3);
+    ASSERT_EQ(pcs[0], 0x1000);
+    ASSERT_EQ(pcs[1], 0x2000);
+    ASSERT_EQ(pcs[2], 0x3000);
+}
+
+TEST(ProfileStackTest, StopsAtLimit) {
+    FakeStack stack;
+    stack.link(0, stack.frame(2), 0x1000);
+    stack.link(2, stack.frame(4), 0x2000);
+    stack.link(4, stack.frame(6), 0x3000);
+
+    uintptr_t pcs[2];
+    size_t depth = km::WalkProfileStack(stack.frame(0), stack.front(), stack.back(), pcs, std::size(pcs));
+    ASSERT_EQ(depth, 2);
+}
+
+TEST(ProfileStackTest, StaysInsideStack) {
+    FakeStack stack;
+
+    // the second frame points past the end of the stack
+    stack.link(0, stack.frame(4), 0x1000);
+    stack.link(4, stack.back() + 0x100, 0x2000);
+
+    uintptr_t pcs[8];
+    size_t depth = km::WalkProfileStack(stack.frame(0), stack.front(), stack.back(), pcs, std::size(pcs));
+    ASSERT_EQ(depth, 2);
+
+    // a frame that straddles the end of the stack is never read
+    size_t last = std::size(stack.slots) - 1;
+    depth = km::WalkProfileStack(stack.frame(last), stack.front(), stack.back(), pcs, std::size(pcs));
+    ASSERT_EQ(depth, 0);
+
+    // nor is a frame below the start
+    depth = km::WalkProfileStack(stack.front() - 16, stack.front(), stack.back(), pcs, std::size(pcs));
+    ASSERT_EQ(depth, 0);
+}
+
+TEST(ProfileStackTest, RejectsLoops) {
+    FakeStack stack;
+    stack.link(0, stack.frame(4), 0x1000);
+    stack.link(4, stack.frame(0), 0x2000);
+
+    uintptr_t pcs[8];
+    size_t depth = km::WalkProfileStack(stack.frame(0), stack.front(), stack.back(), pcs, std::size(pcs));
+    ASSERT_EQ(depth, 2);
+}
+
+TEST(ProfileStackTest, RejectsMisaligned) {
+    FakeStack stack;
+    stack.link(0, stack.frame(4) + 1, 0x1000);
+
+    uintptr_t pcs[8];
+    size_t depth = km::WalkProfileStack(stack.frame(0), stack.front(), stack.back(), pcs, std::size(pcs));
+    ASSERT_EQ(depth, 1);
+}
+
+TEST(ProfileFoldTest, CountsStacks) {
+    std::vector<km::ProfileSample> samples = {
+        MakeSample(0x10, { 0xA, 0xB }),
+        MakeSample(0, { 0xC }),
+        MakeSample(0x10, { 0xA, 0xB }),
+        MakeSample(0x10, { 0xD }, true),
+        MakeSample(0x10, { 0xA, 0xB }),
+    };
+
+    StringStream out;
+    km::WriteFoldedStacks(samples, out);
+
+    ASSERT_EQ(out.result,
+        "idle;0xC_[k] 1\n"
+        "task-0x10;0xB_[k];0xA_[k] 3\n"
+        "task-0x10;0xD 1\n"
+    );
+}
+
+TEST(ProfileFoldTest, Empty) {
+    StringStream out;
+    km::WriteFoldedStacks({}, out);
+    ASSERT_TRUE(out.result.empty());
+}
@@ -5,6 +5,11 @@
 
 #include "uart.hpp"
 
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
 using namespace km::uart::detail;
 
 class MockSerial : public kmtest::IPeripheral {
@@ -222,4 +227,245 @@ TEST_F(SerialTest, SkipScratchTest) {
     km::OpenSerialResult result = km::OpenSerial(info);
 
     EXPECT_EQ(result.status, km::SerialPortStatus::eOk);
-}
\ No newline at end of file
+}
+
+class BufferedSerialTest : public SerialTest {
+public:
+    static constexpr uint16_t kBase = km::com::kComPort1;
+
+    km::BufferedSerialPort port;
+    std::vector<uint8_t> sent;
+
+    void openPort(uint32_t txCapacity, uint32_t rxCapacity) {
+        {
+            testing::InSequence s;
+            SerialConfigLine(serial, kBase);
+
+            // only receive and line status interrupts until there is data to send,
+            // and none at all for a transmit only port
+            uint8_t mask = (rxCapacity != 0) ? (kEnableReceive | kEnableLineStatus) : 0;
+            EXPECT_CALL(serial, write8(kBase + kInterruptEnable, mask));
+        }
+
+        km::ComPortInfo info = {
+            .port = kBase,
+            .divisor = km::com::kBaud9600,
+            .skipLoopbackTest = true,
+            .skipScratchTest = true,
+        };
+
+        km::SerialPort serialPort;
+        ASSERT_EQ(km::SerialPort::create(info, &serialPort), OsStatusSuccess);
+        ASSERT_EQ(km::BufferedSerialPort::create(serialPort, txCapacity, rxCapacity, &port), OsStatusSuccess);
+        testing::Mock::VerifyAndClearExpectations(&serial);
+    }
+
+    void expectTransmit(size_t count) {
+        EXPECT_CALL(serial, read8(kBase + kFifoControl))
+            .WillOnce(testing::Return(kTransmitEmptyInterrupt))
+            .WillOnce(testing::Return(kNoInterruptPending));
+
+        EXPECT_CALL(serial, write8(kBase + kData, _))
+            .Times(count)
+            .WillRepeatedly(testing::Invoke([this](uint16_t, uint8_t value) {
+                sent.push_back(value);
+            }));
+    }
+};
+
+TEST_F(BufferedSerialTest, WriteRefillsFifo) {
+    openPort(64, 16);
+
+    std::array<uint8_t, 20> data;
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = uint8_t(i);
+    }
+
+    // the transmit interrupt is only enabled once
+    EXPECT_CALL(serial, write8(kBase + kInterruptEnable, kEnableReceive | kEnableLineStatus | kEnableTransmit));
+
+    ASSERT_EQ(port.write(std::span(data).first(10)), 10);
+    ASSERT_EQ(port.write(std::span(data).subspan(10)), 10);
+    testing::Mock::VerifyAndClearExpectations(&serial);
+
+    // each interrupt writes at most a fifo worth of data
+    expectTransmit(kFifoDepth);
+    port.handleInterrupt();
+    testing::Mock::VerifyAndClearExpectations(&serial);
+
+    expectTransmit(data.size() - kFifoDepth);
+    port.handleInterrupt();
+    testing::Mock::VerifyAndClearExpectations(&serial);
+
+    // once the ring is empty the transmit interrupt is disabled
+    expectTransmit(0);
+    EXPECT_CALL(serial, write8(kBase + kInterruptEnable, kEnableReceive | kEnableLineStatus));
+    port.handleInterrupt();
+    testing::Mock::VerifyAndClearExpectations(&serial);
+
+    ASSERT_EQ(sent.size(), data.size());
+    EXPECT_TRUE(std::equal(sent.begin(), sent.end(), data.begin()));
+
+    km::BufferedSerialStats stats = port.stats();
+    EXPECT_EQ(stats.txBytes, data.size());
+    EXPECT_EQ(stats.txDropped, 0);
+    EXPECT_EQ(stats.interrupts, 3);
+}
+
+TEST_F(BufferedSerialTest, WriteDropsWhenFull) {
+    openPort(4, 16);
+
+    EXPECT_CALL(serial, write8(kBase + kInterruptEnable, kEnableReceive | kEnableLineStatus | kEnableTransmit));
+
+    std::array<uint8_t, 8> data{};
+    EXPECT_EQ(port.write(data), 4);
+    EXPECT_EQ(port.writeAvailable(), 0);
+    EXPECT_EQ(port.stats().txDropped, 4);
+}
+
+TEST_F(BufferedSerialTest, ReceiveFillsRing) {
+    openPort(16, 16);
+
+    EXPECT_CALL(serial, read8(kBase + kFifoControl))
+        .WillOnce(testing::Return(kReceiveInterrupt))
+        .WillOnce(testing::Return(kNoInterruptPending));
+
+    EXPECT_CALL(serial, read8(kBase + kLineStatus))
+        .WillOnce(testing::Return(kDataReady))
+        .WillOnce(testing::Return(kDataReady))
+        .WillOnce(testing::Return(kDataReady))
+        .WillOnce(testing::Return(0));
+
+    EXPECT_CALL(serial, read8(kBase + kData))
+        .WillOnce(testing::Return('a'))
+        .WillOnce(testing::Return('b'))
+        .WillOnce(testing::Return('c'));
+
+    port.handleInterrupt();
+    EXPECT_EQ(port.readAvailable(), 3);
+    EXPECT_EQ(port.stats().rxBytes, 3);
+
+    std::array<uint8_t, 8> buffer;
+    ASSERT_EQ(port.read(buffer), 3);
+    EXPECT_EQ(buffer[0], 'a');
+    EXPECT_EQ(buffer[1], 'b');
+    EXPECT_EQ(buffer[2], 'c');
+
+    EXPECT_EQ(port.read(buffer), 0);
+}
+
+TEST_F(BufferedSerialTest, ReceiveWakesReader) {
+    openPort(16, 16);
+
+    std::atomic<bool> waiting = false;
+    std::array<uint8_t, 8> buffer;
+    size_t count = 0;
+
+    std::thread reader([&] {
+        count = port.read(buffer, [] { return false; }, [&] {
+            waiting.store(true);
+            std::this_thread::yield();
+        });
+    });
+
+    // the reader has found the ring empty and is waiting for the interrupt handler
+    while (!waiting.load()) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_CALL(serial, read8(kBase + kFifoControl))
+        .WillOnce(testing::Return(kReceiveInterrupt))
+        .WillOnce(testing::Return(kNoInterruptPending));
+
+    EXPECT_CALL(serial, read8(kBase + kLineStatus))
+        .WillOnce(testing::Return(kDataReady))
+        .WillOnce(testing::Return(kDataReady))
+        .WillOnce(testing::Return(kDataReady))
+        .WillOnce(testing::Return(0));
+
+    EXPECT_CALL(serial, read8(kBase + kData))
+        .WillOnce(testing::Return('a'))
+        .WillOnce(testing::Return('b'))
+        .WillOnce(testing::Return('c'));
+
+    port.handleInterrupt();
+    reader.join();
+
+    ASSERT_EQ(count, 3);
+    EXPECT_EQ(buffer[0], 'a');
+    EXPECT_EQ(buffer[1], 'b');
+    EXPECT_EQ(buffer[2], 'c');
+}
+
+TEST_F(BufferedSerialTest, ReadWaitExpires) {
+    openPort(16, 16);
+
+    int checks = 0;
+    int yields = 0;
+
+    std::array<uint8_t, 8> buffer;
+    size_t count = port.read(buffer, [&] { return ++checks > 3; }, [&] { yields += 1; });
+
+    EXPECT_EQ(count, 0);
+    EXPECT_EQ(checks, 4);
+    EXPECT_EQ(yields, 3);
+}
+
+TEST_F(BufferedSerialTest, TransmitOnly) {
+    openPort(16, 0);
+
+    // the receive interrupt stays disabled while transmitting
+    EXPECT_CALL(serial, write8(kBase + kInterruptEnable, kEnableTransmit));
+
+    std::array<uint8_t, 4> data = { 1, 2, 3, 4 };
+    ASSERT_EQ(port.write(data), data.size());
+    testing::Mock::VerifyAndClearExpectations(&serial);
+
+    expectTransmit(data.size());
+    port.handleInterrupt();
+    testing::Mock::VerifyAndClearExpectations(&serial);
+
+    expectTransmit(0);
+    EXPECT_CALL(serial, write8(kBase + kInterruptEnable, 0));
+    port.handleInterrupt();
+    testing::Mock::VerifyAndClearExpectations(&serial);
+
+    ASSERT_EQ(sent.size(), data.size());
+
+    std::array<uint8_t, 4> buffer;
+    EXPECT_EQ(port.readAvailable(), 0);
+    EXPECT_EQ(port.read(buffer), 0);
+}
+
+TEST_F(BufferedSerialTest, FlushDrainsRing) {
+    openPort(16, 16);
+
+    EXPECT_CALL(serial, write8(kBase + kInterruptEnable, kEnableReceive | kEnableLineStatus | kEnableTransmit));
+
+    std::array<uint8_t, 3> data = { 'x', 'y', 'z' };
+    ASSERT_EQ(port.write(data), data.size());
+    testing::Mock::VerifyAndClearExpectations(&serial);
+
+    {
+        testing::InSequence s;
+
+        // interrupts are disabled while polling, then only the idle interrupts are restored
+        EXPECT_CALL(serial, write8(kBase + kInterruptEnable, 0));
+        for (uint8_t byte : data) {
+            EXPECT_CALL(serial, read8(kBase + kLineStatus))
+                .WillOnce(testing::Return(kEmptyTransmit));
+            EXPECT_CALL(serial, write8(kBase + kData, byte));
+        }
+        EXPECT_CALL(serial, write8(kBase + kInterruptEnable, kEnableReceive | kEnableLineStatus));
+    }
+
+    port.flush();
+    testing::Mock::VerifyAndClearExpectations(&serial);
+
+    EXPECT_EQ(port.writeAvailable(), 16);
+    EXPECT_EQ(port.stats().txBytes, data.size());
+
+    // the transmit interrupt is armed again for new writes
+    EXPECT_CALL(serial, write8(kBase + kInterruptEnable, kEnableReceive | kEnableLineStatus | kEnableTransmit));
+    ASSERT_EQ(port.write(std::span(data).first(1)), 1);
+}
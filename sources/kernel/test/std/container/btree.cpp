@@ -1082,3 +1082,142 @@ TEST_F(BTreeTest, CustomAllocator) {
         ASSERT_EQ(foundValue, value) << "Found value does not match expected value";
     }
 }
+
+struct BTreeBulkLoadTest
+    : public BTreeTest
+    , public testing::WithParamInterface<size_t>
+{ };
+
+INSTANTIATE_TEST_SUITE_P(
+    BulkLoad, BTreeBulkLoadTest,
+    testing::Values(0, 1, 2, BTreeTest::Leaf::maxCapacity(), BTreeTest::Leaf::maxCapacity() + 1, 1000, 1000'0));
+
+TEST_P(BTreeBulkLoadTest, LoadSorted) {
+    size_t count = GetParam();
+    std::vector<std::pair<BigKey, int>> entries;
+    for (size_t i = 0; i < count; i++) {
+        entries.push_back({ int(i * 3), int(i) });
+    }
+
+    BTreeMap<BigKey, int> tree;
+    tree.insert(-1, -1);
+    ASSERT_EQ(tree.bulkLoad(entries), OsStatusSuccess);
+    tree.validate();
+
+    ASSERT_EQ(tree.count(), count);
+    ASSERT_FALSE(tree.contains(-1)) << "Existing contents should be replaced";
+
+    size_t index = 0;
+    for (const auto& [key, value] : tree) {
+        ASSERT_EQ(key, entries[index].first) << "Key at index " << index << " is out of order";
+        ASSERT_EQ(value, entries[index].second);
+        index += 1;
+    }
+    ASSERT_EQ(index, count);
+
+    for (const auto& [key, value] : entries) {
+        auto it = tree.find(key);
+        ASSERT_NE(it, tree.end()) << "Key " << key.key << " not found after bulk load";
+        ASSERT_EQ((*it).second, value);
+        ASSERT_FALSE(tree.contains(key.key + 1));
+    }
+
+    // the tree must still be usable by the incremental paths
+    for (size_t i = 0; i < count; i += 2) {
+        tree.remove(int(i * 3));
+        tree.insert(int(i * 3) + 1, 0);
+    }
+    tree.validate();
+    ASSERT_EQ(tree.count(), count);
+}
+
+TEST_F(BTreeTest, BulkLoadPacked) {
+    size_t count = 1000'0;
+    std::vector<std::pair<BigKey, int>> entries;
+    for (size_t i = 0; i < count; i++) {
+        entries.push_back({ int(i), int(i) });
+    }
+
+    BTreeMap<BigKey, int> loaded;
+    ASSERT_EQ(loaded.bulkLoad(entries), OsStatusSuccess);
+
+    BTreeMap<BigKey, int> inserted;
+    for (const auto& [key, value] : entries) {
+        inserted.insert(key, value);
+    }
+
+    auto packed = loaded.stats();
+    auto incremental = inserted.stats();
+    ASSERT_LE(packed.memoryUsage, incremental.memoryUsage);
+    ASSERT_LE(packed.depth, incremental.depth);
+}
+
+TEST_F(BTreeTest, BulkLoadUnsorted) {
+    std::vector<std::pair<BigKey, int>> entries = { {1, 0}, {3, 0}, {2, 0} };
+    std::vector<std::pair<BigKey, int>> duplicates = { {1, 0}, {2, 0}, {2, 0} };
+
+    BTreeMap<BigKey, int> tree;
+    tree.insert(5, 50);
+
+    ASSERT_EQ(tree.bulkLoad(entries), OsStatusInvalidInput);
+    ASSERT_EQ(tree.bulkLoad(duplicates), OsStatusInvalidInput);
+
+    ASSERT_EQ(tree.count(), 1) << "A failed bulk load should leave the map unchanged";
+    ASSERT_TRUE(tree.contains(5));
+}
+
+TEST_F(BTreeTest, BranchlessSearch) {
+    std::uniform_int_distribution<int> dist(-1000, 1000);
+    for (size_t count : { 0zu, 1zu, 3zu, 4zu, 15zu, 16zu, 17zu, 33zu, 126zu, 251zu }) {
+        std::vector<int> keys;
+        for (size_t i = 0; i < count; i++) {
+            keys.push_back(dist(mt));
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        std::vector<uint32_t> unsignedKeys;
+        for (int key : keys) {
+            unsignedKeys.push_back(uint32_t(key) + 0x8000'0000);
+        }
+
+        for (int needle = -1002; needle <= 1002; needle++) {
+            size_t lower = std::distance(keys.begin(), std::lower_bound(keys.begin(), keys.end(), needle));
+            size_t upper = std::distance(keys.begin(), std::upper_bound(keys.begin(), keys.end(), needle));
+            ASSERT_EQ(BranchlessLowerBound(keys.data(), keys.size(), needle), lower) << "needle " << needle;
+            ASSERT_EQ(BranchlessUpperBound(keys.data(), keys.size(), needle), upper) << "needle " << needle;
+
+            uint32_t unsignedNeedle = uint32_t(needle) + 0x8000'0000;
+            ASSERT_EQ(BranchlessLowerBound(unsignedKeys.data(), unsignedKeys.size(), unsignedNeedle), lower);
+            ASSERT_EQ(BranchlessUpperBound(unsignedKeys.data(), unsignedKeys.size(), unsignedNeedle), upper);
+
+            int64_t wideNeedle = needle;
+            std::vector<int64_t> wideKeys(keys.begin(), keys.end());
+            ASSERT_EQ(BranchlessLowerBound(wideKeys.data(), wideKeys.size(), wideNeedle), lower);
+        }
+    }
+}
+
+TEST_F(BTreeTest, IntegralKeys) {
+    BTreeMap<uint32_t, int> tree;
+    std::map<uint32_t, int> expected;
+    std::uniform_int_distribution<uint32_t> dist(0, UINT32_MAX);
+
+    for (size_t i = 0; i < 1000'0; i++) {
+        uint32_t key = dist(mt);
+        tree.insert(key, int(i));
+        expected[key] = int(i);
+    }
+    tree.validate();
+
+    for (const auto& [key, value] : expected) {
+        auto it = tree.find(key);
+        ASSERT_NE(it, tree.end()) << "Key " << key << " not found in BTreeMap";
+        ASSERT_EQ((*it).second, value);
+    }
+
+    for (const auto& [key, value] : expected) {
+        tree.remove(key);
+    }
+    ASSERT_EQ(tree.count(), 0);
+}
@@ -186,3 +186,162 @@ static void BM_BezosBtreeIterate(benchmark::State& state) {
 
 BENCHMARK(BM_BezosBtreeIterate)
     ->Range(32, 8 << 14);
+
+static void BM_AbseilBtreeFindMiss(benchmark::State& state) {
+    absl::btree_map<int, int> btree;
+    std::unique_ptr<int[]> keys(new int[state.range(0)]);
+    std::mt19937 mt(0x1234);
+    std::uniform_int_distribution<int> dist(0, INT_MAX / 2);
+    for (int64_t i = 0; i < state.range(0); i++) {
+        int key = dist(mt);
+        btree.insert({key * 2, i});
+        keys[i] = (key * 2) + 1;
+    }
+
+    for (auto _ : state) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            auto it = btree.find(keys[i]);
+            benchmark::DoNotOptimize(it);
+        }
+    }
+}
+
+BENCHMARK(BM_AbseilBtreeFindMiss)
+    ->Range(32, 8 << 14);
+
+static void BM_BezosBtreeFindMiss(benchmark::State& state) {
+    sm::BTreeMap<int, int> btree;
+    std::unique_ptr<int[]> keys(new int[state.range(0)]);
+    std::mt19937 mt(0x1234);
+    std::uniform_int_distribution<int> dist(0, INT_MAX / 2);
+    for (int64_t i = 0; i < state.range(0); i++) {
+        int key = dist(mt);
+        btree.insert(key * 2, i);
+        keys[i] = (key * 2) + 1;
+    }
+
+    for (auto _ : state) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            auto it = btree.find(keys[i]);
+            benchmark::DoNotOptimize(it);
+        }
+    }
+}
+
+BENCHMARK(BM_BezosBtreeFindMiss)
+    ->Range(32, 8 << 14);
+
+static constexpr int64_t kRangeScanLength = 64;
+
+static void BM_AbseilBtreeRangeScan(benchmark::State& state) {
+    absl::btree_map<int, int> btree;
+    std::unique_ptr<int[]> keys(new int[state.range(0)]);
+    std::mt19937 mt(0x1234);
+    std::uniform_int_distribution<int> dist(0, INT_MAX);
+    for (int64_t i = 0; i < state.range(0); i++) {
+        keys[i] = dist(mt);
+        btree.insert({keys[i], i});
+    }
+
+    for (auto _ : state) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            auto it = btree.find(keys[i]);
+            for (int64_t j = 0; j < kRangeScanLength && it != btree.end(); j++, ++it) {
+                benchmark::DoNotOptimize(auto(it->second));
+            }
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0) * kRangeScanLength);
+}
+
+BENCHMARK(BM_AbseilBtreeRangeScan)
+    ->Range(32, 8 << 14);
+
+static void BM_BezosBtreeRangeScan(benchmark::State& state) {
+    sm::BTreeMap<int, int> btree;
+    std::unique_ptr<int[]> keys(new int[state.range(0)]);
+    std::mt19937 mt(0x1234);
+    std::uniform_int_distribution<int> dist(0, INT_MAX);
+    for (int64_t i = 0; i < state.range(0); i++) {
+        keys[i] = dist(mt);
+        btree.insert(keys[i], i);
+    }
+
+    for (auto _ : state) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            auto it = btree.find(keys[i]);
+            for (int64_t j = 0; j < kRangeScanLength && it != btree.end(); j++, ++it) {
+                benchmark::DoNotOptimize(auto((*it).second));
+            }
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0) * kRangeScanLength);
+}
+
+BENCHMARK(BM_BezosBtreeRangeScan)
+    ->Range(32, 8 << 14);
+
+static std::vector<std::pair<int, int>> GenerateSortedEntries(int64_t count) {
+    std::vector<std::pair<int, int>> entries;
+    std::mt19937 mt(0x1234);
+    std::uniform_int_distribution<int> dist(0, INT_MAX);
+    for (int64_t i = 0; i < count; i++) {
+        entries.push_back({dist(mt), int(i)});
+    }
+
+    std::sort(entries.begin(), entries.end());
+    auto last = std::unique(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first == rhs.first;
+    });
+    entries.erase(last, entries.end());
+    return entries;
+}
+
+static void BM_AbseilBtreeBulkLoad(benchmark::State& state) {
+    std::vector<std::pair<int, int>> entries = GenerateSortedEntries(state.range(0));
+
+    for (auto _ : state) {
+        absl::btree_map<int, int> btree(entries.begin(), entries.end());
+        benchmark::DoNotOptimize(btree);
+    }
+
+    state.SetItemsProcessed(state.iterations() * entries.size());
+}
+
+BENCHMARK(BM_AbseilBtreeBulkLoad)
+    ->Range(32, 8 << 14);
+
+static void BM_BezosBtreeBulkLoad(benchmark::State& state) {
+    std::vector<std::pair<int, int>> entries = GenerateSortedEntries(state.range(0));
+
+    for (auto _ : state) {
+        sm::BTreeMap<int, int> btree;
+        OsStatus status = btree.bulkLoad(entries);
+        benchmark::DoNotOptimize(status);
+        benchmark::DoNotOptimize(btree);
+    }
+
+    state.SetItemsProcessed(state.iterations() * entries.size());
+}
+
+BENCHMARK(BM_BezosBtreeBulkLoad)
+    ->Range(32, 8 << 14);
+
+static void BM_BezosBtreeSortedInsert(benchmark::State& state) {
+    std::vector<std::pair<int, int>> entries = GenerateSortedEntries(state.range(0));
+
+    for (auto _ : state) {
+        sm::BTreeMap<int, int> btree;
+        for (const auto& [key, value] : entries) {
+            btree.insert(key, value);
+        }
+        benchmark::DoNotOptimize(btree);
+    }
+
+    state.SetItemsProcessed(state.iterations() * entries.size());
+}
+
+BENCHMARK(BM_BezosBtreeSortedInsert)
+    ->Range(32, 8 << 14);
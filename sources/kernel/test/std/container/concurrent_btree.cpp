@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "std/container/concurrent_btree.hpp"
+
+using TestMap = sm::ConcurrentBTreeMap<uint32_t, uint64_t>;
+
+class ConcurrentBTreeTest : public testing::Test {
+public:
+    void SetUp() override {
+        ASSERT_EQ(TestMap::create({}, &map), OsStatusSuccess);
+    }
+
+    static uint64_t ValueOf(uint32_t key) {
+        return (uint64_t(key) << 32) | ~key;
+    }
+
+    TestMap map;
+};
+
+TEST_F(ConcurrentBTreeTest, Empty) {
+    uint64_t value = 0;
+    ASSERT_FALSE(map.find(0, &value));
+    ASSERT_FALSE(map.remove(0));
+    ASSERT_EQ(map.count(), 0);
+    map.validate();
+}
+
+TEST_F(ConcurrentBTreeTest, InsertFind) {
+    std::mt19937 mt{0x1234};
+    std::uniform_int_distribution<uint32_t> dist(0, UINT32_MAX);
+    std::map<uint32_t, uint64_t> expected;
+
+    for (size_t i = 0; i < 100'000; i++) {
+        uint32_t key = dist(mt);
+        ASSERT_EQ(map.insert(key, ValueOf(key)), OsStatusSuccess);
+        expected[key] = ValueOf(key);
+    }
+
+    map.validate();
+    ASSERT_EQ(map.count(), expected.size());
+
+    for (const auto& [key, value] : expected) {
+        uint64_t found = 0;
+        ASSERT_TRUE(map.find(key, &found)) << "Key " << key << " not found";
+        ASSERT_EQ(found, value);
+    }
+}
+
+TEST_F(ConcurrentBTreeTest, Update) {
+    ASSERT_EQ(map.insert(10, 1), OsStatusSuccess);
+    ASSERT_EQ(map.insert(10, 2), OsStatusSuccess);
+
+    uint64_t value = 0;
+    ASSERT_TRUE(map.find(10, &value));
+    ASSERT_EQ(value, 2);
+    ASSERT_EQ(map.count(), 1);
+}
+
+TEST_F(ConcurrentBTreeTest, Remove) {
+    for (uint32_t i = 0; i < 10'000; i++) {
+        ASSERT_EQ(map.insert(i, ValueOf(i)), OsStatusSuccess);
+    }
+
+    for (uint32_t i = 0; i < 10'000; i += 2) {
+        ASSERT_TRUE(map.remove(i));
+        ASSERT_FALSE(map.remove(i));
+    }
+
+    map.validate();
+    ASSERT_EQ(map.count(), 5'000);
+
+    for (uint32_t i = 0; i < 10'000; i++) {
+        ASSERT_EQ(map.contains(i), (i % 2) != 0) << "Key " << i;
+    }
+
+    // emptied leaves are reused by later inserts
+    for (uint32_t i = 0; i < 10'000; i += 2) {
+        ASSERT_EQ(map.insert(i, ValueOf(i)), OsStatusSuccess);
+    }
+
+    map.validate();
+    ASSERT_EQ(map.count(), 10'000);
+}
+
+TEST_F(ConcurrentBTreeTest, ConcurrentInsert) {
+    static constexpr size_t kThreadCount = 8;
+    static constexpr uint32_t kKeysPerThread = 20'000;
+
+    std::vector<std::jthread> threads;
+    for (size_t i = 0; i < kThreadCount; i++) {
+        threads.emplace_back([&, i] {
+            // interleave the keys so every thread contends for the same leaves
+            for (uint32_t j = 0; j < kKeysPerThread; j++) {
+                uint32_t key = (j * kThreadCount) + i;
+                EXPECT_EQ(map.insert(key, ValueOf(key)), OsStatusSuccess);
+            }
+        });
+    }
+
+    threads.clear();
+
+    map.validate();
+    ASSERT_EQ(map.count(), kThreadCount * kKeysPerThread);
+
+    for (uint32_t key = 0; key < kThreadCount * kKeysPerThread; key++) {
+        uint64_t value = 0;
+        ASSERT_TRUE(map.find(key, &value)) << "Key " << key << " not found";
+        ASSERT_EQ(value, ValueOf(key));
+    }
+}
+
+TEST_F(ConcurrentBTreeTest, ConcurrentReadWrite) {
+    static constexpr uint32_t kStableKeys = 10'000;
+    static constexpr size_t kReaderCount = 4;
+    static constexpr size_t kWriterCount = 4;
+
+    // even keys are never removed, readers must always find them
+    for (uint32_t i = 0; i < kStableKeys; i++) {
+        ASSERT_EQ(map.insert(i * 2, ValueOf(i * 2)), OsStatusSuccess);
+    }
+
+    std::atomic<bool> running = true;
+    std::atomic<size_t> errors = 0;
+    std::vector<std::jthread> threads;
+
+    for (size_t i = 0; i < kReaderCount; i++) {
+        threads.emplace_back([&, i] {
+            std::mt19937 mt(i);
+            std::uniform_int_distribution<uint32_t> dist(0, (kStableKeys * 2) - 1);
+            while (running) {
+                uint32_t key = dist(mt);
+                uint64_t value = 0;
+                bool found = map.find(key, &value);
+                if ((key % 2 == 0 && !found) || (found && value != ValueOf(key))) {
+                    errors += 1;
+                }
+            }
+        });
+    }
+
+    for (size_t i = 0; i < kWriterCount; i++) {
+        threads.emplace_back([&, i] {
+            std::mt19937 mt(i + kReaderCount);
+            std::uniform_int_distribution<uint32_t> dist(0, kStableKeys * 4);
+            for (size_t j = 0; j < 50'000; j++) {
+                uint32_t key = (dist(mt) * 2) + 1;
+                if (j % 3 == 0) {
+                    map.remove(key);
+                } else if (map.insert(key, ValueOf(key)) != OsStatusSuccess) {
+                    errors += 1;
+                }
+            }
+        });
+    }
+
+    for (size_t i = 0; i < kWriterCount; i++) {
+        threads.pop_back();
+    }
+
+    running = false;
+    threads.clear();
+
+    ASSERT_EQ(errors, 0);
+    map.validate();
+}
+
+TEST(ConcurrentBTreeAllocTest, OutOfMemory) {
+    struct FlakeyAllocator {
+        std::mt19937 *mt;
+
+        void *allocate(size_t size) {
+            return ((*mt)() % 8 == 0) ? nullptr : malloc(size);
+        }
+
+        void *allocateAligned(size_t size, size_t alignment) {
+            return ((*mt)() % 8 == 0) ? nullptr : aligned_alloc(alignment, size);
+        }
+
+        void deallocate(void *ptr, size_t) noexcept {
+            free(ptr);
+        }
+    };
+
+    using FlakeyMap = sm::ConcurrentBTreeMap<uint32_t, uint32_t, FlakeyAllocator>;
+
+    std::mt19937 mt{0x1234};
+    FlakeyMap map;
+    while (FlakeyMap::create(FlakeyAllocator{&mt}, &map) != OsStatusSuccess) { }
+
+    std::map<uint32_t, uint32_t> expected;
+    size_t oomCount = 0;
+
+    for (uint32_t i = 0; i < 50'000; i++) {
+        OsStatus status = map.insert(i, i * 10);
+        if (status == OsStatusSuccess) {
+            expected[i] = i * 10;
+        } else {
+            ASSERT_EQ(status, OsStatusOutOfMemory);
+            oomCount += 1;
+        }
+    }
+
+    ASSERT_NE(oomCount, 0);
+    map.validate();
+    ASSERT_EQ(map.count(), expected.size());
+
+    for (const auto& [key, value] : expected) {
+        uint32_t found = 0;
+        ASSERT_TRUE(map.find(key, &found)) << "Key " << key << " not found";
+        ASSERT_EQ(found, value);
+    }
+}
@@ -0,0 +1,125 @@
+#include <benchmark/benchmark.h>
+
+#include "std/container/btree.hpp"
+#include "std/container/concurrent_btree.hpp"
+#include "std/shared_spinlock.hpp"
+
+#include <random>
+
+[[noreturn]]
+void km::BugCheck(stdx::StringView, std::source_location) noexcept [[clang::nonblocking]] {
+    assert(false && "BugCheck called in benchmark");
+    __builtin_trap();
+}
+
+static constexpr uint32_t kKeyCount = 1024 * 256;
+
+/// @brief The single lock map that kernel users wrap around sm::BTreeMap today.
+struct LockedBTreeMap {
+    stdx::SharedSpinLock lock;
+    sm::BTreeMap<uint32_t, uint64_t> map;
+
+    bool find(uint32_t key, uint64_t *value) {
+        stdx::SharedLock guard(lock);
+        auto it = map.find(key);
+        if (it == map.end()) {
+            return false;
+        }
+
+        *value = (*it).second;
+        return true;
+    }
+
+    void insert(uint32_t key, uint64_t value) {
+        stdx::UniqueLock guard(lock);
+        (void)map.insert(key, value);
+    }
+};
+
+using ConcurrentMap = sm::ConcurrentBTreeMap<uint32_t, uint64_t>;
+
+static LockedBTreeMap *gLockedMap = nullptr;
+static ConcurrentMap *gConcurrentMap = nullptr;
+
+template<typename F>
+static void FillKeys(F&& insert) {
+    // even keys are present, odd keys are used for inserts during the benchmark
+    for (uint32_t i = 0; i < kKeyCount; i++) {
+        insert(i * 2, uint64_t(i));
+    }
+}
+
+// Setup and teardown run once per benchmark, outside of the worker threads.
+
+static void SetupLocked(const benchmark::State&) {
+    gLockedMap = new LockedBTreeMap();
+    FillKeys([](uint32_t key, uint64_t value) { gLockedMap->insert(key, value); });
+}
+
+static void SetupConcurrent(const benchmark::State&) {
+    gConcurrentMap = new ConcurrentMap();
+    (void)ConcurrentMap::create({}, gConcurrentMap);
+    FillKeys([](uint32_t key, uint64_t value) { (void)gConcurrentMap->insert(key, value); });
+}
+
+static void TeardownLocked(const benchmark::State&) {
+    delete gLockedMap;
+}
+
+static void TeardownConcurrent(const benchmark::State&) {
+    delete gConcurrentMap;
+}
+
+/// @brief Run a mix of lookups and inserts, @p writePercent of operations are inserts.
+template<typename Map>
+static void RunWorkload(benchmark::State& state, Map *map, uint32_t writePercent) {
+    std::mt19937 mt(state.thread_index());
+    std::uniform_int_distribution<uint32_t> keys(0, (kKeyCount * 2) - 1);
+    std::uniform_int_distribution<uint32_t> ops(0, 99);
+
+    for (auto _ : state) {
+        uint32_t key = keys(mt);
+        if (ops(mt) < writePercent) {
+            (void)map->insert(key | 1, uint64_t(key));
+        } else {
+            uint64_t value = 0;
+            bool found = map->find(key, &value);
+            benchmark::DoNotOptimize(found);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_LockedBTreeLookup(benchmark::State& state) {
+    RunWorkload(state, gLockedMap, 0);
+}
+
+static void BM_ConcurrentBTreeLookup(benchmark::State& state) {
+    RunWorkload(state, gConcurrentMap, 0);
+}
+
+static void BM_LockedBTreeMixed(benchmark::State& state) {
+    RunWorkload(state, gLockedMap, 10);
+}
+
+static void BM_ConcurrentBTreeMixed(benchmark::State& state) {
+    RunWorkload(state, gConcurrentMap, 10);
+}
+
+BENCHMARK(BM_LockedBTreeLookup)
+    ->Setup(SetupLocked)->Teardown(TeardownLocked)
+    ->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK(BM_ConcurrentBTreeLookup)
+    ->Setup(SetupConcurrent)->Teardown(TeardownConcurrent)
+    ->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK(BM_LockedBTreeMixed)
+    ->Setup(SetupLocked)->Teardown(TeardownLocked)
+    ->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK(BM_ConcurrentBTreeMixed)
+    ->Setup(SetupConcurrent)->Teardown(TeardownConcurrent)
+    ->ThreadRange(1, 16)->UseRealTime();
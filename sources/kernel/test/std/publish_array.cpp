@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include "std/publish_array.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(PublishArrayTest, Empty) {
+    stdx::PublishArray<int, 4> array;
+    ASSERT_EQ(array.count(), 0);
+    ASSERT_TRUE(array.entries().empty());
+}
+
+TEST(PublishArrayTest, AddInOrder) {
+    stdx::PublishArray<int, 4> array;
+
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(array.add(i * 10), OsStatusSuccess);
+    }
+
+    ASSERT_EQ(array.count(), 4);
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(array.entries()[i], i * 10);
+    }
+}
+
+TEST(PublishArrayTest, Full) {
+    stdx::PublishArray<int, 2> array;
+    ASSERT_EQ(array.add(1), OsStatusSuccess);
+    ASSERT_EQ(array.add(2), OsStatusSuccess);
+
+    // entries that do not fit are dropped and never published
+    ASSERT_EQ(array.add(3), OsStatusOutOfMemory);
+    ASSERT_EQ(array.add(4), OsStatusOutOfMemory);
+    ASSERT_EQ(array.count(), 2);
+}
+
+TEST(PublishArrayTest, ConcurrentAdd) {
+    static constexpr int kThreads = 8;
+    static constexpr int kPerThread = 64;
+
+    stdx::PublishArray<int, kThreads * kPerThread> array;
+    std::atomic<bool> done = false;
+    std::atomic<size_t> unwritten = 0;
+
+    //
+    // Entries start at 1, so a reader that sees a zero saw a slot that was
+    // reserved but not yet written.
+    //
+    std::thread reader([&] {
+        while (!done) {
+            for (int entry : array.entries()) {
+                if (entry == 0) {
+                    unwritten += 1;
+                }
+            }
+        }
+    });
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < kThreads; t++) {
+        writers.emplace_back([&, t] {
+            for (int i = 0; i < kPerThread; i++) {
+                ASSERT_EQ(array.add((t * kPerThread) + i + 1), OsStatusSuccess);
+            }
+        });
+    }
+
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+
+    done = true;
+    reader.join();
+
+    ASSERT_EQ(unwritten, 0);
+    ASSERT_EQ(array.count(), kThreads * kPerThread);
+
+    std::vector<int> entries(array.entries().begin(), array.entries().end());
+    std::sort(entries.begin(), entries.end());
+    for (int i = 0; i < kThreads * kPerThread; i++) {
+        ASSERT_EQ(entries[i], i + 1);
+    }
+}
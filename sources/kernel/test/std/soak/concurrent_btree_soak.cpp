@@ -0,0 +1,96 @@
+#include "std/container/concurrent_btree.hpp"
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <cassert>
+#include <cstdio>
+
+static uint64_t ValueOf(uint32_t key) {
+    return (uint64_t(key) << 32) | ~key;
+}
+
+int main() {
+    static constexpr size_t kReaderCount = 8;
+    static constexpr size_t kWriterCount = 8;
+    static constexpr uint32_t kStableKeys = 1024 * 64;
+    static constexpr uint32_t kKeySpace = 1024 * 1024;
+    static constexpr auto kDuration = std::chrono::seconds(30);
+
+    sm::ConcurrentBTreeMap<uint32_t, uint64_t> map;
+    if (OsStatus status = decltype(map)::create({}, &map)) {
+        fprintf(stderr, "Failed to create map: %d\n", int(status));
+        return 1;
+    }
+
+    // keys that are a multiple of 4 are inserted up front and never removed
+    for (uint32_t i = 0; i < kStableKeys; i++) {
+        OsStatus status = map.insert(i * 4, ValueOf(i * 4));
+        assert(status == OsStatusSuccess);
+    }
+
+    std::atomic<bool> running = true;
+    std::atomic<size_t> errors = 0;
+    std::atomic<size_t> reads = 0;
+    std::atomic<size_t> writes = 0;
+
+    {
+        std::vector<std::jthread> threads;
+
+        for (size_t i = 0; i < kReaderCount; i++) {
+            threads.emplace_back([&, i] {
+                std::mt19937 mt(i);
+                std::uniform_int_distribution<uint32_t> dist(0, kKeySpace - 1);
+                size_t count = 0;
+                while (running) {
+                    uint32_t key = dist(mt);
+                    uint64_t value = 0;
+                    bool found = map.find(key, &value);
+                    bool stable = (key % 4 == 0) && (key / 4) < kStableKeys;
+                    if ((stable && !found) || (found && value != ValueOf(key))) {
+                        errors += 1;
+                    }
+
+                    count += 1;
+                }
+
+                reads += count;
+            });
+        }
+
+        for (size_t i = 0; i < kWriterCount; i++) {
+            threads.emplace_back([&, i] {
+                std::mt19937 mt(i + kReaderCount);
+                std::uniform_int_distribution<uint32_t> dist(0, kKeySpace - 1);
+                size_t count = 0;
+                while (running) {
+                    // never touch the stable keys
+                    uint32_t key = dist(mt) | 1;
+                    if (mt() % 2 == 0) {
+                        if (map.insert(key, ValueOf(key)) != OsStatusSuccess) {
+                            errors += 1;
+                        }
+                    } else {
+                        map.remove(key);
+                    }
+
+                    count += 1;
+                }
+
+                writes += count;
+            });
+        }
+
+        std::this_thread::sleep_for(kDuration);
+        running = false;
+    }
+
+    map.validate();
+
+    printf("reads: %zu, writes: %zu, errors: %zu, entries: %zu\n",
+           reads.load(), writes.load(), errors.load(), map.count());
+
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include "syscall_stats.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(SyscallStatsTest, LatencyBuckets) {
+    ASSERT_EQ(km::SyscallLatencyBucket(0), 0);
+    ASSERT_EQ(km::SyscallLatencyBucket(1), 1);
+    ASSERT_EQ(km::SyscallLatencyBucket(2), 2);
+    ASSERT_EQ(km::SyscallLatencyBucket(3), 2);
+    ASSERT_EQ(km::SyscallLatencyBucket(4), 3);
+    ASSERT_EQ(km::SyscallLatencyBucket(1000), 10);
+    ASSERT_EQ(km::SyscallLatencyBucket(1024), 11);
+
+    // everything too long for the histogram lands in the last bucket
+    ASSERT_EQ(km::SyscallLatencyBucket(UINT64_C(1) << 40), km::kSyscallLatencyBuckets - 1);
+    ASSERT_EQ(km::SyscallLatencyBucket(UINT64_MAX), km::kSyscallLatencyBuckets - 1);
+}
+
+TEST(SyscallStatsTest, SummaryOfNothing) {
+    km::SyscallStats stats;
+
+    km::SyscallSummary summary;
+    stats.summary(0x10, &summary);
+
+    ASSERT_EQ(summary.calls, 0);
+    ASSERT_EQ(summary.errors, 0);
+    ASSERT_EQ(summary.ticks, 0);
+}
+
+TEST(SyscallStatsTest, SumsEveryCpu) {
+    km::SyscallStats stats;
+    auto cpu0 = std::make_unique<km::SyscallCounters>();
+    auto cpu1 = std::make_unique<km::SyscallCounters>();
+
+    ASSERT_EQ(stats.addCpu(cpu0.get()), OsStatusSuccess);
+    ASSERT_EQ(stats.addCpu(cpu1.get()), OsStatusSuccess);
+    ASSERT_EQ(stats.cpuCount(), 2);
+
+    cpu0->record(0x10, OsStatusSuccess, 100);
+    cpu0->record(0x10, OsStatusNotFound, 3);
+    cpu1->record(0x10, OsStatusSuccess, 100);
+    cpu1->record(0x20, OsStatusSuccess, 0);
+
+    km::SyscallSummary summary;
+    stats.summary(0x10, &summary);
+
+    ASSERT_EQ(summary.calls, 3);
+    ASSERT_EQ(summary.errors, 1);
+    ASSERT_EQ(summary.ticks, 203);
+    ASSERT_EQ(summary.latency[km::SyscallLatencyBucket(100)], 2);
+    ASSERT_EQ(summary.latency[km::SyscallLatencyBucket(3)], 1);
+
+    stats.summary(0x20, &summary);
+    ASSERT_EQ(summary.calls, 1);
+    ASSERT_EQ(summary.latency[0], 1);
+
+    stats.summary(0x30, &summary);
+    ASSERT_EQ(summary.calls, 0);
+}
+
+TEST(SyscallStatsTest, TooManyCpus) {
+    auto stats = std::make_unique<km::SyscallStats>();
+    km::SyscallCounters counters;
+
+    for (size_t i = 0; i < km::kMaxSyscallStatsCpus; i++) {
+        ASSERT_EQ(stats->addCpu(&counters), OsStatusSuccess);
+    }
+
+    ASSERT_EQ(stats->addCpu(&counters), OsStatusOutOfMemory);
+    ASSERT_EQ(stats->cpuCount(), km::kMaxSyscallStatsCpus);
+}
+
+TEST(SyscallStatsTest, ReadWhileRecording) {
+    static constexpr size_t kWriters = 4;
+    static constexpr uint64_t kCalls = 100'000;
+
+    km::SyscallStats stats;
+    std::unique_ptr<km::SyscallCounters> counters[kWriters];
+    for (auto& cpu : counters) {
+        cpu = std::make_unique<km::SyscallCounters>();
+        ASSERT_EQ(stats.addCpu(cpu.get()), OsStatusSuccess);
+    }
+
+    std::atomic<bool> done = false;
+    std::jthread reader([&] {
+        uint64_t last = 0;
+        while (!done.load()) {
+            km::SyscallSummary summary;
+            stats.summary(0x42, &summary);
+
+            // each writer only counts up, so the total never goes backwards
+            ASSERT_GE(summary.calls, last);
+            ASSERT_LE(summary.calls, kWriters * kCalls);
+            last = summary.calls;
+        }
+    });
+
+    {
+        std::vector<std::jthread> writers;
+        for (auto& cpu : counters) {
+            writers.emplace_back([&cpu] {
+                for (uint64_t i = 0; i < kCalls; i++) {
+                    cpu->record(0x42, (i % 10 == 0) ? OsStatusInvalidInput : OsStatusSuccess, i % 64);
+                }
+            });
+        }
+    }
+
+    done = true;
+    reader.join();
+
+    km::SyscallSummary summary;
+    stats.summary(0x42, &summary);
+    ASSERT_EQ(summary.calls, kWriters * kCalls);
+    ASSERT_EQ(summary.errors, kWriters * kCalls / 10);
+
+    uint64_t histogram = 0;
+    for (uint64_t count : summary.latency) {
+        histogram += count;
+    }
+
+    ASSERT_EQ(histogram, summary.calls);
+}
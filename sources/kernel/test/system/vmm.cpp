@@ -208,6 +208,107 @@ TEST_F(AddressSpaceManagerTest, Allocate) {
     AssertStats0(0, 0);
 }
 
+TEST_F(AddressSpaceManagerTest, AllocateLargePages) {
+    OsStatus status = OsStatusSuccess;
+    km::AddressMapping mapping;
+
+    status = asManager0.map(&memory, x64::kLargePageSize * 2, x64::kPageSize, km::PageFlags::eUserAll, km::MemoryType::eWriteBack, &mapping);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    //
+    // Large allocations are placed on 2m boundaries in both address spaces and mapped with large pages.
+    //
+    ASSERT_EQ((uintptr_t)mapping.vaddr % x64::kLargePageSize, 0);
+    ASSERT_EQ(mapping.paddr.address % x64::kLargePageSize, 0);
+
+    km::PageTables& pt = asManager0.getPageTables();
+    ASSERT_EQ(pt.getPageSize(mapping.vaddr), km::PageSize::eLarge);
+    ASSERT_EQ(pt.getPageSize((void*)((uintptr_t)mapping.vaddr + x64::kLargePageSize)), km::PageSize::eLarge);
+
+    //
+    // Changing the protection of part of a large page splits only that page.
+    //
+    km::VirtualRange head { mapping.vaddr, (void*)((uintptr_t)mapping.vaddr + x64::kPageSize) };
+    status = asManager0.protect(head, km::PageFlags::eUserData);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    ASSERT_EQ(pt.getPageSize(mapping.vaddr), km::PageSize::eRegular);
+    ASSERT_EQ(pt.getMemoryFlags(mapping.vaddr), km::PageFlags::eUserData);
+
+    const void *rest = (void*)((uintptr_t)mapping.vaddr + x64::kPageSize);
+    ASSERT_EQ(pt.getPageSize(rest), km::PageSize::eRegular);
+    ASSERT_EQ(pt.getMemoryFlags(rest), km::PageFlags::eUserAll);
+    ASSERT_EQ(pt.getBackingAddress(rest).address, mapping.paddr.address + x64::kPageSize);
+
+    const void *second = (void*)((uintptr_t)mapping.vaddr + x64::kLargePageSize);
+    ASSERT_EQ(pt.getPageSize(second), km::PageSize::eLarge);
+    ASSERT_EQ(pt.getMemoryFlags(second), km::PageFlags::eUserAll);
+
+    status = asManager0.unmap(&memory, mapping.virtualRange());
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    AssertStats0(0, 0);
+}
+
+TEST_F(AddressSpaceManagerTest, ProtectSpansSegments) {
+    OsStatus status = OsStatusSuccess;
+    km::MemoryRange lo, hi;
+    km::AddressMapping loMapping, hiMapping;
+
+    status = memory.allocate(0x4000, x64::kPageSize, &lo);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    status = memory.allocate(0x4000, x64::kPageSize, &hi);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    sm::VirtualAddress base = sm::gigabytes(2).bytes();
+    status = asManager0.map(&memory, base, lo, km::PageFlags::eUserAll, km::MemoryType::eWriteBack, &loMapping);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    status = asManager0.map(&memory, base + 0x4000, hi, km::PageFlags::eUserAll, km::MemoryType::eWriteBack, &hiMapping);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    km::PageTables& pt = asManager0.getPageTables();
+
+    //
+    // A range that straddles both segments updates every page in both.
+    //
+    km::VirtualRange both { (void*)(base.address + 0x2000), (void*)(base.address + 0x6000) };
+    status = asManager0.protect(both, km::PageFlags::eUserData);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    ASSERT_EQ(pt.getMemoryFlags((void*)(base.address + 0x1000)), km::PageFlags::eUserAll);
+    ASSERT_EQ(pt.getMemoryFlags((void*)(base.address + 0x2000)), km::PageFlags::eUserData);
+    ASSERT_EQ(pt.getMemoryFlags((void*)(base.address + 0x5000)), km::PageFlags::eUserData);
+    ASSERT_EQ(pt.getMemoryFlags((void*)(base.address + 0x6000)), km::PageFlags::eUserAll);
+
+    //
+    // A range that runs past the last segment is rejected without changing anything.
+    //
+    km::VirtualRange beyond { (void*)(base.address + 0x6000), (void*)(base.address + 0x9000) };
+    status = asManager0.protect(beyond, km::PageFlags::eUserData);
+    ASSERT_EQ(status, OsStatusNotFound);
+
+    ASSERT_EQ(pt.getMemoryFlags((void*)(base.address + 0x7000)), km::PageFlags::eUserAll);
+
+    //
+    // As is a range that starts before the first segment.
+    //
+    km::VirtualRange before { (void*)(base.address - 0x1000), (void*)(base.address + 0x1000) };
+    status = asManager0.protect(before, km::PageFlags::eUserData);
+    ASSERT_EQ(status, OsStatusNotFound);
+
+    ASSERT_EQ(pt.getMemoryFlags((void*)base.address), km::PageFlags::eUserAll);
+
+    status = asManager0.unmap(&memory, loMapping.virtualRange());
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    status = asManager0.unmap(&memory, hiMapping.virtualRange());
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    AssertStats0(0, 0);
+}
+
 TEST_F(AddressSpaceManagerTest, UnmapMiddle) {
     OsStatus status = OsStatusSuccess;
     km::AddressMapping mapping;
@@ -693,6 +794,178 @@ TEST_F(AddressSpaceManagerTest, MapRemote) {
     ASSERT_EQ(seg1.range(), range1);
 }
 
+TEST_F(AddressSpaceManagerTest, MapExternalFixed) {
+    OsStatus status = OsStatusSuccess;
+
+    //
+    // Shared pages such as the clock page are owned by the system and mapped at
+    // a fixed address, the address space reserves the range but never releases
+    // the memory.
+    //
+    km::MemoryRange page { 0x1000, 0x2000 };
+    sm::VirtualAddress address = kTestRange.back.address - x64::kPageSize;
+    km::AddressMapping mapping;
+
+    status = asManager0.mapExternal(&memory, address, page, km::PageFlags::eRead | km::PageFlags::eUser, km::MemoryType::eWriteBack, &mapping);
+    ASSERT_EQ(status, OsStatusSuccess);
+    ASSERT_EQ(mapping.vaddr, (const void*)address);
+    ASSERT_EQ(mapping.paddr.address, page.front.address);
+
+    AssertVirtualFound0(mapping.virtualRange(), km::MemoryRangeEx{});
+    AssertStats0(1, x64::kPageSize);
+    AssertMemory(0, 0);
+
+    km::PageTables& pt = asManager0.getPageTables();
+    ASSERT_EQ(pt.getBackingAddress(mapping.vaddr).address, page.front.address);
+    ASSERT_EQ(pt.getMemoryFlags(mapping.vaddr), km::PageFlags::eRead | km::PageFlags::eUser);
+
+    //
+    // The reserved address is not handed out again.
+    //
+    km::AddressMapping other;
+    status = asManager0.allocateVirtual(page, address, x64::kPageSize, x64::kPageSize, false, km::PageFlags::eUserAll, &other);
+    ASSERT_NE(status, OsStatusSuccess);
+
+    status = asManager0.unmap(&memory, mapping.virtualRange());
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    AssertVirtualNotFound0(address);
+    AssertStats0(0, 0);
+    AssertMemory(0, 0);
+}
+
+TEST_F(AddressSpaceManagerTest, UnmapExternalPartial) {
+    OsStatus status = OsStatusSuccess;
+
+    //
+    // External memory is not owned by the memory manager, splitting it must
+    // neither release anything nor invent backing memory for the pieces.
+    //
+    km::MemoryRange external { 0x100000, 0x105000 };
+    km::AddressMapping mapping;
+
+    status = asManager0.mapExternal(external, km::PageFlags::eUserAll, km::MemoryType::eWriteBack, &mapping);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    uintptr_t base = (uintptr_t)mapping.vaddr;
+    auto page = [&](size_t index) { return (const void*)(base + (index * x64::kPageSize)); };
+    auto pages = [&](size_t front, size_t back) { return km::VirtualRange { page(front), page(back) }; };
+
+    km::PageTables& pt = asManager0.getPageTables();
+
+    // |-unmap-|-------|-------|-------|-------|
+    status = asManager0.unmap(&memory, pages(0, 1));
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    AssertVirtualNotFound0(page(0));
+    AssertVirtualFound0(pages(1, 5), km::MemoryRangeEx{});
+    AssertStats0(1, 4 * x64::kPageSize);
+
+    //         |-------|-unmap-|-------|-------|
+    status = asManager0.unmap(&memory, pages(2, 3));
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    AssertVirtualFound0(pages(1, 2), km::MemoryRangeEx{});
+    AssertVirtualNotFound0(page(2));
+    AssertVirtualFound0(pages(3, 5), km::MemoryRangeEx{});
+    AssertStats0(2, 3 * x64::kPageSize);
+
+    //                         |-------|-unmap-|
+    status = asManager0.unmap(&memory, pages(4, 5));
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    AssertVirtualFound0(pages(3, 4), km::MemoryRangeEx{});
+    AssertStats0(2, 2 * x64::kPageSize);
+
+    // The pages that are left still map the same external memory.
+    ASSERT_EQ(pt.getBackingAddress(page(1)).address, external.front.address + x64::kPageSize);
+    ASSERT_EQ(pt.getBackingAddress(page(3)).address, external.front.address + (3 * x64::kPageSize));
+
+    status = asManager0.unmap(&memory, pages(1, 4));
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    AssertStats0(0, 0);
+    AssertMemory(0, 0);
+}
+
+TEST_F(AddressSpaceManagerTest, MapExternalTail) {
+    OsStatus status = OsStatusSuccess;
+    km::MemoryRange external { 0x100000, 0x103000 };
+    km::MemoryRange tail;
+
+    status = memory.allocate(x64::kPageSize, x64::kPageSize, &tail);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    km::VirtualRange range;
+    status = asManager0.mapExternal(&memory, nullptr, external, tail, km::PageFlags::eUserAll, km::MemoryType::eWriteBack, &range);
+    ASSERT_EQ(status, OsStatusSuccess);
+    ASSERT_EQ(range.size(), external.size() + tail.size());
+
+    //
+    // The external pages and the private tail are contiguous, only the tail
+    // is owned by the address space.
+    //
+    const void *last = (const void*)((uintptr_t)range.back - x64::kPageSize);
+    AssertVirtualFound0(km::VirtualRange { range.front, last }, km::MemoryRangeEx{});
+    AssertVirtualFound0(km::VirtualRange { last, range.back }, tail.cast<km::PhysicalAddressEx>());
+    AssertStats0(2, range.size());
+    AssertMemory(1, x64::kPageSize);
+
+    km::PageTables& pt = asManager0.getPageTables();
+    ASSERT_EQ(pt.getBackingAddress(range.front).address, external.front.address);
+    ASSERT_EQ(pt.getBackingAddress(last).address, tail.front.address);
+
+    status = asManager0.unmap(&memory, range);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    AssertStats0(0, 0);
+    AssertMemory(0, 0);
+}
+
+TEST_F(AddressSpaceManagerTest, MapRemoteRejectsExternal) {
+    OsStatus status = OsStatusSuccess;
+    km::MemoryRange lo, hi;
+    km::AddressMapping loMapping, midMapping, hiMapping;
+
+    status = memory.allocate(x64::kPageSize, x64::kPageSize, &lo);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    status = memory.allocate(x64::kPageSize, x64::kPageSize, &hi);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    //
+    // |--lo--|--external--|--hi--|
+    //
+    sm::VirtualAddress base = sm::gigabytes(2).bytes();
+    status = asManager0.map(&memory, base, lo, km::PageFlags::eUserAll, km::MemoryType::eWriteBack, &loMapping);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    status = asManager0.mapExternal(&memory, base + x64::kPageSize, km::MemoryRange { 0x100000, 0x101000 }, km::PageFlags::eUserAll, km::MemoryType::eWriteBack, &midMapping);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    status = asManager0.map(&memory, base + (2 * x64::kPageSize), hi, km::PageFlags::eUserAll, km::MemoryType::eWriteBack, &hiMapping);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    AssertStats0(3, 3 * x64::kPageSize);
+
+    //
+    // The external segment is neither end of the range, it must still be found.
+    //
+    km::VirtualRange all { loMapping.vaddr, hiMapping.virtualRange().back };
+    km::VirtualRange result;
+    status = asManager1.map(&memory, &asManager0, all, km::PageFlags::eUserAll, km::MemoryType::eWriteBack, &result);
+    ASSERT_EQ(status, OsStatusNotSupported);
+
+    AssertStats1(0, 0);
+    AssertMemory(2, 2 * x64::kPageSize);
+
+    status = asManager0.unmap(&memory, all);
+    ASSERT_EQ(status, OsStatusSuccess);
+
+    AssertStats0(0, 0);
+    AssertMemory(0, 0);
+}
+
 class AddressSpaceMapManyTest : public AddressSpaceManagerTest {
 public:
     void SetUp() override {
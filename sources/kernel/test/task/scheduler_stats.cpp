@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include "task/scheduler_queue.hpp"
+
+#include <numeric>
+
+class SchedulerStatsTest : public testing::Test {
+public:
+    void SetUp() override {
+        OsStatus status = task::SchedulerQueue::create(64, &queue);
+        ASSERT_EQ(status, OsStatusSuccess);
+    }
+
+    task::SchedulerQueue queue;
+
+    void enqueue(task::SchedulerEntry *entry) {
+        OsStatus status = queue.enqueue(task::TaskState{}, entry);
+        ASSERT_EQ(status, OsStatusSuccess);
+    }
+
+    task::ScheduleResult reschedule() {
+        task::TaskState state{};
+        return queue.reschedule(&state);
+    }
+
+    static uint64_t totalWaits(const task::QueueStats& stats) {
+        return std::accumulate(std::begin(stats.wait), std::end(stats.wait), uint64_t(0));
+    }
+};
+
+TEST(SchedulerStatsBucketTest, Buckets) {
+    ASSERT_EQ(task::RunQueueWaitBucket(0), 0);
+    ASSERT_EQ(task::RunQueueWaitBucket(1), 1);
+    ASSERT_EQ(task::RunQueueWaitBucket(2), 2);
+    ASSERT_EQ(task::RunQueueWaitBucket(3), 2);
+    ASSERT_EQ(task::RunQueueWaitBucket(4), 3);
+    ASSERT_EQ(task::RunQueueWaitBucket(UINT64_MAX), task::kRunQueueWaitBuckets - 1);
+}
+
+TEST_F(SchedulerStatsTest, Empty) {
+    task::QueueStats stats = queue.getStats();
+    ASSERT_EQ(stats.switches, 0);
+    ASSERT_EQ(stats.preemptions, 0);
+    ASSERT_EQ(stats.idle, 0);
+    ASSERT_EQ(stats.samples, 0);
+    ASSERT_EQ(totalWaits(stats), 0);
+}
+
+TEST_F(SchedulerStatsTest, Idle) {
+    ASSERT_EQ(reschedule(), task::ScheduleResult::eIdle);
+    ASSERT_EQ(reschedule(), task::ScheduleResult::eIdle);
+
+    task::QueueStats stats = queue.getStats();
+    ASSERT_EQ(stats.switches, 0);
+    ASSERT_EQ(stats.idle, 2);
+    ASSERT_EQ(stats.samples, 2);
+    ASSERT_EQ(stats.lengthTotal, 0);
+    ASSERT_EQ(stats.lengthMax, 0);
+}
+
+TEST_F(SchedulerStatsTest, Preemption) {
+    task::SchedulerEntry task0;
+    task::SchedulerEntry task1;
+
+    enqueue(&task0);
+    enqueue(&task1);
+
+    // task0 runs, then task1 preempts it, then task0 preempts task1
+    ASSERT_EQ(reschedule(), task::ScheduleResult::eResume);
+    ASSERT_EQ(queue.getCurrentTask(), &task0);
+    ASSERT_EQ(reschedule(), task::ScheduleResult::eResume);
+    ASSERT_EQ(queue.getCurrentTask(), &task1);
+    ASSERT_EQ(reschedule(), task::ScheduleResult::eResume);
+    ASSERT_EQ(queue.getCurrentTask(), &task0);
+
+    task::QueueStats stats = queue.getStats();
+    ASSERT_EQ(stats.switches, 3);
+    ASSERT_EQ(stats.preemptions, 2);
+    ASSERT_EQ(stats.idle, 0);
+    ASSERT_EQ(stats.samples, 3);
+    ASSERT_EQ(stats.lengthMax, 2);
+    ASSERT_EQ(stats.lengthTotal, 2 + 1 + 1);
+    ASSERT_EQ(totalWaits(stats), 3);
+
+    task::TaskStats stats0 = task0.getStats();
+    ASSERT_EQ(stats0.switches, 2);
+    ASSERT_EQ(stats0.preemptions, 1);
+
+    task::TaskStats stats1 = task1.getStats();
+    ASSERT_EQ(stats1.switches, 1);
+    ASSERT_EQ(stats1.preemptions, 1);
+
+    // task1 waited for task0 to be switched out before it could run
+    ASSERT_GT(stats1.waitTicks, 0);
+    ASSERT_EQ(stats.runTicks, stats0.runTicks + stats1.runTicks);
+}
+
+TEST_F(SchedulerStatsTest, Yield) {
+    task::SchedulerEntry task0;
+    task::SchedulerEntry task1;
+
+    enqueue(&task0);
+    enqueue(&task1);
+
+    ASSERT_EQ(reschedule(), task::ScheduleResult::eResume);
+    ASSERT_EQ(queue.getCurrentTask(), &task0);
+
+    // yielding gives up the cpu while still runnable, which is not a preemption
+    task::TaskState state{};
+    ASSERT_EQ(queue.reschedule(&state, task::ScheduleReason::eYield), task::ScheduleResult::eResume);
+    ASSERT_EQ(queue.getCurrentTask(), &task1);
+
+    // the yielded task is still queued and preempts task1 on the next tick
+    ASSERT_EQ(reschedule(), task::ScheduleResult::eResume);
+    ASSERT_EQ(queue.getCurrentTask(), &task0);
+
+    task::QueueStats stats = queue.getStats();
+    ASSERT_EQ(stats.switches, 3);
+    ASSERT_EQ(stats.preemptions, 1);
+
+    task::TaskStats stats0 = task0.getStats();
+    ASSERT_EQ(stats0.switches, 2);
+    ASSERT_EQ(stats0.preemptions, 0);
+
+    task::TaskStats stats1 = task1.getStats();
+    ASSERT_EQ(stats1.switches, 1);
+    ASSERT_EQ(stats1.preemptions, 1);
+}
+
+TEST_F(SchedulerStatsTest, Voluntary) {
+    task::SchedulerEntry task0;
+
+    enqueue(&task0);
+
+    ASSERT_EQ(reschedule(), task::ScheduleResult::eResume);
+    ASSERT_EQ(queue.getCurrentTask(), &task0);
+
+    // the only task stays on the cpu without a switch
+    ASSERT_EQ(reschedule(), task::ScheduleResult::eResume);
+
+    // sleeping gives up the cpu, which is not a preemption
+    ASSERT_TRUE(task0.sleep(km::os_instant::max()));
+    ASSERT_EQ(reschedule(), task::ScheduleResult::eIdle);
+    ASSERT_EQ(queue.getCurrentTask(), nullptr);
+
+    task::QueueStats stats = queue.getStats();
+    ASSERT_EQ(stats.switches, 1);
+    ASSERT_EQ(stats.preemptions, 0);
+    ASSERT_EQ(stats.idle, 1);
+    ASSERT_EQ(stats.samples, 3);
+
+    task::TaskStats stats0 = task0.getStats();
+    ASSERT_EQ(stats0.switches, 1);
+    ASSERT_EQ(stats0.preemptions, 0);
+    ASSERT_EQ(stats.runTicks, stats0.runTicks);
+}
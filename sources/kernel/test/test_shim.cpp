@@ -12,6 +12,7 @@
 #include "absl/hash/internal/low_level_hash.cc"
 #include "absl/container/internal/raw_hash_set.cc"
 #include "processor.hpp"
+#include "memory/numa.hpp"
 
 void KmIdle() {
     while (1) { }
@@ -52,3 +53,13 @@ void absl::raw_log_internal::RawLog(absl::LogSeverity, const char *file, int lin
 km::CpuCoreId km::GetCurrentCoreId() noexcept [[clang::reentrant]] {
     return km::CpuCoreId(0);
 }
+
+static thread_local km::NumaNodeId gCurrentNumaNode = km::NumaNodeId(0);
+
+km::NumaNodeId km::GetCurrentNumaNode() noexcept [[clang::reentrant]] {
+    return gCurrentNumaNode;
+}
+
+void km::SetCurrentNumaNode(NumaNodeId node) noexcept {
+    gCurrentNumaNode = node;
+}
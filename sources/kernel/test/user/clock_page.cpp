@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <bezos/clock_page.h>
+
+static OsClockPage MakePage(uint64_t frequency, OsTickCounter baseTicks, OsInstant baseTime) {
+    OsClockPage page {
+        .Flags = OS_CLOCK_PAGE_TSC,
+        .FrequencyHz = frequency,
+        .BaseTicks = baseTicks,
+        .BaseTime = baseTime,
+    };
+
+    OsClockPageScale(frequency, &page.Multiplier, &page.Shift);
+    return page;
+}
+
+/// @brief The exact conversion the clock page approximates.
+static OsInstant ExactInstant(const OsClockPage& page, OsTickCounter ticks) {
+    unsigned __int128 elapsed = ticks - page.BaseTicks;
+    return page.BaseTime + OsInstant((elapsed * 10000000) / page.FrequencyHz);
+}
+
+class ClockPageScaleTest : public testing::TestWithParam<uint64_t> { };
+
+INSTANTIATE_TEST_SUITE_P(Frequencies, ClockPageScaleTest, testing::Values(
+    1193182,        // pit
+    14318180,       // hpet
+    10000000,       // exactly one tick per interval
+    1000000000,
+    2400000000,
+    3696000000,
+    5000000000
+));
+
+TEST_P(ClockPageScaleTest, MatchesExact) {
+    uint64_t frequency = GetParam();
+    OsClockPage page = MakePage(frequency, 1234, 5678);
+
+    // From the base up to a year of uptime.
+    uint64_t year = frequency * 60 * 60 * 24 * 365;
+    for (uint64_t elapsed : { uint64_t(0), uint64_t(1), frequency / 3, frequency, frequency * 60 * 60, year }) {
+        OsTickCounter ticks = page.BaseTicks + elapsed;
+        OsInstant exact = ExactInstant(page, ticks);
+        OsInstant fast = OsClockPageInstant(&page, ticks);
+
+        // The truncated multiplier can only make the result smaller.
+        ASSERT_LE(fast, exact) << "elapsed " << elapsed;
+        ASSERT_LE(exact - fast, 1) << "elapsed " << elapsed;
+    }
+}
+
+TEST_P(ClockPageScaleTest, Monotonic) {
+    uint64_t frequency = GetParam();
+    OsClockPage page = MakePage(frequency, 0, 0);
+
+    OsInstant last = 0;
+    for (OsTickCounter ticks = 0; ticks < 100000; ticks += 7) {
+        OsInstant now = OsClockPageInstant(&page, ticks);
+        ASSERT_GE(now, last);
+        last = now;
+    }
+}
@@ -0,0 +1,568 @@
+#include <gtest/gtest.h>
+
+#include "rtld/load/hash.hpp"
+#include "rtld/load/link.hpp"
+
+#include <link.h>
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace elf = os::elf;
+
+/// @brief Builds the dynamic symbol table and hash tables the way a linker would.
+struct TestSymbolTable {
+    std::vector<elf::Symbol> symbols;
+    std::string strtab;
+    std::vector<uint64_t> gnuHash;
+    std::vector<uint32_t> sysvHash;
+
+    static constexpr uint16_t kTextSection = 1;
+
+    TestSymbolTable(std::vector<std::string> names, uint32_t bucketCount, uint32_t bloomSize, uint32_t bloomShift = 6) {
+        // The gnu hash table requires the hashed symbols to be sorted by bucket.
+        std::stable_sort(names.begin(), names.end(), [&](const std::string& lhs, const std::string& rhs) {
+            return hash(lhs) % bucketCount < hash(rhs) % bucketCount;
+        });
+
+        strtab.push_back('\0');
+        symbols.push_back(elf::Symbol { });
+
+        for (size_t i = 0; i < names.size(); i++) {
+            elf::Symbol symbol {
+                .name = uint32_t(strtab.size()),
+                .info = uint8_t(uint8_t(elf::SymbolBinding::eGlobal) << 4),
+                .shndx = kTextSection,
+                .value = 0x1000 + i * 0x10,
+                .size = 0x10,
+            };
+            symbols.push_back(symbol);
+            strtab += names[i];
+            strtab.push_back('\0');
+        }
+
+        buildGnuHash(bucketCount, bloomSize, bloomShift);
+        buildSysvHash(bucketCount);
+    }
+
+    static uint32_t hash(const std::string& name) {
+        return elf::GnuHash(name.data(), name.data() + name.size());
+    }
+
+    void buildGnuHash(uint32_t bucketCount, uint32_t bloomSize, uint32_t bloomShift) {
+        static constexpr uint32_t kSymbolOffset = 1;
+        std::vector<uint32_t> words;
+
+        words.push_back(bucketCount);
+        words.push_back(kSymbolOffset);
+        words.push_back(bloomSize);
+        words.push_back(bloomShift);
+
+        std::vector<uint64_t> bloom(bloomSize);
+        std::vector<uint32_t> buckets(bucketCount);
+        std::vector<uint32_t> chain;
+
+        for (uint32_t index = kSymbolOffset; index < symbols.size(); index++) {
+            std::string name = strtab.data() + symbols[index].name;
+            uint32_t h = hash(name);
+
+            bloom[(h / 64) % bloomSize] |= (UINT64_C(1) << (h % 64)) | (UINT64_C(1) << ((h >> bloomShift) % 64));
+
+            uint32_t bucket = h % bucketCount;
+            if (buckets[bucket] == 0) {
+                buckets[bucket] = index;
+            }
+
+            // The last symbol in each bucket ends the chain.
+            bool last = (index + 1 == symbols.size())
+                     || (hash(strtab.data() + symbols[index + 1].name) % bucketCount != bucket);
+            chain.push_back(last ? (h | 1) : (h & ~1u));
+        }
+
+        for (uint64_t word : bloom) {
+            words.push_back(uint32_t(word));
+            words.push_back(uint32_t(word >> 32));
+        }
+
+        words.insert(words.end(), buckets.begin(), buckets.end());
+        words.insert(words.end(), chain.begin(), chain.end());
+
+        gnuHash.resize((words.size() + 1) / 2);
+        memcpy(gnuHash.data(), words.data(), words.size() * sizeof(uint32_t));
+    }
+
+    void buildSysvHash(uint32_t bucketCount) {
+        std::vector<uint32_t> buckets(bucketCount);
+        std::vector<uint32_t> chain(symbols.size());
+
+        for (uint32_t index = 1; index < symbols.size(); index++) {
+            const char *name = strtab.data() + symbols[index].name;
+            uint32_t bucket = elf::SysvHash(name, name + strlen(name)) % bucketCount;
+            chain[index] = buckets[bucket];
+            buckets[bucket] = index;
+        }
+
+        sysvHash.push_back(bucketCount);
+        sysvHash.push_back(uint32_t(symbols.size()));
+        sysvHash.insert(sysvHash.end(), buckets.begin(), buckets.end());
+        sysvHash.insert(sysvHash.end(), chain.begin(), chain.end());
+    }
+
+    const elf::Symbol *findGnu(std::string_view name) const {
+        elf::GnuHashTable table { gnuHash.data() };
+        return table.find(symbols.data(), strtab.data(), name.data(), name.data() + name.size());
+    }
+
+    const elf::Symbol *findSysv(std::string_view name) const {
+        elf::SysvHashTable table { sysvHash.data() };
+        return table.find(symbols.data(), strtab.data(), name.data(), name.data() + name.size());
+    }
+
+    std::string_view nameOf(const elf::Symbol *symbol) const {
+        return strtab.data() + symbol->name;
+    }
+
+    uint32_t indexOf(std::string_view name) const {
+        for (uint32_t i = 1; i < symbols.size(); i++) {
+            if (nameOf(&symbols[i]) == name) {
+                return i;
+            }
+        }
+
+        return 0;
+    }
+};
+
+static std::vector<std::string> MakeNames(size_t count) {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < count; i++) {
+        names.push_back("symbol_" + std::to_string(i));
+    }
+    return names;
+}
+
+TEST(RtldHashTest, KnownHashes) {
+    // Values from the reference implementations.
+    ASSERT_EQ(elf::GnuHash(nullptr, nullptr), 5381);
+    std::string_view printf = "printf";
+    ASSERT_EQ(elf::GnuHash(printf.data(), printf.data() + printf.size()), 0x156b2bb8);
+    ASSERT_EQ(elf::SysvHash(printf.data(), printf.data() + printf.size()), 0x077905a6);
+}
+
+TEST(RtldHashTest, GnuFindsAll) {
+    std::vector<std::string> names = MakeNames(500);
+    TestSymbolTable table { names, 37, 16 };
+
+    for (const std::string& name : names) {
+        const elf::Symbol *symbol = table.findGnu(name);
+        ASSERT_NE(symbol, nullptr) << name;
+        ASSERT_EQ(table.nameOf(symbol), name);
+    }
+}
+
+TEST(RtldHashTest, GnuMissing) {
+    TestSymbolTable table { MakeNames(500), 37, 16 };
+
+    for (size_t i = 500; i < 1000; i++) {
+        std::string name = "symbol_" + std::to_string(i);
+        ASSERT_EQ(table.findGnu(name), nullptr) << name;
+    }
+
+    // Prefixes and extensions of names that exist.
+    ASSERT_EQ(table.findGnu("symbol_"), nullptr);
+    ASSERT_EQ(table.findGnu("symbol_1x"), nullptr);
+    ASSERT_EQ(table.findGnu("symbol_10 "), nullptr);
+}
+
+TEST(RtldHashTest, GnuBloomRejects) {
+    TestSymbolTable table { MakeNames(64), 17, 8 };
+    elf::GnuHashTable gnu { table.gnuHash.data() };
+
+    size_t rejected = 0;
+    for (size_t i = 0; i < 1000; i++) {
+        std::string name = "missing_" + std::to_string(i);
+        if (!gnu.mayContain(TestSymbolTable::hash(name))) {
+            rejected += 1;
+        }
+    }
+
+    // 64 names in 512 bits with two bits per name, most misses never reach the chains.
+    ASSERT_GT(rejected, 900);
+}
+
+TEST(RtldHashTest, GnuSingleBucket) {
+    std::vector<std::string> names = MakeNames(20);
+    TestSymbolTable table { names, 1, 1 };
+
+    for (const std::string& name : names) {
+        ASSERT_NE(table.findGnu(name), nullptr) << name;
+    }
+
+    ASSERT_EQ(table.findGnu("symbol_20"), nullptr);
+}
+
+TEST(RtldHashTest, SkipsUndefinedAndLocal) {
+    TestSymbolTable table { { "defined", "undefined", "local" }, 3, 1 };
+
+    for (elf::Symbol& symbol : table.symbols) {
+        if (symbol.name == 0) continue;
+
+        std::string_view name = table.nameOf(&symbol);
+        if (name == "undefined") {
+            symbol.shndx = elf::kSectionUndefined;
+        } else if (name == "local") {
+            symbol.info = uint8_t(uint8_t(elf::SymbolBinding::eLocal) << 4);
+        }
+    }
+
+    ASSERT_NE(table.findGnu("defined"), nullptr);
+    ASSERT_EQ(table.findGnu("undefined"), nullptr);
+    ASSERT_EQ(table.findGnu("local"), nullptr);
+
+    ASSERT_NE(table.findSysv("defined"), nullptr);
+    ASSERT_EQ(table.findSysv("undefined"), nullptr);
+    ASSERT_EQ(table.findSysv("local"), nullptr);
+}
+
+TEST(RtldHashTest, SysvFindsAll) {
+    std::vector<std::string> names = MakeNames(500);
+    TestSymbolTable table { names, 37, 16 };
+
+    for (const std::string& name : names) {
+        const elf::Symbol *symbol = table.findSysv(name);
+        ASSERT_NE(symbol, nullptr) << name;
+        ASSERT_EQ(table.nameOf(symbol), name);
+    }
+
+    ASSERT_EQ(table.findSysv("symbol_500"), nullptr);
+}
+
+TEST(RtldHashTest, GnuAndSysvAgree) {
+    std::vector<std::string> names = MakeNames(200);
+    TestSymbolTable table { names, 13, 4 };
+
+    for (const std::string& name : names) {
+        ASSERT_EQ(table.findGnu(name), table.findSysv(name)) << name;
+    }
+}
+
+struct LoadedImage {
+    uintptr_t base = 0;
+    const elf::Symbol *symtab = nullptr;
+    const char *strtab = nullptr;
+    const void *gnuHash = nullptr;
+};
+
+/// @brief Find the gnu hash table of the libc the test is running against.
+static int FindLibc(struct dl_phdr_info *info, size_t, void *user) {
+    if (info->dlpi_name == nullptr || strstr(info->dlpi_name, "libc.so") == nullptr) {
+        return 0;
+    }
+
+    LoadedImage *image = static_cast<LoadedImage *>(user);
+    image->base = info->dlpi_addr;
+
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) &ph = info->dlpi_phdr[i];
+        if (ph.p_type != PT_DYNAMIC) continue;
+
+        // The host loader may have already relocated the entries.
+        auto address = [&](uint64_t value) {
+            return (value < image->base) ? image->base + value : value;
+        };
+
+        const ElfW(Dyn) *dyn = reinterpret_cast<const ElfW(Dyn) *>(info->dlpi_addr + ph.p_vaddr);
+        for (; dyn->d_tag != DT_NULL; dyn++) {
+            switch (dyn->d_tag) {
+            case DT_SYMTAB: image->symtab = reinterpret_cast<const elf::Symbol *>(address(dyn->d_un.d_ptr)); break;
+            case DT_STRTAB: image->strtab = reinterpret_cast<const char *>(address(dyn->d_un.d_ptr)); break;
+            case DT_GNU_HASH: image->gnuHash = reinterpret_cast<const void *>(address(dyn->d_un.d_ptr)); break;
+            }
+        }
+    }
+
+    return 1;
+}
+
+TEST(RtldHashTest, HostLibc) {
+    LoadedImage image;
+    if (dl_iterate_phdr(FindLibc, &image) == 0 || image.gnuHash == nullptr) {
+        GTEST_SKIP() << "libc has no gnu hash table";
+    }
+
+    ASSERT_NE(image.symtab, nullptr);
+    ASSERT_NE(image.strtab, nullptr);
+
+    elf::GnuHashTable table { image.gnuHash };
+    ASSERT_TRUE(table.isValid());
+
+    for (std::string_view name : { "printf", "malloc", "free", "fopen", "dl_iterate_phdr" }) {
+        const elf::Symbol *symbol = table.find(image.symtab, image.strtab, name.data(), name.data() + name.size());
+        ASSERT_NE(symbol, nullptr) << name;
+        ASSERT_EQ(std::string_view(image.strtab + symbol->name), name);
+    }
+
+    for (std::string_view name : { "RtldSoOpen", "printf_", "not_a_libc_function" }) {
+        ASSERT_EQ(table.find(image.symtab, image.strtab, name.data(), name.data() + name.size()), nullptr) << name;
+    }
+}
+
+void RtldPrintf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+void RtldLazyBindFailed(const RtldSoImage *, uint64_t) {
+    abort();
+}
+
+using Vec4 = double __attribute__((vector_size(32)));
+
+static int64_t TestScalarImport(
+    int64_t a, int64_t b, int64_t c, int64_t d, int64_t e, int64_t f,
+    double x0, double x1, double x2, double x3, double x4, double x5, double x6, double x7
+) {
+    double x = x0 + (2 * x1) + (3 * x2) + (4 * x3) + (5 * x4) + (6 * x5) + (7 * x6) + (8 * x7);
+    return a + (2 * b) + (3 * c) + (4 * d) + (5 * e) + (6 * f) + int64_t(x);
+}
+
+[[gnu::target("avx")]]
+static Vec4 TestVectorImport(Vec4 a, Vec4 b) {
+    return a + b;
+}
+
+extern "C" {
+    extern uint64_t RtldTestGot[5];
+
+    void RtldTestPltScalarLazy(void);
+    void RtldTestPltVectorLazy(void);
+
+    int64_t RtldTestPltScalar(
+        int64_t a, int64_t b, int64_t c, int64_t d, int64_t e, int64_t f,
+        double x0, double x1, double x2, double x3, double x4, double x5, double x6, double x7
+    );
+
+    [[gnu::target("avx")]]
+    Vec4 RtldTestPltVector(Vec4 a, Vec4 b);
+}
+
+/// @brief An image exporting the test functions, and an image importing them through rtld_plt.S.
+class RtldLinkTest : public testing::Test {
+public:
+    TestSymbolTable exports { { "scalar_import", "vector_import", "exported_data" }, 3, 1 };
+    TestSymbolTable imports { { "scalar_import", "vector_import", "exported_data", "missing", "missing_weak" }, 5, 1 };
+
+    RtldSoImage exporter{};
+    RtldSoImage importer{};
+
+    uint64_t data[4]{};
+    uint64_t memory[8]{};
+
+    std::vector<elf::Rela> jmprel;
+    std::vector<elf::Rela> rela;
+
+    void SetUp() override {
+        exports.symbols[exports.indexOf("scalar_import")].value = reinterpret_cast<uintptr_t>(&TestScalarImport);
+        exports.symbols[exports.indexOf("vector_import")].value = reinterpret_cast<uintptr_t>(&TestVectorImport);
+        exports.symbols[exports.indexOf("exported_data")].value = reinterpret_cast<uintptr_t>(&data);
+
+        // the exports are absolute, so the exporter is loaded at 0
+        exporter.base = 0;
+        exporter.symtab = exports.symbols.data();
+        exporter.strtab = exports.strtab.data();
+        exporter.gnuHash = elf::GnuHashTable { exports.gnuHash.data() };
+
+        for (elf::Symbol& symbol : imports.symbols) {
+            if (symbol.name == 0) continue;
+
+            symbol.value = 0;
+            symbol.shndx = elf::kSectionUndefined;
+            if (imports.nameOf(&symbol) == "missing_weak") {
+                symbol.info = uint8_t(uint8_t(elf::SymbolBinding::eWeak) << 4);
+            }
+        }
+
+        importer.base = 0;
+        importer.symtab = imports.symbols.data();
+        importer.strtab = imports.strtab.data();
+        importer.gnuHash = elf::GnuHashTable { imports.gnuHash.data() };
+
+        RtldTestGot[0] = 0;
+        RtldTestGot[1] = 0;
+        RtldTestGot[2] = 0;
+        RtldTestGot[3] = reinterpret_cast<uint64_t>(&RtldTestPltScalarLazy);
+        RtldTestGot[4] = reinterpret_cast<uint64_t>(&RtldTestPltVectorLazy);
+
+        jmprel = {
+            jumpSlot(&RtldTestGot[3], "scalar_import"),
+            jumpSlot(&RtldTestGot[4], "vector_import"),
+        };
+
+        RtldLinkImage(&exporter);
+        RtldLinkImage(&importer);
+    }
+
+    void TearDown() override {
+        RtldUnlinkImage(&importer);
+        RtldUnlinkImage(&exporter);
+    }
+
+    static uint64_t info(uint32_t symbol, elf::Amd64Relocation type) {
+        return (uint64_t(symbol) << 32) | uint32_t(type);
+    }
+
+    elf::Rela jumpSlot(uint64_t *slot, std::string_view name) const {
+        return elf::Rela { reinterpret_cast<uint64_t>(slot), info(imports.indexOf(name), elf::Amd64Relocation::eJumpSlot), 0 };
+    }
+
+    /// @brief A data relocation against the importer, which is loaded at @a memory.
+    elf::Rela dataRelocation(size_t word, elf::Amd64Relocation type, std::string_view name = {}, int64_t addend = 0) const {
+        uint32_t symbol = name.empty() ? 0 : imports.indexOf(name);
+        return elf::Rela { word * sizeof(uint64_t), info(symbol, type), addend };
+    }
+
+    void useLazyPlt() {
+        importer.jmprel = jmprel.data();
+        importer.jmprelCount = jmprel.size();
+        importer.pltgot = RtldTestGot;
+    }
+
+    void useData() {
+        importer.base = reinterpret_cast<uintptr_t>(memory);
+        importer.rela = rela.data();
+        importer.relaCount = rela.size();
+    }
+
+    static int64_t callScalar() {
+        return RtldTestPltScalar(1, 2, 3, 4, 5, 6, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0);
+    }
+
+    static int64_t expectedScalar() {
+        return TestScalarImport(1, 2, 3, 4, 5, 6, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0);
+    }
+};
+
+TEST_F(RtldLinkTest, DataRelocations) {
+    rela = {
+        dataRelocation(0, elf::Amd64Relocation::eRelative, {}, 0x20),
+        dataRelocation(1, elf::Amd64Relocation::e64, "exported_data", 8),
+        dataRelocation(2, elf::Amd64Relocation::eGlobalData, "exported_data"),
+        dataRelocation(3, elf::Amd64Relocation::e64, "missing_weak", 16),
+        dataRelocation(4, elf::Amd64Relocation::eNone),
+    };
+    memory[4] = 0x1234;
+    useData();
+
+    ASSERT_EQ(RtldRelocateImage(&importer), OsStatusSuccess);
+
+    uintptr_t base = reinterpret_cast<uintptr_t>(memory);
+    uintptr_t exported = reinterpret_cast<uintptr_t>(&data);
+    ASSERT_EQ(memory[0], base + 0x20);
+    ASSERT_EQ(memory[1], exported + 8);
+    ASSERT_EQ(memory[2], exported);
+
+    // unresolved weak symbols are null
+    ASSERT_EQ(memory[3], 16);
+    ASSERT_EQ(memory[4], 0x1234);
+}
+
+TEST_F(RtldLinkTest, UnresolvedSymbol) {
+    rela = { dataRelocation(0, elf::Amd64Relocation::eGlobalData, "missing") };
+    useData();
+
+    ASSERT_EQ(RtldRelocateImage(&importer), OsStatusNotFound);
+}
+
+TEST_F(RtldLinkTest, UnsupportedRelocation) {
+    // R_X86_64_PC32 is never emitted against a shared object's data
+    rela = { elf::Rela { 0, 2, 0 } };
+    useData();
+
+    ASSERT_EQ(RtldRelocateImage(&importer), OsStatusNotSupported);
+}
+
+TEST_F(RtldLinkTest, BindNow) {
+    useLazyPlt();
+    importer.bindNow = true;
+
+    ASSERT_EQ(RtldRelocateImage(&importer), OsStatusSuccess);
+
+    // every slot is bound up front and the trampoline is never installed
+    ASSERT_EQ(RtldTestGot[1], 0);
+    ASSERT_EQ(RtldTestGot[2], 0);
+    ASSERT_EQ(RtldTestGot[3], reinterpret_cast<uint64_t>(&TestScalarImport));
+    ASSERT_EQ(RtldTestGot[4], reinterpret_cast<uint64_t>(&TestVectorImport));
+
+    ASSERT_EQ(callScalar(), expectedScalar());
+}
+
+TEST_F(RtldLinkTest, LazyRelocate) {
+    useLazyPlt();
+
+    ASSERT_EQ(RtldRelocateImage(&importer), OsStatusSuccess);
+
+    // the slots still point at their stubs until the first call
+    ASSERT_EQ(RtldTestGot[1], reinterpret_cast<uint64_t>(&importer));
+    ASSERT_EQ(RtldTestGot[2], reinterpret_cast<uint64_t>(&RtldLazyTrampoline));
+    ASSERT_EQ(RtldTestGot[3], reinterpret_cast<uint64_t>(&RtldTestPltScalarLazy));
+    ASSERT_EQ(RtldTestGot[4], reinterpret_cast<uint64_t>(&RtldTestPltVectorLazy));
+
+    // the save area holds the registers and at least a legacy fxsave area, 64 byte aligned
+    ASSERT_GE(RtldLazySaveSize, 64 + 512);
+    ASSERT_EQ(RtldLazySaveSize % 64, 0);
+}
+
+TEST_F(RtldLinkTest, LazyBind) {
+    useLazyPlt();
+    ASSERT_EQ(RtldRelocateImage(&importer), OsStatusSuccess);
+
+    ASSERT_EQ(RtldLazyBind(&importer, 1), reinterpret_cast<uintptr_t>(&TestVectorImport));
+    ASSERT_EQ(RtldTestGot[4], reinterpret_cast<uint64_t>(&TestVectorImport));
+
+    // binding one slot leaves the others lazy
+    ASSERT_EQ(RtldTestGot[3], reinterpret_cast<uint64_t>(&RtldTestPltScalarLazy));
+}
+
+TEST_F(RtldLinkTest, LazyTrampoline) {
+    useLazyPlt();
+    ASSERT_EQ(RtldRelocateImage(&importer), OsStatusSuccess);
+
+    // the first call goes through the trampoline with every argument register intact
+    ASSERT_EQ(callScalar(), expectedScalar());
+    ASSERT_EQ(RtldTestGot[3], reinterpret_cast<uint64_t>(&TestScalarImport));
+
+    // later calls go straight to the import
+    ASSERT_EQ(callScalar(), expectedScalar());
+}
+
+[[gnu::target("avx")]]
+static void CheckVectorImport() {
+    Vec4 a = { 1.0, 2.0, 3.0, 4.0 };
+    Vec4 b = { 10.0, 20.0, 30.0, 40.0 };
+
+    Vec4 result = RtldTestPltVector(a, b);
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(result[i], a[i] + b[i]) << "lane " << i;
+    }
+}
+
+TEST_F(RtldLinkTest, LazyTrampolineKeepsVectorState) {
+    if (!__builtin_cpu_supports("avx")) {
+        GTEST_SKIP() << "avx is not supported";
+    }
+
+    useLazyPlt();
+    ASSERT_EQ(RtldRelocateImage(&importer), OsStatusSuccess);
+
+    // the resolver uses the string routines, which clear the upper halves of the ymm registers
+    CheckVectorImport();
+    ASSERT_EQ(RtldTestGot[4], reinterpret_cast<uint64_t>(&TestVectorImport));
+
+    CheckVectorImport();
+}
@@ -0,0 +1,251 @@
+#include <gtest/gtest.h>
+
+#include "stdio_stream.hpp"
+
+#include <string>
+#include <vector>
+
+/// @brief A device that records every write and serves reads from a fixed input.
+struct TestDevice {
+    std::vector<std::string> writes;
+    std::string input;
+    size_t offset = 0;
+    size_t reads = 0;
+
+    /// @brief The most bytes a single read will return, like a terminal returning a line at a time.
+    size_t maxRead = SIZE_MAX;
+
+    OsStatus writeStatus = OsStatusSuccess;
+
+    std::string output() const {
+        std::string result;
+        for (const std::string& write : writes) {
+            result += write;
+        }
+        return result;
+    }
+
+    StreamDevice device() {
+        return StreamDevice {
+            .object = this,
+            .write = [](void *object, const void *src, size_t size, size_t *written) -> OsStatus {
+                TestDevice *self = static_cast<TestDevice *>(object);
+                if (self->writeStatus != OsStatusSuccess) {
+                    return self->writeStatus;
+                }
+
+                self->writes.emplace_back(static_cast<const char *>(src), size);
+                *written = size;
+                return OsStatusSuccess;
+            },
+            .read = [](void *object, void *dst, size_t size, size_t *read) -> OsStatus {
+                TestDevice *self = static_cast<TestDevice *>(object);
+                size_t count = std::min({ size, self->input.size() - self->offset, self->maxRead });
+                memcpy(dst, self->input.data() + self->offset, count);
+                self->offset += count;
+                self->reads += 1;
+                *read = count;
+                return OsStatusSuccess;
+            },
+        };
+    }
+};
+
+TEST(StreamTest, Unbuffered) {
+    TestDevice device;
+    StreamBuffer stream { device.device(), eStreamNone };
+
+    ASSERT_EQ(stream.write("hello", 5), 5);
+    ASSERT_EQ(stream.putc('!'), '!');
+
+    ASSERT_EQ(device.writes.size(), 2);
+    ASSERT_EQ(device.output(), "hello!");
+}
+
+TEST(StreamTest, FullyBuffered) {
+    TestDevice device;
+    StreamBuffer stream { device.device(), eStreamFull };
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(stream.write("line\n", 5), 5);
+    }
+
+    ASSERT_TRUE(device.writes.empty());
+    ASSERT_TRUE(stream.hasPendingWrites());
+
+    ASSERT_TRUE(stream.flush());
+    ASSERT_EQ(device.writes.size(), 1);
+    ASSERT_EQ(device.output().size(), 500);
+    ASSERT_FALSE(stream.hasPendingWrites());
+}
+
+TEST(StreamTest, FullyBufferedOverflow) {
+    TestDevice device;
+    char buffer[16];
+    StreamBuffer stream { device.device(), eStreamFull };
+    ASSERT_TRUE(stream.setBuffer(buffer, eStreamFull, sizeof(buffer)));
+
+    ASSERT_EQ(stream.write("0123456789", 10), 10);
+    ASSERT_TRUE(device.writes.empty());
+
+    // Does not fit, the pending bytes are written first.
+    ASSERT_EQ(stream.write("abcdefghij", 10), 10);
+    ASSERT_EQ(device.writes.size(), 1);
+    ASSERT_EQ(device.writes[0], "0123456789");
+
+    // Larger than the buffer, written straight through.
+    std::string large(40, 'x');
+    ASSERT_EQ(stream.write(large.data(), large.size()), large.size());
+    ASSERT_EQ(device.writes.size(), 3);
+    ASSERT_EQ(device.writes[1], "abcdefghij");
+    ASSERT_EQ(device.writes[2], large);
+}
+
+TEST(StreamTest, LineBuffered) {
+    TestDevice device;
+    StreamBuffer stream { device.device(), eStreamLine };
+
+    ASSERT_EQ(stream.write("hello ", 6), 6);
+    ASSERT_EQ(stream.write("world", 5), 5);
+    ASSERT_TRUE(device.writes.empty());
+
+    ASSERT_EQ(stream.putc('\n'), '\n');
+    ASSERT_EQ(device.writes.size(), 1);
+    ASSERT_EQ(device.writes[0], "hello world\n");
+
+    ASSERT_EQ(stream.write("a\nb", 3), 3);
+    ASSERT_EQ(device.writes.size(), 2);
+    ASSERT_EQ(device.writes[1], "a\nb");
+}
+
+TEST(StreamTest, PutcFullyBuffered) {
+    TestDevice device;
+    StreamBuffer stream { device.device(), eStreamFull };
+
+    for (size_t i = 0; i < StreamBuffer::kDefaultCapacity * 2 + 1; i++) {
+        ASSERT_EQ(stream.putc('a' + (i % 26)), 'a' + int(i % 26));
+    }
+
+    ASSERT_EQ(device.writes.size(), 2);
+    ASSERT_TRUE(stream.flush());
+    ASSERT_EQ(device.writes.size(), 3);
+    ASSERT_EQ(device.output().size(), StreamBuffer::kDefaultCapacity * 2 + 1);
+}
+
+TEST(StreamTest, WriteError) {
+    TestDevice device;
+    device.writeStatus = OsStatusDeviceBusy;
+    StreamBuffer stream { device.device(), eStreamFull };
+
+    ASSERT_EQ(stream.write("abc", 3), 3);
+    ASSERT_EQ(stream.error(), OsStatusSuccess);
+
+    ASSERT_FALSE(stream.flush());
+    ASSERT_EQ(stream.error(), OsStatusDeviceBusy);
+
+    stream.clearError();
+    ASSERT_EQ(stream.error(), OsStatusSuccess);
+}
+
+TEST(StreamTest, ReadAhead) {
+    TestDevice device;
+    device.input = "the quick brown fox";
+    StreamBuffer stream { device.device(), eStreamFull };
+
+    std::string result;
+    while (true) {
+        int c = stream.getc();
+        if (c == -1) break;
+        result += char(c);
+    }
+
+    ASSERT_EQ(result, device.input);
+    ASSERT_TRUE(stream.eof());
+
+    // One read fills the buffer, the second finds the end of the input.
+    ASSERT_EQ(device.reads, 2);
+}
+
+TEST(StreamTest, ReadLarge) {
+    TestDevice device;
+    device.input = std::string(StreamBuffer::kDefaultCapacity * 3, 'z');
+    StreamBuffer stream { device.device(), eStreamFull };
+
+    std::vector<char> buffer(device.input.size());
+    ASSERT_EQ(stream.read(buffer.data(), 10), 10);
+    ASSERT_EQ(stream.read(buffer.data() + 10, buffer.size() - 10), buffer.size() - 10);
+    ASSERT_EQ(std::string(buffer.begin(), buffer.end()), device.input);
+    ASSERT_FALSE(stream.eof());
+
+    ASSERT_EQ(stream.read(buffer.data(), 1), 0);
+    ASSERT_TRUE(stream.eof());
+}
+
+TEST(StreamTest, ReadPartial) {
+    TestDevice device;
+    device.input = "0123456789abcdef";
+    device.maxRead = 3;
+    StreamBuffer stream { device.device(), eStreamFull };
+
+    // Short reads from the device are not the end of the file.
+    char buffer[16];
+    ASSERT_EQ(stream.read(buffer, sizeof(buffer)), sizeof(buffer));
+    ASSERT_EQ(std::string(buffer, sizeof(buffer)), device.input);
+    ASSERT_FALSE(stream.eof());
+}
+
+TEST(StreamTest, Gets) {
+    TestDevice device;
+    device.input = "first line\nsecond\n\nlast";
+    device.maxRead = 5;
+    StreamBuffer stream { device.device(), eStreamFull };
+
+    char buffer[64];
+    ASSERT_EQ(stream.gets(buffer, sizeof(buffer)), 11);
+    ASSERT_STREQ(buffer, "first line\n");
+    ASSERT_EQ(stream.gets(buffer, sizeof(buffer)), 7);
+    ASSERT_STREQ(buffer, "second\n");
+    ASSERT_EQ(stream.gets(buffer, sizeof(buffer)), 1);
+    ASSERT_STREQ(buffer, "\n");
+    ASSERT_EQ(stream.gets(buffer, sizeof(buffer)), 4);
+    ASSERT_STREQ(buffer, "last");
+    ASSERT_EQ(stream.gets(buffer, sizeof(buffer)), 0);
+    ASSERT_TRUE(stream.eof());
+}
+
+TEST(StreamTest, GetsTruncated) {
+    TestDevice device;
+    device.input = "abcdefgh\n";
+    StreamBuffer stream { device.device(), eStreamNone };
+
+    char buffer[4];
+    ASSERT_EQ(stream.gets(buffer, sizeof(buffer)), 3);
+    ASSERT_STREQ(buffer, "abc");
+    ASSERT_EQ(stream.gets(buffer, sizeof(buffer)), 3);
+    ASSERT_STREQ(buffer, "def");
+    ASSERT_EQ(stream.gets(buffer, sizeof(buffer)), 3);
+    ASSERT_STREQ(buffer, "gh\n");
+}
+
+TEST(StreamTest, SwitchDirection) {
+    TestDevice device;
+    device.input = "input";
+    StreamBuffer stream { device.device(), eStreamFull };
+
+    ASSERT_EQ(stream.write("output", 6), 6);
+    ASSERT_TRUE(device.writes.empty());
+
+    // Reading flushes pending writes first.
+    ASSERT_EQ(stream.getc(), 'i');
+    ASSERT_EQ(device.output(), "output");
+}
+
+TEST(StreamTest, SetBufferFlushes) {
+    TestDevice device;
+    StreamBuffer stream { device.device(), eStreamFull };
+
+    ASSERT_EQ(stream.write("pending", 7), 7);
+    ASSERT_TRUE(stream.setBuffer(nullptr, eStreamNone, 0));
+    ASSERT_EQ(device.output(), "pending");
+    ASSERT_EQ(stream.mode(), eStreamNone);
+}
@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+
+#include "string_routines.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+/// @brief Every routine set that can run on this machine.
+static std::vector<StringRoutines> AvailableRoutines() {
+    StringFeatures host = ImplDetectStringFeatures();
+
+    std::vector<StringRoutines> result = {
+        ImplSelectStringRoutines({ }),
+        ImplSelectStringRoutines({ .erms = true }),
+        ImplSelectStringRoutines({ .erms = true, .fsrm = true }),
+    };
+
+    if (host.avx2) {
+        result.push_back(ImplSelectStringRoutines({ .erms = true, .fsrm = true, .avx2 = true }));
+    }
+
+    return result;
+}
+
+static int Sign(int value) {
+    return (value > 0) - (value < 0);
+}
+
+/// @brief Two pages where the second page is inaccessible.
+///
+/// Data placed at the end of the first page verifies that the routines never
+/// read past the page that contains the end of their input.
+class GuardPage {
+    size_t mPageSize;
+    uint8_t *mMemory;
+
+public:
+    GuardPage() {
+        mPageSize = sysconf(_SC_PAGESIZE);
+        void *memory = mmap(nullptr, mPageSize * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        EXPECT_NE(memory, MAP_FAILED);
+        mMemory = static_cast<uint8_t *>(memory);
+        EXPECT_EQ(mprotect(mMemory + mPageSize, mPageSize, PROT_NONE), 0);
+    }
+
+    ~GuardPage() {
+        munmap(mMemory, mPageSize * 2);
+    }
+
+    /// @brief The start of @p size bytes that end at the guard page.
+    uint8_t *tail(size_t size) {
+        return mMemory + mPageSize - size;
+    }
+};
+
+class StringRoutinesTest : public testing::TestWithParam<StringRoutines> {
+public:
+    std::mt19937 mRandom { 0x1234 };
+
+    std::vector<uint8_t> randomBytes(size_t size) {
+        std::uniform_int_distribution<int> dist(1, 255);
+        std::vector<uint8_t> result(size);
+        for (uint8_t& byte : result) {
+            byte = dist(mRandom);
+        }
+        return result;
+    }
+};
+
+INSTANTIATE_TEST_SUITE_P(Routines, StringRoutinesTest, testing::ValuesIn(AvailableRoutines()));
+
+static constexpr size_t kMaxSize = 300;
+static constexpr size_t kMaxAlign = 64;
+
+TEST_P(StringRoutinesTest, StringLength) {
+    StringRoutines routines = GetParam();
+    std::vector<uint8_t> buffer = randomBytes(kMaxSize + kMaxAlign + 1);
+
+    for (size_t align = 0; align < kMaxAlign; align++) {
+        for (size_t size = 0; size < kMaxSize; size++) {
+            std::vector<uint8_t> copy = buffer;
+            char *str = reinterpret_cast<char *>(copy.data() + align);
+            str[size] = '\0';
+            ASSERT_EQ(routines.strlen(str), size) << "align " << align;
+        }
+    }
+}
+
+TEST_P(StringRoutinesTest, StringFind) {
+    StringRoutines routines = GetParam();
+    std::vector<uint8_t> buffer(kMaxSize + kMaxAlign + 1, 'a');
+
+    for (size_t align = 0; align < kMaxAlign; align++) {
+        for (size_t size = 0; size < kMaxSize; size++) {
+            std::vector<uint8_t> copy = buffer;
+            char *str = reinterpret_cast<char *>(copy.data() + align);
+            str[size] = '\0';
+
+            ASSERT_EQ(routines.strchr(str, 'b'), nullptr);
+            ASSERT_EQ(routines.strchr(str, '\0'), str + size);
+
+            if (size > 0) {
+                str[size / 2] = 'b';
+                str[size - 1] = 'b';
+                ASSERT_EQ(routines.strchr(str, 'b'), str + size / 2);
+                ASSERT_EQ(routines.strchr(str, 'b' | 0x100), str + size / 2);
+            }
+        }
+    }
+}
+
+TEST_P(StringRoutinesTest, MemoryFind) {
+    StringRoutines routines = GetParam();
+    std::vector<uint8_t> buffer(kMaxSize + kMaxAlign + 1, 'a');
+
+    for (size_t align = 0; align < kMaxAlign; align++) {
+        for (size_t size = 0; size < kMaxSize; size++) {
+            std::vector<uint8_t> copy = buffer;
+            uint8_t *data = copy.data() + align;
+
+            // A match just past the end must not be reported.
+            data[size] = 'b';
+            ASSERT_EQ(routines.memchr(data, 'b', size), nullptr) << "align " << align << " size " << size;
+
+            if (size > 0) {
+                data[size - 1] = 'b';
+                ASSERT_EQ(routines.memchr(data, 'b', size), data + size - 1);
+                data[size / 3] = 'b';
+                ASSERT_EQ(routines.memchr(data, 'b', size), data + size / 3);
+            }
+        }
+    }
+}
+
+TEST_P(StringRoutinesTest, MemoryCompare) {
+    StringRoutines routines = GetParam();
+    std::vector<uint8_t> lhs = randomBytes(kMaxSize);
+
+    for (size_t size = 0; size < kMaxSize; size++) {
+        std::vector<uint8_t> rhs = lhs;
+        ASSERT_EQ(routines.memcmp(lhs.data(), rhs.data(), size), 0);
+
+        for (size_t index = 0; index < size; index++) {
+            for (int delta : { -1, 1 }) {
+                rhs = lhs;
+                rhs[index] += delta;
+                int expected = memcmp(lhs.data(), rhs.data(), size);
+                int actual = routines.memcmp(lhs.data(), rhs.data(), size);
+                ASSERT_EQ(Sign(actual), Sign(expected)) << "size " << size << " index " << index;
+            }
+        }
+    }
+}
+
+TEST_P(StringRoutinesTest, MemoryCompareUnsigned) {
+    StringRoutines routines = GetParam();
+
+    for (size_t size = 1; size < 80; size++) {
+        std::vector<uint8_t> lhs(size, 0x01);
+        std::vector<uint8_t> rhs(size, 0x01);
+        rhs[size - 1] = 0xFF;
+        ASSERT_LT(routines.memcmp(lhs.data(), rhs.data(), size), 0);
+        ASSERT_GT(routines.memcmp(rhs.data(), lhs.data(), size), 0);
+    }
+}
+
+TEST_P(StringRoutinesTest, MemoryCopy) {
+    StringRoutines routines = GetParam();
+    std::vector<uint8_t> src = randomBytes(4096 + 64);
+
+    for (size_t size : { 0, 1, 2, 3, 4, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 255, 256, 257, 1000, 2047, 2048, 2049, 4096 }) {
+        for (size_t align = 0; align < 17; align++) {
+            std::vector<uint8_t> dst(size + 64, 0);
+            void *result = routines.memcpy(dst.data() + align, src.data() + 3, size);
+            ASSERT_EQ(result, dst.data() + align);
+            ASSERT_EQ(memcmp(dst.data() + align, src.data() + 3, size), 0) << "size " << size << " align " << align;
+
+            // Bytes around the destination are untouched.
+            for (size_t i = 0; i < align; i++) {
+                ASSERT_EQ(dst[i], 0);
+            }
+
+            for (size_t i = align + size; i < dst.size(); i++) {
+                ASSERT_EQ(dst[i], 0);
+            }
+        }
+    }
+}
+
+TEST_P(StringRoutinesTest, MemoryMove) {
+    StringRoutines routines = GetParam();
+    std::vector<uint8_t> data = randomBytes(8192);
+
+    for (size_t size : { 1, 5, 16, 31, 33, 64, 100, 257, 2048, 3000 }) {
+        for (ptrdiff_t shift : { -65, -17, -16, -1, 0, 1, 3, 16, 17, 64, 65, 1000 }) {
+            std::vector<uint8_t> actual = data;
+            std::vector<uint8_t> expected = data;
+            size_t src = 2048;
+            size_t dst = src + shift;
+
+            memmove(expected.data() + dst, expected.data() + src, size);
+            void *result = routines.memmove(actual.data() + dst, actual.data() + src, size);
+            ASSERT_EQ(result, actual.data() + dst);
+            ASSERT_EQ(actual, expected) << "size " << size << " shift " << shift;
+        }
+    }
+}
+
+TEST_P(StringRoutinesTest, MemorySet) {
+    StringRoutines routines = GetParam();
+
+    for (size_t size : { 0, 1, 2, 3, 4, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 255, 256, 2048, 4099 }) {
+        for (size_t align = 0; align < 17; align++) {
+            std::vector<uint8_t> dst(size + 64, 0);
+            void *result = routines.memset(dst.data() + align, 0x1AB, size);
+            ASSERT_EQ(result, dst.data() + align);
+
+            for (size_t i = 0; i < dst.size(); i++) {
+                bool inside = i >= align && i < align + size;
+                ASSERT_EQ(dst[i], inside ? 0xAB : 0) << "size " << size << " align " << align << " index " << i;
+            }
+        }
+    }
+}
+
+TEST_P(StringRoutinesTest, StringLengthPageEnd) {
+    StringRoutines routines = GetParam();
+    GuardPage page;
+
+    for (size_t size = 1; size < 256; size++) {
+        char *str = reinterpret_cast<char *>(page.tail(size));
+        memset(str, 'x', size - 1);
+        str[size - 1] = '\0';
+
+        ASSERT_EQ(routines.strlen(str), size - 1);
+        ASSERT_EQ(routines.strchr(str, 'y'), nullptr);
+        ASSERT_EQ(routines.strchr(str, '\0'), str + size - 1);
+    }
+}
+
+TEST_P(StringRoutinesTest, MemoryFindPageEnd) {
+    StringRoutines routines = GetParam();
+    GuardPage page;
+
+    for (size_t size = 0; size < 256; size++) {
+        uint8_t *data = page.tail(size);
+        memset(data, 'x', size);
+
+        ASSERT_EQ(routines.memchr(data, 'y', size), nullptr);
+        ASSERT_EQ(routines.memcmp(data, data, size), 0);
+    }
+}
+
+TEST(StringFeaturesTest, SelectBaseline) {
+    StringRoutines routines = ImplSelectStringRoutines({ });
+    ASSERT_EQ(routines.strlen, ImplStringLengthSse2);
+    ASSERT_EQ(routines.memcpy, ImplMemoryCopySse2);
+    ASSERT_EQ(routines.memset, ImplMemorySetSse2);
+}
+
+TEST(StringFeaturesTest, SelectAvx2) {
+    StringRoutines routines = ImplSelectStringRoutines({ .erms = true, .fsrm = true, .avx2 = true });
+    ASSERT_EQ(routines.strlen, ImplStringLengthAvx2);
+    ASSERT_EQ(routines.memchr, ImplMemoryFindAvx2);
+    ASSERT_EQ(routines.memcpy, ImplMemoryCopyFsrm);
+    ASSERT_EQ(routines.memmove, ImplMemoryMoveErms);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <bezos/handle.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @defgroup OsClockPage Clock page
+/// @brief The clock data the kernel shares with every process.
+///
+/// The kernel maps a read only page at @ref OS_CLOCK_PAGE_ADDRESS in every
+/// process. When the system clock is driven by an invariant tsc the time can
+/// be computed from the page and a @c rdtsc without entering the kernel.
+///
+/// The kernel writes the page once during boot, before the first process is
+/// created, and never changes it afterwards. The clock is never recalibrated
+/// so there is nothing to republish, and the page can be read without any
+/// synchronization.
+/// @{
+
+/// @brief The address the clock page is mapped at in every process.
+/// @note This is the last page of the user address space, it is reserved before anything else is mapped.
+#define OS_CLOCK_PAGE_ADDRESS 0xFFFFF000
+
+/// @brief The ticks of the clock are read with @c rdtsc.
+/// @note When this is not set the clock can only be read through a system call.
+#define OS_CLOCK_PAGE_TSC (1 << 0)
+
+struct OsClockPage {
+    /// @brief Flags describing the clock.
+    uint32_t Flags;
+
+    /// @brief The shift applied after multiplying by @a Multiplier.
+    uint32_t Shift;
+
+    /// @brief The frequency of the tick counter.
+    uint64_t FrequencyHz;
+
+    /// @brief The tick counter value at @a BaseTime.
+    OsTickCounter BaseTicks;
+
+    /// @brief The time at @a BaseTicks.
+    OsInstant BaseTime;
+
+    /// @brief The multiplier to convert ticks to 100ns intervals.
+    uint64_t Multiplier;
+};
+
+/// @brief Find the multiplier and shift that convert ticks at @p FrequencyHz into 100ns intervals.
+///
+/// The largest shift that keeps the multiplier in 64 bits is used to keep as
+/// much precision as possible.
+static inline void OsClockPageScale(uint64_t FrequencyHz, uint64_t *OutMultiplier, uint32_t *OutShift) {
+    uint32_t shift = 64;
+    unsigned __int128 multiplier = 0;
+
+    while (shift > 0) {
+        multiplier = ((unsigned __int128)10000000 << shift) / FrequencyHz;
+        if ((multiplier >> 64) == 0) {
+            break;
+        }
+
+        shift -= 1;
+    }
+
+    *OutMultiplier = (uint64_t)multiplier;
+    *OutShift = shift;
+}
+
+/// @brief Convert a tick counter value into a time using the clock page.
+static inline OsInstant OsClockPageInstant(const struct OsClockPage *Page, OsTickCounter Ticks) {
+    uint64_t elapsed = Ticks - Page->BaseTicks;
+    unsigned __int128 scaled = (unsigned __int128)elapsed * Page->Multiplier;
+    return Page->BaseTime + (OsInstant)(scaled >> Page->Shift);
+}
+
+/// @} // group OsClockPage
+
+#ifdef __cplusplus
+}
+#endif
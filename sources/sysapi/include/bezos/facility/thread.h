@@ -85,6 +85,25 @@ struct OsThreadCreateInfo {
     OsTxHandle Transaction;
 };
 
+/// @brief Scheduler statistics of a thread.
+///
+/// Times are counted in tsc ticks. @ref OsClockPage::FrequencyHz is only the tsc frequency
+/// when @ref OS_CLOCK_PAGE_TSC is set, with any other clock source the ticks can not be
+/// converted to seconds and only compared against each other.
+struct OsThreadSchedulerInfo {
+    /// @brief The number of times the thread was switched onto a cpu.
+    uint64_t Switches;
+
+    /// @brief The number of times the thread was switched out while it could still run.
+    uint64_t Preemptions;
+
+    /// @brief The ticks spent running, not including the current time slice.
+    OsTickCounter RunTicks;
+
+    /// @brief The ticks spent ready to run but waiting for a cpu.
+    OsTickCounter WaitTicks;
+};
+
 struct OsThreadInfo {
     OsUtf8Char Name[OS_OBJECT_NAME_MAX];
 
@@ -93,6 +112,8 @@ struct OsThreadInfo {
     OsThreadState State;
 
     OsProcessHandle Process;
+
+    struct OsThreadSchedulerInfo Scheduler;
 };
 
 extern OsStatus OsThreadCurrent(OsHandleAccess Access, OsThreadHandle *OutHandle);
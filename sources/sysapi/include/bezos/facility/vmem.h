@@ -144,6 +144,23 @@ extern OsStatus OsVmemMap(struct OsVmemMapInfo MapInfo, OsAnyPointer *OutBase);
 /// @return The status of the operation.
 extern OsStatus OsVmemRelease(OsAnyPointer BaseAddress, OsSize Size);
 
+/// @brief Change the access flags of a range of memory in the current process.
+///
+/// The range may span several areas created by @c OsVmemCreate or @c OsVmemMap,
+/// but every page in the range must be mapped.
+///
+/// @param BaseAddress The base address of the memory to update.
+/// @param Size The size of the memory to update.
+/// @param Access The new access flags, only @c eOsMemoryRead, @c eOsMemoryWrite, and
+///               @c eOsMemoryExecute may be set.
+///
+/// @return The status of the operation.
+///
+/// @retval OsStatusSuccess The access flags of the memory were updated.
+/// @retval OsStatusInvalidInput The range is not page aligned or @p Access contains other flags.
+/// @retval OsStatusNotFound Part of the range is not mapped.
+extern OsStatus OsVmemProtect(OsAnyPointer BaseAddress, OsSize Size, OsMemoryAccess Access);
+
 /// @} // group OsAddressSpace
 
 #ifdef __cplusplus
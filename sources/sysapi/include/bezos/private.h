@@ -35,6 +35,7 @@ enum {
     eOsCallVmemCreate = 0x50,
     eOsCallVmemMap = 0x51,
     eOsCallVmemRelease = 0x52,
+    eOsCallVmemProtect = 0x53,
 
     eOsCallTxBegin = 0x60,
     eOsCallTxCommit = 0x61,
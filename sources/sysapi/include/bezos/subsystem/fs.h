@@ -17,6 +17,7 @@ OS_DEFINE_GUID(kOsSymbolicLinkGuid, 0x14070837, 0xfe9a, 0x11ef, 0x8a0e, 0x138770
 
 enum {
     eOsIteratorNext = UINT64_C(0),
+    eOsIteratorNextBatch = UINT64_C(1),
 };
 
 enum {
@@ -31,6 +32,54 @@ inline OsStatus OsInvokeIteratorNext(OsDeviceHandle Handle, struct OsIteratorNex
     return OsDeviceInvoke(Handle, eOsIteratorNext, Next, sizeof(*Next));
 }
 
+/// @brief A single folder entry written by @ref OsInvokeIteratorNextBatch.
+///
+/// The name is not null terminated, records are padded so that the
+/// next record is always 8 byte aligned.
+struct OsIteratorEntry {
+    /// @brief The size of this record including the name and padding.
+    uint16_t Size;
+
+    /// @brief The length of the name in bytes.
+    uint16_t NameLength;
+
+    uint32_t Reserved;
+
+    OsUtf8Char Name[];
+};
+
+/// @brief The header of a batch of folder entries.
+///
+/// The entries follow the header in the same buffer.
+struct OsIteratorBatch {
+    /// @brief The number of entries written.
+    OsSize Count;
+
+    /// @brief The number of bytes of entries written after the header.
+    OsSize Size;
+};
+
+/// @brief Get the first entry of a batch.
+inline const struct OsIteratorEntry *OsIteratorBatchFirst(const struct OsIteratorBatch *Batch) {
+    return (const struct OsIteratorEntry *)(Batch + 1);
+}
+
+/// @brief Get the entry after @p Entry in a batch.
+inline const struct OsIteratorEntry *OsIteratorEntryNext(const struct OsIteratorEntry *Entry) {
+    return (const struct OsIteratorEntry *)((const char *)Entry + Entry->Size);
+}
+
+/// @brief Fill a buffer with as many folder entries as will fit.
+///
+/// The buffer starts with a @ref OsIteratorBatch header followed by the entries.
+/// Iteration resumes after the last entry returned by the previous call.
+///
+/// @retval OsStatusCompleted There are no more entries in the folder.
+/// @retval OsStatusMoreData The buffer is too small to hold the next entry.
+inline OsStatus OsInvokeIteratorNextBatch(OsDeviceHandle Handle, struct OsIteratorBatch *Batch, OsSize Size) {
+    return OsDeviceInvoke(Handle, eOsIteratorNextBatch, Batch, Size);
+}
+
 struct OsStreamCreateInfo {
     struct OsPath Path;
 };
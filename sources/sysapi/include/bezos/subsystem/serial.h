@@ -0,0 +1,9 @@
+#pragma once
+
+#include <bezos/handle.h>
+
+OS_BEGIN_API
+
+#define OS_DEVICE_SERIAL_COM1 "Devices\0Serial\0COM1"
+
+OS_END_API
@@ -12,6 +12,10 @@ BZP_API_BEGIN
 
 #define BUFSIZ 1024
 
+#define _IOFBF 0
+#define _IOLBF 1
+#define _IONBF 2
+
 #define SEEK_CUR 0x100
 #define SEEK_END 0x200
 #define SEEK_SET 0x300
@@ -88,8 +92,16 @@ extern int fgetc(FILE *);
 
 extern char *fgets(char *, int, FILE *);
 
+extern int getc(FILE *);
+
+extern int getchar(void);
+
 extern int putchar(int);
 
+extern void setbuf(FILE *__BZ_RESTRICT, char *__BZ_RESTRICT);
+
+extern int setvbuf(FILE *__BZ_RESTRICT, char *__BZ_RESTRICT, int, size_t);
+
 extern void setbuffer(FILE *, char *, int);
 
 extern void setlinebuf(FILE *);
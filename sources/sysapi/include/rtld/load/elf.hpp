@@ -43,6 +43,93 @@ namespace os::elf {
         eTls = 0x7,
     };
 
+    /// @brief Segment permissions in @a ProgramHeader::flags.
+    enum ProgramHeaderFlags : uint32_t {
+        eProgramExecute = (1 << 0),
+        eProgramWrite = (1 << 1),
+        eProgramRead = (1 << 2),
+    };
+
+    enum class DynamicTag : int64_t {
+        eNull = 0,
+        eNeeded = 1,
+        ePltRelSize = 2,
+        ePltGot = 3,
+        eHash = 4,
+        eStrTab = 5,
+        eSymTab = 6,
+        eRela = 7,
+        eRelaSize = 8,
+        eRelaEnt = 9,
+        eStrSize = 10,
+        eSymEnt = 11,
+        eInit = 12,
+        eFini = 13,
+        ePltRel = 20,
+        eTextRel = 22,
+        eJmpRel = 23,
+        eBindNow = 24,
+        eInitArray = 25,
+        eFiniArray = 26,
+        eInitArraySize = 27,
+        eFiniArraySize = 28,
+        eFlags = 30,
+        eGnuHash = 0x6ffffef5,
+        eRelaCount = 0x6ffffff9,
+        eFlags1 = 0x6ffffffb,
+    };
+
+    /// @brief @a DynamicTag::eFlags bit requesting all relocations be processed at load.
+    static constexpr uint64_t kDynamicFlagBindNow = 0x8;
+
+    /// @brief @a DynamicTag::eFlags1 bit requesting all relocations be processed at load.
+    static constexpr uint64_t kDynamicFlag1Now = 0x1;
+
+    struct Dynamic {
+        DynamicTag tag;
+        uint64_t value;
+    };
+
+    enum class SymbolBinding : uint8_t {
+        eLocal = 0,
+        eGlobal = 1,
+        eWeak = 2,
+    };
+
+    /// @brief Section index of undefined symbols.
+    static constexpr uint16_t kSectionUndefined = 0;
+
+    struct Symbol {
+        uint32_t name;
+        uint8_t info;
+        uint8_t other;
+        uint16_t shndx;
+        uint64_t value;
+        uint64_t size;
+
+        SymbolBinding binding() const {
+            return SymbolBinding(info >> 4);
+        }
+
+        bool isDefined() const {
+            return shndx != kSectionUndefined;
+        }
+    };
+
+    struct Rela {
+        uint64_t offset;
+        uint64_t info;
+        int64_t addend;
+
+        uint32_t symbol() const {
+            return uint32_t(info >> 32);
+        }
+
+        uint32_t type() const {
+            return uint32_t(info & 0xFFFFFFFF);
+        }
+    };
+
     struct ProgramHeader {
         ProgramHeaderType type;
         uint32_t flags;
@@ -118,5 +205,16 @@ namespace os::elf {
 
     static_assert(sizeof(Header) == 64);
     static_assert(sizeof(ProgramHeader) == 56);
+    enum class Amd64Relocation : uint32_t {
+        eNone = 0,
+        e64 = 1,
+        eGlobalData = 6,
+        eJumpSlot = 7,
+        eRelative = 8,
+    };
+
     static_assert(sizeof(SectionHeader) == 64);
+    static_assert(sizeof(Dynamic) == 16);
+    static_assert(sizeof(Symbol) == 24);
+    static_assert(sizeof(Rela) == 24);
 }
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "rtld/load/elf.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace os::elf {
+    /// @brief The hash function used by @a DynamicTag::eGnuHash tables.
+    constexpr uint32_t GnuHash(const char *front, const char *back) {
+        uint32_t hash = 5381;
+        for (const char *it = front; it != back; it++) {
+            hash = (hash << 5) + hash + uint8_t(*it);
+        }
+
+        return hash;
+    }
+
+    /// @brief The hash function used by @a DynamicTag::eHash tables.
+    constexpr uint32_t SysvHash(const char *front, const char *back) {
+        uint32_t hash = 0;
+        for (const char *it = front; it != back; it++) {
+            hash = (hash << 4) + uint8_t(*it);
+            uint32_t high = hash & 0xF0000000;
+            if (high != 0) {
+                hash ^= high >> 24;
+            }
+            hash &= ~high;
+        }
+
+        return hash;
+    }
+
+    namespace detail {
+        inline bool SymbolNameEqual(const char *strtab, uint32_t name, const char *front, const char *back) {
+            const char *symbol = strtab + name;
+            for (const char *it = front; it != back; it++, symbol++) {
+                if (*symbol != *it) {
+                    return false;
+                }
+            }
+
+            return *symbol == '\0';
+        }
+
+        inline bool IsLookupCandidate(const Symbol& symbol) {
+            return symbol.isDefined() && symbol.binding() != SymbolBinding::eLocal;
+        }
+    }
+
+    /// @brief A view of a @a DynamicTag::eGnuHash table.
+    ///
+    /// The bloom filter rejects most names that are not in the object without touching
+    /// the symbol table, names that pass are found by walking a single sorted hash chain.
+    class GnuHashTable {
+        uint32_t mBucketCount = 0;
+        uint32_t mSymbolOffset = 0;
+        uint32_t mBloomSize = 0;
+        uint32_t mBloomShift = 0;
+        const uint64_t *mBloom = nullptr;
+        const uint32_t *mBuckets = nullptr;
+        const uint32_t *mChain = nullptr;
+
+    public:
+        constexpr GnuHashTable() = default;
+
+        /// @brief Create a view of the table at @p table.
+        ///
+        /// @param table The start of the table, must be 8 byte aligned.
+        GnuHashTable(const void *table) {
+            const uint32_t *header = static_cast<const uint32_t *>(table);
+            mBucketCount = header[0];
+            mSymbolOffset = header[1];
+            mBloomSize = header[2];
+            mBloomShift = header[3];
+            mBloom = reinterpret_cast<const uint64_t *>(header + 4);
+            mBuckets = reinterpret_cast<const uint32_t *>(mBloom + mBloomSize);
+            mChain = mBuckets + mBucketCount;
+        }
+
+        constexpr bool isValid() const {
+            return mBucketCount != 0 && mBloomSize != 0 && (mBloomSize & (mBloomSize - 1)) == 0;
+        }
+
+        /// @brief Test if a name with @p hash may be in the table.
+        bool mayContain(uint32_t hash) const {
+            uint64_t word = mBloom[(hash / 64) & (mBloomSize - 1)];
+            uint64_t mask = (UINT64_C(1) << (hash % 64))
+                          | (UINT64_C(1) << ((hash >> mBloomShift) % 64));
+
+            return (word & mask) == mask;
+        }
+
+        /// @brief Find a defined global symbol.
+        ///
+        /// @param symtab The dynamic symbol table.
+        /// @param strtab The dynamic string table.
+        /// @param front The start of the name.
+        /// @param back The end of the name.
+        ///
+        /// @return The symbol, or nullptr if it is not defined by the object.
+        const Symbol *find(const Symbol *symtab, const char *strtab, const char *front, const char *back) const {
+            uint32_t hash = GnuHash(front, back);
+            if (!mayContain(hash)) {
+                return nullptr;
+            }
+
+            uint32_t index = mBuckets[hash % mBucketCount];
+            if (index < mSymbolOffset) {
+                return nullptr;
+            }
+
+            //
+            // The low bit of each chain entry marks the end of the chain, the
+            // other bits are the hash of the symbol so names are only compared
+            // when the hashes match.
+            //
+            while (true) {
+                uint32_t entry = mChain[index - mSymbolOffset];
+                if ((entry | 1) == (hash | 1)) {
+                    const Symbol *symbol = &symtab[index];
+                    if (detail::IsLookupCandidate(*symbol) && detail::SymbolNameEqual(strtab, symbol->name, front, back)) {
+                        return symbol;
+                    }
+                }
+
+                if (entry & 1) {
+                    return nullptr;
+                }
+
+                index += 1;
+            }
+        }
+    };
+
+    /// @brief A view of a @a DynamicTag::eHash table, used when an object has no gnu hash table.
+    class SysvHashTable {
+        uint32_t mBucketCount = 0;
+        uint32_t mChainCount = 0;
+        const uint32_t *mBuckets = nullptr;
+        const uint32_t *mChain = nullptr;
+
+    public:
+        constexpr SysvHashTable() = default;
+
+        SysvHashTable(const void *table) {
+            const uint32_t *header = static_cast<const uint32_t *>(table);
+            mBucketCount = header[0];
+            mChainCount = header[1];
+            mBuckets = header + 2;
+            mChain = mBuckets + mBucketCount;
+        }
+
+        constexpr bool isValid() const {
+            return mBucketCount != 0;
+        }
+
+        const Symbol *find(const Symbol *symtab, const char *strtab, const char *front, const char *back) const {
+            uint32_t hash = SysvHash(front, back);
+            for (uint32_t index = mBuckets[hash % mBucketCount]; index != 0 && index < mChainCount; index = mChain[index]) {
+                const Symbol *symbol = &symtab[index];
+                if (detail::IsLookupCandidate(*symbol) && detail::SymbolNameEqual(strtab, symbol->name, front, back)) {
+                    return symbol;
+                }
+            }
+
+            return nullptr;
+        }
+    };
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "rtld/load/elf.hpp"
+#include "rtld/load/hash.hpp"
+
+#include <bezos/status.h>
+
+/// @brief A shared object loaded into this process.
+///
+/// Images are kept in load order, symbols are resolved by searching every
+/// loaded image in that order. Dependencies named by DT_NEEDED are not loaded
+/// automatically, they must already be open when an image that uses them is.
+struct RtldSoImage {
+    RtldSoImage *next;
+    RtldSoImage *prev;
+
+    uintptr_t base;
+
+    const os::elf::Symbol *symtab;
+    const char *strtab;
+    os::elf::GnuHashTable gnuHash;
+    os::elf::SysvHashTable sysvHash;
+
+    const os::elf::Rela *rela;
+    size_t relaCount;
+
+    const os::elf::Rela *jmprel;
+    size_t jmprelCount;
+
+    uint64_t *pltgot;
+    bool bindNow;
+    bool textRel;
+
+    uintptr_t init;
+    uintptr_t fini;
+    const uintptr_t *initArray;
+    size_t initArrayCount;
+    const uintptr_t *finiArray;
+    size_t finiArrayCount;
+};
+
+/// @brief Add an image to the end of the global scope.
+void RtldLinkImage(RtldSoImage *image);
+
+/// @brief Remove an image from the global scope.
+void RtldUnlinkImage(RtldSoImage *image);
+
+/// @brief Find a symbol exported by an image.
+///
+/// @return The symbol, or nullptr if the image does not export it.
+const os::elf::Symbol *RtldImageFindSymbol(const RtldSoImage *image, const char *front, const char *back);
+
+/// @brief Apply the relocations of an image.
+///
+/// Data relocations are applied now. PLT relocations are only bound now if the
+/// image asks for it with DT_BIND_NOW, otherwise each slot is pointed at its PLT
+/// stub so the import is resolved by @a RtldLazyBind on the first call, and imports
+/// that are never called are never looked up.
+OsStatus RtldRelocateImage(RtldSoImage *image);
+
+/// @brief Resolves the PLT slot of an import on the first call through it.
+///
+/// Entered from PLT0 with the image and relocation index pushed on the stack,
+/// preserves all argument registers, including the full vector register state,
+/// then jumps to the resolved function.
+extern "C" void RtldLazyTrampoline(void);
+
+/// @brief Bind PLT slot @p index of @p image, called by @a RtldLazyTrampoline.
+///
+/// @return The address of the resolved function.
+extern "C" uintptr_t RtldLazyBind(RtldSoImage *image, uint64_t index);
+
+/// @brief The bytes @a RtldLazyTrampoline reserves for the register state.
+///
+/// Holds the general purpose argument registers followed by an xsave area
+/// large enough for every component enabled in xcr0, or an fxsave area if
+/// the processor does not support xsave.
+extern "C" uint64_t RtldLazySaveSize;
+
+/// @brief If @a RtldLazyTrampoline saves the vector state with xsave rather than fxsave.
+extern "C" uint32_t RtldLazyUseXsave;
+
+//
+// Provided by the loader.
+//
+
+/// @brief Write a diagnostic message.
+void RtldPrintf(const char *fmt, ...);
+
+/// @brief Called when a lazily bound import cannot be resolved, there is no caller to return to.
+[[noreturn]]
+void RtldLazyBindFailed(const RtldSoImage *image, uint64_t index);
@@ -32,9 +32,14 @@ struct RtldSoLoadInfo {
     OsDeviceHandle Object;
 };
 
+struct RtldSoImage;
+
 struct RtldSo {
     OsDeviceHandle Object;
     RtldTlsInitInfo TlsInfo;
+
+    /// @brief The loader state for the object, owned by rtld.
+    struct RtldSoImage *Image;
 };
 
 struct RtldSoName {
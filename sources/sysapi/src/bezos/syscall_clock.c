@@ -1,13 +1,36 @@
 #include <bezos/facility/clock.h>
+#include <bezos/clock_page.h>
 
 #include <bezos/private.h>
 
+static const struct OsClockPage *GetClockPage(void) {
+    return (const struct OsClockPage *)OS_CLOCK_PAGE_ADDRESS;
+}
+
 OsStatus OsClockGetTime(OsInstant *OutTime) {
+    const struct OsClockPage *page = GetClockPage();
+
+    if (page->Flags & OS_CLOCK_PAGE_TSC) {
+        *OutTime = OsClockPageInstant(page, __builtin_ia32_rdtsc());
+        return OsStatusSuccess;
+    }
+
     struct OsCallResult result = OsSystemCall(eOsCallClockGetTime, 0, 0, 0, 0);
     *OutTime = (OsInstant)result.Value;
     return result.Status;
 }
 
+OsStatus OsClockGetTicks(OsTickCounter *OutTicks) {
+    if (GetClockPage()->Flags & OS_CLOCK_PAGE_TSC) {
+        *OutTicks = __builtin_ia32_rdtsc();
+        return OsStatusSuccess;
+    }
+
+    struct OsCallResult result = OsSystemCall(eOsCallClockTicks, 0, 0, 0, 0);
+    *OutTicks = (OsTickCounter)result.Value;
+    return result.Status;
+}
+
 OsStatus OsClockStat(struct OsClockInfo *OutInfo) {
     struct OsCallResult result = OsSystemCall(eOsCallClockStat, (uint64_t)OutInfo, 0, 0, 0);
     return result.Status;
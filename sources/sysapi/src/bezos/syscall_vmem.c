@@ -18,3 +18,8 @@ OsStatus OsVmemRelease(OsAnyPointer BaseAddress, OsSize Size) {
     struct OsCallResult result = OsSystemCall(eOsCallVmemRelease, (uint64_t)BaseAddress, Size, 0, 0);
     return result.Status;
 }
+
+OsStatus OsVmemProtect(OsAnyPointer BaseAddress, OsSize Size, OsMemoryAccess Access) {
+    struct OsCallResult result = OsSystemCall(eOsCallVmemProtect, (uint64_t)BaseAddress, Size, Access, 0);
+    return result.Status;
+}
@@ -56,3 +56,7 @@ void DebugLog(OsDebugMessageFlags Flags, const char *format, ...);
 void AssertOsSuccess(OsStatus status, const char *expr, std::source_location location = std::source_location::current());
 
 #define ASSERT_OS_SUCCESS(expr) AssertOsSuccess(expr, #expr)
+
+/// @brief Flush every open stream, called before the process exits.
+[[gnu::visibility("hidden")]]
+void FlushAllStreams();
@@ -2,6 +2,7 @@
 
 #include <posix/errno.h>
 #include <posix/stdint.h>
+#include <posix/string.h>
 #include <posix/ext/args.h>
 
 #include <bezos/facility/process.h>
@@ -11,32 +12,81 @@
 
 #include "bezos/handle.h"
 #include "private.hpp"
+#include "stdio_stream.hpp"
 
 #define STB_SPRINTF_IMPLEMENTATION 1
 #define STB_SPRINTF_STATIC 1
 #include "stb_sprintf.h"
 
-struct OsImplPosixFile {
-    int fd;
-};
-
 namespace {
 
 struct OsPosixFd {
     OsDeviceHandle handle;
     size_t offset;
-    int error;
-    int eof;
 };
 
 // TODO: need an actual map
 OsPosixFd gFdMap[32];
 // std::atomic<int> gFdCounter{3};
 
+OsStatus PosixFdWrite(void *object, const void *src, size_t size, size_t *written) {
+    OsPosixFd *fd = static_cast<OsPosixFd*>(object);
+    OsDeviceWriteRequest request {
+        .BufferFront = static_cast<const char*>(src),
+        .BufferBack = static_cast<const char*>(src) + size,
+        .Offset = fd->offset,
+        .Timeout = OS_TIMEOUT_INFINITE,
+    };
+    OsSize result = 0;
+
+    OsStatus status = OsDeviceWrite(fd->handle, request, &result);
+    fd->offset += result;
+    *written = result;
+    return status;
+}
+
+OsStatus PosixFdRead(void *object, void *dst, size_t size, size_t *read) {
+    OsPosixFd *fd = static_cast<OsPosixFd*>(object);
+    OsDeviceReadRequest request {
+        .BufferFront = static_cast<char*>(dst),
+        .BufferBack = static_cast<char*>(dst) + size,
+        .Offset = fd->offset,
+        .Timeout = OS_TIMEOUT_INFINITE,
+    };
+    OsSize result = 0;
+
+    OsStatus status = OsDeviceRead(fd->handle, request, &result);
+    fd->offset += result;
+    *read = result;
+    return status;
+}
+
+constexpr StreamDevice PosixFdDevice(int fd) {
+    return StreamDevice {
+        .object = &gFdMap[fd],
+        .write = PosixFdWrite,
+        .read = PosixFdRead,
+    };
+}
+
+}
+
+struct OsImplPosixFile {
+    int fd;
+    StreamBuffer stream;
+};
+
+namespace {
+
 class InitStandardIo {
-    OsImplPosixFile mStandardIn = { 0 };
-    OsImplPosixFile mStandardOut = { 1 };
-    OsImplPosixFile mStandardError = { 2 };
+    //
+    // The standard streams are all connected to a terminal, so output is
+    // line buffered and stdin reads ahead as much as the terminal has.
+    // stderr is never buffered so diagnostics are not lost on a crash.
+    //
+    OsImplPosixFile mStandardIn = { 0, { PosixFdDevice(0), eStreamFull } };
+    OsImplPosixFile mStandardOut = { 1, { PosixFdDevice(1), eStreamLine } };
+    OsImplPosixFile mStandardError = { 2, { PosixFdDevice(2), eStreamNone } };
 
 public:
     InitStandardIo() {
@@ -70,6 +120,23 @@ InitStandardIo& GlobalStandardIo() {
     static InitStandardIo sStandardIo;
     return sStandardIo;
 }
+
+/// @brief Flush output that a program prompting for input expects to be visible.
+void FlushBeforeRead(FILE *file) {
+    if (file == stdin) {
+        stdout->stream.flush();
+    }
+}
+
+/// @brief Flush pending output when returning from main.
+[[gnu::destructor]]
+void FlushStreamsAtExit() {
+    FlushAllStreams();
+}
+}
+
+void FlushAllStreams() {
+    fflush(nullptr);
 }
 
 FILE *OsImplPosixStandardIn(void) {
@@ -94,8 +161,8 @@ FILE *fopen(const char *, const char *) {
     return nullptr;
 }
 
-void clearerr(FILE *) {
-    Unimplemented();
+void clearerr(FILE *file) {
+    file->stream.clearError();
 }
 
 FILE *fdopen(int, const char *) {
@@ -113,17 +180,23 @@ long ftell(FILE *) {
     return -1;
 }
 
-int fflush(FILE *) {
-    Unimplemented();
-    return -1;
+int fflush(FILE *file) {
+    if (file == nullptr) {
+        // Only the standard streams can be opened for now.
+        bool ok = stdout->stream.flush();
+        ok = stderr->stream.flush() && ok;
+        return ok ? 0 : EOF;
+    }
+
+    return file->stream.flush() ? 0 : EOF;
 }
 
 int feof(FILE *file) {
-    return gFdMap[file->fd].eof;
+    return file->stream.eof();
 }
 
 int ferror(FILE *file) {
-    return gFdMap[file->fd].error;
+    return file->stream.error() != OsStatusSuccess;
 }
 
 int fileno(FILE *file) {
@@ -135,27 +208,8 @@ size_t fread(void *dst, size_t size, size_t count, FILE *file) {
         return 0;
     }
 
-    OsPosixFd *fd = &gFdMap[fileno(file)];
-    OsDeviceReadRequest request {
-        .BufferFront = static_cast<char*>(dst),
-        .BufferBack = static_cast<char*>(dst) + size * count,
-        .Offset = fd->offset,
-        .Timeout = OS_TIMEOUT_INFINITE,
-    };
-    OsSize result = 0;
-
-    OsStatus status = OsDeviceRead(fd->handle, request, &result);
-    if (status != OsStatusSuccess) {
-        gFdMap[fileno(file)].error = status;
-        return -1;
-    }
-
-    if (result != size * count) {
-        gFdMap[fileno(file)].eof = 1;
-    }
-
-    fd->offset += result;
-    return result / size;
+    FlushBeforeRead(file);
+    return file->stream.read(dst, size * count) / size;
 }
 
 size_t fwrite(const void *src, size_t size, size_t count, FILE *file) {
@@ -163,27 +217,32 @@ size_t fwrite(const void *src, size_t size, size_t count, FILE *file) {
         return 0;
     }
 
-    OsPosixFd *fd = &gFdMap[fileno(file)];
-    OsDeviceWriteRequest request {
-        .BufferFront = static_cast<const char*>(src),
-        .BufferBack = static_cast<const char*>(src) + size * count,
-        .Offset = fd->offset,
-        .Timeout = OS_TIMEOUT_INFINITE,
-    };
-    OsSize result = 0;
+    return file->stream.write(src, size * count) / size;
+}
 
-    OsStatus status = OsDeviceWrite(fd->handle, request, &result);
-    if (status != OsStatusSuccess) {
-        gFdMap[fileno(file)].error = status;
+int setvbuf(FILE *file, char *buffer, int mode, size_t size) {
+    if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF) {
+        errno = EINVAL;
         return -1;
     }
 
-    if (result != size * count) {
-        gFdMap[fileno(file)].eof = 1;
+    if (!file->stream.setBuffer(buffer, StreamMode(mode), size)) {
+        return EOF;
     }
 
-    fd->offset += result;
-    return result / size;
+    return 0;
+}
+
+void setbuf(FILE *file, char *buffer) {
+    setvbuf(file, buffer, buffer ? _IOFBF : _IONBF, BUFSIZ);
+}
+
+void setbuffer(FILE *file, char *buffer, int size) {
+    setvbuf(file, buffer, buffer ? _IOFBF : _IONBF, size);
+}
+
+void setlinebuf(FILE *file) {
+    setvbuf(file, nullptr, _IOLBF, 0);
 }
 
 int fprintf(FILE *file, const char *format, ...) {
@@ -249,54 +308,65 @@ int vfprintf(FILE *file, const char *format, va_list args) {
 }
 
 int puts(const char *str) {
-    int status = printf("%s\n", str);
-    if (status < 0) {
+    FILE *file = stdout;
+    if (fputs(str, file) == EOF || file->stream.putc('\n') == EOF) {
         return EOF;
     }
 
-    return status;
+    return 1;
 }
 
 int putc(int c, FILE *file) {
-    return fputc(c, file);
+    return file->stream.putc(c);
 }
 
 int fputc(int c, FILE *file) {
-    char buffer[1] = { static_cast<char>(c) };
-    int status = fwrite(buffer, 1, 1, file);
-    if (status != 1) {
+    return file->stream.putc(c);
+}
+
+int putchar(int c) {
+    return fputc(c, stdout);
+}
+
+int fputs(const char *str, FILE *file) {
+    size_t length = strlen(str);
+    if (file->stream.write(str, length) != length) {
         return EOF;
     }
 
-    return c;
+    return 1;
 }
 
-int fgetc(FILE *) {
-    Unimplemented();
-    return -1;
+int getc(FILE *file) {
+    return fgetc(file);
 }
 
-char *fgets(char *, int, FILE *) {
-    Unimplemented();
-    return nullptr;
+int getchar(void) {
+    return fgetc(stdin);
 }
 
-int fputs(const char *, FILE *) {
-    Unimplemented();
-    return -1;
+int fgetc(FILE *file) {
+    FlushBeforeRead(file);
+    return file->stream.getc();
 }
 
-int putchar(int) {
-    Unimplemented();
-    return -1;
-}
+char *fgets(char *dst, int size, FILE *file) {
+    if (size <= 0) {
+        errno = EINVAL;
+        return nullptr;
+    }
 
-void setbuffer(FILE *, char *, int) {
-    Unimplemented();
-}
+    FlushBeforeRead(file);
 
-void setlinebuf(FILE *) {
-    Unimplemented();
+    //
+    // With room for only the terminator nothing is read, this is not
+    // an end of file condition.
+    //
+    if (file->stream.gets(dst, size) == 0 && size > 1) {
+        return nullptr;
+    }
+
+    return dst;
 }
 
 char *cuserid(char *) {
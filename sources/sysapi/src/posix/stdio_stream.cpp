@@ -0,0 +1,281 @@
+#include "stdio_stream.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+StreamBuffer::~StreamBuffer() {
+    flush();
+
+    if (mOwnsBuffer) {
+        free(mBuffer);
+    }
+}
+
+bool StreamBuffer::reserve() {
+    if (mBuffer != nullptr) {
+        return true;
+    }
+
+    if (mCapacity == 0) {
+        mCapacity = kDefaultCapacity;
+    }
+
+    //
+    // If there is no memory for a buffer fall back to unbuffered io
+    // rather than failing the operation.
+    //
+    mBuffer = static_cast<char *>(malloc(mCapacity));
+    if (mBuffer == nullptr) {
+        mCapacity = 0;
+        mMode = eStreamNone;
+        return false;
+    }
+
+    mOwnsBuffer = true;
+    return true;
+}
+
+bool StreamBuffer::writeDevice(const char *src, size_t size) {
+    while (size > 0) {
+        size_t written = 0;
+        OsStatus status = mDevice.write(mDevice.object, src, size, &written);
+        if (status != OsStatusSuccess || written == 0) {
+            mError = (status != OsStatusSuccess) ? status : OsStatusEndOfFile;
+            return false;
+        }
+
+        src += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+size_t StreamBuffer::readDevice(char *dst, size_t size) {
+    size_t read = 0;
+    OsStatus status = mDevice.read(mDevice.object, dst, size, &read);
+    if (status != OsStatusSuccess) {
+        mError = status;
+        return 0;
+    }
+
+    if (read == 0) {
+        mEof = true;
+    }
+
+    return read;
+}
+
+bool StreamBuffer::refill() {
+    mFront = 0;
+    mBack = readDevice(mBuffer, mCapacity);
+    return mBack > 0;
+}
+
+void StreamBuffer::beginRead() {
+    if (mState == eStateWriting) {
+        flush();
+    }
+
+    if (mState != eStateReading) {
+        mState = eStateReading;
+        mFront = 0;
+        mBack = 0;
+    }
+}
+
+void StreamBuffer::beginWrite() {
+    if (mState == eStateReading) {
+        //
+        // Devices behind a stream are not seekable, so read-ahead that
+        // was never consumed is lost.
+        //
+        mFront = 0;
+        mBack = 0;
+    }
+
+    mState = eStateWriting;
+}
+
+bool StreamBuffer::setBuffer(char *buffer, StreamMode mode, size_t size) {
+    bool ok = flush();
+
+    if (mOwnsBuffer) {
+        free(mBuffer);
+    }
+
+    mBuffer = buffer;
+    mCapacity = (buffer != nullptr || size != 0) ? size : kDefaultCapacity;
+    mOwnsBuffer = false;
+    mMode = mode;
+    mState = eStateIdle;
+    mFront = 0;
+    mBack = 0;
+
+    // A user buffer too small to hold anything is the same as no buffer.
+    if (mCapacity == 0) {
+        mMode = eStreamNone;
+    }
+
+    return ok;
+}
+
+bool StreamBuffer::flush() {
+    bool ok = true;
+    if (mState == eStateWriting && mBack > 0) {
+        ok = writeDevice(mBuffer, mBack);
+    }
+
+    mState = eStateIdle;
+    mFront = 0;
+    mBack = 0;
+    return ok;
+}
+
+size_t StreamBuffer::write(const void *src, size_t size) {
+    const char *data = static_cast<const char *>(src);
+
+    beginWrite();
+
+    if (mMode == eStreamNone || !reserve()) {
+        return writeDevice(data, size) ? size : 0;
+    }
+
+    //
+    // Writes that do not fit are sent straight to the device after
+    // the buffer is flushed rather than being copied through it.
+    //
+    if (mBack + size > mCapacity) {
+        if (!writeDevice(mBuffer, mBack)) {
+            return 0;
+        }
+
+        mBack = 0;
+
+        if (size >= mCapacity) {
+            return writeDevice(data, size) ? size : 0;
+        }
+    }
+
+    memcpy(mBuffer + mBack, data, size);
+    mBack += size;
+
+    if (mMode == eStreamLine && memchr(data, '\n', size) != nullptr) {
+        if (!writeDevice(mBuffer, mBack)) {
+            return 0;
+        }
+
+        mBack = 0;
+    }
+
+    return size;
+}
+
+size_t StreamBuffer::read(void *dst, size_t size) {
+    char *data = static_cast<char *>(dst);
+    size_t total = 0;
+
+    beginRead();
+
+    if (mMode == eStreamNone || !reserve()) {
+        while (total < size) {
+            size_t count = readDevice(data + total, size - total);
+            if (count == 0) {
+                break;
+            }
+
+            total += count;
+        }
+
+        return total;
+    }
+
+    while (total < size) {
+        if (mFront == mBack) {
+            //
+            // Large reads skip the buffer, there is nothing to gain from
+            // reading ahead when the caller wants more than a buffer full.
+            //
+            if (size - total >= mCapacity) {
+                size_t count = readDevice(data + total, size - total);
+                if (count == 0) {
+                    break;
+                }
+
+                total += count;
+                continue;
+            }
+
+            if (!refill()) {
+                break;
+            }
+        }
+
+        size_t count = mBack - mFront;
+        if (count > size - total) {
+            count = size - total;
+        }
+
+        memcpy(data + total, mBuffer + mFront, count);
+        mFront += count;
+        total += count;
+    }
+
+    return total;
+}
+
+size_t StreamBuffer::gets(char *dst, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+
+    size_t total = 0;
+    size_t limit = size - 1;
+
+    beginRead();
+
+    if (mMode == eStreamNone || !reserve()) {
+        while (total < limit) {
+            char c;
+            if (readDevice(&c, 1) == 0) {
+                break;
+            }
+
+            dst[total++] = c;
+            if (c == '\n') {
+                break;
+            }
+        }
+
+        dst[total] = '\0';
+        return total;
+    }
+
+    while (total < limit) {
+        if (mFront == mBack && !refill()) {
+            break;
+        }
+
+        size_t count = mBack - mFront;
+        if (count > limit - total) {
+            count = limit - total;
+        }
+
+        const char *front = mBuffer + mFront;
+        const char *newline = static_cast<const char *>(memchr(front, '\n', count));
+        if (newline != nullptr) {
+            count = (newline - front) + 1;
+        }
+
+        memcpy(dst + total, front, count);
+        mFront += count;
+        total += count;
+
+        if (newline != nullptr) {
+            break;
+        }
+    }
+
+    dst[total] = '\0';
+    return total;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <bezos/status.h>
+
+#include <stddef.h>
+
+/// @brief Buffering modes of a stream, these match _IOFBF, _IOLBF, and _IONBF.
+enum StreamMode {
+    /// @brief Writes are only sent to the device when the buffer is full.
+    eStreamFull = 0,
+
+    /// @brief Writes are sent to the device after every newline.
+    eStreamLine = 1,
+
+    /// @brief Every read and write goes to the device.
+    eStreamNone = 2,
+};
+
+/// @brief The device a stream reads from and writes to.
+struct StreamDevice {
+    void *object;
+
+    /// @brief Write up to @p size bytes, may write fewer.
+    OsStatus (*write)(void *object, const void *src, size_t size, size_t *written);
+
+    /// @brief Read up to @p size bytes, reading 0 bytes signals end of file.
+    OsStatus (*read)(void *object, void *dst, size_t size, size_t *read);
+};
+
+/// @brief The buffer behind a FILE.
+///
+/// A stream is either reading or writing at any one time, switching direction
+/// flushes pending writes or discards read-ahead. The buffer is allocated when
+/// the stream is first used so streams that are never touched cost nothing.
+///
+/// This is kept apart from stdio.cpp so it can be tested natively.
+class StreamBuffer {
+    enum State {
+        eStateIdle,
+        eStateReading,
+        eStateWriting,
+    };
+
+    StreamDevice mDevice;
+    StreamMode mMode;
+    State mState = eStateIdle;
+
+    char *mBuffer = nullptr;
+    size_t mCapacity = 0;
+    bool mOwnsBuffer = false;
+
+    /// @brief The unread bytes when reading, or the pending bytes when writing.
+    size_t mFront = 0;
+    size_t mBack = 0;
+
+    OsStatus mError = OsStatusSuccess;
+    bool mEof = false;
+
+    bool reserve();
+    bool writeDevice(const char *src, size_t size);
+    size_t readDevice(char *dst, size_t size);
+    bool refill();
+
+    void beginRead();
+    void beginWrite();
+
+public:
+    /// @brief The buffer size used when none is provided.
+    static constexpr size_t kDefaultCapacity = 4096;
+
+    constexpr StreamBuffer(StreamDevice device, StreamMode mode)
+        : mDevice(device)
+        , mMode(mode)
+    { }
+
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    /// @brief Change the buffering of the stream, flushing any pending writes.
+    ///
+    /// @param buffer The buffer to use, or nullptr to allocate one on first use.
+    /// @param mode The new buffering mode.
+    /// @param size The size of @p buffer, or the size to allocate.
+    ///
+    /// @return If the pending writes were flushed.
+    bool setBuffer(char *buffer, StreamMode mode, size_t size);
+
+    /// @brief Write all pending bytes to the device and discard any read-ahead.
+    bool flush();
+
+    /// @brief Write bytes to the stream.
+    ///
+    /// @return The number of bytes written, less than @p size only on error.
+    size_t write(const void *src, size_t size);
+
+    /// @brief Read bytes from the stream.
+    ///
+    /// @return The number of bytes read, less than @p size only at end of file or on error.
+    size_t read(void *dst, size_t size);
+
+    /// @brief Write a single byte, returns -1 on error.
+    int putc(int c) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (mState == eStateWriting && mMode == eStreamFull && mBack < mCapacity) {
+            mBuffer[mBack++] = static_cast<char>(byte);
+            return byte;
+        }
+
+        return (write(&byte, 1) == 1) ? byte : -1;
+    }
+
+    /// @brief Read a single byte, returns -1 at end of file or on error.
+    int getc() {
+        if (mState == eStateReading && mFront < mBack) {
+            return static_cast<unsigned char>(mBuffer[mFront++]);
+        }
+
+        unsigned char c;
+        return (read(&c, 1) == 1) ? c : -1;
+    }
+
+    /// @brief Read up to and including a newline.
+    ///
+    /// @param dst The buffer to read into, always nul terminated.
+    /// @param size The size of @p dst, including the terminator.
+    ///
+    /// @return The number of bytes read, excluding the terminator.
+    size_t gets(char *dst, size_t size);
+
+    /// @brief Are there writes that have not been sent to the device.
+    bool hasPendingWrites() const { return mState == eStateWriting && mBack > 0; }
+
+    StreamMode mode() const { return mMode; }
+    OsStatus error() const { return mError; }
+    bool eof() const { return mEof; }
+
+    void clearError() {
+        mError = OsStatusSuccess;
+        mEof = false;
+    }
+};
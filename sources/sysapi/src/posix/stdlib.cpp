@@ -60,6 +60,8 @@ void abort(void) {
 
 __attribute__((__nothrow__, __noreturn__))
 void exit(int exitcode) {
+    FlushAllStreams();
+
     //
     // OsProcessTerminate when called with the current process handle
     // will terminate the current process and never return.
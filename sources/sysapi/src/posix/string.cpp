@@ -3,82 +3,126 @@
 #include <posix/stdint.h>
 #include <posix/stdlib.h>
 
+#include "string_routines.hpp"
+
+//
+// The string and memory routines are selected once per process based on the
+// processor features, much like an ifunc. Programs are linked statically and
+// the loader has no ifunc support, so instead each routine is a pointer that
+// starts out at a resolver. The first call to any routine selects all of them
+// and then forwards the call. This is safe to call before constructors have run.
+//
+
+static void ResolveStringRoutines();
+
+static size_t ResolveStringLength(const char *s) {
+    ResolveStringRoutines();
+    return strlen(s);
+}
+
+static char *ResolveStringFind(const char *s, int c) {
+    ResolveStringRoutines();
+    return strchr(s, c);
+}
+
+static void *ResolveMemoryFind(const void *s, int c, size_t n) {
+    ResolveStringRoutines();
+    return memchr(s, c, n);
+}
+
+static int ResolveMemoryCompare(const void *lhs, const void *rhs, size_t n) {
+    ResolveStringRoutines();
+    return memcmp(lhs, rhs, n);
+}
+
+static void *ResolveMemoryCopy(void *dst, const void *src, size_t size) {
+    ResolveStringRoutines();
+    return memcpy(dst, src, size);
+}
+
+static void *ResolveMemoryMove(void *dst, const void *src, size_t size) {
+    ResolveStringRoutines();
+    return memmove(dst, src, size);
+}
+
+static void *ResolveMemorySet(void *ptr, int v, size_t size) {
+    ResolveStringRoutines();
+    return memset(ptr, v, size);
+}
+
+static constinit StringRoutines gStringRoutines = {
+    .strlen = ResolveStringLength,
+    .strchr = ResolveStringFind,
+    .memchr = ResolveMemoryFind,
+    .memcmp = ResolveMemoryCompare,
+    .memcpy = ResolveMemoryCopy,
+    .memmove = ResolveMemoryMove,
+    .memset = ResolveMemorySet,
+};
+
+template<typename T>
+static T LoadRoutine(T *routine) {
+    return __atomic_load_n(routine, __ATOMIC_RELAXED);
+}
+
+template<typename T>
+static void StoreRoutine(T *routine, T value) {
+    __atomic_store_n(routine, value, __ATOMIC_RELAXED);
+}
+
+static void ResolveStringRoutines() {
+    //
+    // Threads racing to resolve all select the same routines, so the
+    // stores do not need to be ordered. The table is stored field by field
+    // to avoid a struct copy the compiler could turn into a call to memcpy.
+    //
+    StringRoutines routines = ImplSelectStringRoutines(ImplDetectStringFeatures());
+    StoreRoutine(&gStringRoutines.strlen, routines.strlen);
+    StoreRoutine(&gStringRoutines.strchr, routines.strchr);
+    StoreRoutine(&gStringRoutines.memchr, routines.memchr);
+    StoreRoutine(&gStringRoutines.memcmp, routines.memcmp);
+    StoreRoutine(&gStringRoutines.memcpy, routines.memcpy);
+    StoreRoutine(&gStringRoutines.memmove, routines.memmove);
+    StoreRoutine(&gStringRoutines.memset, routines.memset);
+}
+
 __attribute__((__nothrow__, __nonblocking__, __nonnull__))
 size_t strlen(const char *s) {
-    size_t len = 0;
-    while (*s++) {
-        len++;
-    }
-    return len;
+    return LoadRoutine(&gStringRoutines.strlen)(s);
 }
 
 __attribute__((__nothrow__, __nonblocking__, __nonnull__))
 size_t strnlen(const char *s, size_t n) {
-    size_t len = 0;
-    while (n-- && *s++) {
-        len++;
+    if (const void *end = memchr(s, '\0', n)) {
+        return static_cast<const char *>(end) - s;
     }
-    return len;
+
+    return n;
 }
 
 __attribute__((__nothrow__, __nonblocking__, __nonnull__, __returns_nonnull__))
 void *memset(void *ptr, int v, size_t size) {
-    unsigned char *p = static_cast<unsigned char *>(ptr);
-    for (size_t i = 0; i < size; i++) {
-        p[i] = static_cast<unsigned char>(v);
-    }
-    return ptr;
+    return LoadRoutine(&gStringRoutines.memset)(ptr, v, size);
 }
 
 __attribute__((__nothrow__, __nonblocking__, __nonnull__, __returns_nonnull__))
 void *memcpy(void *dst, const void *src, size_t size) {
-    unsigned char *d = static_cast<unsigned char *>(dst);
-    const unsigned char *s = static_cast<const unsigned char *>(src);
-    for (size_t i = 0; i < size; i++) {
-        d[i] = s[i];
-    }
-    return dst;
+    return LoadRoutine(&gStringRoutines.memcpy)(dst, src, size);
 }
 
 __attribute__((__nothrow__, __nonblocking__, __nonnull__, __returns_nonnull__))
 void *memmove(void *dst, const void *src, size_t size) {
-    unsigned char *d = static_cast<unsigned char *>(dst);
-    const unsigned char *s = static_cast<const unsigned char *>(src);
-    if (d < s) {
-        for (size_t i = 0; i < size; i++) {
-            d[i] = s[i];
-        }
-    } else {
-        for (size_t i = size; i > 0; i--) {
-            d[i - 1] = s[i - 1];
-        }
-    }
-    return dst;
+    return LoadRoutine(&gStringRoutines.memmove)(dst, src, size);
 }
 
 __attribute__((__nothrow__, __nonblocking__, __nonnull__))
 void *memchr(const void *s, int c, size_t n) {
-    const unsigned char *p = static_cast<const unsigned char *>(s);
-    for (size_t i = 0; i < n; i++) {
-        if (p[i] == c) {
-            return const_cast<unsigned char *>(p + i);
-        }
-    }
-
-    return nullptr;
+    return LoadRoutine(&gStringRoutines.memchr)(s, c, n);
 }
 
 __attribute__((__nothrow__, __nonblocking__, __nonnull__))
 int memcmp(const void *lhs, const void *rhs, size_t n) {
-    const unsigned char *l = static_cast<const unsigned char *>(lhs);
-    const unsigned char *r = static_cast<const unsigned char *>(rhs);
-    for (size_t i = 0; i < n; i++) {
-        if (l[i] != r[i]) {
-            return l[i] - r[i];
-        }
-    }
-
-    return 0;
+    return LoadRoutine(&gStringRoutines.memcmp)(lhs, rhs, n);
 }
 
 __attribute__((__nothrow__, __nonblocking__, __nonnull__))
@@ -168,13 +212,7 @@ char *strncat(char *dst, const char *src, size_t n) {
 }
 
 char *strchr(const char *str, int c) {
-    for (size_t i = 0; str[i]; i++) {
-        if (str[i] == c) {
-            return const_cast<char *>(str + i);
-        }
-    }
-
-    return nullptr;
+    return LoadRoutine(&gStringRoutines.strchr)(str, c);
 }
 
 char *strrchr(const char *str, int c) {
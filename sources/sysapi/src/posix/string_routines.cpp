@@ -0,0 +1,811 @@
+#include "string_routines.hpp"
+
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#define STRING_NO_SANITIZE __attribute__((__no_sanitize_address__))
+
+/// @brief Copies of at least this size use rep movsb when ERMS is available.
+static constexpr size_t kErmsCopyThreshold = 2048;
+
+/// @brief Copies of at least this size use rep movsb when FSRM is available.
+static constexpr size_t kFsrmCopyThreshold = 256;
+
+/// @brief Stores of at least this size use rep stosb when ERMS is available.
+static constexpr size_t kErmsSetThreshold = 2048;
+
+static constexpr size_t kNoThreshold = SIZE_MAX;
+
+template<typename T>
+static const T *AlignDown(const T *ptr, uintptr_t align) {
+    return reinterpret_cast<const T *>(reinterpret_cast<uintptr_t>(ptr) & ~(align - 1));
+}
+
+static bool IsAligned(const void *ptr, uintptr_t align) {
+    return (reinterpret_cast<uintptr_t>(ptr) & (align - 1)) == 0;
+}
+
+static unsigned CountTrailingZeros(uint32_t value) {
+    return __builtin_ctz(value);
+}
+
+static const uint8_t *FoundBefore(const uint8_t *found, const uint8_t *end) {
+    return (found < end) ? found : nullptr;
+}
+
+//
+// Primitive moves.
+//
+
+static void RepMovsb(void *dst, const void *src, size_t size) {
+    asm volatile("rep movsb" : "+D"(dst), "+S"(src), "+c"(size) : : "memory");
+}
+
+static void RepStosb(void *dst, uint8_t value, size_t size) {
+    asm volatile("rep stosb" : "+D"(dst), "+c"(size) : "a"(value) : "memory");
+}
+
+static __m128i LoadVector(const uint8_t *src) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+}
+
+static void StoreVector(uint8_t *dst, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), value);
+}
+
+/// @brief Copy up to 32 bytes, all loads happen before any stores so the ranges may overlap.
+static void CopySmall(uint8_t *dst, const uint8_t *src, size_t size) {
+    if (size >= 16) {
+        __m128i head = LoadVector(src);
+        __m128i tail = LoadVector(src + size - 16);
+        StoreVector(dst, head);
+        StoreVector(dst + size - 16, tail);
+    } else if (size >= 8) {
+        uint64_t head, tail;
+        __builtin_memcpy(&head, src, sizeof(head));
+        __builtin_memcpy(&tail, src + size - 8, sizeof(tail));
+        __builtin_memcpy(dst, &head, sizeof(head));
+        __builtin_memcpy(dst + size - 8, &tail, sizeof(tail));
+    } else if (size >= 4) {
+        uint32_t head, tail;
+        __builtin_memcpy(&head, src, sizeof(head));
+        __builtin_memcpy(&tail, src + size - 4, sizeof(tail));
+        __builtin_memcpy(dst, &head, sizeof(head));
+        __builtin_memcpy(dst + size - 4, &tail, sizeof(tail));
+    } else if (size > 0) {
+        uint8_t first = src[0];
+        uint8_t middle = src[size / 2];
+        uint8_t last = src[size - 1];
+        dst[0] = first;
+        dst[size / 2] = middle;
+        dst[size - 1] = last;
+    }
+}
+
+/// @brief Copy more than 32 non-overlapping bytes, aligning the stores.
+static void CopyAligned(uint8_t *dst, const uint8_t *src, size_t size) {
+    __m128i head = LoadVector(src);
+    __m128i tail = LoadVector(src + size - 16);
+    StoreVector(dst, head);
+    StoreVector(dst + size - 16, tail);
+
+    size_t skip = 16 - (reinterpret_cast<uintptr_t>(dst) & 15);
+    dst += skip;
+    src += skip;
+    size -= skip;
+
+    // The last 16 bytes are covered by the tail store.
+    while (size > 64) {
+        __m128i a = LoadVector(src + 0);
+        __m128i b = LoadVector(src + 16);
+        __m128i c = LoadVector(src + 32);
+        __m128i d = LoadVector(src + 48);
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + 0), a);
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + 16), b);
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + 32), c);
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + 48), d);
+        dst += 64;
+        src += 64;
+        size -= 64;
+    }
+
+    while (size > 16) {
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst), LoadVector(src));
+        dst += 16;
+        src += 16;
+        size -= 16;
+    }
+}
+
+/// @brief Copy more than 32 bytes front to back, safe when @p dst is below @p src.
+static void CopyForward(uint8_t *dst, const uint8_t *src, size_t size) {
+    __m128i tail = LoadVector(src + size - 16);
+    uint8_t *end = dst + size - 16;
+
+    while (size > 64) {
+        __m128i a = LoadVector(src + 0);
+        __m128i b = LoadVector(src + 16);
+        __m128i c = LoadVector(src + 32);
+        __m128i d = LoadVector(src + 48);
+        StoreVector(dst + 0, a);
+        StoreVector(dst + 16, b);
+        StoreVector(dst + 32, c);
+        StoreVector(dst + 48, d);
+        dst += 64;
+        src += 64;
+        size -= 64;
+    }
+
+    while (size > 16) {
+        StoreVector(dst, LoadVector(src));
+        dst += 16;
+        src += 16;
+        size -= 16;
+    }
+
+    StoreVector(end, tail);
+}
+
+/// @brief Copy more than 32 bytes back to front, safe when @p dst is above @p src.
+static void CopyBackward(uint8_t *dst, const uint8_t *src, size_t size) {
+    __m128i head = LoadVector(src);
+
+    while (size > 64) {
+        size -= 64;
+        __m128i a = LoadVector(src + size + 48);
+        __m128i b = LoadVector(src + size + 32);
+        __m128i c = LoadVector(src + size + 16);
+        __m128i d = LoadVector(src + size + 0);
+        StoreVector(dst + size + 48, a);
+        StoreVector(dst + size + 32, b);
+        StoreVector(dst + size + 16, c);
+        StoreVector(dst + size + 0, d);
+    }
+
+    while (size > 16) {
+        size -= 16;
+        StoreVector(dst + size, LoadVector(src + size));
+    }
+
+    StoreVector(dst, head);
+}
+
+static void SetSmall(uint8_t *dst, uint8_t value, size_t size) {
+    if (size >= 16) {
+        __m128i fill = _mm_set1_epi8(static_cast<char>(value));
+        StoreVector(dst, fill);
+        StoreVector(dst + size - 16, fill);
+    } else if (size >= 8) {
+        uint64_t fill = value * UINT64_C(0x0101010101010101);
+        __builtin_memcpy(dst, &fill, sizeof(fill));
+        __builtin_memcpy(dst + size - 8, &fill, sizeof(fill));
+    } else if (size >= 4) {
+        uint32_t fill = value * UINT32_C(0x01010101);
+        __builtin_memcpy(dst, &fill, sizeof(fill));
+        __builtin_memcpy(dst + size - 4, &fill, sizeof(fill));
+    } else if (size > 0) {
+        dst[0] = value;
+        dst[size / 2] = value;
+        dst[size - 1] = value;
+    }
+}
+
+/// @brief Fill more than 32 bytes, aligning the stores.
+static void SetAligned(uint8_t *dst, uint8_t value, size_t size) {
+    __m128i fill = _mm_set1_epi8(static_cast<char>(value));
+    StoreVector(dst, fill);
+    StoreVector(dst + size - 16, fill);
+
+    uint8_t *end = dst + size - 16;
+    uint8_t *ptr = reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(dst) + 16) & ~uintptr_t(15));
+
+    while (end - ptr > 64) {
+        _mm_store_si128(reinterpret_cast<__m128i *>(ptr + 0), fill);
+        _mm_store_si128(reinterpret_cast<__m128i *>(ptr + 16), fill);
+        _mm_store_si128(reinterpret_cast<__m128i *>(ptr + 32), fill);
+        _mm_store_si128(reinterpret_cast<__m128i *>(ptr + 48), fill);
+        ptr += 64;
+    }
+
+    while (ptr < end) {
+        _mm_store_si128(reinterpret_cast<__m128i *>(ptr), fill);
+        ptr += 16;
+    }
+}
+
+template<size_t kThreshold>
+static void *MemoryCopy(void *dst, const void *src, size_t size) {
+    uint8_t *d = static_cast<uint8_t *>(dst);
+    const uint8_t *s = static_cast<const uint8_t *>(src);
+
+    if (size <= 32) {
+        CopySmall(d, s, size);
+    } else if (size >= kThreshold) {
+        RepMovsb(d, s, size);
+    } else {
+        CopyAligned(d, s, size);
+    }
+
+    return dst;
+}
+
+template<size_t kThreshold>
+static void *MemoryMove(void *dst, const void *src, size_t size) {
+    uint8_t *d = static_cast<uint8_t *>(dst);
+    const uint8_t *s = static_cast<const uint8_t *>(src);
+
+    if (size <= 32) {
+        CopySmall(d, s, size);
+    } else if (reinterpret_cast<uintptr_t>(d) - reinterpret_cast<uintptr_t>(s) >= size) {
+        //
+        // Either dst is below src or the ranges are disjoint, a forward
+        // copy never overwrites bytes it has yet to read.
+        //
+        if (size >= kThreshold) {
+            RepMovsb(d, s, size);
+        } else {
+            CopyForward(d, s, size);
+        }
+    } else {
+        CopyBackward(d, s, size);
+    }
+
+    return dst;
+}
+
+template<size_t kThreshold>
+static void *MemorySet(void *dst, int value, size_t size) {
+    uint8_t *d = static_cast<uint8_t *>(dst);
+    uint8_t byte = static_cast<uint8_t>(value);
+
+    if (size <= 32) {
+        SetSmall(d, byte, size);
+    } else if (size >= kThreshold) {
+        RepStosb(d, byte, size);
+    } else {
+        SetAligned(d, byte, size);
+    }
+
+    return dst;
+}
+
+void *ImplMemoryCopySse2(void *dst, const void *src, size_t size) {
+    return MemoryCopy<kNoThreshold>(dst, src, size);
+}
+
+void *ImplMemoryCopyErms(void *dst, const void *src, size_t size) {
+    return MemoryCopy<kErmsCopyThreshold>(dst, src, size);
+}
+
+void *ImplMemoryCopyFsrm(void *dst, const void *src, size_t size) {
+    return MemoryCopy<kFsrmCopyThreshold>(dst, src, size);
+}
+
+void *ImplMemoryMoveSse2(void *dst, const void *src, size_t size) {
+    return MemoryMove<kNoThreshold>(dst, src, size);
+}
+
+void *ImplMemoryMoveErms(void *dst, const void *src, size_t size) {
+    return MemoryMove<kErmsCopyThreshold>(dst, src, size);
+}
+
+void *ImplMemorySetSse2(void *dst, int value, size_t size) {
+    return MemorySet<kNoThreshold>(dst, value, size);
+}
+
+void *ImplMemorySetErms(void *dst, int value, size_t size) {
+    return MemorySet<kErmsSetThreshold>(dst, value, size);
+}
+
+//
+// SSE2 scanning routines.
+//
+// Every load is an aligned 16 byte vector that contains at least one byte
+// of the input, so no load crosses into a page the input does not touch.
+// The unrolled loops only start once the pointer is aligned to the size
+// of the whole group for the same reason.
+//
+
+STRING_NO_SANITIZE
+static __m128i LoadAligned(const uint8_t *src) {
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(src));
+}
+
+static uint32_t MatchMask(__m128i lhs, __m128i rhs) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)));
+}
+
+/// @brief Zero in every byte of @p data that is either zero or equal to @p needle.
+static __m128i ZeroOrNeedle(__m128i data, __m128i needle) {
+    return _mm_min_epu8(_mm_xor_si128(data, needle), data);
+}
+
+STRING_NO_SANITIZE
+size_t ImplStringLengthSse2(const char *str) {
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(str);
+    const uint8_t *ptr = AlignDown(src, 16);
+    const __m128i zero = _mm_setzero_si128();
+
+    if (uint32_t mask = MatchMask(LoadAligned(ptr), zero) >> (src - ptr)) {
+        return CountTrailingZeros(mask);
+    }
+
+    for (ptr += 16; !IsAligned(ptr, 64); ptr += 16) {
+        if (uint32_t mask = MatchMask(LoadAligned(ptr), zero)) {
+            return (ptr - src) + CountTrailingZeros(mask);
+        }
+    }
+
+    while (true) {
+        __m128i a = LoadAligned(ptr + 0);
+        __m128i b = LoadAligned(ptr + 16);
+        __m128i c = LoadAligned(ptr + 32);
+        __m128i d = LoadAligned(ptr + 48);
+        __m128i min = _mm_min_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d));
+        if (MatchMask(min, zero)) {
+            break;
+        }
+
+        ptr += 64;
+    }
+
+    for (;; ptr += 16) {
+        if (uint32_t mask = MatchMask(LoadAligned(ptr), zero)) {
+            return (ptr - src) + CountTrailingZeros(mask);
+        }
+    }
+}
+
+STRING_NO_SANITIZE
+char *ImplStringFindSse2(const char *str, int c) {
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(str);
+    const uint8_t *ptr = AlignDown(src, 16);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(c));
+
+    auto found = [&](const uint8_t *at) -> char * {
+        // The scan stops at either the character or the terminator.
+        return (*at == static_cast<uint8_t>(c)) ? const_cast<char *>(reinterpret_cast<const char *>(at)) : nullptr;
+    };
+
+    if (uint32_t mask = MatchMask(ZeroOrNeedle(LoadAligned(ptr), needle), zero) >> (src - ptr)) {
+        return found(src + CountTrailingZeros(mask));
+    }
+
+    for (ptr += 16; !IsAligned(ptr, 64); ptr += 16) {
+        if (uint32_t mask = MatchMask(ZeroOrNeedle(LoadAligned(ptr), needle), zero)) {
+            return found(ptr + CountTrailingZeros(mask));
+        }
+    }
+
+    while (true) {
+        __m128i a = ZeroOrNeedle(LoadAligned(ptr + 0), needle);
+        __m128i b = ZeroOrNeedle(LoadAligned(ptr + 16), needle);
+        __m128i c = ZeroOrNeedle(LoadAligned(ptr + 32), needle);
+        __m128i d = ZeroOrNeedle(LoadAligned(ptr + 48), needle);
+        __m128i min = _mm_min_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d));
+        if (MatchMask(min, zero)) {
+            break;
+        }
+
+        ptr += 64;
+    }
+
+    for (;; ptr += 16) {
+        if (uint32_t mask = MatchMask(ZeroOrNeedle(LoadAligned(ptr), needle), zero)) {
+            return found(ptr + CountTrailingZeros(mask));
+        }
+    }
+}
+
+STRING_NO_SANITIZE
+void *ImplMemoryFindSse2(const void *data, int c, size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    const uint8_t *src = static_cast<const uint8_t *>(data);
+    const uint8_t *end = src + size;
+    const uint8_t *ptr = AlignDown(src, 16);
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(c));
+
+    auto found = [&](const uint8_t *at) -> void * {
+        return const_cast<uint8_t *>(FoundBefore(at, end));
+    };
+
+    if (uint32_t mask = MatchMask(LoadAligned(ptr), needle) >> (src - ptr)) {
+        return found(src + CountTrailingZeros(mask));
+    }
+
+    for (ptr += 16; ptr < end && !IsAligned(ptr, 64); ptr += 16) {
+        if (uint32_t mask = MatchMask(LoadAligned(ptr), needle)) {
+            return found(ptr + CountTrailingZeros(mask));
+        }
+    }
+
+    while (ptr < end && size_t(end - ptr) >= 64) {
+        __m128i a = _mm_cmpeq_epi8(LoadAligned(ptr + 0), needle);
+        __m128i b = _mm_cmpeq_epi8(LoadAligned(ptr + 16), needle);
+        __m128i c = _mm_cmpeq_epi8(LoadAligned(ptr + 32), needle);
+        __m128i d = _mm_cmpeq_epi8(LoadAligned(ptr + 48), needle);
+        __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+        if (_mm_movemask_epi8(any)) {
+            break;
+        }
+
+        ptr += 64;
+    }
+
+    for (; ptr < end; ptr += 16) {
+        if (uint32_t mask = MatchMask(LoadAligned(ptr), needle)) {
+            return found(ptr + CountTrailingZeros(mask));
+        }
+    }
+
+    return nullptr;
+}
+
+template<typename T>
+static int CompareBigEndian(const uint8_t *lhs, const uint8_t *rhs) {
+    T l, r;
+    __builtin_memcpy(&l, lhs, sizeof(T));
+    __builtin_memcpy(&r, rhs, sizeof(T));
+
+    if constexpr (sizeof(T) == 8) {
+        l = __builtin_bswap64(l);
+        r = __builtin_bswap64(r);
+    } else {
+        l = __builtin_bswap32(l);
+        r = __builtin_bswap32(r);
+    }
+
+    return (l > r) - (l < r);
+}
+
+/// @brief Compare fewer than 16 bytes.
+static int CompareSmall(const uint8_t *lhs, const uint8_t *rhs, size_t size) {
+    if (size >= 8) {
+        if (int result = CompareBigEndian<uint64_t>(lhs, rhs)) {
+            return result;
+        }
+
+        return CompareBigEndian<uint64_t>(lhs + size - 8, rhs + size - 8);
+    } else if (size >= 4) {
+        if (int result = CompareBigEndian<uint32_t>(lhs, rhs)) {
+            return result;
+        }
+
+        return CompareBigEndian<uint32_t>(lhs + size - 4, rhs + size - 4);
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        if (lhs[i] != rhs[i]) {
+            return lhs[i] - rhs[i];
+        }
+    }
+
+    return 0;
+}
+
+/// @brief Compare the 16 bytes at @p offset, returns true and sets @p result if they differ.
+static bool CompareVector(const uint8_t *lhs, const uint8_t *rhs, size_t offset, int *result) {
+    uint32_t mask = MatchMask(LoadVector(lhs + offset), LoadVector(rhs + offset)) ^ 0xFFFF;
+    if (mask == 0) {
+        return false;
+    }
+
+    size_t index = offset + CountTrailingZeros(mask);
+    *result = lhs[index] - rhs[index];
+    return true;
+}
+
+int ImplMemoryCompareSse2(const void *lhs, const void *rhs, size_t size) {
+    const uint8_t *l = static_cast<const uint8_t *>(lhs);
+    const uint8_t *r = static_cast<const uint8_t *>(rhs);
+
+    if (size < 16) {
+        return CompareSmall(l, r, size);
+    }
+
+    int result = 0;
+    size_t offset = 0;
+    for (; size - offset >= 64; offset += 64) {
+        __m128i a = _mm_cmpeq_epi8(LoadVector(l + offset + 0), LoadVector(r + offset + 0));
+        __m128i b = _mm_cmpeq_epi8(LoadVector(l + offset + 16), LoadVector(r + offset + 16));
+        __m128i c = _mm_cmpeq_epi8(LoadVector(l + offset + 32), LoadVector(r + offset + 32));
+        __m128i d = _mm_cmpeq_epi8(LoadVector(l + offset + 48), LoadVector(r + offset + 48));
+        __m128i all = _mm_and_si128(_mm_and_si128(a, b), _mm_and_si128(c, d));
+        if (_mm_movemask_epi8(all) != 0xFFFF) {
+            break;
+        }
+    }
+
+    for (; size - offset >= 16; offset += 16) {
+        if (CompareVector(l, r, offset, &result)) {
+            return result;
+        }
+    }
+
+    // The last vector overlaps bytes that are already known to be equal.
+    if (offset != size && CompareVector(l, r, size - 16, &result)) {
+        return result;
+    }
+
+    return 0;
+}
+
+//
+// AVX2 scanning routines.
+//
+// These follow the SSE2 routines with 32 byte vectors, see above for why
+// the loads are safe.
+//
+
+#define STRING_AVX2 __attribute__((__target__("avx2")))
+
+STRING_NO_SANITIZE STRING_AVX2
+static __m256i LoadAligned256(const uint8_t *src) {
+    return _mm256_load_si256(reinterpret_cast<const __m256i *>(src));
+}
+
+STRING_AVX2
+static uint32_t MatchMask256(__m256i lhs, __m256i rhs) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs)));
+}
+
+STRING_AVX2
+static __m256i ZeroOrNeedle256(__m256i data, __m256i needle) {
+    return _mm256_min_epu8(_mm256_xor_si256(data, needle), data);
+}
+
+STRING_NO_SANITIZE STRING_AVX2
+size_t ImplStringLengthAvx2(const char *str) {
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(str);
+    const uint8_t *ptr = AlignDown(src, 32);
+    const __m256i zero = _mm256_setzero_si256();
+
+    if (uint32_t mask = MatchMask256(LoadAligned256(ptr), zero) >> (src - ptr)) {
+        return CountTrailingZeros(mask);
+    }
+
+    for (ptr += 32; !IsAligned(ptr, 128); ptr += 32) {
+        if (uint32_t mask = MatchMask256(LoadAligned256(ptr), zero)) {
+            return (ptr - src) + CountTrailingZeros(mask);
+        }
+    }
+
+    while (true) {
+        __m256i a = LoadAligned256(ptr + 0);
+        __m256i b = LoadAligned256(ptr + 32);
+        __m256i c = LoadAligned256(ptr + 64);
+        __m256i d = LoadAligned256(ptr + 96);
+        __m256i min = _mm256_min_epu8(_mm256_min_epu8(a, b), _mm256_min_epu8(c, d));
+        if (MatchMask256(min, zero)) {
+            break;
+        }
+
+        ptr += 128;
+    }
+
+    for (;; ptr += 32) {
+        if (uint32_t mask = MatchMask256(LoadAligned256(ptr), zero)) {
+            return (ptr - src) + CountTrailingZeros(mask);
+        }
+    }
+}
+
+STRING_NO_SANITIZE STRING_AVX2
+char *ImplStringFindAvx2(const char *str, int c) {
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(str);
+    const uint8_t *ptr = AlignDown(src, 32);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i needle = _mm256_set1_epi8(static_cast<char>(c));
+
+    auto found = [&](const uint8_t *at) -> char * {
+        return (*at == static_cast<uint8_t>(c)) ? const_cast<char *>(reinterpret_cast<const char *>(at)) : nullptr;
+    };
+
+    if (uint32_t mask = MatchMask256(ZeroOrNeedle256(LoadAligned256(ptr), needle), zero) >> (src - ptr)) {
+        return found(src + CountTrailingZeros(mask));
+    }
+
+    for (ptr += 32; !IsAligned(ptr, 128); ptr += 32) {
+        if (uint32_t mask = MatchMask256(ZeroOrNeedle256(LoadAligned256(ptr), needle), zero)) {
+            return found(ptr + CountTrailingZeros(mask));
+        }
+    }
+
+    while (true) {
+        __m256i a = ZeroOrNeedle256(LoadAligned256(ptr + 0), needle);
+        __m256i b = ZeroOrNeedle256(LoadAligned256(ptr + 32), needle);
+        __m256i c = ZeroOrNeedle256(LoadAligned256(ptr + 64), needle);
+        __m256i d = ZeroOrNeedle256(LoadAligned256(ptr + 96), needle);
+        __m256i min = _mm256_min_epu8(_mm256_min_epu8(a, b), _mm256_min_epu8(c, d));
+        if (MatchMask256(min, zero)) {
+            break;
+        }
+
+        ptr += 128;
+    }
+
+    for (;; ptr += 32) {
+        if (uint32_t mask = MatchMask256(ZeroOrNeedle256(LoadAligned256(ptr), needle), zero)) {
+            return found(ptr + CountTrailingZeros(mask));
+        }
+    }
+}
+
+STRING_NO_SANITIZE STRING_AVX2
+void *ImplMemoryFindAvx2(const void *data, int c, size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    const uint8_t *src = static_cast<const uint8_t *>(data);
+    const uint8_t *end = src + size;
+    const uint8_t *ptr = AlignDown(src, 32);
+    const __m256i needle = _mm256_set1_epi8(static_cast<char>(c));
+
+    auto found = [&](const uint8_t *at) -> void * {
+        return const_cast<uint8_t *>(FoundBefore(at, end));
+    };
+
+    if (uint32_t mask = MatchMask256(LoadAligned256(ptr), needle) >> (src - ptr)) {
+        return found(src + CountTrailingZeros(mask));
+    }
+
+    for (ptr += 32; ptr < end && !IsAligned(ptr, 128); ptr += 32) {
+        if (uint32_t mask = MatchMask256(LoadAligned256(ptr), needle)) {
+            return found(ptr + CountTrailingZeros(mask));
+        }
+    }
+
+    while (ptr < end && size_t(end - ptr) >= 128) {
+        __m256i a = _mm256_cmpeq_epi8(LoadAligned256(ptr + 0), needle);
+        __m256i b = _mm256_cmpeq_epi8(LoadAligned256(ptr + 32), needle);
+        __m256i c = _mm256_cmpeq_epi8(LoadAligned256(ptr + 64), needle);
+        __m256i d = _mm256_cmpeq_epi8(LoadAligned256(ptr + 96), needle);
+        __m256i any = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+        if (_mm256_movemask_epi8(any)) {
+            break;
+        }
+
+        ptr += 128;
+    }
+
+    for (; ptr < end; ptr += 32) {
+        if (uint32_t mask = MatchMask256(LoadAligned256(ptr), needle)) {
+            return found(ptr + CountTrailingZeros(mask));
+        }
+    }
+
+    return nullptr;
+}
+
+STRING_AVX2
+static __m256i LoadVector256(const uint8_t *src) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+}
+
+STRING_AVX2
+static bool CompareVector256(const uint8_t *lhs, const uint8_t *rhs, size_t offset, int *result) {
+    uint32_t mask = ~MatchMask256(LoadVector256(lhs + offset), LoadVector256(rhs + offset));
+    if (mask == 0) {
+        return false;
+    }
+
+    size_t index = offset + CountTrailingZeros(mask);
+    *result = lhs[index] - rhs[index];
+    return true;
+}
+
+STRING_AVX2
+int ImplMemoryCompareAvx2(const void *lhs, const void *rhs, size_t size) {
+    const uint8_t *l = static_cast<const uint8_t *>(lhs);
+    const uint8_t *r = static_cast<const uint8_t *>(rhs);
+
+    if (size < 32) {
+        return ImplMemoryCompareSse2(lhs, rhs, size);
+    }
+
+    int result = 0;
+    size_t offset = 0;
+    for (; size - offset >= 128; offset += 128) {
+        __m256i a = _mm256_cmpeq_epi8(LoadVector256(l + offset + 0), LoadVector256(r + offset + 0));
+        __m256i b = _mm256_cmpeq_epi8(LoadVector256(l + offset + 32), LoadVector256(r + offset + 32));
+        __m256i c = _mm256_cmpeq_epi8(LoadVector256(l + offset + 64), LoadVector256(r + offset + 64));
+        __m256i d = _mm256_cmpeq_epi8(LoadVector256(l + offset + 96), LoadVector256(r + offset + 96));
+        __m256i all = _mm256_and_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, d));
+        if (uint32_t(_mm256_movemask_epi8(all)) != UINT32_MAX) {
+            break;
+        }
+    }
+
+    for (; size - offset >= 32; offset += 32) {
+        if (CompareVector256(l, r, offset, &result)) {
+            return result;
+        }
+    }
+
+    if (offset != size && CompareVector256(l, r, size - 32, &result)) {
+        return result;
+    }
+
+    return 0;
+}
+
+//
+// Routine selection.
+//
+
+static constexpr uint32_t kCpuidOsxsave = (1u << 27); // leaf 1 ecx
+static constexpr uint32_t kCpuidAvx = (1u << 28);     // leaf 1 ecx
+static constexpr uint32_t kCpuidAvx2 = (1u << 5);     // leaf 7 ebx
+static constexpr uint32_t kCpuidErms = (1u << 9);     // leaf 7 ebx
+static constexpr uint32_t kCpuidFsrm = (1u << 4);     // leaf 7 edx
+
+static constexpr uint64_t kXcr0SseAvx = (1u << 1) | (1u << 2);
+
+static uint64_t ReadXcr0() {
+    uint32_t lo, hi;
+    asm volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (uint64_t(hi) << 32) | lo;
+}
+
+StringFeatures ImplDetectStringFeatures() {
+    StringFeatures features{};
+    unsigned eax, ebx, ecx, edx;
+
+    if (__get_cpuid_max(0, nullptr) < 7) {
+        return features;
+    }
+
+    __cpuid(1, eax, ebx, ecx, edx);
+    bool avx = (ecx & kCpuidOsxsave) && (ecx & kCpuidAvx);
+
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    features.erms = ebx & kCpuidErms;
+    features.fsrm = edx & kCpuidFsrm;
+
+    //
+    // The upper halves of the ymm registers are only saved on context
+    // switch if the OS enabled them in xcr0.
+    //
+    if (avx && (ebx & kCpuidAvx2)) {
+        features.avx2 = (ReadXcr0() & kXcr0SseAvx) == kXcr0SseAvx;
+    }
+
+    return features;
+}
+
+StringRoutines ImplSelectStringRoutines(StringFeatures features) {
+    StringRoutines routines = {
+        .strlen = ImplStringLengthSse2,
+        .strchr = ImplStringFindSse2,
+        .memchr = ImplMemoryFindSse2,
+        .memcmp = ImplMemoryCompareSse2,
+        .memcpy = ImplMemoryCopySse2,
+        .memmove = ImplMemoryMoveSse2,
+        .memset = ImplMemorySetSse2,
+    };
+
+    if (features.erms) {
+        routines.memcpy = ImplMemoryCopyErms;
+        routines.memmove = ImplMemoryMoveErms;
+        routines.memset = ImplMemorySetErms;
+    }
+
+    if (features.fsrm) {
+        routines.memcpy = ImplMemoryCopyFsrm;
+    }
+
+    if (features.avx2) {
+        routines.strlen = ImplStringLengthAvx2;
+        routines.strchr = ImplStringFindAvx2;
+        routines.memchr = ImplMemoryFindAvx2;
+        routines.memcmp = ImplMemoryCompareAvx2;
+    }
+
+    return routines;
+}
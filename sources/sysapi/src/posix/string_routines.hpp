@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Vectorized string and memory routines.
+//
+// These are plain C++ functions rather than the public symbols so that they can
+// be built and tested natively next to the host libc. string.cpp selects between
+// them on the first call to each routine.
+//
+// The scanning routines (strlen, strchr, memchr) read whole aligned vectors,
+// which may read past the end of the string but never into the next page.
+// This is invisible to the program but not to address sanitizers, so these
+// routines are built without instrumentation.
+//
+
+/// @brief Processor features that affect which routines are selected.
+struct StringFeatures {
+    /// @brief Enhanced rep movsb and rep stosb.
+    bool erms;
+
+    /// @brief Fast short rep movsb.
+    bool fsrm;
+
+    /// @brief AVX2 is supported and its state is enabled by the OS.
+    bool avx2;
+};
+
+/// @brief The set of routines used by string.cpp.
+struct StringRoutines {
+    size_t (*strlen)(const char *);
+    char *(*strchr)(const char *, int);
+    void *(*memchr)(const void *, int, size_t);
+    int (*memcmp)(const void *, const void *, size_t);
+    void *(*memcpy)(void *, const void *, size_t);
+    void *(*memmove)(void *, const void *, size_t);
+    void *(*memset)(void *, int, size_t);
+};
+
+/// @brief Query the features of the current processor with cpuid and xgetbv.
+StringFeatures ImplDetectStringFeatures();
+
+/// @brief Select the fastest routines for the given features.
+StringRoutines ImplSelectStringRoutines(StringFeatures features);
+
+size_t ImplStringLengthSse2(const char *str);
+char *ImplStringFindSse2(const char *str, int c);
+void *ImplMemoryFindSse2(const void *ptr, int c, size_t size);
+int ImplMemoryCompareSse2(const void *lhs, const void *rhs, size_t size);
+
+size_t ImplStringLengthAvx2(const char *str);
+char *ImplStringFindAvx2(const char *str, int c);
+void *ImplMemoryFindAvx2(const void *ptr, int c, size_t size);
+int ImplMemoryCompareAvx2(const void *lhs, const void *rhs, size_t size);
+
+/// @brief Copy with vector moves only.
+void *ImplMemoryCopySse2(void *dst, const void *src, size_t size);
+
+/// @brief Copy with vector moves, using rep movsb for large copies.
+void *ImplMemoryCopyErms(void *dst, const void *src, size_t size);
+
+/// @brief Copy with vector moves, using rep movsb for medium and large copies.
+void *ImplMemoryCopyFsrm(void *dst, const void *src, size_t size);
+
+void *ImplMemoryMoveSse2(void *dst, const void *src, size_t size);
+void *ImplMemoryMoveErms(void *dst, const void *src, size_t size);
+
+void *ImplMemorySetSse2(void *dst, int value, size_t size);
+void *ImplMemorySetErms(void *dst, int value, size_t size);
@@ -0,0 +1,215 @@
+#include "rtld/load/link.hpp"
+
+#include <cpuid.h>
+#include <string.h>
+
+namespace elf = os::elf;
+
+static RtldSoImage *gImageHead = nullptr;
+static RtldSoImage *gImageTail = nullptr;
+
+uint64_t RtldLazySaveSize = 0;
+uint32_t RtldLazyUseXsave = 0;
+
+/// @brief The size of the general purpose registers saved by the trampoline.
+static constexpr uint64_t kLazyRegisterSize = 64;
+
+/// @brief The size of the legacy fxsave area.
+static constexpr uint64_t kFxsaveSize = 512;
+
+/// @brief The xsave header follows the legacy area and must be zero before the first xsave.
+static constexpr uint64_t kXsaveHeaderSize = 64;
+
+static constexpr uint32_t kCpuidXsave = (1 << 26);
+static constexpr uint32_t kCpuidOsxsave = (1 << 27);
+
+/// @brief Size the register save area of the lazy binding trampoline.
+///
+/// The resolver calls into the string routines, which use the full width of
+/// the vector registers and clear their upper halves on return. Any vector
+/// argument to the import must survive that, so the trampoline saves every
+/// component the OS enabled rather than only xmm0-7.
+static void RtldInitLazyState() {
+    if (RtldLazySaveSize != 0) {
+        return;
+    }
+
+    uint64_t stateSize = kFxsaveSize;
+    uint32_t useXsave = 0;
+
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & kCpuidXsave) && (ecx & kCpuidOsxsave)) {
+        // ebx of leaf 0xd is the size needed for the components currently enabled in xcr0
+        __cpuid_count(0xD, 0, eax, ebx, ecx, edx);
+        stateSize = (ebx > kFxsaveSize + kXsaveHeaderSize) ? ebx : kFxsaveSize + kXsaveHeaderSize;
+        useXsave = 1;
+    }
+
+    RtldLazyUseXsave = useXsave;
+    __atomic_store_n(&RtldLazySaveSize, kLazyRegisterSize + ((stateSize + 63) & ~uint64_t(63)), __ATOMIC_RELEASE);
+}
+
+void RtldLinkImage(RtldSoImage *image) {
+    image->prev = gImageTail;
+    image->next = nullptr;
+
+    if (gImageTail != nullptr) {
+        gImageTail->next = image;
+    } else {
+        gImageHead = image;
+    }
+
+    gImageTail = image;
+}
+
+void RtldUnlinkImage(RtldSoImage *image) {
+    if (image->prev != nullptr) {
+        image->prev->next = image->next;
+    } else {
+        gImageHead = image->next;
+    }
+
+    if (image->next != nullptr) {
+        image->next->prev = image->prev;
+    } else {
+        gImageTail = image->prev;
+    }
+}
+
+const elf::Symbol *RtldImageFindSymbol(const RtldSoImage *image, const char *front, const char *back) {
+    if (image->gnuHash.isValid()) {
+        return image->gnuHash.find(image->symtab, image->strtab, front, back);
+    }
+
+    if (image->sysvHash.isValid()) {
+        return image->sysvHash.find(image->symtab, image->strtab, front, back);
+    }
+
+    return nullptr;
+}
+
+/// @brief Find the definition of a symbol in the global scope.
+static OsStatus RtldResolveSymbol(const char *front, const char *back, uintptr_t *outAddress) {
+    for (const RtldSoImage *image = gImageHead; image != nullptr; image = image->next) {
+        if (const elf::Symbol *symbol = RtldImageFindSymbol(image, front, back)) {
+            *outAddress = image->base + symbol->value;
+            return OsStatusSuccess;
+        }
+    }
+
+    return OsStatusNotFound;
+}
+
+/// @brief Find the address a relocation against symbol @p index refers to.
+static OsStatus RtldResolveImport(const RtldSoImage *image, uint32_t index, uintptr_t *outAddress) {
+    const elf::Symbol &symbol = image->symtab[index];
+
+    // Local symbols never leave the image and need no lookup.
+    if (symbol.binding() == elf::SymbolBinding::eLocal) {
+        *outAddress = image->base + symbol.value;
+        return OsStatusSuccess;
+    }
+
+    const char *name = image->strtab + symbol.name;
+    if (OsStatus status = RtldResolveSymbol(name, name + strlen(name), outAddress)) {
+        if (symbol.binding() == elf::SymbolBinding::eWeak) {
+            *outAddress = 0;
+            return OsStatusSuccess;
+        }
+
+        RtldPrintf("Unresolved symbol: %s", name);
+        return status;
+    }
+
+    return OsStatusSuccess;
+}
+
+static OsStatus RtldApplyRelocation(const RtldSoImage *image, const elf::Rela &rela) {
+    uint64_t *target = reinterpret_cast<uint64_t*>(image->base + rela.offset);
+    uintptr_t address = 0;
+
+    switch (elf::Amd64Relocation(rela.type())) {
+    case elf::Amd64Relocation::eNone:
+        return OsStatusSuccess;
+
+    case elf::Amd64Relocation::eRelative:
+        *target = image->base + rela.addend;
+        return OsStatusSuccess;
+
+    case elf::Amd64Relocation::e64:
+        if (OsStatus status = RtldResolveImport(image, rela.symbol(), &address)) {
+            return status;
+        }
+
+        *target = address + rela.addend;
+        return OsStatusSuccess;
+
+    case elf::Amd64Relocation::eGlobalData:
+    case elf::Amd64Relocation::eJumpSlot:
+        if (OsStatus status = RtldResolveImport(image, rela.symbol(), &address)) {
+            return status;
+        }
+
+        *target = address;
+        return OsStatusSuccess;
+
+    default:
+        RtldPrintf("Unsupported relocation type %u", rela.type());
+        return OsStatusNotSupported;
+    }
+}
+
+OsStatus RtldRelocateImage(RtldSoImage *image) {
+    for (size_t i = 0; i < image->relaCount; i++) {
+        if (OsStatus status = RtldApplyRelocation(image, image->rela[i])) {
+            return status;
+        }
+    }
+
+    if (image->jmprelCount == 0) {
+        return OsStatusSuccess;
+    }
+
+    if (image->bindNow || image->pltgot == nullptr) {
+        for (size_t i = 0; i < image->jmprelCount; i++) {
+            if (OsStatus status = RtldApplyRelocation(image, image->jmprel[i])) {
+                return status;
+            }
+        }
+
+        return OsStatusSuccess;
+    }
+
+    for (size_t i = 0; i < image->jmprelCount; i++) {
+        const elf::Rela &rela = image->jmprel[i];
+        if (elf::Amd64Relocation(rela.type()) != elf::Amd64Relocation::eJumpSlot) {
+            return OsStatusNotSupported;
+        }
+
+        // The slot holds the link time address of the push in its PLT stub.
+        uint64_t *slot = reinterpret_cast<uint64_t*>(image->base + rela.offset);
+        *slot += image->base;
+    }
+
+    RtldInitLazyState();
+
+    image->pltgot[1] = reinterpret_cast<uint64_t>(image);
+    image->pltgot[2] = reinterpret_cast<uint64_t>(&RtldLazyTrampoline);
+
+    return OsStatusSuccess;
+}
+
+extern "C" uintptr_t RtldLazyBind(RtldSoImage *image, uint64_t index) {
+    const elf::Rela &rela = image->jmprel[index];
+
+    uintptr_t address = 0;
+    if (RtldResolveImport(image, rela.symbol(), &address) != OsStatusSuccess || address == 0) {
+        RtldLazyBindFailed(image, index);
+    }
+
+    // Another thread may be binding the same slot, they will both write the same address.
+    uint64_t *slot = reinterpret_cast<uint64_t*>(image->base + rela.offset);
+    __atomic_store_n(slot, address, __ATOMIC_RELEASE);
+
+    return address;
+}
@@ -1,6 +1,8 @@
 #include "rtld/rtld.h"
 
 #include "rtld/load/elf.hpp"
+#include "rtld/load/hash.hpp"
+#include "rtld/load/link.hpp"
 
 #include "common/util/util.hpp"
 #include "common/util/defer.hpp"
@@ -15,6 +17,7 @@
 
 #include <span>
 #include <stdlib.h>
+#include <string.h>
 
 #define STB_SPRINTF_IMPLEMENTATION 1
 #define STB_SPRINTF_STATIC 1
@@ -22,7 +25,7 @@
 
 namespace elf = os::elf;
 
-static void RtldPrintf(const char *fmt, ...) {
+void RtldPrintf(const char *fmt, ...) {
     char buffer[1024];
     va_list args;
     va_start(args, fmt);
@@ -143,44 +146,6 @@ static OsStatus ElfReadHeader(OsDeviceHandle device, elf::Header *result) {
     return OsStatusSuccess;
 }
 
-#if 0
-static OsStatus RemoteMemCopy(void *dst, const void *src, size_t size, OsProcessHandle process) {
-    OsVmemMapInfo mapSourceInfo {
-        .SrcAddress = OsAddress(src),
-        .Size = size,
-        .Access = eOsMemoryRead,
-        .Source = process,
-    };
-
-    OsVmemMapInfo mapDestinationInfo {
-        .SrcAddress = OsAddress(dst),
-        .Size = size,
-        .Access = eOsMemoryWrite,
-        .Source = process,
-    };
-
-    void *sourceMapping = nullptr;
-    if (OsStatus status = OsVmemMap(mapSourceInfo, &sourceMapping)) {
-        RtldPrintf("Failed to map source memory for remote copy: ", OsStatusId(status));
-        return status;
-    }
-
-    void *destinationMapping = nullptr;
-    if (OsStatus status = OsVmemMap(mapDestinationInfo, &destinationMapping)) {
-        RtldPrintf("Failed to map destination memory for remote copy: ", OsStatusId(status));
-        OsVmemRelease(sourceMapping, size);
-        return status;
-    }
-
-    memcpy(destinationMapping, sourceMapping, size);
-
-    OsVmemRelease(sourceMapping, size);
-    OsVmemRelease(destinationMapping, size);
-
-    return OsStatusSuccess;
-}
-#endif
-
 static OsStatus RtldTlsInit(OsDeviceHandle file, OsProcessHandle process, const elf::ProgramHeader &ph, RtldTlsInitInfo *tlsInfo) {
     void *initAddress = (void*)ph.vaddr;
 #if 0
@@ -251,152 +216,275 @@ static OsStatus RtldGetMemoryRange(std::span<const elf::ProgramHeader> phs, size
     return OsStatusSuccess;
 }
 
-static OsStatus RtldMapProgram(OsDeviceHandle file, OsProcessHandle process, uintptr_t *entry, RtldTlsInitInfo *tlsInfo) {
-    elf::Header header;
+static constexpr size_t kPageSize = 0x1000;
 
-    if (OsStatus status = ElfReadHeader(file, &header)) {
-        OsDebugMessage(eOsLogInfo, "Failed to read ELF header");
-        return status;
+static OsStatus ElfReadProgramHeaders(OsDeviceHandle device, const elf::Header &header, elf::ProgramHeader **result) {
+    elf::ProgramHeader *phs = static_cast<elf::ProgramHeader*>(malloc(sizeof(elf::ProgramHeader) * header.phnum));
+    if (phs == nullptr) {
+        return OsStatusOutOfMemory;
     }
 
-    if (header.phnum == 0) {
-        return OsStatusInvalidData;
+    if (OsStatus status = DeviceRead(device, header.phoff, header.phnum, phs)) {
+        free(phs);
+        return status;
     }
 
-    void *elfPhMappingBase = nullptr;
+    *result = phs;
+    return OsStatusSuccess;
+}
+
+static OsMemoryAccess SegmentAccess(const elf::ProgramHeader &ph) {
+    OsMemoryAccess access = eOsMemoryNoAccess;
+    if (ph.flags & elf::eProgramExecute)
+        access |= eOsMemoryExecute;
+    if (ph.flags & elf::eProgramWrite)
+        access |= eOsMemoryWrite;
+    if (ph.flags & elf::eProgramRead)
+        access |= eOsMemoryRead;
+
+    return access;
+}
+
+/// @brief Map part of another process into this process to write to it.
+///
+/// The window is page aligned, @p outAddress points to @p address inside it.
+static OsStatus RtldMapWindow(OsProcessHandle process, uintptr_t address, size_t size, void **outBase, size_t *outSize, char **outAddress) {
+    uintptr_t front = sm::rounddown<uintptr_t>(address, kPageSize);
+    uintptr_t back = sm::roundup<uintptr_t>(address + size, kPageSize);
+
     OsVmemMapInfo mapInfo {
-        .SrcAddress = sm::rounddown(header.phoff, UINT64_C(0x1000)),
-        .Size = sm::roundup(OsSize(header.phnum * header.phentsize) + (header.phoff % 0x1000), UINT64_C(0x1000)),
-        .Access = eOsMemoryRead,
-        .Source = file,
+        .SrcAddress = front,
+        .Size = back - front,
+        .Access = eOsMemoryRead | eOsMemoryWrite,
+        .Source = process,
     };
 
-    if (OsStatus status = OsVmemMap(mapInfo, &elfPhMappingBase)) {
-        OsDebugMessage(eOsLogInfo, "Failed to map ELF program headers");
+    void *base = nullptr;
+    if (OsStatus status = OsVmemMap(mapInfo, &base)) {
         return status;
     }
 
-    void *elfPhMapping = (void*)((uintptr_t)elfPhMappingBase + (header.phoff % 0x1000));
+    *outBase = base;
+    *outSize = back - front;
+    *outAddress = static_cast<char*>(base) + (address - front);
+    return OsStatusSuccess;
+}
 
-    defer {
-        OsVmemRelease(elfPhMappingBase, OsSize(header.phnum * header.phentsize));
-    };
+/// @brief The state shared by all segments of one image while it is mapped.
+struct RtldMapContext {
+    OsDeviceHandle file;
 
-    *entry = header.entry;
-    std::span<elf::ProgramHeader> phs(reinterpret_cast<elf::ProgramHeader*>(elfPhMapping), header.phnum);
+    /// @brief The process the image is mapped into, must be a valid handle.
+    OsProcessHandle process;
 
-    size_t memoryBegin = 0;
-    size_t memoryEnd = 0;
-    if (OsStatus status = RtldGetMemoryRange(phs, &memoryBegin, &memoryEnd)) {
-        OsDebugMessage(eOsLogInfo, "Failed to get memory range");
+    /// @brief The difference between the addresses in the image and where it was mapped.
+    uintptr_t bias;
+
+    /// @brief Has the bias been chosen, if not the first segment picks it.
+    bool placed;
+};
+
+/// @brief Create anonymous memory for a segment and read the file contents into it.
+///
+/// Used when the file offset and virtual address of a segment are not congruent
+/// modulo the page size, so the pages of the file cannot be mapped directly.
+static OsStatus RtldCopySegment(RtldMapContext *context, const elf::ProgramHeader &ph) {
+    uintptr_t front = sm::rounddown<uintptr_t>(ph.vaddr, kPageSize);
+    uintptr_t back = sm::roundup<uintptr_t>(ph.vaddr + ph.memsz, kPageSize);
+
+    OsVmemCreateInfo createInfo {
+        .BaseAddress = context->placed ? OsAnyPointer(front + context->bias) : nullptr,
+        .Size = back - front,
+        .Access = SegmentAccess(ph) | eOsMemoryCommit | eOsMemoryDiscard,
+        .Process = context->process,
+    };
+
+    void *address = nullptr;
+    if (OsStatus status = OsVmemCreate(createInfo, &address)) {
         return status;
     }
 
-    RtldPrintf("Allocating memory: %p-%p", (void*)memoryBegin, (void*)memoryEnd);
+    if (!context->placed) {
+        context->bias = uintptr_t(address) - front;
+        context->placed = true;
+    }
 
-    OsVmemCreateInfo vmemGuestCreateInfo {
-        .BaseAddress = OsAnyPointer(memoryBegin),
-        .Size = memoryEnd - memoryBegin,
-        .Access = eOsMemoryRead | eOsMemoryWrite | eOsMemoryExecute | eOsMemoryCommit | eOsMemoryDiscard,
-        .Process = process,
-    };
-    void *guestAddress = nullptr;
-    if (OsStatus status = OsVmemCreate(vmemGuestCreateInfo, &guestAddress)) {
-        OsDebugMessage(eOsLogInfo, "Failed to create guest memory");
+    if (ph.filesz == 0) {
+        return OsStatusSuccess;
+    }
+
+    void *window = nullptr;
+    size_t windowSize = 0;
+    char *data = nullptr;
+    if (OsStatus status = RtldMapWindow(context->process, ph.vaddr + context->bias, ph.filesz, &window, &windowSize, &data)) {
         return status;
     }
 
-    if (guestAddress != (void*)memoryBegin) {
-        OsDebugMessage(eOsLogInfo, "Guest memory allocated at wrong address");
+    defer {
+        OsVmemRelease(window, windowSize);
+    };
+
+    return DeviceRead(context->file, ph.offset, ph.filesz, data);
+}
+
+/// @brief Map a PT_LOAD segment into the target process.
+///
+/// The file backed part of the segment is mapped straight from the file handle
+/// rather than allocated and copied, each process gets its own private pages so
+/// relocations never reach the file. Only the partial page at the end of the
+/// file contents and the bss past it are touched by the loader.
+static OsStatus RtldMapSegment(RtldMapContext *context, const elf::ProgramHeader &ph) {
+    if (ph.memsz < ph.filesz) {
         return OsStatusInvalidData;
     }
 
-    OsVmemMapInfo vmemGuestMapInfo {
-        .SrcAddress = OsAddress(guestAddress),
-        .Size = memoryEnd - memoryBegin,
-        .Access = eOsMemoryWrite,
-        .Source = process,
-    };
-    if (OsStatus status = OsVmemMap(vmemGuestMapInfo, &guestAddress)) {
-        OsDebugMessage(eOsLogInfo, "Failed to map guest memory");
-        return status;
+    uintptr_t front = sm::rounddown<uintptr_t>(ph.vaddr, kPageSize);
+    uintptr_t back = sm::roundup<uintptr_t>(ph.vaddr + ph.memsz, kPageSize);
+    size_t delta = ph.vaddr - front;
+
+    if ((ph.offset % kPageSize) != delta) {
+        RtldPrintf("Segment %p is not page congruent with its file offset, copying it", (void*)ph.vaddr);
+        return RtldCopySegment(context, ph);
     }
 
-    for (const elf::ProgramHeader &ph : phs) {
-        if (ph.type != elf::ProgramHeaderType::eLoad) {
-            continue;
-        }
+    //
+    // Read only segments may be mapped straight from the media the file is
+    // stored on, so a bss that starts inside the last file page can not be
+    // cleared in place.
+    //
+    size_t fileTail = sm::roundup<uintptr_t>(ph.vaddr + ph.filesz, kPageSize) - (ph.vaddr + ph.filesz);
+    if (!(ph.flags & elf::eProgramWrite) && ph.memsz > ph.filesz && ph.filesz != 0 && fileTail != 0) {
+        return RtldCopySegment(context, ph);
+    }
 
-        char *base = reinterpret_cast<char*>(guestAddress) + (ph.vaddr - memoryBegin);
-        OsDeviceReadRequest read {
-            .BufferFront = base,
-            .BufferBack = base + ph.filesz,
-            .Offset = ph.offset,
-            .Timeout = OS_TIMEOUT_INFINITE,
-        };
+    uintptr_t fileBack = front;
 
-        RtldPrintf("Loading segment: %p-%p to %p", (void*)ph.vaddr, (void*)(ph.vaddr + ph.memsz), base);
+    if (ph.filesz != 0) {
+        //
+        // The size is not rounded up, the file may end inside the last page
+        // and reading past the end of the file is an error.
+        //
+        OsVmemMapInfo mapInfo {
+            .SrcAddress = ph.offset - delta,
+            .DstAddress = context->placed ? front + context->bias : 0,
+            .Size = ph.filesz + delta,
+            .Access = SegmentAccess(ph),
+            .Source = context->file,
+            .Process = context->process,
+        };
 
-        OsSize size = 0;
-        if (OsStatus status = OsDeviceRead(file, read, &size)) {
-            OsDebugMessage(eOsLogInfo, "Failed to read program header");
+        void *address = nullptr;
+        if (OsStatus status = OsVmemMap(mapInfo, &address)) {
             return status;
         }
 
-        if (size != ph.filesz) {
-            OsDebugMessage(eOsLogInfo, "Failed to read full program header");
-            return OsStatusInvalidData;
+        if (!context->placed) {
+            context->bias = uintptr_t(address) - front;
+            context->placed = true;
         }
 
-        RtldPrintf("First 16 bytes: %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x",
-            (uint8_t)base[0], (uint8_t)base[1], (uint8_t)base[2], (uint8_t)base[3],
-            (uint8_t)base[4], (uint8_t)base[5], (uint8_t)base[6], (uint8_t)base[7],
-            (uint8_t)base[8], (uint8_t)base[9], (uint8_t)base[10], (uint8_t)base[11],
-            (uint8_t)base[12], (uint8_t)base[13], (uint8_t)base[14], (uint8_t)base[15]);
-
-
-#if 0
-        OsMemoryAccess access = eOsMemoryNoAccess;
-        if (ph.flags & (1 << 0))
-            access |= eOsMemoryExecute;
-        if (ph.flags & (1 << 1))
-            access |= eOsMemoryWrite;
-        if (ph.flags & (1 << 2))
-            access |= eOsMemoryRead;
-
-        if (ph.memsz != ph.filesz) {
-            OsVmemCreateInfo vmemGuestCreateInfo {
-                .BaseAddress = reinterpret_cast<void*>(ph.vaddr),
-                .Size = sm::roundup<uint64_t>(ph.memsz, 0x1000),
-                .Access = access | eOsMemoryCommit | eOsMemoryDiscard,
-                .Process = process,
-            };
-
-            void *guestAddress = nullptr;
-            if (OsStatus status = OsVmemCreate(vmemGuestCreateInfo, &guestAddress)) {
-                OsDebugMessage(eOsLogInfo, "Failed to create guest memory for program header");
+        fileBack = sm::roundup<uintptr_t>(ph.vaddr + ph.filesz, kPageSize);
+
+        //
+        // The rest of the last file page holds whatever follows the segment in
+        // the file, or nothing at all if the file ended. When that page is also
+        // the start of the bss it must be cleared.
+        //
+        if (ph.memsz > ph.filesz && fileTail != 0) {
+            void *window = nullptr;
+            size_t windowSize = 0;
+            char *data = nullptr;
+            if (OsStatus status = RtldMapWindow(context->process, ph.vaddr + ph.filesz + context->bias, fileTail, &window, &windowSize, &data)) {
                 return status;
             }
+
+            memset(data, 0, fileTail);
+            OsVmemRelease(window, windowSize);
         }
+    }
 
-        OsVmemMapInfo vmemGuestMapInfo {
-            .SrcAddress = ph.offset,
-            .DstAddress = ph.vaddr,
-            .Size = ph.filesz,
-            .Access = access,
-            .Source = file,
-            .Process = process,
+    if (back > fileBack) {
+        OsVmemCreateInfo createInfo {
+            .BaseAddress = context->placed ? OsAnyPointer(fileBack + context->bias) : nullptr,
+            .Size = back - fileBack,
+            .Access = SegmentAccess(ph) | eOsMemoryCommit | eOsMemoryDiscard,
+            .Process = context->process,
         };
-        void *guestAddress = nullptr;
 
-        // TODO: handle misaligned mappings
-        if (OsStatus status = OsVmemMap(vmemGuestMapInfo, &guestAddress)) {
-            OsDebugMessage(eOsLogInfo, "Failed to map program header into guest memory");
+        void *address = nullptr;
+        if (OsStatus status = OsVmemCreate(createInfo, &address)) {
             return status;
         }
-#endif
 
+        if (!context->placed) {
+            context->bias = uintptr_t(address) - fileBack;
+            context->placed = true;
+        }
+    }
+
+    RtldPrintf("Mapped segment: %p-%p at %p", (void*)ph.vaddr, (void*)(ph.vaddr + ph.memsz), (void*)(front + context->bias));
+    return OsStatusSuccess;
+}
+
+static OsStatus RtldMapSegments(RtldMapContext *context, std::span<const elf::ProgramHeader> phs) {
+    for (const elf::ProgramHeader &ph : phs) {
+        if (ph.type != elf::ProgramHeaderType::eLoad || ph.memsz == 0) {
+            continue;
+        }
+
+        if (OsStatus status = RtldMapSegment(context, ph)) {
+            RtldPrintf("Failed to map segment %p: %llx", (void*)ph.vaddr, status);
+            return status;
+        }
+    }
+
+    return OsStatusSuccess;
+}
+
+static OsStatus RtldMapProgram(OsDeviceHandle file, OsProcessHandle process, uintptr_t *entry, RtldTlsInitInfo *tlsInfo) {
+    elf::Header header;
+
+    if (OsStatus status = ElfReadHeader(file, &header)) {
+        OsDebugMessage(eOsLogInfo, "Failed to read ELF header");
+        return status;
+    }
+
+    if (header.phnum == 0) {
+        return OsStatusInvalidData;
+    }
+
+    elf::ProgramHeader *elfPhs = nullptr;
+    if (OsStatus status = ElfReadProgramHeaders(file, header, &elfPhs)) {
+        OsDebugMessage(eOsLogInfo, "Failed to read ELF program headers");
+        return status;
+    }
+
+    defer {
+        free(elfPhs);
+    };
 
+    *entry = header.entry;
+    std::span<const elf::ProgramHeader> phs(elfPhs, header.phnum);
+
+    size_t memoryBegin = 0;
+    size_t memoryEnd = 0;
+    if (OsStatus status = RtldGetMemoryRange(phs, &memoryBegin, &memoryEnd)) {
+        OsDebugMessage(eOsLogInfo, "Failed to get memory range");
+        return status;
+    }
+
+    RtldPrintf("Mapping program: %p-%p", (void*)memoryBegin, (void*)memoryEnd);
+
+    RtldMapContext context {
+        .file = file,
+        .process = process,
+        .bias = 0,
+        .placed = true,
+    };
+
+    if (OsStatus status = RtldMapSegments(&context, phs)) {
+        OsDebugMessage(eOsLogInfo, "Failed to map program segments");
+        return status;
     }
 
     if (const elf::ProgramHeader *tls = FindTlsSection(phs)) {
@@ -573,56 +661,148 @@ OsStatus RtldCreateTls(OsProcessHandle Process, struct RtldTlsInitInfo *TlsInfo,
     return OsStatusSuccess;
 }
 
-#if 0
-[[maybe_unused]]
-static os::IRelocator *GetRelocator(os::elf::Machine machine) {
-    if (machine == os::elf::Machine::eAmd64) {
-        static os::Amd64Relocator sInstance;
-        return &sInstance;
-    } else if (machine == os::elf::Machine::eSparcV9) {
-        static os::SparcV9Relocator sInstance;
-        return &sInstance;
-    } else {
-        return nullptr;
+/// @brief A handle to this process with the access the loader needs.
+static OsProcessHandle gSelfProcess = OS_HANDLE_INVALID;
+
+static OsStatus RtldGetSelfProcess(OsProcessHandle *outHandle) {
+    if (gSelfProcess == OS_HANDLE_INVALID) {
+        if (OsStatus status = OsProcessCurrent(eOsProcessAccessVmControl | eOsProcessAccessDestroy, &gSelfProcess)) {
+            return status;
+        }
     }
+
+    *outHandle = gSelfProcess;
+    return OsStatusSuccess;
 }
 
-OsStatus RtldSoOpen(const RtldSoLoadInfo *LoadInfo, RtldSo *OutObject) {
-    elf::Header header;
-    UniquePtr<elf::ProgramHeader[]> phs { nullptr, &free };
-    OsStatus status = OsStatusSuccess;
+[[noreturn]]
+void RtldLazyBindFailed(const RtldSoImage *, uint64_t) {
+    //
+    // There is nowhere to return to, the call site expects the function
+    // to exist.
+    //
+    OsProcessTerminate(gSelfProcess, -1);
+    __builtin_unreachable();
+}
 
-    if ((status = ElfReadHeader(LoadInfo->Object, elf::Type::eShared, &header))) {
-        return status;
+static OsStatus RtldReadDynamic(RtldSoImage *image, const elf::Dynamic *dynamic) {
+    size_t relaSize = 0;
+    size_t jmprelSize = 0;
+    size_t initArraySize = 0;
+    size_t finiArraySize = 0;
+    uintptr_t base = image->base;
+
+    for (const elf::Dynamic *it = dynamic; it->tag != elf::DynamicTag::eNull; it++) {
+        switch (it->tag) {
+        case elf::DynamicTag::eSymTab:
+            image->symtab = reinterpret_cast<const elf::Symbol*>(base + it->value);
+            break;
+        case elf::DynamicTag::eStrTab:
+            image->strtab = reinterpret_cast<const char*>(base + it->value);
+            break;
+        case elf::DynamicTag::eGnuHash:
+            image->gnuHash = elf::GnuHashTable(reinterpret_cast<const void*>(base + it->value));
+            break;
+        case elf::DynamicTag::eHash:
+            image->sysvHash = elf::SysvHashTable(reinterpret_cast<const void*>(base + it->value));
+            break;
+        case elf::DynamicTag::eRela:
+            image->rela = reinterpret_cast<const elf::Rela*>(base + it->value);
+            break;
+        case elf::DynamicTag::eRelaSize:
+            relaSize = it->value;
+            break;
+        case elf::DynamicTag::eJmpRel:
+            image->jmprel = reinterpret_cast<const elf::Rela*>(base + it->value);
+            break;
+        case elf::DynamicTag::ePltRelSize:
+            jmprelSize = it->value;
+            break;
+        case elf::DynamicTag::ePltRel:
+            if (it->value != uint64_t(elf::DynamicTag::eRela)) {
+                return OsStatusNotSupported;
+            }
+            break;
+        case elf::DynamicTag::ePltGot:
+            image->pltgot = reinterpret_cast<uint64_t*>(base + it->value);
+            break;
+        case elf::DynamicTag::eBindNow:
+            image->bindNow = true;
+            break;
+        case elf::DynamicTag::eFlags:
+            image->bindNow |= (it->value & elf::kDynamicFlagBindNow) != 0;
+            break;
+        case elf::DynamicTag::eFlags1:
+            image->bindNow |= (it->value & elf::kDynamicFlag1Now) != 0;
+            break;
+        case elf::DynamicTag::eTextRel:
+            image->textRel = true;
+            break;
+        case elf::DynamicTag::eInit:
+            image->init = base + it->value;
+            break;
+        case elf::DynamicTag::eFini:
+            image->fini = base + it->value;
+            break;
+        case elf::DynamicTag::eInitArray:
+            image->initArray = reinterpret_cast<const uintptr_t*>(base + it->value);
+            break;
+        case elf::DynamicTag::eInitArraySize:
+            initArraySize = it->value;
+            break;
+        case elf::DynamicTag::eFiniArray:
+            image->finiArray = reinterpret_cast<const uintptr_t*>(base + it->value);
+            break;
+        case elf::DynamicTag::eFiniArraySize:
+            finiArraySize = it->value;
+            break;
+        default:
+            break;
+        }
     }
 
-    if (header.phnum == 0) {
+    if (image->symtab == nullptr || image->strtab == nullptr) {
         return OsStatusInvalidData;
     }
 
-    phs = UniqueArray<elf::ProgramHeader>(header.phnum);
-    if (phs == nullptr) {
-        status = OsStatusOutOfMemory;
-        goto error;
+    // Segments are mapped with their own permissions, there is no way to write to text.
+    if (image->textRel) {
+        return OsStatusNotSupported;
     }
 
-error:
-    return status;
-}
+    image->relaCount = relaSize / sizeof(elf::Rela);
+    image->jmprelCount = jmprelSize / sizeof(elf::Rela);
+    image->initArrayCount = initArraySize / sizeof(uintptr_t);
+    image->finiArrayCount = finiArraySize / sizeof(uintptr_t);
 
-OsStatus RtldSoClose(RtldSo *Object) {
     return OsStatusSuccess;
 }
 
-OsStatus RtldSoSymbol(RtldSo *Object, RtldSoName Name, void **OutAddress) {
-    return OsStatusNotFound;
+static void RtldRunInit(const RtldSoImage *image) {
+    if (image->init != 0) {
+        reinterpret_cast<void(*)(void)>(image->init)();
+    }
+
+    for (size_t i = 0; i < image->initArrayCount; i++) {
+        reinterpret_cast<void(*)(void)>(image->initArray[i])();
+    }
+}
+
+static void RtldRunFini(const RtldSoImage *image) {
+    for (size_t i = image->finiArrayCount; i > 0; i--) {
+        reinterpret_cast<void(*)(void)>(image->finiArray[i - 1])();
+    }
+
+    if (image->fini != 0) {
+        reinterpret_cast<void(*)(void)>(image->fini)();
+    }
 }
 
-OsStatus RtldStartProgram(const RtldStartInfo *StartInfo) {
+OsStatus RtldSoOpen(const RtldSoLoadInfo *LoadInfo, RtldSo *OutObject) {
     elf::Header header;
-    OsStatus status = OsStatusSuccess;
+    OsProcessHandle process = OS_HANDLE_INVALID;
 
-    if ((status = ElfReadHeader(StartInfo->Program, elf::Type::eExecutable, &header))) {
+    if (OsStatus status = ElfReadHeader(LoadInfo->Object, &header)) {
         return status;
     }
 
@@ -630,30 +810,114 @@ OsStatus RtldStartProgram(const RtldStartInfo *StartInfo) {
         return OsStatusInvalidData;
     }
 
-error:
-    return status;
-}
-#endif
+    if (header.machine != elf::Machine::eAmd64) {
+        return OsStatusNotSupported;
+    }
 
-OsStatus RtldSoOpen(const RtldSoLoadInfo *LoadInfo, RtldSo *OutObject) {
-    elf::Header header;
-    OsStatus status = OsStatusSuccess;
+    if (OsStatus status = RtldGetSelfProcess(&process)) {
+        return status;
+    }
 
-    if ((status = ElfReadHeader(LoadInfo->Object, &header))) {
+    elf::ProgramHeader *elfPhs = nullptr;
+    if (OsStatus status = ElfReadProgramHeaders(LoadInfo->Object, header, &elfPhs)) {
         return status;
     }
 
-    if (header.phnum == 0) {
+    defer {
+        free(elfPhs);
+    };
+
+    std::span<const elf::ProgramHeader> phs(elfPhs, header.phnum);
+
+    const elf::ProgramHeader *dynamic = FindProgramHeader(phs, elf::ProgramHeaderType::eDynamic);
+    if (dynamic == nullptr) {
         return OsStatusInvalidData;
     }
 
-    return status;
+    // Shared objects go wherever the first segment is placed, executables go where they were linked.
+    RtldMapContext context {
+        .file = LoadInfo->Object,
+        .process = process,
+        .bias = 0,
+        .placed = header.type != elf::Type::eShared,
+    };
+
+    if (OsStatus status = RtldMapSegments(&context, phs)) {
+        return status;
+    }
+
+    RtldSoImage *image = static_cast<RtldSoImage*>(calloc(1, sizeof(RtldSoImage)));
+    if (image == nullptr) {
+        return OsStatusOutOfMemory;
+    }
+
+    image->base = context.bias;
+
+    if (OsStatus status = RtldReadDynamic(image, reinterpret_cast<const elf::Dynamic*>(image->base + dynamic->vaddr))) {
+        free(image);
+        return status;
+    }
+
+    //
+    // The image is linked before it is relocated so that references to
+    // its own exports resolve.
+    //
+    RtldLinkImage(image);
+
+    if (OsStatus status = RtldRelocateImage(image)) {
+        RtldUnlinkImage(image);
+        free(image);
+        return status;
+    }
+
+    RtldTlsInitInfo tlsInfo{};
+    if (const elf::ProgramHeader *tls = FindTlsSection(phs)) {
+        tlsInfo = RtldTlsInitInfo {
+            .InitAddress = reinterpret_cast<void*>(image->base + tls->vaddr),
+            .TlsDataSize = tls->filesz,
+            .TlsBssSize = tls->memsz - tls->filesz,
+            .TlsAlign = tls->align,
+        };
+    }
+
+    RtldRunInit(image);
+
+    *OutObject = RtldSo {
+        .Object = LoadInfo->Object,
+        .TlsInfo = tlsInfo,
+        .Image = image,
+    };
+
+    return OsStatusSuccess;
 }
 
 OsStatus RtldSoClose(RtldSo *Object) {
+    RtldSoImage *image = Object->Image;
+    if (image == nullptr) {
+        return OsStatusInvalidInput;
+    }
+
+    RtldRunFini(image);
+    RtldUnlinkImage(image);
+    free(image);
+
+    Object->Image = nullptr;
+
+    // The segments stay mapped, the system cannot release memory yet.
     return OsStatusSuccess;
 }
 
 OsStatus RtldSoSymbol(RtldSo *Object, RtldSoName Name, void **OutAddress) {
-    return OsStatusNotFound;
-}
\ No newline at end of file
+    const RtldSoImage *image = Object->Image;
+    if (image == nullptr) {
+        return OsStatusInvalidInput;
+    }
+
+    const elf::Symbol *symbol = RtldImageFindSymbol(image, Name.NameFront, Name.NameBack);
+    if (symbol == nullptr) {
+        return OsStatusNotFound;
+    }
+
+    *OutAddress = reinterpret_cast<void*>(image->base + symbol->value);
+    return OsStatusSuccess;
+}
@@ -175,6 +175,10 @@ public:
         *outNode = request.Node;
         return OsStatusSuccess;
     }
+
+    OsStatus NextBatch(OsIteratorBatch *batch, size_t size) {
+        return OsInvokeIteratorNextBatch(mHandle, batch, size);
+    }
 };
 
 static void ListCurrentFolder(StreamDevice& tty, std::string_view path) {
@@ -206,33 +210,31 @@ static void ListCurrentFolder(StreamDevice& tty, std::string_view path) {
         return;
     }
 
-    while (true) {
-        OsNodeHandle node = OS_HANDLE_INVALID;
-        defer {
-            if (node != OS_HANDLE_INVALID) {
-                ASSERT_OS_SUCCESS(OsNodeClose(node));
-            }
-        };
+    //
+    // Fetch the names in batches rather than opening and stating each node,
+    // a single call returns as many entries as fit in the buffer.
+    //
+    alignas(OsIteratorBatch) char buffer[4096];
+    OsIteratorBatch *batch = reinterpret_cast<OsIteratorBatch*>(buffer);
 
-        if (OsStatus status = iterator.Next(&node)) {
-            if (status == OsStatusCompleted) {
-                break;
-            }
+    while (true) {
+        OsStatus status = iterator.NextBatch(batch, sizeof(buffer));
+        if (status == OsStatusCompleted) {
+            break;
+        }
 
+        if (status != OsStatusSuccess) {
             tty.Format("Error: Failed to iterate folder '{}'.\n", path);
             tty.Format("Status: {}\n", status);
             return;
         }
 
-        OsNodeInfo info{};
-        if (OsStatus status = OsNodeStat(node, &info)) {
-            tty.Format("Error: Failed to get node info.\n");
-            tty.Format("Status: {}\n", status);
-            return;
+        const OsIteratorEntry *entry = OsIteratorBatchFirst(batch);
+        for (size_t i = 0; i < batch->Count; i++) {
+            std::string_view name = { entry->Name, entry->NameLength };
+            tty.Format("{}\n", name);
+            entry = OsIteratorEntryNext(entry);
         }
-
-        std::string_view name = { info.Name, strnlen(info.Name, sizeof(info.Name)) };
-        tty.Format("{}\n", name);
     }
 }
 
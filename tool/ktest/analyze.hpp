@@ -0,0 +1,647 @@
+#pragma once
+
+#include "debug/packet.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <map>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+//
+// events.bin is a flat array of km::debug::EventPacket written by the kernel
+// over a serial port. Packets carry no timestamp, so the index of a packet in
+// the stream is used as its time everywhere in here.
+//
+
+/// @brief A read only mapping of a whole file.
+class MappedFile {
+    void *mData = nullptr;
+    size_t mSize = 0;
+
+public:
+    MappedFile(const std::filesystem::path& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Failed to open " + path.string());
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "Failed to stat " + path.string());
+        }
+
+        mSize = info.st_size;
+
+        if (mSize != 0) {
+            mData = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mData == MAP_FAILED) {
+                int error = errno;
+                close(fd);
+                throw std::system_error(error, std::generic_category(), "Failed to map " + path.string());
+            }
+
+            // every pass reads the whole file, fault it in up front
+            madvise(mData, mSize, MADV_WILLNEED);
+        }
+
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (mData != nullptr) {
+            munmap(mData, mSize);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const std::byte> Bytes() const {
+        return { static_cast<const std::byte*>(mData), mSize };
+    }
+};
+
+/// @brief A log2 histogram of sizes, bucket n holds sizes in [2^(n-1), 2^n).
+struct SizeHistogram {
+    static constexpr size_t kBuckets = 65;
+
+    uint64_t counts[kBuckets]{};
+
+    void Add(uint64_t size) {
+        counts[std::bit_width(size)] += 1;
+    }
+};
+
+enum class MemoryKind {
+    ePhysical,
+    eVirtual,
+};
+
+/// @brief The lifetime of a single allocation.
+struct Allocation {
+    static constexpr uint64_t kLeaked = UINT64_MAX;
+
+    uint64_t address;
+    uint64_t size;
+    uint32_t alignment;
+    uint32_t tag;
+
+    /// @brief The packet that allocated the memory.
+    uint64_t allocated;
+
+    /// @brief The packet that released the last of the memory, or @a kLeaked.
+    uint64_t released = kLeaked;
+
+    bool IsLeaked() const { return released == kLeaked; }
+};
+
+/// @brief The bytes in use after a packet changed them.
+struct MemorySample {
+    uint64_t packet;
+    uint64_t bytes;
+};
+
+struct MemoryReport {
+    std::vector<Allocation> allocations;
+    std::vector<MemorySample> usage;
+    SizeHistogram sizes;
+
+    uint64_t releases = 0;
+
+    uint64_t peakBytes = 0;
+    uint64_t peakPacket = 0;
+
+    /// @brief The bytes still allocated at the end of the stream.
+    uint64_t liveBytes = 0;
+
+    /// @brief Bytes released that were never allocated in the stream.
+    /// @note Memory allocated before the stream was opened, or whose packet was dropped, is counted here.
+    uint64_t unmatchedBytes = 0;
+
+    /// @brief Allocations that overlapped memory that was never released.
+    uint64_t overlaps = 0;
+};
+
+/// @brief Rebuilds allocation lifetimes from allocate and release packets.
+///
+/// Releases are address ranges that may cover part of an allocation or
+/// several allocations, so the live memory is kept as a map of disjoint
+/// ranges that are split as they are released.
+class LifetimeTracker {
+    struct LiveRange {
+        uint64_t back;
+        size_t allocation;
+    };
+
+    /// @brief Live ranges keyed by their front address.
+    std::map<uint64_t, LiveRange> mLive;
+
+    /// @brief The bytes of each allocation that are still live.
+    std::vector<uint64_t> mRemaining;
+
+    MemoryReport& mReport;
+
+    uint64_t take(uint64_t packet, uint64_t front, uint64_t back) {
+        auto it = mLive.upper_bound(front);
+        if (it != mLive.begin()) {
+            auto prev = std::prev(it);
+            if (prev->second.back > front) {
+                it = prev;
+            }
+        }
+
+        uint64_t taken = 0;
+
+        while (it != mLive.end() && it->first < back) {
+            uint64_t liveFront = it->first;
+            LiveRange live = it->second;
+
+            uint64_t cutFront = std::max(liveFront, front);
+            uint64_t cutBack = std::min(live.back, back);
+
+            it = mLive.erase(it);
+
+            if (liveFront < cutFront) {
+                mLive.emplace(liveFront, LiveRange { cutFront, live.allocation });
+            }
+
+            if (cutBack < live.back) {
+                it = mLive.emplace(cutBack, LiveRange { live.back, live.allocation }).first;
+            }
+
+            uint64_t bytes = cutBack - cutFront;
+            taken += bytes;
+
+            mRemaining[live.allocation] -= bytes;
+            if (mRemaining[live.allocation] == 0) {
+                mReport.allocations[live.allocation].released = packet;
+            }
+        }
+
+        mReport.liveBytes -= taken;
+        return taken;
+    }
+
+    void sample(uint64_t packet) {
+        mReport.usage.push_back(MemorySample { packet, mReport.liveBytes });
+
+        if (mReport.liveBytes > mReport.peakBytes) {
+            mReport.peakBytes = mReport.liveBytes;
+            mReport.peakPacket = packet;
+        }
+    }
+
+public:
+    LifetimeTracker(MemoryReport& report)
+        : mReport(report)
+    { }
+
+    void Allocate(uint64_t packet, uint64_t address, uint64_t size, uint32_t alignment, uint32_t tag) {
+        size_t index = mReport.allocations.size();
+        mReport.allocations.push_back(Allocation { address, size, alignment, tag, packet });
+        mReport.sizes.Add(size);
+
+        if (size == 0) {
+            mReport.allocations[index].released = packet;
+            mRemaining.push_back(0);
+            return;
+        }
+
+        // the previous owner must have been released in a packet that was dropped
+        uint64_t back = address + size;
+        if (take(packet, address, back) != 0) {
+            mReport.overlaps += 1;
+        }
+
+        mRemaining.push_back(size);
+        mLive.emplace(address, LiveRange { back, index });
+        mReport.liveBytes += size;
+        sample(packet);
+    }
+
+    void Release(uint64_t packet, uint64_t front, uint64_t back) {
+        mReport.releases += 1;
+        if (back <= front) {
+            return;
+        }
+
+        uint64_t taken = take(packet, front, back);
+        mReport.unmatchedBytes += (back - front) - taken;
+        sample(packet);
+    }
+};
+
+inline MemoryReport AnalyzeMemory(std::span<const km::debug::EventPacket> packets, MemoryKind kind) {
+    using km::debug::Event;
+
+    MemoryReport report;
+    LifetimeTracker tracker(report);
+
+    for (uint64_t i = 0; i < packets.size(); i++) {
+        const km::debug::EventPacket& packet = packets[i];
+
+        if (kind == MemoryKind::ePhysical) {
+            if (packet.event == Event::eAllocatePhysicalMemory) {
+                const auto& event = packet.data.allocatePhysicalMemory;
+                tracker.Allocate(i, event.address, event.size, event.alignment, event.tag);
+            } else if (packet.event == Event::eReleasePhysicalMemory) {
+                const auto& event = packet.data.releasePhysicalMemory;
+                tracker.Release(i, event.begin, event.end);
+            }
+        } else {
+            if (packet.event == Event::eAllocateVirtualMemory) {
+                const auto& event = packet.data.allocateVirtualMemory;
+                tracker.Allocate(i, event.address, event.size, event.alignment, event.tag);
+            } else if (packet.event == Event::eReleaseVirtualMemory) {
+                const auto& event = packet.data.releaseVirtualMemory;
+                tracker.Release(i, event.begin, event.end);
+            }
+        }
+    }
+
+    return report;
+}
+
+/// @brief The top byte of a task id is not part of the id, the same as --parse.
+static constexpr uint64_t kTaskIdMask = 0x00FF'FFFF'FFFF'FFFF;
+
+/// @brief A task running on a cpu between two schedule packets.
+struct ScheduleSlice {
+    uint32_t cpu;
+    uint64_t task;
+    uint64_t begin;
+    uint64_t end;
+};
+
+struct CpuSchedule {
+    uint64_t switches = 0;
+
+    /// @brief The packets spent running each task.
+    std::map<uint64_t, uint64_t> tasks;
+};
+
+struct ScheduleReport {
+    std::vector<ScheduleSlice> slices;
+    std::map<uint32_t, CpuSchedule> cpus;
+};
+
+inline ScheduleReport AnalyzeSchedule(std::span<const km::debug::EventPacket> packets) {
+    ScheduleReport report;
+
+    // the slice each cpu is running, a task of 0 is idle
+    std::map<uint32_t, ScheduleSlice> running;
+
+    auto finish = [&](const ScheduleSlice& slice, uint64_t end) {
+        if (slice.task == 0 || end <= slice.begin) {
+            return;
+        }
+
+        ScheduleSlice result = slice;
+        result.end = end;
+        report.slices.push_back(result);
+        report.cpus[slice.cpu].tasks[slice.task] += end - slice.begin;
+    };
+
+    for (uint64_t i = 0; i < packets.size(); i++) {
+        const km::debug::EventPacket& packet = packets[i];
+        if (packet.event != km::debug::Event::eScheduleTask) {
+            continue;
+        }
+
+        const km::debug::ScheduleTask& event = packet.data.scheduleTask;
+        ScheduleSlice next { event.cpu, event.next & kTaskIdMask, i, i };
+
+        if (auto it = running.find(event.cpu); it != running.end()) {
+            finish(it->second, i);
+            it->second = next;
+        } else {
+            running.emplace(event.cpu, next);
+        }
+
+        report.cpus[event.cpu].switches += 1;
+    }
+
+    for (const auto& [cpu, slice] : running) {
+        finish(slice, packets.size());
+    }
+
+    std::ranges::sort(report.slices, [](const ScheduleSlice& lhs, const ScheduleSlice& rhs) {
+        return std::tie(lhs.cpu, lhs.begin) < std::tie(rhs.cpu, rhs.begin);
+    });
+
+    return report;
+}
+
+struct EventAnalysis {
+    std::filesystem::path path;
+
+    uint64_t packets = 0;
+    uint64_t unknown = 0;
+
+    /// @brief Bytes at the end of the file that do not make a whole packet.
+    uint64_t trailingBytes = 0;
+
+    MemoryReport physicalMemory;
+    MemoryReport virtualMemory;
+    ScheduleReport schedule;
+};
+
+/// @brief Analyze a single event stream.
+///
+/// The memory and schedule passes each depend only on the order of their
+/// own packets, so they scan the mapped stream concurrently.
+inline EventAnalysis AnalyzeEvents(const std::filesystem::path& path) {
+    MappedFile file(path);
+    std::span<const std::byte> bytes = file.Bytes();
+
+    size_t count = bytes.size() / sizeof(km::debug::EventPacket);
+    std::span packets(reinterpret_cast<const km::debug::EventPacket*>(bytes.data()), count);
+
+    auto physical = std::async(std::launch::async, AnalyzeMemory, packets, MemoryKind::ePhysical);
+    auto virt = std::async(std::launch::async, AnalyzeMemory, packets, MemoryKind::eVirtual);
+    auto schedule = std::async(std::launch::async, AnalyzeSchedule, packets);
+
+    uint64_t unknown = std::ranges::count_if(packets, [](const km::debug::EventPacket& packet) {
+        return packet.event > km::debug::Event::eScheduleTask;
+    });
+
+    return EventAnalysis {
+        .path = path,
+        .packets = count,
+        .unknown = unknown,
+        .trailingBytes = bytes.size() % sizeof(km::debug::EventPacket),
+        .physicalMemory = physical.get(),
+        .virtualMemory = virt.get(),
+        .schedule = schedule.get(),
+    };
+}
+
+/// @brief Collect event streams, directories are searched for events.bin files.
+inline std::vector<std::filesystem::path> FindEventFiles(std::span<const std::string> paths) {
+    std::vector<std::filesystem::path> result;
+
+    for (const std::string& path : paths) {
+        if (!std::filesystem::is_directory(path)) {
+            result.emplace_back(path);
+            continue;
+        }
+
+        std::vector<std::filesystem::path> found;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+            if (entry.is_regular_file() && entry.path().filename() == "events.bin") {
+                found.push_back(entry.path());
+            }
+        }
+
+        std::ranges::sort(found);
+        result.insert(result.end(), found.begin(), found.end());
+    }
+
+    return result;
+}
+
+/// @brief Analyze many event streams, @p jobs streams at a time.
+inline std::vector<EventAnalysis> AnalyzeEventFiles(std::span<const std::filesystem::path> paths, unsigned jobs) {
+    std::vector<EventAnalysis> results(paths.size());
+    std::vector<std::exception_ptr> errors(paths.size());
+    std::atomic<size_t> next = 0;
+
+    {
+        std::vector<std::jthread> workers;
+        for (unsigned i = 0; i < std::clamp<size_t>(jobs, 1, paths.size()); i++) {
+            workers.emplace_back([&] {
+                for (size_t index = next++; index < paths.size(); index = next++) {
+                    try {
+                        results[index] = AnalyzeEvents(paths[index]);
+                    } catch (...) {
+                        errors[index] = std::current_exception();
+                    }
+                }
+            });
+        }
+    }
+
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    return results;
+}
+
+//
+// reports
+//
+
+inline std::string FormatBytes(uint64_t bytes) {
+    static constexpr std::string_view kUnits[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+
+    size_t unit = 0;
+    while (unit + 1 < std::size(kUnits) && bytes >= (uint64_t(1024) << (unit * 10))) {
+        unit += 1;
+    }
+
+    if (unit == 0) {
+        return std::format("{} B", bytes);
+    }
+
+    return std::format("{:.2f} {}", double(bytes) / double(uint64_t(1) << (unit * 10)), kUnits[unit]);
+}
+
+inline void WriteSizeHistogram(std::ostream& out, const SizeHistogram& histogram) {
+    for (size_t bucket = 0; bucket < SizeHistogram::kBuckets; bucket++) {
+        uint64_t count = histogram.counts[bucket];
+        if (count == 0) {
+            continue;
+        }
+
+        if (bucket == 0) {
+            out << std::format("    {:>24} {}\n", "0", count);
+        } else {
+            uint64_t front = uint64_t(1) << (bucket - 1);
+            out << std::format("    {:>24} {}\n", std::format(">= {}", FormatBytes(front)), count);
+        }
+    }
+}
+
+inline void WriteMemoryReport(std::ostream& out, std::string_view name, const MemoryReport& report) {
+    static constexpr size_t kLargestLeaks = 10;
+
+    std::vector<const Allocation*> leaks;
+    for (const Allocation& allocation : report.allocations) {
+        if (allocation.IsLeaked()) {
+            leaks.push_back(&allocation);
+        }
+    }
+
+    out << std::format("  {} memory\n", name);
+    out << std::format("    allocations {}, releases {}\n", report.allocations.size(), report.releases);
+    out << std::format("    peak {} at packet {}\n", FormatBytes(report.peakBytes), report.peakPacket);
+    out << std::format("    leaked {} in {} allocations\n", FormatBytes(report.liveBytes), leaks.size());
+
+    if (report.unmatchedBytes != 0) {
+        out << std::format("    released {} that was never allocated in the stream\n", FormatBytes(report.unmatchedBytes));
+    }
+
+    if (report.overlaps != 0) {
+        out << std::format("    {} allocations overlapped live memory, release packets may have been dropped\n", report.overlaps);
+    }
+
+    if (!report.allocations.empty()) {
+        out << "    allocation sizes\n";
+        WriteSizeHistogram(out, report.sizes);
+    }
+
+    std::ranges::sort(leaks, std::greater{}, &Allocation::size);
+    if (leaks.size() > kLargestLeaks) {
+        leaks.resize(kLargestLeaks);
+    }
+
+    if (!leaks.empty()) {
+        out << "    largest leaks\n";
+        for (const Allocation *leak : leaks) {
+            out << std::format("      {:#018x} {} tag {} allocated at packet {}\n", leak->address, FormatBytes(leak->size), leak->tag, leak->allocated);
+        }
+    }
+}
+
+inline void WriteAnalysisReport(std::ostream& out, const EventAnalysis& analysis) {
+    out << std::format("{}: {} packets\n", analysis.path.string(), analysis.packets);
+
+    if (analysis.unknown != 0) {
+        out << std::format("  {} packets of unknown type\n", analysis.unknown);
+    }
+
+    if (analysis.trailingBytes != 0) {
+        out << std::format("  {} trailing bytes do not make a whole packet\n", analysis.trailingBytes);
+    }
+
+    WriteMemoryReport(out, "physical", analysis.physicalMemory);
+    WriteMemoryReport(out, "virtual", analysis.virtualMemory);
+
+    for (const auto& [cpu, schedule] : analysis.schedule.cpus) {
+        out << std::format("  cpu {}: {} switches, {} tasks\n", cpu, schedule.switches, schedule.tasks.size());
+    }
+}
+
+//
+// chrome trace export
+//
+
+inline std::string EscapeJson(std::string_view text) {
+    std::string result;
+    result.reserve(text.size());
+
+    for (char c : text) {
+        switch (c) {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                result += std::format("\\u{:04x}", c);
+            } else {
+                result += c;
+            }
+            break;
+        }
+    }
+
+    return result;
+}
+
+/// @brief Writes trace events in the chrome trace event format.
+///
+/// Each stream is a process, each cpu is a thread, memory usage is a
+/// counter and every allocation is an async slice from its allocation to
+/// its release. One packet is one microsecond of trace time.
+class ChromeTraceWriter {
+    static constexpr size_t kFlushSize = 1 << 20;
+
+    std::ostream& mOut;
+    std::string mBuffer;
+    bool mFirst = true;
+
+    template<typename... A>
+    void event(std::format_string<A...> fmt, A&&... args) {
+        mBuffer += mFirst ? "\n" : ",\n";
+        mFirst = false;
+        std::format_to(std::back_inserter(mBuffer), fmt, std::forward<A>(args)...);
+
+        if (mBuffer.size() >= kFlushSize) {
+            mOut << mBuffer;
+            mBuffer.clear();
+        }
+    }
+
+    void memory(size_t pid, std::string_view name, const MemoryReport& report, uint64_t end) {
+        for (const MemorySample& sample : report.usage) {
+            event(R"({{"ph":"C","pid":{},"ts":{},"name":"{} memory","args":{{"bytes":{}}}}})", pid, sample.packet, name, sample.bytes);
+        }
+
+        for (size_t i = 0; i < report.allocations.size(); i++) {
+            const Allocation& allocation = report.allocations[i];
+            bool leaked = allocation.IsLeaked();
+            uint64_t released = leaked ? end : allocation.released;
+
+            event(R"({{"ph":"b","pid":{},"cat":"{}","id":"{}","ts":{},"name":"tag {}","args":{{"address":"{:#x}","size":{},"alignment":{}}}}})",
+                pid, name, i, allocation.allocated, allocation.tag, allocation.address, allocation.size, allocation.alignment);
+            event(R"({{"ph":"e","pid":{},"cat":"{}","id":"{}","ts":{},"name":"tag {}","args":{{"leaked":{}}}}})",
+                pid, name, i, released, allocation.tag, leaked);
+        }
+    }
+
+public:
+    ChromeTraceWriter(std::ostream& out)
+        : mOut(out)
+    {
+        mBuffer = R"({"displayTimeUnit":"ms","traceEvents":[)";
+    }
+
+    void Add(size_t pid, const EventAnalysis& analysis) {
+        event(R"({{"ph":"M","pid":{},"name":"process_name","args":{{"name":"{}"}}}})", pid, EscapeJson(analysis.path.string()));
+
+        for (const auto& [cpu, schedule] : analysis.schedule.cpus) {
+            event(R"({{"ph":"M","pid":{},"tid":{},"name":"thread_name","args":{{"name":"cpu {}"}}}})", pid, cpu, cpu);
+        }
+
+        for (const ScheduleSlice& slice : analysis.schedule.slices) {
+            event(R"({{"ph":"X","pid":{},"tid":{},"ts":{},"dur":{},"name":"task {:#x}"}})", pid, slice.cpu, slice.begin, slice.end - slice.begin, slice.task);
+        }
+
+        memory(pid, "physical", analysis.physicalMemory, analysis.packets);
+        memory(pid, "virtual", analysis.virtualMemory, analysis.packets);
+    }
+
+    void Finish() {
+        mBuffer += "\n]}\n";
+        mOut << mBuffer;
+        mBuffer.clear();
+        mOut.flush();
+    }
+};
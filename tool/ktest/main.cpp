@@ -4,6 +4,8 @@
 
 #include "debug/packet.hpp"
 
+#include "analyze.hpp"
+
 #include <filesystem>
 #include <vector>
 #include <fstream>
@@ -113,6 +115,37 @@ static int ParseEvents(const argparse::ArgumentParser& parser) {
     return 0;
 }
 
+static int AnalyzeEventStreams(const argparse::ArgumentParser& parser) {
+    auto paths = FindEventFiles(parser.get<std::vector<std::string>>("--analyze"));
+    if (paths.empty()) {
+        std::cerr << "No event streams found" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto results = AnalyzeEventFiles(paths, parser.get<unsigned int>("--instances"));
+
+    for (const EventAnalysis& analysis : results) {
+        WriteAnalysisReport(std::cout, analysis);
+    }
+
+    if (auto trace = parser.present("--trace")) {
+        std::ofstream out(*trace, std::ios::binary);
+        if (!out) {
+            std::cerr << "Failed to open " << *trace << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        ChromeTraceWriter writer(out);
+        for (size_t i = 0; i < results.size(); i++) {
+            writer.Add(i, results[i]);
+        }
+
+        writer.Finish();
+    }
+
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, const char **argv) try {
     argparse::ArgumentParser parser{"BezOS soak test tool"};
 
@@ -129,8 +162,15 @@ int main(int argc, const char **argv) try {
         .help("Parse event log")
         .nargs(argparse::nargs_pattern::any);
 
+    parser.add_argument("--analyze")
+        .help("Analyze event logs, directories are searched for events.bin")
+        .nargs(argparse::nargs_pattern::any);
+
+    parser.add_argument("--trace")
+        .help("Write the analyzed event logs as a chrome trace");
+
     parser.add_argument("--instances", "-j")
-        .help("Number of instances to run")
+        .help("Number of instances to run, or event logs to analyze at once")
         .default_value(std::thread::hardware_concurrency() / 4)
         .scan<'u', unsigned>();
 
@@ -142,6 +182,8 @@ int main(int argc, const char **argv) try {
 
     if (parser.present("--parse")) {
         return ParseEvents(parser);
+    } else if (parser.present("--analyze")) {
+        return AnalyzeEventStreams(parser);
     } else if (parser.present("--image")) {
         return RunInstances(parser, unknown);
     }
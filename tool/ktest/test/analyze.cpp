@@ -0,0 +1,219 @@
+#include <gtest/gtest.h>
+
+#include "../analyze.hpp"
+
+#include <cstring>
+#include <sstream>
+
+template<typename T>
+static km::debug::EventPacket MakePacket(km::debug::Event event, const T& data) {
+    km::debug::EventPacket packet { .event = event };
+    std::memcpy(&packet.data, &data, sizeof(T));
+    return packet;
+}
+
+static km::debug::EventPacket Schedule(uint32_t cpu, uint64_t previous, uint64_t next) {
+    return MakePacket(km::debug::Event::eScheduleTask, km::debug::ScheduleTask { previous, next, cpu });
+}
+
+static km::debug::EventPacket AllocatePhysical(uint64_t address, uint64_t size) {
+    return MakePacket(km::debug::Event::eAllocatePhysicalMemory, km::debug::AllocatePhysicalMemory { size, address, 0x1000, 0 });
+}
+
+static km::debug::EventPacket ReleasePhysical(uint64_t begin, uint64_t end) {
+    return MakePacket(km::debug::Event::eReleasePhysicalMemory, km::debug::ReleasePhysicalMemory { begin, end, 0 });
+}
+
+class LifetimeTrackerTest : public testing::Test {
+public:
+    MemoryReport report;
+    LifetimeTracker tracker{report};
+};
+
+TEST_F(LifetimeTrackerTest, Release) {
+    tracker.Allocate(0, 0x1000, 0x1000, 0, 0);
+    ASSERT_EQ(report.liveBytes, 0x1000);
+    ASSERT_TRUE(report.allocations[0].IsLeaked());
+
+    tracker.Release(1, 0x1000, 0x2000);
+    ASSERT_EQ(report.liveBytes, 0);
+    ASSERT_EQ(report.allocations[0].released, 1);
+    ASSERT_EQ(report.unmatchedBytes, 0);
+    ASSERT_EQ(report.releases, 1);
+}
+
+TEST_F(LifetimeTrackerTest, PartialRelease) {
+    tracker.Allocate(0, 0x1000, 0x3000, 0, 0);
+
+    // release the middle first, leaving two live ranges
+    tracker.Release(1, 0x2000, 0x3000);
+    ASSERT_EQ(report.liveBytes, 0x2000);
+    ASSERT_TRUE(report.allocations[0].IsLeaked());
+
+    tracker.Release(2, 0x1000, 0x2000);
+    ASSERT_EQ(report.liveBytes, 0x1000);
+    ASSERT_TRUE(report.allocations[0].IsLeaked());
+
+    // the allocation is only released when its last byte is
+    tracker.Release(3, 0x3000, 0x4000);
+    ASSERT_EQ(report.liveBytes, 0);
+    ASSERT_EQ(report.allocations[0].released, 3);
+    ASSERT_EQ(report.unmatchedBytes, 0);
+}
+
+TEST_F(LifetimeTrackerTest, ReleaseSpansAllocations) {
+    tracker.Allocate(0, 0x1000, 0x1000, 0, 0);
+    tracker.Allocate(1, 0x2000, 0x1000, 0, 0);
+    tracker.Allocate(2, 0x4000, 0x2000, 0, 0);
+
+    // covers the first two and half of the third, with a gap between them
+    tracker.Release(3, 0x1000, 0x5000);
+    ASSERT_EQ(report.allocations[0].released, 3);
+    ASSERT_EQ(report.allocations[1].released, 3);
+    ASSERT_TRUE(report.allocations[2].IsLeaked());
+    ASSERT_EQ(report.liveBytes, 0x1000);
+    ASSERT_EQ(report.unmatchedBytes, 0x1000);
+
+    tracker.Release(4, 0x5000, 0x6000);
+    ASSERT_EQ(report.allocations[2].released, 4);
+    ASSERT_EQ(report.liveBytes, 0);
+}
+
+TEST_F(LifetimeTrackerTest, OverlappingAllocation) {
+    tracker.Allocate(0, 0x1000, 0x2000, 0, 0);
+
+    // the release of the top half of the first allocation was dropped
+    tracker.Allocate(1, 0x2000, 0x2000, 0, 0);
+    ASSERT_EQ(report.overlaps, 1);
+    ASSERT_EQ(report.liveBytes, 0x3000);
+    ASSERT_TRUE(report.allocations[0].IsLeaked());
+
+    tracker.Release(2, 0x1000, 0x2000);
+    ASSERT_EQ(report.allocations[0].released, 2);
+    ASSERT_TRUE(report.allocations[1].IsLeaked());
+
+    tracker.Release(3, 0x2000, 0x4000);
+    ASSERT_EQ(report.allocations[1].released, 3);
+    ASSERT_EQ(report.liveBytes, 0);
+    ASSERT_EQ(report.unmatchedBytes, 0);
+}
+
+TEST_F(LifetimeTrackerTest, Unmatched) {
+    tracker.Release(0, 0x1000, 0x3000);
+    ASSERT_EQ(report.unmatchedBytes, 0x2000);
+    ASSERT_EQ(report.liveBytes, 0);
+
+    // empty and inverted releases are counted but change nothing
+    tracker.Release(1, 0x3000, 0x3000);
+    tracker.Release(2, 0x3000, 0x1000);
+    ASSERT_EQ(report.releases, 3);
+    ASSERT_EQ(report.unmatchedBytes, 0x2000);
+}
+
+TEST_F(LifetimeTrackerTest, Peak) {
+    tracker.Allocate(0, 0x1000, 0x1000, 0, 0);
+    tracker.Allocate(1, 0x2000, 0x2000, 0, 0);
+    tracker.Release(2, 0x1000, 0x4000);
+    tracker.Allocate(3, 0x1000, 0x1000, 0, 0);
+
+    ASSERT_EQ(report.peakBytes, 0x3000);
+    ASSERT_EQ(report.peakPacket, 1);
+
+    ASSERT_EQ(report.usage.size(), 4);
+    ASSERT_EQ(report.usage[2].packet, 2);
+    ASSERT_EQ(report.usage[2].bytes, 0);
+}
+
+TEST(AnalyzeScheduleTest, Slices) {
+    km::debug::EventPacket packets[] = {
+        Schedule(0, 0, 0x10),
+        Schedule(1, 0, 0x20),
+        AllocatePhysical(0x1000, 0x1000),
+        Schedule(0, 0x10, 0x20),
+        Schedule(1, 0x20, 0),
+        Schedule(0, 0x20, 0x10),
+    };
+
+    ScheduleReport report = AnalyzeSchedule(packets);
+
+    ASSERT_EQ(report.cpus.size(), 2);
+    ASSERT_EQ(report.cpus[0].switches, 3);
+    ASSERT_EQ(report.cpus[1].switches, 2);
+
+    // idle time is not a slice
+    ASSERT_EQ(report.slices.size(), 4);
+
+    const ScheduleSlice expected[] = {
+        { 0, 0x10, 0, 3 },
+        { 0, 0x20, 3, 5 },
+        { 0, 0x10, 5, 6 },
+        { 1, 0x20, 1, 4 },
+    };
+
+    for (size_t i = 0; i < std::size(expected); i++) {
+        ASSERT_EQ(report.slices[i].cpu, expected[i].cpu) << i;
+        ASSERT_EQ(report.slices[i].task, expected[i].task) << i;
+        ASSERT_EQ(report.slices[i].begin, expected[i].begin) << i;
+        ASSERT_EQ(report.slices[i].end, expected[i].end) << i;
+    }
+
+    ASSERT_EQ(report.cpus[0].tasks[0x10], 4);
+    ASSERT_EQ(report.cpus[0].tasks[0x20], 2);
+}
+
+TEST(AnalyzeScheduleTest, TaskIdMask) {
+    km::debug::EventPacket packets[] = {
+        Schedule(0, 0, 0xFFFF'8000'0000'1000),
+        Schedule(0, 0xFFFF'8000'0000'1000, 0),
+    };
+
+    ScheduleReport report = AnalyzeSchedule(packets);
+
+    ASSERT_EQ(report.slices.size(), 1);
+    ASSERT_EQ(report.slices[0].task, 0x00FF'8000'0000'1000);
+}
+
+TEST(ChromeTraceTest, Events) {
+    km::debug::EventPacket packets[] = {
+        Schedule(0, 0, 0x10),
+        AllocatePhysical(0x1000, 0x2000),
+        AllocatePhysical(0x4000, 0x1000),
+        ReleasePhysical(0x1000, 0x3000),
+        Schedule(0, 0x10, 0),
+    };
+
+    EventAnalysis analysis {
+        .path = "events.bin",
+        .packets = std::size(packets),
+        .physicalMemory = AnalyzeMemory(packets, MemoryKind::ePhysical),
+        .virtualMemory = AnalyzeMemory(packets, MemoryKind::eVirtual),
+        .schedule = AnalyzeSchedule(packets),
+    };
+
+    std::ostringstream out;
+    ChromeTraceWriter writer(out);
+    writer.Add(1, analysis);
+    writer.Finish();
+
+    std::string expected =
+        R"({"displayTimeUnit":"ms","traceEvents":[)" "\n"
+        R"({"ph":"M","pid":1,"name":"process_name","args":{"name":"events.bin"}},)" "\n"
+        R"({"ph":"M","pid":1,"tid":0,"name":"thread_name","args":{"name":"cpu 0"}},)" "\n"
+        R"({"ph":"X","pid":1,"tid":0,"ts":0,"dur":4,"name":"task 0x10"},)" "\n"
+        R"({"ph":"C","pid":1,"ts":1,"name":"physical memory","args":{"bytes":8192}},)" "\n"
+        R"({"ph":"C","pid":1,"ts":2,"name":"physical memory","args":{"bytes":12288}},)" "\n"
+        R"({"ph":"C","pid":1,"ts":3,"name":"physical memory","args":{"bytes":4096}},)" "\n"
+        R"({"ph":"b","pid":1,"cat":"physical","id":"0","ts":1,"name":"tag 0","args":{"address":"0x1000","size":8192,"alignment":4096}},)" "\n"
+        R"({"ph":"e","pid":1,"cat":"physical","id":"0","ts":3,"name":"tag 0","args":{"leaked":false}},)" "\n"
+        R"({"ph":"b","pid":1,"cat":"physical","id":"1","ts":2,"name":"tag 0","args":{"address":"0x4000","size":4096,"alignment":4096}},)" "\n"
+        R"({"ph":"e","pid":1,"cat":"physical","id":"1","ts":5,"name":"tag 0","args":{"leaked":true}})" "\n"
+        "]}\n";
+
+    ASSERT_EQ(out.str(), expected);
+}
+
+TEST(ChromeTraceTest, EscapeJson) {
+    ASSERT_EQ(EscapeJson(R"(a"b\c)"), R"(a\"b\\c)");
+    ASSERT_EQ(EscapeJson("a\nb\tc"), R"(a\nb\tc)");
+    ASSERT_EQ(EscapeJson("\x01"), R"(\u0001)");
+}
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <openssl/evp.h>
+
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ranges>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/// @brief An incremental sha256 digest.
+class Sha256 {
+    EVP_MD_CTX *mContext;
+
+public:
+    Sha256() : mContext(EVP_MD_CTX_new()) {
+        if (mContext == nullptr || EVP_DigestInit_ex(mContext, EVP_sha256(), nullptr) != 1) {
+            throw std::runtime_error("Failed to create sha256 context");
+        }
+    }
+
+    ~Sha256() {
+        EVP_MD_CTX_free(mContext);
+    }
+
+    Sha256(const Sha256&) = delete;
+    Sha256& operator=(const Sha256&) = delete;
+
+    void Update(const void *data, size_t size) {
+        if (EVP_DigestUpdate(mContext, data, size) != 1) {
+            throw std::runtime_error("Failed to update sha256");
+        }
+    }
+
+    /// @brief Add a field, prefixed by its length so adjacent fields can never run together.
+    void Field(std::string_view text) {
+        uint64_t size = text.size();
+        Update(&size, sizeof(size));
+        Update(text.data(), text.size());
+    }
+
+    /// @brief Finish the digest and return it as hex.
+    std::string Finish() {
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned int size = 0;
+        if (EVP_DigestFinal_ex(mContext, digest, &size) != 1) {
+            throw std::runtime_error("Failed to finish sha256");
+        }
+
+        std::string result;
+        for (unsigned int i = 0; i < size; i++) {
+            result += std::format("{:02x}", digest[i]);
+        }
+
+        return result;
+    }
+};
+
+/// @brief Hash the contents of a file.
+inline std::string HashFileContent(const std::filesystem::path& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Failed to open " + path.string());
+    }
+
+    Sha256 sha;
+    char buffer[1 << 16];
+    while (true) {
+        ssize_t result = read(fd, buffer, sizeof(buffer));
+        if (result == 0) {
+            break;
+        }
+
+        if (result < 0) {
+            if (errno == EINTR) continue;
+
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "Failed to read " + path.string());
+        }
+
+        sha.Update(buffer, result);
+    }
+
+    close(fd);
+    return sha.Finish();
+}
+
+/// @brief A content addressed store of package install trees.
+///
+/// Every file is stored once as an object named by its hash, and each install
+/// tree is a manifest of the files, folders and symlinks that make it up. Trees
+/// are restored by cloning the objects with reflinks where the filesystem
+/// supports them, and by hardlinking them where it does not.
+///
+/// Objects are stored without write permissions. A hardlinked file is shared
+/// with the store, so writing to it in place would corrupt every tree that
+/// uses it.
+class InstallCache {
+    std::filesystem::path mRoot;
+    std::atomic<uint64_t> mTempCounter = 0;
+
+    std::filesystem::path ObjectPath(const std::string& hash, mode_t mode) const {
+        return mRoot / "objects" / hash.substr(0, 2) / std::format("{}.{:o}", hash, mode);
+    }
+
+    std::filesystem::path ManifestPath(const std::string& key) const {
+        return mRoot / "installs" / key;
+    }
+
+    std::filesystem::path TempPath(const std::filesystem::path& folder) {
+        std::ostringstream thread;
+        thread << std::this_thread::get_id();
+        return folder / std::format(".tmp-{}-{}-{}", getpid(), thread.str(), mTempCounter++);
+    }
+
+    /// @brief Clone a file with a reflink, fails if the filesystem does not support them.
+    static bool Reflink(const std::filesystem::path& src, const std::filesystem::path& dst, mode_t mode) {
+        int in = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) {
+            return false;
+        }
+
+        int out = open(dst.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+        if (out < 0) {
+            close(in);
+            return false;
+        }
+
+        bool ok = ioctl(out, FICLONE, in) == 0;
+        close(in);
+        close(out);
+
+        if (!ok) {
+            unlink(dst.c_str());
+        }
+
+        return ok;
+    }
+
+    /// @brief Copy a file, cloning it with a reflink if possible.
+    static void CopyFile(const std::filesystem::path& src, const std::filesystem::path& dst, mode_t mode) {
+        if (!Reflink(src, dst, mode)) {
+            std::filesystem::copy_file(src, dst, std::filesystem::copy_options::overwrite_existing);
+        }
+
+        std::filesystem::permissions(dst, std::filesystem::perms(mode));
+    }
+
+    void StoreObject(const std::filesystem::path& path, const std::string& hash, mode_t mode) {
+        std::filesystem::path object = ObjectPath(hash, mode);
+        if (std::filesystem::exists(object)) {
+            return;
+        }
+
+        std::filesystem::create_directories(object.parent_path());
+
+        // Written to a temporary name first so a partial object is never visible.
+        std::filesystem::path temp = TempPath(object.parent_path());
+        CopyFile(path, temp, mode);
+        std::filesystem::rename(temp, object);
+    }
+
+public:
+    InstallCache(std::filesystem::path root)
+        : mRoot(std::move(root))
+    { }
+
+    bool Contains(const std::string& key) const {
+        return std::filesystem::exists(ManifestPath(key));
+    }
+
+    /// @brief Store an install tree under a key.
+    void Store(const std::string& key, const std::filesystem::path& tree) {
+        std::ostringstream manifest;
+
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        std::vector<std::filesystem::directory_entry> entries(std::filesystem::recursive_directory_iterator(tree, options), {});
+        std::ranges::sort(entries);
+
+        for (const auto& entry : entries) {
+            std::string relative = entry.path().lexically_relative(tree).generic_string();
+            if (relative.find_first_of("\t\n") != std::string::npos) {
+                throw std::runtime_error(std::format("Can not cache file with a tab or newline in its name {}", entry.path().string()));
+            }
+
+            mode_t mode = mode_t(entry.symlink_status().permissions()) & 0777;
+
+            if (entry.is_symlink()) {
+                std::string target = std::filesystem::read_symlink(entry.path()).string();
+                if (target.find_first_of("\t\n") != std::string::npos) {
+                    throw std::runtime_error(std::format("Can not cache symlink with a tab or newline in its target {}", entry.path().string()));
+                }
+
+                manifest << std::format("l\t{}\t{}\n", target, relative);
+            } else if (entry.is_directory()) {
+                manifest << std::format("d\t{:o}\t{}\n", mode, relative);
+            } else if (entry.is_regular_file()) {
+                std::string hash = HashFileContent(entry.path());
+                StoreObject(entry.path(), hash, mode & ~0222);
+                manifest << std::format("f\t{:o}\t{}\t{}\n", mode, hash, relative);
+            } else {
+                throw std::runtime_error(std::format("Can not cache special file {}", entry.path().string()));
+            }
+        }
+
+        std::filesystem::path path = ManifestPath(key);
+        std::filesystem::create_directories(path.parent_path());
+
+        std::filesystem::path temp = TempPath(path.parent_path());
+        {
+            std::ofstream out(temp);
+            out << manifest.str();
+            if (!out) {
+                throw std::runtime_error("Failed to write manifest " + temp.string());
+            }
+        }
+
+        std::filesystem::rename(temp, path);
+    }
+
+    /// @brief Replace @p tree with the install tree stored under a key.
+    ///
+    /// @return False if the key is not in the cache or any of its objects are missing.
+    bool Restore(const std::string& key, const std::filesystem::path& tree) {
+        std::ifstream in(ManifestPath(key));
+        if (!in.is_open()) {
+            return false;
+        }
+
+        struct Entry {
+            char type;
+            mode_t mode;
+            std::string data;
+            std::string path;
+        };
+
+        std::vector<Entry> entries;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::vector<std::string> fields;
+            for (auto part : line | std::views::split('\t')) {
+                fields.emplace_back(part.begin(), part.end());
+            }
+
+            if (fields.size() == 3 && fields[0] == "l") {
+                entries.push_back(Entry { 'l', 0, fields[1], fields[2] });
+            } else if (fields.size() == 3 && fields[0] == "d") {
+                entries.push_back(Entry { 'd', mode_t(std::stoul(fields[1], nullptr, 8)), "", fields[2] });
+            } else if (fields.size() == 4 && fields[0] == "f") {
+                mode_t mode = mode_t(std::stoul(fields[1], nullptr, 8));
+                if (!std::filesystem::exists(ObjectPath(fields[2], mode & ~0222))) {
+                    return false;
+                }
+
+                entries.push_back(Entry { 'f', mode, fields[2], fields[3] });
+            } else {
+                return false;
+            }
+        }
+
+        std::filesystem::remove_all(tree);
+        std::filesystem::create_directories(tree);
+
+        // Entries are sorted so every folder is created before its contents.
+        for (const Entry& entry : entries) {
+            std::filesystem::path dst = tree / entry.path;
+            if (entry.type == 'd') {
+                std::filesystem::create_directory(dst);
+            } else if (entry.type == 'l') {
+                std::filesystem::create_symlink(entry.data, dst);
+            } else {
+                std::filesystem::path object = ObjectPath(entry.data, entry.mode & ~0222);
+                if (Reflink(object, dst, entry.mode)) {
+                    std::filesystem::permissions(dst, std::filesystem::perms(entry.mode));
+                    continue;
+                }
+
+                std::error_code ec;
+                std::filesystem::create_hard_link(object, dst, ec);
+                if (ec) {
+                    CopyFile(object, dst, entry.mode);
+                }
+            }
+        }
+
+        // Folder permissions are applied last, a read only folder could not be filled.
+        for (const Entry& entry : entries | std::views::reverse) {
+            if (entry.type == 'd') {
+                std::filesystem::permissions(tree / entry.path, std::filesystem::perms(entry.mode));
+            }
+        }
+
+        return true;
+    }
+};
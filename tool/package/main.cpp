@@ -22,7 +22,9 @@
 
 #include <glob/glob.h>
 
+#include "cache.hpp"
 #include "defer.hpp"
+#include "schedule.hpp"
 
 #include <sys/mman.h>
 #include <sys/mount.h>
@@ -34,6 +36,8 @@
 #include <generator>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 using namespace std::literals;
 
@@ -96,6 +100,9 @@ class Logger {
     std::ostream *mOutStream = &std::cout;
     std::ostream *mErrorStream = &std::cerr;
 
+    // packages are built in parallel, keep each message on its own line
+    std::mutex mLock;
+
 public:
     bool mVerbose = false;
 
@@ -112,15 +119,17 @@ public:
 
     void logv(const std::string& message) {
         if (mVerbose) {
-            *mOutStream << message << std::endl;
+            log(message);
         }
     }
 
     void log(const std::string& message) {
+        std::lock_guard guard(mLock);
         *mOutStream << message << std::endl;
     }
 
     void err(const std::string& message) {
+        std::lock_guard guard(mLock);
         *mErrorStream << message << std::endl;
     }
 
@@ -601,6 +610,9 @@ struct Scope {
 class PackageDb {
     sql::Database mDatabase;
 
+    // packages are built in parallel and share the connection
+    std::recursive_mutex mLock;
+
 public:
     PackageDb(const fs::path& path) : mDatabase(path, sql::OPEN_READWRITE | sql::OPEN_CREATE) {
         mDatabase.exec(
@@ -628,6 +640,40 @@ public:
             "    installed INTEGER NOT NULL\n"
             ")\n"
         );
+
+        mDatabase.exec(
+            "CREATE TABLE IF NOT EXISTS file_hashes (\n"
+            "    path TEXT PRIMARY KEY,\n"
+            "    size INTEGER NOT NULL,\n"
+            "    mtime INTEGER NOT NULL,\n"
+            "    hash TEXT NOT NULL\n"
+            ")\n"
+        );
+    }
+
+    /// @brief Get the hash of a file if it has not changed since it was last hashed
+    std::optional<std::string> GetFileHash(const fs::path& path, uint64_t size, int64_t mtime) {
+        std::lock_guard guard(mLock);
+        sql::Statement query(mDatabase, "SELECT hash FROM file_hashes WHERE path = ? AND size = ? AND mtime = ?");
+        query.bind(1, path.string());
+        query.bind(2, int64_t(size));
+        query.bind(3, mtime);
+
+        if (query.executeStep()) {
+            return query.getColumn(0).getString();
+        }
+
+        return std::nullopt;
+    }
+
+    void SetFileHash(const fs::path& path, uint64_t size, int64_t mtime, const std::string& hash) {
+        std::lock_guard guard(mLock);
+        sql::Statement query(mDatabase, "INSERT OR REPLACE INTO file_hashes (path, size, mtime, hash) VALUES (?, ?, ?, ?)");
+        query.bind(1, path.string());
+        query.bind(2, int64_t(size));
+        query.bind(3, mtime);
+        query.bind(4, hash);
+        query.exec();
     }
 
     bool HasTool(const std::string& name) {
@@ -751,6 +797,7 @@ public:
     }
 
     std::set<std::string> GetPackageDependencies(const std::string& name) {
+        std::lock_guard guard(mLock);
         std::set<std::string> result;
 
         sql::Statement query(mDatabase, "SELECT dependency FROM dependencies WHERE package = ?");
@@ -764,6 +811,7 @@ public:
     }
 
     PackageStatus GetPackageStatus(std::string_view name) {
+        std::lock_guard guard(mLock);
         sql::Statement query(mDatabase, "SELECT status FROM targets WHERE name = ?");
         query.bind(1, std::string(name));
 
@@ -782,12 +830,14 @@ public:
     }
 
     bool ShouldRunStep(std::string_view name, PackageStatus status) {
+        std::lock_guard guard(mLock);
         auto current = GetPackageStatus(name);
         return current == eUnknown || current < status;
     }
 
     void SetPackageStatus(std::string_view name, PackageStatus status) {
         if (name.empty()) throw std::runtime_error("Empty package name");
+        std::lock_guard guard(mLock);
         sql::Statement query(mDatabase, "INSERT OR REPLACE INTO targets (name, status) VALUES (?, ?)");
         query.bind(1, std::string(name));
         query.bind(2, GetPackageStatusString(status));
@@ -797,6 +847,7 @@ public:
     void LowerPackageStatus(std::string_view name, PackageStatus status) {
         if (name.empty()) return;
 
+        std::lock_guard guard(mLock);
         auto current = GetPackageStatus(name);
         if (current > status) {
             SetPackageStatus(name, status);
@@ -806,6 +857,7 @@ public:
     void RaiseTargetStatus(std::string_view name, PackageStatus status) {
         if (name.empty()) return;
 
+        std::lock_guard guard(mLock);
         auto current = GetPackageStatus(name);
         if (current == eUnknown || current < status) {
             SetPackageStatus(name, status);
@@ -821,6 +873,8 @@ public:
 };
 
 static PackageDb *gPackageDb;
+static JobServer *gJobServer;
+static InstallCache *gInstallCache;
 
 struct Workspace {
     std::map<std::string, PackageInfo> packages;
@@ -897,6 +951,14 @@ struct Workspace {
 
     fs::path GetArtifactPath(const std::string& name);
 
+    /// @brief Does another package install into the same folder as this one
+    bool SharesInstallPath(const PackageInfo& info) const {
+        auto path = info.GetInstallPath();
+        return stdr::count_if(packages | stdv::values, [&](const PackageInfo& other) {
+            return other.GetInstallPath() == path;
+        }) > 1;
+    }
+
     bool HasBuildTarget(const std::string& name) {
         return packages.contains(name);
     }
@@ -1651,6 +1713,9 @@ static void AcquirePackage(const PackageInfo& package) {
 }
 
 static void AddGitignoreSymlink(const fs::path& path) {
+    static std::mutex lock;
+    std::lock_guard guard(lock);
+
     std::fstream file(".gitignore", std::ios::in | std::ios::out);
 
     // read in the file
@@ -1850,6 +1915,19 @@ static void ConfigurePackage(const PackageInfo& package) {
     gPackageDb->RaiseTargetStatus(package.name, eConfigured);
 }
 
+/// @brief Let a child build tool take jobs from the shared job server.
+///
+/// Any -j on the command line would make the tool ignore the job server,
+/// the job count is passed through MAKEFLAGS instead.
+static void AddJobServerFlags(std::map<std::string, std::string>& env, ConfigureProgram program) {
+    // meson and cmake both build with ninja
+    if (program == eMeson || program == eCMake) {
+        env["MAKEFLAGS"] = gJobServer->NinjaFlags();
+    } else {
+        env["MAKEFLAGS"] = gJobServer->MakeFlags();
+    }
+}
+
 static void RunBuildStep(const PackageInfo& package, const BuildStep& step) {
     logger.logf("{}: build", package.name);
 
@@ -1868,9 +1946,11 @@ static void RunBuildStep(const PackageInfo& package, const BuildStep& step) {
         ReplacePackagePlaceholders(value, package);
     }
 
+    AddJobServerFlags(env, buildProgram);
+
     if (buildProgram == eMeson) {
         logger.logf("{}: build program meson", package.name);
-        auto result = execute({ "meson", "compile" }, sp::cwd{builddir});
+        auto result = execute({ "meson", "compile" }, sp::cwd{builddir}, sp::environment{env});
         if (result != 0) {
             logger.logf("{}: build failed with exit code {}", package.name, result);
             logger.logf("Error logs: {}", err.string());
@@ -1879,7 +1959,7 @@ static void RunBuildStep(const PackageInfo& package, const BuildStep& step) {
         }
     } else if (buildProgram == eCMake) {
         logger.logf("{}: build program cmake", package.name);
-        auto result = execute({ "cmake", "--build", builddir }, sp::cwd{builddir});
+        auto result = execute({ "cmake", "--build", builddir }, sp::cwd{builddir}, sp::environment{env});
         if (result != 0) {
             logger.logf("{}: build failed with exit code {}", package.name, result);
             logger.logf("Error logs: {}", err.string());
@@ -1888,7 +1968,7 @@ static void RunBuildStep(const PackageInfo& package, const BuildStep& step) {
         }
     } else if (buildProgram == eAutoconf) {
         logger.logf("{}: build program autoconf", package.name);
-        auto result = execute({ "make", "-j" + std::to_string(std::thread::hardware_concurrency()), "-Otarget" }, sp::cwd{builddir});
+        auto result = execute({ "make", "-Otarget" }, sp::cwd{builddir}, sp::environment{env});
         if (result != 0) {
             logger.logf("{}: build failed with exit code {}", package.name, result);
             logger.logf("Error logs: {}", err.string());
@@ -1917,7 +1997,6 @@ static void RunBuildStep(const PackageInfo& package, const BuildStep& step) {
             args.push_back(key + "=" + option);
         }
 
-        args.push_back("-j" + std::to_string(std::thread::hardware_concurrency()));
         auto result = execute(args, sp::cwd{builddir}, sp::output{out.c_str()}, sp::error{err.c_str()}, sp::environment{env});
         if (result != 0) {
             logger.logf("{}: build failed with exit code {}", package.name, result);
@@ -2231,42 +2310,290 @@ static void ReadTargetElement(XmlNode root, Scope& scope) {
     }
 }
 
-static std::set<std::string> gVisitedPackages;
+// packages named on the command line are always built rather than restored
+static std::set<std::string> gUncachedPackages;
 
-static void VisitPackage(const PackageInfo& packageInfo) {
-    assert(!packageInfo.name.empty() && "Package name cannot be empty");
+static std::mutex gPackageKeysLock;
+static std::map<std::string, std::string> gPackageKeys;
 
-    //
-    // Small optimization, NOT required for correctness. We keep track of
-    // visited packages to avoid re-processing them multiple times in the
-    // case of shared dependencies. Functions are idempotent so this is just
-    // to not print duplicate logs.
-    //
-    if (auto [it, inserted] = gVisitedPackages.insert(packageInfo.name); !inserted) {
-        return;
+/// @brief Hash a file, reusing the last hash if its size and mtime have not changed.
+static std::string HashSourceFile(const fs::directory_entry& entry) {
+    auto path = fs::absolute(entry.path());
+    uint64_t size = entry.file_size();
+    int64_t mtime = entry.last_write_time().time_since_epoch().count();
+
+    if (auto hash = gPackageDb->GetFileHash(path, size, mtime)) {
+        return *hash;
     }
 
-    auto deps = gPackageDb->GetPackageDependencies(packageInfo.name);
-    for (const auto& dep : deps) {
-        PackageInfo info;
-        if (!gWorkspace.TryGetPackage(dep, info)) {
+    auto hash = HashFileContent(path);
+    gPackageDb->SetFileHash(path, size, mtime, hash);
+    return hash;
+}
+
+/// @brief Hash every file in a source tree.
+///
+/// Symlinks are hashed by their target rather than followed, the symlinks
+/// to dependencies are covered by the keys of those dependencies.
+static std::string HashSourceTree(const fs::path& root) {
+    Sha256 sha;
+
+    if (!fs::exists(root)) {
+        return sha.Finish();
+    }
+
+    std::vector<fs::directory_entry> entries;
+    for (auto it = fs::recursive_directory_iterator(root); it != fs::recursive_directory_iterator(); ++it) {
+        if (it->is_directory() && !it->is_symlink() && it->path().filename() == ".git") {
+            it.disable_recursion_pending();
+            continue;
+        }
+
+        entries.push_back(*it);
+    }
+
+    stdr::sort(entries);
+
+    for (const auto& entry : entries) {
+        auto relative = entry.path().lexically_relative(root).generic_string();
+        if (entry.is_symlink()) {
+            sha.Field("l");
+            sha.Field(relative);
+            sha.Field(fs::read_symlink(entry.path()).string());
+        } else if (entry.is_regular_file()) {
+            bool executable = (entry.status().permissions() & fs::perms::owner_exec) != fs::perms::none;
+            sha.Field(executable ? "x" : "f");
+            sha.Field(relative);
+            sha.Field(HashSourceFile(entry));
+        }
+    }
+
+    return sha.Finish();
+}
+
+/// @brief Hash everything that decides how a package is configured, built, and installed.
+static void HashPackageRecipe(Sha256& sha, const PackageInfo& package) {
+    auto field = [&](std::string text) {
+        ReplacePackagePlaceholders(text, package);
+        sha.Field(text);
+    };
+
+    auto fields = [&](const auto& map) {
+        for (const auto& [key, value] : map) {
+            field(key);
+            field(value);
+        }
+    };
+
+    auto file = [&](const std::string& path) {
+        if (path.empty()) {
+            return;
+        }
+
+        std::string resolved = path;
+        ReplacePackagePlaceholders(resolved, package);
+
+        std::ifstream in(resolved);
+        field(std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>()));
+    };
+
+    field(package.name);
+    field(package.version);
+    field(package.installName);
+    field(package.installTargets);
+
+    for (const auto& download : package.downloads) {
+        field(download.url);
+        field(download.sha256.value_or(""));
+        field(download.git.url);
+        field(download.git.commit);
+    }
+
+    for (const auto& step : package.configureSteps) {
+        field("configure");
+        field(std::string(ConfigureProgramToString(step.configure)));
+        field(step.configureToolPath);
+        field(step.configureSourcePath);
+        field(step.scriptBody);
+        stdr::for_each(step.args, field);
+        fields(step.env);
+        fields(step.options);
+        file(step.crossFile);
+        file(step.nativeFile);
+    }
+
+    for (const auto& step : package.buildSteps) {
+        field("build");
+        field(std::string(ConfigureProgramToString(step.program)));
+        field(step.buildToolPath);
+        field(step.scriptBody);
+        field(step.targets);
+        field(step.cwd);
+        stdr::for_each(step.args, field);
+        fields(step.env);
+        fields(step.options);
+    }
+}
+
+/// @brief The cache key for a package.
+///
+/// Covers the package recipe, its source tree, and the keys of every package
+/// it depends on, so a change to a dependency changes the key of everything
+/// built on top of it.
+static std::string GetPackageKey(const PackageInfo& package) {
+    {
+        std::lock_guard guard(gPackageKeysLock);
+        if (auto it = gPackageKeys.find(package.name); it != gPackageKeys.end()) {
+            return it->second;
+        }
+    }
+
+    Sha256 sha;
+    HashPackageRecipe(sha, package);
+    sha.Field(HashSourceTree(package.GetSourceFolder()));
+
+    for (const auto& dep : gPackageDb->GetPackageDependencies(package.name)) {
+        if (!gWorkspace.HasBuildTarget(dep)) {
             continue;
         }
 
-        assert(!dep.empty() && "Dependency name cannot be empty");
+        sha.Field(dep);
+        sha.Field(GetPackageKey(gWorkspace.getPackage(dep)));
+    }
+
+    auto key = sha.Finish();
+
+    std::lock_guard guard(gPackageKeysLock);
+    gPackageKeys.emplace(package.name, key);
+    return key;
+}
+
+/// @brief Can the install tree of a package be stored in the cache.
+///
+/// The package must own its install folder, and everything it produces
+/// must be in that folder.
+static bool IsPackageCacheable(const PackageInfo& package) {
+    return gInstallCache != nullptr
+        && package.guessBuildProgram() != eConfigureNone
+        && package.scripts.empty()
+        && !gWorkspace.SharesInstallPath(package);
+}
+
+static bool RestorePackage(const PackageInfo& package, const std::string& key) {
+    if (gUncachedPackages.contains(package.name) || !gInstallCache->Restore(key, package.GetInstallPath())) {
+        return false;
+    }
+
+    logger.logf("{}: restore {}", package.name, key.substr(0, 12));
+    gPackageDb->RaiseTargetStatus(package.name, eInstalled);
+    return true;
+}
 
-        VisitPackage(info);
+static void StorePackage(const PackageInfo& package, const std::string& key) {
+    try {
+        gInstallCache->Store(key, package.GetInstallPath());
+        logger.verbosef("{}: store {}", package.name, key.substr(0, 12));
+    } catch (const std::exception& e) {
+        // A package that can not be cached is still installed
+        logger.errf("{}: failed to store in cache: {}", package.name, e.what());
     }
+}
+
+static void VisitPackage(const PackageInfo& packageInfo) {
+    assert(!packageInfo.name.empty() && "Package name cannot be empty");
 
     logger.verbosef("Processing package {} {}", packageInfo.name, GetPackageStatusString(gPackageDb->GetPackageStatus(packageInfo.name)));
 
     ConnectDependencies(packageInfo);
+
+    bool cacheable = IsPackageCacheable(packageInfo) && gPackageDb->ShouldRunStep(packageInfo.name, eInstalled);
+    std::string key;
+
+    if (cacheable) {
+        key = GetPackageKey(packageInfo);
+        if (RestorePackage(packageInfo, key)) {
+            return;
+        }
+
+        // packages restored by an earlier run were never configured here
+        if (!fs::exists(packageInfo.GetBuildFolder())) {
+            gPackageDb->LowerPackageStatus(packageInfo.name, eDownloaded);
+        }
+    }
+
     ConfigurePackage(packageInfo);
     BuildPackage(packageInfo);
-    InstallPackage(packageInfo);
+
+    if (cacheable) {
+        // start from an empty folder so stale files never end up in the cache
+        RemoveFolderIfExists(packageInfo.GetInstallPath());
+        InstallPackage(packageInfo);
+        StorePackage(packageInfo, key);
+    } else {
+        InstallPackage(packageInfo);
+    }
+
     GenerateArtifact(packageInfo.name, packageInfo);
 }
 
+/// @brief Build a set of packages and everything they depend on.
+///
+/// Packages are visited once all of their dependencies have been visited,
+/// independent packages are visited in parallel.
+static void VisitPackages(const std::set<std::string>& roots) {
+    std::map<std::string, PackageInfo> packages;
+    PackageScheduler scheduler(*gJobServer);
+
+    auto collect = [&](this auto&& self, const std::string& name) -> bool {
+        if (packages.contains(name)) {
+            return true;
+        }
+
+        PackageInfo info;
+        if (!gWorkspace.TryGetPackage(name, info)) {
+            return false;
+        }
+
+        assert(!name.empty() && "Package name cannot be empty");
+
+        packages.emplace(name, info);
+
+        std::set<std::string> deps;
+        for (const auto& dep : gPackageDb->GetPackageDependencies(name)) {
+            if (self(dep)) {
+                deps.insert(dep);
+            }
+        }
+
+        scheduler.AddPackage(name, deps);
+        return true;
+    };
+
+    for (const auto& name : roots) {
+        collect(name);
+    }
+
+    auto timings = scheduler.Run([&](const std::string& name) {
+        VisitPackage(packages.at(name));
+    });
+
+    stdr::sort(timings, [](const auto& lhs, const auto& rhs) { return lhs.path < rhs.path; });
+
+    for (const auto& timing : timings) {
+        logger.verbosef("{}: {:.2f} (critical path {:.2f})", timing.name, timing.elapsed, timing.path);
+    }
+
+    auto path = PackageScheduler::CriticalPath(timings);
+    if (!path.empty()) {
+        auto steps = path
+            | stdv::transform([](const auto& timing) { return std::format("{} ({:.2f})", timing.name, timing.elapsed); })
+            | stdv::join_with(" -> "s)
+            | stdr::to<std::string>();
+
+        logger.logf("critical path {:.2f}: {}", path.back().path, steps);
+    }
+}
+
 static void CheckRequiredTools(PackageDb& db) {
     bool ok = true;
     auto checkTool = [&](const std::string& name) {
@@ -2368,6 +2695,14 @@ static int RunPackageTool(argparse::ArgumentParser& parser) {
 
     gPackageDb = &packageDb;
 
+    JobServer jobServer(gBuildRoot / "jobserver", parser.get<int>("--jobs"));
+    gJobServer = &jobServer;
+
+    InstallCache installCache(PackageCacheRoot() / ".install");
+    if (!parser.get<bool>("--no-cache")) {
+        gInstallCache = &installCache;
+    }
+
     if (parser.present("--workspace")) {
         try {
             gWorkspace.workspace = *argo::parser::load(parser.get<std::string>("--workspace"));
@@ -2406,6 +2741,7 @@ static int RunPackageTool(argparse::ArgumentParser& parser) {
         auto all = parser.get<std::vector<std::string>>(flag);
         for (const auto& name : all) {
             packagesToVisit.insert(name);
+            gUncachedPackages.insert(name);
 
             if (recurseStateLowering) {
                 auto deps = gPackageDb->GetDependantPackages(name);
@@ -2418,6 +2754,7 @@ static int RunPackageTool(argparse::ArgumentParser& parser) {
                     if (hard) {
                         gWorkspace.RelinkPackage(dep);
                         packagesToVisit.insert(dep);
+                        gUncachedPackages.insert(dep);
                     }
 
                     gPackageDb->LowerPackageStatus(dep, status);
@@ -2432,6 +2769,7 @@ static int RunPackageTool(argparse::ArgumentParser& parser) {
                         if (gWorkspace.TryGetPackage(dep, info)) {
                             gWorkspace.RelinkPackage(dep);
                             packagesToVisit.insert(dep);
+                            gUncachedPackages.insert(dep);
                         }
                     }
                 }
@@ -2477,16 +2815,7 @@ static int RunPackageTool(argparse::ArgumentParser& parser) {
         packagesToVisit = gPackageDb->GetToplevelPackages();
     }
 
-    for (auto& pkgName : packagesToVisit) {
-        PackageInfo info;
-        if (!gWorkspace.TryGetPackage(pkgName, info)) {
-            continue;
-        }
-
-        assert(!pkgName.empty() && "Package name cannot be empty");
-
-        VisitPackage(info);
-    }
+    VisitPackages(packagesToVisit);
 
     if (parser.present("--clangd")) {
         GenerateClangDaemonConfig(parser.get<std::vector<std::string>>("--clangd"));
@@ -2598,6 +2927,16 @@ int main(int argc, const char **argv) try {
         .append()
         .nargs(argparse::nargs_pattern::any);
 
+    parser.add_argument("-j", "--jobs")
+        .help("Number of jobs to run in parallel, shared with child make and ninja processes")
+        .default_value(int(std::thread::hardware_concurrency()))
+        .scan<'i', int>();
+
+    parser.add_argument("--no-cache")
+        .help("Always build packages rather than restoring them from the install cache")
+        .default_value(false)
+        .implicit_value(true);
+
     parser.add_argument("--prefix")
         .help("Path to the installation prefix")
         .default_value("install");
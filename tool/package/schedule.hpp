@@ -0,0 +1,351 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// @brief A GNU make compatible job server.
+///
+/// The job server is a fifo holding one token for every job slot after the
+/// first. Every job that runs must hold a slot, and child make and ninja
+/// processes take further tokens from the same fifo, so the whole build shares
+/// a single -j budget.
+class JobServer {
+    std::filesystem::path mPath;
+    int mFd = -1;
+    int mJobs;
+
+    // The first slot is implicit and is never written to the fifo.
+    std::mutex mLock;
+    bool mImplicitFree = true;
+
+public:
+    /// @brief A slot held by a running job.
+    class Token {
+        friend JobServer;
+
+        JobServer *mServer = nullptr;
+        char mValue = 0;
+        bool mImplicit = false;
+
+        Token(JobServer *server, char value, bool implicit)
+            : mServer(server)
+            , mValue(value)
+            , mImplicit(implicit)
+        { }
+
+    public:
+        Token(const Token&) = delete;
+        Token& operator=(const Token&) = delete;
+
+        Token(Token&& other)
+            : mServer(std::exchange(other.mServer, nullptr))
+            , mValue(other.mValue)
+            , mImplicit(other.mImplicit)
+        { }
+
+        ~Token() {
+            if (mServer != nullptr) {
+                mServer->Release(mValue, mImplicit);
+            }
+        }
+    };
+
+    JobServer(std::filesystem::path path, int jobs)
+        : mPath(std::move(path))
+        , mJobs(std::max(jobs, 1))
+    {
+        std::filesystem::remove(mPath);
+
+        if (mkfifo(mPath.c_str(), 0600) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Failed to create job server " + mPath.string());
+        }
+
+        //
+        // Opened read write so that reads block on an empty fifo rather than
+        // returning eof. The descriptor is inherited by child processes, make
+        // before 4.4 only accepts the descriptor form of the protocol.
+        //
+        mFd = open(mPath.c_str(), O_RDWR);
+        if (mFd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Failed to open job server " + mPath.string());
+        }
+
+        std::string tokens(mJobs - 1, '+');
+        if (!tokens.empty() && write(mFd, tokens.data(), tokens.size()) != ssize_t(tokens.size())) {
+            throw std::system_error(errno, std::generic_category(), "Failed to fill job server " + mPath.string());
+        }
+    }
+
+    ~JobServer() {
+        if (mFd >= 0) {
+            close(mFd);
+        }
+
+        std::error_code ec;
+        std::filesystem::remove(mPath, ec);
+    }
+
+    JobServer(const JobServer&) = delete;
+    JobServer& operator=(const JobServer&) = delete;
+
+    int Jobs() const { return mJobs; }
+
+    /// @brief Wait for a free slot.
+    Token Acquire() {
+        {
+            std::lock_guard guard(mLock);
+            if (mImplicitFree) {
+                mImplicitFree = false;
+                return Token(this, 0, true);
+            }
+        }
+
+        char value = 0;
+        while (true) {
+            ssize_t result = read(mFd, &value, 1);
+            if (result == 1) {
+                return Token(this, value, false);
+            }
+
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+
+            throw std::system_error(errno, std::generic_category(), "Failed to read job server " + mPath.string());
+        }
+    }
+
+    /// @brief The MAKEFLAGS value that lets child make processes share the job server.
+    std::string MakeFlags() const {
+        return std::format("-j{} --jobserver-auth={},{}", mJobs, mFd, mFd);
+    }
+
+    /// @brief The MAKEFLAGS value for ninja, which only understands the fifo form.
+    ///
+    /// Ninja 1.13 is the first version with job server support, older
+    /// versions ignore it and use their own -j.
+    std::string NinjaFlags() const {
+        return std::format("-j{} --jobserver-auth=fifo:{}", mJobs, mPath.string());
+    }
+
+private:
+    void Release(char value, bool implicit) {
+        if (implicit) {
+            std::lock_guard guard(mLock);
+            mImplicitFree = true;
+            return;
+        }
+
+        // Nothing sensible can be done if the fifo fails here, the token is lost.
+        while (write(mFd, &value, 1) < 0 && errno == EINTR) { }
+    }
+};
+
+/// @brief Timing for a single package once the schedule has finished.
+struct PackageTiming {
+    std::string name;
+
+    /// @brief Time spent running the package itself.
+    std::chrono::duration<double> elapsed;
+
+    /// @brief The longest chain of package times ending with this package.
+    std::chrono::duration<double> path;
+
+    /// @brief The dependency on the longest chain, empty if there is none.
+    std::string critical;
+};
+
+/// @brief Runs packages in dependency order, independent packages run in parallel.
+///
+/// A package becomes ready once every package it depends on has finished.
+/// Each running package holds a job server slot for as long as it runs.
+class PackageScheduler {
+    struct Node {
+        std::set<std::string> dependencies;
+        std::vector<std::string> dependants;
+        size_t remaining = 0;
+        PackageTiming timing;
+    };
+
+    JobServer& mJobServer;
+    std::map<std::string, Node> mNodes;
+
+    std::mutex mLock;
+    std::condition_variable mChanged;
+    std::deque<std::string> mReady;
+    size_t mRunning = 0;
+    size_t mFinished = 0;
+    std::exception_ptr mError;
+
+    void Finish(const std::string& name, std::chrono::duration<double> elapsed) {
+        Node& node = mNodes.at(name);
+        node.timing.elapsed = elapsed;
+        node.timing.path = elapsed;
+
+        for (const std::string& dep : node.dependencies) {
+            const PackageTiming& timing = mNodes.at(dep).timing;
+            if (timing.path + elapsed > node.timing.path) {
+                node.timing.path = timing.path + elapsed;
+                node.timing.critical = dep;
+            }
+        }
+
+        for (const std::string& dependant : node.dependants) {
+            if (--mNodes.at(dependant).remaining == 0) {
+                mReady.push_back(dependant);
+            }
+        }
+
+        mFinished += 1;
+    }
+
+    bool Done() const {
+        return mRunning == 0 && (mError || mReady.empty());
+    }
+
+    void Worker(const std::function<void(const std::string&)>& run) {
+        std::unique_lock guard(mLock);
+
+        while (true) {
+            mChanged.wait(guard, [&] { return Done() || (!mError && !mReady.empty()); });
+            if (Done()) {
+                return;
+            }
+
+            std::string name = std::move(mReady.front());
+            mReady.pop_front();
+            mRunning += 1;
+
+            guard.unlock();
+
+            std::exception_ptr error;
+            std::chrono::steady_clock::time_point start;
+
+            try {
+                // Time spent waiting for a slot is not part of the package time.
+                JobServer::Token token = mJobServer.Acquire();
+                start = std::chrono::steady_clock::now();
+                run(name);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            guard.lock();
+
+            mRunning -= 1;
+            if (error) {
+                // Stop starting new packages, the running ones are left to finish.
+                if (!mError) mError = error;
+            } else {
+                Finish(name, elapsed);
+            }
+
+            mChanged.notify_all();
+        }
+    }
+
+public:
+    PackageScheduler(JobServer& jobServer)
+        : mJobServer(jobServer)
+    { }
+
+    /// @brief Add a package and the packages it depends on.
+    ///
+    /// Every dependency must also be added before the schedule is run.
+    void AddPackage(const std::string& name, std::set<std::string> dependencies) {
+        mNodes[name].dependencies = std::move(dependencies);
+    }
+
+    bool HasPackage(const std::string& name) const {
+        return mNodes.contains(name);
+    }
+
+    /// @brief Run every package, calling @p run once for each.
+    ///
+    /// @p run is called from multiple threads at the same time. If it throws
+    /// no new packages are started and the first exception is rethrown once
+    /// the running packages finish.
+    std::vector<PackageTiming> Run(const std::function<void(const std::string&)>& run) {
+        for (auto& [name, node] : mNodes) {
+            node.timing.name = name;
+            node.remaining = node.dependencies.size();
+
+            for (const std::string& dep : node.dependencies) {
+                if (!mNodes.contains(dep)) {
+                    throw std::runtime_error(std::format("Package {} depends on unscheduled package {}", name, dep));
+                }
+
+                mNodes.at(dep).dependants.push_back(name);
+            }
+        }
+
+        for (auto& [name, node] : mNodes) {
+            if (node.remaining == 0) {
+                mReady.push_back(name);
+            }
+        }
+
+        {
+            std::vector<std::jthread> workers;
+            for (int i = 0; i < mJobServer.Jobs(); i++) {
+                workers.emplace_back([&] { Worker(run); });
+            }
+        }
+
+        if (mError) {
+            std::rethrow_exception(mError);
+        }
+
+        if (mFinished != mNodes.size()) {
+            throw std::runtime_error("Dependency cycle between packages");
+        }
+
+        std::vector<PackageTiming> result;
+        for (const auto& [_, node] : mNodes) {
+            result.push_back(node.timing);
+        }
+
+        return result;
+    }
+
+    /// @brief The chain of packages that took the longest, from first to last.
+    static std::vector<PackageTiming> CriticalPath(const std::vector<PackageTiming>& timings) {
+        std::map<std::string, const PackageTiming*> byName;
+        const PackageTiming *last = nullptr;
+        for (const PackageTiming& timing : timings) {
+            byName[timing.name] = &timing;
+            if (last == nullptr || timing.path > last->path) {
+                last = &timing;
+            }
+        }
+
+        std::vector<PackageTiming> path;
+        for (const PackageTiming *it = last; it != nullptr; it = it->critical.empty() ? nullptr : byName.at(it->critical)) {
+            path.insert(path.begin(), *it);
+        }
+
+        return path;
+    }
+};